@@ -69,8 +69,8 @@ AF4 SpdLoadSourceImage(ASU2 p, AU1 slice)
         float depth1 = depthTex[min(p + ASU2(2, 0), uInputTextureDimensions - 1)].r;
         float depth2 = depthTex[min(p + ASU2(2, 1), uInputTextureDimensions - 1)].r;
 
-        maxDepth = max(maxDepth, depth1);
-        maxDepth = max(maxDepth, depth2);
+        minDepth = min(minDepth, min(depth1, depth2));
+        maxDepth = max(maxDepth, max(depth1, depth2));
     }
 
     if (sampleExtraRow)
@@ -78,23 +78,30 @@ AF4 SpdLoadSourceImage(ASU2 p, AU1 slice)
         float depth1 = depthTex[min(p + ASU2(0, 2), uInputTextureDimensions - 1)].r;
         float depth2 = depthTex[min(p + ASU2(1, 2), uInputTextureDimensions - 1)].r;
 
-        maxDepth = max(maxDepth, depth1);
-        maxDepth = max(maxDepth, depth2);
+        minDepth = min(minDepth, min(depth1, depth2));
+        maxDepth = max(maxDepth, max(depth1, depth2));
     }
 
     // if both edges are odd, include the corner texel
     if (sampleExtraColumn && sampleExtraRow)
     {
         float depth = depthTex[min(p + ASU2(2, 2), uInputTextureDimensions - 1)].r;
+
+        minDepth = min(minDepth, depth);
+        maxDepth = max(maxDepth, depth);
     }
 
+    // HiZ stores the farthest depth of each texel, so that it can be used for conservative occlusion culling.
+    // With reversed-z it's the min depth.
+    float hiZDepth = minDepth;
+
     minDepth = (minDepth == 0) ? 1 : minDepth;
 
     // bit-wise cast float -> uint preserves the monoticity
     InterlockedMin(minMaxDepthBuffer[0], asuint(minDepth));
     InterlockedMax(minMaxDepthBuffer[1], asuint(maxDepth));
 
-    return AF4_x(maxDepth);
+    return AF4_x(hiZDepth);
 }
 
 //---------------------------------------------------------------------------//
@@ -105,10 +112,10 @@ AF4 SpdLoad(ASU2 p, AU1 slice)
 
     if (p.x >= mipSize.x || p.y >= mipSize.y)
     {
-        return AF4_x(0);
+        return AF4_x(1);
     }
 
-    float maxDepth = hiZBufferTex[5][min(p, uInputTextureDimensions - 1)].r;
+    float hiZDepth = hiZBufferTex[5][min(p, uInputTextureDimensions - 1)].r;
 
     bool sampleExtraColumn = ((mipSize.x & 1) != 0);
     bool sampleExtraRow = ((mipSize.y & 1) != 0);
@@ -116,21 +123,21 @@ AF4 SpdLoad(ASU2 p, AU1 slice)
     // if we are reducing an odd-sized texture, we need to fetch additional texels
     if (sampleExtraColumn)
     {
-        maxDepth = max(maxDepth, hiZBufferTex[5][min(p + int2(2, 0), mipSize - 1)].r);
-        maxDepth = max(maxDepth, hiZBufferTex[5][min(p + int2(2, 1), mipSize - 1)].r);
+        hiZDepth = min(hiZDepth, hiZBufferTex[5][min(p + int2(2, 0), mipSize - 1)].r);
+        hiZDepth = min(hiZDepth, hiZBufferTex[5][min(p + int2(2, 1), mipSize - 1)].r);
     }
     if (sampleExtraRow)
     {
-        maxDepth = max(maxDepth, hiZBufferTex[5][min(p + int2(0, 2), mipSize - 1)].r);
-        maxDepth = max(maxDepth, hiZBufferTex[5][min(p + int2(1, 2), mipSize - 1)].r);
+        hiZDepth = min(hiZDepth, hiZBufferTex[5][min(p + int2(0, 2), mipSize - 1)].r);
+        hiZDepth = min(hiZDepth, hiZBufferTex[5][min(p + int2(1, 2), mipSize - 1)].r);
     }
     // if both edges are odd, include the corner texel
     if (sampleExtraColumn && sampleExtraRow)
     {
-        maxDepth = max(maxDepth, hiZBufferTex[5][min(p + int2(2, 2), mipSize - 1)].r);
+        hiZDepth = min(hiZDepth, hiZBufferTex[5][min(p + int2(2, 2), mipSize - 1)].r);
     }
 
-    return AF4(maxDepth.xxxx);
+    return AF4(hiZDepth.xxxx);
 } // load from output MIP 5
 
 //---------------------------------------------------------------------------//
@@ -187,7 +194,7 @@ void SpdStoreIntermediate(AU1 x, AU1 y, AF4 value)
 
 AF4 SpdReduce4(AF4 v0, AF4 v1, AF4 v2, AF4 v3)
 {
-    return AF4_x(max(v0.x, max(v1.x, max(v2.x, v3.x))));
+    return AF4_x(min(v0.x, min(v1.x, min(v2.x, v3.x))));
 }
 
 //---------------------------------------------------------------------------//
@@ -0,0 +1,401 @@
+//---------------------------------------------------------------------------//
+
+#include "resources.hlsli"
+#include "math.hlsli"
+
+//---------------------------------------------------------------------------//
+
+// Keep in sync with renderer_gpu_culling.odin
+#define GPU_CULLING_THREAD_GROUP_SIZE 64
+
+// Keep in sync with renderer_resource_mesh.odin
+#define MESH_MAX_LODS 4
+
+#define GPU_CULLING_FLAG_FRUSTUM_CULLING 0x01
+#define GPU_CULLING_FLAG_OCCLUSION_CULLING 0x02
+#define GPU_CULLING_FLAG_USE_PREVIOUS_VIEW 0x04
+#define GPU_CULLING_FLAG_WRITE_OCCLUDED_ENTRIES 0x08
+#define GPU_CULLING_FLAG_TEST_OCCLUDED_ENTRIES_ONLY 0x10
+#define GPU_CULLING_FLAG_SELECT_LODS 0x20
+
+// Draw slot of an entry, the LOD is stored in the top 2 bits and the index of the instance
+// within its batch and LOD in the rest
+#define GPU_CULLING_INVALID_DRAW_SLOT 0xFFFFFFFF
+#define GPU_CULLING_DRAW_SLOT_LOD_SHIFT 30
+#define GPU_CULLING_DRAW_SLOT_INSTANCE_MASK 0x3FFFFFFF
+
+//---------------------------------------------------------------------------//
+
+struct GPUCullingEntry
+{
+    uint meshInstanceIdx;
+    uint materialInstanceIdx;
+    uint batchIdx;
+};
+
+//---------------------------------------------------------------------------//
+
+struct GPUCullingBatch
+{
+    float3 boundingBoxMin;
+    uint numLods;
+    float3 boundingBoxMax;
+    uint firstEntry;
+    uint numEntries;
+    uint drawGroupIdx;
+    uint firstDrawCommand;
+    uint lodFirstIndices[MESH_MAX_LODS];
+    uint lodIndexCounts[MESH_MAX_LODS];
+    float lodErrors[MESH_MAX_LODS];
+    uint _padding;
+};
+
+//---------------------------------------------------------------------------//
+
+struct DrawIndexedIndirectCommand
+{
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint firstInstance;
+};
+
+//---------------------------------------------------------------------------//
+
+[[vk::binding(0, 0)]]
+cbuffer GPUCullingParams : register(b0, space0)
+{
+    float4 uFrustumPlanes[6];
+    uint2 uHiZDimensions;
+    uint uHiZMipCount;
+    uint uFlags;
+    uint uNumEntries;
+    uint uNumBatches;
+    uint uNumDrawGroups;
+    uint uDrawInfosOffset;
+    float3 uViewPosition;
+    float uLODErrorThreshold;
+    float uLODPixelsPerUnit;
+    float uNearPlane;
+}
+
+[[vk::binding(1, 0)]]
+StructuredBuffer<GPUCullingEntry> gEntries : register(t0, space0);
+
+[[vk::binding(2, 0)]]
+StructuredBuffer<GPUCullingBatch> gBatches : register(t1, space0);
+
+[[vk::binding(3, 0)]]
+RWStructuredBuffer<uint> gBatchCounters : register(u0, space0);
+
+[[vk::binding(4, 0)]]
+RWStructuredBuffer<uint> gDrawCounts : register(u1, space0);
+
+[[vk::binding(5, 0)]]
+RWStructuredBuffer<MeshInstancedDrawInfo> gDrawInfos : register(u2, space0);
+
+[[vk::binding(6, 0)]]
+RWStructuredBuffer<DrawIndexedIndirectCommand> gDrawCommands : register(u3, space0);
+
+[[vk::binding(7, 0)]]
+RWStructuredBuffer<uint> gOccludedEntries : register(u4, space0);
+
+[[vk::binding(8, 0)]]
+RWStructuredBuffer<uint> gEntryDrawSlots : register(u5, space0);
+
+#if defined(OCCLUSION_CULLING)
+[[vk::binding(9, 0)]]
+Texture2D<float> gHiZTexture : register(t2, space0);
+#endif
+
+//---------------------------------------------------------------------------//
+
+#if defined(RESET_COUNTERS_SHADER)
+
+[numthreads(GPU_CULLING_THREAD_GROUP_SIZE, 1, 1)]
+void ResetCounters(uint3 dispatchThreadId: SV_DispatchThreadID)
+{
+    if (dispatchThreadId.x < uNumBatches * MESH_MAX_LODS)
+    {
+        gBatchCounters[dispatchThreadId.x] = 0;
+    }
+
+    if (dispatchThreadId.x < uNumDrawGroups)
+    {
+        gDrawCounts[dispatchThreadId.x] = 0;
+    }
+}
+
+#endif // RESET_COUNTERS_SHADER
+
+//---------------------------------------------------------------------------//
+
+#if defined(CULL_INSTANCES_SHADER)
+
+//---------------------------------------------------------------------------//
+
+bool IsInsideFrustum(in float3 pCenter, in float3 pExtent)
+{
+    [unroll]
+    for (int i = 0; i < 6; ++i)
+    {
+        const float4 plane = uFrustumPlanes[i];
+        if (dot(plane.xyz, pCenter) + plane.w < -dot(abs(plane.xyz), pExtent))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------------//
+
+#if defined(OCCLUSION_CULLING)
+
+// Projects the bounding box to the screen and tests it against the HiZ buffer,
+// which stores the farthest depth of each texel (min with reversed-z)
+bool IsOccluded(in float3 pBoundsMin, in float3 pBoundsMax, in float4x4 pModelViewProjection)
+{
+    float2 uvMin = float2(1, 1);
+    float2 uvMax = float2(0, 0);
+    float closestDepth = 0;
+
+    [unroll]
+    for (int i = 0; i < 8; ++i)
+    {
+        const float3 corner = float3(
+            (i & 1) ? pBoundsMax.x : pBoundsMin.x,
+            (i & 2) ? pBoundsMax.y : pBoundsMin.y,
+            (i & 4) ? pBoundsMax.z : pBoundsMin.z);
+
+        const float4 clipPos = mul(pModelViewProjection, float4(corner, 1));
+
+        // The box intersects the near plane
+        if (clipPos.w <= 0)
+        {
+            return false;
+        }
+
+        const float3 ndc = clipPos.xyz / clipPos.w;
+
+        // UV grows downwards
+        const float2 uv = float2(0.5 + 0.5 * ndc.x, 0.5 - 0.5 * ndc.y);
+
+        uvMin = min(uvMin, uv);
+        uvMax = max(uvMax, uv);
+        closestDepth = max(closestDepth, ndc.z);
+    }
+
+    uvMin = saturate(uvMin);
+    uvMax = saturate(uvMax);
+
+    // Pick the mip at which the box covers at most 2x2 texels
+    const float2 extent = (uvMax - uvMin) * float2(uHiZDimensions);
+    const uint mip = min(uint(ceil(log2(max(max(extent.x, extent.y), 1)))), uHiZMipCount - 1);
+
+    const uint2 mipDimensions = max(uHiZDimensions >> mip, uint2(1, 1));
+    const uint2 texelMin = min(uint2(uvMin * float2(mipDimensions)), mipDimensions - 1);
+    const uint2 texelMax = min(uint2(uvMax * float2(mipDimensions)), mipDimensions - 1);
+
+    const float farthestDepth = min(
+        min(gHiZTexture.Load(int3(texelMin.x, texelMin.y, mip)), gHiZTexture.Load(int3(texelMax.x, texelMin.y, mip))),
+        min(gHiZTexture.Load(int3(texelMin.x, texelMax.y, mip)), gHiZTexture.Load(int3(texelMax.x, texelMax.y, mip))));
+
+    return closestDepth < farthestDepth;
+}
+
+#endif // OCCLUSION_CULLING
+
+//---------------------------------------------------------------------------//
+
+// Selects the coarsest LOD whose error, projected on the screen, is below the threshold.
+// Keep in sync with select_mesh_batch_entry_lods in renderer_job_render_instanced_mesh.odin
+uint SelectLOD(in GPUCullingBatch pBatch, in float4x4 pModelMatrix)
+{
+    // The errors are in mesh space, scale them by the largest scale of the instance
+    const float3x3 axes = transpose((float3x3)pModelMatrix);
+    const float scale = max(max(length(axes[0]), length(axes[1])), length(axes[2]));
+
+    const float3 center = (pBatch.boundingBoxMin + pBatch.boundingBoxMax) * 0.5;
+    const float radius = length(pBatch.boundingBoxMax - center) * scale;
+    const float3 centerWS = mul(pModelMatrix, float4(center, 1)).xyz;
+
+    // Size of a world space unit in pixels at the closest point of the bounding sphere
+    const float distanceToView = max(length(centerWS - uViewPosition) - radius, uNearPlane);
+    const float pixelsPerUnit = uLODPixelsPerUnit / distanceToView;
+
+    uint lod = 0;
+    for (uint i = 1; i < pBatch.numLods; ++i)
+    {
+        if (pBatch.lodErrors[i] * scale * pixelsPerUnit > uLODErrorThreshold)
+        {
+            break;
+        }
+        lod = i;
+    }
+
+    return lod;
+}
+
+//---------------------------------------------------------------------------//
+
+[numthreads(GPU_CULLING_THREAD_GROUP_SIZE, 1, 1)]
+void CullInstances(uint3 dispatchThreadId: SV_DispatchThreadID)
+{
+    const uint entryIdx = dispatchThreadId.x;
+    if (entryIdx >= uNumEntries)
+    {
+        return;
+    }
+
+    // Entries that aren't drawn keep the invalid slot, so the draw infos pass skips them
+    gEntryDrawSlots[entryIdx] = GPU_CULLING_INVALID_DRAW_SLOT;
+
+    if ((uFlags & GPU_CULLING_FLAG_TEST_OCCLUDED_ENTRIES_ONLY) && gOccludedEntries[entryIdx] == 0)
+    {
+        return;
+    }
+
+    const GPUCullingEntry entry = gEntries[entryIdx];
+    const GPUCullingBatch batch = gBatches[entry.batchIdx];
+    const MeshInstanceInfo meshInstanceInfo = gMeshInstanceInfoBuffer[entry.meshInstanceIdx];
+
+    bool isVisible = true;
+
+    if (uFlags & GPU_CULLING_FLAG_FRUSTUM_CULLING)
+    {
+        const float3 center = (batch.boundingBoxMin + batch.boundingBoxMax) * 0.5;
+        const float3 extent = (batch.boundingBoxMax - batch.boundingBoxMin) * 0.5;
+
+        const float3 centerWS = mul(meshInstanceInfo.modelMatrix, float4(center, 1)).xyz;
+        const float3x3 absModelMatrix = abs((float3x3)meshInstanceInfo.modelMatrix);
+        const float3 extentWS = mul(absModelMatrix, extent);
+
+        isVisible = IsInsideFrustum(centerWS, extentWS);
+    }
+
+    bool isOccluded = false;
+
+#if defined(OCCLUSION_CULLING)
+    if (isVisible && (uFlags & GPU_CULLING_FLAG_OCCLUSION_CULLING))
+    {
+        // The HiZ buffer of the previous frame has to be tested with the previous transforms
+        const float4x4 modelViewProjection = (uFlags & GPU_CULLING_FLAG_USE_PREVIOUS_VIEW) ?
+            mul(uPerView.PreviousView.ViewProjectionMatrix, meshInstanceInfo.prevModelMatrix) :
+            mul(uPerView.CurrentView.ViewProjectionMatrix, meshInstanceInfo.modelMatrix);
+
+        isOccluded = IsOccluded(batch.boundingBoxMin, batch.boundingBoxMax, modelViewProjection);
+    }
+#endif // OCCLUSION_CULLING
+
+    if (uFlags & GPU_CULLING_FLAG_WRITE_OCCLUDED_ENTRIES)
+    {
+        gOccludedEntries[entryIdx] = (isVisible && isOccluded) ? 1 : 0;
+    }
+
+    if (!isVisible || isOccluded)
+    {
+        return;
+    }
+
+    const uint lod = (uFlags & GPU_CULLING_FLAG_SELECT_LODS) ?
+        SelectLOD(batch, meshInstanceInfo.modelMatrix) :
+        0;
+
+    uint instanceIdx;
+    InterlockedAdd(gBatchCounters[entry.batchIdx * MESH_MAX_LODS + lod], 1, instanceIdx);
+
+    gEntryDrawSlots[entryIdx] = (lod << GPU_CULLING_DRAW_SLOT_LOD_SHIFT) | instanceIdx;
+}
+
+#endif // CULL_INSTANCES_SHADER
+
+//---------------------------------------------------------------------------//
+
+#if defined(BUILD_DRAW_COMMANDS_SHADER)
+
+[numthreads(GPU_CULLING_THREAD_GROUP_SIZE, 1, 1)]
+void BuildDrawCommands(uint3 dispatchThreadId: SV_DispatchThreadID)
+{
+    const uint batchIdx = dispatchThreadId.x;
+    if (batchIdx >= uNumBatches)
+    {
+        return;
+    }
+
+    const GPUCullingBatch batch = gBatches[batchIdx];
+
+    // Instances of each LOD follow the ones of the previous LOD in the draw infos of the batch
+    uint firstInstance = batch.firstEntry;
+
+    for (uint lod = 0; lod < batch.numLods; ++lod)
+    {
+        const uint numInstances = gBatchCounters[batchIdx * MESH_MAX_LODS + lod];
+        if (numInstances == 0)
+        {
+            continue;
+        }
+
+        // Draw commands of a group are compacted, so the indirect count draw can skip the empty ones
+        uint drawIdx;
+        InterlockedAdd(gDrawCounts[batch.drawGroupIdx], 1, drawIdx);
+
+        DrawIndexedIndirectCommand command;
+        command.indexCount = batch.lodIndexCounts[lod];
+        command.instanceCount = numInstances;
+        command.firstIndex = batch.lodFirstIndices[lod];
+        command.vertexOffset = 0;
+        command.firstInstance = firstInstance;
+
+        gDrawCommands[batch.firstDrawCommand + drawIdx] = command;
+
+        firstInstance += numInstances;
+    }
+}
+
+#endif // BUILD_DRAW_COMMANDS_SHADER
+
+//---------------------------------------------------------------------------//
+
+#if defined(WRITE_DRAW_INFOS_SHADER)
+
+[numthreads(GPU_CULLING_THREAD_GROUP_SIZE, 1, 1)]
+void WriteDrawInfos(uint3 dispatchThreadId: SV_DispatchThreadID)
+{
+    const uint entryIdx = dispatchThreadId.x;
+    if (entryIdx >= uNumEntries)
+    {
+        return;
+    }
+
+    const uint drawSlot = gEntryDrawSlots[entryIdx];
+    if (drawSlot == GPU_CULLING_INVALID_DRAW_SLOT)
+    {
+        return;
+    }
+
+    const uint lod = drawSlot >> GPU_CULLING_DRAW_SLOT_LOD_SHIFT;
+    const uint instanceIdx = drawSlot & GPU_CULLING_DRAW_SLOT_INSTANCE_MASK;
+
+    const GPUCullingEntry entry = gEntries[entryIdx];
+    const GPUCullingBatch batch = gBatches[entry.batchIdx];
+
+    // Same layout as the firstInstance of the draw commands, see BuildDrawCommands
+    uint firstInstance = batch.firstEntry;
+    for (uint i = 0; i < lod; ++i)
+    {
+        firstInstance += gBatchCounters[entry.batchIdx * MESH_MAX_LODS + i];
+    }
+
+    MeshInstancedDrawInfo drawInfo;
+    drawInfo.meshInstanceIdx = entry.meshInstanceIdx;
+    drawInfo.materialInstanceIdx = entry.materialInstanceIdx;
+
+    gDrawInfos[uDrawInfosOffset + firstInstance + instanceIdx] = drawInfo;
+}
+
+#endif // WRITE_DRAW_INFOS_SHADER
+
+//---------------------------------------------------------------------------//
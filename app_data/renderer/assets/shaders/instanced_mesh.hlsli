@@ -2,6 +2,7 @@
 #define GEOMETRY_PASS_INSTANCED_MESH_H
 
 #include "scene_types.hlsli"
+#include "packing.hlsli"
 
 [[vk::binding(0, 0)]]
 StructuredBuffer<MeshInstancedDrawInfo> gMeshInstancedDrawInfoBuffer : register(t0, space0);
@@ -11,4 +12,29 @@ MeshInstancedDrawInfo FetchMeshInstanceInfo(in uint pInstanceId)
     return gMeshInstancedDrawInfoBuffer[pInstanceId];
 }
 
+// Vertex attributes are packed, keep in sync with VertexFormat in renderer_resource_mesh.odin
+struct PackedVertexInput
+{
+    [[vk::location(0)]]
+    float4 position : POSITION;
+    [[vk::location(1)]]
+    float2 uv : TEXCOORD0;
+    [[vk::location(2)]]
+    float2 normal : NORMAL;
+    [[vk::location(3)]]
+    float2 tangent : TANGENT;
+};
+
+// Positions are quantized to 16 bits relative to the bounds of the mesh
+float3 DecodeVertexPosition(in float4 pPackedPosition, in MeshInstanceInfo pMeshInstanceInfo)
+{
+    return pMeshInstanceInfo.positionOffset.xyz + pPackedPosition.xyz * pMeshInstanceInfo.positionScale.xyz;
+}
+
+// Normals and tangents are octahedral encoded
+float3 DecodeVertexDirection(in float2 pPackedDirection)
+{
+    return decodeNormal(pPackedDirection);
+}
+
 #endif // GEOMETRY_PASS_INSTANCED_MESH_H
@@ -29,20 +29,6 @@ StructuredBuffer<ShadowCascade> ShadowCascades : register(t0, space0);
 
 //---------------------------------------------------------------------------//
 
-struct VSInput
-{
-    [[vk::location(0)]]
-    float3 position : POSITION;
-    [[vk::location(1)]]
-    float2 uv : TEXCOORD0;
-    [[vk::location(2)]]
-    float3 normal : NORMAL;
-    [[vk::location(3)]]
-    float3 tangent : TANGENT;
-};
-
-//---------------------------------------------------------------------------//
-
 struct PSInput
 {
 };
@@ -55,12 +41,13 @@ struct PSOutput
 
 //---------------------------------------------------------------------------//
 
-float4 VSMain(in VSInput pVertexInput, in uint pInstanceId: SV_INSTANCEID, out PSInput pPixelInput) : SV_Position
+float4 VSMain(in PackedVertexInput pVertexInput, in uint pInstanceId: SV_INSTANCEID, out PSInput pPixelInput) : SV_Position
 {
     const MeshInstancedDrawInfo meshInstancedDrawInfo = FetchMeshInstanceInfo(pInstanceId);
+    const MeshInstanceInfo meshInstanceInfo = gMeshInstanceInfoBuffer[meshInstancedDrawInfo.meshInstanceIdx];
 
-    const float4x4 modelMatrix = gMeshInstanceInfoBuffer[meshInstancedDrawInfo.meshInstanceIdx].modelMatrix;
-    const float3 positionWS = mul(modelMatrix, float4(pVertexInput.position, 1.0)).xyz;
+    const float3 position = DecodeVertexPosition(pVertexInput.position, meshInstanceInfo);
+    const float3 positionWS = mul(meshInstanceInfo.modelMatrix, float4(position, 1.0)).xyz;
 
     return mul(ShadowCascades[CascadeShadows.CascadeIndex].RenderMatrix, float4(positionWS.xyz, 1));
 }
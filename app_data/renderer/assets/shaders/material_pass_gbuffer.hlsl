@@ -14,20 +14,6 @@
 
 //---------------------------------------------------------------------------//
 
-struct VSInput
-{
-    [[vk::location(0)]]
-    float3 position : POSITION;
-    [[vk::location(1)]]
-    float2 uv : TEXCOORD0;
-    [[vk::location(2)]]
-    float3 normal : NORMAL;
-    [[vk::location(3)]]
-    float3 tangent : TANGENT;
-};
-
-//---------------------------------------------------------------------------//
-
 struct PSInput
 {
     [[vk::location(0)]]
@@ -62,15 +48,20 @@ struct PSOutput
 
 //---------------------------------------------------------------------------//
 
-float4 VSMain(in VSInput pVertexInput, in uint pInstanceId: SV_INSTANCEID, out PSInput pPixelInput) : SV_Position
+float4 VSMain(in PackedVertexInput pVertexInput, in uint pInstanceId: SV_INSTANCEID, out PSInput pPixelInput) : SV_Position
 {
     const MeshInstancedDrawInfo meshInstancedDrawInfo = FetchMeshInstanceInfo(pInstanceId);
+    const MeshInstanceInfo meshInstanceInfo = gMeshInstanceInfoBuffer[meshInstancedDrawInfo.meshInstanceIdx];
+
+    const float4x4 modelMatrix = meshInstanceInfo.modelMatrix;
+    const float4x4 prevModelMatrix = meshInstanceInfo.prevModelMatrix;
 
-    const float4x4 modelMatrix = gMeshInstanceInfoBuffer[meshInstancedDrawInfo.meshInstanceIdx].modelMatrix;
-    const float4x4 prevModelMatrix = gMeshInstanceInfoBuffer[meshInstancedDrawInfo.meshInstanceIdx].prevModelMatrix;
+    const float3 position = DecodeVertexPosition(pVertexInput.position, meshInstanceInfo);
+    const float3 normal = DecodeVertexDirection(pVertexInput.normal);
+    const float3 tangent = DecodeVertexDirection(pVertexInput.tangent);
 
-    const float3 positionWS = mul(modelMatrix, float4(pVertexInput.position, 1.0)).xyz;
-    const float3 prevPositionWS = mul(prevModelMatrix, float4(pVertexInput.position, 1.0)).xyz;
+    const float3 positionWS = mul(modelMatrix, float4(position, 1.0)).xyz;
+    const float3 prevPositionWS = mul(prevModelMatrix, float4(position, 1.0)).xyz;
 
     const float4 positionClip = mul(uPerView.CurrentView.ViewProjectionMatrix, float4(positionWS.xyz, 1));
     const float4 prevPositionClip = mul(uPerView.PreviousView.ViewProjectionMatrix, float4(prevPositionWS.xyz, 1));
@@ -83,9 +74,9 @@ float4 VSMain(in VSInput pVertexInput, in uint pInstanceId: SV_INSTANCEID, out P
     pPixelInput.prevPositionClip = prevPositionClip;
     pPixelInput.materialInstanceIdx = meshInstancedDrawInfo.materialInstanceIdx;
     pPixelInput.uv = pVertexInput.uv;
-    pPixelInput.normal = normalize(mul(normalMatrix, pVertexInput.normal));
-    pPixelInput.tangent = normalize(mul(normalMatrix, pVertexInput.tangent));
-    pPixelInput.binormal = normalize(cross(pVertexInput.normal, pVertexInput.tangent));
+    pPixelInput.normal = normalize(mul(normalMatrix, normal));
+    pPixelInput.tangent = normalize(mul(normalMatrix, tangent));
+    pPixelInput.binormal = normalize(cross(normal, tangent));
 
     return positionClip;
 }
@@ -33,6 +33,9 @@ struct MeshInstanceInfo
 {
     float4x4 modelMatrix;
     float4x4 prevModelMatrix;
+    // Dequantizes the positions of the mesh
+    float4 positionOffset;
+    float4 positionScale;
 };
 
 //---------------------------------------------------------------------------//
@@ -9,11 +9,16 @@ VULKAN_SDK_ENV_VAR_NAMES = [
     "VULKAN_SDK"
 ]
 
+# The Linux builds link the static archives, see the foreign imports in src/third_party
+IS_WINDOWS = os.name == "nt"
+LIB_EXTENSION = ".lib" if IS_WINDOWS else ".a"
+
 #-----------------------------------------------------------------------#
 
 def run_command_silent(args):
     return subprocess.run(
         " ".join(args),
+        shell=not IS_WINDOWS,
         #stdout=subprocess.DEVNULL,
         #stderr=subprocess.DEVNULL
     ).returncode
@@ -38,9 +43,9 @@ def build_vma():
 
     res = run_command_silent([
         "clang++",
-        "-I %s/Include" % vulkan_sdk_path,
+        "-I %s/%s" % (vulkan_sdk_path, "Include" if IS_WINDOWS else "include"),
         "-c", 
-        "-o src/third_party/vma/external/vma.o", 
+        "-o ../src/third_party/vma/external/vma.o", 
         "../src/third_party/vma/external/vma.cpp"
     ])
 
@@ -51,7 +56,7 @@ def build_vma():
     res = run_command_silent([
         "llvm-ar",
         "rc",
-        "../src/third_party/vma/external/vma.lib",
+        "../src/third_party/vma/external/vma" + LIB_EXTENSION,
         "../src/third_party/vma/external/vma.o"
     ])
 
@@ -69,10 +74,10 @@ def build_tinyobj():
     print("Building tiny_obj_loader...")
 
     res = run_command_silent([
-        "clang++",
+        "clang",
         "-c", 
-        "-o src/third_party/tiny_obj_loader/external/tiny_obj_loader.o", 
-        "../src/third_party/tiny_obj_loader/external/tiny_obj_loader.cc"
+        "-o ../src/third_party/tiny_obj_loader/external/tiny_obj_loader.o", 
+        "../src/third_party/tiny_obj_loader/external/tiny_obj_loader.c"
     ])
 
     if res != 0:
@@ -82,7 +87,7 @@ def build_tinyobj():
     res = run_command_silent([
         "llvm-ar",
         "rc",
-        "../src/third_party/tiny_obj_loader/external/tiny_obj_loader.lib",
+        "../src/third_party/tiny_obj_loader/external/tiny_obj_loader" + LIB_EXTENSION,
         "../src/third_party/tiny_obj_loader/external/tiny_obj_loader.o"
     ])
 
@@ -104,7 +109,7 @@ def build_spirv_reflect():
     res = run_command_silent([
         "clang++",
         "-c", 
-        "-o src/third_party/spirv_reflect/external/spirv_reflect.o", 
+        "-o ../src/third_party/spirv_reflect/external/spirv_reflect.o", 
         "../src/third_party/spirv_reflect/external/spirv_reflect.cpp"
     ])
 
@@ -115,7 +120,7 @@ def build_spirv_reflect():
     res = run_command_silent([
         "llvm-ar",
         "rc",
-        "../src/third_party/spirv_reflect/external/spirv_reflect.lib",
+        "../src/third_party/spirv_reflect/external/spirv_reflect" + LIB_EXTENSION,
         "../src/third_party/spirv_reflect/external/spirv_reflect.o"
     ])
 
@@ -147,7 +152,7 @@ def build_tinyobjloader():
     res = run_command_silent([
         "llvm-ar",
         "rc",
-        "../src/third_party/tinydds/external/tinydds.lib",
+        "../src/third_party/tinydds/external/tinydds" + LIB_EXTENSION,
         "../src/third_party/tinydds/external/tinydds.o"
     ])
 
@@ -162,9 +167,12 @@ def build_tinyobjloader():
 #-----------------------------------------------------------------------#
 
 def main():
-    # build_vma()
-    # build_tinyobj()
-    #build_spirv_reflect()
+    # Nothing is prebuilt for Linux, assimp comes from the system package there
+    if not IS_WINDOWS:
+        build_vma()
+        build_tinyobj()
+        build_spirv_reflect()
+
     build_tinyobjloader()
 #-----------------------------------------------------------------------#
 
@@ -11,11 +11,14 @@ DEFAULT_TEMP_ARENA_SIZE :: 16 * KILOBYTE
 
 //---------------------------------------------------------------------------//
 
-@(private = "file")
+// Thread local, as the stack allocator isn't thread safe. Each thread that uses
+// temp arenas (e.g. job system workers) has to call temp_arenas_init_stack first.
+@(private = "file", thread_local)
 INTERNAL: struct {
 	// Stack used to sub-allocate scratch arenas from that are used within a function scope 
 	temp_arenas_stack:     mem.Stack,
 	temp_arenas_allocator: mem.Allocator,
+	backing_allocator:     mem.Allocator,
 }
 
 //---------------------------------------------------------------------------//
@@ -24,6 +27,14 @@ temp_arenas_init_stack :: proc(p_arenas_size: u32, p_allocator: mem.Allocator) {
 	// Init the stack used for temp areans
 	mem.stack_init(&INTERNAL.temp_arenas_stack, make([]byte, p_arenas_size, p_allocator))
 	INTERNAL.temp_arenas_allocator = mem.stack_allocator(&INTERNAL.temp_arenas_stack)
+	INTERNAL.backing_allocator = p_allocator
+}
+
+//---------------------------------------------------------------------------//
+
+temp_arenas_deinit_stack :: proc() {
+	delete(INTERNAL.temp_arenas_stack.data, INTERNAL.backing_allocator)
+	INTERNAL = {}
 }
 
 //---------------------------------------------------------------------------//
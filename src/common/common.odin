@@ -12,6 +12,7 @@ import "core:os"
 import "core:slice"
 import "core:strconv"
 import "core:strings"
+import "core:sync"
 
 //---------------------------------------------------------------------------//
 
@@ -37,8 +38,10 @@ GIGABYTE :: MEGABYTE * 1024
 Name :: distinct u32
 @(private = "file")
 INTERNAL: struct {
-	string_table:     map[Name]string,
-	string_allocator: mem.Allocator,
+	string_table:      map[Name]string,
+	string_allocator:  mem.Allocator,
+	// Names are created and read by the asset loading jobs as well
+	string_table_lock: sync.RW_Mutex,
 }
 
 //---------------------------------------------------------------------------//
@@ -54,10 +57,19 @@ init_names :: proc(p_string_allocator: mem.Allocator) {
 create_name :: proc(p_name: string) -> Name {
 	assert(len(p_name) > 0)
 	name := Name(hash.crc32(transmute([]u8)p_name))
-	if name in INTERNAL.string_table {
+
+	sync.shared_lock(&INTERNAL.string_table_lock)
+	exists := name in INTERNAL.string_table
+	sync.shared_unlock(&INTERNAL.string_table_lock)
+	if exists {
 		return name
 	}
-	INTERNAL.string_table[name] = strings.clone(p_name, INTERNAL.string_allocator)
+
+	sync.lock(&INTERNAL.string_table_lock)
+	defer sync.unlock(&INTERNAL.string_table_lock)
+	if name not_in INTERNAL.string_table {
+		INTERNAL.string_table[name] = strings.clone(p_name, INTERNAL.string_allocator)
+	}
 	return name
 }
 
@@ -75,6 +87,8 @@ name_equal :: proc(p_name_1: Name, p_name_2: Name) -> bool {
 //---------------------------------------------------------------------------//
 
 get_string :: proc(p_name: Name) -> string {
+	sync.shared_lock(&INTERNAL.string_table_lock)
+	defer sync.shared_unlock(&INTERNAL.string_table_lock)
 	assert(p_name in INTERNAL.string_table)
 	return INTERNAL.string_table[p_name]
 }
@@ -1,115 +1,192 @@
 package common
 
+import "core:mem"
 import "core:time"
-import "core:sys/windows"
 
 //---------------------------------------------------------------------------//
 
-get_last_file_write_time :: proc(p_file_path: string) -> time.Time {
-    
-    temp_arena: Arena
-	temp_arena_init(&temp_arena)
-	defer arena_delete(temp_arena)
-
-	path_w := windows.utf8_to_wstring(p_file_path, temp_arena.allocator)
-
-    file_handle := windows.CreateFileW(
-		path_w,
-		windows.GENERIC_READ,
-		windows.FILE_SHARE_READ,
-		nil,
-		windows.OPEN_EXISTING,
-		windows.FILE_ATTRIBUTE_NORMAL,
-		nil,
-	)
-
-	if file_handle == windows.INVALID_HANDLE_VALUE {
-        return time.Time{}
-	}
-	
-    defer {
-		windows.CloseHandle(file_handle)
-	}
+// The platform specific parts live in filesystem_windows.odin and filesystem_linux.odin
 
-    ft_create: windows.FILETIME
-    ft_access: windows.FILETIME
-    ft_write: windows.FILETIME
+//---------------------------------------------------------------------------//
 
-    if !windows.GetFileTime(file_handle, &ft_create, &ft_access, &ft_write) {
-        return time.Time{}
-    }
+// Reads the asset data files through io_uring on Linux. Off by default, the files are then read
+// with blocking reads on the job system.
+ASYNC_FILE_IO_ENABLED :: #config(NEAT_ASYNC_FILE_IO, false)
 
-    write_time : i64 = 0
-    write_time |= i64(ft_write.dwLowDateTime)
-    write_time |= (i64(ft_write.dwHighDateTime) << 32)
+//---------------------------------------------------------------------------//
 
-    return time.from_nanoseconds(write_time)
+FileMapHint :: enum u8 {
+	// The data is read front to back, lets the OS read ahead more aggressively
+	Sequential,
+	// Starts reading the whole file in the background, mmap_file doesn't wait for it
+	WillNeed,
+	// Reads the whole file before mmap_file returns
+	Populate,
+	// Backs the mapping with huge pages when it's large enough and the OS supports it,
+	// only has an effect on Linux
+	HugePages,
 }
 
+FileMapHints :: bit_set[FileMapHint;u8]
+
 //---------------------------------------------------------------------------//
 
+// Mappings smaller than this don't ask for huge pages
+@(private)
+FILE_MAP_HUGE_PAGES_MIN_SIZE :: 2 * MEGABYTE
+
+//---------------------------------------------------------------------------//
 
 FileMemoryMapping :: struct {
-	file_handle:    windows.HANDLE,
-	mapping_handle: windows.HANDLE,
 	mapped_ptr:     rawptr,
+	size:           int,
+	// Set when the file was read into memory by an async read instead of being mapped,
+	// unmap_file frees the data with it
+	read_allocator: mem.Allocator,
+	using platform: PlatformFileMapping,
+}
+
+//---------------------------------------------------------------------------//
+
+AsyncFileReadStatus :: enum u8 {
+	Pending,
+	Done,
+	Failed,
+}
+
+//---------------------------------------------------------------------------//
+
+// Read of a whole file into memory, see async_file_read_begin
+AsyncFileRead :: struct {
+	status:         AsyncFileReadStatus,
+	// Contents of the file once the read is done, released with unmap_file
+	mapping:        FileMemoryMapping,
+	using platform: PlatformAsyncFileRead,
 }
 
 //---------------------------------------------------------------------------//
 
-mmap_file :: proc(p_file_path: string) -> (out_mapping: FileMemoryMapping, out_res: bool) {
+DirectoryWatcher :: struct {
+	using platform: PlatformDirectoryWatcher,
+}
+
+//---------------------------------------------------------------------------//
 
-	temp_arena: Arena
-	temp_arena_init(&temp_arena)
-	defer arena_delete(temp_arena)
+get_last_file_write_time :: proc(p_file_path: string) -> time.Time {
+	return platform_get_last_file_write_time(p_file_path)
+}
 
-	path_w := windows.utf8_to_wstring(p_file_path, temp_arena.allocator)
+//---------------------------------------------------------------------------//
 
-	file_handle := windows.CreateFileW(
-		path_w,
-		windows.GENERIC_READ,
-		windows.FILE_SHARE_READ,
-		nil,
-		windows.OPEN_EXISTING,
-		windows.FILE_ATTRIBUTE_NORMAL,
-		nil,
-	)
-	if file_handle == windows.INVALID_HANDLE_VALUE {
-		return {}, false
+mmap_file :: proc(
+	p_file_path: string,
+	p_hints: FileMapHints = {},
+) -> (
+	out_mapping: FileMemoryMapping,
+	out_res: bool,
+) {
+	return platform_mmap_file(p_file_path, p_hints)
+}
+
+//---------------------------------------------------------------------------//
+
+unmap_file :: proc(p_mapping: FileMemoryMapping) {
+	if p_mapping.read_allocator.procedure != nil {
+		mem.free(p_mapping.mapped_ptr, p_mapping.read_allocator)
+		return
 	}
-	defer if (out_res == false) {
-		windows.CloseHandle(file_handle)
+	platform_unmap_file(p_mapping)
+}
+
+//---------------------------------------------------------------------------//
+
+// Asks the OS to start reading the given range of the mapping in the background, returns right
+// away. Used by the asset loads to get the reads going before the data is actually touched.
+mmap_file_prefetch :: proc(p_mapping: FileMemoryMapping, p_offset: int, p_size: int) {
+	assert(p_offset >= 0 && p_offset + p_size <= p_mapping.size)
+	if p_size == 0 || p_mapping.read_allocator.procedure != nil {
+		return
 	}
+	platform_mmap_file_prefetch(p_mapping, p_offset, p_size)
+}
+
+//---------------------------------------------------------------------------//
+
+// Starts watching a directory and its subdirectories for file writes
+directory_watcher_init :: proc(
+	p_watcher: ^DirectoryWatcher,
+	p_dir_path: string,
+	p_allocator := context.allocator,
+) -> bool {
+	return platform_directory_watcher_init(p_watcher, p_dir_path, p_allocator)
+}
+
+//---------------------------------------------------------------------------//
 
-	mapping_handle := windows.CreateFileMappingW(
-		file_handle,
-		nil,
-		windows.PAGE_READONLY,
-		0,
-		0,
-		nil,
-	)
-	if mapping_handle == windows.INVALID_HANDLE_VALUE {
-		return {}, false
+directory_watcher_deinit :: proc(p_watcher: ^DirectoryWatcher) {
+	platform_directory_watcher_deinit(p_watcher)
+}
+
+//---------------------------------------------------------------------------//
+
+// Returns the paths, relative to the watched directory, of the files that were written since
+// the last poll. Doesn't block.
+directory_watcher_poll :: proc(p_watcher: ^DirectoryWatcher, p_allocator: mem.Allocator) -> []string {
+	return platform_directory_watcher_poll(p_watcher, p_allocator)
+}
+
+//---------------------------------------------------------------------------//
+
+// Starts the async file I/O, reads are submitted to io_uring on Linux. Returns false when it's
+// not available, e.g. on Windows, on kernels without io_uring or when ASYNC_FILE_IO_ENABLED
+// is off, in which case the files have to be read on the job system instead.
+// Reads are submitted and completed on the calling thread.
+async_file_io_init :: proc(p_queue_depth: u32) -> bool {
+	when ASYNC_FILE_IO_ENABLED {
+		return platform_async_file_io_init(p_queue_depth)
+	} else {
+		return false
 	}
+}
 
-	file_mapped_ptr := windows.MapViewOfFile(mapping_handle, windows.FILE_MAP_READ, 0, 0, 0)
+//---------------------------------------------------------------------------//
 
-	return FileMemoryMapping{
-			file_handle = file_handle,
-			mapping_handle = mapping_handle,
-			mapped_ptr = file_mapped_ptr,
-		},
-		true
+async_file_io_deinit :: proc() {
+	platform_async_file_io_deinit()
 }
 
 //---------------------------------------------------------------------------//
 
-unmap_file :: proc(p_mapping: FileMemoryMapping) {
-	windows.UnmapViewOfFile(p_mapping.mapped_ptr)
-	windows.CloseHandle(p_mapping.mapping_handle)
-	windows.CloseHandle(p_mapping.file_handle)
+async_file_io_is_enabled :: proc() -> bool {
+	return platform_async_file_io_is_enabled()
+}
+
+//---------------------------------------------------------------------------//
 
+// Starts reading the whole file into memory allocated with p_allocator. p_read has to stay alive
+// until it's not .Pending anymore. Returns false when the read couldn't be started, e.g. when
+// the queue is full, the caller is expected to read the file itself then.
+async_file_read_begin :: proc(
+	p_read: ^AsyncFileRead,
+	p_file_path: string,
+	p_allocator := context.allocator,
+) -> bool {
+	p_read^ = {}
+	if platform_async_file_io_is_enabled() == false {
+		return false
+	}
+	return platform_async_file_read_begin(p_read, p_file_path, p_allocator)
 }
 
-//---------------------------------------------------------------------------//
\ No newline at end of file
+//---------------------------------------------------------------------------//
+
+// Updates the status of the reads that finished since the last poll and returns their count.
+// With p_wait set, blocks until at least one read finishes, unless none are pending.
+async_file_io_poll :: proc(p_wait := false) -> u32 {
+	if platform_async_file_io_is_enabled() == false {
+		return 0
+	}
+	return platform_async_file_io_poll(p_wait)
+}
+
+//---------------------------------------------------------------------------//
@@ -0,0 +1,738 @@
+package common
+
+import "base:intrinsics"
+import "core:mem"
+import "core:os"
+import "core:strings"
+import "core:sync"
+import "core:sys/linux"
+import "core:time"
+
+//---------------------------------------------------------------------------//
+
+@(private)
+PlatformFileMapping :: struct {}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+PlatformDirectoryWatcher :: struct {
+	inotify_fd:   linux.Fd,
+	root_path:    string,
+	// inotify doesn't watch subdirectories, so each one has its own watch.
+	// Maps the watch to the path of the directory relative to the root.
+	watched_dirs: map[linux.Wd]string,
+	allocator:    mem.Allocator,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+PlatformAsyncFileRead :: struct {
+	fd:         linux.Fd,
+	bytes_read: int,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+INOTIFY_WATCH_MASK :: linux.Inotify_Event_Mask{.CLOSE_WRITE, .MOVED_TO, .CREATE, .ONLYDIR}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+platform_get_last_file_write_time :: proc(p_file_path: string) -> time.Time {
+
+	temp_arena: Arena
+	temp_arena_init(&temp_arena)
+	defer arena_delete(temp_arena)
+
+	path := strings.clone_to_cstring(p_file_path, temp_arena.allocator)
+
+	file_stat: linux.Statx
+	if linux.statx(linux.AT_FDCWD, path, {}, {.MTIME}, &file_stat) != .NONE {
+		return time.Time{}
+	}
+
+	return time.unix(file_stat.mtime.sec, i64(file_stat.mtime.nsec))
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+platform_mmap_file :: proc(
+	p_file_path: string,
+	p_hints: FileMapHints,
+) -> (
+	out_mapping: FileMemoryMapping,
+	out_res: bool,
+) {
+
+	temp_arena: Arena
+	temp_arena_init(&temp_arena)
+	defer arena_delete(temp_arena)
+
+	path := strings.clone_to_cstring(p_file_path, temp_arena.allocator)
+
+	fd, open_err := linux.open(path, {.CLOEXEC})
+	if open_err != .NONE {
+		return {}, false
+	}
+	// The mapping keeps the file alive, the descriptor isn't needed after mmap
+	defer linux.close(fd)
+
+	file_stat: linux.Stat
+	if linux.fstat(fd, &file_stat) != .NONE || file_stat.size == 0 {
+		return {}, false
+	}
+	file_size := int(file_stat.size)
+
+	map_flags := linux.Map_Flags{.PRIVATE}
+	if .Populate in p_hints {
+		map_flags += {.POPULATE}
+	}
+
+	mapped_ptr, mmap_err := linux.mmap(0, uint(file_size), {.READ}, map_flags, fd)
+	if mmap_err != .NONE {
+		return {}, false
+	}
+
+	// Huge pages for file backed mappings are only a hint, they need a kernel with
+	// CONFIG_READ_ONLY_THP_FOR_FS, otherwise the advice is ignored
+	if .HugePages in p_hints && file_size >= FILE_MAP_HUGE_PAGES_MIN_SIZE {
+		linux.madvise(mapped_ptr, uint(file_size), .HUGEPAGE)
+	}
+	if .Sequential in p_hints {
+		linux.madvise(mapped_ptr, uint(file_size), .SEQUENTIAL)
+	}
+	if .WillNeed in p_hints && .Populate not_in p_hints {
+		linux.madvise(mapped_ptr, uint(file_size), .WILLNEED)
+	}
+
+	return FileMemoryMapping{mapped_ptr = mapped_ptr, size = file_size}, true
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+platform_unmap_file :: proc(p_mapping: FileMemoryMapping) {
+	linux.munmap(p_mapping.mapped_ptr, uint(p_mapping.size))
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+platform_mmap_file_prefetch :: proc(p_mapping: FileMemoryMapping, p_offset: int, p_size: int) {
+	// madvise needs a page aligned address
+	page_size := uintptr(os.get_page_size())
+	range_start := uintptr(p_mapping.mapped_ptr) + uintptr(p_offset)
+	range_end := range_start + uintptr(p_size)
+	range_start = mem.align_backward_uintptr(range_start, page_size)
+
+	linux.madvise(rawptr(range_start), uint(range_end - range_start), .WILLNEED)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+platform_directory_watcher_init :: proc(
+	p_watcher: ^DirectoryWatcher,
+	p_dir_path: string,
+	p_allocator: mem.Allocator,
+) -> bool {
+
+	inotify_fd, err := linux.inotify_init1({.NONBLOCK, .CLOEXEC})
+	if err != .NONE {
+		return false
+	}
+
+	p_watcher.inotify_fd = inotify_fd
+	p_watcher.allocator = p_allocator
+	p_watcher.root_path = strings.clone(p_dir_path, p_allocator)
+	p_watcher.watched_dirs = make(map[linux.Wd]string, p_allocator)
+
+	if inotify_watch_dir_tree(p_watcher, p_dir_path, "") == false {
+		platform_directory_watcher_deinit(p_watcher)
+		return false
+	}
+
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+platform_directory_watcher_deinit :: proc(p_watcher: ^DirectoryWatcher) {
+	linux.close(p_watcher.inotify_fd)
+	for _, dir_path in p_watcher.watched_dirs {
+		delete(dir_path, p_watcher.allocator)
+	}
+	delete(p_watcher.watched_dirs)
+	delete(p_watcher.root_path, p_watcher.allocator)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+platform_directory_watcher_poll :: proc(
+	p_watcher: ^DirectoryWatcher,
+	p_allocator: mem.Allocator,
+) -> []string {
+
+	changed_files := make([dynamic]string, p_allocator)
+
+	// The events have to be aligned to their 4 byte fields
+	event_buffer: [4096]u8 #align (align_of(linux.Inotify_Event))
+
+	for {
+		bytes_read, err := linux.read(p_watcher.inotify_fd, event_buffer[:])
+		if err != .NONE || bytes_read <= 0 {
+			// .EAGAIN, there are no more events
+			break
+		}
+
+		for offset := 0; offset < bytes_read; {
+			event := (^linux.Inotify_Event)(&event_buffer[offset])
+			offset += size_of(linux.Inotify_Event) + int(event.len)
+
+			if event.len == 0 {
+				continue
+			}
+
+			dir_path, is_watched := p_watcher.watched_dirs[event.wd]
+			if is_watched == false {
+				continue
+			}
+
+			name_ptr := ([^]u8)(uintptr(event) + size_of(linux.Inotify_Event))
+			name := strings.string_from_null_terminated_ptr(name_ptr, int(event.len))
+
+			file_path: string
+			if len(dir_path) > 0 {
+				file_path = strings.join({dir_path, name}, "/", p_allocator)
+			} else {
+				file_path = strings.clone(name, p_allocator)
+			}
+
+			if .ISDIR in event.mask {
+				// Start watching the newly created directories as well
+				if .CREATE in event.mask {
+					dir_full_path := strings.join(
+						{p_watcher.root_path, file_path},
+						"/",
+						p_allocator,
+					)
+					inotify_watch_dir_tree(p_watcher, dir_full_path, file_path)
+				}
+				continue
+			}
+
+			if .CREATE in event.mask {
+				// The file will be reported again once it's written and closed
+				continue
+			}
+
+			append(&changed_files, file_path)
+		}
+	}
+
+	return changed_files[:]
+}
+
+//---------------------------------------------------------------------------//
+
+// Watches the directory and all of its subdirectories, p_rel_path is the path of
+// the directory relative to the root of the watcher
+@(private = "file")
+inotify_watch_dir_tree :: proc(
+	p_watcher: ^DirectoryWatcher,
+	p_dir_path: string,
+	p_rel_path: string,
+) -> bool {
+
+	temp_arena: Arena
+	temp_arena_init(&temp_arena)
+	defer arena_delete(temp_arena)
+
+	dir_path := strings.clone_to_cstring(p_dir_path, temp_arena.allocator)
+
+	wd, err := linux.inotify_add_watch(p_watcher.inotify_fd, dir_path, INOTIFY_WATCH_MASK)
+	if err != .NONE {
+		return false
+	}
+
+	if wd not_in p_watcher.watched_dirs {
+		p_watcher.watched_dirs[wd] = strings.clone(p_rel_path, p_watcher.allocator)
+	}
+
+	dir_handle, open_err := os.open(p_dir_path)
+	if open_err != 0 {
+		return false
+	}
+	defer os.close(dir_handle)
+
+	dir_entries, read_err := os.read_dir(dir_handle, -1, temp_arena.allocator)
+	if read_err != 0 {
+		return false
+	}
+
+	for dir_entry in dir_entries {
+		if dir_entry.is_dir == false {
+			continue
+		}
+
+		sub_dir_rel_path := dir_entry.name
+		if len(p_rel_path) > 0 {
+			sub_dir_rel_path = strings.join({p_rel_path, dir_entry.name}, "/", temp_arena.allocator)
+		}
+
+		if inotify_watch_dir_tree(p_watcher, dir_entry.fullpath, sub_dir_rel_path) == false {
+			return false
+		}
+	}
+
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+// io_uring is used through the raw syscalls, the layouts below match linux/io_uring.h
+
+@(private = "file")
+SYS_IO_URING_SETUP :: 425
+
+@(private = "file")
+SYS_IO_URING_ENTER :: 426
+
+@(private = "file")
+IORING_OP_READ :: 22
+
+@(private = "file")
+IORING_ENTER_GETEVENTS :: 1 << 0
+
+@(private = "file")
+IORING_FEAT_SINGLE_MMAP :: 1 << 0
+
+@(private = "file")
+IORING_FEAT_NODROP :: 1 << 1
+
+// Added in 5.6 together with IORING_OP_READ, used to detect whether the op is supported
+@(private = "file")
+IORING_FEAT_RW_CUR_POS :: 1 << 3
+
+@(private = "file")
+IORING_OFF_SQ_RING :: 0
+
+@(private = "file")
+IORING_OFF_CQ_RING :: 0x8000000
+
+@(private = "file")
+IORING_OFF_SQES :: 0x10000000
+
+// Reads are split so that the length fits into the 32 bit field of the submission
+@(private = "file")
+IO_URING_MAX_READ_SIZE :: GIGABYTE
+
+@(private = "file")
+ASYNC_FILE_READ_ALIGNMENT :: 64
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+IoSqringOffsets :: struct {
+	head:         u32,
+	tail:         u32,
+	ring_mask:    u32,
+	ring_entries: u32,
+	flags:        u32,
+	dropped:      u32,
+	array:        u32,
+	resv1:        u32,
+	user_addr:    u64,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+IoCqringOffsets :: struct {
+	head:         u32,
+	tail:         u32,
+	ring_mask:    u32,
+	ring_entries: u32,
+	overflow:     u32,
+	cqes:         u32,
+	flags:        u32,
+	resv1:        u32,
+	user_addr:    u64,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+IoUringParams :: struct {
+	sq_entries:     u32,
+	cq_entries:     u32,
+	flags:          u32,
+	sq_thread_cpu:  u32,
+	sq_thread_idle: u32,
+	features:       u32,
+	wq_fd:          u32,
+	resv:           [3]u32,
+	sq_off:         IoSqringOffsets,
+	cq_off:         IoCqringOffsets,
+}
+
+#assert(size_of(IoUringParams) == 120)
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+IoUringSqe :: struct {
+	opcode:       u8,
+	flags:        u8,
+	ioprio:       u16,
+	fd:           i32,
+	off:          u64,
+	addr:         u64,
+	len:          u32,
+	rw_flags:     u32,
+	user_data:    u64,
+	buf_index:    u16,
+	personality:  u16,
+	splice_fd_in: i32,
+	addr3:        u64,
+	_:            u64,
+}
+
+#assert(size_of(IoUringSqe) == 64)
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+IoUringCqe :: struct {
+	user_data: u64,
+	res:       i32,
+	flags:     u32,
+}
+
+#assert(size_of(IoUringCqe) == 16)
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+INTERNAL: struct {
+	is_io_uring_enabled: bool,
+	ring_fd:             linux.Fd,
+	sq_ring_ptr:         rawptr,
+	sq_ring_size:        uint,
+	cq_ring_ptr:         rawptr,
+	cq_ring_size:        uint,
+	sqes_size:           uint,
+	sq_head:             ^u32,
+	sq_tail:             ^u32,
+	sq_mask:             u32,
+	sq_array:            [^]u32,
+	sqes:                [^]IoUringSqe,
+	cq_head:             ^u32,
+	cq_tail:             ^u32,
+	cq_mask:             u32,
+	cqes:                [^]IoUringCqe,
+	num_sq_entries:      u32,
+	// Reads that were started and haven't completed yet, including the unsubmitted ones
+	num_reads_in_flight: u32,
+	// Entries written to the submission queue that the kernel hasn't taken yet
+	num_unsubmitted:     u32,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+platform_async_file_io_init :: proc(p_queue_depth: u32) -> bool {
+
+	params: IoUringParams
+	ring_fd, setup_err := io_uring_setup(p_queue_depth, &params)
+	if setup_err != .NONE {
+		// .ENOSYS on kernels without io_uring, .EPERM when it's disabled with a sysctl
+		return false
+	}
+
+	required_features := u32(IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_RW_CUR_POS)
+	if params.features & required_features != required_features {
+		linux.close(ring_fd)
+		return false
+	}
+
+	// With IORING_FEAT_SINGLE_MMAP both rings share one mapping
+	sq_ring_size := uint(params.sq_off.array) + uint(params.sq_entries) * size_of(u32)
+	cq_ring_size := uint(params.cq_off.cqes) + uint(params.cq_entries) * size_of(IoUringCqe)
+	ring_size := max(sq_ring_size, cq_ring_size)
+
+	ring_ptr, ring_mmap_err := linux.mmap(
+		0,
+		ring_size,
+		{.READ, .WRITE},
+		{.SHARED, .POPULATE},
+		ring_fd,
+		IORING_OFF_SQ_RING,
+	)
+	if ring_mmap_err != .NONE {
+		linux.close(ring_fd)
+		return false
+	}
+
+	sqes_size := uint(params.sq_entries) * size_of(IoUringSqe)
+	sqes_ptr, sqes_mmap_err := linux.mmap(
+		0,
+		sqes_size,
+		{.READ, .WRITE},
+		{.SHARED, .POPULATE},
+		ring_fd,
+		IORING_OFF_SQES,
+	)
+	if sqes_mmap_err != .NONE {
+		linux.munmap(ring_ptr, ring_size)
+		linux.close(ring_fd)
+		return false
+	}
+
+	ring_base := uintptr(ring_ptr)
+
+	INTERNAL.ring_fd = ring_fd
+	INTERNAL.sq_ring_ptr = ring_ptr
+	INTERNAL.sq_ring_size = ring_size
+	INTERNAL.sqes_size = sqes_size
+	INTERNAL.sq_head = (^u32)(ring_base + uintptr(params.sq_off.head))
+	INTERNAL.sq_tail = (^u32)(ring_base + uintptr(params.sq_off.tail))
+	INTERNAL.sq_mask = ((^u32)(ring_base + uintptr(params.sq_off.ring_mask)))^
+	INTERNAL.sq_array = ([^]u32)(ring_base + uintptr(params.sq_off.array))
+	INTERNAL.sqes = ([^]IoUringSqe)(sqes_ptr)
+	INTERNAL.cq_head = (^u32)(ring_base + uintptr(params.cq_off.head))
+	INTERNAL.cq_tail = (^u32)(ring_base + uintptr(params.cq_off.tail))
+	INTERNAL.cq_mask = ((^u32)(ring_base + uintptr(params.cq_off.ring_mask)))^
+	INTERNAL.cqes = ([^]IoUringCqe)(ring_base + uintptr(params.cq_off.cqes))
+	INTERNAL.num_sq_entries = params.sq_entries
+	INTERNAL.num_reads_in_flight = 0
+	INTERNAL.num_unsubmitted = 0
+	INTERNAL.is_io_uring_enabled = true
+
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+platform_async_file_io_deinit :: proc() {
+	if INTERNAL.is_io_uring_enabled == false {
+		return
+	}
+	assert(INTERNAL.num_reads_in_flight == 0)
+
+	linux.munmap(rawptr(INTERNAL.sqes), INTERNAL.sqes_size)
+	linux.munmap(INTERNAL.sq_ring_ptr, INTERNAL.sq_ring_size)
+	linux.close(INTERNAL.ring_fd)
+	INTERNAL = {}
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+platform_async_file_io_is_enabled :: proc() -> bool {
+	return INTERNAL.is_io_uring_enabled
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+platform_async_file_read_begin :: proc(
+	p_read: ^AsyncFileRead,
+	p_file_path: string,
+	p_allocator: mem.Allocator,
+) -> bool {
+
+	// The completion queue is at least as large as the submission queue, so limiting the reads
+	// in flight to the submission queue size also guarantees there's room for their completions
+	if INTERNAL.num_reads_in_flight >= INTERNAL.num_sq_entries {
+		return false
+	}
+
+	temp_arena: Arena
+	temp_arena_init(&temp_arena)
+	defer arena_delete(temp_arena)
+
+	path := strings.clone_to_cstring(p_file_path, temp_arena.allocator)
+
+	fd, open_err := linux.open(path, {.CLOEXEC})
+	if open_err != .NONE {
+		return false
+	}
+
+	file_stat: linux.Stat
+	if linux.fstat(fd, &file_stat) != .NONE || file_stat.size == 0 {
+		linux.close(fd)
+		return false
+	}
+	file_size := int(file_stat.size)
+
+	data, alloc_err := mem.alloc(file_size, ASYNC_FILE_READ_ALIGNMENT, p_allocator)
+	if alloc_err != .None {
+		linux.close(fd)
+		return false
+	}
+
+	p_read.status = .Pending
+	p_read.mapping = FileMemoryMapping {
+		mapped_ptr     = data,
+		size           = file_size,
+		read_allocator = p_allocator,
+	}
+	p_read.fd = fd
+	p_read.bytes_read = 0
+
+	io_uring_queue_read(p_read)
+	INTERNAL.num_reads_in_flight += 1
+	io_uring_submit()
+
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+platform_async_file_io_poll :: proc(p_wait: bool) -> u32 {
+
+	io_uring_submit()
+
+	cq_head := INTERNAL.cq_head^
+	cq_tail := sync.atomic_load_explicit(INTERNAL.cq_tail, .Acquire)
+
+	if p_wait && cq_head == cq_tail && INTERNAL.num_reads_in_flight > 0 {
+		// .EINTR just returns early, the caller polls again
+		io_uring_enter(INTERNAL.ring_fd, 0, 1, IORING_ENTER_GETEVENTS)
+		cq_tail = sync.atomic_load_explicit(INTERNAL.cq_tail, .Acquire)
+	}
+
+	num_finished: u32 = 0
+
+	for ; cq_head != cq_tail; cq_head += 1 {
+		cqe := INTERNAL.cqes[cq_head & INTERNAL.cq_mask]
+		read := (^AsyncFileRead)(uintptr(cqe.user_data))
+
+		if cqe.res > 0 {
+			read.bytes_read += int(cqe.res)
+		}
+
+		// Continue where the read stopped when it was interrupted or came back short,
+		// its previous submission was already consumed so there's room in the queue
+		is_retry := cqe.res == -i32(linux.Errno.EINTR) || cqe.res == -i32(linux.Errno.EAGAIN)
+		is_short_read := cqe.res > 0 && read.bytes_read < read.mapping.size
+		if is_retry || is_short_read {
+			io_uring_queue_read(read)
+			continue
+		}
+
+		linux.close(read.fd)
+
+		// An error, or the file got truncated since the read was started
+		if read.bytes_read < read.mapping.size {
+			mem.free(read.mapping.mapped_ptr, read.mapping.read_allocator)
+			read.mapping = {}
+			read.status = .Failed
+		} else {
+			read.status = .Done
+		}
+
+		INTERNAL.num_reads_in_flight -= 1
+		num_finished += 1
+	}
+
+	sync.atomic_store_explicit(INTERNAL.cq_head, cq_head, .Release)
+
+	io_uring_submit()
+
+	return num_finished
+}
+
+//---------------------------------------------------------------------------//
+
+// Writes a read of the remaining part of the file to the submission queue, it's handed to the
+// kernel on the next io_uring_submit
+@(private = "file")
+io_uring_queue_read :: proc(p_read: ^AsyncFileRead) {
+
+	sq_tail := INTERNAL.sq_tail^
+	sq_head := sync.atomic_load_explicit(INTERNAL.sq_head, .Acquire)
+	assert(sq_tail - sq_head < INTERNAL.num_sq_entries)
+
+	read_size := min(p_read.mapping.size - p_read.bytes_read, IO_URING_MAX_READ_SIZE)
+	sqe_idx := sq_tail & INTERNAL.sq_mask
+
+	INTERNAL.sqes[sqe_idx] = IoUringSqe {
+		opcode    = IORING_OP_READ,
+		fd        = i32(p_read.fd),
+		off       = u64(p_read.bytes_read),
+		addr      = u64(uintptr(p_read.mapping.mapped_ptr) + uintptr(p_read.bytes_read)),
+		len       = u32(read_size),
+		user_data = u64(uintptr(p_read)),
+	}
+	INTERNAL.sq_array[sqe_idx] = sqe_idx
+
+	sync.atomic_store_explicit(INTERNAL.sq_tail, sq_tail + 1, .Release)
+	INTERNAL.num_unsubmitted += 1
+}
+
+//---------------------------------------------------------------------------//
+
+// Hands the queued reads to the kernel. When it fails, e.g. with .EAGAIN or .EBUSY, the reads
+// stay in the queue and are submitted on the next call.
+@(private = "file")
+io_uring_submit :: proc() {
+	if INTERNAL.num_unsubmitted == 0 {
+		return
+	}
+	num_submitted, err := io_uring_enter(INTERNAL.ring_fd, INTERNAL.num_unsubmitted, 0, 0)
+	if err == .NONE {
+		INTERNAL.num_unsubmitted -= u32(num_submitted)
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+io_uring_setup :: proc(p_entries: u32, p_params: ^IoUringParams) -> (linux.Fd, linux.Errno) {
+	res := int(intrinsics.syscall(SYS_IO_URING_SETUP, uintptr(p_entries), uintptr(p_params)))
+	if res < 0 {
+		return -1, linux.Errno(-res)
+	}
+	return linux.Fd(res), .NONE
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+io_uring_enter :: proc(
+	p_ring_fd: linux.Fd,
+	p_to_submit: u32,
+	p_min_complete: u32,
+	p_flags: u32,
+) -> (
+	int,
+	linux.Errno,
+) {
+	res := int(
+		intrinsics.syscall(
+			SYS_IO_URING_ENTER,
+			uintptr(p_ring_fd),
+			uintptr(p_to_submit),
+			uintptr(p_min_complete),
+			uintptr(p_flags),
+			0,
+			0,
+		),
+	)
+	if res < 0 {
+		return 0, linux.Errno(-res)
+	}
+	return res, .NONE
+}
+
+//---------------------------------------------------------------------------//
@@ -0,0 +1,327 @@
+package common
+
+import "core:mem"
+import "core:sys/windows"
+import "core:time"
+
+//---------------------------------------------------------------------------//
+
+@(private)
+PlatformFileMapping :: struct {
+	file_handle:    windows.HANDLE,
+	mapping_handle: windows.HANDLE,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+PlatformDirectoryWatcher :: struct {
+	dir_handle:   windows.HANDLE,
+	event_handle: windows.HANDLE,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+PlatformAsyncFileRead :: struct {}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+platform_get_last_file_write_time :: proc(p_file_path: string) -> time.Time {
+
+	temp_arena: Arena
+	temp_arena_init(&temp_arena)
+	defer arena_delete(temp_arena)
+
+	path_w := windows.utf8_to_wstring(p_file_path, temp_arena.allocator)
+
+	file_handle := windows.CreateFileW(
+		path_w,
+		windows.GENERIC_READ,
+		windows.FILE_SHARE_READ,
+		nil,
+		windows.OPEN_EXISTING,
+		windows.FILE_ATTRIBUTE_NORMAL,
+		nil,
+	)
+
+	if file_handle == windows.INVALID_HANDLE_VALUE {
+		return time.Time{}
+	}
+
+	defer {
+		windows.CloseHandle(file_handle)
+	}
+
+	ft_create: windows.FILETIME
+	ft_access: windows.FILETIME
+	ft_write: windows.FILETIME
+
+	if !windows.GetFileTime(file_handle, &ft_create, &ft_access, &ft_write) {
+		return time.Time{}
+	}
+
+	write_time: i64 = 0
+	write_time |= i64(ft_write.dwLowDateTime)
+	write_time |= (i64(ft_write.dwHighDateTime) << 32)
+
+	return time.from_nanoseconds(write_time)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+platform_mmap_file :: proc(
+	p_file_path: string,
+	p_hints: FileMapHints,
+) -> (
+	out_mapping: FileMemoryMapping,
+	out_res: bool,
+) {
+
+	temp_arena: Arena
+	temp_arena_init(&temp_arena)
+	defer arena_delete(temp_arena)
+
+	path_w := windows.utf8_to_wstring(p_file_path, temp_arena.allocator)
+
+	file_flags: windows.DWORD = windows.FILE_ATTRIBUTE_NORMAL
+	if .Sequential in p_hints {
+		file_flags |= windows.FILE_FLAG_SEQUENTIAL_SCAN
+	}
+
+	file_handle := windows.CreateFileW(
+		path_w,
+		windows.GENERIC_READ,
+		windows.FILE_SHARE_READ,
+		nil,
+		windows.OPEN_EXISTING,
+		file_flags,
+		nil,
+	)
+	if file_handle == windows.INVALID_HANDLE_VALUE {
+		return {}, false
+	}
+	defer if (out_res == false) {
+		windows.CloseHandle(file_handle)
+	}
+
+	file_size: windows.LARGE_INTEGER
+	if windows.GetFileSizeEx(file_handle, &file_size) == false || file_size == 0 {
+		return {}, false
+	}
+
+	mapping_handle := windows.CreateFileMappingW(
+		file_handle,
+		nil,
+		windows.PAGE_READONLY,
+		0,
+		0,
+		nil,
+	)
+	if mapping_handle == nil {
+		return {}, false
+	}
+	defer if (out_res == false) {
+		windows.CloseHandle(mapping_handle)
+	}
+
+	file_mapped_ptr := windows.MapViewOfFile(mapping_handle, windows.FILE_MAP_READ, 0, 0, 0)
+	if file_mapped_ptr == nil {
+		return {}, false
+	}
+
+	out_mapping = FileMemoryMapping {
+		mapped_ptr = file_mapped_ptr,
+		size = int(file_size),
+		platform = {file_handle = file_handle, mapping_handle = mapping_handle},
+	}
+
+	// Windows has no way to populate a view up front, so both hints just start the reads.
+	// Large pages aren't supported for file backed views, so .HugePages is ignored.
+	if .WillNeed in p_hints || .Populate in p_hints {
+		platform_mmap_file_prefetch(out_mapping, 0, out_mapping.size)
+	}
+
+	return out_mapping, true
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+platform_unmap_file :: proc(p_mapping: FileMemoryMapping) {
+	windows.UnmapViewOfFile(p_mapping.mapped_ptr)
+	windows.CloseHandle(p_mapping.mapping_handle)
+	windows.CloseHandle(p_mapping.file_handle)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+platform_mmap_file_prefetch :: proc(p_mapping: FileMemoryMapping, p_offset: int, p_size: int) {
+	range := windows.WIN32_MEMORY_RANGE_ENTRY {
+		VirtualAddress = mem.ptr_offset((^byte)(p_mapping.mapped_ptr), p_offset),
+		NumberOfBytes  = windows.SIZE_T(p_size),
+	}
+	windows.PrefetchVirtualMemory(windows.GetCurrentProcess(), 1, &range, 0)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+platform_directory_watcher_init :: proc(
+	p_watcher: ^DirectoryWatcher,
+	p_dir_path: string,
+	p_allocator: mem.Allocator,
+) -> bool {
+
+	temp_arena: Arena
+	temp_arena_init(&temp_arena)
+	defer arena_delete(temp_arena)
+
+	dir_path_w := windows.utf8_to_wstring(p_dir_path, temp_arena.allocator)
+
+	p_watcher.dir_handle = windows.CreateFileW(
+		dir_path_w,
+		windows.FILE_LIST_DIRECTORY,
+		windows.FILE_SHARE_READ | windows.FILE_SHARE_WRITE | windows.FILE_SHARE_DELETE,
+		nil,
+		windows.OPEN_EXISTING,
+		windows.FILE_FLAG_BACKUP_SEMANTICS | windows.FILE_FLAG_OVERLAPPED,
+		nil,
+	)
+	if p_watcher.dir_handle == windows.INVALID_HANDLE_VALUE {
+		return false
+	}
+
+	p_watcher.event_handle = windows.CreateEventW(nil, false, false, nil)
+	if p_watcher.event_handle == nil {
+		windows.CloseHandle(p_watcher.dir_handle)
+		return false
+	}
+
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+platform_directory_watcher_deinit :: proc(p_watcher: ^DirectoryWatcher) {
+	windows.CloseHandle(p_watcher.event_handle)
+	windows.CloseHandle(p_watcher.dir_handle)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+platform_directory_watcher_poll :: proc(
+	p_watcher: ^DirectoryWatcher,
+	p_allocator: mem.Allocator,
+) -> []string {
+
+	windows.ResetEvent(p_watcher.event_handle)
+
+	overlapped := windows.OVERLAPPED {
+		hEvent = p_watcher.event_handle,
+	}
+
+	// Read directory changes
+	change_buffer: [1024]windows.BYTE
+	success := windows.ReadDirectoryChangesW(
+		p_watcher.dir_handle,
+		&change_buffer[0],
+		len(change_buffer),
+		true,
+		windows.FILE_NOTIFY_CHANGE_LAST_WRITE,
+		nil,
+		&overlapped,
+		nil,
+	)
+	if success == false {
+		return nil
+	}
+	defer windows.CancelIo(p_watcher.dir_handle)
+
+	result := windows.WaitForSingleObject(overlapped.hEvent, 0)
+	if result != windows.WAIT_OBJECT_0 {
+		return nil
+	}
+
+	bytes_transferred: windows.DWORD
+	windows.GetOverlappedResult(p_watcher.dir_handle, &overlapped, &bytes_transferred, false)
+	if bytes_transferred == 0 {
+		return nil
+	}
+
+	changed_files := make([dynamic]string, p_allocator)
+
+	event := (^windows.FILE_NOTIFY_INFORMATION)(&change_buffer[0])
+
+	for {
+
+		file_name_len := int(event.file_name_length)
+		file_name_w := windows.wstring(&event.file_name[0])
+		file_name, err := windows.wstring_to_utf8(
+			file_name_w,
+			(file_name_len / size_of(windows.wchar_t)),
+			p_allocator,
+		)
+
+		if err == nil {
+			append(&changed_files, file_name)
+		}
+
+		if event.next_entry_offset == 0 {
+			break
+		}
+
+		event = (^windows.FILE_NOTIFY_INFORMATION)(
+			uintptr(event) + uintptr(event.next_entry_offset),
+		)
+	}
+
+	return changed_files[:]
+}
+
+//---------------------------------------------------------------------------//
+
+// There is no async file I/O backend on Windows yet, the files are read on the job system
+
+@(private)
+platform_async_file_io_init :: proc(p_queue_depth: u32) -> bool {
+	return false
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+platform_async_file_io_deinit :: proc() {
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+platform_async_file_io_is_enabled :: proc() -> bool {
+	return false
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+platform_async_file_read_begin :: proc(
+	p_read: ^AsyncFileRead,
+	p_file_path: string,
+	p_allocator: mem.Allocator,
+) -> bool {
+	return false
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+platform_async_file_io_poll :: proc(p_wait: bool) -> u32 {
+	return 0
+}
+
+//---------------------------------------------------------------------------//
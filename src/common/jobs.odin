@@ -0,0 +1,828 @@
+package common
+
+//---------------------------------------------------------------------------//
+
+import "core:log"
+import "core:mem"
+import "core:os"
+import "core:sync"
+import "core:thread"
+import "core:time"
+
+//---------------------------------------------------------------------------//
+
+// Has to be a power of two
+@(private = "file")
+JOB_QUEUE_CAPACITY :: 4096
+
+@(private = "file")
+DEFAULT_WORKER_TEMP_ARENAS_SIZE :: 16 * MEGABYTE
+
+//---------------------------------------------------------------------------//
+
+JobProc :: proc(p_user_data: rawptr)
+
+//---------------------------------------------------------------------------//
+
+Job :: struct {
+	procedure: JobProc,
+	user_data: rawptr,
+	// Decremented when the job finishes
+	counter:   ^JobCounter,
+}
+
+//---------------------------------------------------------------------------//
+
+// Number of jobs that didn't finish yet. Jobs that depend on a group of other jobs
+// wait on their counter, the waiting thread executes other jobs in the meantime.
+JobCounter :: struct {
+	value: i32,
+}
+
+//---------------------------------------------------------------------------//
+
+JobParallelForProc :: proc(p_start: u32, p_end: u32, p_user_data: rawptr)
+
+//---------------------------------------------------------------------------//
+
+JobSystemInitOptions :: struct {
+	// Number of worker threads, not including the thread that called jobs_init.
+	// When 0, one worker per core is created.
+	num_workers:      u32,
+	// Size of the stack that each worker sub-allocates it's temp arenas from
+	temp_arenas_size: u32,
+}
+
+//---------------------------------------------------------------------------//
+
+// Chase-Lev work-stealing deque. The owning worker pushes and pops jobs at the bottom,
+// while other workers steal them from the top.
+// https://www.dre.vanderbilt.edu/~schmidt/PDF/work-stealing-dequeue.pdf
+@(private = "file")
+JobQueue :: struct {
+	top:      int,
+	_padding: [56]byte, // Keep top and bottom on separate cache lines
+	bottom:   int,
+	jobs:     []Job,
+}
+
+//---------------------------------------------------------------------------//
+
+// Jobs scheduled by threads that the job system didn't start (e.g. I/O completion threads).
+// Only the owner of a work-stealing queue can push to it, so these go through a locked ring
+// buffer that the workers drain before stealing. It grows when it's full.
+@(private = "file")
+JobInjectionQueue :: struct {
+	lock:  sync.Mutex,
+	jobs:  []Job,
+	head:  u32,
+	count: u32,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+JobSystem :: struct {
+	workers:          []^thread.Thread,
+	// One queue per worker, the thread that called jobs_init uses the first one
+	queues:           []JobQueue,
+	injection_queue:  JobInjectionQueue,
+	wake_sema:        sync.Sema,
+	running:          bool,
+	temp_arenas_size: u32,
+	allocator:        mem.Allocator,
+}
+
+//---------------------------------------------------------------------------//
+
+// The global job system, the benchmarks can run their own instance next to it
+@(private = "file")
+INTERNAL: JobSystem
+
+//---------------------------------------------------------------------------//
+
+// Only valid when tls_job_system is set, it's 0 on the threads the job system doesn't know
+@(private = "file", thread_local)
+tls_worker_idx: u32
+
+// Job system of the thread, set for the thread that called jobs_init and for the workers
+@(private = "file", thread_local)
+tls_job_system: ^JobSystem
+
+@(private = "file", thread_local)
+tls_random_state: u32
+
+//---------------------------------------------------------------------------//
+
+jobs_init :: proc(p_options: JobSystemInitOptions, p_allocator: mem.Allocator) -> bool {
+	if job_system_init(&INTERNAL, p_options, p_allocator) == false {
+		return false
+	}
+
+	log.infof("Job system initialized with %d workers\n", len(INTERNAL.workers))
+
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+jobs_deinit :: proc() {
+	job_system_deinit(&INTERNAL)
+}
+
+//---------------------------------------------------------------------------//
+
+// Returns the number of threads that execute jobs, including the one that called jobs_init
+jobs_get_num_threads :: proc() -> u32 {
+	return max(u32(len(job_system_get_current().queues)), 1)
+}
+
+//---------------------------------------------------------------------------//
+
+// Index of the calling thread in [0, jobs_get_num_threads()), can be used
+// to index per-thread data, e.g. per-thread command buffers
+jobs_get_thread_idx :: #force_inline proc() -> u32 {
+	assert(tls_job_system != nil || len(INTERNAL.queues) == 0, "Not a job system thread")
+	return tls_worker_idx
+}
+
+//---------------------------------------------------------------------------//
+
+// Schedules the jobs on the calling thread's queue, idle workers will steal them. Threads that
+// the job system didn't start push them to the injection queue instead. Jobs that don't fit
+// into a full queue are executed right away, the caller is going to wait for them anyway.
+// p_counter is incremented by the number of jobs and decremented as they finish.
+jobs_run :: proc(p_jobs: []Job, p_counter: ^JobCounter) {
+	sync.atomic_add(&p_counter.value, i32(len(p_jobs)))
+
+	system := job_system_get_current()
+
+	// Execute inline when the job system is not running
+	if len(system.queues) == 0 {
+		for &job in p_jobs {
+			job.counter = p_counter
+			job_execute(job)
+		}
+		return
+	}
+
+	if tls_job_system != nil {
+		queue := &system.queues[tls_worker_idx]
+		for &job in p_jobs {
+			job.counter = p_counter
+			if job_queue_push(queue, job) == false {
+				job_execute(job)
+			}
+		}
+	} else {
+		injection_queue_push(system, p_jobs, p_counter)
+	}
+
+	sync.sema_post(&system.wake_sema, min(len(p_jobs), len(system.workers)))
+}
+
+//---------------------------------------------------------------------------//
+
+// Waits until all of the jobs associated with the counter finish. The calling thread executes
+// the pending jobs while waiting, unless the job system didn't start it, as then it has no
+// queue nor temp arenas for them.
+jobs_wait :: proc(p_counter: ^JobCounter) {
+	for sync.atomic_load(&p_counter.value) > 0 {
+		if tls_job_system == nil || jobs_try_execute_one(tls_job_system) == false {
+			thread.yield()
+		}
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+JobParallelForBatch :: struct {
+	procedure: JobParallelForProc,
+	user_data: rawptr,
+	start:     u32,
+	end:       u32,
+}
+
+//---------------------------------------------------------------------------//
+
+// Splits [0, p_count) into batches of p_batch_size and runs them across all workers,
+// returns when all of the batches are done
+jobs_parallel_for :: proc(
+	p_count: u32,
+	p_batch_size: u32,
+	p_procedure: JobParallelForProc,
+	p_user_data: rawptr,
+) {
+	if p_count == 0 {
+		return
+	}
+
+	num_batches := (p_count + p_batch_size - 1) / p_batch_size
+	if num_batches == 1 || len(job_system_get_current().queues) == 0 {
+		p_procedure(0, p_count, p_user_data)
+		return
+	}
+
+	temp_arena: Arena
+	temp_arena_init(
+		&temp_arena,
+		num_batches * (size_of(JobParallelForBatch) + size_of(Job)) + KILOBYTE,
+	)
+	defer arena_delete(temp_arena)
+
+	batches := make([]JobParallelForBatch, num_batches, temp_arena.allocator)
+	jobs := make([]Job, num_batches, temp_arena.allocator)
+
+	for i in 0 ..< num_batches {
+		batches[i] = JobParallelForBatch {
+			procedure = p_procedure,
+			user_data = p_user_data,
+			start     = i * p_batch_size,
+			end       = min((i + 1) * p_batch_size, p_count),
+		}
+		jobs[i] = Job {
+			procedure = job_parallel_for_batch_run,
+			user_data = &batches[i],
+		}
+	}
+
+	counter: JobCounter
+	jobs_run(jobs, &counter)
+	jobs_wait(&counter)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+job_parallel_for_batch_run :: proc(p_user_data: rawptr) {
+	batch := (^JobParallelForBatch)(p_user_data)
+	batch.procedure(batch.start, batch.end, batch.user_data)
+}
+
+//---------------------------------------------------------------------------//
+
+// Starts the workers of the job system, the calling thread becomes the first of it's threads
+@(private = "file")
+job_system_init :: proc(
+	p_system: ^JobSystem,
+	p_options: JobSystemInitOptions,
+	p_allocator: mem.Allocator,
+) -> bool {
+	num_workers := p_options.num_workers
+	if num_workers == 0 {
+		num_workers = u32(max(os.processor_core_count() - 1, 1))
+	}
+
+	p_system.allocator = p_allocator
+	p_system.temp_arenas_size = p_options.temp_arenas_size
+	if p_system.temp_arenas_size == 0 {
+		p_system.temp_arenas_size = DEFAULT_WORKER_TEMP_ARENAS_SIZE
+	}
+
+	p_system.queues = make([]JobQueue, num_workers + 1, p_allocator)
+	for &queue in p_system.queues {
+		queue.jobs = make([]Job, JOB_QUEUE_CAPACITY, p_allocator)
+	}
+	p_system.injection_queue.jobs = make([]Job, JOB_QUEUE_CAPACITY, p_allocator)
+
+	tls_worker_idx = 0
+	tls_job_system = p_system
+	tls_random_state = 1
+
+	sync.atomic_store(&p_system.running, true)
+
+	p_system.workers = make([]^thread.Thread, num_workers, p_allocator)
+	for i in 0 ..< num_workers {
+		p_system.workers[i] = thread.create_and_start_with_poly_data2(
+			p_system,
+			i + 1,
+			worker_run,
+			context,
+		)
+		if p_system.workers[i] == nil {
+			log.errorf("Failed to create job worker %d\n", i)
+			p_system.workers = p_system.workers[:i]
+			job_system_deinit(p_system)
+			return false
+		}
+	}
+
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+job_system_deinit :: proc(p_system: ^JobSystem) {
+	sync.atomic_store(&p_system.running, false)
+	sync.sema_post(&p_system.wake_sema, len(p_system.workers))
+
+	for worker in p_system.workers {
+		thread.destroy(worker)
+	}
+
+	for queue in p_system.queues {
+		delete(queue.jobs, p_system.allocator)
+	}
+	delete(p_system.injection_queue.jobs, p_system.allocator)
+
+	delete(p_system.workers, p_system.allocator)
+	delete(p_system.queues, p_system.allocator)
+
+	p_system.workers = nil
+	p_system.queues = nil
+	p_system.injection_queue = {}
+	p_system.wake_sema = {}
+
+	if tls_job_system == p_system {
+		tls_job_system = nil
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+// The job system of the calling thread, threads that no job system started use the global one
+@(private = "file")
+job_system_get_current :: #force_inline proc() -> ^JobSystem {
+	return tls_job_system if tls_job_system != nil else &INTERNAL
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+worker_run :: proc(p_system: ^JobSystem, p_worker_idx: u32) {
+	tls_worker_idx = p_worker_idx
+	tls_job_system = p_system
+	tls_random_state = p_worker_idx * 2654435761 + 1
+
+	// Each worker has it's own stack for temp arenas, as they're not thread safe
+	temp_arenas_init_stack(p_system.temp_arenas_size, p_system.allocator)
+	defer temp_arenas_deinit_stack()
+
+	for sync.atomic_load(&p_system.running) {
+		if jobs_try_execute_one(p_system) == false {
+			sync.sema_wait(&p_system.wake_sema)
+		}
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+jobs_try_execute_one :: proc(p_system: ^JobSystem) -> bool {
+	if len(p_system.queues) == 0 {
+		return false
+	}
+
+	job, found := job_queue_pop(&p_system.queues[tls_worker_idx])
+
+	if found == false {
+		job, found = injection_queue_pop(&p_system.injection_queue)
+	}
+
+	// Try to steal a job from the other workers, starting at a random one
+	if found == false {
+		num_queues := u32(len(p_system.queues))
+		first_victim := next_random() % num_queues
+		for i in 0 ..< num_queues {
+			victim := (first_victim + i) % num_queues
+			if victim == tls_worker_idx {
+				continue
+			}
+			job, found = job_queue_steal(&p_system.queues[victim])
+			if found {
+				break
+			}
+		}
+	}
+
+	if found == false {
+		return false
+	}
+
+	job_execute(job)
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+job_execute :: #force_inline proc(p_job: Job) {
+	p_job.procedure(p_job.user_data)
+	if p_job.counter != nil {
+		sync.atomic_sub(&p_job.counter.value, 1)
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+// Returns false when the queue is full
+@(private = "file")
+job_queue_push :: proc(p_queue: ^JobQueue, p_job: Job) -> bool {
+	bottom := sync.atomic_load_explicit(&p_queue.bottom, .Relaxed)
+	top := sync.atomic_load_explicit(&p_queue.top, .Acquire)
+	if bottom - top >= JOB_QUEUE_CAPACITY {
+		return false
+	}
+
+	p_queue.jobs[bottom & (JOB_QUEUE_CAPACITY - 1)] = p_job
+	sync.atomic_store_explicit(&p_queue.bottom, bottom + 1, .Release)
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+job_queue_pop :: proc(p_queue: ^JobQueue) -> (Job, bool) {
+	bottom := sync.atomic_load_explicit(&p_queue.bottom, .Relaxed) - 1
+	sync.atomic_store_explicit(&p_queue.bottom, bottom, .Relaxed)
+	sync.atomic_thread_fence(.Seq_Cst)
+	top := sync.atomic_load_explicit(&p_queue.top, .Relaxed)
+
+	// Queue is empty
+	if top > bottom {
+		sync.atomic_store_explicit(&p_queue.bottom, bottom + 1, .Relaxed)
+		return {}, false
+	}
+
+	job := p_queue.jobs[bottom & (JOB_QUEUE_CAPACITY - 1)]
+	if top != bottom {
+		return job, true
+	}
+
+	// This is the last job, so we're racing against the thieves
+	_, won := sync.atomic_compare_exchange_strong_explicit(
+		&p_queue.top,
+		top,
+		top + 1,
+		.Seq_Cst,
+		.Relaxed,
+	)
+	sync.atomic_store_explicit(&p_queue.bottom, bottom + 1, .Relaxed)
+
+	return job, won
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+injection_queue_push :: proc(p_system: ^JobSystem, p_jobs: []Job, p_counter: ^JobCounter) {
+	injection_queue := &p_system.injection_queue
+
+	sync.mutex_lock(&injection_queue.lock)
+	defer sync.mutex_unlock(&injection_queue.lock)
+
+	for &job in p_jobs {
+		job.counter = p_counter
+
+		capacity := u32(len(injection_queue.jobs))
+		if injection_queue.count == capacity {
+			// Unwrap the jobs into a queue twice the size, so the capacity stays a power of two
+			jobs := make([]Job, capacity * 2, p_system.allocator)
+			for i in 0 ..< capacity {
+				jobs[i] = injection_queue.jobs[(injection_queue.head + i) & (capacity - 1)]
+			}
+			delete(injection_queue.jobs, p_system.allocator)
+			injection_queue.jobs = jobs
+			injection_queue.head = 0
+			capacity *= 2
+		}
+
+		tail := (injection_queue.head + injection_queue.count) & (capacity - 1)
+		injection_queue.jobs[tail] = job
+		sync.atomic_add_explicit(&injection_queue.count, 1, .Relaxed)
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+injection_queue_pop :: proc(p_injection_queue: ^JobInjectionQueue) -> (Job, bool) {
+	// Skip the lock in the common case, the jobs are picked up on the next attempt anyway
+	if sync.atomic_load_explicit(&p_injection_queue.count, .Relaxed) == 0 {
+		return {}, false
+	}
+
+	sync.mutex_lock(&p_injection_queue.lock)
+	defer sync.mutex_unlock(&p_injection_queue.lock)
+
+	if p_injection_queue.count == 0 {
+		return {}, false
+	}
+
+	capacity := u32(len(p_injection_queue.jobs))
+	job := p_injection_queue.jobs[p_injection_queue.head]
+	p_injection_queue.head = (p_injection_queue.head + 1) & (capacity - 1)
+	sync.atomic_sub_explicit(&p_injection_queue.count, 1, .Relaxed)
+
+	return job, true
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+job_queue_steal :: proc(p_queue: ^JobQueue) -> (Job, bool) {
+	top := sync.atomic_load_explicit(&p_queue.top, .Acquire)
+	sync.atomic_thread_fence(.Seq_Cst)
+	bottom := sync.atomic_load_explicit(&p_queue.bottom, .Acquire)
+
+	if top >= bottom {
+		return {}, false
+	}
+
+	job := p_queue.jobs[top & (JOB_QUEUE_CAPACITY - 1)]
+	_, won := sync.atomic_compare_exchange_strong_explicit(
+		&p_queue.top,
+		top,
+		top + 1,
+		.Seq_Cst,
+		.Relaxed,
+	)
+
+	return job, won
+}
+
+//---------------------------------------------------------------------------//
+
+// xorshift32, used to pick the worker to steal from
+@(private = "file")
+next_random :: #force_inline proc() -> u32 {
+	x := tls_random_state
+	x ~= x << 13
+	x ~= x >> 17
+	x ~= x << 5
+	tls_random_state = x
+	return x
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+STRESS_TEST_FAN_OUT :: 8
+@(private = "file")
+STRESS_TEST_DEPTH :: 4
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+StressTestContext :: struct {
+	num_executed: i32,
+	depth:        u32,
+}
+
+//---------------------------------------------------------------------------//
+
+// Spawns a tree of nested jobs, where each job waits for it's children, and checks
+// that every job was executed exactly once. Returns false if that's not the case.
+// The last tree is spawned from a thread that the job system didn't start.
+jobs_run_stress_test :: proc(p_num_iterations: u32 = 64) -> bool {
+
+	// Number of jobs in the tree, including the root
+	expected: i32 = 0
+	level_size: i32 = 1
+	for _ in 0 ..= STRESS_TEST_DEPTH {
+		expected += level_size
+		level_size *= STRESS_TEST_FAN_OUT
+	}
+
+	for iteration in 0 ..< p_num_iterations {
+		root := StressTestContext {
+			depth = STRESS_TEST_DEPTH,
+		}
+		root_jobs := []Job{{procedure = stress_test_job, user_data = &root}}
+
+		counter: JobCounter
+		jobs_run(root_jobs, &counter)
+		jobs_wait(&counter)
+
+		if root.num_executed != expected {
+			log.errorf(
+				"Job system stress test failed on iteration %d - executed %d jobs, expected %d\n",
+				iteration,
+				root.num_executed,
+				expected,
+			)
+			return false
+		}
+	}
+
+	foreign_root := StressTestContext {
+		depth = STRESS_TEST_DEPTH,
+	}
+	foreign_thread := thread.create_and_start_with_poly_data(
+		&foreign_root,
+		stress_test_run_from_foreign_thread,
+		context,
+	)
+	if foreign_thread == nil {
+		log.error("Job system stress test failed to create a thread\n")
+		return false
+	}
+	thread.destroy(foreign_thread)
+
+	if foreign_root.num_executed != expected {
+		log.errorf(
+			"Job system stress test failed from a foreign thread - executed %d jobs, expected %d\n",
+			foreign_root.num_executed,
+			expected,
+		)
+		return false
+	}
+
+	// Bursts larger than the queues, the overflow is executed inline or grows the injection queue
+	if stress_test_run_burst() == false {
+		return false
+	}
+	burst_result := false
+	burst_thread := thread.create_and_start_with_poly_data(
+		&burst_result,
+		stress_test_run_burst_from_foreign_thread,
+		context,
+	)
+	if burst_thread == nil {
+		log.error("Job system stress test failed to create a thread\n")
+		return false
+	}
+	thread.destroy(burst_thread)
+	if burst_result == false {
+		return false
+	}
+
+	log.infof(
+		"Job system stress test passed - %d iterations, %d jobs each\n",
+		p_num_iterations,
+		expected,
+	)
+
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+stress_test_run_from_foreign_thread :: proc(p_root: ^StressTestContext) {
+	root_jobs := []Job{{procedure = stress_test_job, user_data = p_root}}
+
+	counter: JobCounter
+	jobs_run(root_jobs, &counter)
+	jobs_wait(&counter)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+stress_test_run_burst :: proc() -> bool {
+	num_jobs := 4 * JOB_QUEUE_CAPACITY
+
+	num_executed: i32 = 0
+	jobs := make([]Job, num_jobs)
+	defer delete(jobs)
+	for &job in jobs {
+		job = Job {
+			procedure = stress_test_burst_job,
+			user_data = &num_executed,
+		}
+	}
+
+	counter: JobCounter
+	jobs_run(jobs, &counter)
+	jobs_wait(&counter)
+
+	if num_executed != i32(num_jobs) {
+		log.errorf(
+			"Job system stress test failed on a burst - executed %d jobs, expected %d\n",
+			num_executed,
+			num_jobs,
+		)
+		return false
+	}
+
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+stress_test_run_burst_from_foreign_thread :: proc(p_result: ^bool) {
+	p_result^ = stress_test_run_burst()
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+stress_test_burst_job :: proc(p_user_data: rawptr) {
+	sync.atomic_add((^i32)(p_user_data), 1)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+stress_test_job :: proc(p_user_data: rawptr) {
+	ctx := (^StressTestContext)(p_user_data)
+	sync.atomic_add(&ctx.num_executed, 1)
+
+	if ctx.depth == 0 {
+		return
+	}
+
+	children: [STRESS_TEST_FAN_OUT]StressTestContext
+	jobs: [STRESS_TEST_FAN_OUT]Job
+	for i in 0 ..< STRESS_TEST_FAN_OUT {
+		children[i].depth = ctx.depth - 1
+		jobs[i] = Job {
+			procedure = stress_test_job,
+			user_data = &children[i],
+		}
+	}
+
+	counter: JobCounter
+	jobs_run(jobs[:], &counter)
+	jobs_wait(&counter)
+
+	for child in children {
+		sync.atomic_add(&ctx.num_executed, child.num_executed)
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+// Runs the same CPU bound workload with 1..N threads and reports the speedup.
+// Each thread count gets it's own private job system, the global one keeps running the jobs
+// that are already scheduled on it, e.g. the asset loads, but they can skew the timings.
+jobs_run_scaling_benchmark :: proc(
+	p_max_threads: u32 = 0,
+	p_num_jobs: u32 = 4096,
+	p_allocator := context.allocator,
+) {
+	max_threads := p_max_threads
+	if max_threads == 0 {
+		max_threads = u32(max(os.processor_core_count(), 1))
+	}
+
+	// The calling thread joins each of the benchmark job systems, it's restored afterwards
+	prev_job_system := tls_job_system
+	prev_worker_idx := tls_worker_idx
+	defer {
+		tls_job_system = prev_job_system
+		tls_worker_idx = prev_worker_idx
+	}
+
+	results := make([]u32, p_num_jobs, p_allocator)
+	defer delete(results, p_allocator)
+
+	single_thread_duration: f64 = 0
+
+	for num_threads in 1 ..= max_threads {
+
+		benchmark_system: JobSystem
+		if num_threads > 1 {
+			options := JobSystemInitOptions {
+				num_workers = num_threads - 1,
+			}
+			if job_system_init(&benchmark_system, options, p_allocator) == false {
+				break
+			}
+		}
+
+		start := time.tick_now()
+		if num_threads > 1 {
+			jobs_parallel_for(p_num_jobs, 16, scaling_benchmark_workload, &results)
+		} else {
+			scaling_benchmark_workload(0, p_num_jobs, &results)
+		}
+		duration := time.duration_milliseconds(time.tick_since(start))
+
+		if num_threads == 1 {
+			single_thread_duration = duration
+		} else {
+			job_system_deinit(&benchmark_system)
+		}
+
+		log.infof(
+			"Job system scaling: %d threads, %.3f ms, speedup %.2fx\n",
+			num_threads,
+			duration,
+			single_thread_duration / duration,
+		)
+	}
+
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+scaling_benchmark_workload :: proc(p_start: u32, p_end: u32, p_user_data: rawptr) {
+	results := (^[]u32)(p_user_data)^
+	for i in p_start ..< p_end {
+		x := i + 1
+		for _ in 0 ..< 4096 {
+			x ~= x << 13
+			x ~= x >> 17
+			x ~= x << 5
+		}
+		results[i] = x
+	}
+}
+
+//---------------------------------------------------------------------------//
@@ -0,0 +1,383 @@
+package common
+
+//---------------------------------------------------------------------------//
+
+// Compression of independent blocks in the LZ4 block format
+// (https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md).
+// The compressor is a greedy single pass over a hash table of the last position of each
+// 4 byte sequence, it trades some ratio for speed, the decompressor is what matters here.
+
+//---------------------------------------------------------------------------//
+
+import "core:log"
+import "core:math/rand"
+import "core:mem"
+import "core:slice"
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+LZ4_MIN_MATCH :: 4
+
+// The last 5 bytes are always literals and the last match has to start 12 bytes before the end
+@(private = "file")
+LZ4_LAST_LITERALS :: 5
+@(private = "file")
+LZ4_MF_LIMIT :: 12
+
+@(private = "file")
+LZ4_MAX_OFFSET :: 65535
+
+LZ4_HASH_TABLE_SIZE :: 1 << 16
+
+//---------------------------------------------------------------------------//
+
+// Worst case size of a compressed block
+lz4_compress_bound :: proc(p_size: int) -> int {
+	return p_size + p_size / 255 + 16
+}
+
+//---------------------------------------------------------------------------//
+
+// Compresses p_src into p_dst, which has to be at least lz4_compress_bound(len(p_src)) bytes.
+// p_hash_table has to have LZ4_HASH_TABLE_SIZE entries, it's used as scratch memory.
+// Returns the compressed size.
+lz4_compress_block :: proc(p_src: []byte, p_dst: []byte, p_hash_table: []i32) -> int {
+	assert(len(p_dst) >= lz4_compress_bound(len(p_src)))
+	assert(len(p_hash_table) == LZ4_HASH_TABLE_SIZE)
+
+	slice.fill(p_hash_table, -1)
+
+	src_len := len(p_src)
+	dst_pos := 0
+	anchor := 0
+	pos := 0
+
+	if src_len >= LZ4_MF_LIMIT {
+		match_start_limit := src_len - LZ4_MF_LIMIT
+		match_end_limit := src_len - LZ4_LAST_LITERALS
+
+		for pos <= match_start_limit {
+			sequence := lz4_read_u32(p_src, pos)
+			hash := lz4_hash(sequence)
+			candidate := int(p_hash_table[hash])
+			p_hash_table[hash] = i32(pos)
+
+			if candidate < 0 ||
+			   pos - candidate > LZ4_MAX_OFFSET ||
+			   lz4_read_u32(p_src, candidate) != sequence {
+				// Skip faster through data that doesn't compress
+				pos += 1 + ((pos - anchor) >> 6)
+				continue
+			}
+
+			// Extend the match backwards into the pending literals and then forwards
+			for pos > anchor && candidate > 0 && p_src[pos - 1] == p_src[candidate - 1] {
+				pos -= 1
+				candidate -= 1
+			}
+
+			match_len := LZ4_MIN_MATCH
+			for pos + match_len < match_end_limit &&
+			    p_src[candidate + match_len] == p_src[pos + match_len] {
+				match_len += 1
+			}
+
+			dst_pos = lz4_write_sequence(p_dst, dst_pos, p_src[anchor:pos], pos - candidate, match_len)
+
+			pos += match_len
+			anchor = pos
+		}
+	}
+
+	// The remaining bytes are stored as literals of the last sequence
+	last_literals := p_src[anchor:]
+	dst_pos = lz4_write_length(p_dst, dst_pos, len(last_literals), 4)
+	copy(p_dst[dst_pos:], last_literals)
+	dst_pos += len(last_literals)
+
+	return dst_pos
+}
+
+//---------------------------------------------------------------------------//
+
+// Decompresses a block into p_dst. Returns the decompressed size, fails on malformed data
+// or when p_dst is too small, so it's safe to use on data read from disk.
+lz4_decompress_block :: proc(p_src: []byte, p_dst: []byte) -> (int, bool) {
+	src_pos := 0
+	dst_pos := 0
+
+	for src_pos < len(p_src) {
+		token := p_src[src_pos]
+		src_pos += 1
+
+		// Literals
+		literals_len, literals_len_ok := lz4_read_length(p_src, &src_pos, int(token >> 4))
+		if literals_len_ok == false ||
+		   src_pos + literals_len > len(p_src) ||
+		   dst_pos + literals_len > len(p_dst) {
+			return 0, false
+		}
+
+		copy(p_dst[dst_pos:], p_src[src_pos:src_pos + literals_len])
+		src_pos += literals_len
+		dst_pos += literals_len
+
+		// The last sequence has no match
+		if src_pos == len(p_src) {
+			break
+		}
+
+		// Match
+		if src_pos + 2 > len(p_src) {
+			return 0, false
+		}
+
+		offset := int(p_src[src_pos]) | (int(p_src[src_pos + 1]) << 8)
+		src_pos += 2
+
+		match_len, match_len_ok := lz4_read_length(p_src, &src_pos, int(token & 0xF))
+		match_len += LZ4_MIN_MATCH
+
+		if match_len_ok == false ||
+		   offset == 0 ||
+		   offset > dst_pos ||
+		   dst_pos + match_len > len(p_dst) {
+			return 0, false
+		}
+
+		match_pos := dst_pos - offset
+		if offset >= match_len {
+			mem.copy_non_overlapping(&p_dst[dst_pos], &p_dst[match_pos], match_len)
+		} else {
+			// Overlapping matches repeat the last offset bytes
+			for i in 0 ..< match_len {
+				p_dst[dst_pos + i] = p_dst[match_pos + i]
+			}
+		}
+		dst_pos += match_len
+	}
+
+	return dst_pos, true
+}
+
+//---------------------------------------------------------------------------//
+
+// Round-trips inputs that hit the edge cases of the format - blocks shorter than the match limit,
+// long literal and match lengths, overlapping matches and offsets at the window limit - and checks
+// that truncated blocks and too small outputs are rejected. Logs an error and returns false if
+// any check fails.
+lz4_run_checks :: proc(p_allocator := context.allocator) -> bool {
+	MAX_INPUT_SIZE :: 256 * KILOBYTE
+
+	hash_table := make([]i32, LZ4_HASH_TABLE_SIZE, p_allocator)
+	defer delete(hash_table, p_allocator)
+	input := make([]byte, MAX_INPUT_SIZE, p_allocator)
+	defer delete(input, p_allocator)
+	compressed := make([]byte, lz4_compress_bound(MAX_INPUT_SIZE), p_allocator)
+	defer delete(compressed, p_allocator)
+	decompressed := make([]byte, MAX_INPUT_SIZE, p_allocator)
+	defer delete(decompressed, p_allocator)
+
+	success := true
+
+	check_round_trip :: proc(
+		p_name: string,
+		p_input: []byte,
+		p_compressed: []byte,
+		p_decompressed: []byte,
+		p_hash_table: []i32,
+	) -> bool {
+		compressed_size := lz4_compress_block(p_input, p_compressed, p_hash_table)
+		if compressed_size > lz4_compress_bound(len(p_input)) {
+			log.errorf(
+				"LZ4 check failed - %s: %d bytes compressed to %d, over the bound\n",
+				p_name,
+				len(p_input),
+				compressed_size,
+			)
+			return false
+		}
+
+		block := p_compressed[:compressed_size]
+
+		decompressed_size, ok := lz4_decompress_block(block, p_decompressed[:len(p_input)])
+		if ok == false ||
+		   decompressed_size != len(p_input) ||
+		   slice.equal(p_decompressed[:len(p_input)], p_input) == false {
+			log.errorf("LZ4 check failed - %s: %d bytes don't round-trip\n", p_name, len(p_input))
+			return false
+		}
+
+		if len(p_input) == 0 {
+			return true
+		}
+
+		// The last literals are never empty, so both have to run out of bytes
+		if _, truncated_ok := lz4_decompress_block(block[:len(block) - 1], p_decompressed);
+		   truncated_ok {
+			log.errorf("LZ4 check failed - %s: a truncated block was decoded\n", p_name)
+			return false
+		}
+
+		if _, small_ok := lz4_decompress_block(block, p_decompressed[:len(p_input) - 1]); small_ok {
+			log.errorf("LZ4 check failed - %s: decoded into a too small output\n", p_name)
+			return false
+		}
+
+		return true
+	}
+
+	// Around the minimum sizes for a match
+	for size in ([]int{0, 1, 4, 11, 12, 13, 17}) {
+		slice.zero(input[:size])
+		if check_round_trip("zeros", input[:size], compressed, decompressed, hash_table) == false {
+			success = false
+		}
+	}
+
+	// A single match covering the whole block, length bytes well past 255
+	slice.fill(input, 0xAB)
+	if check_round_trip("run", input, compressed, decompressed, hash_table) == false {
+		success = false
+	}
+
+	// Incompressible, a single literal run with long length bytes
+	for &b in input {
+		b = byte(rand.uint32())
+	}
+	if check_round_trip("random", input, compressed, decompressed, hash_table) == false {
+		success = false
+	}
+
+	// Short repeating patterns, overlapping matches with offsets smaller than the match length
+	for &b, i in input {
+		b = byte(i % 3) if (i / 4096) % 2 == 0 else byte(rand.uint32() % 4)
+	}
+	if check_round_trip("patterns", input, compressed, decompressed, hash_table) == false {
+		success = false
+	}
+
+	// Random data repeated at the largest offset a match can use and just past it
+	for offset in ([]int{LZ4_MAX_OFFSET, LZ4_MAX_OFFSET + 1}) {
+		for i in 0 ..< offset {
+			input[i] = byte(rand.uint32())
+		}
+		for i in offset ..< 2 * offset {
+			input[i] = input[i - offset]
+		}
+		block := input[:2 * offset]
+		if check_round_trip("max offset", block, compressed, decompressed, hash_table) == false {
+			success = false
+		}
+	}
+
+	if success {
+		log.info("LZ4 checks passed\n")
+	}
+
+	return success
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+lz4_read_u32 :: #force_inline proc(p_data: []byte, p_pos: int) -> u32 {
+	return(
+		u32(p_data[p_pos]) |
+		(u32(p_data[p_pos + 1]) << 8) |
+		(u32(p_data[p_pos + 2]) << 16) |
+		(u32(p_data[p_pos + 3]) << 24) \
+	)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+lz4_hash :: #force_inline proc(p_sequence: u32) -> u32 {
+	return (p_sequence * 2654435761) >> (32 - 16)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+lz4_write_sequence :: proc(
+	p_dst: []byte,
+	p_dst_pos: int,
+	p_literals: []byte,
+	p_offset: int,
+	p_match_len: int,
+) -> int {
+	dst_pos := p_dst_pos
+	token_pos := dst_pos
+
+	dst_pos = lz4_write_length(p_dst, dst_pos, len(p_literals), 4)
+	copy(p_dst[dst_pos:], p_literals)
+	dst_pos += len(p_literals)
+
+	p_dst[dst_pos] = byte(p_offset)
+	p_dst[dst_pos + 1] = byte(p_offset >> 8)
+	dst_pos += 2
+
+	// The match length goes to the low bits of the token that was written with the literals
+	match_len := p_match_len - LZ4_MIN_MATCH
+	p_dst[token_pos] |= byte(min(match_len, 15))
+	if match_len >= 15 {
+		dst_pos = lz4_write_length_bytes(p_dst, dst_pos, match_len - 15)
+	}
+
+	return dst_pos
+}
+
+//---------------------------------------------------------------------------//
+
+// Writes the token with the length in the bits starting at p_shift, followed by the extra length bytes
+@(private = "file")
+lz4_write_length :: proc(p_dst: []byte, p_dst_pos: int, p_length: int, p_shift: u32) -> int {
+	p_dst[p_dst_pos] = byte(min(p_length, 15)) << p_shift
+	if p_length < 15 {
+		return p_dst_pos + 1
+	}
+	return lz4_write_length_bytes(p_dst, p_dst_pos + 1, p_length - 15)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+lz4_write_length_bytes :: proc(p_dst: []byte, p_dst_pos: int, p_length: int) -> int {
+	dst_pos := p_dst_pos
+	length := p_length
+	for length >= 255 {
+		p_dst[dst_pos] = 255
+		dst_pos += 1
+		length -= 255
+	}
+	p_dst[dst_pos] = byte(length)
+	return dst_pos + 1
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+lz4_read_length :: proc(p_src: []byte, p_src_pos: ^int, p_token_length: int) -> (int, bool) {
+	length := p_token_length
+	if length < 15 {
+		return length, true
+	}
+
+	for {
+		if p_src_pos^ >= len(p_src) {
+			return 0, false
+		}
+		extra := p_src[p_src_pos^]
+		p_src_pos^ += 1
+		length += int(extra)
+		if extra != 255 {
+			break
+		}
+	}
+
+	return length, true
+}
+
+//---------------------------------------------------------------------------//
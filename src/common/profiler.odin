@@ -0,0 +1,402 @@
+package common
+
+//---------------------------------------------------------------------------//
+
+import "core:fmt"
+import "core:log"
+import "core:mem"
+import "core:os"
+import "core:slice"
+import "core:strings"
+import "core:sync"
+import "core:time"
+
+//---------------------------------------------------------------------------//
+
+// When disabled, the profiler procs are empty and the scopes compile to nothing
+PROFILER_ENABLED :: #config(NEAT_PROFILER_ENABLED, true)
+
+//---------------------------------------------------------------------------//
+
+// How deep the CPU scopes can be nested on a single thread
+@(private = "file")
+PROFILER_MAX_SCOPE_DEPTH :: 64
+
+// GPU results arrive a few frames late, the capture waits for them before it's written
+@(private = "file")
+PROFILER_CAPTURE_GPU_LATENCY_FRAMES :: 4
+
+// Weight of the last frame in the rolling averages
+@(private = "file")
+PROFILER_STATS_BLEND_FACTOR :: 0.05
+
+// Thread id used for the GPU events in the trace, each queue gets the next one
+@(private = "file")
+PROFILER_GPU_TRACE_TID :: 0
+
+//---------------------------------------------------------------------------//
+
+ProfilerEvent :: struct {
+	// Has to outlive the frame, e.g. a string literal or an interned Name
+	name:        string,
+	// Nanoseconds since profiler_init
+	start_ns:    i64,
+	duration_ns: i64,
+	thread_id:   int,
+	frame:       u64,
+	// Only used by the GPU events
+	gpu_queue:   ProfilerGpuQueue,
+}
+
+//---------------------------------------------------------------------------//
+
+// Queue the GPU event was recorded on, each one has its own track in the trace
+ProfilerGpuQueue :: enum u8 {
+	Graphics,
+	AsyncCompute,
+}
+
+//---------------------------------------------------------------------------//
+
+// Rolling average time of the scopes with the same name, summed up over the frame
+ProfilerStat :: struct {
+	name:   string,
+	cpu_ms: f32,
+	gpu_ms: f32,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+ProfilerOpenScope :: struct {
+	name:     string,
+	start_ns: i64,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+INTERNAL: struct {
+	start_tick:          time.Tick,
+	frame:               u64,
+	// Scopes that ended during the current frame, on any of the threads
+	frame_events:        [dynamic]ProfilerEvent,
+	frame_events_lock:   sync.Mutex,
+	stats:               map[string]ProfilerStat,
+	stats_lock:          sync.Mutex,
+	capture_events:      [dynamic]ProfilerEvent,
+	capture_first_frame: u64,
+	capture_end_frame:   u64,
+	capture_path:        string,
+	is_capturing:        bool,
+	allocator:           mem.Allocator,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file", thread_local)
+tls_open_scopes: [PROFILER_MAX_SCOPE_DEPTH]ProfilerOpenScope
+
+@(private = "file", thread_local)
+tls_num_open_scopes: u32
+
+//---------------------------------------------------------------------------//
+
+profiler_init :: proc(p_allocator: mem.Allocator) {
+	when PROFILER_ENABLED {
+		INTERNAL.allocator = p_allocator
+		INTERNAL.start_tick = time.tick_now()
+		INTERNAL.frame_events = make([dynamic]ProfilerEvent, p_allocator)
+		INTERNAL.capture_events = make([dynamic]ProfilerEvent, p_allocator)
+		INTERNAL.stats = make(map[string]ProfilerStat, p_allocator)
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+profiler_deinit :: proc() {
+	when PROFILER_ENABLED {
+		delete(INTERNAL.frame_events)
+		delete(INTERNAL.capture_events)
+		delete(INTERNAL.stats)
+		delete(INTERNAL.capture_path, INTERNAL.allocator)
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+// Closes the current frame. Its CPU scopes go into the rolling stats and into the capture,
+// if there's one running. Called once per frame, before any of the frame's scopes begin.
+profiler_begin_frame :: proc() {
+	when PROFILER_ENABLED {
+		sync.mutex_lock(&INTERNAL.frame_events_lock)
+		defer sync.mutex_unlock(&INTERNAL.frame_events_lock)
+
+		profiler_update_stats(INTERNAL.frame_events[:], false)
+
+		if INTERNAL.is_capturing && INTERNAL.frame < INTERNAL.capture_end_frame {
+			append(&INTERNAL.capture_events, ..INTERNAL.frame_events[:])
+		}
+		clear(&INTERNAL.frame_events)
+
+		INTERNAL.frame += 1
+
+		if INTERNAL.is_capturing &&
+		   INTERNAL.frame >= INTERNAL.capture_end_frame + PROFILER_CAPTURE_GPU_LATENCY_FRAMES {
+			profiler_write_capture()
+		}
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+profiler_get_frame :: #force_inline proc() -> u64 {
+	when PROFILER_ENABLED {
+		return INTERNAL.frame
+	} else {
+		return 0
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+// Time in the profiler's timebase, used to line up the GPU events with the CPU ones
+profiler_get_time_ns :: #force_inline proc() -> i64 {
+	when PROFILER_ENABLED {
+		return i64(time.tick_diff(INTERNAL.start_tick, time.tick_now()))
+	} else {
+		return 0
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+// Measures the rest of the enclosing block:
+// 	common.profiler_scope("MeshBatchesUpdate")
+@(deferred_none = profiler_scope_end)
+profiler_scope :: #force_inline proc(p_name: string) {
+	profiler_scope_begin(p_name)
+}
+
+//---------------------------------------------------------------------------//
+
+// Scopes nest per thread, profiler_scope_end closes the last one begun on the calling thread.
+// The name has to outlive the frame, e.g. a string literal or an interned Name.
+profiler_scope_begin :: #force_inline proc(p_name: string) {
+	when PROFILER_ENABLED {
+		assert(tls_num_open_scopes < PROFILER_MAX_SCOPE_DEPTH)
+		tls_open_scopes[tls_num_open_scopes] = {
+			name     = p_name,
+			start_ns = profiler_get_time_ns(),
+		}
+		tls_num_open_scopes += 1
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+profiler_scope_end :: #force_inline proc() {
+	when PROFILER_ENABLED {
+		if tls_num_open_scopes == 0 {
+			return
+		}
+		tls_num_open_scopes -= 1
+		scope := tls_open_scopes[tls_num_open_scopes]
+
+		event := ProfilerEvent {
+			name        = scope.name,
+			start_ns    = scope.start_ns,
+			duration_ns = profiler_get_time_ns() - scope.start_ns,
+			thread_id   = sync.current_thread_id(),
+		}
+
+		sync.mutex_lock(&INTERNAL.frame_events_lock)
+		event.frame = INTERNAL.frame
+		append(&INTERNAL.frame_events, event)
+		sync.mutex_unlock(&INTERNAL.frame_events_lock)
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+// Adds the GPU events of a finished frame. The renderer resolves them a few frames
+// after they were recorded, p_frame is the profiler frame they were recorded in.
+profiler_add_gpu_events :: proc(p_frame: u64, p_events: []ProfilerEvent) {
+	when PROFILER_ENABLED {
+		profiler_update_stats(p_events, true)
+
+		sync.mutex_lock(&INTERNAL.frame_events_lock)
+		defer sync.mutex_unlock(&INTERNAL.frame_events_lock)
+
+		if INTERNAL.is_capturing &&
+		   p_frame >= INTERNAL.capture_first_frame &&
+		   p_frame < INTERNAL.capture_end_frame {
+			for event in p_events {
+				gpu_event := event
+				gpu_event.thread_id = PROFILER_GPU_TRACE_TID + int(event.gpu_queue)
+				gpu_event.frame = p_frame
+				append(&INTERNAL.capture_events, gpu_event)
+			}
+		}
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+// Records the next p_num_frames frames and writes them to p_file_path as a Chrome trace,
+// which can be opened in chrome://tracing or https://ui.perfetto.dev
+profiler_capture_begin :: proc(p_num_frames: u32, p_file_path: string) -> bool {
+	when PROFILER_ENABLED {
+		sync.mutex_lock(&INTERNAL.frame_events_lock)
+		defer sync.mutex_unlock(&INTERNAL.frame_events_lock)
+
+		if INTERNAL.is_capturing {
+			log.warn("Profiler capture is already running\n")
+			return false
+		}
+
+		delete(INTERNAL.capture_path, INTERNAL.allocator)
+		INTERNAL.capture_path = strings.clone(p_file_path, INTERNAL.allocator)
+		INTERNAL.capture_first_frame = INTERNAL.frame
+		INTERNAL.capture_end_frame = INTERNAL.frame + u64(p_num_frames)
+		INTERNAL.is_capturing = true
+		clear(&INTERNAL.capture_events)
+
+		return true
+	} else {
+		return false
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+profiler_is_capturing :: proc() -> bool {
+	when PROFILER_ENABLED {
+		return INTERNAL.is_capturing
+	} else {
+		return false
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+// Returns the rolling stats sorted by name
+profiler_get_stats :: proc(p_allocator: mem.Allocator) -> []ProfilerStat {
+	when PROFILER_ENABLED {
+		sync.mutex_lock(&INTERNAL.stats_lock)
+		defer sync.mutex_unlock(&INTERNAL.stats_lock)
+
+		stats := make([]ProfilerStat, len(INTERNAL.stats), p_allocator)
+		i := 0
+		for _, stat in INTERNAL.stats {
+			stats[i] = stat
+			i += 1
+		}
+
+		slice.sort_by(stats, proc(p_a, p_b: ProfilerStat) -> bool {
+			return p_a.name < p_b.name
+		})
+
+		return stats
+	} else {
+		return nil
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+profiler_update_stats :: proc(p_events: []ProfilerEvent, p_gpu: bool) {
+	temp_arena: Arena
+	temp_arena_init(&temp_arena)
+	defer arena_delete(temp_arena)
+
+	// Scopes with the same name, e.g. the draw stream chunks, are summed up
+	frame_times := make(map[string]f32, len(p_events), temp_arena.allocator)
+	for event in p_events {
+		frame_times[event.name] += f32(f64(event.duration_ns) / f64(time.Millisecond))
+	}
+
+	sync.mutex_lock(&INTERNAL.stats_lock)
+	defer sync.mutex_unlock(&INTERNAL.stats_lock)
+
+	for name, frame_time in frame_times {
+		if name not_in INTERNAL.stats {
+			// Start from the first measurement, instead of blending in from zero
+			INTERNAL.stats[name] = ProfilerStat {
+				name   = name,
+				cpu_ms = p_gpu ? 0 : frame_time,
+				gpu_ms = p_gpu ? frame_time : 0,
+			}
+			continue
+		}
+
+		stat := &INTERNAL.stats[name]
+		if p_gpu {
+			stat.gpu_ms += (frame_time - stat.gpu_ms) * PROFILER_STATS_BLEND_FACTOR
+		} else {
+			stat.cpu_ms += (frame_time - stat.cpu_ms) * PROFILER_STATS_BLEND_FACTOR
+		}
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+// Writes the captured events in the Chrome trace event format, as complete ("X") events
+@(private = "file")
+profiler_write_capture :: proc() {
+	INTERNAL.is_capturing = false
+
+	trace := strings.builder_make(INTERNAL.allocator)
+	defer strings.builder_destroy(&trace)
+
+	strings.write_string(&trace, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n")
+	for gpu_queue in ProfilerGpuQueue {
+		if gpu_queue != .Graphics {
+			strings.write_string(&trace, ",\n")
+		}
+		fmt.sbprintf(
+			&trace,
+			"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"GPU %v\"}}",
+			PROFILER_GPU_TRACE_TID + int(gpu_queue),
+			gpu_queue,
+		)
+	}
+
+	for event in INTERNAL.capture_events {
+		strings.write_string(&trace, ",\n{\"name\":")
+		strings.write_quoted_string(&trace, event.name)
+		fmt.sbprintf(
+			&trace,
+			",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%d,\"args\":{\"frame\":%d}}",
+			is_gpu_trace_tid(event.thread_id) ? "gpu" : "cpu",
+			f64(event.start_ns) / 1000,
+			f64(event.duration_ns) / 1000,
+			event.thread_id,
+			event.frame,
+		)
+	}
+
+	strings.write_string(&trace, "\n]}\n")
+
+	if os.write_entire_file(INTERNAL.capture_path, trace.buf[:]) == false {
+		log.errorf("Failed to write the profiler capture to '%s'\n", INTERNAL.capture_path)
+		return
+	}
+
+	log.infof(
+		"Profiler capture of %d frames written to '%s'\n",
+		INTERNAL.capture_end_frame - INTERNAL.capture_first_frame,
+		INTERNAL.capture_path,
+	)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+is_gpu_trace_tid :: #force_inline proc(p_thread_id: int) -> bool {
+	return p_thread_id >= PROFILER_GPU_TRACE_TID &&
+		p_thread_id < PROFILER_GPU_TRACE_TID + len(ProfilerGpuQueue)
+}
+
+//---------------------------------------------------------------------------//
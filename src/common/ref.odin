@@ -3,18 +3,68 @@ package common
 //---------------------------------------------------------------------------//
 
 import "core:c"
+import "core:log"
+import "core:math/rand"
 import "core:mem"
+import "core:time"
+
+//---------------------------------------------------------------------------//
+
+// Number of low bits of a ref used for the generation, the remaining high bits store the index
+REF_GENERATION_BITS :: #config(REF_GENERATION_BITS, 8)
+
+#assert(REF_GENERATION_BITS > 0 && REF_GENERATION_BITS < 32)
+
+REF_INDEX_BITS :: 32 - REF_GENERATION_BITS
+
+// The last index is never handed out, so that no valid ref can be equal to UINT32_MAX
+REF_MAX_CAPACITY :: (u32(1) << REF_INDEX_BITS) - 1
+
+@(private = "file")
+REF_GENERATION_MASK :: (u32(1) << REF_GENERATION_BITS) - 1
+
+@(private = "file")
+REF_NAME_TABLE_MIN_SIZE :: 16
+
+// Marks an unused slot of the name table
+@(private = "file")
+REF_NAME_TABLE_EMPTY :: c.UINT32_MAX
+
+//---------------------------------------------------------------------------//
+
+RefArrayFlagBits :: enum u8 {
+	// Doubles the capacity when the array is full instead of asserting. Only for arrays whose
+	// resource data can grow along with it, see ref_array_get_capacity().
+	Growable,
+}
+
+RefArrayFlags :: distinct bit_set[RefArrayFlagBits;u8]
+
+//---------------------------------------------------------------------------//
+
+RefNameTableEntry :: struct {
+	name: Name,
+	idx:  u32,
+}
 
 //---------------------------------------------------------------------------//
 
 RefArray :: struct($ResourceType: typeid) {
 	next_idx:         u32,
 	num_free_indices: u32,
+	// Stack of the freed indices, reused before a new index is taken
 	free_indices:     []u32,
-	generations:      []u8,
+	generations:      []u32,
 	names:            []Name,
+	// Densely packed refs of the alive resources, valid up to alive_count
 	alive_refs:       []Ref(ResourceType),
 	alive_count:      u32,
+	// Position of each index in alive_refs, so that it can be swap-removed in O(1)
+	alive_positions:  []u32,
+	// Open addressing table with linear probing, maps names to indices. Kept at most half
+	// full, as it's sized to twice the capacity.
+	name_table:       []RefNameTableEntry,
+	flags:            RefArrayFlags,
 	allocator:        mem.Allocator,
 }
 
@@ -27,21 +77,18 @@ Ref :: struct($T: typeid) {
 //---------------------------------------------------------------------------//
 
 ref_is_alive :: #force_inline proc(p_ref_array: ^RefArray($R), p_ref: Ref(R)) -> bool {
-	idx := u32(p_ref.ref >> 24)
-
-	gen := ref_get_generation(p_ref)
-	if gen != p_ref_array.generations[idx] {
+	idx := p_ref.ref >> REF_GENERATION_BITS
+	if idx >= p_ref_array.next_idx {
 		return false
 	}
-
-	return true
+	return ref_get_generation(p_ref) == p_ref_array.generations[idx]
 }
 
 //---------------------------------------------------------------------------//
 
 ref_get_idx :: #force_inline proc(p_ref_array: ^RefArray($R), p_ref: Ref(R)) -> u32 {
-	idx := u32(p_ref.ref >> 24)
-		assert(idx < p_ref_array.next_idx)
+	idx := p_ref.ref >> REF_GENERATION_BITS
+	assert(idx < p_ref_array.next_idx)
 
 	gen := ref_get_generation(p_ref)
 	assert(gen == p_ref_array.generations[idx])
@@ -51,8 +98,8 @@ ref_get_idx :: #force_inline proc(p_ref_array: ^RefArray($R), p_ref: Ref(R)) ->
 
 //---------------------------------------------------------------------------//
 
-ref_get_generation :: #force_inline proc(p_ref: $T) -> u8 {
-	return u8(p_ref.ref & 0xFF)
+ref_get_generation :: #force_inline proc(p_ref: $T) -> u32 {
+	return p_ref.ref & REF_GENERATION_MASK
 }
 
 //---------------------------------------------------------------------------//
@@ -61,44 +108,65 @@ ref_array_create :: proc(
 	$R: typeid,
 	p_capacity: int,
 	p_allocator: mem.Allocator = context.allocator,
+	p_flags: RefArrayFlags = {},
 ) -> RefArray(R) {
-	return(
-		RefArray(R){
-			free_indices = make([]u32, p_capacity, p_allocator),
-			generations = make([]u8, p_capacity, p_allocator),
-			names = make([]Name, p_capacity, p_allocator),
-			next_idx = 0,
-			num_free_indices = 0,
-			alive_refs = make([]Ref(R), p_capacity, p_allocator),
-			alive_count = 0,
-			allocator = p_allocator,
-		} \
-	)
+	assert(p_capacity > 0 && u32(p_capacity) <= REF_MAX_CAPACITY)
+
+	ref_array := RefArray(R) {
+		flags     = p_flags,
+		allocator = p_allocator,
+	}
+	allocate_storage(&ref_array, u32(p_capacity))
+
+	for &entry in ref_array.name_table {
+		entry.idx = REF_NAME_TABLE_EMPTY
+	}
+
+	return ref_array
+}
+
+//---------------------------------------------------------------------------//
+
+ref_array_delete :: proc(p_ref_array: ^RefArray($R)) {
+	free_storage(p_ref_array)
+	p_ref_array^ = {}
 }
 
+//---------------------------------------------------------------------------//
+
+// Resource data indexed with ref_get_idx() has to be at least this large
+ref_array_get_capacity :: #force_inline proc(p_ref_array: ^RefArray($R)) -> u32 {
+	return u32(len(p_ref_array.generations))
+}
+
+//---------------------------------------------------------------------------//
+
 ref_create :: proc($R: typeid, p_ref_array: ^RefArray(R), p_name: Name) -> Ref(R) {
-	assert(
-		p_ref_array.next_idx < u32(len(p_ref_array.free_indices)) ||
-		len(p_ref_array.free_indices) > 0,
-	)
 
 	idx := u32(0)
-	generation := u32(0)
 	if p_ref_array.num_free_indices > 0 {
 		p_ref_array.num_free_indices -= 1
 		idx = p_ref_array.free_indices[p_ref_array.num_free_indices]
-		p_ref_array.generations[idx] += 1
-		generation = u32(p_ref_array.generations[idx])
 	} else {
+		if p_ref_array.next_idx == ref_array_get_capacity(p_ref_array) {
+			assert(
+				.Growable in p_ref_array.flags,
+				"Ref array is full, increase the MAX_* capacity of the resource",
+			)
+			grow(p_ref_array)
+		}
 		idx = p_ref_array.next_idx
 		p_ref_array.next_idx += 1
 	}
 
 	new_ref := Ref(R) {
-		ref = (idx << 24) | (generation & 0xFF),
+		ref = (idx << REF_GENERATION_BITS) | p_ref_array.generations[idx],
 	}
 
 	p_ref_array.names[idx] = p_name
+	name_table_insert(p_ref_array, p_name, idx)
+
+	p_ref_array.alive_positions[idx] = p_ref_array.alive_count
 	p_ref_array.alive_refs[p_ref_array.alive_count] = new_ref
 	p_ref_array.alive_count += 1
 
@@ -108,46 +176,438 @@ ref_create :: proc($R: typeid, p_ref_array: ^RefArray(R), p_name: Name) -> Ref(R
 //---------------------------------------------------------------------------//
 
 ref_free :: proc(p_ref_array: ^RefArray($R), p_ref: Ref(R)) {
-	assert(p_ref_array.num_free_indices < u32(len(p_ref_array.free_indices)))
-	p_ref_array.free_indices[p_ref_array.num_free_indices] = ref_get_idx(p_ref_array, p_ref)
-	p_ref_array.generations[p_ref_array.num_free_indices] = ref_get_generation(p_ref)
-	p_ref_array.num_free_indices += 1
-	p_ref_array.names[ref_get_idx(p_ref_array, p_ref)] = 0
+	idx := ref_get_idx(p_ref_array, p_ref)
 
-	for i in 0 ..< p_ref_array.alive_count {
-		if p_ref_array.alive_refs[i] == p_ref {
-			// Swap the last element with the removed element
-			p_ref_array.alive_refs[i] = p_ref_array.alive_refs[p_ref_array.alive_count - 1]
-			break
-		}
-	}
+	name_table_remove(p_ref_array, p_ref_array.names[idx], idx)
+	p_ref_array.names[idx] = EMPTY_NAME
+
+	// Bumping the generation right away makes the outstanding refs stale
+	p_ref_array.generations[idx] = (p_ref_array.generations[idx] + 1) & REF_GENERATION_MASK
+
+	p_ref_array.free_indices[p_ref_array.num_free_indices] = idx
+	p_ref_array.num_free_indices += 1
 
+	// Swap the last alive ref into the place of the removed one
+	position := p_ref_array.alive_positions[idx]
 	p_ref_array.alive_count -= 1
+	last_ref := p_ref_array.alive_refs[p_ref_array.alive_count]
+	p_ref_array.alive_refs[position] = last_ref
+	p_ref_array.alive_positions[last_ref.ref >> REF_GENERATION_BITS] = position
 }
 
 //---------------------------------------------------------------------------//
 
+// When multiple alive resources share the name, any one of them can be returned
 ref_find_by_name :: proc(p_ref_array: ^RefArray($R), p_name: Name) -> Ref(R) {
-	for name, idx in p_ref_array.names {
-		if name_equal(name, p_name) {
-			return Ref(R){ref = u32(idx) << 24 | u32(p_ref_array.generations[idx])}
+	mask := u32(len(p_ref_array.name_table) - 1)
+	slot := name_table_hash(p_name) & mask
+
+	for {
+		entry := p_ref_array.name_table[slot]
+		if entry.idx == REF_NAME_TABLE_EMPTY {
+			return Ref(R){ref = c.UINT32_MAX}
+		}
+		if name_equal(entry.name, p_name) {
+			return Ref(R) {
+				ref = entry.idx << REF_GENERATION_BITS | p_ref_array.generations[entry.idx],
+			}
 		}
+		slot = (slot + 1) & mask
 	}
-
-	return Ref(R){ref = c.UINT32_MAX}
 }
+
 //---------------------------------------------------------------------------//
 
 ref_array_clear :: proc(p_ref_array: ^RefArray($R)) {
-	capacity := len(p_ref_array.generations)
+	// Make the refs of the cleared resources stale, the indices will be handed out again
+	for idx in 0 ..< p_ref_array.next_idx {
+		p_ref_array.generations[idx] = (p_ref_array.generations[idx] + 1) & REF_GENERATION_MASK
+		p_ref_array.names[idx] = EMPTY_NAME
+	}
+	for &entry in p_ref_array.name_table {
+		entry.idx = REF_NAME_TABLE_EMPTY
+	}
 
-	delete(p_ref_array.free_indices)
-	delete(p_ref_array.generations)
 	p_ref_array.alive_count = 0
-	p_ref_array.free_indices = make([]u32, capacity, p_ref_array.allocator)
-	p_ref_array.generations = make([]u8, capacity, p_ref_array.allocator)
 	p_ref_array.next_idx = 0
 	p_ref_array.num_free_indices = 0
 }
 
 //---------------------------------------------------------------------------//
+
+@(private = "file")
+allocate_storage :: proc(p_ref_array: ^RefArray($R), p_capacity: u32) {
+	allocator := p_ref_array.allocator
+	p_ref_array.free_indices = make([]u32, p_capacity, allocator)
+	p_ref_array.generations = make([]u32, p_capacity, allocator)
+	p_ref_array.names = make([]Name, p_capacity, allocator)
+	p_ref_array.alive_refs = make([]Ref(R), p_capacity, allocator)
+	p_ref_array.alive_positions = make([]u32, p_capacity, allocator)
+	p_ref_array.name_table = make(
+		[]RefNameTableEntry,
+		max(REF_NAME_TABLE_MIN_SIZE, next_power_of_two(p_capacity * 2)),
+		allocator,
+	)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+free_storage :: proc(p_ref_array: ^RefArray($R)) {
+	allocator := p_ref_array.allocator
+	delete(p_ref_array.free_indices, allocator)
+	delete(p_ref_array.generations, allocator)
+	delete(p_ref_array.names, allocator)
+	delete(p_ref_array.alive_refs, allocator)
+	delete(p_ref_array.alive_positions, allocator)
+	delete(p_ref_array.name_table, allocator)
+}
+
+//---------------------------------------------------------------------------//
+
+// Doubles the capacity and rehashes the names. Only called once the free indices ran out.
+@(private = "file")
+grow :: proc(p_ref_array: ^RefArray($R)) {
+	old_capacity := ref_array_get_capacity(p_ref_array)
+	assert(old_capacity < REF_MAX_CAPACITY)
+	new_capacity := u32(min(u64(old_capacity) * 2, u64(REF_MAX_CAPACITY)))
+
+	old := p_ref_array^
+	allocate_storage(p_ref_array, new_capacity)
+
+	copy(p_ref_array.free_indices, old.free_indices)
+	copy(p_ref_array.generations, old.generations)
+	copy(p_ref_array.names, old.names)
+	copy(p_ref_array.alive_refs, old.alive_refs)
+	copy(p_ref_array.alive_positions, old.alive_positions)
+
+	for &entry in p_ref_array.name_table {
+		entry.idx = REF_NAME_TABLE_EMPTY
+	}
+	for entry in old.name_table {
+		if entry.idx != REF_NAME_TABLE_EMPTY {
+			name_table_insert(p_ref_array, entry.name, entry.idx)
+		}
+	}
+
+	free_storage(&old)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+name_table_hash :: #force_inline proc(p_name: Name) -> u32 {
+	// Names are already hashes, this just spreads them over the low bits
+	h := u32(p_name) * 0x9E3779B1
+	return h ~ (h >> 16)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+name_table_insert :: proc(p_ref_array: ^RefArray($R), p_name: Name, p_idx: u32) {
+	if name_equal(p_name, EMPTY_NAME) {
+		return
+	}
+
+	mask := u32(len(p_ref_array.name_table) - 1)
+	slot := name_table_hash(p_name) & mask
+	for p_ref_array.name_table[slot].idx != REF_NAME_TABLE_EMPTY {
+		slot = (slot + 1) & mask
+	}
+	p_ref_array.name_table[slot] = {
+		name = p_name,
+		idx  = p_idx,
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+// Uses backward shift deletion, so that the table doesn't fill up with tombstones
+@(private = "file")
+name_table_remove :: proc(p_ref_array: ^RefArray($R), p_name: Name, p_idx: u32) {
+	if name_equal(p_name, EMPTY_NAME) {
+		return
+	}
+
+	table := p_ref_array.name_table
+	mask := u32(len(table) - 1)
+
+	// The index has to match as well, as names don't have to be unique
+	slot := name_table_hash(p_name) & mask
+	for table[slot].idx != p_idx {
+		assert(table[slot].idx != REF_NAME_TABLE_EMPTY)
+		slot = (slot + 1) & mask
+	}
+
+	// Move back the entries of the cluster that can't be reached anymore once the slot is empty
+	hole := slot
+	next := (slot + 1) & mask
+	for table[next].idx != REF_NAME_TABLE_EMPTY {
+		home := name_table_hash(table[next].name) & mask
+		if ((next - home) & mask) >= ((next - hole) & mask) {
+			table[hole] = table[next]
+			hole = next
+		}
+		next = (next + 1) & mask
+	}
+	table[hole].idx = REF_NAME_TABLE_EMPTY
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+next_power_of_two :: #force_inline proc(p_value: u32) -> u32 {
+	power := u32(1)
+	for power < p_value {
+		power <<= 1
+	}
+	return power
+}
+
+//---------------------------------------------------------------------------//
+
+// Runs random creates and frees on a small growable array, with duplicate and empty names, and
+// checks after each step that the name table matches the alive refs - every entry is reachable
+// from its home slot, every named ref can be found and freed names can't. Logs an error and
+// returns false if any check fails.
+ref_array_run_checks :: proc(p_num_steps: u32 = 4000, p_allocator := context.allocator) -> bool {
+	CheckResource :: struct {}
+	NUM_NAMES :: 48
+
+	ref_array := ref_array_create(CheckResource, 4, p_allocator, {.Growable})
+	defer ref_array_delete(&ref_array)
+
+	// A small pool, so that names are shared by multiple refs and the table forms clusters
+	names: [NUM_NAMES]Name
+	for &name in names {
+		name = Name(rand.uint32() | 1)
+	}
+
+	success := true
+
+	for step in 0 ..< p_num_steps {
+		// Grows to ~128 alive refs and then keeps the count around there
+		if ref_array.alive_count == 0 || (rand.uint32() % 256) >= ref_array.alive_count {
+			name := EMPTY_NAME if rand.uint32() % 8 == 0 else names[rand.uint32() % NUM_NAMES]
+			ref := ref_create(CheckResource, &ref_array, name)
+
+			if name_equal(name, EMPTY_NAME) == false &&
+			   ref_find_by_name(&ref_array, name).ref == c.UINT32_MAX {
+				log.errorf("Ref array check failed - step %d: created ref not found\n", step)
+				success = false
+			}
+		} else {
+			ref := ref_array.alive_refs[rand.uint32() % ref_array.alive_count]
+			ref_free(&ref_array, ref)
+
+			if ref_is_alive(&ref_array, ref) {
+				log.errorf("Ref array check failed - step %d: freed ref still alive\n", step)
+				success = false
+			}
+		}
+
+		if check_ref_array_name_table(&ref_array, names[:], step) == false {
+			success = false
+			break
+		}
+	}
+
+	ref_array_clear(&ref_array)
+	for name in names {
+		if ref_find_by_name(&ref_array, name).ref != c.UINT32_MAX {
+			log.error("Ref array check failed - name found after clear\n")
+			success = false
+			break
+		}
+	}
+
+	if success {
+		log.info("Ref array checks passed\n")
+	}
+
+	return success
+}
+
+//---------------------------------------------------------------------------//
+
+// Creates, finds and frees p_num_refs refs in a growable array, compares the lookups
+// with the linear name scan the ref arrays used to do
+ref_array_run_benchmark :: proc(
+	p_num_refs: u32 = 100000,
+	p_num_linear_finds: u32 = 1000,
+	p_allocator := context.allocator,
+) {
+	BenchmarkResource :: struct {}
+
+	ref_array := ref_array_create(BenchmarkResource, 64, p_allocator, {.Growable})
+	defer ref_array_delete(&ref_array)
+
+	names := make([]Name, p_num_refs, p_allocator)
+	defer delete(names, p_allocator)
+	refs := make([]Ref(BenchmarkResource), p_num_refs, p_allocator)
+	defer delete(refs, p_allocator)
+
+	// Multiplying by an odd constant is a bijection, so the names are unique and non-empty
+	for &name, i in names {
+		name = Name(u32(i + 1) * 0x9E3779B1)
+	}
+
+	start := time.tick_now()
+	for name, i in names {
+		refs[i] = ref_create(BenchmarkResource, &ref_array, name)
+	}
+	create_duration := time.duration_nanoseconds(time.tick_since(start))
+
+	start = time.tick_now()
+	num_found := u32(0)
+	for name, i in names {
+		if ref_find_by_name(&ref_array, name) == refs[i] {
+			num_found += 1
+		}
+	}
+	find_duration := time.duration_nanoseconds(time.tick_since(start))
+
+	start = time.tick_now()
+	num_found_linear := u32(0)
+	for _ in 0 ..< min(p_num_linear_finds, p_num_refs) {
+		name := names[rand.uint32() % p_num_refs]
+		for idx in 0 ..< ref_array.next_idx {
+			if name_equal(ref_array.names[idx], name) {
+				num_found_linear += 1
+				break
+			}
+		}
+	}
+	linear_find_duration := time.duration_nanoseconds(time.tick_since(start))
+
+	rand.shuffle(refs)
+
+	start = time.tick_now()
+	for ref in refs {
+		ref_free(&ref_array, ref)
+	}
+	free_duration := time.duration_nanoseconds(time.tick_since(start))
+
+	if num_found != p_num_refs || ref_array.alive_count != 0 {
+		log.errorf(
+			"Ref array benchmark: found %d/%d refs, %d still alive\n",
+			num_found,
+			p_num_refs,
+			ref_array.alive_count,
+		)
+	}
+
+	ns_per_find := f64(find_duration) / f64(p_num_refs)
+	ns_per_linear_find := f64(linear_find_duration) / f64(max(num_found_linear, 1))
+
+	log.infof(
+		"Ref array benchmark: %d refs - create: %.1f ns/ref, free: %.1f ns/ref, find: %.1f ns/ref, linear find: %.1f ns/ref (%.0fx)\n",
+		p_num_refs,
+		f64(create_duration) / f64(p_num_refs),
+		f64(free_duration) / f64(p_num_refs),
+		ns_per_find,
+		ns_per_linear_find,
+		ns_per_linear_find / max(ns_per_find, 0.001),
+	)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+check_ref_array_name_table :: proc(
+	p_ref_array: ^RefArray($R),
+	p_names: []Name,
+	p_step: u32,
+) -> bool {
+	table := p_ref_array.name_table
+	mask := u32(len(table) - 1)
+
+	num_named_refs := u32(0)
+	for ref, position in p_ref_array.alive_refs[:p_ref_array.alive_count] {
+		idx := ref.ref >> REF_GENERATION_BITS
+		if ref_is_alive(p_ref_array, ref) == false ||
+		   p_ref_array.alive_positions[idx] != u32(position) {
+			log.errorf("Ref array check failed - step %d: alive refs out of sync\n", p_step)
+			return false
+		}
+		if name_equal(p_ref_array.names[idx], EMPTY_NAME) == false {
+			num_named_refs += 1
+		}
+	}
+
+	num_entries := u32(0)
+	for entry, slot in table {
+		if entry.idx == REF_NAME_TABLE_EMPTY {
+			continue
+		}
+		num_entries += 1
+
+		alive_ref := Ref(R) {
+			ref = entry.idx << REF_GENERATION_BITS | p_ref_array.generations[entry.idx],
+		}
+		if entry.idx >= p_ref_array.next_idx ||
+		   p_ref_array.alive_refs[p_ref_array.alive_positions[entry.idx]] != alive_ref ||
+		   name_equal(p_ref_array.names[entry.idx], entry.name) == false {
+			log.errorf(
+				"Ref array check failed - step %d: slot %d points at a dead or renamed index\n",
+				p_step,
+				slot,
+			)
+			return false
+		}
+
+		// Lookups stop at the first empty slot, so there can't be one between home and the entry
+		probe := name_table_hash(entry.name) & mask
+		for ; probe != u32(slot); probe = (probe + 1) & mask {
+			if table[probe].idx == REF_NAME_TABLE_EMPTY {
+				log.errorf(
+					"Ref array check failed - step %d: slot %d is unreachable\n",
+					p_step,
+					slot,
+				)
+				return false
+			}
+		}
+	}
+
+	if num_entries != num_named_refs {
+		log.errorf(
+			"Ref array check failed - step %d: %d table entries for %d named refs\n",
+			p_step,
+			num_entries,
+			num_named_refs,
+		)
+		return false
+	}
+
+	// Found exactly when an alive ref has the name
+	for name in p_names {
+		has_alive_ref := false
+		for ref in p_ref_array.alive_refs[:p_ref_array.alive_count] {
+			if name_equal(p_ref_array.names[ref.ref >> REF_GENERATION_BITS], name) {
+				has_alive_ref = true
+				break
+			}
+		}
+
+		found_ref := ref_find_by_name(p_ref_array, name)
+		found := found_ref.ref != c.UINT32_MAX
+		if found != has_alive_ref {
+			log.errorf("Ref array check failed - step %d: wrong lookup result\n", p_step)
+			return false
+		}
+
+		if found {
+			found_name := p_ref_array.names[ref_get_idx(p_ref_array, found_ref)]
+			if name_equal(found_name, name) == false {
+				log.errorf("Ref array check failed - step %d: lookup found another name\n", p_step)
+				return false
+			}
+		}
+	}
+
+	return true
+}
+
+//---------------------------------------------------------------------------//
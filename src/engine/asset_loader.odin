@@ -0,0 +1,368 @@
+package engine
+
+//---------------------------------------------------------------------------//
+
+// Asynchronous loading of the assets. The *_asset_load_async procs return the asset ref right
+// away, the asset stays in the .Loading state until it's ready to be used. Each load goes through:
+// - on Linux with -define:NEAT_ASYNC_FILE_IO=true, an io_uring read of the data file that's
+//   polled by asset_loader_update. Otherwise, e.g. on Windows, the file is mapped by the read
+//   job instead,
+// - a job that maps the files, parses the metadata and decodes the data on the job system,
+// - asset_loader_update, called once per frame on the main thread, that creates the renderer
+//   resources from the decoded data and waits for the dependencies, e.g. the materials of a mesh,
+// - the completion callbacks, called from asset_loader_update once the data is on the GPU.
+
+//---------------------------------------------------------------------------//
+
+import "core:log"
+import "core:mem"
+import "core:sync"
+
+import "../common"
+
+//---------------------------------------------------------------------------//
+
+AssetLoadState :: enum u8 {
+	Loading,
+	Loaded,
+	Failed,
+}
+
+//---------------------------------------------------------------------------//
+
+// Always called from asset_loader_update, even when the asset was already loaded
+AssetLoadCallback :: proc(p_name: common.Name, p_success: bool, p_user_data: rawptr)
+
+//---------------------------------------------------------------------------//
+
+@(private)
+AssetLoadStepResult :: enum u8 {
+	Pending,
+	Done,
+	Failed,
+}
+
+//---------------------------------------------------------------------------//
+
+// Runs on the job system, fills the load data of the request
+@(private)
+AssetLoadReadProc :: proc(p_request: ^AssetLoadRequest) -> bool
+
+// Runs on the main thread once the read job is done, until it returns .Done or .Failed.
+// It's responsible for releasing the resources the read proc acquired, e.g. file mappings.
+@(private)
+AssetLoadStepProc :: proc(p_request: ^AssetLoadRequest) -> AssetLoadStepResult
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+AssetLoadCallbackEntry :: struct {
+	callback:  AssetLoadCallback,
+	user_data: rawptr,
+	name:      common.Name,
+	success:   bool,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+AssetLoadRequest :: struct {
+	type:            AssetType,
+	name:            common.Name,
+	// Ref of the asset that's being loaded, the type of the ref depends on the asset type
+	asset_ref:       u32,
+	// Step of the load, used by the step proc of the asset type
+	stage:           u8,
+	// Memory for the load data, released once the request finishes
+	arena:           common.Arena,
+	load_data:       rawptr,
+	read_proc:       AssetLoadReadProc,
+	step_proc:       AssetLoadStepProc,
+	read_counter:    common.JobCounter,
+	read_success:    bool,
+	// Async read of the data file, the read job starts once it's not .Pending anymore.
+	// The read proc takes over the data when it's .Done and reads the file itself otherwise.
+	file_read:       common.AsyncFileRead,
+	is_reading_file: bool,
+	callbacks:       [dynamic]AssetLoadCallbackEntry,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+ASSET_LOADER_PREFETCH_STRIDE :: 4 * common.KILOBYTE
+
+// Max number of the data files that are read at the same time, the loads over it read their
+// files on the job system
+@(private = "file")
+ASSET_LOADER_FILE_READ_QUEUE_DEPTH :: 64
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+INTERNAL: struct {
+	requests:          [dynamic]^AssetLoadRequest,
+	pending_callbacks: [dynamic]AssetLoadCallbackEntry,
+	is_updating:       bool,
+	// Keeps the prefetch reads from being optimized away
+	prefetch_sink:     u8,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+asset_loader_init :: proc() {
+	INTERNAL.requests = make([dynamic]^AssetLoadRequest, G_ALLOCATORS.main_allocator)
+	INTERNAL.pending_callbacks = make([dynamic]AssetLoadCallbackEntry, G_ALLOCATORS.main_allocator)
+
+	if common.async_file_io_init(ASSET_LOADER_FILE_READ_QUEUE_DEPTH) {
+		log.info("Asset data files are read with async file I/O")
+	} else {
+		log.info("Async file I/O isn't available, asset data files are read on the job system")
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+// Advances the pending loads, has to be called on the main thread once per frame
+asset_loader_update :: proc() {
+	common.profiler_scope("AssetLoaderUpdate")
+
+	INTERNAL.is_updating = true
+
+	temp_arena: common.Arena
+	common.temp_arena_init(&temp_arena)
+	defer common.arena_delete(temp_arena)
+
+	finished_requests := make([dynamic]^AssetLoadRequest, temp_arena.allocator)
+
+	common.async_file_io_poll()
+
+	// Requests that are started by the step procs are appended and checked in the same loop
+	for i := 0; i < len(INTERNAL.requests); {
+		request := INTERNAL.requests[i]
+
+		if request.is_reading_file {
+			if request.file_read.status != .Pending {
+				request.is_reading_file = false
+				asset_loader_start_read_job(request)
+			}
+			i += 1
+			continue
+		}
+
+		if sync.atomic_load(&request.read_counter.value) > 0 {
+			i += 1
+			continue
+		}
+
+		result := request.step_proc(request)
+		if result == .Pending {
+			i += 1
+			continue
+		}
+
+		for &callback_entry in request.callbacks {
+			callback_entry.success = result == .Done
+		}
+		append(&INTERNAL.pending_callbacks, ..request.callbacks[:])
+
+		unordered_remove(&INTERNAL.requests, i)
+		append(&finished_requests, request)
+	}
+
+	INTERNAL.is_updating = false
+
+	for request in finished_requests {
+		asset_loader_request_destroy(request)
+	}
+
+	// The callbacks can start new loads, so they're called on a copy
+	if len(INTERNAL.pending_callbacks) > 0 {
+		callbacks := make(
+			[]AssetLoadCallbackEntry,
+			len(INTERNAL.pending_callbacks),
+			temp_arena.allocator,
+		)
+		copy(callbacks, INTERNAL.pending_callbacks[:])
+		clear(&INTERNAL.pending_callbacks)
+
+		for callback_entry in callbacks {
+			callback_entry.callback(
+				callback_entry.name,
+				callback_entry.success,
+				callback_entry.user_data,
+			)
+		}
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+// Number of the assets that are still being loaded, including the ones that wait for their upload
+asset_loader_get_num_pending :: proc() -> u32 {
+	return u32(len(INTERNAL.requests))
+}
+
+//---------------------------------------------------------------------------//
+
+// Starts loading an asset, the read proc is given p_load_data_size bytes of zeroed load data.
+// When p_data_file_path is set, the file is read asynchronously before the read job starts.
+@(private)
+asset_loader_start :: proc(
+	p_type: AssetType,
+	p_name: common.Name,
+	p_asset_ref: u32,
+	p_load_data_size: int,
+	p_arena_size: u32,
+	p_read_proc: AssetLoadReadProc,
+	p_step_proc: AssetLoadStepProc,
+	p_data_file_path: string,
+	p_callback: AssetLoadCallback,
+	p_user_data: rawptr,
+) {
+	request := new(AssetLoadRequest, G_ALLOCATORS.main_allocator)
+	request^ = AssetLoadRequest {
+		type      = p_type,
+		name      = p_name,
+		asset_ref = p_asset_ref,
+		read_proc = p_read_proc,
+		step_proc = p_step_proc,
+		callbacks = make([dynamic]AssetLoadCallbackEntry, G_ALLOCATORS.main_allocator),
+	}
+
+	common.arena_init(&request.arena, p_arena_size, G_ALLOCATORS.main_allocator)
+	load_data, _ := mem.alloc(p_load_data_size, 16, request.arena.allocator)
+	request.load_data = load_data
+
+	if p_callback != nil {
+		append(
+			&request.callbacks,
+			AssetLoadCallbackEntry{callback = p_callback, user_data = p_user_data, name = p_name},
+		)
+	}
+
+	append(&INTERNAL.requests, request)
+
+	if len(p_data_file_path) > 0 {
+		request.is_reading_file = common.async_file_read_begin(
+			&request.file_read,
+			p_data_file_path,
+			G_ALLOCATORS.asset_allocator,
+		)
+		if request.is_reading_file {
+			return
+		}
+	}
+
+	asset_loader_start_read_job(request)
+}
+
+//---------------------------------------------------------------------------//
+
+// Called when an asset that's already loaded or being loaded is requested again
+@(private)
+asset_loader_add_callback :: proc(
+	p_type: AssetType,
+	p_name: common.Name,
+	p_load_state: AssetLoadState,
+	p_callback: AssetLoadCallback,
+	p_user_data: rawptr,
+) {
+	if p_callback == nil {
+		return
+	}
+
+	callback_entry := AssetLoadCallbackEntry {
+		callback  = p_callback,
+		user_data = p_user_data,
+		name      = p_name,
+		success   = p_load_state == .Loaded,
+	}
+
+	// Assets that are loaded, but still wait for their upload have a request as well
+	request := asset_loader_find_request(p_type, p_name)
+	if request != nil {
+		append(&request.callbacks, callback_entry)
+		return
+	}
+
+	append(&INTERNAL.pending_callbacks, callback_entry)
+}
+
+//---------------------------------------------------------------------------//
+
+// Finishes the load of an asset that was started with one of the *_asset_load_async procs,
+// used when the asset is needed right away. Returns once the asset isn't .Loading anymore.
+@(private)
+asset_loader_wait :: proc(p_load_state: ^AssetLoadState) {
+	assert(INTERNAL.is_updating == false, "Can't wait for an asset while the loads are updated")
+
+	for p_load_state^ == .Loading {
+		// The calling thread helps with the reads while waiting
+		is_reading_files := false
+		for request in INTERNAL.requests {
+			if request.is_reading_file {
+				is_reading_files = true
+				continue
+			}
+			common.jobs_wait(&request.read_counter)
+		}
+		if is_reading_files {
+			common.async_file_io_poll(true)
+		}
+		asset_loader_update()
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+// Faults in the pages of mapped data, so that the main thread doesn't wait for the disk
+// when the data is copied to the staging buffer
+@(private)
+asset_loader_prefetch :: proc(p_data: []byte) {
+	sum := u8(0)
+	for offset := 0; offset < len(p_data); offset += ASSET_LOADER_PREFETCH_STRIDE {
+		sum += p_data[offset]
+	}
+	sync.atomic_store(&INTERNAL.prefetch_sink, sum)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+asset_loader_start_read_job :: proc(p_request: ^AssetLoadRequest) {
+	read_jobs := []common.Job{{procedure = asset_loader_read_job, user_data = p_request}}
+	common.jobs_run(read_jobs, &p_request.read_counter)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+asset_loader_read_job :: proc(p_user_data: rawptr) {
+	request := (^AssetLoadRequest)(p_user_data)
+	request.read_success = request.read_proc(request)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+asset_loader_find_request :: proc(p_type: AssetType, p_name: common.Name) -> ^AssetLoadRequest {
+	for request in INTERNAL.requests {
+		if request.type == p_type && request.name == p_name {
+			return request
+		}
+	}
+	return nil
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+asset_loader_request_destroy :: proc(p_request: ^AssetLoadRequest) {
+	common.arena_delete(p_request.arena)
+	delete(p_request.callbacks)
+	free(p_request, G_ALLOCATORS.main_allocator)
+}
+
+//---------------------------------------------------------------------------//
@@ -0,0 +1,623 @@
+package engine
+
+//---------------------------------------------------------------------------//
+
+// Cooked asset pack - all of the assets in a single file, so that loading them takes a lookup in
+// a table and a single file mapping, instead of opening and parsing the metadata, properties and
+// data files of every asset. Layout of the file:
+// - AssetPackHeader,
+// - table of contents - AssetPackEntry per asset, sorted by the type and the name of the asset,
+// - string table - names of the assets and the names they reference, registered on mount,
+// - metadata and payload of each asset. Metadata is stored as a fixed layout binary struct
+//   defined by the asset type, payloads are aligned to 4 KB, so they can be used in place.
+
+//---------------------------------------------------------------------------//
+
+import "core:encoding/json"
+import "core:log"
+import "core:mem"
+import "core:os"
+import "core:path/filepath"
+import "core:slice"
+import "core:strings"
+import "core:time"
+
+import "../common"
+
+//---------------------------------------------------------------------------//
+
+G_ASSET_PACK_PATH :: "app_data/engine/assets/assets.pack"
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+ASSET_PACK_MAGIC :: 0x4B41504E // NPAK
+@(private = "file")
+ASSET_PACK_VERSION :: 1
+@(private = "file")
+ASSET_PACK_PAYLOAD_ALIGNMENT :: 4 * common.KILOBYTE
+@(private = "file")
+ASSET_PACK_METADATA_ALIGNMENT :: 16
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+AssetPackHeader :: struct {
+	magic:               u32,
+	version:             u32,
+	num_entries:         u32,
+	string_table_size:   u32,
+	toc_offset:          u64,
+	string_table_offset: u64,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+AssetPackEntry :: struct {
+	uuid:            UUID,
+	name:            common.Name,
+	type:            u32,
+	// Offset of the name in the string table
+	name_offset:     u32,
+	metadata_size:   u32,
+	metadata_offset: u64,
+	payload_offset:  u64,
+	payload_size:    u64,
+}
+
+//---------------------------------------------------------------------------//
+
+// Strings are stored as their length followed by the characters, padded to 4 bytes
+@(private = "file")
+AssetPackString :: struct {
+	length: u32,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+AssetPackBuilder :: struct {
+	entries:        [dynamic]AssetPackBuilderEntry,
+	string_table:   [dynamic]byte,
+	string_offsets: map[string]u32,
+	allocator:      mem.Allocator,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+AssetPackBuilderEntry :: struct {
+	entry:        AssetPackEntry,
+	metadata:     []byte,
+	payload_path: string,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+INTERNAL: struct {
+	mounted:      bool,
+	file_mapping: common.FileMemoryMapping,
+	data:         []byte,
+	entries:      []AssetPackEntry,
+}
+
+//---------------------------------------------------------------------------//
+
+// Makes the loaders read the assets that are in the pack from it, the assets that
+// aren't in the pack are still loaded from their own files
+asset_pack_mount :: proc(p_pack_path: string) -> bool {
+	assert(INTERNAL.mounted == false)
+
+	// The assets are read in any order, so only ask for huge pages, the payloads
+	// are prefetched one by one when they're loaded
+	file_mapping, mapping_ok := common.mmap_file(p_pack_path, {.HugePages})
+	if mapping_ok == false {
+		log.warnf("Failed to mount asset pack '%s' - couldn't mmap file\n", p_pack_path)
+		return false
+	}
+
+	data := slice.from_ptr((^byte)(file_mapping.mapped_ptr), file_mapping.size)
+
+	if len(data) < size_of(AssetPackHeader) {
+		log.warnf("Failed to mount asset pack '%s' - invalid header\n", p_pack_path)
+		common.unmap_file(file_mapping)
+		return false
+	}
+
+	header := (^AssetPackHeader)(raw_data(data))
+	toc_size := u64(header.num_entries) * size_of(AssetPackEntry)
+	if header.magic != ASSET_PACK_MAGIC ||
+	   header.version != ASSET_PACK_VERSION ||
+	   header.toc_offset + toc_size > u64(len(data)) ||
+	   header.string_table_offset + u64(header.string_table_size) > u64(len(data)) {
+		log.warnf("Failed to mount asset pack '%s' - invalid header\n", p_pack_path)
+		common.unmap_file(file_mapping)
+		return false
+	}
+
+	INTERNAL.file_mapping = file_mapping
+	INTERNAL.data = data
+	INTERNAL.entries = common.slice_cast(
+		AssetPackEntry,
+		data,
+		u32(header.toc_offset),
+		header.num_entries,
+	)
+
+	// Register all of the names, so that the assets can be found by their names
+	string_table := data[header.string_table_offset:][:header.string_table_size]
+	for string_offset := 0; string_offset < len(string_table); {
+		str := asset_pack_read_string(string_table, u32(string_offset))
+		common.create_name(str)
+		string_offset += size_of(AssetPackString) + mem.align_forward_int(len(str), 4)
+	}
+
+	INTERNAL.mounted = true
+
+	log.infof("Mounted asset pack '%s' with %d assets\n", p_pack_path, header.num_entries)
+
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+// Assets loaded from the pack use it's memory directly,
+// so it can only be unmounted once all of them are unloaded
+asset_pack_unmount :: proc() {
+	if INTERNAL.mounted == false {
+		return
+	}
+	common.unmap_file(INTERNAL.file_mapping)
+	INTERNAL = {}
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+asset_pack_find :: proc(p_type: AssetType, p_name: common.Name) -> (^AssetPackEntry, bool) {
+	if INTERNAL.mounted == false {
+		return nil, false
+	}
+
+	idx, found := slice.binary_search_by(
+		INTERNAL.entries,
+		AssetPackEntry{type = u32(p_type), name = p_name},
+		asset_pack_entry_cmp,
+	)
+	if found == false {
+		return nil, false
+	}
+
+	return &INTERNAL.entries[idx], true
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+asset_pack_get_metadata :: proc(p_entry: ^AssetPackEntry) -> []byte {
+	return INTERNAL.data[p_entry.metadata_offset:][:p_entry.metadata_size]
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+asset_pack_get_payload :: proc(p_entry: ^AssetPackEntry) -> []byte {
+	return INTERNAL.data[p_entry.payload_offset:][:p_entry.payload_size]
+}
+
+//---------------------------------------------------------------------------//
+
+// Starts reading the payload in the background, so that it's in memory once it's used
+@(private)
+asset_pack_prefetch_payload :: proc(p_entry: ^AssetPackEntry) {
+	common.mmap_file_prefetch(
+		INTERNAL.file_mapping,
+		int(p_entry.payload_offset),
+		int(p_entry.payload_size),
+	)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+asset_pack_get_file_mapping :: proc() -> common.FileMemoryMapping {
+	return INTERNAL.file_mapping
+}
+
+//---------------------------------------------------------------------------//
+
+// Cooks all of the assets in the asset directories into a single pack
+asset_pack_build :: proc(p_pack_path: string) -> bool {
+	build_start := time.tick_now()
+
+	builder := AssetPackBuilder {
+		entries        = make([dynamic]AssetPackBuilderEntry, G_ALLOCATORS.main_allocator),
+		string_table   = make([dynamic]byte, G_ALLOCATORS.main_allocator),
+		string_offsets = make(map[string]u32, 64, G_ALLOCATORS.main_allocator),
+		allocator      = G_ALLOCATORS.main_allocator,
+	}
+	defer asset_pack_builder_destroy(&builder)
+
+	if texture_asset_cook(&builder) == false ||
+	   material_asset_cook(&builder) == false ||
+	   mesh_asset_cook(&builder) == false {
+		log.warnf("Failed to build asset pack '%s'\n", p_pack_path)
+		return false
+	}
+
+	if asset_pack_builder_write(&builder, p_pack_path) == false {
+		log.warnf("Failed to build asset pack '%s' - couldn't write the file\n", p_pack_path)
+		return false
+	}
+
+	log.infof(
+		"Built asset pack '%s' with %d assets in %.2f ms\n",
+		p_pack_path,
+		len(builder.entries),
+		time.duration_milliseconds(time.tick_since(build_start)),
+	)
+
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+// Adds an asset to the pack. The metadata is copied, the payload file,
+// if there's one, is read only when the pack is written.
+@(private)
+asset_pack_builder_add :: proc(
+	p_builder: ^AssetPackBuilder,
+	p_type: AssetType,
+	p_name: string,
+	p_uuid: UUID,
+	p_metadata: []byte,
+	p_payload_path: string = "",
+) -> bool {
+	payload_size := i64(0)
+	if len(p_payload_path) > 0 {
+		payload_size = os.file_size_from_path(p_payload_path)
+		if payload_size < 0 {
+			log.warnf("Failed to add '%s' to the asset pack - missing %s\n", p_name, p_payload_path)
+			return false
+		}
+	}
+
+	append(
+		&p_builder.entries,
+		AssetPackBuilderEntry {
+			entry = AssetPackEntry {
+				uuid = p_uuid,
+				name = common.create_name(p_name),
+				type = u32(p_type),
+				name_offset = asset_pack_builder_add_string(p_builder, p_name),
+				metadata_size = u32(len(p_metadata)),
+				payload_size = u64(payload_size),
+			},
+			metadata = slice.clone(p_metadata, p_builder.allocator),
+			payload_path = strings.clone(p_payload_path, p_builder.allocator),
+		},
+	)
+
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+// Adds a string to the string table, so that a name referenced
+// by the metadata gets registered when the pack is mounted
+@(private)
+asset_pack_builder_add_string :: proc(p_builder: ^AssetPackBuilder, p_string: string) -> u32 {
+	if offset, found := p_builder.string_offsets[p_string]; found {
+		return offset
+	}
+
+	offset := u32(len(p_builder.string_table))
+	length := AssetPackString {
+		length = u32(len(p_string)),
+	}
+	append(&p_builder.string_table, ..mem.ptr_to_bytes(&length))
+	append(&p_builder.string_table, p_string)
+	for len(p_builder.string_table) % 4 != 0 {
+		append(&p_builder.string_table, 0)
+	}
+
+	p_builder.string_offsets[strings.clone(p_string, p_builder.allocator)] = offset
+	return offset
+}
+
+//---------------------------------------------------------------------------//
+
+// Returns the names of the assets in an asset directory, based on their metadata files
+@(private)
+asset_pack_collect_asset_names :: proc(p_assets_dir: string, p_allocator: mem.Allocator) -> []string {
+	metadata_paths, glob_err := filepath.glob(
+		filepath.join({p_assets_dir, "*.metadata"}, p_allocator),
+		p_allocator,
+	)
+	if glob_err != .None {
+		return nil
+	}
+
+	for metadata_path, i in metadata_paths {
+		metadata_paths[i] = filepath.short_stem(filepath.base(metadata_path))
+	}
+
+	return metadata_paths
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+asset_pack_builder_write :: proc(p_builder: ^AssetPackBuilder, p_pack_path: string) -> bool {
+	slice.sort_by_cmp(p_builder.entries[:], proc(a, b: AssetPackBuilderEntry) -> slice.Ordering {
+		return asset_pack_entry_cmp(a.entry, b.entry)
+	})
+
+	// Layout the file
+	header := AssetPackHeader {
+		magic             = ASSET_PACK_MAGIC,
+		version           = ASSET_PACK_VERSION,
+		num_entries       = u32(len(p_builder.entries)),
+		string_table_size = u32(len(p_builder.string_table)),
+		toc_offset        = size_of(AssetPackHeader),
+	}
+	header.string_table_offset =
+		header.toc_offset + u64(len(p_builder.entries)) * size_of(AssetPackEntry)
+
+	offset := header.string_table_offset + u64(header.string_table_size)
+	for &builder_entry in p_builder.entries {
+		entry := &builder_entry.entry
+
+		offset = u64(mem.align_forward_uint(uint(offset), ASSET_PACK_METADATA_ALIGNMENT))
+		entry.metadata_offset = offset
+		offset += u64(entry.metadata_size)
+
+		if entry.payload_size > 0 {
+			offset = u64(mem.align_forward_uint(uint(offset), ASSET_PACK_PAYLOAD_ALIGNMENT))
+			entry.payload_offset = offset
+			offset += entry.payload_size
+		}
+	}
+
+	fd, err := os.open(p_pack_path, os.O_WRONLY | os.O_CREATE | os.O_TRUNC)
+	if err != 0 {
+		return false
+	}
+	defer os.close(fd)
+
+	written := u64(0)
+
+	os.write_ptr(fd, &header, size_of(AssetPackHeader))
+	for &builder_entry in p_builder.entries {
+		os.write_ptr(fd, &builder_entry.entry, size_of(AssetPackEntry))
+	}
+	os.write(fd, p_builder.string_table[:])
+	written = header.string_table_offset + u64(header.string_table_size)
+
+	// Write the metadata and the payloads, padding them to their offsets
+	padding: [ASSET_PACK_PAYLOAD_ALIGNMENT]byte
+	for builder_entry in p_builder.entries {
+		entry := builder_entry.entry
+
+		os.write(fd, padding[:entry.metadata_offset - written])
+		os.write(fd, builder_entry.metadata)
+		written = entry.metadata_offset + u64(entry.metadata_size)
+
+		if entry.payload_size == 0 {
+			continue
+		}
+
+		payload, read_ok := os.read_entire_file(builder_entry.payload_path, p_builder.allocator)
+		if read_ok == false || u64(len(payload)) != entry.payload_size {
+			delete(payload, p_builder.allocator)
+			return false
+		}
+
+		os.write(fd, padding[:entry.payload_offset - written])
+		os.write(fd, payload)
+		written = entry.payload_offset + entry.payload_size
+
+		delete(payload, p_builder.allocator)
+	}
+
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+asset_pack_builder_destroy :: proc(p_builder: ^AssetPackBuilder) {
+	for builder_entry in p_builder.entries {
+		delete(builder_entry.metadata, p_builder.allocator)
+		delete(builder_entry.payload_path, p_builder.allocator)
+	}
+	for str in p_builder.string_offsets {
+		delete(str, p_builder.allocator)
+	}
+	delete(p_builder.entries)
+	delete(p_builder.string_table)
+	delete(p_builder.string_offsets)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+asset_pack_entry_cmp :: proc(p_a: AssetPackEntry, p_b: AssetPackEntry) -> slice.Ordering {
+	if p_a.type != p_b.type {
+		return p_a.type < p_b.type ? .Less : .Greater
+	}
+	if p_a.name != p_b.name {
+		return p_a.name < p_b.name ? .Less : .Greater
+	}
+	return .Equal
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+asset_pack_read_string :: proc(p_string_table: []byte, p_offset: u32) -> string {
+	length := (^AssetPackString)(&p_string_table[p_offset]).length
+	return string(p_string_table[p_offset + size_of(AssetPackString):][:length])
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+ASSET_PACK_BENCHMARK_WARM_ITERATIONS :: 5
+
+//---------------------------------------------------------------------------//
+
+// Compares the time it takes to read the metadata and the data of all of the assets in the pack
+// with reading them from their own files. The first pass over each is reported as the cold load,
+// it's only really cold when the files aren't in the file cache of the OS yet, e.g. after a reboot.
+asset_pack_run_benchmark :: proc() {
+	if os.exists(G_ASSET_PACK_PATH) == false {
+		log.warnf(
+			"Asset pack benchmark: '%s' doesn't exist, building it, so the cold results will be warm\n",
+			G_ASSET_PACK_PATH,
+		)
+		if asset_pack_build(G_ASSET_PACK_PATH) == false {
+			return
+		}
+	}
+
+	cold_pack_duration, pack_checksum, pack_ok := asset_pack_benchmark_read_pack()
+	if pack_ok == false {
+		return
+	}
+
+	// The list of the assets comes from the pack
+	if asset_pack_mount(G_ASSET_PACK_PATH) == false {
+		return
+	}
+	entries := slice.clone(INTERNAL.entries, G_ALLOCATORS.main_allocator)
+	defer delete(entries, G_ALLOCATORS.main_allocator)
+	asset_pack_unmount()
+
+	cold_loose_duration, loose_checksum := asset_pack_benchmark_read_loose_files(entries)
+
+	warm_pack_duration: time.Duration
+	warm_loose_duration: time.Duration
+	for _ in 0 ..< ASSET_PACK_BENCHMARK_WARM_ITERATIONS {
+		pack_duration, _, _ := asset_pack_benchmark_read_pack()
+		loose_duration, _ := asset_pack_benchmark_read_loose_files(entries)
+		warm_pack_duration += pack_duration
+		warm_loose_duration += loose_duration
+	}
+
+	if pack_checksum != loose_checksum {
+		log.warnf("Asset pack benchmark: the pack doesn't match the asset files\n")
+	}
+
+	log.infof(
+		"Asset pack benchmark: %d assets - cold: %.2f ms loose files, %.2f ms pack, warm: %.2f ms loose files, %.2f ms pack\n",
+		len(entries),
+		time.duration_milliseconds(cold_loose_duration),
+		time.duration_milliseconds(cold_pack_duration),
+		time.duration_milliseconds(warm_loose_duration) / ASSET_PACK_BENCHMARK_WARM_ITERATIONS,
+		time.duration_milliseconds(warm_pack_duration) / ASSET_PACK_BENCHMARK_WARM_ITERATIONS,
+	)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+asset_pack_benchmark_read_pack :: proc() -> (time.Duration, u64, bool) {
+	start := time.tick_now()
+
+	if asset_pack_mount(G_ASSET_PACK_PATH) == false {
+		return 0, 0, false
+	}
+	defer asset_pack_unmount()
+
+	checksum := u64(0)
+	for entry in INTERNAL.entries {
+		found_entry, found := asset_pack_find(AssetType(entry.type), entry.name)
+		assert(found)
+		checksum += asset_pack_benchmark_touch_pages(asset_pack_get_payload(found_entry))
+	}
+
+	return time.tick_since(start), checksum, true
+}
+
+//---------------------------------------------------------------------------//
+
+// Reads the files of the assets the way the loaders do, parsing the JSON and mapping the data file
+@(private = "file")
+asset_pack_benchmark_read_loose_files :: proc(p_entries: []AssetPackEntry) -> (time.Duration, u64) {
+	start := time.tick_now()
+
+	checksum := u64(0)
+	for entry in p_entries {
+		temp_arena: common.Arena
+		common.temp_arena_init(&temp_arena, common.MEGABYTE)
+		defer common.arena_delete(temp_arena)
+
+		assets_dir: string
+		payload_extension: string
+		switch AssetType(entry.type) {
+		case .Texture:
+			assets_dir = G_TEXTURE_ASSETS_DIR
+			payload_extension = "dds"
+		case .Mesh:
+			assets_dir = G_MESH_ASSETS_DIR
+			payload_extension = "bin"
+		case .Material:
+			assets_dir = G_MATERIAL_ASSETS_DIR
+		}
+
+		json_paths := [2]string {
+			asset_create_path(assets_dir, entry.name, "metadata", temp_arena.allocator),
+			// Material properties
+			asset_create_path(assets_dir, entry.name, "json", temp_arena.allocator),
+		}
+		num_json_files := AssetType(entry.type) == .Material ? 2 : 1
+
+		for json_path in json_paths[:num_json_files] {
+			json_data, read_ok := os.read_entire_file(json_path, temp_arena.allocator)
+			if read_ok == false {
+				continue
+			}
+			_, _ = json.parse(json_data, .JSON5, true, temp_arena.allocator)
+		}
+
+		if len(payload_extension) == 0 {
+			continue
+		}
+
+		payload_path := asset_create_path(
+			assets_dir,
+			entry.name,
+			payload_extension,
+			temp_arena.allocator,
+		)
+		file_mapping, mapping_ok := common.mmap_file(payload_path)
+		if mapping_ok == false {
+			continue
+		}
+		payload := slice.from_ptr(
+			(^byte)(file_mapping.mapped_ptr),
+			int(os.file_size_from_path(payload_path)),
+		)
+		checksum += asset_pack_benchmark_touch_pages(payload)
+		common.unmap_file(file_mapping)
+	}
+
+	return time.tick_since(start), checksum
+}
+
+//---------------------------------------------------------------------------//
+
+// Reads a byte of every page, so that the whole file is actually read
+@(private = "file")
+asset_pack_benchmark_touch_pages :: proc(p_data: []byte) -> u64 {
+	checksum := u64(0)
+	for offset := 0; offset < len(p_data); offset += ASSET_PACK_PAYLOAD_ALIGNMENT {
+		checksum += u64(p_data[offset])
+	}
+	return checksum
+}
+
+//---------------------------------------------------------------------------//
@@ -4,6 +4,7 @@ package engine
 
 import "core:math/linalg/glsl"
 import "../common"
+import "../renderer"
 
 //---------------------------------------------------------------------------//
 
@@ -129,3 +130,27 @@ camera_add_speed :: proc(p_speed_delta: f32) {
 }
 
 //---------------------------------------------------------------------------//
+
+// Places the camera directly, used to play back scripted camera paths
+camera_set :: proc(p_position: glsl.vec3, p_yaw: f32, p_pitch: f32) {
+	using Camera
+	position = p_position
+	yaw = p_yaw
+	pitch = clamp(p_pitch, -89.0, 89.0)
+	velocity = {0, 0, 0}
+
+	camera_update_vectors()
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+camera_update_render_camera :: proc() {
+	renderer.g_render_camera.position = Camera.position
+	renderer.g_render_camera.forward = Camera.forward
+	renderer.g_render_camera.up = Camera.up
+	renderer.g_render_camera.fov = Camera.fov
+	renderer.g_render_camera.near_plane = Camera.near_plane
+}
+
+//---------------------------------------------------------------------------//
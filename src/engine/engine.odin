@@ -22,6 +22,9 @@ USE_VULKAN_BACKEND :: #config(USE_VULKAN_BACKEND, true)
 
 InitOptions :: struct {
 	window_width, window_height: u32,
+	// Doesn't create a window, the renderer draws into offscreen images of the window's size.
+	// Used together with run_headless.
+	headless:                    bool,
 }
 
 //---------------------------------------------------------------------------//
@@ -58,36 +61,48 @@ init :: proc(p_options: InitOptions) -> bool {
 	mem_init(MemoryInitOptions{total_available_memory = 64 * common.MEGABYTE})
 
 	common.init_names(G_ALLOCATORS.string_allocator)
+	common.profiler_init(G_ALLOCATORS.main_allocator)
+
+	if common.jobs_init({}, G_ALLOCATORS.main_allocator) == false {
+		log.error("Failed to init the job system")
+		return false
+	}
 
 	// Initialize assets
+	asset_loader_init()
 	texture_asset_init()
 	material_asset_init()
 	mesh_asset_init()
 
-	// Initialize SDL2
-	if sdl.Init(sdl.INIT_VIDEO) != 0 {
-		return false
-	}
+	if p_options.headless == false {
+		// Initialize SDL2
+		if sdl.Init(sdl.INIT_VIDEO) != 0 {
+			return false
+		}
 
-	// Create window
-	G_ENGINE.window = sdl.CreateWindow(
-		"neat",
-		sdl.WINDOWPOS_CENTERED,
-		sdl.WINDOWPOS_CENTERED,
-		i32(p_options.window_width),
-		i32(p_options.window_height),
-		{.VULKAN, .RESIZABLE},
-	)
-
-	if G_ENGINE.window == nil {
-		return false
-	}
+		// Create window
+		G_ENGINE.window = sdl.CreateWindow(
+			"neat",
+			sdl.WINDOWPOS_CENTERED,
+			sdl.WINDOWPOS_CENTERED,
+			i32(p_options.window_width),
+			i32(p_options.window_height),
+			{.VULKAN, .RESIZABLE},
+		)
+
+		if G_ENGINE.window == nil {
+			return false
+		}
 
-	sdl.GetMouseState(&INTERNAL.last_frame_mouse_pos.x, &INTERNAL.last_frame_mouse_pos.x)
+		sdl.GetMouseState(&INTERNAL.last_frame_mouse_pos.x, &INTERNAL.last_frame_mouse_pos.x)
+	}
 
 	//Init renderer
 	{
-		renderer_init_options := renderer.InitOptions{}
+		renderer_init_options := renderer.InitOptions {
+			headless            = p_options.headless,
+			headless_resolution = {p_options.window_width, p_options.window_height},
+		}
 
 		when USE_VULKAN_BACKEND {
 			renderer_init_options.window = G_ENGINE.window
@@ -120,6 +135,9 @@ run :: proc() {
 
 		context.logger = G_ENGINE_LOG
 
+		common.profiler_begin_frame()
+		common.profiler_scope("Frame")
+
 		current_time := time.now()
 		accumulated_dt += f32(time.duration_seconds(time.diff(last_frame_time, current_time)))
 		last_frame_time = current_time
@@ -180,12 +198,9 @@ run :: proc() {
 			accumulated_dt -= target_dt
 		}
 
-		// Update renderer camera
-		renderer.g_render_camera.position = Camera.position
-		renderer.g_render_camera.forward = Camera.forward
-		renderer.g_render_camera.up = Camera.up
-		renderer.g_render_camera.fov = Camera.fov
-		renderer.g_render_camera.near_plane = Camera.near_plane
+		camera_update_render_camera()
+
+		asset_loader_update()
 
 		renderer.update(target_dt)
 
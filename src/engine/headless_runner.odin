@@ -0,0 +1,178 @@
+package engine
+
+//---------------------------------------------------------------------------//
+
+import "core:fmt"
+import "core:log"
+import "core:math/linalg/glsl"
+import "core:os"
+import "core:slice"
+import "core:strings"
+import "core:time"
+
+import "../common"
+import "../renderer"
+
+//---------------------------------------------------------------------------//
+
+// Camera placement at a point of the scripted path, the camera is linearly interpolated
+// between the keys, which are spread evenly over the recorded frames
+HeadlessCameraKey :: struct {
+	position: glsl.vec3,
+	yaw:      f32,
+	pitch:    f32,
+}
+
+//---------------------------------------------------------------------------//
+
+HeadlessRunOptions :: struct {
+	// Number of the frames that are timed
+	num_frames:        u32,
+	// Frames rendered before the timed ones, so that the caches and TAA history settle
+	num_warmup_frames: u32,
+	camera_path:       []HeadlessCameraKey,
+	// CSV file the per frame CPU timings are written to, skipped when empty
+	timings_path:      string,
+	// PNG file the SceneSDR image is saved to after the last frame, skipped when empty
+	scene_dump_path:   string,
+}
+
+//---------------------------------------------------------------------------//
+
+// Upper limit of the frames spent waiting for the assets to load before the warmup starts
+@(private = "file")
+HEADLESS_MAX_ASSET_LOAD_FRAMES :: 10000
+
+//---------------------------------------------------------------------------//
+
+// Renders a fixed number of frames along a scripted camera path and reports the CPU frame
+// times. Meant for benchmarking, the engine has to be initialized with InitOptions.headless.
+// Uses a fixed time step, so consecutive runs render the exact same frames.
+run_headless :: proc(p_options: HeadlessRunOptions) -> bool {
+
+	context.logger = G_ENGINE_LOG
+
+	if len(p_options.camera_path) == 0 || p_options.num_frames == 0 {
+		log.error("Headless run needs a camera path and at least one frame\n")
+		return false
+	}
+
+	target_dt: f32 = 1.0 / 60.0
+
+	// Wait for the asset loads that were started before the run
+	for i := 0; asset_loader_get_num_pending() > 0; i += 1 {
+		if i == HEADLESS_MAX_ASSET_LOAD_FRAMES {
+			log.errorf(
+				"Headless run: %d assets still loading after %d frames\n",
+				asset_loader_get_num_pending(),
+				HEADLESS_MAX_ASSET_LOAD_FRAMES,
+			)
+			return false
+		}
+		headless_run_frame(p_options.camera_path, 0, target_dt)
+	}
+
+	for _ in 0 ..< p_options.num_warmup_frames {
+		headless_run_frame(p_options.camera_path, 0, target_dt)
+	}
+
+	frame_times := make([]f64, p_options.num_frames, G_ALLOCATORS.main_allocator)
+	defer delete(frame_times, G_ALLOCATORS.main_allocator)
+
+	for frame_idx in 0 ..< p_options.num_frames {
+		path_t := f32(frame_idx) / f32(max(p_options.num_frames - 1, 1))
+
+		frame_start := time.tick_now()
+		headless_run_frame(p_options.camera_path, path_t, target_dt)
+		frame_times[frame_idx] = time.duration_milliseconds(time.tick_since(frame_start))
+	}
+
+	if len(p_options.timings_path) > 0 {
+		headless_write_timings(p_options.timings_path, frame_times)
+	}
+
+	total_time: f64 = 0
+	for frame_time in frame_times {
+		total_time += frame_time
+	}
+
+	sorted_frame_times := slice.clone(frame_times, G_ALLOCATORS.main_allocator)
+	defer delete(sorted_frame_times, G_ALLOCATORS.main_allocator)
+	slice.sort(sorted_frame_times)
+
+	p95_idx := min(len(sorted_frame_times) * 95 / 100, len(sorted_frame_times) - 1)
+
+	log.infof(
+		"Headless run: %d frames - avg: %.3f ms, min: %.3f ms, max: %.3f ms, p95: %.3f ms\n",
+		p_options.num_frames,
+		total_time / f64(p_options.num_frames),
+		sorted_frame_times[0],
+		sorted_frame_times[len(sorted_frame_times) - 1],
+		sorted_frame_times[p95_idx],
+	)
+
+	if len(p_options.scene_dump_path) > 0 {
+		scene_sdr_ref := renderer.image_find("SceneSDR")
+		if scene_sdr_ref == renderer.InvalidImageRef {
+			log.error("Headless run: SceneSDR image not found\n")
+			return false
+		}
+		renderer.image_write_to_png(scene_sdr_ref, p_options.scene_dump_path) or_return
+	}
+
+	// Fails the run, so that the validation errors can't go unnoticed on CI
+	num_validation_errors := renderer.get_num_validation_errors()
+	if num_validation_errors > 0 {
+		log.errorf("Headless run: %d Vulkan validation errors\n", num_validation_errors)
+		return false
+	}
+
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+headless_run_frame :: proc(p_camera_path: []HeadlessCameraKey, p_path_t: f32, p_dt: f32) {
+	common.profiler_begin_frame()
+	common.profiler_scope("Frame")
+
+	// Find the keys surrounding the point on the path
+	key_pos := p_path_t * f32(len(p_camera_path) - 1)
+	key_idx := min(int(key_pos), len(p_camera_path) - 1)
+	next_key_idx := min(key_idx + 1, len(p_camera_path) - 1)
+	key_t := key_pos - f32(key_idx)
+
+	key := p_camera_path[key_idx]
+	next_key := p_camera_path[next_key_idx]
+
+	camera_set(
+		glsl.lerp(key.position, next_key.position, glsl.vec3(key_t)),
+		glsl.lerp(key.yaw, next_key.yaw, key_t),
+		glsl.lerp(key.pitch, next_key.pitch, key_t),
+	)
+	camera_update_render_camera()
+
+	asset_loader_update()
+
+	renderer.update(p_dt)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+headless_write_timings :: proc(p_file_path: string, p_frame_times: []f64) {
+	csv := strings.builder_make(G_ALLOCATORS.main_allocator)
+	defer strings.builder_destroy(&csv)
+
+	strings.write_string(&csv, "frame,cpu_ms\n")
+	for frame_time, i in p_frame_times {
+		fmt.sbprintf(&csv, "%d,%.4f\n", i, frame_time)
+	}
+
+	if os.write_entire_file(p_file_path, csv.buf[:]) == false {
+		log.warnf("Headless run: failed to write the timings to '%s'\n", p_file_path)
+	}
+}
+
+//---------------------------------------------------------------------------//
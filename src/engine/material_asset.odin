@@ -6,6 +6,7 @@ import "core:c"
 import "core:encoding/json"
 import "core:log"
 import "core:math/linalg/glsl"
+import "core:mem"
 import "core:os"
 import "core:path/filepath"
 import "core:strings"
@@ -25,7 +26,7 @@ G_MATERIAL_DB_PATH :: "app_data/engine/assets/materials/db.json"
 
 //---------------------------------------------------------------------------//
 
-@(private = "file")
+@(private)
 G_MATERIAL_ASSETS_DIR :: "app_data/engine/assets/materials/"
 
 //---------------------------------------------------------------------------//
@@ -49,6 +50,18 @@ INTERNAL: struct {
 
 //---------------------------------------------------------------------------//
 
+// State of a single material save, so that multiple materials can be written in parallel
+@(private = "file")
+MaterialSaveTask :: struct {
+	metadata:           MaterialAssetMetadata,
+	material_name:      string,
+	material_file_name: string,
+	properties:         ^MaterialPropertiesAssetJSON,
+	success:            bool,
+}
+
+//---------------------------------------------------------------------------//
+
 @(private)
 MaterialPropertiesAssetJSON :: struct {
 	flags:                u32,
@@ -73,12 +86,51 @@ MaterialAssetMetadata :: struct {
 
 //---------------------------------------------------------------------------//
 
+// Metadata and properties of a material in the asset pack, the image names are
+// registered when the pack is mounted, EMPTY_NAME when the material doesn't use the image
+@(private = "file")
+MaterialAssetPackMetadata :: struct {
+	metadata:             MaterialAssetMetadata,
+	flags:                u32,
+	albedo:               glsl.vec3,
+	normal:               glsl.vec3,
+	roughness:            f32,
+	metalness:            f32,
+	occlusion:            f32,
+	albedo_image_name:    common.Name,
+	normal_image_name:    common.Name,
+	roughness_image_name: common.Name,
+	metalness_image_name: common.Name,
+	occlusion_image_name: common.Name,
+}
+
+//---------------------------------------------------------------------------//
+
 MaterialAsset :: struct {
 	using metadata:        MaterialAssetMetadata,
 	material_instance_ref: renderer.MaterialInstanceRef,
 	flags:                 u32,
 	ref_count:             u32,
 	texture_asset_refs:    [dynamic]TextureAssetRef,
+	load_state:            AssetLoadState,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+MaterialLoadData :: struct {
+	metadata: MaterialAssetMetadata,
+	props:    MaterialPropertiesAssetJSON,
+}
+
+//---------------------------------------------------------------------------//
+
+// Image of a material that's loaded asynchronously, the image is set once the texture is loaded
+@(private = "file")
+MaterialImageLoad :: struct {
+	material_asset_ref: MaterialAssetRef,
+	texture_asset_ref:  TextureAssetRef,
+	image_flag:         renderer.MaterialPropertiesFlagBits,
 }
 
 //---------------------------------------------------------------------------//
@@ -228,7 +280,16 @@ material_asset_load :: proc(p_name: common.Name) -> MaterialAssetRef {
 	// Check if it's already loaded
 	loaded_material_asset_ref := common.ref_find_by_name(&G_MATERIAL_ASSET_REF_ARRAY, p_name)
 	if loaded_material_asset_ref != InvalidMaterialAssetRef {
-		material_asset_get(loaded_material_asset_ref).ref_count += 1
+		material_asset := material_asset_get(loaded_material_asset_ref)
+		material_asset.ref_count += 1
+
+		// Finish the async load, as the material is needed right away
+		asset_loader_wait(&material_asset.load_state)
+		if material_asset.load_state == .Failed {
+			material_asset_unload(loaded_material_asset_ref)
+			return InvalidMaterialAssetRef
+		}
+
 		return loaded_material_asset_ref
 	}
 
@@ -236,52 +297,173 @@ material_asset_load :: proc(p_name: common.Name) -> MaterialAssetRef {
 	common.temp_arena_init(&temp_arena, common.MEGABYTE)
 	defer common.arena_delete(temp_arena)
 
-	material_name := common.get_string(p_name)
+	load_data: MaterialLoadData
+	if material_load_data_read(p_name, &load_data, temp_arena.allocator) == false {
+		return InvalidMaterialAssetRef
+	}
 
-	// Load  metadata
-	material_metadata: MaterialAssetMetadata
-	{
-		material_metadata_file_path := common.aprintf(
-			temp_arena.allocator,
-			"%s%s.metadata",
-			G_MATERIAL_ASSETS_DIR,
-			material_name,
-		)
-		material_metadata_json, success := os.read_entire_file(
-			material_metadata_file_path,
-			temp_arena.allocator,
-		)
-		if !success {
-			log.warnf("Failed to load material '%s' - couldn't load metadata\n", material_name)
-			return InvalidMaterialAssetRef
-		}
-		err := json.unmarshal(
-			material_metadata_json,
-			&material_metadata,
-			.JSON5,
-			temp_arena.allocator,
+	material_asset_ref := allocate_material_asset_ref(p_name)
+	if material_asset_create_from_load_data(material_asset_ref, &load_data, false) == false {
+		common.ref_free(&G_MATERIAL_ASSET_REF_ARRAY, material_asset_ref)
+		return InvalidMaterialAssetRef
+	}
+
+	material_asset := material_asset_get(material_asset_ref)
+	material_asset.ref_count = 1
+	material_asset.load_state = .Loaded
+
+	return material_asset_ref
+}
+
+//---------------------------------------------------------------------------//
+
+// Returns right away, the material can be used once it's load state is .Loaded.
+// The textures of the material are loaded asynchronously as well, the material is
+// .Loaded before them and each image is set once it's texture is loaded.
+material_asset_load_async :: proc(
+	p_name: common.Name,
+	p_callback: AssetLoadCallback = nil,
+	p_user_data: rawptr = nil,
+) -> MaterialAssetRef {
+	loaded_material_asset_ref := common.ref_find_by_name(&G_MATERIAL_ASSET_REF_ARRAY, p_name)
+	if loaded_material_asset_ref != InvalidMaterialAssetRef {
+		material_asset := material_asset_get(loaded_material_asset_ref)
+		material_asset.ref_count += 1
+		asset_loader_add_callback(
+			.Material,
+			p_name,
+			material_asset.load_state,
+			p_callback,
+			p_user_data,
 		)
-		if err != nil {
-			log.warnf("Failed to load material '%s' - couldn't read metadata\n", material_name)
-			return InvalidMaterialAssetRef
+		return loaded_material_asset_ref
+	}
+
+	material_asset_ref := allocate_material_asset_ref(p_name)
+	material_asset := material_asset_get(material_asset_ref)
+	material_asset.ref_count = 1
+	material_asset.load_state = .Loading
+	material_asset.material_instance_ref = renderer.InvalidMaterialInstanceRef
+	material_asset.texture_asset_refs = nil
+
+	asset_loader_start(
+		.Material,
+		p_name,
+		material_asset_ref.ref,
+		size_of(MaterialLoadData),
+		common.MEGABYTE,
+		material_load_request_read,
+		material_load_request_step,
+		"",
+		p_callback,
+		p_user_data,
+	)
+
+	return material_asset_ref
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+material_load_request_read :: proc(p_request: ^AssetLoadRequest) -> bool {
+	return material_load_data_read(
+		p_request.name,
+		(^MaterialLoadData)(p_request.load_data),
+		p_request.arena.allocator,
+	)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+material_load_request_step :: proc(p_request: ^AssetLoadRequest) -> AssetLoadStepResult {
+	material_asset_ref := MaterialAssetRef {
+		ref = p_request.asset_ref,
+	}
+	material_asset := material_asset_get(material_asset_ref)
+
+	// Unloaded while it was loading
+	if material_asset.ref_count == 0 {
+		common.ref_free(&G_MATERIAL_ASSET_REF_ARRAY, material_asset_ref)
+		return .Failed
+	}
+
+	if p_request.read_success == false ||
+	   material_asset_create_from_load_data(
+			   material_asset_ref,
+			   (^MaterialLoadData)(p_request.load_data),
+			   true,
+		   ) ==
+		   false {
+		material_asset.load_state = .Failed
+		return .Failed
+	}
+
+	material_asset.load_state = .Loaded
+	return .Done
+}
+
+//---------------------------------------------------------------------------//
+
+// Loads the metadata and the properties, from the asset pack if the material is in it.
+// Safe to run on any thread.
+@(private = "file")
+material_load_data_read :: proc(
+	p_name: common.Name,
+	p_load_data: ^MaterialLoadData,
+	p_allocator: mem.Allocator,
+) -> bool {
+	material_name := common.get_string(p_name)
+
+	pack_entry, in_pack := asset_pack_find(.Material, p_name)
+	if in_pack {
+		pack_metadata := asset_pack_get_metadata(pack_entry)
+		if len(pack_metadata) != size_of(MaterialAssetPackMetadata) {
+			log.warnf(
+				"Failed to load material '%s' - invalid metadata in the asset pack\n",
+				material_name,
+			)
+			return false
 		}
+		material_pack_metadata := (^MaterialAssetPackMetadata)(raw_data(pack_metadata))
+		p_load_data.metadata = material_pack_metadata.metadata
+		p_load_data.props = material_pack_metadata_get_properties(material_pack_metadata)
+		return true
 	}
 
-	material_type_ref := renderer.material_type_find(material_metadata.material_type_name)
+	if material_read_metadata(material_name, &p_load_data.metadata, p_allocator) == false {
+		return false
+	}
+	return material_read_properties(material_name, &p_load_data.props, p_allocator)
+}
+
+//---------------------------------------------------------------------------//
+
+// Creates the material instance, has to run on the main thread
+@(private = "file")
+material_asset_create_from_load_data :: proc(
+	p_material_asset_ref: MaterialAssetRef,
+	p_load_data: ^MaterialLoadData,
+	p_load_textures_async: bool,
+) -> bool {
+	material_asset := material_asset_get(p_material_asset_ref)
+	material_name := common.get_string(material_asset.name)
+
+	material_type_ref := renderer.material_type_find(p_load_data.metadata.material_type_name)
 	if material_type_ref == renderer.InvalidMaterialTypeRef {
 		log.warn(
 			"Failed to load material '%s' - unsupported material type '%s'",
 			material_name,
-			common.get_string(material_metadata.material_type_name),
+			common.get_string(p_load_data.metadata.material_type_name),
 		)
-		return InvalidMaterialAssetRef
+		return false
 	}
 
-	material_asset_ref := allocate_material_asset_ref(p_name)
-	material_asset := material_asset_get(material_asset_ref)
+	material_asset.uuid = p_load_data.metadata.uuid
+	material_asset.material_type_name = p_load_data.metadata.material_type_name
 
 	// Create a material instance for this material asset
-	material_asset.material_instance_ref = renderer.material_instance_allocate(p_name)
+	material_asset.material_instance_ref = renderer.material_instance_allocate(material_asset.name)
 	material_instance_idx := renderer.material_instance_get_idx(
 		material_asset.material_instance_ref,
 	)
@@ -295,39 +477,19 @@ material_asset_load :: proc(p_name: common.Name) -> MaterialAssetRef {
 		G_ALLOCATORS.asset_allocator,
 	)
 
-	// Load the material properties
-	material_asset_path := asset_create_path(
-		G_MATERIAL_ASSETS_DIR,
-		p_name,
-		"json",
-		temp_arena.allocator,
-	)
-	material_data, success := os.read_entire_file(material_asset_path, temp_arena.allocator)
-
-	if success == false {
-		common.ref_free(&G_MATERIAL_ASSET_REF_ARRAY, material_asset_ref)
-		renderer.material_instance_destroy(material_asset.material_instance_ref)
-		return InvalidMaterialAssetRef
-	}
-
-	load_success := material_asset_load_properties(
-		material_asset_ref,
-		material_data,
-		material_asset.material_instance_ref,
+	// Apply the material properties
+	material_asset_load_properties(
+		p_material_asset_ref,
+		p_load_data.props,
 		renderer.material_instance_get_properties_ptr(
 			material_asset.material_instance_ref,
 		),
+		p_load_textures_async,
 	)
-	if load_success == false {
-		return InvalidMaterialAssetRef
-	}
 
-	material_asset.ref_count = 1
-
-	return material_asset_ref
+	return true
 }
 
-
 //---------------------------------------------------------------------------//
 
 @(private = "file")
@@ -393,137 +555,439 @@ material_asset_save_properties :: proc(
 @(private = "file")
 material_asset_load_properties :: proc(
 	p_material_asset_ref: MaterialAssetRef,
-	p_material_properties_data: []byte,
-	p_material_instance_ref: renderer.MaterialInstanceRef,
+	p_material_props: MaterialPropertiesAssetJSON,
 	p_material_properties: ^renderer.MaterialProperties,
-) -> bool {
-
-	temp_arena: common.Arena
-	common.temp_arena_init(&temp_arena)
-	defer common.arena_delete(temp_arena)
-
-	material_props: MaterialPropertiesAssetJSON
-
-	material_asset := material_asset_get(p_material_asset_ref)
-
-	error := json.unmarshal(
-		p_material_properties_data,
-		&material_props,
-		.JSON5,
-		temp_arena.allocator,
-	)
-	if error != nil {
-		return false
-	}
-
-	p_material_properties.flags = transmute(renderer.MaterialPropertiesFlags)material_props.flags
-	p_material_properties.albedo = material_props.albedo
-	p_material_properties.normal = material_props.normal
-	p_material_properties.roughness = material_props.roughness
-	p_material_properties.metalness = material_props.metalness
-	p_material_properties.occlusion = material_props.occlusion
+	p_load_textures_async: bool,
+) {
+	p_material_properties.flags = transmute(renderer.MaterialPropertiesFlags)p_material_props.flags
+	p_material_properties.albedo = p_material_props.albedo
+	p_material_properties.normal = p_material_props.normal
+	p_material_properties.roughness = p_material_props.roughness
+	p_material_properties.metalness = p_material_props.metalness
+	p_material_properties.occlusion = p_material_props.occlusion
 
 	if .HasAlbedoImage in p_material_properties.flags {
-		material_asset_set_image_by_name(
-			&p_material_properties.albedo_image_id,
-			material_props.albedo_image_name,
-			&material_asset.texture_asset_refs,
+		material_asset_set_image(
+			p_material_asset_ref,
+			p_material_properties,
+			.HasAlbedoImage,
+			p_material_props.albedo_image_name,
+			p_load_textures_async,
 		)
 	}
 	if .HasNormalImage in p_material_properties.flags {
-		material_asset_set_image_by_name(
-			&p_material_properties.normal_image_id,
-			material_props.normal_image_name,
-			&material_asset.texture_asset_refs,
+		material_asset_set_image(
+			p_material_asset_ref,
+			p_material_properties,
+			.HasNormalImage,
+			p_material_props.normal_image_name,
+			p_load_textures_async,
 		)
 	}
 	if .HasRoughnessImage in p_material_properties.flags {
-		material_asset_set_image_by_name(
-			&p_material_properties.roughness_image_id,
-			material_props.roughness_image_name,
-			&material_asset.texture_asset_refs,
+		material_asset_set_image(
+			p_material_asset_ref,
+			p_material_properties,
+			.HasRoughnessImage,
+			p_material_props.roughness_image_name,
+			p_load_textures_async,
 		)
 	}
 	if .HasMetalnessImage in p_material_properties.flags {
-		material_asset_set_image_by_name(
-			&p_material_properties.metalness_image_id,
-			material_props.metalness_image_name,
-			&material_asset.texture_asset_refs,
+		material_asset_set_image(
+			p_material_asset_ref,
+			p_material_properties,
+			.HasMetalnessImage,
+			p_material_props.metalness_image_name,
+			p_load_textures_async,
 		)
 	}
 	if .HasOcclusionImage in p_material_properties.flags {
-		material_asset_set_image_by_name(
-			&p_material_properties.occlusion_image_id,
-			material_props.occlusion_image_name,
-			&material_asset.texture_asset_refs,
+		material_asset_set_image(
+			p_material_asset_ref,
+			p_material_properties,
+			.HasOcclusionImage,
+			p_material_props.occlusion_image_name,
+			p_load_textures_async,
 		)
 	}
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+material_read_metadata :: proc(
+	p_material_name: string,
+	p_metadata: ^MaterialAssetMetadata,
+	p_allocator: mem.Allocator,
+) -> bool {
+	material_metadata_file_path := common.aprintf(
+		p_allocator,
+		"%s%s.metadata",
+		G_MATERIAL_ASSETS_DIR,
+		p_material_name,
+	)
+	material_metadata_json, success := os.read_entire_file(
+		material_metadata_file_path,
+		p_allocator,
+	)
+	if !success {
+		log.warnf("Failed to load material '%s' - couldn't load metadata\n", p_material_name)
+		return false
+	}
+	err := json.unmarshal(material_metadata_json, p_metadata, .JSON5, p_allocator)
+	if err != nil {
+		log.warnf("Failed to load material '%s' - couldn't read metadata\n", p_material_name)
+		return false
+	}
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+material_read_properties :: proc(
+	p_material_name: string,
+	p_material_props: ^MaterialPropertiesAssetJSON,
+	p_allocator: mem.Allocator,
+) -> bool {
+	material_asset_path := asset_create_path(
+		G_MATERIAL_ASSETS_DIR,
+		common.create_name(p_material_name),
+		"json",
+		p_allocator,
+	)
+	material_data, success := os.read_entire_file(material_asset_path, p_allocator)
+	if !success {
+		log.warnf("Failed to load material '%s' - couldn't load properties\n", p_material_name)
+		return false
+	}
+	err := json.unmarshal(material_data, p_material_props, .JSON5, p_allocator)
+	if err != nil {
+		log.warnf("Failed to load material '%s' - couldn't read properties\n", p_material_name)
+		return false
+	}
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+// Adds all of the materials to the asset pack, they don't have a payload,
+// as the properties are stored with the metadata
+@(private)
+material_asset_cook :: proc(p_builder: ^AssetPackBuilder) -> bool {
+	temp_arena: common.Arena
+	common.temp_arena_init(&temp_arena, common.MEGABYTE)
+	defer common.arena_delete(temp_arena)
+
+	material_names := asset_pack_collect_asset_names(G_MATERIAL_ASSETS_DIR, temp_arena.allocator)
+	for material_name in material_names {
+		material_metadata: MaterialAssetMetadata
+		material_props: MaterialPropertiesAssetJSON
+		if material_read_metadata(material_name, &material_metadata, temp_arena.allocator) ==
+			   false ||
+		   material_read_properties(material_name, &material_props, temp_arena.allocator) ==
+			   false {
+			return false
+		}
+
+		pack_metadata := MaterialAssetPackMetadata {
+			metadata             = material_metadata,
+			flags                = material_props.flags,
+			albedo               = material_props.albedo,
+			normal               = material_props.normal,
+			roughness            = material_props.roughness,
+			metalness            = material_props.metalness,
+			occlusion            = material_props.occlusion,
+			albedo_image_name    = material_cook_image_name(
+				p_builder,
+				material_props.albedo_image_name,
+			),
+			normal_image_name    = material_cook_image_name(
+				p_builder,
+				material_props.normal_image_name,
+			),
+			roughness_image_name = material_cook_image_name(
+				p_builder,
+				material_props.roughness_image_name,
+			),
+			metalness_image_name = material_cook_image_name(
+				p_builder,
+				material_props.metalness_image_name,
+			),
+			occlusion_image_name = material_cook_image_name(
+				p_builder,
+				material_props.occlusion_image_name,
+			),
+		}
+
+		if asset_pack_builder_add(
+			   p_builder,
+			   .Material,
+			   material_name,
+			   material_metadata.uuid,
+			   mem.ptr_to_bytes(&pack_metadata),
+		   ) ==
+		   false {
+			return false
+		}
+	}
 
 	return true
 }
 
 //---------------------------------------------------------------------------//
 
+@(private = "file")
+material_cook_image_name :: proc(
+	p_builder: ^AssetPackBuilder,
+	p_image_name: string,
+) -> common.Name {
+	if len(p_image_name) == 0 {
+		return common.EMPTY_NAME
+	}
+	asset_pack_builder_add_string(p_builder, p_image_name)
+	return common.create_name(p_image_name)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+material_pack_metadata_get_properties :: proc(
+	p_pack_metadata: ^MaterialAssetPackMetadata,
+) -> MaterialPropertiesAssetJSON {
+	image_name_to_string :: proc(p_image_name: common.Name) -> string {
+		return "" if p_image_name == common.EMPTY_NAME else common.get_string(p_image_name)
+	}
+
+	return MaterialPropertiesAssetJSON {
+		flags = p_pack_metadata.flags,
+		albedo = p_pack_metadata.albedo,
+		normal = p_pack_metadata.normal,
+		roughness = p_pack_metadata.roughness,
+		metalness = p_pack_metadata.metalness,
+		occlusion = p_pack_metadata.occlusion,
+		albedo_image_name = image_name_to_string(p_pack_metadata.albedo_image_name),
+		normal_image_name = image_name_to_string(p_pack_metadata.normal_image_name),
+		roughness_image_name = image_name_to_string(p_pack_metadata.roughness_image_name),
+		metalness_image_name = image_name_to_string(p_pack_metadata.metalness_image_name),
+		occlusion_image_name = image_name_to_string(p_pack_metadata.occlusion_image_name),
+	}
+}
+
+//---------------------------------------------------------------------------//
+
 material_asset_save_new :: proc(
 	p_material_asset_ref: MaterialAssetRef,
 	p_material_properties: MaterialPropertiesAssetJSON,
 ) -> bool {
+	return material_asset_save_new_batch({p_material_asset_ref}, {p_material_properties})
+}
+
+//---------------------------------------------------------------------------//
+
+// Saves multiple new material assets, the files are written in parallel on the job system.
+// The material database is saved only once, after all of the materials are written.
+material_asset_save_new_batch :: proc(
+	p_material_asset_refs: []MaterialAssetRef,
+	p_material_properties: []MaterialPropertiesAssetJSON,
+) -> bool {
+	assert(len(p_material_asset_refs) == len(p_material_properties))
 
 	temp_arena: common.Arena
-	common.temp_arena_init(&temp_arena)
+	common.temp_arena_init(&temp_arena, common.MEGABYTE)
 	defer common.arena_delete(temp_arena)
 
-	material_asset := material_asset_get(p_material_asset_ref)
-	material_file_name := strings.concatenate(
-		{common.get_string(material_asset.name), ".json"},
-		temp_arena.allocator,
-	)
-	material_asset_path := filepath.join(
-		{G_MATERIAL_ASSETS_DIR, material_file_name},
-		temp_arena.allocator,
-	)
-	defer delete(material_asset_path, temp_arena.allocator)
+	tasks := make([]MaterialSaveTask, len(p_material_asset_refs), temp_arena.allocator)
+	for material_asset_ref, i in p_material_asset_refs {
+		material_asset := material_asset_get(material_asset_ref)
+		material_name := common.get_string(material_asset.name)
+		tasks[i] = MaterialSaveTask {
+			metadata           = material_asset.metadata,
+			material_name      = material_name,
+			material_file_name = strings.concatenate(
+				{material_name, ".json"},
+				temp_arena.allocator,
+			),
+			properties         = &p_material_properties[i],
+		}
+	}
+
+	common.jobs_parallel_for(u32(len(tasks)), 1, material_save_tasks_run, &tasks)
+
+	// Add the entries to the database
+	all_saved := true
+	num_saved := 0
+	for task in tasks {
+		if task.success == false {
+			all_saved = false
+			continue
+		}
+
+		db_entry := AssetDatabaseEntry {
+			uuid      = task.metadata.uuid,
+			name      = task.material_name,
+			file_name = task.material_file_name,
+		}
+		asset_database_add(&INTERNAL.material_database, db_entry)
+		num_saved += 1
+	}
+
+	if num_saved > 0 {
+		asset_database_save(&INTERNAL.material_database)
+	}
+
+	return all_saved
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+material_save_tasks_run :: proc(p_start: u32, p_end: u32, p_user_data: rawptr) {
+	tasks := (^[]MaterialSaveTask)(p_user_data)^
+	for &task in tasks[p_start:p_end] {
+		task.success = material_save_task_write_files(&task)
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+// Writes the metadata and the properties of the material, safe to run on any thread
+@(private = "file")
+material_save_task_write_files :: proc(p_task: ^MaterialSaveTask) -> bool {
+
+	temp_arena: common.Arena
+	common.temp_arena_init(&temp_arena)
+	defer common.arena_delete(temp_arena)
 
 	// Write the metadata file
 	material_metadata_file_path := common.aprintf(
 		temp_arena.allocator,
 		"%s%s.metadata",
 		G_MATERIAL_ASSETS_DIR,
-		common.get_string(material_asset.name),
+		p_task.material_name,
 	)
 
 	if common.write_json_file(
 		   material_metadata_file_path,
 		   MaterialAssetMetadata,
-		   material_asset.metadata,
+		   p_task.metadata,
 		   temp_arena.allocator,
 	   ) ==
 	   false {
 		log.warnf(
 			"Failed to save material '%s' - couldn't save metadata\n",
-			common.get_string(material_asset.name),
+			p_task.material_name,
 		)
 		return false
 	}
 
-	// Add an entry to the database
-	db_entry := AssetDatabaseEntry {
-		uuid      = material_asset.uuid,
-		name      = common.get_string(material_asset.name),
-		file_name = material_file_name,
-	}
-	asset_database_add(&INTERNAL.material_database, db_entry, true)
+	material_asset_path := filepath.join(
+		{G_MATERIAL_ASSETS_DIR, p_task.material_file_name},
+		temp_arena.allocator,
+	)
 
 	return common.write_json_file(
 		material_asset_path,
 		MaterialPropertiesAssetJSON,
-		p_material_properties,
+		p_task.properties^,
 		temp_arena.allocator,
 	)
 }
 
 //---------------------------------------------------------------------------//
 
+@(private = "file")
+material_asset_set_image :: proc(
+	p_material_asset_ref: MaterialAssetRef,
+	p_material_properties: ^renderer.MaterialProperties,
+	p_image_flag: renderer.MaterialPropertiesFlagBits,
+	p_image_name: string,
+	p_load_async: bool,
+) {
+	material_asset := material_asset_get(p_material_asset_ref)
+
+	if p_load_async == false {
+		material_asset_set_image_by_name(
+			material_properties_get_image_id_ptr(p_material_properties, p_image_flag),
+			p_image_name,
+			&material_asset.texture_asset_refs,
+		)
+		return
+	}
+
+	// The material doesn't use the image until the texture is loaded
+	p_material_properties.flags -= {p_image_flag}
+
+	image_load := new(MaterialImageLoad, G_ALLOCATORS.main_allocator)
+	image_load.material_asset_ref = p_material_asset_ref
+	image_load.image_flag = p_image_flag
+	image_load.texture_asset_ref = texture_asset_load_async(
+		p_image_name,
+		material_on_texture_loaded,
+		image_load,
+	)
+
+	append(&material_asset.texture_asset_refs, image_load.texture_asset_ref)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+material_on_texture_loaded :: proc(p_name: common.Name, p_success: bool, p_user_data: rawptr) {
+	image_load := (^MaterialImageLoad)(p_user_data)
+	defer free(image_load, G_ALLOCATORS.main_allocator)
+
+	if p_success == false {
+		return
+	}
+
+	// The material could've been unloaded in the meantime
+	if common.ref_is_alive(&G_MATERIAL_ASSET_REF_ARRAY, image_load.material_asset_ref) == false {
+		return
+	}
+	material_asset := material_asset_get(image_load.material_asset_ref)
+	if material_asset.ref_count == 0 || material_asset.load_state != .Loaded {
+		return
+	}
+
+	image_ref := texture_asset_get(image_load.texture_asset_ref).image_ref
+	image_idx := renderer.image_get_idx(image_ref)
+
+	material_properties := renderer.material_instance_get_properties_ptr(
+		material_asset.material_instance_ref,
+	)
+	material_properties_get_image_id_ptr(material_properties, image_load.image_flag)^ =
+		renderer.g_resources.images[image_idx].bindless_idx
+	material_properties.flags += {image_load.image_flag}
+
+	renderer.material_instance_mark_dirty(material_asset.material_instance_ref)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+material_properties_get_image_id_ptr :: proc(
+	p_material_properties: ^renderer.MaterialProperties,
+	p_image_flag: renderer.MaterialPropertiesFlagBits,
+) -> ^u32 {
+	switch p_image_flag {
+	case .HasAlbedoImage:
+		return &p_material_properties.albedo_image_id
+	case .HasNormalImage:
+		return &p_material_properties.normal_image_id
+	case .HasRoughnessImage:
+		return &p_material_properties.roughness_image_id
+	case .HasMetalnessImage:
+		return &p_material_properties.metalness_image_id
+	case .HasOcclusionImage:
+		return &p_material_properties.occlusion_image_id
+	}
+	return nil
+}
+
+//---------------------------------------------------------------------------//
+
 @(private = "file")
 material_asset_set_image_by_name :: proc(
 	p_image_id: ^u32,
@@ -553,6 +1017,16 @@ material_asset_unload :: proc(p_material_asset_ref: MaterialAssetRef) {
 		return
 	}
 
+	// The load request releases the material once it finishes
+	if material_asset.load_state == .Loading {
+		return
+	}
+
+	if material_asset.load_state == .Failed {
+		common.ref_free(&G_MATERIAL_ASSET_REF_ARRAY, p_material_asset_ref)
+		return
+	}
+
 	for texture_asset_ref in material_asset.texture_asset_refs {
 		texture_asset_unload(texture_asset_ref)
 	}
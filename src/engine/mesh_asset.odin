@@ -12,6 +12,7 @@ import "core:path/filepath"
 import "core:slice"
 import "core:strconv"
 import "core:strings"
+import "core:time"
 
 import "../common"
 import "../renderer"
@@ -20,7 +21,11 @@ import assimp "../third_party/assimp"
 //---------------------------------------------------------------------------//
 
 @(private = "file")
-G_METADATA_FILE_VERSION :: 1
+G_METADATA_FILE_VERSION :: 5
+
+// Written only with compressed mesh data, uncompressed files keep the previous version
+@(private = "file")
+G_METADATA_FILE_VERSION_COMPRESSED_DATA :: 6
 
 //---------------------------------------------------------------------------//
 
@@ -29,12 +34,17 @@ G_MESH_DB_PATH :: "app_data/engine/assets/meshes/db.json"
 
 //---------------------------------------------------------------------------//
 
-@(private = "file")
+@(private)
 G_MESH_ASSETS_DIR :: "app_data/engine/assets/meshes/"
 
 //---------------------------------------------------------------------------//
 
-MeshAssetImportFlagBits :: enum u16 {}
+MeshAssetImportFlagBits :: enum u16 {
+	// Store the mesh data as independently compressed blocks, see mesh_compression.odin
+	CompressData,
+	// Simplify the submeshes into LOD chains, see mesh_simplifier.odin
+	GenerateLODs,
+}
 
 MeshAssetImportFlags :: distinct bit_set[MeshAssetImportFlagBits;u16]
 
@@ -58,32 +68,59 @@ MeshFeatureFlagBits :: enum u16 {
 	UV,
 	Tangent,
 	IndexedDraw,
+	Meshlets,
+	// Vertex attributes are stored as in renderer.VertexFormat, older assets store them as floats
+	PackedVertices,
 }
 
 MeshFeatureFlags :: distinct bit_set[MeshFeatureFlagBits;u16]
 
 //---------------------------------------------------------------------------//
 
+@(private = "file")
+SubMeshLODMetadata :: struct {
+	index_offset: u32 `json:"indexOffset"`,
+	index_count:  u32 `json:"indexCount"`,
+	error:        f32 `json:"error"`,
+}
+
+//---------------------------------------------------------------------------//
+
 @(private = "file")
 SubMeshMetadata :: struct {
 	vertex_offset:       u32 `json:"vertexOffset"`,
 	vertex_count:        u32 `json:"vertexCount"`,
 	index_offset:        u32 `json:"indexOffset"`,
 	index_count:         u32 `json:"indexCount"`,
+	meshlet_offset:      u32 `json:"meshletOffset"`,
+	meshlet_count:       u32 `json:"meshletCount"`,
 	material_asset_name: common.Name,
+	bounds_min:          glsl.vec3 `json:"boundsMin"`,
+	bounds_max:          glsl.vec3 `json:"boundsMax"`,
+	// Simplified levels, starting from LOD 1. Their indices are stored after the indices of all submeshes
+	lods:                []SubMeshLODMetadata `json:"lods"`,
 }
 
 //---------------------------------------------------------------------------//
 
 @(private = "file")
 MeshAssetMetadata :: struct {
-	using base:        AssetMetadataBase,
-	feature_flags:     MeshFeatureFlags `json:"featureFlags"`,
-	sub_meshes:        []SubMeshMetadata `json:"subMeshes"`,
-	total_vertex_size: u32 `json:"totalVertexSize"`,
-	total_index_size:  u32 `json:"totalIndexSize"`,
-	num_vertices:      u32 `json:"numVertices"`,
-	num_indices:       u32 `json:"numIndices"`,
+	using base:             AssetMetadataBase,
+	feature_flags:          MeshFeatureFlags `json:"featureFlags"`,
+	sub_meshes:             []SubMeshMetadata `json:"subMeshes"`,
+	total_vertex_size:      u32 `json:"totalVertexSize"`,
+	total_index_size:       u32 `json:"totalIndexSize"`,
+	num_vertices:           u32 `json:"numVertices"`,
+	num_indices:            u32 `json:"numIndices"`,
+	// Meshlet section, stored after the vertex data when the .Meshlets feature is present
+	num_meshlets:           u32 `json:"numMeshlets"`,
+	num_meshlet_vertices:   u32 `json:"numMeshletVertices"`,
+	meshlet_triangles_size: u32 `json:"meshletTrianglesSize"`,
+	// Range the packed positions are quantized to
+	position_bounds_min:    glsl.vec3 `json:"positionBoundsMin"`,
+	position_bounds_max:    glsl.vec3 `json:"positionBoundsMax"`,
+	// Blocks of the compressed mesh data, empty if the data is stored uncompressed
+	compressed_blocks:      []MeshBlobBlock `json:"compressedBlocks"`,
 }
 
 //---------------------------------------------------------------------------//
@@ -92,6 +129,29 @@ MeshAsset :: struct {
 	using metadata: MeshAssetMetadata,
 	ref_count:      u32,
 	mesh_ref:       renderer.MeshRef,
+	load_state:     AssetLoadState,
+}
+
+//---------------------------------------------------------------------------//
+
+// Mesh data read from the disk, but without the renderer mesh yet
+@(private = "file")
+MeshLoadData :: struct {
+	metadata:      MeshAssetMetadata,
+	// Mesh data file, the asset pack or the decompressed data
+	mesh_data:     []byte,
+	file_mapping:  common.FileMemoryMapping,
+	data_block:    []byte,
+	material_refs: []MaterialAssetRef,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+MeshLoadStage :: enum u8 {
+	LoadMaterials,
+	CreateMesh,
+	WaitForUpload,
 }
 
 //---------------------------------------------------------------------------//
@@ -145,7 +205,12 @@ SubMesh :: struct {
 	vertex_count:        u32,
 	index_offset:        u32,
 	index_count:         u32,
+	meshlet_offset:      u32,
+	meshlet_count:       u32,
 	material_asset_name: common.Name,
+	bounding_box:        renderer.BoundingBox,
+	lods:                [renderer.MESH_MAX_LODS]renderer.SubMeshLOD,
+	num_lods:            u32,
 }
 
 //---------------------------------------------------------------------------//
@@ -160,10 +225,74 @@ MeshImportContext :: struct {
 	normals:            []glsl.vec3,
 	tangents:           []glsl.vec3,
 	uvs:                []glsl.vec2,
+	packed_vertices:    PackedVertices,
+	position_bounds:    renderer.BoundingBox,
 	mesh_feature_flags: MeshFeatureFlags,
+	import_flags:       MeshAssetImportFlags,
 	sub_meshes:         []SubMesh,
+	meshlets:           MeshletBuildOutput,
 	mesh_dir:           string,
 	mesh_name:          string,
+	// Materials and textures referenced by the scene, imported after all of the nodes are loaded
+	materials:          [dynamic]MaterialImport,
+	material_indices:   map[common.Name]u32,
+	texture_imports:    [dynamic]TextureAssetImportOptions,
+	texture_indices:    map[string]i32,
+	allocator:          mem.Allocator,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+MaterialTextureSlot :: enum {
+	Albedo,
+	Normal,
+	Roughness,
+	Metalness,
+	Occlusion,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+G_MATERIAL_TEXTURE_SLOT_ASSIMP_TYPES := [MaterialTextureSlot]assimp.TextureType {
+	.Albedo    = .AitexturetypeBaseColor,
+	.Normal    = .AitexturetypeNormals,
+	.Roughness = .AitexturetypeDiffuseRoughness,
+	.Metalness = .AitexturetypeMetalness,
+	.Occlusion = .AitexturetypeLightmap,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+MaterialImport :: struct {
+	material_asset_ref: MaterialAssetRef,
+	// Index into MeshImportContext.texture_imports, -1 if the material doesn't use the slot
+	texture_indices:    [MaterialTextureSlot]i32,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+MeshWriteJobData :: struct {
+	import_ctx:              ^MeshImportContext,
+	metadata:                ^MeshAssetMetadata,
+	mesh_asset_path:         string,
+	mesh_metadata_file_path: string,
+	success:                 bool,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+MeshOptimizeJobData :: struct {
+	import_ctx:   ^MeshImportContext,
+	stats_before: []MeshOptimizerStats,
+	stats_after:  []MeshOptimizerStats,
+	meshlets:     []MeshletBuildOutput,
+	// Indices of the simplified levels, relative to the submesh
+	lod_indices:  [][dynamic]u32,
 }
 
 //---------------------------------------------------------------------------//
@@ -188,9 +317,11 @@ mesh_asset_get :: proc(p_ref: MeshAssetRef) -> ^MeshAsset {
 mesh_asset_import :: proc(p_import_options: MeshAssetImportOptions) -> AssetImportResult {
 
 	temp_arena: common.Arena
-	common.temp_arena_init(&temp_arena, common.KILOBYTE * 128)
+	common.temp_arena_init(&temp_arena, common.MEGABYTE)
 	defer common.arena_delete(temp_arena)
 
+	import_start := time.tick_now()
+
 	mesh_asset_name := filepath.short_stem(filepath.base(p_import_options.file_path))
 	mesh_file_path := strings.clone_to_cstring(p_import_options.file_path, temp_arena.allocator)
 
@@ -211,7 +342,6 @@ mesh_asset_import :: proc(p_import_options: MeshAssetImportOptions) -> AssetImpo
 			.FlipUVs,
 			.JoinIdenticalVertices,
 			.Triangulate,
-			.ImproveCacheLocality,
 			.FindDegenerates,
 			.OptimizeMeshes,
 			.GenSmoothNormals,
@@ -225,10 +355,11 @@ mesh_asset_import :: proc(p_import_options: MeshAssetImportOptions) -> AssetImpo
 	defer assimp.release_import(scene)
 
 	mesh_import_ctx := MeshImportContext {
-		curr_idx  = 0,
-		curr_vtx  = 0,
-		mesh_dir  = filepath.dir(p_import_options.file_path, temp_arena.allocator),
-		mesh_name = mesh_asset_name,
+		curr_idx     = 0,
+		curr_vtx     = 0,
+		mesh_dir     = filepath.dir(p_import_options.file_path, temp_arena.allocator),
+		mesh_name    = mesh_asset_name,
+		import_flags = p_import_options.flags,
 	}
 
 	log.infof("Importing mesh '%s'\n", mesh_asset_name)
@@ -270,9 +401,206 @@ mesh_asset_import :: proc(p_import_options: MeshAssetImportOptions) -> AssetImpo
 	defer delete(mesh_import_ctx.sub_meshes, G_ALLOCATORS.main_allocator)
 	defer delete(mesh_import_ctx.indices, G_ALLOCATORS.main_allocator)
 
-	// Recursivly load the nodes
+	mesh_import_ctx.materials = make([dynamic]MaterialImport, temp_arena.allocator)
+	mesh_import_ctx.material_indices = make(map[common.Name]u32, 64, temp_arena.allocator)
+	mesh_import_ctx.texture_imports = make([dynamic]TextureAssetImportOptions, temp_arena.allocator)
+	mesh_import_ctx.texture_indices = make(map[string]i32, 64, temp_arena.allocator)
+	mesh_import_ctx.allocator = temp_arena.allocator
+
+	stage_start := time.tick_now()
+	scene_duration := time.tick_diff(import_start, stage_start)
+
+	// Recursivly load the nodes, this only collects the materials and textures
 	assimp_load_node(scene, scene.mRootNode, &mesh_import_ctx, glsl.identity(glsl.mat4x4))
 
+	nodes_duration := time.tick_lap_time(&stage_start)
+
+	// Reorder the triangles and vertices of each submesh for the vertex cache, overdraw
+	// and vertex fetch, then split them into meshlets and generate the LODs when requested
+	optimize_job_data := MeshOptimizeJobData {
+		import_ctx   = &mesh_import_ctx,
+		stats_before = make(
+			[]MeshOptimizerStats,
+			len(mesh_import_ctx.sub_meshes),
+			temp_arena.allocator,
+		),
+		stats_after  = make(
+			[]MeshOptimizerStats,
+			len(mesh_import_ctx.sub_meshes),
+			temp_arena.allocator,
+		),
+		meshlets     = make(
+			[]MeshletBuildOutput,
+			len(mesh_import_ctx.sub_meshes),
+			temp_arena.allocator,
+		),
+		lod_indices  = make(
+			[][dynamic]u32,
+			len(mesh_import_ctx.sub_meshes),
+			temp_arena.allocator,
+		),
+	}
+	for i in 0 ..< len(mesh_import_ctx.sub_meshes) {
+		optimize_job_data.meshlets[i] = meshlet_build_output_create(G_ALLOCATORS.main_allocator)
+		optimize_job_data.lod_indices[i] = make([dynamic]u32, G_ALLOCATORS.main_allocator)
+	}
+	defer {
+		for i in 0 ..< len(mesh_import_ctx.sub_meshes) {
+			meshlet_build_output_destroy(&optimize_job_data.meshlets[i])
+			delete(optimize_job_data.lod_indices[i])
+		}
+	}
+
+	if .IndexedDraw in mesh_import_ctx.mesh_feature_flags {
+		common.jobs_parallel_for(
+			u32(len(mesh_import_ctx.sub_meshes)),
+			1,
+			mesh_optimize_sub_meshes,
+			&optimize_job_data,
+		)
+	}
+
+	stats_before, stats_after: MeshOptimizerStats
+	for i in 0 ..< len(mesh_import_ctx.sub_meshes) {
+		mesh_optimizer_stats_add(&stats_before, optimize_job_data.stats_before[i])
+		mesh_optimizer_stats_add(&stats_after, optimize_job_data.stats_after[i])
+	}
+
+	// Merge the meshlets of all submeshes into a single section
+	mesh_import_ctx.meshlets = meshlet_build_output_create(G_ALLOCATORS.main_allocator)
+	defer meshlet_build_output_destroy(&mesh_import_ctx.meshlets)
+
+	for &sub_mesh, i in mesh_import_ctx.sub_meshes {
+		sub_mesh_meshlets := &optimize_job_data.meshlets[i]
+		vertices_base := u32(len(mesh_import_ctx.meshlets.vertices))
+		triangles_base := u32(len(mesh_import_ctx.meshlets.triangles))
+
+		sub_mesh.meshlet_offset = u32(len(mesh_import_ctx.meshlets.meshlets))
+		sub_mesh.meshlet_count = u32(len(sub_mesh_meshlets.meshlets))
+
+		for meshlet in sub_mesh_meshlets.meshlets {
+			merged_meshlet := meshlet
+			merged_meshlet.vertex_offset += vertices_base
+			merged_meshlet.triangle_offset += triangles_base
+			append(&mesh_import_ctx.meshlets.meshlets, merged_meshlet)
+		}
+		append(&mesh_import_ctx.meshlets.vertices, ..sub_mesh_meshlets.vertices[:])
+		append(&mesh_import_ctx.meshlets.triangles, ..sub_mesh_meshlets.triangles[:])
+	}
+
+	if len(mesh_import_ctx.meshlets.meshlets) > 0 {
+		mesh_import_ctx.mesh_feature_flags += {.Meshlets}
+	}
+
+	// Append the indices of the LODs after the indices of all submeshes, so the
+	// ranges of LOD 0 stay the same and meshes without LODs keep their layout
+	num_lod_indices := 0
+	num_lod_triangles := 0
+	for lod_indices in optimize_job_data.lod_indices {
+		num_lod_indices += len(lod_indices)
+	}
+
+	if num_lod_indices > 0 {
+		base_indices := mesh_import_ctx.indices
+		mesh_import_ctx.indices = make(
+			[]u32,
+			len(base_indices) + num_lod_indices,
+			G_ALLOCATORS.main_allocator,
+		)
+		copy(mesh_import_ctx.indices, base_indices)
+		delete(base_indices, G_ALLOCATORS.main_allocator)
+
+		lod_indices_base := u32(len(base_indices))
+		for &sub_mesh, i in mesh_import_ctx.sub_meshes {
+			lod_indices := optimize_job_data.lod_indices[i][:]
+			for idx, j in lod_indices {
+				mesh_import_ctx.indices[int(lod_indices_base) + j] = idx + sub_mesh.vertex_offset
+			}
+			for &lod in sub_mesh.lods[1:sub_mesh.num_lods] {
+				lod.index_offset += lod_indices_base
+				num_lod_triangles += int(lod.index_count / 3)
+			}
+			lod_indices_base += u32(len(lod_indices))
+		}
+	}
+
+	optimize_duration := time.tick_lap_time(&stage_start)
+
+	log.infof(
+		"Optimized mesh '%s' - ACMR: %.3f -> %.3f, ATVR: %.3f -> %.3f, overdraw: %.3f -> %.3f, %d meshlets, %d LOD triangles\n",
+		mesh_asset_name,
+		mesh_optimizer_stats_get_acmr(stats_before),
+		mesh_optimizer_stats_get_acmr(stats_after),
+		mesh_optimizer_stats_get_atvr(stats_before),
+		mesh_optimizer_stats_get_atvr(stats_after),
+		mesh_optimizer_stats_get_overdraw(stats_before),
+		mesh_optimizer_stats_get_overdraw(stats_after),
+		len(mesh_import_ctx.meshlets.meshlets),
+		num_lod_triangles,
+	)
+
+	// Pack the vertex attributes, the streams of missing features are left empty
+	{
+		normals := mesh_import_ctx.normals if .Normal in mesh_import_ctx.mesh_feature_flags else nil
+		tangents :=
+			mesh_import_ctx.tangents if .Tangent in mesh_import_ctx.mesh_feature_flags else nil
+		uvs := mesh_import_ctx.uvs if .UV in mesh_import_ctx.mesh_feature_flags else nil
+
+		mesh_import_ctx.position_bounds = calculate_bounding_box(mesh_import_ctx.positions)
+
+		packing_error: MeshVertexPackingError
+		mesh_import_ctx.packed_vertices, packing_error = mesh_pack_vertices(
+			mesh_import_ctx.positions,
+			normals,
+			tangents,
+			uvs,
+			mesh_import_ctx.position_bounds,
+			G_ALLOCATORS.main_allocator,
+		)
+		mesh_import_ctx.mesh_feature_flags += {.PackedVertices}
+
+		log.infof(
+			"Packed vertices of mesh '%s' - %d -> %d bytes per vertex, max error - position: %f, normal: %.3f deg, tangent: %.3f deg, uv: %f\n",
+			mesh_asset_name,
+			size_of(glsl.vec3) * 3 + size_of(glsl.vec2),
+			size_of(renderer.VertexFormat),
+			packing_error.max_position_error,
+			packing_error.max_normal_error,
+			packing_error.max_tangent_error,
+			packing_error.max_uv_error,
+		)
+	}
+	defer packed_vertices_delete(mesh_import_ctx.packed_vertices, G_ALLOCATORS.main_allocator)
+
+	// Import all of the textures referenced by the materials in parallel
+	texture_import_results := make(
+		[]AssetImportResult,
+		len(mesh_import_ctx.texture_imports),
+		temp_arena.allocator,
+	)
+	texture_asset_import_batch(mesh_import_ctx.texture_imports[:], texture_import_results)
+
+	textures_duration := time.tick_lap_time(&stage_start)
+
+	// Now that the texture names are known, fill the material properties
+	material_asset_refs := make(
+		[]MaterialAssetRef,
+		len(mesh_import_ctx.materials),
+		temp_arena.allocator,
+	)
+	material_props := make(
+		[]MaterialPropertiesAssetJSON,
+		len(mesh_import_ctx.materials),
+		temp_arena.allocator,
+	)
+	for material_import, i in mesh_import_ctx.materials {
+		material_asset_refs[i] = material_import.material_asset_ref
+		material_props[i] = material_import_create_properties(
+			material_import,
+			texture_import_results,
+		)
+	}
+
 	// Save the metadata
 	mesh_metadata_file_path := common.aprintf(
 		temp_arena.allocator,
@@ -299,15 +627,24 @@ mesh_asset_import :: proc(p_import_options: MeshAssetImportOptions) -> AssetImpo
 		mesh_metadata.total_index_size = size_of(u32) * mesh_metadata.num_indices
 	}
 
-	mesh_metadata.total_vertex_size = size_of(glsl.vec3) * mesh_metadata.num_vertices
+	mesh_metadata.position_bounds_min = mesh_import_ctx.position_bounds.min
+	mesh_metadata.position_bounds_max = mesh_import_ctx.position_bounds.max
+
+	mesh_metadata.total_vertex_size = size_of([4]u16) * mesh_metadata.num_vertices
 	if .Normal in mesh_import_ctx.mesh_feature_flags {
-		mesh_metadata.total_vertex_size += size_of(glsl.vec3) * mesh_metadata.num_vertices
+		mesh_metadata.total_vertex_size += size_of([2]i16) * mesh_metadata.num_vertices
 	}
 	if .Tangent in mesh_import_ctx.mesh_feature_flags {
-		mesh_metadata.total_vertex_size += size_of(glsl.vec3) * mesh_metadata.num_vertices
+		mesh_metadata.total_vertex_size += size_of([2]i16) * mesh_metadata.num_vertices
 	}
 	if .UV in mesh_import_ctx.mesh_feature_flags {
-		mesh_metadata.total_vertex_size += size_of(glsl.vec2) * mesh_metadata.num_vertices
+		mesh_metadata.total_vertex_size += size_of([2]f16) * mesh_metadata.num_vertices
+	}
+
+	if .Meshlets in mesh_import_ctx.mesh_feature_flags {
+		mesh_metadata.num_meshlets = u32(len(mesh_import_ctx.meshlets.meshlets))
+		mesh_metadata.num_meshlet_vertices = u32(len(mesh_import_ctx.meshlets.vertices))
+		mesh_metadata.meshlet_triangles_size = u32(len(mesh_import_ctx.meshlets.triangles))
 	}
 
 	for sub_mesh, i in mesh_import_ctx.sub_meshes {
@@ -316,71 +653,73 @@ mesh_asset_import :: proc(p_import_options: MeshAssetImportOptions) -> AssetImpo
 			vertex_count        = sub_mesh.vertex_count,
 			index_offset        = sub_mesh.index_offset,
 			index_count         = sub_mesh.index_count,
+			meshlet_offset      = sub_mesh.meshlet_offset,
+			meshlet_count       = sub_mesh.meshlet_count,
 			material_asset_name = sub_mesh.material_asset_name,
+			bounds_min          = sub_mesh.bounding_box.min,
+			bounds_max          = sub_mesh.bounding_box.max,
 		}
-	}
-
-	if common.write_json_file(
-		   mesh_metadata_file_path,
-		   MeshAssetMetadata,
-		   mesh_metadata,
-		   temp_arena.allocator,
-	   ) ==
-	   false {
-		log.warnf("Failed to save mesh '%s' - couldn't save metadata\n", mesh_asset_name)
-		return AssetImportResult{status = .Error}
 
+		if sub_mesh.num_lods > 1 {
+			lods := make([]SubMeshLODMetadata, sub_mesh.num_lods - 1, temp_arena.allocator)
+			for lod, j in sub_mesh.lods[1:sub_mesh.num_lods] {
+				lods[j] = SubMeshLODMetadata {
+					index_offset = lod.index_offset,
+					index_count  = lod.index_count,
+					error        = lod.error,
+				}
+			}
+			mesh_metadata.sub_meshes[i].lods = lods
+		}
 	}
 
-	mesh_name := common.create_name(mesh_asset_name)
-
-	// Save the data itself
-	fd, err := os.open(mesh_asset_path, os.O_WRONLY | os.O_CREATE)
-	if err != 0 {
-		os.remove(mesh_metadata_file_path)
-		log.warnf(
-			"Failed to save mesh '%s' - couldn't open file %s\n",
-			mesh_asset_name,
-			mesh_asset_path,
-		)
-
-		return AssetImportResult{status = .Error}
+	// Write the mesh data on a worker while the materials are being saved
+	mesh_write_job_data := MeshWriteJobData {
+		import_ctx              = &mesh_import_ctx,
+		metadata                = &mesh_metadata,
+		mesh_asset_path         = mesh_asset_path,
+		mesh_metadata_file_path = mesh_metadata_file_path,
 	}
-	defer os.close(fd)
+	mesh_write_jobs := []common.Job{{procedure = mesh_write_job, user_data = &mesh_write_job_data}}
+	mesh_write_counter: common.JobCounter
+	common.jobs_run(mesh_write_jobs, &mesh_write_counter)
 
-	if .IndexedDraw in mesh_import_ctx.mesh_feature_flags {
-		os.write_ptr(fd, raw_data(mesh_import_ctx.indices), int(mesh_metadata.total_index_size))
+	material_asset_save_new_batch(material_asset_refs, material_props)
+	for material_asset_ref in material_asset_refs {
+		material_asset_unload(material_asset_ref)
 	}
 
-	os.write_ptr(fd, raw_data(mesh_import_ctx.positions), int(num_vertices) * size_of(glsl.vec3))
+	common.jobs_wait(&mesh_write_counter)
 
-	if .Normal in mesh_import_ctx.mesh_feature_flags {
-		os.write_ptr(fd, raw_data(mesh_import_ctx.normals), int(num_vertices) * size_of(glsl.vec3))
-	}
+	write_duration := time.tick_lap_time(&stage_start)
 
-	if .Tangent in mesh_import_ctx.mesh_feature_flags {
-		os.write_ptr(
-			fd,
-			raw_data(mesh_import_ctx.tangents),
-			int(num_vertices) * size_of(glsl.vec3),
-		)
+	if mesh_write_job_data.success == false {
+		return AssetImportResult{status = .Error}
 	}
 
-
-	if .UV in mesh_import_ctx.mesh_feature_flags {
-		os.write_ptr(fd, raw_data(mesh_import_ctx.uvs), int(num_vertices) * size_of(glsl.vec2))
-	}
+	mesh_name := common.create_name(mesh_asset_name)
 
 	// Add an entry to the database
-	mesh_file_name := strings.concatenate({mesh_asset_name, ".bin"}, temp_arena.allocator)
-
 	db_entry := AssetDatabaseEntry {
 		uuid      = mesh_metadata.uuid,
 		name      = mesh_asset_name,
-		file_name = mesh_file_name,
+		file_name = mesh_asset_file_name,
 	}
 	asset_database_add(&INTERNAL.mesh_database, db_entry, true)
 
+	log.infof(
+		"Imported mesh '%s' in %.2f ms - scene: %.2f ms, nodes: %.2f ms, optimization: %.2f ms, %d textures: %.2f ms, %d materials and mesh data: %.2f ms\n",
+		mesh_asset_name,
+		time.duration_milliseconds(time.tick_since(import_start)),
+		time.duration_milliseconds(scene_duration),
+		time.duration_milliseconds(nodes_duration),
+		time.duration_milliseconds(optimize_duration),
+		len(texture_import_results),
+		time.duration_milliseconds(textures_duration),
+		len(material_asset_refs),
+		time.duration_milliseconds(write_duration),
+	)
+
 	return AssetImportResult{name = mesh_name, status = .Ok}
 }
 
@@ -407,7 +746,16 @@ mesh_asset_load_by_name :: proc(p_mesh_asset_name: common.Name) -> (ret_mesh_ref
 	{
 		mesh_asset_ref := common.ref_find_by_name(&G_MESH_ASSET_REF_ARRAY, p_mesh_asset_name)
 		if mesh_asset_ref != InvalidMeshAssetRef {
-			mesh_asset_get(mesh_asset_ref).ref_count += 1
+			mesh_asset := mesh_asset_get(mesh_asset_ref)
+			mesh_asset.ref_count += 1
+
+			// Finish the async load, as the mesh is needed right away
+			asset_loader_wait(&mesh_asset.load_state)
+			if mesh_asset.load_state == .Failed {
+				mesh_asset_unload(mesh_asset_ref)
+				return InvalidMeshAssetRef
+			}
+
 			return mesh_asset_ref
 		}
 	}
@@ -418,166 +766,586 @@ mesh_asset_load_by_name :: proc(p_mesh_asset_name: common.Name) -> (ret_mesh_ref
 	common.temp_arena_init(&temp_arena, common.MEGABYTE)
 	defer common.arena_delete(temp_arena)
 
-	mesh_asset_path := asset_create_path(
-		G_MESH_ASSETS_DIR,
-		p_mesh_asset_name,
-		"bin",
-		temp_arena.allocator,
-	)
-
-	// Load metadata
-	mesh_metadata: MeshAssetMetadata
-	mesh_name := common.get_string(p_mesh_asset_name)
-
-	{
-		mesh_metadata_file_path := common.aprintf(
-			temp_arena.allocator,
-			"%s%s.metadata",
-			G_MESH_ASSETS_DIR,
-			mesh_name,
-		)
-		mesh_metadata_json, success := os.read_entire_file(
-			mesh_metadata_file_path,
-			temp_arena.allocator,
-		)
-		if !success {
-			log.warnf("Failed to load mesh '%s' - couldn't load metadata\n", mesh_name)
-			return InvalidMeshAssetRef
-		}
-		err := json.unmarshal(mesh_metadata_json, &mesh_metadata, .JSON5, temp_arena.allocator)
-		if err != nil {
-			log.warnf("Failed to load mesh '%s' - couldn't read metadata\n", mesh_name)
-			return InvalidMeshAssetRef
-		}
+	load_data: MeshLoadData
+	if mesh_load_data_read(p_mesh_asset_name, &load_data, temp_arena.allocator, {}) == false {
+		return InvalidMeshAssetRef
 	}
 
-	// Create renderer mesh
-	mesh_resource_ref := renderer.mesh_allocate(
-		p_mesh_asset_name,
-		u32(len(mesh_metadata.sub_meshes)),
+	load_data.material_refs = make(
+		[]MaterialAssetRef,
+		len(load_data.metadata.sub_meshes),
+		temp_arena.allocator,
 	)
-	mesh_resource_idx := renderer.mesh_get_idx(mesh_resource_ref)
-	mesh_resource := &renderer.g_resources.meshes[mesh_resource_idx]
-	mesh_resource.desc.data_allocator = G_ALLOCATORS.main_allocator
+	for sub_mesh_metadata, i in load_data.metadata.sub_meshes {
+		load_data.material_refs[i] = material_asset_load(sub_mesh_metadata.material_asset_name)
+		assert(load_data.material_refs[i] != InvalidMaterialAssetRef)
+	}
 
-	// Load mesh data
-	file_mapping, mapping_success := common.mmap_file(mesh_asset_path)
-	if mapping_success == false {
-		log.warnf(
-			"Failed to load mesh '%s' - couldn't mmap file\n",
-			common.get_string(p_mesh_asset_name),
-		)
+	mesh_resource_ref, created := mesh_asset_create_from_load_data(p_mesh_asset_name, &load_data)
+	if created == false {
 		return InvalidMeshAssetRef
 	}
 
-	mesh_resource.desc.file_mapping = file_mapping
-
-	// Setup index pointer
-	current_data_ptr := (^byte)(file_mapping.mapped_ptr)
-	if .IndexedDraw in mesh_metadata.feature_flags {
-		mesh_resource.desc.flags += {.Indexed}
-		mesh_resource.desc.indices = slice.from_ptr(
-			(^u32)(current_data_ptr),
-			int(mesh_metadata.num_indices),
-		)
+	mesh_asset_ref := allocate_mesh_asset_ref(p_mesh_asset_name)
+	mesh_asset := mesh_asset_get(mesh_asset_ref)
+	mesh_asset.metadata = load_data.metadata
+	mesh_asset.ref_count = 1
+	mesh_asset.mesh_ref = mesh_resource_ref
+	mesh_asset.load_state = .Loaded
 
-		current_data_ptr = mem.ptr_offset(current_data_ptr, (mesh_metadata.total_index_size))
-	}
+	return mesh_asset_ref
+}
 
-	// Setup positions pointer
-	mesh_resource.desc.position = slice.from_ptr(
-		(^glsl.vec3)(current_data_ptr),
-		int(mesh_metadata.num_vertices),
-	)
+//---------------------------------------------------------------------------//
 
-	current_data_ptr = mem.ptr_offset(
-		current_data_ptr,
-		size_of(glsl.vec3) * (mesh_metadata.num_vertices),
-	)
+mesh_asset_load_async :: proc {
+	mesh_asset_load_async_by_name,
+	mesh_asset_load_async_by_str,
+}
 
+//---------------------------------------------------------------------------//
 
-	// Setup normals pointer
-	if .Normal in mesh_metadata.feature_flags {
-		mesh_resource.desc.features += {.Normal}
+@(private = "file")
+mesh_asset_load_async_by_str :: proc(
+	p_mesh_asset_name: string,
+	p_callback: AssetLoadCallback = nil,
+	p_user_data: rawptr = nil,
+) -> MeshAssetRef {
+	return mesh_asset_load_async_by_name(
+		common.create_name(p_mesh_asset_name),
+		p_callback,
+		p_user_data,
+	)
+}
 
-		mesh_resource.desc.normal = slice.from_ptr(
-			(^glsl.vec3)(current_data_ptr),
-			int(mesh_metadata.num_vertices),
-		)
+//---------------------------------------------------------------------------//
 
-		current_data_ptr = mem.ptr_offset(
-			current_data_ptr,
-			size_of(glsl.vec3) * (mesh_metadata.num_vertices),
+// Returns right away, the mesh can be used once it's load state is .Loaded. The mesh
+// data is read and decompressed on the job system, then the materials are loaded and
+// the renderer mesh is created. The callback is called once the mesh data is uploaded.
+@(private = "file")
+mesh_asset_load_async_by_name :: proc(
+	p_mesh_asset_name: common.Name,
+	p_callback: AssetLoadCallback = nil,
+	p_user_data: rawptr = nil,
+) -> MeshAssetRef {
+	mesh_asset_ref := common.ref_find_by_name(&G_MESH_ASSET_REF_ARRAY, p_mesh_asset_name)
+	if mesh_asset_ref != InvalidMeshAssetRef {
+		mesh_asset := mesh_asset_get(mesh_asset_ref)
+		mesh_asset.ref_count += 1
+		asset_loader_add_callback(
+			.Mesh,
+			p_mesh_asset_name,
+			mesh_asset.load_state,
+			p_callback,
+			p_user_data,
 		)
+		return mesh_asset_ref
 	}
 
-	// Setup tangents pointer
-	if .Tangent in mesh_metadata.feature_flags {
-		mesh_resource.desc.features += {.Tangent}
+	log.infof("Loading mesh '%s' asynchronously\n", common.get_string(p_mesh_asset_name))
 
-		mesh_resource.desc.tangent = slice.from_ptr(
-			(^glsl.vec3)(current_data_ptr),
-			int(mesh_metadata.num_vertices),
-		)
+	mesh_asset_ref = allocate_mesh_asset_ref(p_mesh_asset_name)
+	mesh_asset := mesh_asset_get(mesh_asset_ref)
+	mesh_asset.ref_count = 1
+	mesh_asset.mesh_ref = renderer.InvalidMeshRef
+	mesh_asset.load_state = .Loading
 
-		current_data_ptr = mem.ptr_offset(
-			current_data_ptr,
-			size_of(glsl.vec3) * (mesh_metadata.num_vertices),
+	temp_arena: common.Arena
+	common.temp_arena_init(&temp_arena)
+	defer common.arena_delete(temp_arena)
+
+	// The data in the asset pack is used in place, only separate files are read ahead
+	mesh_data_path: string
+	if _, in_pack := asset_pack_find(.Mesh, p_mesh_asset_name); in_pack == false {
+		mesh_data_path = asset_create_path(
+			G_MESH_ASSETS_DIR,
+			p_mesh_asset_name,
+			"bin",
+			temp_arena.allocator,
 		)
 	}
 
-	// Setup uvs pointer
-	if .UV in mesh_metadata.feature_flags {
-		mesh_resource.desc.features += {.UV}
-
-		mesh_resource.desc.uv = slice.from_ptr(
-			(^glsl.vec2)(current_data_ptr),
-			int(mesh_metadata.num_vertices),
-		)
+	asset_loader_start(
+		.Mesh,
+		p_mesh_asset_name,
+		mesh_asset_ref.ref,
+		size_of(MeshLoadData),
+		common.MEGABYTE,
+		mesh_load_request_read,
+		mesh_load_request_step,
+		mesh_data_path,
+		p_callback,
+		p_user_data,
+	)
 
-		current_data_ptr = mem.ptr_offset(
-			current_data_ptr,
-			size_of(glsl.vec2) * (mesh_metadata.num_vertices),
-		)
-	}
+	return mesh_asset_ref
+}
 
+//---------------------------------------------------------------------------//
 
-	// Setup submeshes information
-	for sub_mesh_metadata, i in mesh_metadata.sub_meshes {
+@(private = "file")
+mesh_load_request_read :: proc(p_request: ^AssetLoadRequest) -> bool {
+	load_data := (^MeshLoadData)(p_request.load_data)
 
-		material_asset_ref := material_asset_load(sub_mesh_metadata.material_asset_name)
-		assert(material_asset_ref != InvalidMaterialAssetRef)
-		material_asset := material_asset_get(material_asset_ref)
+	file_data: common.FileMemoryMapping
+	if p_request.file_read.status == .Done {
+		file_data = p_request.file_read.mapping
+	}
 
-		mesh_resource.desc.sub_meshes[i] = renderer.SubMesh {
-			vertex_offset         = sub_mesh_metadata.vertex_offset,
-			vertex_count          = sub_mesh_metadata.vertex_count,
-			index_offset          = sub_mesh_metadata.index_offset,
-			index_count           = sub_mesh_metadata.index_count,
-			material_instance_ref = material_asset.material_instance_ref,
-		}
+	data_read := mesh_load_data_read(
+		p_request.name,
+		load_data,
+		p_request.arena.allocator,
+		file_data,
+	)
+	if data_read == false {
+		return false
 	}
 
-	// Create the mesh resource
-	if renderer.mesh_create(mesh_resource_ref) == false {
-		return InvalidMeshAssetRef
+	// Decompressed data and data that was read by the asset loader is already in memory
+	if load_data.data_block == nil && file_data.mapped_ptr == nil {
+		asset_loader_prefetch(load_data.mesh_data)
 	}
 
-	// Safe to do, as the data now has been uploaded to the staging buffer 
-	// and memory  will be freed at the end of the function call
-	mesh_resource.desc.position = nil
-	mesh_resource.desc.normal = nil
-	mesh_resource.desc.uv = nil
-	mesh_resource.desc.tangent = nil
-	mesh_resource.desc.indices = nil
+	return true
+}
 
-	mesh_asset_ref := allocate_mesh_asset_ref(p_mesh_asset_name)
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+mesh_load_request_step :: proc(p_request: ^AssetLoadRequest) -> AssetLoadStepResult {
+	mesh_asset_ref := MeshAssetRef {
+		ref = p_request.asset_ref,
+	}
 	mesh_asset := mesh_asset_get(mesh_asset_ref)
-	mesh_asset.metadata = mesh_metadata
-	mesh_asset.ref_count = 1
-	mesh_asset.mesh_ref = mesh_resource_ref
+	load_data := (^MeshLoadData)(p_request.load_data)
+	stage := (^MeshLoadStage)(&p_request.stage)
+
+	// Unloaded while it was loading
+	if mesh_asset.ref_count == 0 {
+		if stage^ != .WaitForUpload {
+			mesh_load_request_cancel(p_request)
+			common.ref_free(&G_MESH_ASSET_REF_ARRAY, mesh_asset_ref)
+		}
+		return .Failed
+	}
 
-	return mesh_asset_ref
+	if p_request.read_success == false {
+		mesh_asset.load_state = .Failed
+		return .Failed
+	}
+
+	switch stage^ {
+	case .LoadMaterials:
+		load_data.material_refs = make(
+			[]MaterialAssetRef,
+			len(load_data.metadata.sub_meshes),
+			p_request.arena.allocator,
+		)
+		for sub_mesh_metadata, i in load_data.metadata.sub_meshes {
+			load_data.material_refs[i] = material_asset_load_async(
+				sub_mesh_metadata.material_asset_name,
+			)
+		}
+		stage^ = .CreateMesh
+		fallthrough
+
+	case .CreateMesh:
+		for material_ref in load_data.material_refs {
+			material_load_state := material_asset_get(material_ref).load_state
+			if material_load_state == .Loading {
+				return .Pending
+			}
+			if material_load_state == .Failed {
+				log.warnf(
+					"Failed to load mesh '%s' - couldn't load it's materials\n",
+					common.get_string(p_request.name),
+				)
+				mesh_load_request_cancel(p_request)
+				mesh_asset.load_state = .Failed
+				return .Failed
+			}
+		}
+
+		mesh_resource_ref, created := mesh_asset_create_from_load_data(p_request.name, load_data)
+		if created == false {
+			for material_ref in load_data.material_refs {
+				material_asset_unload(material_ref)
+			}
+			mesh_asset.load_state = .Failed
+			return .Failed
+		}
+
+		mesh_asset.metadata = load_data.metadata
+		mesh_asset.mesh_ref = mesh_resource_ref
+		mesh_asset.load_state = .Loaded
+		stage^ = .WaitForUpload
+		fallthrough
+
+	case .WaitForUpload:
+		if renderer.mesh_is_ready(mesh_asset.mesh_ref) == false {
+			return .Pending
+		}
+	}
+
+	return .Done
+}
+
+//---------------------------------------------------------------------------//
+
+// Releases the data and the materials of a mesh that's not going to be created
+@(private = "file")
+mesh_load_request_cancel :: proc(p_request: ^AssetLoadRequest) {
+	if p_request.read_success == false {
+		return
+	}
+
+	load_data := (^MeshLoadData)(p_request.load_data)
+	mesh_load_data_release(load_data)
+	for material_ref in load_data.material_refs {
+		material_asset_unload(material_ref)
+	}
+	load_data.material_refs = nil
+}
+
+//---------------------------------------------------------------------------//
+
+// Reads the metadata and maps the mesh data, decompressing it if needed. p_file_data is the
+// mesh data file when it was already read by the asset loader, it's released on failure.
+// Safe to run on any thread.
+@(private = "file")
+mesh_load_data_read :: proc(
+	p_name: common.Name,
+	p_load_data: ^MeshLoadData,
+	p_allocator: mem.Allocator,
+	p_file_data: common.FileMemoryMapping,
+) -> bool {
+	mesh_name := common.get_string(p_name)
+
+	// Load metadata, from the asset pack if the mesh is in it
+	pack_entry, in_pack := asset_pack_find(.Mesh, p_name)
+	metadata_read: bool
+	if in_pack {
+		metadata_read = mesh_read_pack_metadata(pack_entry, &p_load_data.metadata, p_allocator)
+		if metadata_read == false {
+			log.warnf("Failed to load mesh '%s' - invalid metadata in the asset pack\n", mesh_name)
+		}
+	} else {
+		metadata_read = mesh_read_metadata(mesh_name, &p_load_data.metadata, p_allocator)
+	}
+
+	if metadata_read == false {
+		if p_file_data.mapped_ptr != nil {
+			common.unmap_file(p_file_data)
+		}
+		return false
+	}
+
+	// Load mesh data, the data in the asset pack is used in place
+	if in_pack {
+		p_load_data.mesh_data = asset_pack_get_payload(pack_entry)
+		asset_pack_prefetch_payload(pack_entry)
+	} else if p_file_data.mapped_ptr != nil {
+		p_load_data.file_mapping = p_file_data
+		p_load_data.mesh_data = slice.from_ptr((^byte)(p_file_data.mapped_ptr), p_file_data.size)
+	} else {
+		mesh_asset_path := asset_create_path(G_MESH_ASSETS_DIR, p_name, "bin", p_allocator)
+
+		mapping_success: bool
+		p_load_data.file_mapping, mapping_success = common.mmap_file(
+			mesh_asset_path,
+			{.Sequential, .WillNeed, .HugePages},
+		)
+		if mapping_success == false {
+			log.warnf("Failed to load mesh '%s' - couldn't mmap file\n", mesh_name)
+			return false
+		}
+
+		p_load_data.mesh_data = slice.from_ptr(
+			(^byte)(p_load_data.file_mapping.mapped_ptr),
+			p_load_data.file_mapping.size,
+		)
+	}
+
+	// Compressed data is decoded in parallel into a single allocation with the uncompressed
+	// layout. The file isn't needed afterwards, the renderer releases the allocation once
+	// the data is uploaded.
+	if len(p_load_data.metadata.compressed_blocks) > 0 {
+		compressed_size, uncompressed_size := mesh_blob_get_sizes(
+			p_load_data.metadata.compressed_blocks,
+		)
+
+		data_block := make([]byte, uncompressed_size, G_ALLOCATORS.main_allocator)
+		decompressed := false
+		if compressed_size <= len(p_load_data.mesh_data) {
+			decompressed = mesh_blob_decompress(
+				p_load_data.mesh_data[:compressed_size],
+				p_load_data.metadata.compressed_blocks,
+				data_block,
+			)
+		}
+
+		if p_load_data.file_mapping.mapped_ptr != nil {
+			common.unmap_file(p_load_data.file_mapping)
+			p_load_data.file_mapping = {}
+		}
+
+		if decompressed == false {
+			delete(data_block, G_ALLOCATORS.main_allocator)
+			log.warnf("Failed to load mesh '%s' - couldn't decompress data\n", mesh_name)
+			return false
+		}
+
+		p_load_data.data_block = data_block
+		p_load_data.mesh_data = data_block
+	}
+
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+mesh_load_data_release :: proc(p_load_data: ^MeshLoadData) {
+	if p_load_data.file_mapping.mapped_ptr != nil {
+		common.unmap_file(p_load_data.file_mapping)
+		p_load_data.file_mapping = {}
+	}
+	delete(p_load_data.data_block, G_ALLOCATORS.main_allocator)
+	p_load_data.data_block = nil
+	p_load_data.mesh_data = nil
+}
+
+//---------------------------------------------------------------------------//
+
+// Creates the renderer mesh from the loaded data, has to run on the main thread.
+// The materials of the submeshes have to be loaded already.
+@(private = "file")
+mesh_asset_create_from_load_data :: proc(
+	p_mesh_asset_name: common.Name,
+	p_load_data: ^MeshLoadData,
+) -> (
+	renderer.MeshRef,
+	bool,
+) {
+	mesh_metadata := &p_load_data.metadata
+
+	// Create renderer mesh
+	mesh_resource_ref := renderer.mesh_allocate(
+		p_mesh_asset_name,
+		u32(len(mesh_metadata.sub_meshes)),
+	)
+	mesh_resource_idx := renderer.mesh_get_idx(mesh_resource_ref)
+	mesh_resource := &renderer.g_resources.meshes[mesh_resource_idx]
+	mesh_resource.desc.data_allocator = G_ALLOCATORS.main_allocator
+	mesh_resource.desc.file_mapping = p_load_data.file_mapping
+	mesh_resource.desc.data_block = p_load_data.data_block
+
+	current_data_ptr := raw_data(p_load_data.mesh_data)
+
+	// Setup index pointer
+	if .IndexedDraw in mesh_metadata.feature_flags {
+		mesh_resource.desc.flags += {.Indexed}
+		mesh_resource.desc.indices = slice.from_ptr(
+			(^u32)(current_data_ptr),
+			int(mesh_metadata.num_indices),
+		)
+
+		current_data_ptr = mem.ptr_offset(current_data_ptr, (mesh_metadata.total_index_size))
+	}
+
+	// Setup vertex pointers, older assets store the attributes as floats, they're packed below
+	is_packed := .PackedVertices in mesh_metadata.feature_flags
+	num_vertices := int(mesh_metadata.num_vertices)
+
+	positions: []glsl.vec3
+	normals: []glsl.vec3
+	tangents: []glsl.vec3
+	uvs: []glsl.vec2
+
+	// Setup positions pointer
+	if is_packed {
+		mesh_resource.desc.position = slice.from_ptr((^[4]u16)(current_data_ptr), num_vertices)
+		current_data_ptr = mem.ptr_offset(current_data_ptr, size_of([4]u16) * num_vertices)
+	} else {
+		positions = slice.from_ptr((^glsl.vec3)(current_data_ptr), num_vertices)
+		current_data_ptr = mem.ptr_offset(current_data_ptr, size_of(glsl.vec3) * num_vertices)
+	}
+
+	// Setup normals pointer
+	if .Normal in mesh_metadata.feature_flags {
+		mesh_resource.desc.features += {.Normal}
+
+		if is_packed {
+			mesh_resource.desc.normal = slice.from_ptr((^[2]i16)(current_data_ptr), num_vertices)
+			current_data_ptr = mem.ptr_offset(current_data_ptr, size_of([2]i16) * num_vertices)
+		} else {
+			normals = slice.from_ptr((^glsl.vec3)(current_data_ptr), num_vertices)
+			current_data_ptr = mem.ptr_offset(current_data_ptr, size_of(glsl.vec3) * num_vertices)
+		}
+	}
+
+	// Setup tangents pointer
+	if .Tangent in mesh_metadata.feature_flags {
+		mesh_resource.desc.features += {.Tangent}
+
+		if is_packed {
+			mesh_resource.desc.tangent = slice.from_ptr((^[2]i16)(current_data_ptr), num_vertices)
+			current_data_ptr = mem.ptr_offset(current_data_ptr, size_of([2]i16) * num_vertices)
+		} else {
+			tangents = slice.from_ptr((^glsl.vec3)(current_data_ptr), num_vertices)
+			current_data_ptr = mem.ptr_offset(current_data_ptr, size_of(glsl.vec3) * num_vertices)
+		}
+	}
+
+	// Setup uvs pointer
+	if .UV in mesh_metadata.feature_flags {
+		mesh_resource.desc.features += {.UV}
+
+		if is_packed {
+			mesh_resource.desc.uv = slice.from_ptr((^[2]f16)(current_data_ptr), num_vertices)
+			current_data_ptr = mem.ptr_offset(current_data_ptr, size_of([2]f16) * num_vertices)
+		} else {
+			uvs = slice.from_ptr((^glsl.vec2)(current_data_ptr), num_vertices)
+			current_data_ptr = mem.ptr_offset(current_data_ptr, size_of(glsl.vec2) * num_vertices)
+		}
+	}
+
+	// Setup meshlets pointers
+	if .Meshlets in mesh_metadata.feature_flags {
+		mesh_resource.desc.meshlets = slice.from_ptr(
+			(^renderer.Meshlet)(current_data_ptr),
+			int(mesh_metadata.num_meshlets),
+		)
+		current_data_ptr = mem.ptr_offset(
+			current_data_ptr,
+			size_of(renderer.Meshlet) * mesh_metadata.num_meshlets,
+		)
+
+		mesh_resource.desc.meshlet_vertices = slice.from_ptr(
+			(^u32)(current_data_ptr),
+			int(mesh_metadata.num_meshlet_vertices),
+		)
+		current_data_ptr = mem.ptr_offset(
+			current_data_ptr,
+			size_of(u32) * mesh_metadata.num_meshlet_vertices,
+		)
+
+		mesh_resource.desc.meshlet_triangles = slice.from_ptr(
+			current_data_ptr,
+			int(mesh_metadata.meshlet_triangles_size),
+		)
+	}
+
+	// Setup submeshes information
+	for &sub_mesh_metadata, i in mesh_metadata.sub_meshes {
+
+		material_asset := material_asset_get(p_load_data.material_refs[i])
+
+		// Older metadata files don't store bounding boxes, calculate them from the vertex data
+		if mesh_metadata.version < 2 {
+			bounding_box := calculate_bounding_box(
+				positions[sub_mesh_metadata.vertex_offset:sub_mesh_metadata.vertex_offset +
+				sub_mesh_metadata.vertex_count],
+			)
+			sub_mesh_metadata.bounds_min = bounding_box.min
+			sub_mesh_metadata.bounds_max = bounding_box.max
+		}
+
+		mesh_resource.desc.sub_meshes[i] = renderer.SubMesh {
+			vertex_offset         = sub_mesh_metadata.vertex_offset,
+			vertex_count          = sub_mesh_metadata.vertex_count,
+			index_offset          = sub_mesh_metadata.index_offset,
+			index_count           = sub_mesh_metadata.index_count,
+			meshlet_offset        = sub_mesh_metadata.meshlet_offset,
+			meshlet_count         = sub_mesh_metadata.meshlet_count,
+			material_instance_ref = material_asset.material_instance_ref,
+			bounding_box          = {
+				min = sub_mesh_metadata.bounds_min,
+				max = sub_mesh_metadata.bounds_max,
+			},
+		}
+
+		renderer_sub_mesh := &mesh_resource.desc.sub_meshes[i]
+		renderer_sub_mesh.lods[0] = renderer.SubMeshLOD {
+			index_offset = sub_mesh_metadata.index_offset,
+			index_count  = sub_mesh_metadata.index_count,
+		}
+		renderer_sub_mesh.num_lods = 1
+
+		num_lods := min(len(sub_mesh_metadata.lods), renderer.MESH_MAX_LODS - 1)
+		for lod in sub_mesh_metadata.lods[:num_lods] {
+			renderer_sub_mesh.lods[renderer_sub_mesh.num_lods] = renderer.SubMeshLOD {
+				index_offset = lod.index_offset,
+				index_count  = lod.index_count,
+				error        = lod.error,
+			}
+			renderer_sub_mesh.num_lods += 1
+		}
+	}
+
+	if is_packed {
+		mesh_resource.desc.position_bounds = {
+			min = mesh_metadata.position_bounds_min,
+			max = mesh_metadata.position_bounds_max,
+		}
+	} else {
+		// Pack the vertices of older assets. The packed data and a copy of the indices are
+		// released by the renderer with the data allocator once they're uploaded.
+		mesh_resource.desc.position_bounds = calculate_bounding_box(positions)
+		packed_vertices, _ := mesh_pack_vertices(
+			positions,
+			normals,
+			tangents,
+			uvs,
+			mesh_resource.desc.position_bounds,
+			G_ALLOCATORS.main_allocator,
+		)
+		mesh_resource.desc.position = packed_vertices.positions
+		mesh_resource.desc.normal = packed_vertices.normals
+		mesh_resource.desc.tangent = packed_vertices.tangents
+		mesh_resource.desc.uv = packed_vertices.uvs
+		if mesh_resource.desc.indices != nil {
+			mesh_resource.desc.indices = slice.clone(
+				mesh_resource.desc.indices,
+				G_ALLOCATORS.main_allocator,
+			)
+		}
+	}
+
+	// Create the mesh resource
+	if renderer.mesh_create(mesh_resource_ref) == false {
+		mesh_resource.desc.file_mapping = {}
+		mesh_resource.desc.data_block = nil
+		mesh_load_data_release(p_load_data)
+		return renderer.InvalidMeshRef, false
+	}
+
+	// The meshlets were copied by the renderer
+	mesh_resource.desc.meshlets = nil
+	mesh_resource.desc.meshlet_vertices = nil
+	mesh_resource.desc.meshlet_triangles = nil
+
+	if is_packed {
+		// Safe to do, as the data is uploaded straight from the file mapping, the asset pack
+		// or the decompressed data, which are released once the upload finishes
+		mesh_resource.desc.position = nil
+		mesh_resource.desc.normal = nil
+		mesh_resource.desc.uv = nil
+		mesh_resource.desc.tangent = nil
+		mesh_resource.desc.indices = nil
+	} else {
+		// Nothing references the file or the decompressed data anymore
+		if mesh_resource.desc.file_mapping.mapped_ptr != nil {
+			common.unmap_file(mesh_resource.desc.file_mapping)
+			mesh_resource.desc.file_mapping = {}
+		}
+		delete(mesh_resource.desc.data_block, G_ALLOCATORS.main_allocator)
+		mesh_resource.desc.data_block = nil
+	}
+
+	return mesh_resource_ref, true
 }
 
 //---------------------------------------------------------------------------//
@@ -588,7 +1356,16 @@ mesh_asset_unload :: proc(p_mesh_asset_ref: MeshAssetRef) {
 	if mesh_asset.ref_count > 0 {
 		return
 	}
-	renderer.mesh_destroy(mesh_asset.mesh_ref)
+
+	// The load request releases the mesh once it finishes
+	if mesh_asset.load_state == .Loading {
+		return
+	}
+
+	if mesh_asset.load_state == .Loaded {
+		renderer.mesh_destroy(mesh_asset.mesh_ref)
+	}
+	common.ref_free(&G_MESH_ASSET_REF_ARRAY, p_mesh_asset_ref)
 }
 
 //---------------------------------------------------------------------------//
@@ -636,73 +1413,15 @@ assimp_load_node :: proc(
 			temp_arena.allocator,
 		)
 
-		// Create a new material asset for this submesh
-		material_props := MaterialPropertiesAssetJSON {
-			flags = 0,
-		}
+		// Create a new material asset for this submesh, unless another submesh already uses it
 		material_asset_name := common.create_name(material_name)
-		material_asset_ref := allocate_material_asset_ref(material_asset_name)
-		material_asset := material_asset_get(material_asset_ref)
-		material_asset.material_type_name = common.create_name("OpaquePBR")
-
-		if (material_asset_create(material_asset_ref) == false) {
-			return
+		if material_asset_name not_in p_import_ctx.material_indices {
+			if assimp_collect_material(assimp_material, material_asset_name, p_import_ctx) ==
+			   false {
+				return
+			}
 		}
 
-		// Set default scalar values
-		material_props.albedo = {1, 1, 1}
-		material_props.normal = {0, 1, 0}
-		material_props.roughness = 0.5
-		material_props.metalness = 0
-		material_props.occlusion = 1
-
-		// Import all of the textures for this submesh and set it in the material
-		assimp_material_import_texture(
-			assimp_material,
-			.AitexturetypeBaseColor,
-			p_import_ctx.mesh_dir,
-			&material_props.albedo_image_name,
-			&material_props.flags,
-			1 << 0,
-		)
-
-		assimp_material_import_texture(
-			assimp_material,
-			.AitexturetypeNormals,
-			p_import_ctx.mesh_dir,
-			&material_props.normal_image_name,
-			&material_props.flags,
-			1 << 1,
-		)
-		assimp_material_import_texture(
-			assimp_material,
-			.AitexturetypeDiffuseRoughness,
-			p_import_ctx.mesh_dir,
-			&material_props.roughness_image_name,
-			&material_props.flags,
-			1 << 2,
-		)
-		assimp_material_import_texture(
-			assimp_material,
-			.AitexturetypeMetalness,
-			p_import_ctx.mesh_dir,
-			&material_props.metalness_image_name,
-			&material_props.flags,
-			1 << 3,
-		)
-		assimp_material_import_texture(
-			assimp_material,
-			.AitexturetypeLightmap,
-			p_import_ctx.mesh_dir,
-			&material_props.occlusion_image_name,
-			&material_props.flags,
-			1 << 4,
-		)
-
-		// Save the newly created material asset
-		material_asset_save_new(material_asset_ref, material_props)
-		material_asset_unload(material_asset_ref)
-
 		// Set the material for this submesh
 		p_import_ctx.sub_meshes[p_import_ctx.current_sub_mesh].material_asset_name =
 			material_asset_name
@@ -780,6 +1499,11 @@ assimp_load_node :: proc(
 			p_import_ctx.curr_vtx += 1
 		}
 
+		// Calculate the mesh space bounding box of this submesh
+		sub_mesh.bounding_box = calculate_bounding_box(
+			p_import_ctx.positions[sub_mesh.vertex_offset:p_import_ctx.curr_vtx],
+		)
+
 		for j in 0 ..< assimp_mesh.mNumFaces {
 			for k in 0 ..< assimp_mesh.mFaces[j].mNumIndices {
 				idx := sub_mesh.vertex_offset + assimp_mesh.mFaces[j].mIndices[k]
@@ -799,47 +1523,717 @@ assimp_load_node :: proc(
 //---------------------------------------------------------------------------//
 
 @(private = "file")
-assimp_material_import_texture :: proc(
+assimp_collect_material :: proc(
 	p_assimp_material: ^assimp.Material,
-	p_assimp_texture_type: assimp.TextureType,
-	p_mesh_dir: string,
-	p_out_texture_name: ^string,
-	p_out_flags: ^u32,
-	p_texture_flag: u32,
-) {
-	temp_arena: common.Arena
-	common.temp_arena_init(&temp_arena)
-	defer common.arena_delete(temp_arena)
+	p_material_asset_name: common.Name,
+	p_import_ctx: ^MeshImportContext,
+) -> bool {
+	material_asset_ref := allocate_material_asset_ref(p_material_asset_name)
+	material_asset := material_asset_get(material_asset_ref)
+	material_asset.material_type_name = common.create_name("OpaquePBR")
+
+	if (material_asset_create(material_asset_ref) == false) {
+		return false
+	}
+
+	material_import := MaterialImport {
+		material_asset_ref = material_asset_ref,
+	}
 
+	for slot in MaterialTextureSlot {
+		material_import.texture_indices[slot] = assimp_collect_material_texture(
+			p_assimp_material,
+			slot,
+			p_import_ctx,
+		)
+	}
+
+	p_import_ctx.material_indices[p_material_asset_name] = u32(len(p_import_ctx.materials))
+	append(&p_import_ctx.materials, material_import)
+
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+// Adds the texture to the list of textures to import, unless another material already uses it.
+// Returns the index of the texture import or -1 when the material doesn't have this texture.
+@(private = "file")
+assimp_collect_material_texture :: proc(
+	p_assimp_material: ^assimp.Material,
+	p_slot: MaterialTextureSlot,
+	p_import_ctx: ^MeshImportContext,
+) -> i32 {
 	texture_path: assimp.String
-	assimp_get_material_texture(p_assimp_material, p_assimp_texture_type, &texture_path)
+	assimp_get_material_texture(
+		p_assimp_material,
+		G_MATERIAL_TEXTURE_SLOT_ASSIMP_TYPES[p_slot],
+		&texture_path,
+	)
 
 	if texture_path.length == 0 {
-		return
+		return -1
 	}
 
 	texture_file_path := string(texture_path.data[:texture_path.length])
-	if filepath.is_abs(texture_file_path) == false {
-		texture_file_path = filepath.join({p_mesh_dir, texture_file_path}, temp_arena.allocator)
+	if filepath.is_abs(texture_file_path) {
+		texture_file_path = strings.clone(texture_file_path, p_import_ctx.allocator)
+	} else {
+		texture_file_path = filepath.join(
+			{p_import_ctx.mesh_dir, texture_file_path},
+			p_import_ctx.allocator,
+		)
+	}
+
+	if texture_idx, found := p_import_ctx.texture_indices[texture_file_path]; found {
+		return texture_idx
 	}
 
 	texture_import_options := TextureAssetImportOptions {
 		file_path = texture_file_path,
 	}
 
-	if p_assimp_texture_type == .AitexturetypeBaseColor{
+	if p_slot == .Albedo {
 		texture_import_options.flags += {.IsColor}
 	}
 
-	if p_assimp_texture_type == .AitexturetypeNormals {
+	if p_slot == .Normal {
 		texture_import_options.flags += {.IsNormalMap}
 	}
 
-	import_result := texture_asset_import(texture_import_options)
-	if import_result.status != .Error {
-		p_out_texture_name^ = common.get_string(import_result.name)
-		p_out_flags^ |= p_texture_flag
+	texture_idx := i32(len(p_import_ctx.texture_imports))
+	append(&p_import_ctx.texture_imports, texture_import_options)
+	p_import_ctx.texture_indices[texture_file_path] = texture_idx
+
+	return texture_idx
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+material_import_create_properties :: proc(
+	p_material_import: MaterialImport,
+	p_texture_import_results: []AssetImportResult,
+) -> MaterialPropertiesAssetJSON {
+
+	// Set default scalar values
+	material_props := MaterialPropertiesAssetJSON {
+		flags     = 0,
+		albedo    = {1, 1, 1},
+		normal    = {0, 1, 0},
+		roughness = 0.5,
+		metalness = 0,
+		occlusion = 1,
+	}
+
+	// Set the textures that were imported successfully
+	for texture_idx, slot in p_material_import.texture_indices {
+		if texture_idx < 0 || p_texture_import_results[texture_idx].status == .Error {
+			continue
+		}
+
+		texture_name := common.get_string(p_texture_import_results[texture_idx].name)
+		material_props.flags |= 1 << u32(slot)
+
+		switch slot {
+		case .Albedo:
+			material_props.albedo_image_name = texture_name
+		case .Normal:
+			material_props.normal_image_name = texture_name
+		case .Roughness:
+			material_props.roughness_image_name = texture_name
+		case .Metalness:
+			material_props.metalness_image_name = texture_name
+		case .Occlusion:
+			material_props.occlusion_image_name = texture_name
+		}
+	}
+
+	return material_props
+}
+
+//---------------------------------------------------------------------------//
+
+// Optimizes the submeshes in the given range, builds their meshlets and LODs,
+// each submesh owns its range of vertices and indices
+@(private = "file")
+mesh_optimize_sub_meshes :: proc(p_start: u32, p_end: u32, p_user_data: rawptr) {
+	job_data := (^MeshOptimizeJobData)(p_user_data)
+	import_ctx := job_data.import_ctx
+
+	for i in p_start ..< p_end {
+		sub_mesh := &import_ctx.sub_meshes[i]
+		vertex_start := sub_mesh.vertex_offset
+		vertex_end := sub_mesh.vertex_offset + sub_mesh.vertex_count
+		indices := import_ctx.indices[sub_mesh.index_offset:][:sub_mesh.index_count]
+		positions := import_ctx.positions[vertex_start:vertex_end]
+
+		// The optimizer works with indices relative to the submesh
+		for &idx in indices {
+			idx -= vertex_start
+		}
+
+		job_data.stats_before[i] = mesh_optimizer_analyze(indices, positions)
+
+		mesh_optimize(
+			indices,
+			positions,
+			import_ctx.normals[vertex_start:vertex_end],
+			import_ctx.tangents[vertex_start:vertex_end],
+			import_ctx.uvs[vertex_start:vertex_end],
+		)
+
+		job_data.stats_after[i] = mesh_optimizer_analyze(indices, positions)
+
+		meshlets_build(indices, positions, &job_data.meshlets[i])
+
+		if .GenerateLODs in import_ctx.import_flags {
+			sub_mesh.num_lods = mesh_simplifier_build_lod_chain(
+				indices,
+				positions,
+				&job_data.lod_indices[i],
+				&sub_mesh.lods,
+			)
+		} else {
+			sub_mesh.lods[0] = renderer.SubMeshLOD {
+				index_count = sub_mesh.index_count,
+			}
+			sub_mesh.num_lods = 1
+		}
+		sub_mesh.lods[0].index_offset = sub_mesh.index_offset
+
+		for &idx in indices {
+			idx += vertex_start
+		}
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+// Writes the metadata and the vertex/index data of the mesh, safe to run on any thread
+@(private = "file")
+mesh_write_job :: proc(p_user_data: rawptr) {
+	job_data := (^MeshWriteJobData)(p_user_data)
+	job_data.success = mesh_write_files(
+		job_data.import_ctx,
+		job_data.metadata,
+		job_data.mesh_asset_path,
+		job_data.mesh_metadata_file_path,
+	)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+mesh_write_files :: proc(
+	p_import_ctx: ^MeshImportContext,
+	p_metadata: ^MeshAssetMetadata,
+	p_mesh_asset_path: string,
+	p_mesh_metadata_file_path: string,
+) -> bool {
+
+	temp_arena: common.Arena
+	common.temp_arena_init(&temp_arena, common.MEGABYTE)
+	defer common.arena_delete(temp_arena)
+
+	// Data streams, in the order they're stored in the file
+	streams := make([dynamic][]byte, 0, 8, temp_arena.allocator)
+
+	if .IndexedDraw in p_import_ctx.mesh_feature_flags {
+		append(&streams, mem.slice_to_bytes(p_import_ctx.indices))
+	}
+
+	packed_vertices := &p_import_ctx.packed_vertices
+
+	append(&streams, mem.slice_to_bytes(packed_vertices.positions))
+
+	if .Normal in p_import_ctx.mesh_feature_flags {
+		append(&streams, mem.slice_to_bytes(packed_vertices.normals))
+	}
+
+	if .Tangent in p_import_ctx.mesh_feature_flags {
+		append(&streams, mem.slice_to_bytes(packed_vertices.tangents))
+	}
+
+	if .UV in p_import_ctx.mesh_feature_flags {
+		append(&streams, mem.slice_to_bytes(packed_vertices.uvs))
+	}
+
+	if .Meshlets in p_import_ctx.mesh_feature_flags {
+		meshlets := &p_import_ctx.meshlets
+		append(&streams, mem.slice_to_bytes(meshlets.meshlets[:]))
+		append(&streams, mem.slice_to_bytes(meshlets.vertices[:]))
+		append(&streams, meshlets.triangles[:])
+	}
+
+	// Replace the streams with the compressed blocks, the block table is saved with the metadata
+	if .CompressData in p_import_ctx.import_flags {
+		data_size := 0
+		for stream in streams {
+			data_size += len(stream)
+		}
+
+		data := make([]byte, data_size, G_ALLOCATORS.main_allocator)
+		defer delete(data, G_ALLOCATORS.main_allocator)
+
+		data_offset := 0
+		for stream in streams {
+			copy(data[data_offset:], stream)
+			data_offset += len(stream)
+		}
+
+		compressed, blocks := mesh_blob_compress(
+			data,
+			mesh_get_blob_sections(p_metadata, temp_arena.allocator),
+			G_ALLOCATORS.main_allocator,
+		)
+		defer delete(compressed, G_ALLOCATORS.main_allocator)
+		defer delete(blocks, G_ALLOCATORS.main_allocator)
+
+		p_metadata.compressed_blocks = blocks
+		p_metadata.version = G_METADATA_FILE_VERSION_COMPRESSED_DATA
+		defer p_metadata.compressed_blocks = nil
+
+		clear(&streams)
+		append(&streams, compressed)
+
+		log.infof(
+			"Compressed mesh '%s' - %d -> %d bytes in %d blocks\n",
+			p_import_ctx.mesh_name,
+			len(data),
+			len(compressed),
+			len(blocks),
+		)
+	}
+
+	if common.write_json_file(
+		   p_mesh_metadata_file_path,
+		   MeshAssetMetadata,
+		   p_metadata^,
+		   temp_arena.allocator,
+	   ) ==
+	   false {
+		log.warnf("Failed to save mesh '%s' - couldn't save metadata\n", p_import_ctx.mesh_name)
+		return false
 	}
+
+	// Save the data itself
+	fd, err := os.open(p_mesh_asset_path, os.O_WRONLY | os.O_CREATE)
+	if err != 0 {
+		os.remove(p_mesh_metadata_file_path)
+		log.warnf(
+			"Failed to save mesh '%s' - couldn't open file %s\n",
+			p_import_ctx.mesh_name,
+			p_mesh_asset_path,
+		)
+
+		return false
+	}
+	defer os.close(fd)
+
+	for stream in streams {
+		os.write(fd, stream)
+	}
+
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+mesh_read_metadata :: proc(
+	p_mesh_name: string,
+	p_metadata: ^MeshAssetMetadata,
+	p_allocator: mem.Allocator,
+) -> bool {
+	mesh_metadata_file_path := common.aprintf(
+		p_allocator,
+		"%s%s.metadata",
+		G_MESH_ASSETS_DIR,
+		p_mesh_name,
+	)
+	mesh_metadata_json, success := os.read_entire_file(mesh_metadata_file_path, p_allocator)
+	if !success {
+		log.warnf("Failed to load mesh '%s' - couldn't load metadata\n", p_mesh_name)
+		return false
+	}
+	err := json.unmarshal(mesh_metadata_json, p_metadata, .JSON5, p_allocator)
+	if err != nil {
+		log.warnf("Failed to load mesh '%s' - couldn't read metadata\n", p_mesh_name)
+		return false
+	}
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+// Adds all of the meshes to the asset pack, the data files are stored as they are
+@(private)
+mesh_asset_cook :: proc(p_builder: ^AssetPackBuilder) -> bool {
+	temp_arena: common.Arena
+	common.temp_arena_init(&temp_arena, common.MEGABYTE)
+	defer common.arena_delete(temp_arena)
+
+	mesh_names := asset_pack_collect_asset_names(G_MESH_ASSETS_DIR, temp_arena.allocator)
+	for mesh_name in mesh_names {
+		mesh_metadata: MeshAssetMetadata
+		if mesh_read_metadata(mesh_name, &mesh_metadata, temp_arena.allocator) == false {
+			return false
+		}
+
+		mesh_path := asset_create_path(
+			G_MESH_ASSETS_DIR,
+			common.create_name(mesh_name),
+			"bin",
+			temp_arena.allocator,
+		)
+
+		if asset_pack_builder_add(
+			   p_builder,
+			   .Mesh,
+			   mesh_name,
+			   mesh_metadata.uuid,
+			   mesh_write_pack_metadata(&mesh_metadata, temp_arena.allocator),
+			   mesh_path,
+		   ) ==
+		   false {
+			return false
+		}
+	}
+
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+// Metadata of a mesh in the asset pack. It's followed by the submeshes, the LODs
+// of all submeshes and the compressed blocks, each array is aligned to 16 bytes.
+@(private = "file")
+MeshAssetPackMetadata :: struct {
+	base:                   AssetMetadataBase,
+	feature_flags:          MeshFeatureFlags,
+	total_vertex_size:      u32,
+	total_index_size:       u32,
+	num_vertices:           u32,
+	num_indices:            u32,
+	num_meshlets:           u32,
+	num_meshlet_vertices:   u32,
+	meshlet_triangles_size: u32,
+	position_bounds_min:    glsl.vec3,
+	position_bounds_max:    glsl.vec3,
+	num_sub_meshes:         u32,
+	num_lods:               u32,
+	num_compressed_blocks:  u32,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+SubMeshPackMetadata :: struct {
+	vertex_offset:       u32,
+	vertex_count:        u32,
+	index_offset:        u32,
+	index_count:         u32,
+	meshlet_offset:      u32,
+	meshlet_count:       u32,
+	material_asset_name: common.Name,
+	bounds_min:          glsl.vec3,
+	bounds_max:          glsl.vec3,
+	// Range of the LODs of this submesh
+	lod_offset:          u32,
+	lod_count:           u32,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+MeshPackMetadataLayout :: struct {
+	sub_meshes_offset: int,
+	lods_offset:       int,
+	blocks_offset:     int,
+	size:              int,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+mesh_get_pack_metadata_layout :: proc(
+	p_num_sub_meshes: u32,
+	p_num_lods: u32,
+	p_num_compressed_blocks: u32,
+) -> (
+	layout: MeshPackMetadataLayout,
+) {
+	layout.sub_meshes_offset = mem.align_forward_int(size_of(MeshAssetPackMetadata), 16)
+	layout.lods_offset = mem.align_forward_int(
+		layout.sub_meshes_offset + int(p_num_sub_meshes) * size_of(SubMeshPackMetadata),
+		16,
+	)
+	layout.blocks_offset = mem.align_forward_int(
+		layout.lods_offset + int(p_num_lods) * size_of(SubMeshLODMetadata),
+		16,
+	)
+	layout.size = layout.blocks_offset + int(p_num_compressed_blocks) * size_of(MeshBlobBlock)
+	return layout
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+mesh_write_pack_metadata :: proc(
+	p_metadata: ^MeshAssetMetadata,
+	p_allocator: mem.Allocator,
+) -> []byte {
+	num_lods := u32(0)
+	for sub_mesh in p_metadata.sub_meshes {
+		num_lods += u32(len(sub_mesh.lods))
+	}
+
+	num_sub_meshes := u32(len(p_metadata.sub_meshes))
+	num_compressed_blocks := u32(len(p_metadata.compressed_blocks))
+	layout := mesh_get_pack_metadata_layout(num_sub_meshes, num_lods, num_compressed_blocks)
+
+	data := make([]byte, layout.size, p_allocator)
+
+	(^MeshAssetPackMetadata)(raw_data(data))^ = MeshAssetPackMetadata {
+		base                   = p_metadata.base,
+		feature_flags          = p_metadata.feature_flags,
+		total_vertex_size      = p_metadata.total_vertex_size,
+		total_index_size       = p_metadata.total_index_size,
+		num_vertices           = p_metadata.num_vertices,
+		num_indices            = p_metadata.num_indices,
+		num_meshlets           = p_metadata.num_meshlets,
+		num_meshlet_vertices   = p_metadata.num_meshlet_vertices,
+		meshlet_triangles_size = p_metadata.meshlet_triangles_size,
+		position_bounds_min    = p_metadata.position_bounds_min,
+		position_bounds_max    = p_metadata.position_bounds_max,
+		num_sub_meshes         = num_sub_meshes,
+		num_lods               = num_lods,
+		num_compressed_blocks  = num_compressed_blocks,
+	}
+
+	sub_meshes := common.slice_cast(
+		SubMeshPackMetadata,
+		data,
+		u32(layout.sub_meshes_offset),
+		num_sub_meshes,
+	)
+	lods := common.slice_cast(SubMeshLODMetadata, data, u32(layout.lods_offset), num_lods)
+	compressed_blocks := common.slice_cast(
+		MeshBlobBlock,
+		data,
+		u32(layout.blocks_offset),
+		num_compressed_blocks,
+	)
+
+	lod_offset := u32(0)
+	for sub_mesh, i in p_metadata.sub_meshes {
+		sub_meshes[i] = SubMeshPackMetadata {
+			vertex_offset       = sub_mesh.vertex_offset,
+			vertex_count        = sub_mesh.vertex_count,
+			index_offset        = sub_mesh.index_offset,
+			index_count         = sub_mesh.index_count,
+			meshlet_offset      = sub_mesh.meshlet_offset,
+			meshlet_count       = sub_mesh.meshlet_count,
+			material_asset_name = sub_mesh.material_asset_name,
+			bounds_min          = sub_mesh.bounds_min,
+			bounds_max          = sub_mesh.bounds_max,
+			lod_offset          = lod_offset,
+			lod_count           = u32(len(sub_mesh.lods)),
+		}
+		copy(lods[lod_offset:], sub_mesh.lods)
+		lod_offset += u32(len(sub_mesh.lods))
+	}
+
+	copy(compressed_blocks, p_metadata.compressed_blocks)
+
+	return data
+}
+
+//---------------------------------------------------------------------------//
+
+// The LODs and the compressed blocks point straight into the asset pack
+@(private = "file")
+mesh_read_pack_metadata :: proc(
+	p_pack_entry: ^AssetPackEntry,
+	p_metadata: ^MeshAssetMetadata,
+	p_allocator: mem.Allocator,
+) -> bool {
+	data := asset_pack_get_metadata(p_pack_entry)
+	if len(data) < size_of(MeshAssetPackMetadata) {
+		return false
+	}
+
+	pack_metadata := (^MeshAssetPackMetadata)(raw_data(data))
+	layout := mesh_get_pack_metadata_layout(
+		pack_metadata.num_sub_meshes,
+		pack_metadata.num_lods,
+		pack_metadata.num_compressed_blocks,
+	)
+	if len(data) != layout.size {
+		return false
+	}
+
+	sub_meshes := common.slice_cast(
+		SubMeshPackMetadata,
+		data,
+		u32(layout.sub_meshes_offset),
+		pack_metadata.num_sub_meshes,
+	)
+	lods := common.slice_cast(
+		SubMeshLODMetadata,
+		data,
+		u32(layout.lods_offset),
+		pack_metadata.num_lods,
+	)
+
+	p_metadata^ = MeshAssetMetadata {
+		base                   = pack_metadata.base,
+		feature_flags          = pack_metadata.feature_flags,
+		sub_meshes             = make([]SubMeshMetadata, len(sub_meshes), p_allocator),
+		total_vertex_size      = pack_metadata.total_vertex_size,
+		total_index_size       = pack_metadata.total_index_size,
+		num_vertices           = pack_metadata.num_vertices,
+		num_indices            = pack_metadata.num_indices,
+		num_meshlets           = pack_metadata.num_meshlets,
+		num_meshlet_vertices   = pack_metadata.num_meshlet_vertices,
+		meshlet_triangles_size = pack_metadata.meshlet_triangles_size,
+		position_bounds_min    = pack_metadata.position_bounds_min,
+		position_bounds_max    = pack_metadata.position_bounds_max,
+		compressed_blocks      = common.slice_cast(
+			MeshBlobBlock,
+			data,
+			u32(layout.blocks_offset),
+			pack_metadata.num_compressed_blocks,
+		),
+	}
+
+	for sub_mesh, i in sub_meshes {
+		if sub_mesh.lod_offset + sub_mesh.lod_count > pack_metadata.num_lods {
+			return false
+		}
+
+		p_metadata.sub_meshes[i] = SubMeshMetadata {
+			vertex_offset       = sub_mesh.vertex_offset,
+			vertex_count        = sub_mesh.vertex_count,
+			index_offset        = sub_mesh.index_offset,
+			index_count         = sub_mesh.index_count,
+			meshlet_offset      = sub_mesh.meshlet_offset,
+			meshlet_count       = sub_mesh.meshlet_count,
+			material_asset_name = sub_mesh.material_asset_name,
+			bounds_min          = sub_mesh.bounds_min,
+			bounds_max          = sub_mesh.bounds_max,
+			lods                = lods[sub_mesh.lod_offset:][:sub_mesh.lod_count],
+		}
+	}
+
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+// Sections of the mesh data, in the order they're stored in the file
+@(private = "file")
+mesh_get_blob_sections :: proc(
+	p_metadata: ^MeshAssetMetadata,
+	p_allocator: mem.Allocator,
+) -> []MeshBlobSection {
+	sections := make([dynamic]MeshBlobSection, 0, 8, p_allocator)
+
+	if .IndexedDraw in p_metadata.feature_flags {
+		append(
+			&sections,
+			MeshBlobSection {
+				size = p_metadata.total_index_size,
+				filter = .IndexDelta,
+				element_size = size_of(u32),
+			},
+		)
+	}
+
+	// Byte planes are split per component, older assets store the attributes as floats
+	num_vertices := p_metadata.num_vertices
+	position_size := u32(size_of([4]u16))
+	direction_size := u32(size_of([2]i16))
+	uv_size := u32(size_of([2]f16))
+	component_size := u32(size_of(u16))
+	if .PackedVertices not_in p_metadata.feature_flags {
+		position_size = size_of(glsl.vec3)
+		direction_size = size_of(glsl.vec3)
+		uv_size = size_of(glsl.vec2)
+		component_size = size_of(f32)
+	}
+
+	append(
+		&sections,
+		MeshBlobSection {
+			size = position_size * num_vertices,
+			filter = .BytePlanes,
+			element_size = component_size,
+		},
+	)
+
+	if .Normal in p_metadata.feature_flags {
+		append(
+			&sections,
+			MeshBlobSection {
+				size = direction_size * num_vertices,
+				filter = .BytePlanes,
+				element_size = component_size,
+			},
+		)
+	}
+
+	if .Tangent in p_metadata.feature_flags {
+		append(
+			&sections,
+			MeshBlobSection {
+				size = direction_size * num_vertices,
+				filter = .BytePlanes,
+				element_size = component_size,
+			},
+		)
+	}
+
+	if .UV in p_metadata.feature_flags {
+		append(
+			&sections,
+			MeshBlobSection {
+				size = uv_size * num_vertices,
+				filter = .BytePlanes,
+				element_size = component_size,
+			},
+		)
+	}
+
+	if .Meshlets in p_metadata.feature_flags {
+		append(
+			&sections,
+			MeshBlobSection {
+				size = size_of(renderer.Meshlet) * p_metadata.num_meshlets,
+				filter = .BytePlanes,
+				element_size = size_of(u32),
+			},
+		)
+		append(
+			&sections,
+			MeshBlobSection {
+				size = size_of(u32) * p_metadata.num_meshlet_vertices,
+				filter = .IndexDelta,
+				element_size = size_of(u32),
+			},
+		)
+		append(
+			&sections,
+			MeshBlobSection {
+				size = p_metadata.meshlet_triangles_size,
+				filter = .None,
+				element_size = 1,
+			},
+		)
+	}
+
+	return sections[:]
 }
 
 //---------------------------------------------------------------------------//
@@ -865,3 +2259,162 @@ assimp_get_material_texture :: #force_inline proc(
 }
 
 //---------------------------------------------------------------------------//
+
+@(private = "file")
+calculate_bounding_box :: proc(p_positions: []glsl.vec3) -> renderer.BoundingBox {
+	if len(p_positions) == 0 {
+		return {}
+	}
+
+	bounding_box := renderer.BoundingBox {
+		min = p_positions[0],
+		max = p_positions[0],
+	}
+
+	for position in p_positions[1:] {
+		bounding_box.min = glsl.min(bounding_box.min, position)
+		bounding_box.max = glsl.max(bounding_box.max, position)
+	}
+
+	return bounding_box
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+MESH_COMPRESSION_BENCHMARK_DECODE_ITERATIONS :: 10
+
+//---------------------------------------------------------------------------//
+
+// Compresses the mesh data files found in the assets directory and measures the compression
+// ratio and the decoding speed, on a single thread and on all of the job system threads
+mesh_compression_run_benchmark :: proc() {
+
+	mesh_paths, glob_err := filepath.glob(G_MESH_ASSETS_DIR + "*.bin", G_ALLOCATORS.main_allocator)
+	defer {
+		for path in mesh_paths {
+			delete(path, G_ALLOCATORS.main_allocator)
+		}
+		delete(mesh_paths, G_ALLOCATORS.main_allocator)
+	}
+
+	if glob_err != .None || len(mesh_paths) == 0 {
+		log.warnf("Mesh compression benchmark: no meshes found in %s\n", G_MESH_ASSETS_DIR)
+		return
+	}
+
+	total_uncompressed_size := 0
+	total_compressed_size := 0
+	compress_duration: time.Duration
+	decode_duration_single_thread: time.Duration
+	decode_duration_parallel: time.Duration
+
+	for mesh_path in mesh_paths {
+		temp_arena: common.Arena
+		common.temp_arena_init(&temp_arena, common.MEGABYTE)
+		defer common.arena_delete(temp_arena)
+
+		mesh_name := filepath.short_stem(filepath.base(mesh_path))
+
+		mesh_metadata: MeshAssetMetadata
+		if mesh_read_metadata(mesh_name, &mesh_metadata, temp_arena.allocator) == false {
+			continue
+		}
+
+		data, read_ok := os.read_entire_file(mesh_path, G_ALLOCATORS.main_allocator)
+		if read_ok == false {
+			continue
+		}
+		defer delete(data, G_ALLOCATORS.main_allocator)
+
+		// Files that are already compressed are decoded first, so all meshes are measured the same way
+		if len(mesh_metadata.compressed_blocks) > 0 {
+			_, uncompressed_size := mesh_blob_get_sizes(mesh_metadata.compressed_blocks)
+			uncompressed_data := make([]byte, uncompressed_size, G_ALLOCATORS.main_allocator)
+			if mesh_blob_decompress(data, mesh_metadata.compressed_blocks, uncompressed_data) ==
+			   false {
+				delete(uncompressed_data, G_ALLOCATORS.main_allocator)
+				continue
+			}
+			delete(data, G_ALLOCATORS.main_allocator)
+			data = uncompressed_data
+		}
+
+		sections := mesh_get_blob_sections(&mesh_metadata, temp_arena.allocator)
+		sections_size := 0
+		for section in sections {
+			sections_size += int(section.size)
+		}
+		if sections_size != len(data) {
+			log.warnf(
+				"Mesh compression benchmark: size of '%s' doesn't match the metadata\n",
+				mesh_name,
+			)
+			continue
+		}
+
+		start := time.tick_now()
+		compressed, blocks := mesh_blob_compress(data, sections, G_ALLOCATORS.main_allocator)
+		compress_duration += time.tick_since(start)
+		defer delete(compressed, G_ALLOCATORS.main_allocator)
+		defer delete(blocks, G_ALLOCATORS.main_allocator)
+
+		decoded := make([]byte, len(data), G_ALLOCATORS.main_allocator)
+		defer delete(decoded, G_ALLOCATORS.main_allocator)
+
+		decode_ok := true
+
+		start = time.tick_now()
+		for _ in 0 ..< MESH_COMPRESSION_BENCHMARK_DECODE_ITERATIONS {
+			if mesh_blob_decompress(compressed, blocks, decoded, false) == false {
+				decode_ok = false
+			}
+		}
+		decode_duration_single_thread += time.tick_since(start)
+
+		start = time.tick_now()
+		for _ in 0 ..< MESH_COMPRESSION_BENCHMARK_DECODE_ITERATIONS {
+			if mesh_blob_decompress(compressed, blocks, decoded) == false {
+				decode_ok = false
+			}
+		}
+		decode_duration_parallel += time.tick_since(start)
+
+		if decode_ok == false || slice.equal(decoded, data) == false {
+			log.warnf("Mesh compression benchmark: '%s' doesn't match after decoding\n", mesh_name)
+			continue
+		}
+
+		log.infof(
+			"Mesh compression benchmark: '%s' %.2f MB -> %.2f MB (%.2fx) in %d blocks\n",
+			mesh_name,
+			f64(len(data)) / common.MEGABYTE,
+			f64(len(compressed)) / common.MEGABYTE,
+			f64(len(data)) / f64(max(len(compressed), 1)),
+			len(blocks),
+		)
+
+		total_uncompressed_size += len(data)
+		total_compressed_size += len(compressed)
+	}
+
+	if total_uncompressed_size == 0 {
+		return
+	}
+
+	decoded_gigabytes :=
+		f64(total_uncompressed_size * MESH_COMPRESSION_BENCHMARK_DECODE_ITERATIONS) / 1e9
+
+	log.infof(
+		"Mesh compression benchmark: %.2f MB -> %.2f MB (%.2fx), compression: %.1f MB/s, decoding: %.2f GB/s on 1 thread, %.2f GB/s on %d threads\n",
+		f64(total_uncompressed_size) / common.MEGABYTE,
+		f64(total_compressed_size) / common.MEGABYTE,
+		f64(total_uncompressed_size) / f64(max(total_compressed_size, 1)),
+		f64(total_uncompressed_size) / common.MEGABYTE / time.duration_seconds(compress_duration),
+		decoded_gigabytes / time.duration_seconds(decode_duration_single_thread),
+		decoded_gigabytes / time.duration_seconds(decode_duration_parallel),
+		common.jobs_get_num_threads(),
+	)
+}
+
+//---------------------------------------------------------------------------//
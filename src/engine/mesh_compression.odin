@@ -0,0 +1,368 @@
+package engine
+
+//---------------------------------------------------------------------------//
+
+// Compression of the mesh data files. The data is made of sections (indices, vertex streams,
+// meshlets), each section is split into blocks that are filtered and then LZ4 compressed on
+// their own, so they can be decoded in parallel and in any order:
+// - IndexDelta - indices are stored as zigzag encoded deltas to the previous index of the block,
+//   which are small for meshes optimized for the vertex cache, and then split into byte planes,
+// - BytePlanes - bytes of the elements are grouped by their position in the element, so the slowly
+//   changing high bytes of the quantized vertex attributes end up next to each other.
+
+//---------------------------------------------------------------------------//
+
+import "core:mem"
+import "core:sync"
+
+import "../common"
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+MESH_BLOB_BLOCK_SIZE :: 256 * common.KILOBYTE
+
+//---------------------------------------------------------------------------//
+
+@(private)
+MeshBlobFilter :: enum u8 {
+	None,
+	IndexDelta,
+	BytePlanes,
+}
+
+//---------------------------------------------------------------------------//
+
+// Continuous range of the uncompressed data that uses the same filter
+@(private)
+MeshBlobSection :: struct {
+	size:         u32,
+	filter:       MeshBlobFilter,
+	element_size: u32,
+}
+
+//---------------------------------------------------------------------------//
+
+// Blocks that didn't compress are stored as is, in which case the sizes are the same
+@(private)
+MeshBlobBlock :: struct {
+	filter:              MeshBlobFilter `json:"filter"`,
+	element_size:        u32 `json:"elementSize"`,
+	uncompressed_offset: u32 `json:"uncompressedOffset"`,
+	uncompressed_size:   u32 `json:"uncompressedSize"`,
+	compressed_offset:   u32 `json:"compressedOffset"`,
+	compressed_size:     u32 `json:"compressedSize"`,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+MeshBlobCompressJobData :: struct {
+	data:           []byte,
+	blocks:         []MeshBlobBlock,
+	// Each block is compressed to it's own worst case sized range, they're compacted afterwards
+	compressed:     []byte,
+	output_offsets: []int,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+MeshBlobDecompressJobData :: struct {
+	compressed:        []byte,
+	blocks:            []MeshBlobBlock,
+	dst:               []byte,
+	num_failed_blocks: u32,
+}
+
+//---------------------------------------------------------------------------//
+
+// Compresses p_data, made of p_sections, into a single buffer allocated with p_allocator
+@(private)
+mesh_blob_compress :: proc(
+	p_data: []byte,
+	p_sections: []MeshBlobSection,
+	p_allocator: mem.Allocator,
+) -> (
+	compressed: []byte,
+	blocks: []MeshBlobBlock,
+) {
+	// Split the sections into blocks, the block size is kept a multiple of the element size
+	// so that the elements aren't split between the blocks
+	blocks_dynamic := make([dynamic]MeshBlobBlock, p_allocator)
+	section_offset := u32(0)
+	for section in p_sections {
+		element_size := max(section.element_size, 1)
+		max_block_size := (MESH_BLOB_BLOCK_SIZE / element_size) * element_size
+
+		for block_offset := u32(0); block_offset < section.size; block_offset += max_block_size {
+			append(
+				&blocks_dynamic,
+				MeshBlobBlock {
+					filter = section.filter,
+					element_size = element_size,
+					uncompressed_offset = section_offset + block_offset,
+					uncompressed_size = min(max_block_size, section.size - block_offset),
+				},
+			)
+		}
+
+		section_offset += section.size
+	}
+	assert(int(section_offset) == len(p_data))
+	blocks = blocks_dynamic[:]
+
+	output_offsets := make([]int, len(blocks), p_allocator)
+	defer delete(output_offsets, p_allocator)
+
+	output_size := 0
+	for block, i in blocks {
+		output_offsets[i] = output_size
+		output_size += common.lz4_compress_bound(int(block.uncompressed_size))
+	}
+
+	job_data := MeshBlobCompressJobData {
+		data           = p_data,
+		blocks         = blocks,
+		compressed     = make([]byte, output_size, p_allocator),
+		output_offsets = output_offsets,
+	}
+	defer delete(job_data.compressed, p_allocator)
+
+	common.jobs_parallel_for(u32(len(blocks)), 1, mesh_blob_compress_blocks, &job_data)
+
+	// Pack the compressed blocks together
+	compressed_size := 0
+	for block in blocks {
+		compressed_size += int(block.compressed_size)
+	}
+
+	compressed = make([]byte, compressed_size, p_allocator)
+	compressed_offset := u32(0)
+	for &block, i in blocks {
+		block_start := output_offsets[i]
+		copy(
+			compressed[compressed_offset:],
+			job_data.compressed[block_start:block_start + int(block.compressed_size)],
+		)
+		block.compressed_offset = compressed_offset
+		compressed_offset += block.compressed_size
+	}
+
+	return compressed, blocks
+}
+
+//---------------------------------------------------------------------------//
+
+// Decodes the blocks into p_dst, which has the size of the uncompressed data.
+// The blocks are decoded by the job system unless p_parallel is false.
+@(private)
+mesh_blob_decompress :: proc(
+	p_compressed: []byte,
+	p_blocks: []MeshBlobBlock,
+	p_dst: []byte,
+	p_parallel := true,
+) -> bool {
+	// Validate the ranges first, as the block table comes from the metadata file
+	for block in p_blocks {
+		if block.uncompressed_size > MESH_BLOB_BLOCK_SIZE ||
+		   int(block.uncompressed_offset) + int(block.uncompressed_size) > len(p_dst) ||
+		   int(block.compressed_offset) + int(block.compressed_size) > len(p_compressed) ||
+		   block.element_size == 0 {
+			return false
+		}
+	}
+
+	job_data := MeshBlobDecompressJobData {
+		compressed = p_compressed,
+		blocks     = p_blocks,
+		dst        = p_dst,
+	}
+
+	if p_parallel {
+		common.jobs_parallel_for(u32(len(p_blocks)), 1, mesh_blob_decompress_blocks, &job_data)
+	} else {
+		mesh_blob_decompress_blocks(0, u32(len(p_blocks)), &job_data)
+	}
+
+	return job_data.num_failed_blocks == 0
+}
+
+//---------------------------------------------------------------------------//
+
+// Returns the size of the compressed and uncompressed data described by the blocks
+@(private)
+mesh_blob_get_sizes :: proc(
+	p_blocks: []MeshBlobBlock,
+) -> (
+	compressed_size: int,
+	uncompressed_size: int,
+) {
+	for block in p_blocks {
+		compressed_size = max(
+			compressed_size,
+			int(block.compressed_offset) + int(block.compressed_size),
+		)
+		uncompressed_size = max(
+			uncompressed_size,
+			int(block.uncompressed_offset) + int(block.uncompressed_size),
+		)
+	}
+	return compressed_size, uncompressed_size
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+mesh_blob_compress_blocks :: proc(p_start: u32, p_end: u32, p_user_data: rawptr) {
+	job_data := (^MeshBlobCompressJobData)(p_user_data)
+
+	temp_arena: common.Arena
+	common.temp_arena_init(
+		&temp_arena,
+		MESH_BLOB_BLOCK_SIZE + common.LZ4_HASH_TABLE_SIZE * size_of(i32) + common.KILOBYTE,
+	)
+	defer common.arena_delete(temp_arena)
+
+	filtered := make([]byte, MESH_BLOB_BLOCK_SIZE, temp_arena.allocator)
+	hash_table := make([]i32, common.LZ4_HASH_TABLE_SIZE, temp_arena.allocator)
+
+	for &block, i in job_data.blocks[p_start:p_end] {
+		src := job_data.data[block.uncompressed_offset:][:block.uncompressed_size]
+		block_filtered := filtered[:block.uncompressed_size]
+
+		switch block.filter {
+		case .None:
+			copy(block_filtered, src)
+		case .IndexDelta:
+			filter_index_delta(src, block_filtered)
+		case .BytePlanes:
+			filter_byte_planes(src, block_filtered, int(block.element_size))
+		}
+
+		output_offset := job_data.output_offsets[int(p_start) + i]
+		output := job_data.compressed[output_offset:][:common.lz4_compress_bound(len(src))]
+		compressed_size := common.lz4_compress_block(block_filtered, output, hash_table)
+
+		// Store the block as is if it doesn't compress
+		if compressed_size >= len(src) {
+			copy(output, src)
+			block.filter = .None
+			compressed_size = len(src)
+		}
+
+		block.compressed_size = u32(compressed_size)
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+mesh_blob_decompress_blocks :: proc(p_start: u32, p_end: u32, p_user_data: rawptr) {
+	job_data := (^MeshBlobDecompressJobData)(p_user_data)
+
+	temp_arena: common.Arena
+	common.temp_arena_init(&temp_arena, MESH_BLOB_BLOCK_SIZE + common.KILOBYTE)
+	defer common.arena_delete(temp_arena)
+
+	scratch := make([]byte, MESH_BLOB_BLOCK_SIZE, temp_arena.allocator)
+
+	for block in job_data.blocks[p_start:p_end] {
+		src := job_data.compressed[block.compressed_offset:][:block.compressed_size]
+		dst := job_data.dst[block.uncompressed_offset:][:block.uncompressed_size]
+
+		if block.compressed_size == block.uncompressed_size {
+			copy(dst, src)
+			continue
+		}
+
+		// Unfiltered blocks are decoded in place, the rest goes through the scratch buffer
+		decoded := dst if block.filter == .None else scratch[:block.uncompressed_size]
+
+		decoded_size, ok := common.lz4_decompress_block(src, decoded)
+		if ok == false || decoded_size != len(decoded) {
+			sync.atomic_add(&job_data.num_failed_blocks, 1)
+			continue
+		}
+
+		switch block.filter {
+		case .None:
+		case .IndexDelta:
+			unfilter_index_delta(decoded, dst)
+		case .BytePlanes:
+			unfilter_byte_planes(decoded, dst, int(block.element_size))
+		}
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+filter_index_delta :: proc(p_src: []byte, p_dst: []byte) {
+	num_indices := len(p_src) / size_of(u32)
+	src_indices := ([^]u32)(raw_data(p_src))[:num_indices]
+
+	// Keep the deltas in the first part of the destination, it's then split into byte planes
+	temp_arena: common.Arena
+	common.temp_arena_init(&temp_arena, u32(len(p_src)) + common.KILOBYTE)
+	defer common.arena_delete(temp_arena)
+
+	deltas := make([]u32, num_indices, temp_arena.allocator)
+	prev_index := u32(0)
+	for index, i in src_indices {
+		delta := i32(index - prev_index)
+		deltas[i] = u32((delta << 1) ~ (delta >> 31))
+		prev_index = index
+	}
+
+	filter_byte_planes(mem.slice_to_bytes(deltas), p_dst, size_of(u32))
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+unfilter_index_delta :: proc(p_src: []byte, p_dst: []byte) {
+	unfilter_byte_planes(p_src, p_dst, size_of(u32))
+
+	num_indices := len(p_dst) / size_of(u32)
+	indices := ([^]u32)(raw_data(p_dst))[:num_indices]
+
+	prev_index := u32(0)
+	for &index in indices {
+		delta := (index >> 1) ~ (0 - (index & 1))
+		index = prev_index + delta
+		prev_index = index
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+// Bytes that don't make a full element are kept at the end as they are
+@(private = "file")
+filter_byte_planes :: proc(p_src: []byte, p_dst: []byte, p_element_size: int) {
+	num_elements := len(p_src) / p_element_size
+	for i in 0 ..< num_elements {
+		for b in 0 ..< p_element_size {
+			p_dst[b * num_elements + i] = p_src[i * p_element_size + b]
+		}
+	}
+	tail_offset := num_elements * p_element_size
+	copy(p_dst[tail_offset:], p_src[tail_offset:])
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+unfilter_byte_planes :: proc(p_src: []byte, p_dst: []byte, p_element_size: int) {
+	num_elements := len(p_src) / p_element_size
+	for b in 0 ..< p_element_size {
+		plane := p_src[b * num_elements:][:num_elements]
+		for value, i in plane {
+			p_dst[i * p_element_size + b] = value
+		}
+	}
+	tail_offset := num_elements * p_element_size
+	copy(p_dst[tail_offset:], p_src[tail_offset:])
+}
+
+//---------------------------------------------------------------------------//
@@ -0,0 +1,282 @@
+package engine
+
+//---------------------------------------------------------------------------//
+
+import "core:log"
+import "core:math"
+import "core:math/linalg/glsl"
+import "core:mem"
+import "core:slice"
+import "core:time"
+
+import "../renderer"
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+NO_LOCAL_INDEX :: 0xFF
+
+//---------------------------------------------------------------------------//
+
+@(private)
+MeshletBuildOutput :: struct {
+	meshlets:  [dynamic]renderer.Meshlet,
+	vertices:  [dynamic]u32,
+	triangles: [dynamic]u8,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+meshlet_build_output_create :: proc(p_allocator: mem.Allocator) -> MeshletBuildOutput {
+	return MeshletBuildOutput {
+		meshlets = make([dynamic]renderer.Meshlet, p_allocator),
+		vertices = make([dynamic]u32, p_allocator),
+		triangles = make([dynamic]u8, p_allocator),
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+meshlet_build_output_destroy :: proc(p_output: ^MeshletBuildOutput) {
+	delete(p_output.meshlets)
+	delete(p_output.vertices)
+	delete(p_output.triangles)
+}
+
+//---------------------------------------------------------------------------//
+
+// Splits the triangles into meshlets in the order they're in, so the indices should already be
+// optimized for the vertex cache, which keeps neighbouring triangles together.
+// The indices and the meshlet vertices are relative to the start of p_positions.
+@(private)
+meshlets_build :: proc(
+	p_indices: []u32,
+	p_positions: []glsl.vec3,
+	p_output: ^MeshletBuildOutput,
+) {
+	// Index of each vertex in the current meshlet
+	local_indices := make([]u8, len(p_positions), G_ALLOCATORS.main_allocator)
+	defer delete(local_indices, G_ALLOCATORS.main_allocator)
+	slice.fill(local_indices, NO_LOCAL_INDEX)
+
+	meshlet := renderer.Meshlet {
+		vertex_offset   = u32(len(p_output.vertices)),
+		triangle_offset = u32(len(p_output.triangles)),
+	}
+
+	for triangle in 0 ..< len(p_indices) / 3 {
+		triangle_indices := p_indices[triangle * 3:][:3]
+
+		num_new_vertices: u32 = 0
+		for idx in triangle_indices {
+			if local_indices[idx] == NO_LOCAL_INDEX {
+				num_new_vertices += 1
+			}
+		}
+
+		if meshlet.vertex_count + num_new_vertices > renderer.MESHLET_MAX_VERTICES ||
+		   meshlet.triangle_count == renderer.MESHLET_MAX_TRIANGLES {
+			meshlet_finish(&meshlet, local_indices, p_positions, p_output)
+		}
+
+		for idx in triangle_indices {
+			if local_indices[idx] == NO_LOCAL_INDEX {
+				local_indices[idx] = u8(meshlet.vertex_count)
+				append(&p_output.vertices, idx)
+				meshlet.vertex_count += 1
+			}
+			append(&p_output.triangles, local_indices[idx])
+		}
+		meshlet.triangle_count += 1
+	}
+
+	if meshlet.triangle_count > 0 {
+		meshlet_finish(&meshlet, local_indices, p_positions, p_output)
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+// Computes the bounds of the meshlet, adds it to the output and starts a new one
+@(private = "file")
+meshlet_finish :: proc(
+	p_meshlet: ^renderer.Meshlet,
+	p_local_indices: []u8,
+	p_positions: []glsl.vec3,
+	p_output: ^MeshletBuildOutput,
+) {
+	meshlet_vertices := p_output.vertices[p_meshlet.vertex_offset:][:p_meshlet.vertex_count]
+	for vertex in meshlet_vertices {
+		p_local_indices[vertex] = NO_LOCAL_INDEX
+	}
+
+	num_triangle_indices := p_meshlet.triangle_count * 3
+	meshlet_triangles := p_output.triangles[p_meshlet.triangle_offset:][:num_triangle_indices]
+	meshlet_compute_bounds(p_meshlet, meshlet_vertices, meshlet_triangles, p_positions)
+
+	// Keep the triangles of each meshlet 4 byte aligned, so they can be read as u32s on the GPU
+	for len(p_output.triangles) % 4 != 0 {
+		append(&p_output.triangles, 0)
+	}
+
+	append(&p_output.meshlets, p_meshlet^)
+
+	p_meshlet^ = renderer.Meshlet {
+		vertex_offset   = u32(len(p_output.vertices)),
+		triangle_offset = u32(len(p_output.triangles)),
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+// Bounding sphere around the center of the bounding box and the cone containing
+// the normals of all triangles, with the apex behind all of the triangle planes
+@(private = "file")
+meshlet_compute_bounds :: proc(
+	p_meshlet: ^renderer.Meshlet,
+	p_vertices: []u32,
+	p_triangles: []u8,
+	p_positions: []glsl.vec3,
+) {
+	bounding_box := renderer.BoundingBox {
+		min = p_positions[p_vertices[0]],
+		max = p_positions[p_vertices[0]],
+	}
+	for vertex in p_vertices[1:] {
+		bounding_box.min = glsl.min(bounding_box.min, p_positions[vertex])
+		bounding_box.max = glsl.max(bounding_box.max, p_positions[vertex])
+	}
+
+	center := (bounding_box.min + bounding_box.max) * 0.5
+	radius: f32 = 0
+	for vertex in p_vertices {
+		radius = max(radius, glsl.length(p_positions[vertex] - center))
+	}
+
+	p_meshlet.center = center
+	p_meshlet.radius = radius
+
+	// The meshlet is never culled by the cone by default
+	p_meshlet.cone_apex = center
+	p_meshlet.cone_axis = {0, 0, 0}
+	p_meshlet.cone_cutoff = 1
+
+	normal_sum := glsl.vec3{}
+	for triangle in 0 ..< len(p_triangles) / 3 {
+		normal, is_valid := meshlet_get_triangle_normal(
+			p_vertices,
+			p_triangles,
+			p_positions,
+			triangle,
+		)
+		if is_valid {
+			normal_sum += normal
+		}
+	}
+
+	if glsl.length(normal_sum) < 1e-6 {
+		return
+	}
+	axis := glsl.normalize(normal_sum)
+
+	min_dot: f32 = 1
+	for triangle in 0 ..< len(p_triangles) / 3 {
+		normal, is_valid := meshlet_get_triangle_normal(
+			p_vertices,
+			p_triangles,
+			p_positions,
+			triangle,
+		)
+		if is_valid {
+			min_dot = min(min_dot, glsl.dot(normal, axis))
+		}
+	}
+
+	// Normals spread over more than a hemisphere, the meshlet is never back facing as a whole
+	if min_dot <= 0 {
+		return
+	}
+
+	// Move the apex back along the axis until it's behind all of the triangle planes
+	max_t: f32 = 0
+	for triangle in 0 ..< len(p_triangles) / 3 {
+		normal, is_valid := meshlet_get_triangle_normal(
+			p_vertices,
+			p_triangles,
+			p_positions,
+			triangle,
+		)
+		if is_valid == false {
+			continue
+		}
+		p0 := p_positions[p_vertices[p_triangles[triangle * 3]]]
+		t := glsl.dot(center - p0, normal) / glsl.dot(axis, normal)
+		max_t = max(max_t, t)
+	}
+
+	p_meshlet.cone_apex = center - axis * max_t
+	p_meshlet.cone_axis = axis
+	p_meshlet.cone_cutoff = math.sqrt(1 - min_dot * min_dot)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+meshlet_get_triangle_normal :: #force_inline proc(
+	p_vertices: []u32,
+	p_triangles: []u8,
+	p_positions: []glsl.vec3,
+	p_triangle: int,
+) -> (
+	glsl.vec3,
+	bool,
+) {
+	a := p_positions[p_vertices[p_triangles[p_triangle * 3 + 0]]]
+	b := p_positions[p_vertices[p_triangles[p_triangle * 3 + 1]]]
+	c := p_positions[p_vertices[p_triangles[p_triangle * 3 + 2]]]
+	normal := glsl.cross(b - a, c - a)
+	length := glsl.length(normal)
+	if length < 1e-12 {
+		return {}, false
+	}
+	return normal / length, true
+}
+
+//---------------------------------------------------------------------------//
+
+// Builds the meshlets of a tessellated sphere, reports the build time and how full the meshlets are,
+// then runs the meshlet culling benchmark with them. Doesn't need a GPU.
+meshlets_run_benchmark :: proc(p_num_instances: u32 = 1024) {
+	allocator := G_ALLOCATORS.main_allocator
+
+	positions, indices := mesh_generate_sphere(256, 512, allocator)
+	defer delete(positions, allocator)
+	defer delete(indices)
+
+	mesh_optimize(indices[:], positions, nil, nil, nil)
+
+	output := meshlet_build_output_create(allocator)
+	defer meshlet_build_output_destroy(&output)
+
+	start := time.tick_now()
+	meshlets_build(indices[:], positions, &output)
+	duration := time.duration_milliseconds(time.tick_since(start))
+
+	num_triangles := len(indices) / 3
+	num_meshlets := max(len(output.meshlets), 1)
+
+	log.infof(
+		"Meshlet build benchmark: %d triangles -> %d meshlets in %.2f ms, %.1f vertices and %.1f triangles per meshlet\n",
+		num_triangles,
+		len(output.meshlets),
+		duration,
+		f32(len(output.vertices)) / f32(num_meshlets),
+		f32(num_triangles) / f32(num_meshlets),
+	)
+
+	renderer.culling_run_meshlet_benchmark(output.meshlets[:], p_num_instances)
+}
+
+//---------------------------------------------------------------------------//
@@ -0,0 +1,689 @@
+package engine
+
+//---------------------------------------------------------------------------//
+
+// Reordering of the triangles and vertices of imported meshes:
+// - vertex cache optimization with Tipsify (Sander et al. 2007, "Fast Triangle Reordering
+//   for Vertex Locality and Reduced Overdraw"),
+// - overdraw optimization by sorting the Tipsify clusters with a view-independent metric,
+// - vertex fetch optimization by laying out the vertices in the order they're first used.
+// Everything is measured in software (FIFO cache simulation, rasterization from 6 directions),
+// so the results can be compared without a GPU.
+
+//---------------------------------------------------------------------------//
+
+import "core:math"
+import "core:math/linalg/glsl"
+import "core:mem"
+import "core:slice"
+
+//---------------------------------------------------------------------------//
+
+// Size of the simulated FIFO post-transform cache
+@(private = "file")
+MESH_OPTIMIZER_CACHE_SIZE :: 16
+
+// Clusters are split further as long as their ACMR is within this factor of the whole cluster
+@(private = "file")
+MESH_OPTIMIZER_OVERDRAW_THRESHOLD :: 1.05
+
+@(private = "file")
+OVERDRAW_VIEWPORT_SIZE :: 256
+
+//---------------------------------------------------------------------------//
+
+@(private)
+MeshOptimizerStats :: struct {
+	num_triangles:  u64,
+	num_vertices:   u64,
+	cache_misses:   u64,
+	pixels_shaded:  u64,
+	pixels_covered: u64,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+VertexCacheSimulator :: struct {
+	timestamps: []u32,
+	timestamp:  u32,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+TriangleCluster :: struct {
+	first_triangle: u32,
+	end_triangle:   u32,
+	sort_key:       f32,
+}
+
+//---------------------------------------------------------------------------//
+
+// Reorders the triangles and vertices of a mesh in place.
+// The indices are relative to the start of the vertex streams, all of the streams have the same length.
+@(private)
+mesh_optimize :: proc(
+	p_indices: []u32,
+	p_positions: []glsl.vec3,
+	p_normals: []glsl.vec3,
+	p_tangents: []glsl.vec3,
+	p_uvs: []glsl.vec2,
+) {
+	if len(p_indices) < 3 {
+		return
+	}
+
+	mesh_optimize_indices(p_indices, p_positions)
+	optimize_vertex_fetch(p_indices, p_positions, p_normals, p_tangents, p_uvs)
+}
+
+//---------------------------------------------------------------------------//
+
+// Reorders only the triangles, used for index buffers that share the vertices with another one
+@(private)
+mesh_optimize_indices :: proc(p_indices: []u32, p_positions: []glsl.vec3) {
+	if len(p_indices) < 3 {
+		return
+	}
+
+	allocator := G_ALLOCATORS.main_allocator
+
+	optimized_indices := make([]u32, len(p_indices), allocator)
+	defer delete(optimized_indices, allocator)
+
+	clusters := make([dynamic]u32, allocator)
+	defer delete(clusters)
+
+	optimize_vertex_cache(p_indices, u32(len(p_positions)), optimized_indices, &clusters)
+	optimize_overdraw(optimized_indices, p_positions, clusters[:], p_indices)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+mesh_optimizer_analyze :: proc(p_indices: []u32, p_positions: []glsl.vec3) -> MeshOptimizerStats {
+	stats := MeshOptimizerStats {
+		num_triangles = u64(len(p_indices) / 3),
+	}
+
+	if len(p_indices) < 3 {
+		return stats
+	}
+
+	cache := vertex_cache_create(u32(len(p_positions)))
+	defer vertex_cache_destroy(&cache)
+
+	is_vertex_used := make([]bool, len(p_positions), G_ALLOCATORS.main_allocator)
+	defer delete(is_vertex_used, G_ALLOCATORS.main_allocator)
+
+	for idx in p_indices {
+		if vertex_cache_access(&cache, idx) {
+			stats.cache_misses += 1
+		}
+		if is_vertex_used[idx] == false {
+			is_vertex_used[idx] = true
+			stats.num_vertices += 1
+		}
+	}
+
+	stats.pixels_shaded, stats.pixels_covered = analyze_overdraw(p_indices, p_positions)
+
+	return stats
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+mesh_optimizer_stats_add :: proc(p_stats: ^MeshOptimizerStats, p_other: MeshOptimizerStats) {
+	p_stats.num_triangles += p_other.num_triangles
+	p_stats.num_vertices += p_other.num_vertices
+	p_stats.cache_misses += p_other.cache_misses
+	p_stats.pixels_shaded += p_other.pixels_shaded
+	p_stats.pixels_covered += p_other.pixels_covered
+}
+
+//---------------------------------------------------------------------------//
+
+// Average cache miss ratio - transformed vertices per triangle
+@(private)
+mesh_optimizer_stats_get_acmr :: proc(p_stats: MeshOptimizerStats) -> f32 {
+	return f32(p_stats.cache_misses) / f32(max(p_stats.num_triangles, 1))
+}
+
+//---------------------------------------------------------------------------//
+
+// Average transform to vertex ratio - 1.0 is optimal
+@(private)
+mesh_optimizer_stats_get_atvr :: proc(p_stats: MeshOptimizerStats) -> f32 {
+	return f32(p_stats.cache_misses) / f32(max(p_stats.num_vertices, 1))
+}
+
+//---------------------------------------------------------------------------//
+
+// Shaded pixels per visible pixel - 1.0 is optimal
+@(private)
+mesh_optimizer_stats_get_overdraw :: proc(p_stats: MeshOptimizerStats) -> f32 {
+	return f32(p_stats.pixels_shaded) / f32(max(p_stats.pixels_covered, 1))
+}
+
+//---------------------------------------------------------------------------//
+
+// Unit sphere with outward facing triangles, used by the benchmarks and validation
+@(private)
+mesh_generate_sphere :: proc(
+	p_num_rings: u32,
+	p_num_segments: u32,
+	p_allocator: mem.Allocator,
+) -> (
+	[]glsl.vec3,
+	[dynamic]u32,
+) {
+	positions := make([]glsl.vec3, (p_num_rings + 1) * (p_num_segments + 1), p_allocator)
+	for ring in 0 ..= p_num_rings {
+		theta := f32(ring) / f32(p_num_rings) * math.PI
+		for segment in 0 ..= p_num_segments {
+			phi := f32(segment) / f32(p_num_segments) * 2 * math.PI
+			positions[ring * (p_num_segments + 1) + segment] = {
+				math.sin(theta) * math.cos(phi),
+				math.cos(theta),
+				math.sin(theta) * math.sin(phi),
+			}
+		}
+	}
+
+	indices := make([dynamic]u32, 0, p_num_rings * p_num_segments * 6, p_allocator)
+	for ring in 0 ..< p_num_rings {
+		for segment in 0 ..< p_num_segments {
+			a := ring * (p_num_segments + 1) + segment
+			b := a + p_num_segments + 1
+			quad := [2][3]u32{{a, b, b + 1}, {a, b + 1, a + 1}}
+			for triangle in quad {
+				p0, p1, p2 := positions[triangle[0]], positions[triangle[1]], positions[triangle[2]]
+				normal := glsl.cross(p1 - p0, p2 - p0)
+
+				// Skip the degenerate triangles at the poles
+				if glsl.length(normal) < 1e-12 {
+					continue
+				}
+				if glsl.dot(normal, p0 + p1 + p2) < 0 {
+					append(&indices, triangle[0], triangle[2], triangle[1])
+				} else {
+					append(&indices, triangle[0], triangle[1], triangle[2])
+				}
+			}
+		}
+	}
+
+	return positions, indices
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+vertex_cache_create :: proc(p_num_vertices: u32) -> VertexCacheSimulator {
+	return VertexCacheSimulator {
+		timestamps = make([]u32, p_num_vertices, G_ALLOCATORS.main_allocator),
+		timestamp = MESH_OPTIMIZER_CACHE_SIZE + 1,
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+vertex_cache_destroy :: proc(p_cache: ^VertexCacheSimulator) {
+	delete(p_cache.timestamps, G_ALLOCATORS.main_allocator)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+vertex_cache_reset :: #force_inline proc(p_cache: ^VertexCacheSimulator) {
+	p_cache.timestamp += MESH_OPTIMIZER_CACHE_SIZE + 1
+}
+
+//---------------------------------------------------------------------------//
+
+// Returns true on a cache miss
+@(private = "file")
+vertex_cache_access :: #force_inline proc(p_cache: ^VertexCacheSimulator, p_vertex: u32) -> bool {
+	if p_cache.timestamp - p_cache.timestamps[p_vertex] > MESH_OPTIMIZER_CACHE_SIZE {
+		p_cache.timestamps[p_vertex] = p_cache.timestamp
+		p_cache.timestamp += 1
+		return true
+	}
+	return false
+}
+
+//---------------------------------------------------------------------------//
+
+// Tipsify - fans around the vertices, picking the next fanning vertex among the ones
+// that will still be in the cache. Jumps to a new, unrelated vertex create hard boundaries
+// between the clusters, which are stored in p_out_clusters as the first triangle of each cluster.
+@(private = "file")
+optimize_vertex_cache :: proc(
+	p_indices: []u32,
+	p_num_vertices: u32,
+	p_out_indices: []u32,
+	p_out_clusters: ^[dynamic]u32,
+) {
+	allocator := G_ALLOCATORS.main_allocator
+	num_triangles := u32(len(p_indices) / 3)
+
+	// Triangles adjacent to each vertex
+	adjacency_offsets := make([]u32, p_num_vertices + 1, allocator)
+	defer delete(adjacency_offsets, allocator)
+	live_triangles := make([]u32, p_num_vertices, allocator)
+	defer delete(live_triangles, allocator)
+
+	for idx in p_indices {
+		live_triangles[idx] += 1
+	}
+	for vertex in 0 ..< p_num_vertices {
+		adjacency_offsets[vertex + 1] = adjacency_offsets[vertex] + live_triangles[vertex]
+	}
+
+	adjacency := make([]u32, len(p_indices), allocator)
+	defer delete(adjacency, allocator)
+	adjacency_cursors := slice.clone(adjacency_offsets[:p_num_vertices], allocator)
+	defer delete(adjacency_cursors, allocator)
+
+	for triangle in 0 ..< num_triangles {
+		for idx in p_indices[triangle * 3:][:3] {
+			adjacency[adjacency_cursors[idx]] = triangle
+			adjacency_cursors[idx] += 1
+		}
+	}
+
+	is_triangle_emitted := make([]bool, num_triangles, allocator)
+	defer delete(is_triangle_emitted, allocator)
+	dead_end_stack := make([dynamic]u32, 0, len(p_indices), allocator)
+	defer delete(dead_end_stack)
+	candidates := make([dynamic]u32, 0, 64, allocator)
+	defer delete(candidates)
+
+	cache := vertex_cache_create(p_num_vertices)
+	defer vertex_cache_destroy(&cache)
+
+	num_emitted := u32(0)
+	scan_cursor := u32(0)
+
+	fanning_vertex := tipsify_skip_dead_end(live_triangles, &dead_end_stack, &scan_cursor)
+	append(p_out_clusters, 0)
+
+	for fanning_vertex >= 0 {
+		clear(&candidates)
+
+		adjacent_triangles :=
+			adjacency[adjacency_offsets[fanning_vertex]:adjacency_offsets[fanning_vertex + 1]]
+		for triangle in adjacent_triangles {
+			if is_triangle_emitted[triangle] {
+				continue
+			}
+			is_triangle_emitted[triangle] = true
+
+			for idx in p_indices[triangle * 3:][:3] {
+				p_out_indices[num_emitted] = idx
+				num_emitted += 1
+
+				append(&dead_end_stack, idx)
+				append(&candidates, idx)
+				live_triangles[idx] -= 1
+				vertex_cache_access(&cache, idx)
+			}
+		}
+
+		// Pick the candidate that will still be in the cache after fanning around it
+		fanning_vertex = -1
+		best_priority := -1
+		for candidate in candidates {
+			if live_triangles[candidate] == 0 {
+				continue
+			}
+			priority := 0
+			cache_age := int(cache.timestamp - cache.timestamps[candidate])
+			if cache_age + 2 * int(live_triangles[candidate]) <= MESH_OPTIMIZER_CACHE_SIZE {
+				priority = cache_age
+			}
+			if priority > best_priority {
+				best_priority = priority
+				fanning_vertex = int(candidate)
+			}
+		}
+
+		if fanning_vertex < 0 {
+			fanning_vertex = tipsify_skip_dead_end(live_triangles, &dead_end_stack, &scan_cursor)
+
+			boundary := num_emitted / 3
+			if fanning_vertex >= 0 && boundary < num_triangles {
+				append(p_out_clusters, boundary)
+			}
+		}
+	}
+
+	assert(num_emitted == u32(len(p_indices)))
+}
+
+//---------------------------------------------------------------------------//
+
+// Returns the most recently used vertex that still has triangles left,
+// or the next one in the input order when there's none. -1 when all triangles are emitted.
+@(private = "file")
+tipsify_skip_dead_end :: proc(
+	p_live_triangles: []u32,
+	p_dead_end_stack: ^[dynamic]u32,
+	p_scan_cursor: ^u32,
+) -> int {
+	for len(p_dead_end_stack) > 0 {
+		vertex := pop(p_dead_end_stack)
+		if p_live_triangles[vertex] > 0 {
+			return int(vertex)
+		}
+	}
+
+	for p_scan_cursor^ < u32(len(p_live_triangles)) {
+		vertex := p_scan_cursor^
+		if p_live_triangles[vertex] > 0 {
+			return int(vertex)
+		}
+		p_scan_cursor^ += 1
+	}
+
+	return -1
+}
+
+//---------------------------------------------------------------------------//
+
+// Splits the hard clusters further where it doesn't hurt the ACMR too much, then sorts the clusters
+// so that the ones facing away from the center of the mesh are drawn first and occlude the rest
+@(private = "file")
+optimize_overdraw :: proc(
+	p_indices: []u32,
+	p_positions: []glsl.vec3,
+	p_hard_clusters: []u32,
+	p_out_indices: []u32,
+) {
+	allocator := G_ALLOCATORS.main_allocator
+	num_triangles := u32(len(p_indices) / 3)
+
+	cache := vertex_cache_create(u32(len(p_positions)))
+	defer vertex_cache_destroy(&cache)
+
+	clusters := make([dynamic]TriangleCluster, allocator)
+	defer delete(clusters)
+
+	for hard_cluster_start, i in p_hard_clusters {
+		hard_cluster_end :=
+			i + 1 < len(p_hard_clusters) ? p_hard_clusters[i + 1] : num_triangles
+
+		// ACMR of the whole cluster
+		vertex_cache_reset(&cache)
+		cluster_misses := 0
+		for idx in p_indices[hard_cluster_start * 3:hard_cluster_end * 3] {
+			cluster_misses += vertex_cache_access(&cache, idx) ? 1 : 0
+		}
+		acmr_threshold :=
+			f32(cluster_misses) /
+			f32(hard_cluster_end - hard_cluster_start) *
+			MESH_OPTIMIZER_OVERDRAW_THRESHOLD
+
+		// Split at every point where the ACMR of the sub-cluster is good enough
+		vertex_cache_reset(&cache)
+		cluster_start := hard_cluster_start
+		misses := 0
+		for triangle in hard_cluster_start ..< hard_cluster_end {
+			for idx in p_indices[triangle * 3:][:3] {
+				misses += vertex_cache_access(&cache, idx) ? 1 : 0
+			}
+
+			if f32(misses) / f32(triangle - cluster_start + 1) <= acmr_threshold ||
+			   triangle + 1 == hard_cluster_end {
+				append(
+					&clusters,
+					TriangleCluster{first_triangle = cluster_start, end_triangle = triangle + 1},
+				)
+				cluster_start = triangle + 1
+				misses = 0
+			}
+		}
+	}
+
+	// Area weighted centroid of the whole mesh
+	mesh_centroid := glsl.vec3{}
+	mesh_area: f32 = 0
+	for triangle in 0 ..< num_triangles {
+		centroid, normal := triangle_get_centroid_and_normal(p_indices, p_positions, triangle)
+		area := glsl.length(normal)
+		mesh_centroid += centroid * area
+		mesh_area += area
+	}
+	mesh_centroid /= max(mesh_area, 1e-12)
+
+	for &cluster in clusters {
+		cluster_centroid := glsl.vec3{}
+		cluster_normal := glsl.vec3{}
+		cluster_area: f32 = 0
+		for triangle in cluster.first_triangle ..< cluster.end_triangle {
+			centroid, normal := triangle_get_centroid_and_normal(p_indices, p_positions, triangle)
+			area := glsl.length(normal)
+			cluster_centroid += centroid * area
+			cluster_normal += normal
+			cluster_area += area
+		}
+		cluster_centroid /= max(cluster_area, 1e-12)
+
+		normal_length := glsl.length(cluster_normal)
+		if normal_length > 0 {
+			cluster.sort_key = glsl.dot(
+				cluster_centroid - mesh_centroid,
+				cluster_normal / normal_length,
+			)
+		}
+	}
+
+	slice.stable_sort_by(clusters[:], proc(p_lhs, p_rhs: TriangleCluster) -> bool {
+		return p_lhs.sort_key > p_rhs.sort_key
+	})
+
+	num_written := 0
+	for cluster in clusters {
+		cluster_indices := p_indices[cluster.first_triangle * 3:cluster.end_triangle * 3]
+		copy(p_out_indices[num_written:], cluster_indices)
+		num_written += len(cluster_indices)
+	}
+	assert(num_written == len(p_indices))
+}
+
+//---------------------------------------------------------------------------//
+
+// The length of the returned normal is twice the area of the triangle
+@(private = "file")
+triangle_get_centroid_and_normal :: #force_inline proc(
+	p_indices: []u32,
+	p_positions: []glsl.vec3,
+	p_triangle: u32,
+) -> (
+	glsl.vec3,
+	glsl.vec3,
+) {
+	a := p_positions[p_indices[p_triangle * 3 + 0]]
+	b := p_positions[p_indices[p_triangle * 3 + 1]]
+	c := p_positions[p_indices[p_triangle * 3 + 2]]
+	return (a + b + c) / 3, glsl.cross(b - a, c - a)
+}
+
+//---------------------------------------------------------------------------//
+
+// Lays out the vertices in the order they're first referenced by the indices,
+// unreferenced vertices are moved to the end
+@(private = "file")
+optimize_vertex_fetch :: proc(
+	p_indices: []u32,
+	p_positions: []glsl.vec3,
+	p_normals: []glsl.vec3,
+	p_tangents: []glsl.vec3,
+	p_uvs: []glsl.vec2,
+) {
+	allocator := G_ALLOCATORS.main_allocator
+
+	remap := make([]u32, len(p_positions), allocator)
+	defer delete(remap, allocator)
+	slice.fill(remap, max(u32))
+
+	next_vertex := u32(0)
+	for &idx in p_indices {
+		if remap[idx] == max(u32) {
+			remap[idx] = next_vertex
+			next_vertex += 1
+		}
+		idx = remap[idx]
+	}
+
+	for &new_idx in remap {
+		if new_idx == max(u32) {
+			new_idx = next_vertex
+			next_vertex += 1
+		}
+	}
+
+	remap_vertex_stream(p_positions, remap)
+	remap_vertex_stream(p_normals, remap)
+	remap_vertex_stream(p_tangents, remap)
+	remap_vertex_stream(p_uvs, remap)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+remap_vertex_stream :: proc(p_stream: []$T, p_remap: []u32) {
+	if len(p_stream) == 0 {
+		return
+	}
+
+	original := slice.clone(p_stream, G_ALLOCATORS.main_allocator)
+	defer delete(original, G_ALLOCATORS.main_allocator)
+
+	for new_idx, old_idx in p_remap {
+		p_stream[new_idx] = original[old_idx]
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+// Rasterizes the mesh with orthographic projections along the +-X, +-Y and +-Z axes,
+// with back face culling and depth testing in submission order. Returns the number of
+// pixels that passed the depth test and the number of pixels covered in the end.
+@(private = "file")
+analyze_overdraw :: proc(p_indices: []u32, p_positions: []glsl.vec3) -> (u64, u64) {
+	bounds_min := glsl.vec3{max(f32), max(f32), max(f32)}
+	bounds_max := glsl.vec3{-max(f32), -max(f32), -max(f32)}
+	for idx in p_indices {
+		bounds_min = glsl.min(bounds_min, p_positions[idx])
+		bounds_max = glsl.max(bounds_max, p_positions[idx])
+	}
+
+	extent := bounds_max - bounds_min
+	max_extent := max(extent.x, extent.y, extent.z)
+	if max_extent <= 0 {
+		return 0, 0
+	}
+	scale := f32(OVERDRAW_VIEWPORT_SIZE - 1) / max_extent
+
+	depth_buffer := make(
+		[]f32,
+		OVERDRAW_VIEWPORT_SIZE * OVERDRAW_VIEWPORT_SIZE,
+		G_ALLOCATORS.main_allocator,
+	)
+	defer delete(depth_buffer, G_ALLOCATORS.main_allocator)
+
+	pixels_shaded: u64 = 0
+	pixels_covered: u64 = 0
+
+	for axis in 0 ..< 3 {
+		for direction in 0 ..< 2 {
+			slice.fill(depth_buffer, max(f32))
+
+			for triangle in 0 ..< len(p_indices) / 3 {
+				vertices: [3]glsl.vec3
+				for i in 0 ..< 3 {
+					position := (p_positions[p_indices[triangle * 3 + i]] - bounds_min) * scale
+
+					// Rotate the axes so that the view axis is z
+					vertices[i] = {
+						position[(axis + 1) % 3],
+						position[(axis + 2) % 3],
+						position[axis],
+					}
+
+					// Looking from the opposite side mirrors x as well, so the winding stays the same
+					if direction == 1 {
+						vertices[i].x = f32(OVERDRAW_VIEWPORT_SIZE - 1) - vertices[i].x
+						vertices[i].z = f32(OVERDRAW_VIEWPORT_SIZE - 1) - vertices[i].z
+					}
+				}
+
+				pixels_shaded += rasterize_triangle(vertices, depth_buffer)
+			}
+
+			for depth in depth_buffer {
+				if depth < max(f32) {
+					pixels_covered += 1
+				}
+			}
+		}
+	}
+
+	return pixels_shaded, pixels_covered
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+edge_function :: #force_inline proc(p_a: glsl.vec3, p_b: glsl.vec3, p_x: f32, p_y: f32) -> f32 {
+	return (p_b.x - p_a.x) * (p_y - p_a.y) - (p_b.y - p_a.y) * (p_x - p_a.x)
+}
+
+//---------------------------------------------------------------------------//
+
+// Returns the number of pixels that passed the depth test
+@(private = "file")
+rasterize_triangle :: proc(p_vertices: [3]glsl.vec3, p_depth_buffer: []f32) -> u64 {
+	a, b, c := p_vertices[0], p_vertices[1], p_vertices[2]
+
+	// Back facing or degenerate
+	area := edge_function(a, b, c.x, c.y)
+	if area <= 0 {
+		return 0
+	}
+
+	min_x := max(int(math.floor(min(a.x, b.x, c.x))), 0)
+	min_y := max(int(math.floor(min(a.y, b.y, c.y))), 0)
+	max_x := min(int(math.ceil(max(a.x, b.x, c.x))), OVERDRAW_VIEWPORT_SIZE - 1)
+	max_y := min(int(math.ceil(max(a.y, b.y, c.y))), OVERDRAW_VIEWPORT_SIZE - 1)
+
+	pixels_shaded: u64 = 0
+	for y in min_y ..= max_y {
+		pixel_y := f32(y) + 0.5
+		for x in min_x ..= max_x {
+			pixel_x := f32(x) + 0.5
+
+			w0 := edge_function(b, c, pixel_x, pixel_y)
+			w1 := edge_function(c, a, pixel_x, pixel_y)
+			w2 := edge_function(a, b, pixel_x, pixel_y)
+			if w0 < 0 || w1 < 0 || w2 < 0 {
+				continue
+			}
+
+			depth := (w0 * a.z + w1 * b.z + w2 * c.z) / area
+			depth_idx := y * OVERDRAW_VIEWPORT_SIZE + x
+			if depth < p_depth_buffer[depth_idx] {
+				p_depth_buffer[depth_idx] = depth
+				pixels_shaded += 1
+			}
+		}
+	}
+
+	return pixels_shaded
+}
+
+//---------------------------------------------------------------------------//
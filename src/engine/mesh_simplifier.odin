@@ -0,0 +1,790 @@
+package engine
+
+//---------------------------------------------------------------------------//
+
+// Mesh simplification with quadric error metrics (Garland and Heckbert 1997, "Surface
+// Simplification Using Quadric Error Metrics"), used to generate the LODs of the submeshes.
+// Edges are always collapsed into one of their vertices, so the simplified index buffers
+// share the vertices with the original one. Vertices on the borders and on attribute seams
+// (multiple vertices with the same position) are never removed.
+
+//---------------------------------------------------------------------------//
+
+import "core:log"
+import "core:math"
+import "core:math/linalg/glsl"
+import "core:slice"
+
+import "../renderer"
+
+//---------------------------------------------------------------------------//
+
+// Error allowed for the first simplified level, relative to the extent of the submesh.
+// Each next level doubles it.
+@(private = "file")
+MESH_LOD_TARGET_ERROR :: 0.01
+
+// Index count of each level relative to the previous one
+@(private = "file")
+MESH_LOD_REDUCTION :: 0.5
+
+// Levels that aren't at least this much smaller than the previous one are not worth keeping
+@(private = "file")
+MESH_LOD_MIN_REDUCTION :: 0.8
+
+@(private = "file")
+MESH_LOD_MIN_TRIANGLES :: 32
+
+//---------------------------------------------------------------------------//
+
+// Symmetric 4x4 matrix of the sum of squared distances to a set of planes, weighted by their area
+@(private = "file")
+Quadric :: struct {
+	a00, a11, a22: f64,
+	a01, a02, a12: f64,
+	b0, b1, b2:    f64,
+	c:             f64,
+	weight:        f64,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+EdgeCollapse :: struct {
+	vertex:        u32,
+	target_vertex: u32,
+	error:         f32,
+}
+
+//---------------------------------------------------------------------------//
+
+// Generates the simplified levels of a submesh, LOD 0 is the submesh itself. The indices of
+// the other levels are appended to p_out_indices and their offsets are relative to it.
+// Errors are in the same units as the positions. Returns the number of levels.
+@(private)
+mesh_simplifier_build_lod_chain :: proc(
+	p_indices: []u32,
+	p_positions: []glsl.vec3,
+	p_out_indices: ^[dynamic]u32,
+	p_out_lods: ^[renderer.MESH_MAX_LODS]renderer.SubMeshLOD,
+) -> u32 {
+	p_out_lods[0] = renderer.SubMeshLOD {
+		index_count = u32(len(p_indices)),
+	}
+
+	lod_indices := make([dynamic]u32, G_ALLOCATORS.main_allocator)
+	defer delete(lod_indices)
+
+	num_lods: u32 = 1
+	previous_index_count := len(p_indices)
+	target_error: f32 = MESH_LOD_TARGET_ERROR
+
+	for num_lods < renderer.MESH_MAX_LODS {
+		target_index_count := int(f32(previous_index_count) * MESH_LOD_REDUCTION) / 3 * 3
+		if target_index_count < MESH_LOD_MIN_TRIANGLES * 3 {
+			break
+		}
+
+		clear(&lod_indices)
+		error := mesh_simplify(
+			p_indices,
+			p_positions,
+			target_index_count,
+			target_error,
+			&lod_indices,
+		)
+
+		// The simplification is limited by the error or by the locked vertices
+		if f32(len(lod_indices)) > f32(previous_index_count) * MESH_LOD_MIN_REDUCTION {
+			break
+		}
+
+		// Never let a broken level reach the GPU, the levels before it are still valid
+		if is_lod_valid(lod_indices[:], len(p_positions), error) == false {
+			log.errorf(
+				"Mesh simplifier produced an invalid LOD %d, the LOD chain ends at LOD %d\n",
+				num_lods,
+				num_lods - 1,
+			)
+			break
+		}
+
+		mesh_optimize_indices(lod_indices[:], p_positions)
+
+		p_out_lods[num_lods] = renderer.SubMeshLOD {
+			index_offset = u32(len(p_out_indices)),
+			index_count  = u32(len(lod_indices)),
+			error        = error,
+		}
+		append(p_out_indices, ..lod_indices[:])
+
+		previous_index_count = len(lod_indices)
+		target_error *= 2
+		num_lods += 1
+	}
+
+	return num_lods
+}
+
+//---------------------------------------------------------------------------//
+
+// A level is valid when it's made of whole, non-degenerate triangles that only reference
+// the vertices of the submesh and its error is a finite distance
+@(private = "file")
+is_lod_valid :: proc(p_indices: []u32, p_num_vertices: int, p_error: f32) -> bool {
+	if len(p_indices) % 3 != 0 || math.is_nan(p_error) || math.is_inf(p_error) || p_error < 0 {
+		return false
+	}
+
+	for triangle in 0 ..< len(p_indices) / 3 {
+		a := p_indices[triangle * 3 + 0]
+		b := p_indices[triangle * 3 + 1]
+		c := p_indices[triangle * 3 + 2]
+
+		if int(max(a, b, c)) >= p_num_vertices || a == b || b == c || a == c {
+			return false
+		}
+	}
+
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+// Collapses the edges with the smallest error until there are at most p_target_index_count
+// indices left or the next collapse would exceed p_target_error, which is relative to the extent
+// of the mesh. The simplified indices are appended to p_out_indices.
+// Returns the error of the simplified mesh, in the same units as the positions.
+@(private)
+mesh_simplify :: proc(
+	p_indices: []u32,
+	p_positions: []glsl.vec3,
+	p_target_index_count: int,
+	p_target_error: f32,
+	p_out_indices: ^[dynamic]u32,
+) -> f32 {
+	allocator := G_ALLOCATORS.main_allocator
+	num_vertices := len(p_positions)
+
+	if len(p_indices) <= p_target_index_count || num_vertices == 0 {
+		append(p_out_indices, ..p_indices)
+		return 0
+	}
+
+	// Work in the unit cube, so that the errors don't depend on the scale of the mesh
+	bounds_min := p_positions[0]
+	bounds_max := p_positions[0]
+	for position in p_positions[1:] {
+		bounds_min = glsl.min(bounds_min, position)
+		bounds_max = glsl.max(bounds_max, position)
+	}
+	extent := bounds_max - bounds_min
+	max_extent := max(extent.x, extent.y, extent.z)
+	scale := max_extent > 0 ? 1 / max_extent : 1
+
+	positions := make([]glsl.vec3, num_vertices, allocator)
+	defer delete(positions, allocator)
+	for position, i in p_positions {
+		positions[i] = (position - bounds_min) * scale
+	}
+
+	is_vertex_locked := make([]bool, num_vertices, allocator)
+	defer delete(is_vertex_locked, allocator)
+	simplifier_lock_border_and_seam_vertices(p_indices, p_positions, is_vertex_locked)
+
+	quadrics := make([]Quadric, num_vertices, allocator)
+	defer delete(quadrics, allocator)
+
+	for triangle in 0 ..< len(p_indices) / 3 {
+		triangle_indices := p_indices[triangle * 3:][:3]
+		a := positions[triangle_indices[0]]
+		b := positions[triangle_indices[1]]
+		c := positions[triangle_indices[2]]
+
+		normal := glsl.cross(b - a, c - a)
+		length := glsl.length(normal)
+		if length == 0 {
+			continue
+		}
+		normal /= length
+
+		quadric := quadric_from_plane(normal, -glsl.dot(normal, a), length * 0.5)
+		for idx in triangle_indices {
+			quadric_add(&quadrics[idx], quadric)
+		}
+	}
+
+	indices := slice.clone_to_dynamic(p_indices, allocator)
+	defer delete(indices)
+
+	remap := make([]u32, num_vertices, allocator)
+	defer delete(remap, allocator)
+	is_vertex_collapsed := make([]bool, num_vertices, allocator)
+	defer delete(is_vertex_collapsed, allocator)
+
+	adjacency_offsets := make([]u32, num_vertices + 1, allocator)
+	defer delete(adjacency_offsets, allocator)
+	adjacency := make([dynamic]u32, allocator)
+	defer delete(adjacency)
+
+	collapses := make([dynamic]EdgeCollapse, allocator)
+	defer delete(collapses)
+
+	target_error_sq := p_target_error * p_target_error
+	result_error_sq: f32 = 0
+
+	// Each pass collapses the cheapest edges that don't share any vertices
+	for len(indices) > p_target_index_count {
+
+		// Triangles adjacent to each vertex
+		slice.zero(adjacency_offsets)
+		for idx in indices {
+			adjacency_offsets[idx + 1] += 1
+		}
+		for vertex in 0 ..< num_vertices {
+			adjacency_offsets[vertex + 1] += adjacency_offsets[vertex]
+		}
+		resize(&adjacency, len(indices))
+		for triangle in 0 ..< len(indices) / 3 {
+			for idx in indices[triangle * 3:][:3] {
+				adjacency[adjacency_offsets[idx]] = u32(triangle)
+				adjacency_offsets[idx] += 1
+			}
+		}
+		// Filling moved the offsets to the end of each range, move them back
+		for vertex := num_vertices; vertex > 0; vertex -= 1 {
+			adjacency_offsets[vertex] = adjacency_offsets[vertex - 1]
+		}
+		adjacency_offsets[0] = 0
+
+		// Interior edges are shared by two triangles, so we only take them in one direction
+		clear(&collapses)
+		for triangle in 0 ..< len(indices) / 3 {
+			for k in 0 ..< 3 {
+				v0 := indices[triangle * 3 + k]
+				v1 := indices[triangle * 3 + (k + 1) % 3]
+				if v0 > v1 || (is_vertex_locked[v0] && is_vertex_locked[v1]) {
+					continue
+				}
+
+				quadric := quadrics[v0]
+				quadric_add(&quadric, quadrics[v1])
+
+				collapse := EdgeCollapse {
+					error = max(f32),
+				}
+				if is_vertex_locked[v0] == false {
+					collapse = {v0, v1, quadric_error(quadric, positions[v1])}
+				}
+				if is_vertex_locked[v1] == false {
+					error := quadric_error(quadric, positions[v0])
+					if error < collapse.error {
+						collapse = {v1, v0, error}
+					}
+				}
+				append(&collapses, collapse)
+			}
+		}
+
+		slice.sort_by(collapses[:], proc(p_lhs, p_rhs: EdgeCollapse) -> bool {
+			return p_lhs.error < p_rhs.error
+		})
+
+		for i in 0 ..< num_vertices {
+			remap[i] = u32(i)
+		}
+		slice.zero(is_vertex_collapsed)
+
+		num_triangles := len(indices) / 3
+		target_num_triangles := p_target_index_count / 3
+		num_collapses := 0
+
+		for collapse in collapses {
+			if collapse.error > target_error_sq || num_triangles <= target_num_triangles {
+				break
+			}
+
+			if is_vertex_collapsed[collapse.vertex] || is_vertex_collapsed[collapse.target_vertex] {
+				continue
+			}
+
+			adjacent_triangles :=
+				adjacency[adjacency_offsets[collapse.vertex]:adjacency_offsets[collapse.vertex + 1]]
+
+			if simplifier_collapse_flips_triangles(
+				   indices[:],
+				   positions,
+				   remap,
+				   adjacent_triangles,
+				   collapse,
+			   ) {
+				continue
+			}
+
+			// Triangles that have both of the vertices become degenerate
+			for triangle in adjacent_triangles {
+				for idx in indices[triangle * 3:][:3] {
+					if remap[idx] == collapse.target_vertex {
+						num_triangles -= 1
+						break
+					}
+				}
+			}
+
+			remap[collapse.vertex] = collapse.target_vertex
+			quadric_add(&quadrics[collapse.target_vertex], quadrics[collapse.vertex])
+			is_vertex_collapsed[collapse.vertex] = true
+			is_vertex_collapsed[collapse.target_vertex] = true
+
+			result_error_sq = max(result_error_sq, collapse.error)
+			num_collapses += 1
+		}
+
+		if num_collapses == 0 {
+			break
+		}
+
+		// Apply the collapses and remove the degenerate triangles
+		num_indices := 0
+		for triangle in 0 ..< len(indices) / 3 {
+			a := remap[indices[triangle * 3 + 0]]
+			b := remap[indices[triangle * 3 + 1]]
+			c := remap[indices[triangle * 3 + 2]]
+			if a == b || b == c || a == c {
+				continue
+			}
+			indices[num_indices + 0] = a
+			indices[num_indices + 1] = b
+			indices[num_indices + 2] = c
+			num_indices += 3
+		}
+		resize(&indices, num_indices)
+	}
+
+	append(p_out_indices, ..indices[:])
+
+	return math.sqrt(result_error_sq) / scale
+}
+
+//---------------------------------------------------------------------------//
+
+// Border edges are used by a single triangle, non-manifold ones by more than two. Vertices that
+// share the position with other vertices are on an attribute seam. All of them are locked.
+@(private = "file")
+simplifier_lock_border_and_seam_vertices :: proc(
+	p_indices: []u32,
+	p_positions: []glsl.vec3,
+	p_is_vertex_locked: []bool,
+) {
+	allocator := G_ALLOCATORS.main_allocator
+
+	// Vertices with the same position are welded to find the edges
+	welded_vertices := make([]u32, len(p_positions), allocator)
+	defer delete(welded_vertices, allocator)
+
+	first_vertex_with_position := make(map[glsl.vec3]u32, len(p_positions), allocator)
+	defer delete(first_vertex_with_position)
+
+	for position, i in p_positions {
+		first_vertex, found := first_vertex_with_position[position]
+		if found {
+			welded_vertices[i] = first_vertex
+			p_is_vertex_locked[i] = true
+			p_is_vertex_locked[first_vertex] = true
+		} else {
+			first_vertex_with_position[position] = u32(i)
+			welded_vertices[i] = u32(i)
+		}
+	}
+
+	edge_triangle_counts := make(map[u64]u32, len(p_indices), allocator)
+	defer delete(edge_triangle_counts)
+
+	for triangle in 0 ..< len(p_indices) / 3 {
+		for k in 0 ..< 3 {
+			edge_key := simplifier_edge_key(
+				welded_vertices[p_indices[triangle * 3 + k]],
+				welded_vertices[p_indices[triangle * 3 + (k + 1) % 3]],
+			)
+			edge_triangle_counts[edge_key] += 1
+		}
+	}
+
+	for triangle in 0 ..< len(p_indices) / 3 {
+		for k in 0 ..< 3 {
+			v0 := p_indices[triangle * 3 + k]
+			v1 := p_indices[triangle * 3 + (k + 1) % 3]
+			edge_key := simplifier_edge_key(welded_vertices[v0], welded_vertices[v1])
+			if edge_triangle_counts[edge_key] != 2 {
+				p_is_vertex_locked[v0] = true
+				p_is_vertex_locked[v1] = true
+			}
+		}
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+simplifier_edge_key :: #force_inline proc(p_v0: u32, p_v1: u32) -> u64 {
+	return u64(min(p_v0, p_v1)) << 32 | u64(max(p_v0, p_v1))
+}
+
+//---------------------------------------------------------------------------//
+
+// Checks if moving the vertex to the target vertex would flip any of the triangles around it
+@(private = "file")
+simplifier_collapse_flips_triangles :: proc(
+	p_indices: []u32,
+	p_positions: []glsl.vec3,
+	p_remap: []u32,
+	p_adjacent_triangles: []u32,
+	p_collapse: EdgeCollapse,
+) -> bool {
+	for triangle in p_adjacent_triangles {
+		triangle_indices := [3]u32 {
+			p_remap[p_indices[triangle * 3 + 0]],
+			p_remap[p_indices[triangle * 3 + 1]],
+			p_remap[p_indices[triangle * 3 + 2]],
+		}
+
+		// Triangles that have the target vertex will be removed
+		if slice.contains(triangle_indices[:], p_collapse.target_vertex) {
+			continue
+		}
+
+		a := p_positions[triangle_indices[0]]
+		b := p_positions[triangle_indices[1]]
+		c := p_positions[triangle_indices[2]]
+		normal := glsl.cross(b - a, c - a)
+
+		for &idx in triangle_indices {
+			if idx == p_collapse.vertex {
+				idx = p_collapse.target_vertex
+			}
+		}
+
+		a = p_positions[triangle_indices[0]]
+		b = p_positions[triangle_indices[1]]
+		c = p_positions[triangle_indices[2]]
+		collapsed_normal := glsl.cross(b - a, c - a)
+
+		if glsl.dot(normal, collapsed_normal) <= 0 {
+			return true
+		}
+	}
+
+	return false
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+quadric_from_plane :: proc(p_normal: glsl.vec3, p_distance: f32, p_weight: f32) -> Quadric {
+	x, y, z := f64(p_normal.x), f64(p_normal.y), f64(p_normal.z)
+	d := f64(p_distance)
+	w := f64(p_weight)
+	return Quadric {
+		a00 = w * x * x,
+		a11 = w * y * y,
+		a22 = w * z * z,
+		a01 = w * x * y,
+		a02 = w * x * z,
+		a12 = w * y * z,
+		b0 = w * x * d,
+		b1 = w * y * d,
+		b2 = w * z * d,
+		c = w * d * d,
+		weight = w,
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+quadric_add :: #force_inline proc(p_quadric: ^Quadric, p_other: Quadric) {
+	p_quadric.a00 += p_other.a00
+	p_quadric.a11 += p_other.a11
+	p_quadric.a22 += p_other.a22
+	p_quadric.a01 += p_other.a01
+	p_quadric.a02 += p_other.a02
+	p_quadric.a12 += p_other.a12
+	p_quadric.b0 += p_other.b0
+	p_quadric.b1 += p_other.b1
+	p_quadric.b2 += p_other.b2
+	p_quadric.c += p_other.c
+	p_quadric.weight += p_other.weight
+}
+
+//---------------------------------------------------------------------------//
+
+// Weighted average of the squared distances to the planes of the quadric
+@(private = "file")
+quadric_error :: #force_inline proc(p_quadric: Quadric, p_position: glsl.vec3) -> f32 {
+	q := p_quadric
+	x, y, z := f64(p_position.x), f64(p_position.y), f64(p_position.z)
+
+	error :=
+		q.a00 * x * x +
+		q.a11 * y * y +
+		q.a22 * z * z +
+		2 * (q.a01 * x * y + q.a02 * x * z + q.a12 * y * z) +
+		2 * (q.b0 * x + q.b1 * y + q.b2 * z) +
+		q.c
+
+	return f32(abs(error) / max(q.weight, 1e-12))
+}
+
+//---------------------------------------------------------------------------//
+
+// Generates the LOD chains of a sphere and of a flat grid and checks that each level is made of
+// valid triangles, reduces the triangle count, reports an error within the target error and
+// stays close to the original vertices. Logs an error and returns false if any check fails.
+mesh_simplifier_run_checks :: proc() -> bool {
+	allocator := G_ALLOCATORS.main_allocator
+
+	success := true
+
+	// Sphere, with seams at the poles and at the start of the rings
+	{
+		positions, indices := mesh_generate_sphere(32, 64, allocator)
+		defer delete(positions, allocator)
+		defer delete(indices)
+
+		if validate_lod_chain("sphere", indices[:], positions, 2) == false {
+			success = false
+		}
+	}
+
+	// Flat grid, every interior vertex can be removed without any error
+	{
+		GRID_SIZE :: 64
+
+		positions := make([]glsl.vec3, (GRID_SIZE + 1) * (GRID_SIZE + 1), allocator)
+		defer delete(positions, allocator)
+		indices := make([dynamic]u32, 0, GRID_SIZE * GRID_SIZE * 6, allocator)
+		defer delete(indices)
+
+		for y in 0 ..= GRID_SIZE {
+			for x in 0 ..= GRID_SIZE {
+				positions[y * (GRID_SIZE + 1) + x] = {f32(x), f32(y), 0}
+			}
+		}
+		for y in 0 ..< GRID_SIZE {
+			for x in 0 ..< GRID_SIZE {
+				a := u32(y * (GRID_SIZE + 1) + x)
+				b := a + GRID_SIZE + 1
+				append(&indices, a, a + 1, b + 1, a, b + 1, b)
+			}
+		}
+
+		if validate_lod_chain("grid", indices[:], positions, 3) == false {
+			success = false
+		}
+	}
+
+	if success {
+		log.info("Mesh simplifier checks passed\n")
+	}
+
+	return success
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+validate_lod_chain :: proc(
+	p_name: string,
+	p_indices: []u32,
+	p_positions: []glsl.vec3,
+	p_min_num_lods: u32,
+) -> bool {
+	lod_indices := make([dynamic]u32, G_ALLOCATORS.main_allocator)
+	defer delete(lod_indices)
+
+	lods: [renderer.MESH_MAX_LODS]renderer.SubMeshLOD
+	num_lods := mesh_simplifier_build_lod_chain(p_indices, p_positions, &lod_indices, &lods)
+
+	if num_lods < p_min_num_lods {
+		log.errorf(
+			"Mesh simplifier check failed - %s has %d LODs, expected at least %d\n",
+			p_name,
+			num_lods,
+			p_min_num_lods,
+		)
+		return false
+	}
+
+	bounds_min := p_positions[0]
+	bounds_max := p_positions[0]
+	for position in p_positions[1:] {
+		bounds_min = glsl.min(bounds_min, position)
+		bounds_max = glsl.max(bounds_max, position)
+	}
+	extent := bounds_max - bounds_min
+	max_extent := max(extent.x, extent.y, extent.z)
+
+	target_error: f32 = MESH_LOD_TARGET_ERROR * max_extent
+	for lod in 1 ..< num_lods {
+		if int(lods[lod].index_offset + lods[lod].index_count) > len(lod_indices) {
+			log.errorf(
+				"Mesh simplifier check failed - %s LOD %d index range [%d, %d) is out of bounds\n",
+				p_name,
+				lod,
+				lods[lod].index_offset,
+				lods[lod].index_offset + lods[lod].index_count,
+			)
+			return false
+		}
+
+		indices := lod_indices[lods[lod].index_offset:][:lods[lod].index_count]
+
+		if is_lod_valid(indices, len(p_positions), lods[lod].error) == false {
+			log.errorf(
+				"Mesh simplifier check failed - %s LOD %d has invalid triangles or error\n",
+				p_name,
+				lod,
+			)
+			return false
+		}
+
+		if f32(lods[lod].index_count) > f32(lods[lod - 1].index_count) * MESH_LOD_MIN_REDUCTION {
+			log.errorf(
+				"Mesh simplifier check failed - %s LOD %d has %d indices, LOD %d has %d\n",
+				p_name,
+				lod,
+				lods[lod].index_count,
+				lod - 1,
+				lods[lod - 1].index_count,
+			)
+			return false
+		}
+
+		if lods[lod].error > target_error * 1.001 {
+			log.errorf(
+				"Mesh simplifier check failed - %s LOD %d error %f exceeds the target %f\n",
+				p_name,
+				lod,
+				lods[lod].error,
+				target_error,
+			)
+			return false
+		}
+
+		// The quadric error is an average over the planes, so allow some slack
+		max_distance := max_distance_to_surface(p_indices, indices, p_positions)
+		if max_distance > 4 * lods[lod].error + 1e-3 * max_extent {
+			log.errorf(
+				"Mesh simplifier check failed - %s LOD %d is %f away from the original vertices, error is %f\n",
+				p_name,
+				lod,
+				max_distance,
+				lods[lod].error,
+			)
+			return false
+		}
+
+		log.infof(
+			"Mesh simplifier check: %s LOD %d - %d -> %d triangles, error %f, max distance %f\n",
+			p_name,
+			lod,
+			len(p_indices) / 3,
+			len(indices) / 3,
+			lods[lod].error,
+			max_distance,
+		)
+
+		target_error *= 2
+	}
+
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+// Largest distance from the vertices used by the original triangles to the simplified triangles
+@(private = "file")
+max_distance_to_surface :: proc(
+	p_original_indices: []u32,
+	p_simplified_indices: []u32,
+	p_positions: []glsl.vec3,
+) -> f32 {
+	is_vertex_used := make([]bool, len(p_positions), G_ALLOCATORS.main_allocator)
+	defer delete(is_vertex_used, G_ALLOCATORS.main_allocator)
+	for idx in p_original_indices {
+		is_vertex_used[idx] = true
+	}
+
+	max_distance: f32 = 0
+	for position, vertex in p_positions {
+		if is_vertex_used[vertex] == false {
+			continue
+		}
+
+		distance := max(f32)
+		for triangle in 0 ..< len(p_simplified_indices) / 3 {
+			closest_point := closest_point_on_triangle(
+				position,
+				p_positions[p_simplified_indices[triangle * 3 + 0]],
+				p_positions[p_simplified_indices[triangle * 3 + 1]],
+				p_positions[p_simplified_indices[triangle * 3 + 2]],
+			)
+			distance = min(distance, glsl.length(position - closest_point))
+		}
+		max_distance = max(max_distance, distance)
+	}
+
+	return max_distance
+}
+
+//---------------------------------------------------------------------------//
+
+// Real-Time Collision Detection, 5.1.5
+@(private = "file")
+closest_point_on_triangle :: proc(p_point, p_a, p_b, p_c: glsl.vec3) -> glsl.vec3 {
+	ab := p_b - p_a
+	ac := p_c - p_a
+	ap := p_point - p_a
+
+	d1 := glsl.dot(ab, ap)
+	d2 := glsl.dot(ac, ap)
+	if d1 <= 0 && d2 <= 0 {
+		return p_a
+	}
+
+	bp := p_point - p_b
+	d3 := glsl.dot(ab, bp)
+	d4 := glsl.dot(ac, bp)
+	if d3 >= 0 && d4 <= d3 {
+		return p_b
+	}
+
+	vc := d1 * d4 - d3 * d2
+	if vc <= 0 && d1 >= 0 && d3 <= 0 {
+		return p_a + ab * (d1 / (d1 - d3))
+	}
+
+	cp := p_point - p_c
+	d5 := glsl.dot(ab, cp)
+	d6 := glsl.dot(ac, cp)
+	if d6 >= 0 && d5 <= d6 {
+		return p_c
+	}
+
+	vb := d5 * d2 - d1 * d6
+	if vb <= 0 && d2 >= 0 && d6 <= 0 {
+		return p_a + ac * (d2 / (d2 - d6))
+	}
+
+	va := d3 * d6 - d5 * d4
+	if va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0 {
+		return p_b + (p_c - p_b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)))
+	}
+
+	denom := 1 / (va + vb + vc)
+	v := vb * denom
+	w := vc * denom
+	return p_a + ab * v + ac * w
+}
+
+//---------------------------------------------------------------------------//
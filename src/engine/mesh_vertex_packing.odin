@@ -0,0 +1,331 @@
+package engine
+
+//---------------------------------------------------------------------------//
+
+// Packing of the vertex attributes into renderer.VertexFormat:
+// - positions are quantized to 16 bits per axis, relative to the bounds of the mesh,
+// - normals and tangents are octahedral encoded into two 16 bit snorms
+//   (Cigolle et al. 2014, "A Survey of Efficient Representations for Independent Unit Vectors"),
+// - UVs are stored as half floats, as they can be outside of the [0, 1] range when tiled.
+// The error introduced by the packing is measured, so it can be reported by the importer.
+
+//---------------------------------------------------------------------------//
+
+import "core:log"
+import "core:math"
+import "core:math/linalg/glsl"
+import "core:math/rand"
+import "core:mem"
+
+import "../renderer"
+
+//---------------------------------------------------------------------------//
+
+@(private)
+PackedVertices :: struct {
+	positions: [][4]u16,
+	normals:   [][2]i16,
+	tangents:  [][2]i16,
+	uvs:       [][2]f16,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+MeshVertexPackingError :: struct {
+	// Largest distance between the original and the dequantized position, in mesh units
+	max_position_error: f32,
+	// Largest angle between the original and the decoded direction, in degrees
+	max_normal_error:   f32,
+	max_tangent_error:  f32,
+	// Largest difference between the original and the half float UV coordinate
+	max_uv_error:       f32,
+}
+
+//---------------------------------------------------------------------------//
+
+// Packs the vertex streams of a mesh. Streams that are empty aren't packed.
+@(private)
+mesh_pack_vertices :: proc(
+	p_positions: []glsl.vec3,
+	p_normals: []glsl.vec3,
+	p_tangents: []glsl.vec3,
+	p_uvs: []glsl.vec2,
+	p_position_bounds: renderer.BoundingBox,
+	p_allocator: mem.Allocator,
+) -> (
+	packed_vertices: PackedVertices,
+	packing_error: MeshVertexPackingError,
+) {
+	extent := p_position_bounds.max - p_position_bounds.min
+
+	packed_vertices.positions = make([][4]u16, len(p_positions), p_allocator)
+	for position, i in p_positions {
+		packed_position := &packed_vertices.positions[i]
+		for axis in 0 ..< 3 {
+			t := f32(0)
+			if extent[axis] > 0 {
+				t = (position[axis] - p_position_bounds.min[axis]) / extent[axis]
+			}
+			packed_position[axis] = u16(math.round(clamp(t, 0, 1) * 65535))
+		}
+
+		dequantized_position := glsl.vec3 {
+			f32(packed_position[0]) / 65535,
+			f32(packed_position[1]) / 65535,
+			f32(packed_position[2]) / 65535,
+		}
+		dequantized_position = p_position_bounds.min + dequantized_position * extent
+
+		packing_error.max_position_error = max(
+			packing_error.max_position_error,
+			glsl.length(dequantized_position - position),
+		)
+	}
+
+	if len(p_normals) > 0 {
+		packed_vertices.normals, packing_error.max_normal_error = pack_directions(
+			p_normals,
+			p_allocator,
+		)
+	}
+
+	if len(p_tangents) > 0 {
+		packed_vertices.tangents, packing_error.max_tangent_error = pack_directions(
+			p_tangents,
+			p_allocator,
+		)
+	}
+
+	if len(p_uvs) > 0 {
+		packed_vertices.uvs = make([][2]f16, len(p_uvs), p_allocator)
+		for uv, i in p_uvs {
+			packed_vertices.uvs[i] = {f16(uv.x), f16(uv.y)}
+			packing_error.max_uv_error = max(
+				packing_error.max_uv_error,
+				abs(f32(packed_vertices.uvs[i].x) - uv.x),
+				abs(f32(packed_vertices.uvs[i].y) - uv.y),
+			)
+		}
+	}
+
+	return packed_vertices, packing_error
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+packed_vertices_delete :: proc(p_packed_vertices: PackedVertices, p_allocator: mem.Allocator) {
+	delete(p_packed_vertices.positions, p_allocator)
+	delete(p_packed_vertices.normals, p_allocator)
+	delete(p_packed_vertices.tangents, p_allocator)
+	delete(p_packed_vertices.uvs, p_allocator)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+pack_directions :: proc(
+	p_directions: []glsl.vec3,
+	p_allocator: mem.Allocator,
+) -> (
+	packed_directions: [][2]i16,
+	max_error: f32,
+) {
+	packed_directions = make([][2]i16, len(p_directions), p_allocator)
+
+	for direction, i in p_directions {
+		// Vertices without a normal or tangent are encoded as +Z
+		length := glsl.length(direction)
+		if length == 0 {
+			continue
+		}
+
+		packed_directions[i] = octahedral_encode(direction / length)
+
+		// Angle from the chord length, acos of a dot product that's close to 1 is too imprecise
+		// for the errors of a 16 bit encoding
+		chord := glsl.length(octahedral_decode(packed_directions[i]) - direction / length)
+		max_error = max(max_error, math.to_degrees(2 * math.asin(min(chord * 0.5, 1))))
+	}
+
+	return packed_directions, max_error
+}
+
+//---------------------------------------------------------------------------//
+
+// Packs random vertices and checks that the reported errors are within the quantization bounds:
+// half a step per position axis, half a half float ULP for the UVs and the worst case of the
+// 16 bit octahedral encoding for the directions. Also checks the directions that the octahedral
+// folding has to handle exactly. Logs an error and returns false if any check fails.
+mesh_vertex_packing_run_checks :: proc() -> bool {
+	// Measured worst case is ~0.0037 degrees
+	MAX_DIRECTION_ERROR_DEGREES :: 0.005
+	NUM_VERTICES :: 100000
+
+	allocator := G_ALLOCATORS.main_allocator
+
+	success := true
+
+	positions := make([]glsl.vec3, NUM_VERTICES, allocator)
+	defer delete(positions, allocator)
+	normals := make([]glsl.vec3, NUM_VERTICES, allocator)
+	defer delete(normals, allocator)
+	uvs := make([]glsl.vec2, NUM_VERTICES, allocator)
+	defer delete(uvs, allocator)
+
+	// Flat along Z, so a zero extent is covered as well
+	bounds := renderer.BoundingBox {
+		min = {-3, 0, 1},
+		max = {5, 2, 1},
+	}
+
+	max_abs_uv := f32(0)
+	for i in 0 ..< NUM_VERTICES {
+		positions[i] = {
+			rand.float32_range(bounds.min.x, bounds.max.x),
+			rand.float32_range(bounds.min.y, bounds.max.y),
+			bounds.min.z,
+		}
+
+		normals[i] = {
+			rand.float32_range(-1, 1),
+			rand.float32_range(-1, 1),
+			rand.float32_range(-1, 1),
+		}
+
+		uvs[i] = {rand.float32_range(-4, 4), rand.float32_range(-4, 4)}
+		max_abs_uv = max(max_abs_uv, abs(uvs[i].x), abs(uvs[i].y))
+	}
+
+	packed_vertices, packing_error := mesh_pack_vertices(
+		positions,
+		normals,
+		nil,
+		uvs,
+		bounds,
+		allocator,
+	)
+	defer packed_vertices_delete(packed_vertices, allocator)
+
+	// Small slack for the float math of the dequantization
+	max_position_error := 0.5 * glsl.length(bounds.max - bounds.min) / 65535 + 1e-6
+	if packing_error.max_position_error > max_position_error {
+		log.errorf(
+			"Mesh vertex packing check failed - position error %f, expected at most %f\n",
+			packing_error.max_position_error,
+			max_position_error,
+		)
+		success = false
+	}
+
+	if packing_error.max_normal_error > MAX_DIRECTION_ERROR_DEGREES {
+		log.errorf(
+			"Mesh vertex packing check failed - normal error %f degrees, expected at most %f\n",
+			packing_error.max_normal_error,
+			MAX_DIRECTION_ERROR_DEGREES,
+		)
+		success = false
+	}
+
+	// Half of the half float ULP at the largest UV
+	max_uv_error := max_abs_uv / 2048
+	if packing_error.max_uv_error > max_uv_error {
+		log.errorf(
+			"Mesh vertex packing check failed - UV error %f, expected at most %f\n",
+			packing_error.max_uv_error,
+			max_uv_error,
+		)
+		success = false
+	}
+
+	// Axes and octant diagonals, in both hemispheres, go through the folding and the clamping
+	special_directions := []glsl.vec3 {
+		{1, 0, 0},
+		{-1, 0, 0},
+		{0, 1, 0},
+		{0, -1, 0},
+		{0, 0, 1},
+		{0, 0, -1},
+		{1, 1, 1},
+		{-1, -1, -1},
+		{1, -1, -1},
+		{-1, 1, -1},
+	}
+
+	for direction in special_directions {
+		normalized_direction := glsl.normalize(direction)
+		decoded_direction := octahedral_decode(octahedral_encode(normalized_direction))
+		direction_error := math.to_degrees(
+			2 * math.asin(min(glsl.length(decoded_direction - normalized_direction) * 0.5, 1)),
+		)
+
+		if direction_error > MAX_DIRECTION_ERROR_DEGREES {
+			log.errorf(
+				"Mesh vertex packing check failed - direction %v decodes as %v\n",
+				direction,
+				decoded_direction,
+			)
+			success = false
+		}
+	}
+
+	// Vertices without a normal have to decode as +Z
+	{
+		zero_normals := []glsl.vec3{{0, 0, 0}}
+		packed_normals, _ := pack_directions(zero_normals, allocator)
+		defer delete(packed_normals, allocator)
+
+		if octahedral_decode(packed_normals[0]) != glsl.vec3{0, 0, 1} {
+			log.errorf(
+				"Mesh vertex packing check failed - zero normal decodes as %v\n",
+				octahedral_decode(packed_normals[0]),
+			)
+			success = false
+		}
+	}
+
+	if success {
+		log.info("Mesh vertex packing checks passed\n")
+	}
+
+	return success
+}
+
+//---------------------------------------------------------------------------//
+
+// Matches encodeNormal/decodeNormal in packing.hlsli
+@(private = "file")
+octahedral_encode :: proc(p_direction: glsl.vec3) -> [2]i16 {
+	p := p_direction.xy / (abs(p_direction.x) + abs(p_direction.y) + abs(p_direction.z))
+	if p_direction.z <= 0 {
+		p = (1 - glsl.abs(p.yx)) * sign_not_zero(p)
+	}
+	return {i16(math.round(clamp(p.x, -1, 1) * 32767)), i16(math.round(clamp(p.y, -1, 1) * 32767))}
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+octahedral_decode :: proc(p_packed_direction: [2]i16) -> glsl.vec3 {
+	e := glsl.vec2 {
+		max(f32(p_packed_direction.x) / 32767, -1),
+		max(f32(p_packed_direction.y) / 32767, -1),
+	}
+	v := glsl.vec3{e.x, e.y, 1 - abs(e.x) - abs(e.y)}
+	if v.z < 0 {
+		folded := (1 - glsl.abs(e.yx)) * sign_not_zero(e)
+		v.x = folded.x
+		v.y = folded.y
+	}
+	return glsl.normalize(v)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+sign_not_zero :: #force_inline proc(p_v: glsl.vec2) -> glsl.vec2 {
+	return {p_v.x >= 0 ? 1 : -1, p_v.y >= 0 ? 1 : -1}
+}
+
+//---------------------------------------------------------------------------//
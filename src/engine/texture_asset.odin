@@ -7,7 +7,6 @@ import "../renderer"
 import "../third_party/tinydds"
 
 import "core:c"
-import "core:c/libc"
 import "core:encoding/json"
 import "core:fmt"
 import "core:log"
@@ -27,7 +26,7 @@ G_METADATA_FILE_VERSION :: 1
 
 @(private = "file")
 G_TEXTURE_DB_PATH :: "app_data/engine/assets/textures/db.json"
-@(private = "file")
+@(private)
 G_TEXTURE_ASSETS_DIR :: "app_data/engine/assets/textures/"
 
 //---------------------------------------------------------------------------//
@@ -58,6 +57,19 @@ TextureAssetMetadata :: struct {
 
 //---------------------------------------------------------------------------//
 
+// State of a single texture import, so that multiple textures can be converted in parallel
+@(private = "file")
+TextureImportTask :: struct {
+	options:           TextureAssetImportOptions,
+	texture_name:      string,
+	texture_file_name: string,
+	texture_file_path: string,
+	uuid:              UUID,
+	result:            AssetImportResult,
+}
+
+//---------------------------------------------------------------------------//
+
 @(private = "file")
 INTERNAL: struct {
 	texture_database:  AssetDatabase,
@@ -123,6 +135,23 @@ TextureAsset :: struct {
 	format:         TextureAssetFormat,
 	ref_count:      u32,
 	image_ref:      renderer.ImageRef,
+	load_state:     AssetLoadState,
+}
+
+//---------------------------------------------------------------------------//
+
+// Texture read from the disk, but without the renderer image yet
+@(private = "file")
+TextureLoadData :: struct {
+	metadata:      TextureAssetMetadata,
+	file_mapping:  common.FileMemoryMapping,
+	in_pack:       bool,
+	num_mips:      u32,
+	width:         u32,
+	height:        u32,
+	depth:         u32,
+	texture_datas: []TextureAssetData,
+	format:        TextureAssetFormat,
 }
 
 //---------------------------------------------------------------------------//
@@ -146,6 +175,8 @@ texture_asset_init :: proc() {
 	asset_database_init(&INTERNAL.texture_database, G_TEXTURE_DB_PATH)
 	asset_database_read(&INTERNAL.texture_database)
 
+	texture_compression_init()
+
 	// Setup tiny dds callbacks
 	INTERNAL.tinydds_callbacks = {
 		allocFn     = tinydds_alloc,
@@ -162,30 +193,123 @@ texture_asset_init :: proc() {
 //---------------------------------------------------------------------------//
 
 texture_asset_import :: proc(p_options: TextureAssetImportOptions) -> AssetImportResult {
+	results: [1]AssetImportResult
+	texture_asset_import_batch({p_options}, results[:])
+	return results[0]
+}
+
+//---------------------------------------------------------------------------//
+
+// Imports multiple textures at once, converting them in parallel on the job system.
+// The texture database is saved only once, after all of the textures are imported.
+texture_asset_import_batch :: proc(
+	p_options: []TextureAssetImportOptions,
+	p_out_results: []AssetImportResult,
+) {
+	assert(len(p_options) == len(p_out_results))
 
 	temp_arena: common.Arena
-	common.temp_arena_init(&temp_arena)
+	common.temp_arena_init(&temp_arena, common.MEGABYTE)
 	defer common.arena_delete(temp_arena)
 
-	// Check if the texture already exits
-	texture_name := filepath.short_stem(filepath.base(p_options.file_path))
-	texture_file_name := strings.concatenate({texture_name, ".dds"}, temp_arena.allocator)
-	texture_file_path := filepath.join(
-		{G_TEXTURE_ASSETS_DIR, texture_file_name},
-		temp_arena.allocator,
+	// Names, uuids and duplicates are resolved up front, as they're not thread safe
+	tasks := make([]TextureImportTask, len(p_options), temp_arena.allocator)
+	for options, i in p_options {
+		texture_import_task_prepare(&tasks[i], options, temp_arena.allocator)
+
+		// Two different files with the same name in this batch
+		for other_task in tasks[:i] {
+			if tasks[i].result.status == .Ok && other_task.result.name == tasks[i].result.name {
+				tasks[i].result.status = .Duplicate
+			}
+		}
+	}
+
+	common.jobs_parallel_for(u32(len(tasks)), 1, texture_import_tasks_run, &tasks)
+
+	// Add the entries to the database
+	num_imported := 0
+	for task, i in tasks {
+		p_out_results[i] = task.result
+		if task.result.status != .Ok {
+			continue
+		}
+
+		db_entry := AssetDatabaseEntry {
+			uuid      = task.uuid,
+			name      = task.texture_name,
+			file_name = task.texture_file_name,
+		}
+		asset_database_add(&INTERNAL.texture_database, db_entry)
+		num_imported += 1
+	}
+
+	if num_imported > 0 {
+		asset_database_save(&INTERNAL.texture_database)
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+texture_import_task_prepare :: proc(
+	p_task: ^TextureImportTask,
+	p_options: TextureAssetImportOptions,
+	p_allocator: mem.Allocator,
+) {
+	p_task.options = p_options
+	p_task.texture_name = filepath.short_stem(filepath.base(p_options.file_path))
+	p_task.texture_file_name = strings.concatenate({p_task.texture_name, ".dds"}, p_allocator)
+	p_task.texture_file_path = filepath.join(
+		{G_TEXTURE_ASSETS_DIR, p_task.texture_file_name},
+		p_allocator,
 	)
+	p_task.result = {
+		name   = common.create_name(p_task.texture_name),
+		status = .Ok,
+	}
 
-	if os.exists(texture_file_path) {
-		return {status = .Duplicate, name = common.create_name(texture_name)}
+	// Check if the texture already exits
+	if os.exists(p_task.texture_file_path) {
+		p_task.result.status = .Duplicate
+		return
 	}
 
-	texture_uuid := uuid_create()
+	p_task.uuid = uuid_create()
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+texture_import_tasks_run :: proc(p_start: u32, p_end: u32, p_user_data: rawptr) {
+	tasks := (^[]TextureImportTask)(p_user_data)^
+	for &task in tasks[p_start:p_end] {
+		if task.result.status != .Ok {
+			continue
+		}
+		if texture_import_task_convert(&task) == false {
+			task.result = {
+				status = .Error,
+			}
+		}
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+// Writes the metadata and converts the texture to dds, safe to run on any thread
+@(private = "file")
+texture_import_task_convert :: proc(p_task: ^TextureImportTask) -> bool {
+
+	temp_arena: common.Arena
+	common.temp_arena_init(&temp_arena)
+	defer common.arena_delete(temp_arena)
 
 	// Write the metadata file
 	{
 		texture_metadata := TextureAssetMetadata {
-			name    = common.create_name(texture_name),
-			uuid    = texture_uuid,
+			name    = p_task.result.name,
+			uuid    = p_task.uuid,
 			version = G_METADATA_FILE_VERSION,
 			type    = .Texture,
 		}
@@ -193,7 +317,7 @@ texture_asset_import :: proc(p_options: TextureAssetImportOptions) -> AssetImpor
 			temp_arena.allocator,
 			"%s%s.metadata",
 			G_TEXTURE_ASSETS_DIR,
-			texture_name,
+			p_task.texture_name,
 		)
 
 		if common.write_json_file(
@@ -203,63 +327,50 @@ texture_asset_import :: proc(p_options: TextureAssetImportOptions) -> AssetImpor
 			   temp_arena.allocator,
 		   ) ==
 		   false {
-			log.warnf("Failed to import texture '%s' - couldn't save metadata\n", texture_name)
-			return {status = .Error}
-
+			log.warnf(
+				"Failed to import texture '%s' - couldn't save metadata\n",
+				p_task.texture_name,
+			)
+			return false
 		}
 	}
 
 	// Pick compression format
 	// https://learn.microsoft.com/en-us/windows/win32/direct3d11/texture-block-compression-in-direct3d-11#block-compression-formats-supported-in-direct3d-11
-	
-	texconv_options_builder := strings.Builder{}
-	strings.builder_init(&texconv_options_builder, temp_arena.allocator)
-	defer strings.builder_destroy(&texconv_options_builder)
-
-	compression_format := "BC3_UNORM"
-	if .IsNormalMap in p_options.flags {
-		compression_format = "BC5_UNORM"
-	} else if .IsGrayScale in p_options.flags {
-		compression_format = "BC4_UNORM"
-	} else if .IsCutout in p_options.flags {
-		compression_format = "BC1_UNORM"
-	} else if .IsHDR in p_options.flags {
-		compression_format = "BC6H_UF16"
-	}
-	
-	// Convert jpg to linear speace, png is expected to be in linear space already
-	if .IsColor in p_options.flags && (
-		strings.ends_with(p_options.file_path, ".jpg") ||  
-		strings.ends_with(p_options.file_path, ".jpeg")) {		
-		strings.write_string(&texconv_options_builder, " -srgbi ")
+	compression_options := TextureCompressionOptions {
+		format        = .BC3_UNorm,
+		is_normal_map = .IsNormalMap in p_task.options.flags,
 	}
 
-	texconv_options := strings.to_string(texconv_options_builder)
-
-	// Convert the texture to dds 
-	texconv_cmd := fmt.tprintf(
-		"app_data\\engine\\tools\\texconv.exe -pow2 -o %s -f %s %s %s > nul 2>&1",
-		G_TEXTURE_ASSETS_DIR,
-		compression_format,
-		texconv_options,
-		p_options.file_path,
-	)
+	if .IsNormalMap in p_task.options.flags {
+		compression_options.format = .BC5_UNorm
+	} else if .IsGrayScale in p_task.options.flags {
+		compression_options.format = .BC4_UNorm
+	} else if .IsCutout in p_task.options.flags {
+		compression_options.format = .BC1_Unorm
+	} else if .IsHDR in p_task.options.flags {
+		compression_options.format = .BC6H_UFloat16
+	}
 
-	texconv_cmd_c := strings.clone_to_cstring(texconv_cmd, temp_arena.allocator)
-	if res := libc.system(texconv_cmd_c); res != 0 {
-		log.warnf("Failed to convert texture %s: %d", p_options.file_path, res)
-		return {status = .Error}
+	// Convert jpg to linear speace, png is expected to be in linear space already
+	if .IsColor in p_task.options.flags &&
+	   (strings.ends_with(p_task.options.file_path, ".jpg") ||
+			   strings.ends_with(p_task.options.file_path, ".jpeg")) {
+		compression_options.is_srgb_source = true
 	}
 
-	// Add an entry to the database
-	db_entry := AssetDatabaseEntry {
-		uuid      = texture_uuid,
-		name      = texture_name,
-		file_name = texture_file_name,
+	// Convert the texture to dds
+	if texture_compression_compress_file(
+		   p_task.options.file_path,
+		   p_task.texture_file_path,
+		   compression_options,
+	   ) ==
+	   false {
+		log.warnf("Failed to convert texture %s\n", p_task.options.file_path)
+		return false
 	}
-	asset_database_add(&INTERNAL.texture_database, db_entry, true)
 
-	return {name = common.create_name(texture_name), status = .Ok}
+	return true
 }
 
 //---------------------------------------------------------------------------//
@@ -270,6 +381,16 @@ texture_asset_unload :: proc(p_texture_asset_ref: TextureAssetRef) {
 	if texture_asset.ref_count > 0 {
 		return
 	}
+
+	// The load request releases the texture once it finishes
+	if texture_asset.load_state == .Loading {
+		return
+	}
+
+	if texture_asset.load_state == .Failed {
+		common.ref_free(&G_TEXTURE_ASSET_REF_ARRAY, p_texture_asset_ref)
+		return
+	}
 	for i in 0 ..< texture_asset.depth {
 		for j in 0 ..< u32(texture_asset.num_mips) {
 			delete(texture_asset.texture_datas[i].data_per_mip[j], G_ALLOCATORS.main_allocator)
@@ -288,39 +409,39 @@ texture_asset_unload :: proc(p_texture_asset_ref: TextureAssetRef) {
 @(private = "file")
 texture_asset_load_texture_data_tiny_dds :: proc(
 	p_tinydds_ctx: tinydds.TinyDDS_ContextHandle,
-	p_texture_asset: ^TextureAsset,
+	p_load_data: ^TextureLoadData,
 	p_allocator: mem.Allocator,
 ) -> bool {
 
 	// For easier cleanup on failure
 	loaded_mips := make([dynamic][]byte, p_allocator)
 
-	p_texture_asset.texture_datas = make(
+	p_load_data.texture_datas = make(
 		[]TextureAssetData,
-		int(p_texture_asset.depth),
+		int(p_load_data.depth),
 		G_ALLOCATORS.asset_allocator,
 	)
 
 	// Load each depth
-	for i in 0 ..< p_texture_asset.depth {
-		p_texture_asset.texture_datas[i].data_per_mip = make(
+	for i in 0 ..< p_load_data.depth {
+		p_load_data.texture_datas[i].data_per_mip = make(
 			[][]byte,
-			int(p_texture_asset.num_mips),
+			int(p_load_data.num_mips),
 			G_ALLOCATORS.asset_allocator,
 		)
 		// Load each mip
-		for j in 0 ..< u32(p_texture_asset.num_mips) {
+		for j in 0 ..< u32(p_load_data.num_mips) {
 			image_data := tinydds.image_raw_data(p_tinydds_ctx, i, j)
 
 			// Cleanup on failure
 			if image_data == nil {
 				for _ in 0 ..= i {
 					delete(
-						p_texture_asset.texture_datas[i].data_per_mip,
+						p_load_data.texture_datas[i].data_per_mip,
 						G_ALLOCATORS.asset_allocator,
 					)
 				}
-				delete(p_texture_asset.texture_datas, G_ALLOCATORS.asset_allocator)
+				delete(p_load_data.texture_datas, G_ALLOCATORS.asset_allocator)
 				for mip_data in loaded_mips {
 					delete(mip_data, G_ALLOCATORS.asset_allocator)
 				}
@@ -328,11 +449,11 @@ texture_asset_load_texture_data_tiny_dds :: proc(
 			}
 
 			// Get the data
-			p_texture_asset.texture_datas[i].data_per_mip[j] = slice.bytes_from_ptr(
+			p_load_data.texture_datas[i].data_per_mip[j] = slice.bytes_from_ptr(
 				image_data,
 				int(tinydds.face_size(p_tinydds_ctx, j)),
 			)
-			append(&loaded_mips, p_texture_asset.texture_datas[i].data_per_mip[j])
+			append(&loaded_mips, p_load_data.texture_datas[i].data_per_mip[j])
 		}
 	}
 	return true
@@ -355,7 +476,16 @@ texture_asset_load_by_name :: proc(p_name: common.Name) -> TextureAssetRef {
 	// Check if it's already loaded
 	loaded_texture_asset_ref := common.ref_find_by_name(&G_TEXTURE_ASSET_REF_ARRAY, p_name)
 	if loaded_texture_asset_ref != InvalidTextureAssetRef {
-		texture_asset_get(loaded_texture_asset_ref).ref_count += 1
+		texture_asset := texture_asset_get(loaded_texture_asset_ref)
+		texture_asset.ref_count += 1
+
+		// Finish the async load, as the texture is needed right away
+		asset_loader_wait(&texture_asset.load_state)
+		if texture_asset.load_state == .Failed {
+			texture_asset_unload(loaded_texture_asset_ref)
+			return InvalidTextureAssetRef
+		}
+
 		return loaded_texture_asset_ref
 	}
 
@@ -365,109 +495,320 @@ texture_asset_load_by_name :: proc(p_name: common.Name) -> TextureAssetRef {
 	common.temp_arena_init(&temp_arena)
 	defer common.arena_delete(temp_arena)
 
-	// Open the texture file
-	asset_path := asset_create_path(G_TEXTURE_ASSETS_DIR, p_name, "dds", temp_arena.allocator)
+	load_data: TextureLoadData
+	if texture_load_data_read(p_name, &load_data, temp_arena.allocator, {}) == false {
+		return InvalidTextureAssetRef
+	}
 
-	texture_asset_file_mapping, mapping_succeess := common.mmap_file(asset_path)
-	if mapping_succeess == false {
-		log.errorf("Failed to map texture asset file: %s\n", asset_path)
+	texture_ref := allocate_texture_asset_ref(p_name)
+	if texture_asset_create_from_load_data(texture_ref, &load_data) == false {
+		common.ref_free(&G_TEXTURE_ASSET_REF_ARRAY, texture_ref)
 		return InvalidTextureAssetRef
 	}
 
-	// Init tiny dds
-	user_data := TinyDDSUserData {
-		temp_arena       = &temp_arena,
-		file_mapping_ptr = texture_asset_file_mapping.mapped_ptr,
+	texture_asset := texture_asset_get(texture_ref)
+	texture_asset.ref_count = 1
+	texture_asset.load_state = .Loaded
+
+	return texture_ref
+}
+
+//---------------------------------------------------------------------------//
+
+texture_asset_load_async :: proc {
+	texture_asset_load_async_by_str,
+	texture_asset_load_async_by_name,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+texture_asset_load_async_by_str :: proc(
+	p_name: string,
+	p_callback: AssetLoadCallback = nil,
+	p_user_data: rawptr = nil,
+) -> TextureAssetRef {
+	return texture_asset_load_async_by_name(common.create_name(p_name), p_callback, p_user_data)
+}
+
+//---------------------------------------------------------------------------//
+
+// Returns right away, the texture can be used once it's load state is .Loaded
+@(private = "file")
+texture_asset_load_async_by_name :: proc(
+	p_name: common.Name,
+	p_callback: AssetLoadCallback = nil,
+	p_user_data: rawptr = nil,
+) -> TextureAssetRef {
+	loaded_texture_asset_ref := common.ref_find_by_name(&G_TEXTURE_ASSET_REF_ARRAY, p_name)
+	if loaded_texture_asset_ref != InvalidTextureAssetRef {
+		texture_asset := texture_asset_get(loaded_texture_asset_ref)
+		texture_asset.ref_count += 1
+		asset_loader_add_callback(
+			.Texture,
+			p_name,
+			texture_asset.load_state,
+			p_callback,
+			p_user_data,
+		)
+		return loaded_texture_asset_ref
 	}
 
-	texture_metadata: TextureAssetMetadata
-	texture_name := common.get_string(p_name)
+	texture_ref := allocate_texture_asset_ref(p_name)
+	texture_asset := texture_asset_get(texture_ref)
+	texture_asset.ref_count = 1
+	texture_asset.load_state = .Loading
+	texture_asset.image_ref = renderer.InvalidImageRef
 
-	// Load texture metadata
-	{
-		texture_metadata_file_path := common.aprintf(
-			temp_arena.allocator,
-			"%s%s.metadata",
+	temp_arena: common.Arena
+	common.temp_arena_init(&temp_arena)
+	defer common.arena_delete(temp_arena)
+
+	// The DDS file in the asset pack is used in place, only separate files are read ahead
+	texture_data_path: string
+	if _, in_pack := asset_pack_find(.Texture, p_name); in_pack == false {
+		texture_data_path = asset_create_path(
 			G_TEXTURE_ASSETS_DIR,
-			texture_name,
-		)
-		texture_metadata_json, success := os.read_entire_file(
-			texture_metadata_file_path,
+			p_name,
+			"dds",
 			temp_arena.allocator,
 		)
-		if !success {
-			log.warnf("Failed to load texture '%s' - couldn't load metadata\n", texture_name)
-			return InvalidTextureAssetRef
+	}
+
+	asset_loader_start(
+		.Texture,
+		p_name,
+		texture_ref.ref,
+		size_of(TextureLoadData),
+		common.MEGABYTE,
+		texture_load_request_read,
+		texture_load_request_step,
+		texture_data_path,
+		p_callback,
+		p_user_data,
+	)
+
+	return texture_ref
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+texture_load_request_read :: proc(p_request: ^AssetLoadRequest) -> bool {
+	load_data := (^TextureLoadData)(p_request.load_data)
+
+	file_data: common.FileMemoryMapping
+	if p_request.file_read.status == .Done {
+		file_data = p_request.file_read.mapping
+	}
+
+	data_read := texture_load_data_read(
+		p_request.name,
+		load_data,
+		p_request.arena.allocator,
+		file_data,
+	)
+	if data_read == false {
+		return false
+	}
+
+	// Data that was read by the asset loader is already in memory
+	if file_data.mapped_ptr != nil {
+		return true
+	}
+	for mip_data in load_data.texture_datas[0].data_per_mip {
+		asset_loader_prefetch(mip_data)
+	}
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+texture_load_request_step :: proc(p_request: ^AssetLoadRequest) -> AssetLoadStepResult {
+	texture_ref := TextureAssetRef {
+		ref = p_request.asset_ref,
+	}
+	texture_asset := texture_asset_get(texture_ref)
+	load_data := (^TextureLoadData)(p_request.load_data)
+
+	// Unloaded while it was loading
+	if texture_asset.ref_count == 0 {
+		if p_request.read_success {
+			texture_load_data_release(load_data)
 		}
-		err := json.unmarshal(
-			texture_metadata_json,
-			&texture_metadata,
-			.JSON5,
-			temp_arena.allocator,
-		)
-		if err != nil {
-			log.warnf("Failed to load texture '%s' - couldn't read metadata\n", texture_name)
-			return InvalidTextureAssetRef
+		common.ref_free(&G_TEXTURE_ASSET_REF_ARRAY, texture_ref)
+		return .Failed
+	}
+
+	if p_request.read_success == false ||
+	   texture_asset_create_from_load_data(texture_ref, load_data) == false {
+		texture_asset.load_state = .Failed
+		return .Failed
+	}
+
+	texture_asset.load_state = .Loaded
+	return .Done
+}
+
+//---------------------------------------------------------------------------//
+
+// Maps the texture file and reads the DDS header, safe to run on any thread. p_file_data is
+// the DDS file when it was already read by the asset loader, it's released on failure.
+@(private = "file")
+texture_load_data_read :: proc(
+	p_name: common.Name,
+	p_load_data: ^TextureLoadData,
+	p_allocator: mem.Allocator,
+	p_file_data: common.FileMemoryMapping,
+) -> bool {
+	texture_name := common.get_string(p_name)
+	texture_data_ptr: rawptr
+
+	// Use the asset pack if the texture is in it, the DDS file is used in place
+	pack_entry, in_pack := asset_pack_find(.Texture, p_name)
+	if in_pack {
+		pack_metadata := asset_pack_get_metadata(pack_entry)
+		if len(pack_metadata) != size_of(TextureAssetMetadata) {
+			log.warnf(
+				"Failed to load texture '%s' - invalid metadata in the asset pack\n",
+				texture_name,
+			)
+			return false
+		}
+		p_load_data.metadata = (^TextureAssetMetadata)(raw_data(pack_metadata))^
+		p_load_data.file_mapping = asset_pack_get_file_mapping()
+		p_load_data.in_pack = true
+		texture_data_ptr = raw_data(asset_pack_get_payload(pack_entry))
+		asset_pack_prefetch_payload(pack_entry)
+	} else {
+		// Open the texture file, unless the asset loader already read it
+		if p_file_data.mapped_ptr != nil {
+			p_load_data.file_mapping = p_file_data
+		} else {
+			asset_path := asset_create_path(G_TEXTURE_ASSETS_DIR, p_name, "dds", p_allocator)
+
+			mapping_succeess: bool
+			p_load_data.file_mapping, mapping_succeess = common.mmap_file(
+				asset_path,
+				{.Sequential, .WillNeed, .HugePages},
+			)
+			if mapping_succeess == false {
+				log.errorf("Failed to map texture asset file: %s\n", asset_path)
+				return false
+			}
+		}
+		texture_data_ptr = p_load_data.file_mapping.mapped_ptr
+
+		// Load texture metadata
+		if texture_read_metadata(texture_name, &p_load_data.metadata, p_allocator) == false {
+			common.unmap_file(p_load_data.file_mapping)
+			return false
 		}
 	}
 
-	texture_ref := allocate_texture_asset_ref(p_name)
-	texture_asset := texture_asset_get(texture_ref)
-	texture_asset.uuid = texture_metadata.uuid
+	temp_arena: common.Arena
+	common.temp_arena_init(&temp_arena)
+	defer common.arena_delete(temp_arena)
+
+	// Init tiny dds
+	user_data := TinyDDSUserData {
+		temp_arena       = &temp_arena,
+		file_mapping_ptr = texture_data_ptr,
+	}
 
 	tinydds_ctx := tinydds.create_context(&INTERNAL.tinydds_callbacks, &user_data)
 	defer tinydds.destroy_context(tinydds_ctx)
-	if tinydds.read_header(tinydds_ctx) == false {
-		log.warnf("Failed to read the DDS header for texture %s\n", common.get_string(p_name))
-		return InvalidTextureAssetRef
-	}
 
-	texture_asset.num_mips = tinydds.number_of_mipmaps(tinydds_ctx)
-	texture_asset.width = tinydds.width(tinydds_ctx)
-	texture_asset.height = tinydds.height(tinydds_ctx)
-	texture_asset.depth = tinydds.depth(tinydds_ctx)
+	header_read := tinydds.read_header(tinydds_ctx)
+	if header_read {
+		p_load_data.num_mips = tinydds.number_of_mipmaps(tinydds_ctx)
+		p_load_data.width = tinydds.width(tinydds_ctx)
+		p_load_data.height = tinydds.height(tinydds_ctx)
+		p_load_data.depth = tinydds.depth(tinydds_ctx)
+	}
 
-	tinydds_format := tinydds.get_format(tinydds_ctx)
+	format_supported := true
 
-	#partial switch tinydds_format {
+	#partial switch tinydds.get_format(tinydds_ctx) {
 	case .TddsBc1RgbaUnormBlock:
-		texture_asset.format = .BC1_Unorm
+		p_load_data.format = .BC1_Unorm
 	case .TddsBc3UnormBlock:
-		texture_asset.format = .BC3_UNorm
+		p_load_data.format = .BC3_UNorm
 	case .TddsBc4UnormBlock:
-		texture_asset.format = .BC4_UNorm
+		p_load_data.format = .BC4_UNorm
 	case .TddsBc5SnormBlock:
-		texture_asset.format = .BC5_SNorm
+		p_load_data.format = .BC5_SNorm
 	case .TddsBc5UnormBlock:
-		texture_asset.format = .BC5_UNorm
+		p_load_data.format = .BC5_UNorm
 	case .TddsBc6HUfloatBlock:
-		texture_asset.format = .BC6H_UFloat16
+		p_load_data.format = .BC6H_UFloat16
 	case:
-		assert(false, "Unsupported texture format")
+		format_supported = false
 	}
 
-	texture_asset.ref_count = 1
-	texture_asset.image_ref = renderer.InvalidImageRef
+	if header_read == false {
+		log.warnf("Failed to read the DDS header for texture %s\n", texture_name)
+	} else if format_supported == false {
+		log.warnf("Failed to load texture '%s' - unsupported format\n", texture_name)
+	}
 
-	// Now upload data to the renderer
-	if !texture_asset_load_texture_data_tiny_dds(
-		   tinydds_ctx,
-		   texture_asset,
-		   G_ALLOCATORS.main_allocator,
-	   ) {
-		common.ref_free(&G_TEXTURE_ASSET_REF_ARRAY, texture_ref)
-		return InvalidTextureAssetRef
+	if header_read == false ||
+	   format_supported == false ||
+	   !texture_asset_load_texture_data_tiny_dds(
+			   tinydds_ctx,
+			   p_load_data,
+			   G_ALLOCATORS.main_allocator,
+		   ) {
+		if p_load_data.in_pack == false {
+			common.unmap_file(p_load_data.file_mapping)
+		}
+		return false
 	}
 
-	image_ref := renderer.image_allocate(p_name)
-	image := &renderer.g_resources.images[renderer.image_get_idx(image_ref)]
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+texture_load_data_release :: proc(p_load_data: ^TextureLoadData) {
+	for texture_data in p_load_data.texture_datas {
+		delete(texture_data.data_per_mip, G_ALLOCATORS.asset_allocator)
+	}
+	delete(p_load_data.texture_datas, G_ALLOCATORS.asset_allocator)
+
+	if p_load_data.in_pack == false {
+		common.unmap_file(p_load_data.file_mapping)
+	}
+}
+
+//---------------------------------------------------------------------------//
 
+// Creates the renderer image, has to run on the main thread. Releases the load data on failure.
+@(private = "file")
+texture_asset_create_from_load_data :: proc(
+	p_texture_ref: TextureAssetRef,
+	p_load_data: ^TextureLoadData,
+) -> bool {
+	texture_asset := texture_asset_get(p_texture_ref)
+	texture_asset.uuid = p_load_data.metadata.uuid
+	texture_asset.num_mips = p_load_data.num_mips
+	texture_asset.width = p_load_data.width
+	texture_asset.height = p_load_data.height
+	texture_asset.depth = p_load_data.depth
+	texture_asset.format = p_load_data.format
+	texture_asset.image_ref = renderer.InvalidImageRef
+
+	image_ref := renderer.image_allocate(texture_asset.name)
 	if image_ref == renderer.InvalidImageRef {
-		texture_asset_unload(texture_ref)
-		return InvalidTextureAssetRef
+		texture_load_data_release(p_load_data)
+		return false
 	}
 
-	#partial switch texture_asset.format {
+	image := &renderer.g_resources.images[renderer.image_get_idx(image_ref)]
+
+	switch texture_asset.format {
 	case .BC1_Unorm:
 		image.desc.format = .BC1_RGBA_UNorm
 	case .BC3_UNorm:
@@ -480,29 +821,97 @@ texture_asset_load_by_name :: proc(p_name: common.Name) -> TextureAssetRef {
 		image.desc.format = .BC5_UNorm
 	case .BC6H_UFloat16:
 		image.desc.format = .BC6H_UFloat
-	case:
-		texture_asset_unload(texture_ref)
-		renderer.image_destroy(image_ref)
-		log.warnf("Unsupported image format for image '%s'\n", common.get_string(p_name))
-		return InvalidTextureAssetRef
 	}
 
 	image.desc.type = .TwoDimensional
 	image.desc.mip_count = texture_asset.num_mips
 	// @TODO support for more slices
-	image.desc.data_per_mip = texture_asset.texture_datas[0].data_per_mip
+	image.desc.data_per_mip = p_load_data.texture_datas[0].data_per_mip
 	image.desc.dimensions = glsl.uvec3{texture_asset.width, texture_asset.height, 1}
 	image.desc.sample_count_flags = {._1}
-	image.desc.file_mapping = texture_asset_file_mapping
+	image.desc.file_mapping = p_load_data.file_mapping
+	if p_load_data.in_pack {
+		image.desc.flags += {.SharedFileMapping}
+	}
 
 	if renderer.image_create_texture(image_ref) == false {
-		texture_asset_unload(texture_ref)
-		return InvalidTextureAssetRef
+		// The mapping is released with the load data
+		image.desc.file_mapping = {}
+		renderer.image_destroy(image_ref)
+		texture_load_data_release(p_load_data)
+		return false
 	}
 
+	texture_asset.texture_datas = p_load_data.texture_datas
 	texture_asset.image_ref = image_ref
 
-	return texture_ref
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+// Adds all of the textures to the asset pack, the DDS files are stored as they are
+@(private)
+texture_asset_cook :: proc(p_builder: ^AssetPackBuilder) -> bool {
+	temp_arena: common.Arena
+	common.temp_arena_init(&temp_arena, common.MEGABYTE)
+	defer common.arena_delete(temp_arena)
+
+	texture_names := asset_pack_collect_asset_names(G_TEXTURE_ASSETS_DIR, temp_arena.allocator)
+	for texture_name in texture_names {
+		texture_metadata: TextureAssetMetadata
+		if texture_read_metadata(texture_name, &texture_metadata, temp_arena.allocator) == false {
+			return false
+		}
+
+		texture_path := asset_create_path(
+			G_TEXTURE_ASSETS_DIR,
+			common.create_name(texture_name),
+			"dds",
+			temp_arena.allocator,
+		)
+
+		if asset_pack_builder_add(
+			   p_builder,
+			   .Texture,
+			   texture_name,
+			   texture_metadata.uuid,
+			   mem.ptr_to_bytes(&texture_metadata),
+			   texture_path,
+		   ) ==
+		   false {
+			return false
+		}
+	}
+
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+texture_read_metadata :: proc(
+	p_texture_name: string,
+	p_metadata: ^TextureAssetMetadata,
+	p_allocator: mem.Allocator,
+) -> bool {
+	texture_metadata_file_path := common.aprintf(
+		p_allocator,
+		"%s%s.metadata",
+		G_TEXTURE_ASSETS_DIR,
+		p_texture_name,
+	)
+	texture_metadata_json, success := os.read_entire_file(texture_metadata_file_path, p_allocator)
+	if !success {
+		log.warnf("Failed to load texture '%s' - couldn't load metadata\n", p_texture_name)
+		return false
+	}
+	err := json.unmarshal(texture_metadata_json, p_metadata, .JSON5, p_allocator)
+	if err != nil {
+		log.warnf("Failed to load texture '%s' - couldn't read metadata\n", p_texture_name)
+		return false
+	}
+	return true
 }
 
 //---------------------------------------------------------------------------//
@@ -0,0 +1,1421 @@
+package engine
+
+//---------------------------------------------------------------------------//
+
+// In-process block compression of textures. The source image is resized to power of two
+// dimensions, a full mip chain is generated with a [1 3 3 1] box-tent filter and all of the
+// mips are compressed in parallel on the job system. Block encoders work on all 16 texels
+// of a block at once, one SIMD vector per channel.
+
+//---------------------------------------------------------------------------//
+
+import "../common"
+import "../third_party/tinydds"
+
+import "base:intrinsics"
+import "core:c"
+import "core:encoding/endian"
+import "core:log"
+import "core:math"
+import "core:math/linalg"
+import "core:os"
+import "core:path/filepath"
+import "core:simd"
+import "core:strings"
+import "core:time"
+
+import stb_image "vendor:stb/image"
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+f32x16 :: #simd[16]f32
+
+// Number of block rows compressed by a single job
+@(private = "file")
+COMPRESSION_BLOCK_ROWS_PER_JOB :: 4
+
+// Number of texel rows filtered by a single job when generating the mips
+@(private = "file")
+MIP_GENERATION_ROWS_PER_JOB :: 16
+
+@(private = "file")
+LINEAR_TO_SRGB_TABLE_SIZE :: 4096
+
+@(private = "file")
+MAX_HALF_FLOAT :: 65504.0
+
+// Weights of the separable downsample filter
+@(private = "file")
+MIP_FILTER_WEIGHTS := [4]f32{0.125, 0.375, 0.375, 0.125}
+
+// Weight of the first endpoint for each of the BC1 palette entries
+@(private = "file")
+BC1_ENDPOINT_WEIGHTS := [4]f32{1, 0, 2.0 / 3.0, 1.0 / 3.0}
+
+// Interpolation weights of the 4 bit BC6H indices, in 1/64 units
+@(private = "file")
+BC6H_INDEX_WEIGHTS := [16]f32{0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64}
+
+//---------------------------------------------------------------------------//
+
+TextureCompressionOptions :: struct {
+	format:         TextureAssetFormat,
+	// The source stores sRGB encoded colors. The mips are filtered in linear
+	// space and the texture is stored as linear, as all of the formats are UNORM
+	is_srgb_source: bool,
+	// Normals are renormalized after filtering
+	is_normal_map:  bool,
+}
+
+//---------------------------------------------------------------------------//
+
+// Uncompressed image, stores either LDR or HDR texels depending on the source
+@(private = "file")
+TextureSurface :: struct {
+	width:      u32,
+	height:     u32,
+	texels_ldr: [][4]u8,
+	texels_hdr: [][4]f32,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+CompressedMip :: struct {
+	data:         []byte,
+	num_blocks_x: u32,
+	num_blocks_y: u32,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+CompressionTask :: struct {
+	mip_idx:         u32,
+	first_block_row: u32,
+	end_block_row:   u32,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+CompressionJobData :: struct {
+	surfaces: []TextureSurface,
+	mips:     []CompressedMip,
+	tasks:    []CompressionTask,
+	options:  ^TextureCompressionOptions,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+MipGenerationJobData :: struct {
+	src:     ^TextureSurface,
+	dst:     ^TextureSurface,
+	options: ^TextureCompressionOptions,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+BlockBitWriter :: struct {
+	bits:   [2]u64,
+	offset: u32,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+INTERNAL: struct {
+	srgb_to_linear: [256]f32,
+	linear_to_srgb: [LINEAR_TO_SRGB_TABLE_SIZE]u8,
+	is_initialized: bool,
+}
+
+//---------------------------------------------------------------------------//
+
+// Builds the sRGB conversion tables, safe to call more than once
+@(private)
+texture_compression_init :: proc() {
+	if INTERNAL.is_initialized {
+		return
+	}
+
+	for i in 0 ..< 256 {
+		c := f32(i) / 255
+		INTERNAL.srgb_to_linear[i] =
+			c <= 0.04045 ? c / 12.92 : math.pow((c + 0.055) / 1.055, 2.4)
+	}
+
+	for i in 0 ..< LINEAR_TO_SRGB_TABLE_SIZE {
+		c := f32(i) / (LINEAR_TO_SRGB_TABLE_SIZE - 1)
+		srgb := c <= 0.0031308 ? c * 12.92 : 1.055 * math.pow(c, 1.0 / 2.4) - 0.055
+		INTERNAL.linear_to_srgb[i] = u8(math.round(clamp(srgb, 0, 1) * 255))
+	}
+
+	INTERNAL.is_initialized = true
+}
+
+//---------------------------------------------------------------------------//
+
+// Compresses the image at p_src_path with a full mip chain and saves it as a DDS file at p_dst_path
+texture_compression_compress_file :: proc(
+	p_src_path: string,
+	p_dst_path: string,
+	p_options: TextureCompressionOptions,
+) -> bool {
+
+	texture_compression_init()
+
+	temp_arena: common.Arena
+	common.temp_arena_init(&temp_arena)
+	defer common.arena_delete(temp_arena)
+
+	options := p_options
+	is_hdr := p_options.format == .BC6H_UFloat16
+
+	// Load the source image, stb_image owns the texels
+	src_path_c := strings.clone_to_cstring(p_src_path, temp_arena.allocator)
+	width, height, num_channels: i32
+	source := TextureSurface{}
+	source_texels: rawptr
+
+	if is_hdr {
+		texels := stb_image.loadf(src_path_c, &width, &height, &num_channels, 4)
+		source.texels_hdr = ([^][4]f32)(rawptr(texels))[:width * height]
+		source_texels = rawptr(texels)
+	} else {
+		texels := stb_image.load(src_path_c, &width, &height, &num_channels, 4)
+		source.texels_ldr = ([^][4]u8)(rawptr(texels))[:width * height]
+		source_texels = rawptr(texels)
+	}
+
+	if source_texels == nil {
+		log.warnf("Failed to compress texture '%s' - couldn't load the image\n", p_src_path)
+		return false
+	}
+
+	source.width = u32(width)
+	source.height = u32(height)
+
+	surfaces := generate_mip_chain(&source, &options)
+	stb_image.image_free(source_texels)
+	defer destroy_mip_chain(surfaces)
+
+	compressed_mips := compress_mip_chain(surfaces, &options)
+	defer destroy_compressed_mips(compressed_mips)
+
+	return write_dds_file(
+		p_dst_path,
+		surfaces[0].width,
+		surfaces[0].height,
+		compressed_mips,
+		p_options.format,
+	)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+surface_create :: proc(p_width: u32, p_height: u32, p_is_hdr: bool) -> TextureSurface {
+	surface := TextureSurface {
+		width  = p_width,
+		height = p_height,
+	}
+	if p_is_hdr {
+		surface.texels_hdr = make([][4]f32, p_width * p_height, G_ALLOCATORS.main_allocator)
+	} else {
+		surface.texels_ldr = make([][4]u8, p_width * p_height, G_ALLOCATORS.main_allocator)
+	}
+	return surface
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+surface_destroy :: proc(p_surface: ^TextureSurface) {
+	delete(p_surface.texels_ldr, G_ALLOCATORS.main_allocator)
+	delete(p_surface.texels_hdr, G_ALLOCATORS.main_allocator)
+	p_surface^ = {}
+}
+
+//---------------------------------------------------------------------------//
+
+// Returns the texel as linear floats, LDR texels are normalized to [0, 1]
+@(private = "file")
+surface_load :: #force_inline proc(
+	p_surface: ^TextureSurface,
+	p_x: u32,
+	p_y: u32,
+	p_options: ^TextureCompressionOptions,
+) -> [4]f32 {
+	texel_idx := p_y * p_surface.width + p_x
+	if p_surface.texels_hdr != nil {
+		return p_surface.texels_hdr[texel_idx]
+	}
+
+	texel := p_surface.texels_ldr[texel_idx]
+	if p_options.is_srgb_source {
+		return {
+			INTERNAL.srgb_to_linear[texel.r],
+			INTERNAL.srgb_to_linear[texel.g],
+			INTERNAL.srgb_to_linear[texel.b],
+			f32(texel.a) / 255,
+		}
+	}
+	return [4]f32{f32(texel.r), f32(texel.g), f32(texel.b), f32(texel.a)} / 255
+}
+
+//---------------------------------------------------------------------------//
+
+// Stores linear floats, encoding them back to the source color space
+@(private = "file")
+surface_store :: #force_inline proc(
+	p_surface: ^TextureSurface,
+	p_x: u32,
+	p_y: u32,
+	p_value: [4]f32,
+	p_options: ^TextureCompressionOptions,
+) {
+	texel_idx := p_y * p_surface.width + p_x
+	if p_surface.texels_hdr != nil {
+		p_surface.texels_hdr[texel_idx] = p_value
+		return
+	}
+
+	value := p_value
+	for &channel in value {
+		channel = clamp(channel, 0, 1)
+	}
+
+	if p_options.is_normal_map {
+		normal := linalg.normalize0([3]f32{value.x, value.y, value.z} * 2 - 1)
+		value = {normal.x * 0.5 + 0.5, normal.y * 0.5 + 0.5, normal.z * 0.5 + 0.5, value.w}
+	}
+
+	texel: [4]u8
+	if p_options.is_srgb_source {
+		for i in 0 ..< 3 {
+			texel[i] = INTERNAL.linear_to_srgb[u32(value[i] * (LINEAR_TO_SRGB_TABLE_SIZE - 1) + 0.5)]
+		}
+	} else {
+		for i in 0 ..< 3 {
+			texel[i] = u8(value[i] * 255 + 0.5)
+		}
+	}
+	texel.a = u8(value.a * 255 + 0.5)
+
+	p_surface.texels_ldr[texel_idx] = texel
+}
+
+//---------------------------------------------------------------------------//
+
+// Creates the mip chain, the first mip is the source resized to power of two dimensions
+@(private = "file")
+generate_mip_chain :: proc(
+	p_source: ^TextureSurface,
+	p_options: ^TextureCompressionOptions,
+) -> []TextureSurface {
+
+	is_hdr := p_source.texels_hdr != nil
+	width := u32(math.next_power_of_two(int(p_source.width)))
+	height := u32(math.next_power_of_two(int(p_source.height)))
+	num_mips := 32 - intrinsics.count_leading_zeros(max(width, height))
+
+	surfaces := make([]TextureSurface, num_mips, G_ALLOCATORS.main_allocator)
+	surfaces[0] = surface_create(width, height, is_hdr)
+
+	if width == p_source.width && height == p_source.height {
+		copy(surfaces[0].texels_ldr, p_source.texels_ldr)
+		copy(surfaces[0].texels_hdr, p_source.texels_hdr)
+	} else {
+		job_data := MipGenerationJobData {
+			src     = p_source,
+			dst     = &surfaces[0],
+			options = p_options,
+		}
+		common.jobs_parallel_for(height, MIP_GENERATION_ROWS_PER_JOB, resize_rows, &job_data)
+	}
+
+	for mip in 1 ..< num_mips {
+		src := &surfaces[mip - 1]
+		surfaces[mip] = surface_create(max(src.width / 2, 1), max(src.height / 2, 1), is_hdr)
+
+		job_data := MipGenerationJobData {
+			src     = src,
+			dst     = &surfaces[mip],
+			options = p_options,
+		}
+		common.jobs_parallel_for(
+			surfaces[mip].height,
+			MIP_GENERATION_ROWS_PER_JOB,
+			downsample_rows,
+			&job_data,
+		)
+	}
+
+	return surfaces
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+destroy_mip_chain :: proc(p_surfaces: []TextureSurface) {
+	for &surface in p_surfaces {
+		surface_destroy(&surface)
+	}
+	delete(p_surfaces, G_ALLOCATORS.main_allocator)
+}
+
+//---------------------------------------------------------------------------//
+
+// Bilinear upscale to the power of two dimensions
+@(private = "file")
+resize_rows :: proc(p_start: u32, p_end: u32, p_user_data: rawptr) {
+	job_data := (^MipGenerationJobData)(p_user_data)
+	src := job_data.src
+	dst := job_data.dst
+
+	scale_x := f32(src.width) / f32(dst.width)
+	scale_y := f32(src.height) / f32(dst.height)
+
+	for y in p_start ..< p_end {
+		src_y := max((f32(y) + 0.5) * scale_y - 0.5, 0)
+		y0 := min(u32(src_y), src.height - 1)
+		y1 := min(y0 + 1, src.height - 1)
+		weight_y := src_y - f32(y0)
+
+		for x in 0 ..< dst.width {
+			src_x := max((f32(x) + 0.5) * scale_x - 0.5, 0)
+			x0 := min(u32(src_x), src.width - 1)
+			x1 := min(x0 + 1, src.width - 1)
+			weight_x := src_x - f32(x0)
+
+			top_left := surface_load(src, x0, y0, job_data.options)
+			top_right := surface_load(src, x1, y0, job_data.options)
+			bottom_left := surface_load(src, x0, y1, job_data.options)
+			bottom_right := surface_load(src, x1, y1, job_data.options)
+
+			top := top_left + (top_right - top_left) * weight_x
+			bottom := bottom_left + (bottom_right - bottom_left) * weight_x
+
+			surface_store(dst, x, y, top + (bottom - top) * weight_y, job_data.options)
+		}
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+downsample_rows :: proc(p_start: u32, p_end: u32, p_user_data: rawptr) {
+	job_data := (^MipGenerationJobData)(p_user_data)
+	src := job_data.src
+	dst := job_data.dst
+
+	for y in p_start ..< p_end {
+		for x in 0 ..< dst.width {
+			sum: [4]f32
+			for tap_y in 0 ..< u32(4) {
+				src_y, weight_y := downsample_filter_tap(y, tap_y, src.height, dst.height)
+				if weight_y == 0 {
+					continue
+				}
+				for tap_x in 0 ..< u32(4) {
+					src_x, weight_x := downsample_filter_tap(x, tap_x, src.width, dst.width)
+					if weight_x == 0 {
+						continue
+					}
+					sum += surface_load(src, src_x, src_y, job_data.options) * (weight_x * weight_y)
+				}
+			}
+			surface_store(dst, x, y, sum, job_data.options)
+		}
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+// Returns the source coordinate and weight of a filter tap, clamping at the edges.
+// Axes that are already 1 texel wide aren't reduced, so they use a single tap
+@(private = "file")
+downsample_filter_tap :: #force_inline proc(
+	p_dst_coord: u32,
+	p_tap: u32,
+	p_src_size: u32,
+	p_dst_size: u32,
+) -> (
+	u32,
+	f32,
+) {
+	if p_src_size == p_dst_size {
+		return p_dst_coord, p_tap == 0 ? 1 : 0
+	}
+	coord := i32(p_dst_coord * 2 + p_tap) - 1
+	return u32(clamp(coord, 0, i32(p_src_size) - 1)), MIP_FILTER_WEIGHTS[p_tap]
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+get_block_size_in_bytes :: proc(p_format: TextureAssetFormat) -> u32 {
+	#partial switch p_format {
+	case .BC1_Unorm, .BC4_UNorm:
+		return 8
+	}
+	return 16
+}
+
+//---------------------------------------------------------------------------//
+
+// Splits all of the mips into rows of blocks and compresses them in parallel
+@(private = "file")
+compress_mip_chain :: proc(
+	p_surfaces: []TextureSurface,
+	p_options: ^TextureCompressionOptions,
+) -> []CompressedMip {
+
+	temp_arena: common.Arena
+	common.temp_arena_init(&temp_arena)
+	defer common.arena_delete(temp_arena)
+
+	block_size := get_block_size_in_bytes(p_options.format)
+
+	mips := make([]CompressedMip, len(p_surfaces), G_ALLOCATORS.main_allocator)
+	tasks := make([dynamic]CompressionTask, temp_arena.allocator)
+
+	for surface, mip_idx in p_surfaces {
+		num_blocks_x := (surface.width + 3) / 4
+		num_blocks_y := (surface.height + 3) / 4
+
+		mips[mip_idx] = CompressedMip {
+			data         = make(
+				[]byte,
+				num_blocks_x * num_blocks_y * block_size,
+				G_ALLOCATORS.main_allocator,
+			),
+			num_blocks_x = num_blocks_x,
+			num_blocks_y = num_blocks_y,
+		}
+
+		for row := u32(0); row < num_blocks_y; row += COMPRESSION_BLOCK_ROWS_PER_JOB {
+			append(
+				&tasks,
+				CompressionTask {
+					mip_idx = u32(mip_idx),
+					first_block_row = row,
+					end_block_row = min(row + COMPRESSION_BLOCK_ROWS_PER_JOB, num_blocks_y),
+				},
+			)
+		}
+	}
+
+	job_data := CompressionJobData {
+		surfaces = p_surfaces,
+		mips     = mips,
+		tasks    = tasks[:],
+		options  = p_options,
+	}
+	common.jobs_parallel_for(u32(len(tasks)), 1, compress_block_rows, &job_data)
+
+	return mips
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+destroy_compressed_mips :: proc(p_mips: []CompressedMip) {
+	for mip in p_mips {
+		delete(mip.data, G_ALLOCATORS.main_allocator)
+	}
+	delete(p_mips, G_ALLOCATORS.main_allocator)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+compress_block_rows :: proc(p_start: u32, p_end: u32, p_user_data: rawptr) {
+	job_data := (^CompressionJobData)(p_user_data)
+	block_size := get_block_size_in_bytes(job_data.options.format)
+
+	for task in job_data.tasks[p_start:p_end] {
+		surface := &job_data.surfaces[task.mip_idx]
+		mip := &job_data.mips[task.mip_idx]
+
+		for block_y in task.first_block_row ..< task.end_block_row {
+			for block_x in 0 ..< mip.num_blocks_x {
+				offset := (block_y * mip.num_blocks_x + block_x) * block_size
+				compress_block(
+					surface,
+					block_x,
+					block_y,
+					job_data.options,
+					mip.data[offset:][:block_size],
+				)
+			}
+		}
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+compress_block :: proc(
+	p_surface: ^TextureSurface,
+	p_block_x: u32,
+	p_block_y: u32,
+	p_options: ^TextureCompressionOptions,
+	p_dst: []byte,
+) {
+	r, g, b, a := load_block(p_surface, p_block_x, p_block_y, p_options)
+
+	#partial switch p_options.format {
+	case .BC1_Unorm:
+		encode_block_bc1(r, g, b, a, true, p_dst)
+	case .BC3_UNorm:
+		encode_block_bc4(a, p_dst[0:8])
+		encode_block_bc1(r, g, b, a, false, p_dst[8:16])
+	case .BC4_UNorm:
+		encode_block_bc4(r, p_dst)
+	case .BC5_UNorm:
+		encode_block_bc4(r, p_dst[0:8])
+		encode_block_bc4(g, p_dst[8:16])
+	case .BC6H_UFloat16:
+		encode_block_bc6h(r, g, b, p_dst)
+	case:
+		assert(false, "Unsupported texture compression format")
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+// Loads a 4x4 block into one vector per channel, clamping at the edges of the surface.
+// LDR channels are in the [0, 255] range, sRGB sources are converted to linear.
+// HDR channels are the bits of the half float, as BC6H interpolates them as integers
+@(private = "file")
+load_block :: proc(
+	p_surface: ^TextureSurface,
+	p_block_x: u32,
+	p_block_y: u32,
+	p_options: ^TextureCompressionOptions,
+) -> (
+	f32x16,
+	f32x16,
+	f32x16,
+	f32x16,
+) {
+	block: [4][16]f32
+
+	for i in 0 ..< u32(16) {
+		x := min(p_block_x * 4 + i % 4, p_surface.width - 1)
+		y := min(p_block_y * 4 + i / 4, p_surface.height - 1)
+		texel_idx := y * p_surface.width + x
+
+		if p_surface.texels_hdr != nil {
+			texel := p_surface.texels_hdr[texel_idx]
+			for c in 0 ..< 3 {
+				block[c][i] = f32(transmute(u16)f16(clamp(texel[c], 0, MAX_HALF_FLOAT)))
+			}
+			continue
+		}
+
+		texel := p_surface.texels_ldr[texel_idx]
+		for c in 0 ..< 4 {
+			block[c][i] = f32(texel[c])
+		}
+		if p_options.is_srgb_source {
+			for c in 0 ..< 3 {
+				block[c][i] = INTERNAL.srgb_to_linear[texel[c]] * 255
+			}
+		}
+	}
+
+	return transmute(f32x16)block[0],
+		transmute(f32x16)block[1],
+		transmute(f32x16)block[2],
+		transmute(f32x16)block[3]
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+splat :: #force_inline proc(p_value: f32) -> f32x16 {
+	values: [16]f32
+	for &value in values {
+		value = p_value
+	}
+	return transmute(f32x16)values
+}
+
+//---------------------------------------------------------------------------//
+
+// Returns the endpoints of the principal axis of the block colors,
+// found with a power iteration on the covariance matrix and inset by 1/16 of the range
+@(private = "file")
+find_principal_endpoints :: proc(p_r, p_g, p_b: f32x16) -> (e0: [3]f32, e1: [3]f32) {
+	mean :=
+		[3]f32 {
+			simd.reduce_add_ordered(p_r),
+			simd.reduce_add_ordered(p_g),
+			simd.reduce_add_ordered(p_b),
+		} /
+		16
+
+	dr := p_r - splat(mean.r)
+	dg := p_g - splat(mean.g)
+	db := p_b - splat(mean.b)
+
+	covariance := [3][3]f32 {
+		{
+			simd.reduce_add_ordered(dr * dr),
+			simd.reduce_add_ordered(dr * dg),
+			simd.reduce_add_ordered(dr * db),
+		},
+		{
+			simd.reduce_add_ordered(dr * dg),
+			simd.reduce_add_ordered(dg * dg),
+			simd.reduce_add_ordered(dg * db),
+		},
+		{
+			simd.reduce_add_ordered(dr * db),
+			simd.reduce_add_ordered(dg * db),
+			simd.reduce_add_ordered(db * db),
+		},
+	}
+
+	// Start from the channel with the largest variance, so the axis is never orthogonal to it
+	axis := covariance[0]
+	if covariance[1][1] > covariance[0][0] && covariance[1][1] >= covariance[2][2] {
+		axis = covariance[1]
+	} else if covariance[2][2] > covariance[0][0] {
+		axis = covariance[2]
+	}
+
+	for _ in 0 ..< 8 {
+		largest := max(abs(axis.x), abs(axis.y), abs(axis.z))
+		if largest < 1e-8 {
+			break
+		}
+		axis /= largest
+		// The covariance matrix is symmetric, so rows can be used instead of columns
+		axis = {
+			linalg.dot(covariance[0], axis),
+			linalg.dot(covariance[1], axis),
+			linalg.dot(covariance[2], axis),
+		}
+	}
+
+	// Solid color block
+	axis_length := linalg.length(axis)
+	if axis_length < 1e-8 {
+		return mean, mean
+	}
+	axis /= axis_length
+
+	projection := dr * splat(axis.x) + dg * splat(axis.y) + db * splat(axis.z)
+	t_min := simd.reduce_min(projection)
+	t_max := simd.reduce_max(projection)
+	inset := (t_max - t_min) / 16
+
+	return mean + axis * (t_max - inset), mean + axis * (t_min + inset)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+pack_565 :: proc(p_color: [3]f32) -> u16 {
+	r := u16(math.round(clamp(p_color.r, 0, 255) * 31 / 255))
+	g := u16(math.round(clamp(p_color.g, 0, 255) * 63 / 255))
+	b := u16(math.round(clamp(p_color.b, 0, 255) * 31 / 255))
+	return r << 11 | g << 5 | b
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+unpack_565 :: proc(p_color: u16) -> [3]f32 {
+	r := u32(p_color >> 11) & 31
+	g := u32(p_color >> 5) & 63
+	b := u32(p_color) & 31
+	return {f32(r << 3 | r >> 2), f32(g << 2 | g >> 4), f32(b << 3 | b >> 2)}
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+bc1_build_palette :: proc(p_c0: u16, p_c1: u16, p_four_colors: bool) -> [4][3]f32 {
+	c0 := unpack_565(p_c0)
+	c1 := unpack_565(p_c1)
+	if p_four_colors {
+		return {c0, c1, (2 * c0 + c1) / 3, (c0 + 2 * c1) / 3}
+	}
+	return {c0, c1, (c0 + c1) / 2, {}}
+}
+
+//---------------------------------------------------------------------------//
+
+// Picks the closest palette entry for each of the texels, returns the indices and the total squared error
+@(private = "file")
+bc1_find_indices :: proc(
+	p_r, p_g, p_b: f32x16,
+	p_c0: u16,
+	p_c1: u16,
+	p_four_colors: bool,
+) -> (
+	indices: [16]u32,
+	error: f32,
+) {
+	palette := bc1_build_palette(p_c0, p_c1, p_four_colors)
+
+	best_distance := splat(max(f32))
+	best_idx := splat(0)
+
+	num_colors := p_four_colors ? 4 : 3
+	for i in 0 ..< num_colors {
+		dr := p_r - splat(palette[i].r)
+		dg := p_g - splat(palette[i].g)
+		db := p_b - splat(palette[i].b)
+		distance := dr * dr + dg * dg + db * db
+
+		is_closer := simd.lanes_lt(distance, best_distance)
+		best_distance = simd.select(is_closer, distance, best_distance)
+		best_idx = simd.select(is_closer, splat(f32(i)), best_idx)
+	}
+
+	for idx, i in simd.to_array(best_idx) {
+		indices[i] = u32(idx)
+	}
+
+	return indices, simd.reduce_add_ordered(best_distance)
+}
+
+//---------------------------------------------------------------------------//
+
+// Least squares fit of the endpoints to the palette entries that the texels were assigned to
+@(private = "file")
+bc1_refine_endpoints :: proc(
+	p_r, p_g, p_b: f32x16,
+	p_indices: [16]u32,
+) -> (
+	e0: [3]f32,
+	e1: [3]f32,
+	ok: bool,
+) {
+	weights: [16]f32
+	for idx, i in p_indices {
+		weights[i] = BC1_ENDPOINT_WEIGHTS[idx]
+	}
+
+	w0 := transmute(f32x16)weights
+	w1 := splat(1) - w0
+
+	w0w0 := simd.reduce_add_ordered(w0 * w0)
+	w1w1 := simd.reduce_add_ordered(w1 * w1)
+	w0w1 := simd.reduce_add_ordered(w0 * w1)
+
+	determinant := w0w0 * w1w1 - w0w1 * w0w1
+	if abs(determinant) < 1e-6 {
+		return
+	}
+
+	w0x := [3]f32 {
+		simd.reduce_add_ordered(w0 * p_r),
+		simd.reduce_add_ordered(w0 * p_g),
+		simd.reduce_add_ordered(w0 * p_b),
+	}
+	w1x := [3]f32 {
+		simd.reduce_add_ordered(w1 * p_r),
+		simd.reduce_add_ordered(w1 * p_g),
+		simd.reduce_add_ordered(w1 * p_b),
+	}
+
+	e0 = (w0x * w1w1 - w1x * w0w1) / determinant
+	e1 = (w1x * w0w0 - w0x * w0w1) / determinant
+	return e0, e1, true
+}
+
+//---------------------------------------------------------------------------//
+
+// When p_allow_transparency is set, blocks with alpha below 128 use the 3 color mode,
+// where the last palette entry is transparent black
+@(private = "file")
+encode_block_bc1 :: proc(p_r, p_g, p_b, p_a: f32x16, p_allow_transparency: bool, p_dst: []byte) {
+	use_transparency := p_allow_transparency && simd.reduce_min(p_a) < 128
+
+	e0, e1 := find_principal_endpoints(p_r, p_g, p_b)
+	c0 := pack_565(e0)
+	c1 := pack_565(e1)
+
+	indices: [16]u32
+
+	if use_transparency {
+		if c0 > c1 {
+			c0, c1 = c1, c0
+		}
+		indices, _ = bc1_find_indices(p_r, p_g, p_b, c0, c1, false)
+		for alpha, i in simd.to_array(p_a) {
+			if alpha < 128 {
+				indices[i] = 3
+			}
+		}
+	} else {
+		error: f32
+		indices, error = bc1_find_indices(p_r, p_g, p_b, c0, c1, true)
+
+		if refined_e0, refined_e1, ok := bc1_refine_endpoints(p_r, p_g, p_b, indices); ok {
+			refined_c0 := pack_565(refined_e0)
+			refined_c1 := pack_565(refined_e1)
+			refined_indices, refined_error := bc1_find_indices(
+				p_r,
+				p_g,
+				p_b,
+				refined_c0,
+				refined_c1,
+				true,
+			)
+			if refined_error < error {
+				c0, c1 = refined_c0, refined_c1
+				indices = refined_indices
+			}
+		}
+
+		// The 4 color mode requires c0 > c1, swapping the endpoints swaps 0 with 1 and 2 with 3
+		if c0 < c1 {
+			c0, c1 = c1, c0
+			for &idx in indices {
+				idx ~= 1
+			}
+		} else if c0 == c1 {
+			indices = {}
+		}
+	}
+
+	index_bits: u32
+	for idx, i in indices {
+		index_bits |= idx << (2 * u32(i))
+	}
+
+	endian.put_u16(p_dst[0:], .Little, c0)
+	endian.put_u16(p_dst[2:], .Little, c1)
+	endian.put_u32(p_dst[4:], .Little, index_bits)
+}
+
+//---------------------------------------------------------------------------//
+
+// Uses the 8 value mode, where index 0 is the max, 1 is the min and 2-7 interpolate between them
+@(private = "file")
+encode_block_bc4 :: proc(p_values: f32x16, p_dst: []byte) {
+	a0 := u8(math.round(clamp(simd.reduce_max(p_values), 0, 255)))
+	a1 := u8(math.round(clamp(simd.reduce_min(p_values), 0, 255)))
+
+	bits := u64(a0) | u64(a1) << 8
+
+	// Otherwise it's a solid block and all of the indices are 0
+	if a0 > a1 {
+		t := (splat(f32(a0)) - p_values) * splat(7 / f32(a0 - a1))
+		steps := simd.clamp(simd.floor(t + splat(0.5)), splat(0), splat(7))
+
+		for step, i in simd.to_array(steps) {
+			idx := u64(step)
+			switch idx {
+			case 0:
+			case 7:
+				idx = 1
+			case:
+				idx += 1
+			}
+			bits |= idx << (16 + 3 * u64(i))
+		}
+	}
+
+	endian.put_u64(p_dst, .Little, bits)
+}
+
+//---------------------------------------------------------------------------//
+
+// Inverse of bc6h_unquantize, 10 bit unsigned endpoints
+@(private = "file")
+bc6h_quantize :: proc(p_half: f32) -> u32 {
+	estimate := i32(math.round((p_half - 15.5) / 31))
+
+	// The estimate can be off by one, pick the closest of the neighbours
+	best_q := u32(0)
+	best_error := max(f32)
+	for q in max(estimate - 1, 0) ..= min(estimate + 1, 1023) {
+		error := abs(bc6h_unquantize(u32(q)) - p_half)
+		if error < best_error {
+			best_q = u32(q)
+			best_error = error
+		}
+	}
+	return best_q
+}
+
+//---------------------------------------------------------------------------//
+
+// Returns the half float bits that the decoder produces for a 10 bit unsigned endpoint
+@(private = "file")
+bc6h_unquantize :: proc(p_quantized: u32) -> f32 {
+	unquantized: u32
+	switch p_quantized {
+	case 0:
+		unquantized = 0
+	case 1023:
+		unquantized = 0xFFFF
+	case:
+		unquantized = ((p_quantized << 16) + 0x8000) >> 10
+	}
+	return f32((unquantized * 31) >> 6)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+block_bit_writer_write :: proc(p_writer: ^BlockBitWriter, p_value: u64, p_num_bits: u32) {
+	for i in 0 ..< p_num_bits {
+		bit_idx := p_writer.offset + i
+		p_writer.bits[bit_idx / 64] |= ((p_value >> i) & 1) << (bit_idx % 64)
+	}
+	p_writer.offset += p_num_bits
+}
+
+//---------------------------------------------------------------------------//
+
+// Only mode 11 is used - a single region with 10 bit endpoints and 4 bit indices
+@(private = "file")
+encode_block_bc6h :: proc(p_r, p_g, p_b: f32x16, p_dst: []byte) {
+	e0, e1 := find_principal_endpoints(p_r, p_g, p_b)
+
+	quantized_e0, quantized_e1: [3]u32
+	unquantized_e0, unquantized_e1: [3]f32
+	for c in 0 ..< 3 {
+		quantized_e0[c] = bc6h_quantize(e0[c])
+		quantized_e1[c] = bc6h_quantize(e1[c])
+		unquantized_e0[c] = bc6h_unquantize(quantized_e0[c])
+		unquantized_e1[c] = bc6h_unquantize(quantized_e1[c])
+	}
+
+	indices: [16]u32
+
+	axis := unquantized_e1 - unquantized_e0
+	axis_length_sqr := linalg.dot(axis, axis)
+	if axis_length_sqr > 0 {
+		// Position along the axis in 1/64 units, matched against the actual index weights
+		t :=
+			((p_r - splat(unquantized_e0.r)) * splat(axis.r) +
+				(p_g - splat(unquantized_e0.g)) * splat(axis.g) +
+				(p_b - splat(unquantized_e0.b)) * splat(axis.b)) *
+			splat(64 / axis_length_sqr)
+
+		best_distance := splat(max(f32))
+		best_idx := splat(0)
+		for weight, i in BC6H_INDEX_WEIGHTS {
+			distance := simd.abs(t - splat(weight))
+			is_closer := simd.lanes_lt(distance, best_distance)
+			best_distance = simd.select(is_closer, distance, best_distance)
+			best_idx = simd.select(is_closer, splat(f32(i)), best_idx)
+		}
+
+		for idx, i in simd.to_array(best_idx) {
+			indices[i] = u32(idx)
+		}
+	}
+
+	// The first index is stored with 3 bits, so its top bit has to be 0
+	if indices[0] >= 8 {
+		quantized_e0, quantized_e1 = quantized_e1, quantized_e0
+		for &idx in indices {
+			idx = 15 - idx
+		}
+	}
+
+	writer: BlockBitWriter
+	block_bit_writer_write(&writer, 0x03, 5)
+	for c in 0 ..< 3 {
+		block_bit_writer_write(&writer, u64(quantized_e0[c]), 10)
+	}
+	for c in 0 ..< 3 {
+		block_bit_writer_write(&writer, u64(quantized_e1[c]), 10)
+	}
+	block_bit_writer_write(&writer, u64(indices[0]), 3)
+	for idx in indices[1:] {
+		block_bit_writer_write(&writer, u64(idx), 4)
+	}
+	assert(writer.offset == 128)
+
+	endian.put_u64(p_dst[0:], .Little, writer.bits[0])
+	endian.put_u64(p_dst[8:], .Little, writer.bits[1])
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+write_dds_file :: proc(
+	p_path: string,
+	p_width: u32,
+	p_height: u32,
+	p_mips: []CompressedMip,
+	p_format: TextureAssetFormat,
+) -> bool {
+
+	dds_format: tinydds.TinyDDS_Format
+	#partial switch p_format {
+	case .BC1_Unorm:
+		dds_format = .TddsBc1RgbaUnormBlock
+	case .BC3_UNorm:
+		dds_format = .TddsBc3UnormBlock
+	case .BC4_UNorm:
+		dds_format = .TddsBc4UnormBlock
+	case .BC5_UNorm:
+		dds_format = .TddsBc5UnormBlock
+	case .BC6H_UFloat16:
+		dds_format = .TddsBc6HUfloatBlock
+	case:
+		log.warnf("Failed to write '%s' - unsupported format %v\n", p_path, p_format)
+		return false
+	}
+
+	temp_arena: common.Arena
+	common.temp_arena_init(&temp_arena)
+	defer common.arena_delete(temp_arena)
+
+	mip_sizes := make([]u32, len(p_mips), temp_arena.allocator)
+	mip_data := make([]rawptr, len(p_mips), temp_arena.allocator)
+	total_size := 0
+	for mip, i in p_mips {
+		mip_sizes[i] = u32(len(mip.data))
+		mip_data[i] = raw_data(mip.data)
+		total_size += len(mip.data)
+	}
+
+	// Header + DX10 header
+	dds_data := make([dynamic]byte, 0, total_size + 148, G_ALLOCATORS.main_allocator)
+	defer delete(dds_data)
+
+	write_callbacks := tinydds.TinyDDS_WriteCallbacks {
+		error = dds_write_error,
+		alloc = dds_write_alloc,
+		free  = dds_write_free,
+		write = dds_write,
+	}
+
+	if tinydds.write_image(
+		   &write_callbacks,
+		   &dds_data,
+		   p_width,
+		   p_height,
+		   1,
+		   1,
+		   u32(len(p_mips)),
+		   dds_format,
+		   false,
+		   true,
+		   &mip_sizes[0],
+		   &mip_data[0],
+	   ) ==
+	   false {
+		log.warnf("Failed to write '%s' - couldn't encode the DDS\n", p_path)
+		return false
+	}
+
+	if os.write_entire_file(p_path, dds_data[:]) == false {
+		log.warnf("Failed to write '%s'\n", p_path)
+		return false
+	}
+
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+dds_write :: proc(user: rawptr, buffer: rawptr, byte_count: c.size_t) {
+	dds_data := (^[dynamic]byte)(user)
+	append(dds_data, ..([^]byte)(buffer)[:byte_count])
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+dds_write_alloc :: proc(user: rawptr, size: c.size_t) -> rawptr {
+	return nil
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+dds_write_free :: proc(user: rawptr, memory: rawptr) {
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+dds_write_error :: proc(user: rawptr, msg: cstring) {
+	log.warnf("TinyDDS error: %s\n", string(msg))
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+decode_block_bc1 :: proc(p_src: []byte, p_four_colors_only: bool, p_dst: ^[16][4]u8) {
+	c0, _ := endian.get_u16(p_src[0:], .Little)
+	c1, _ := endian.get_u16(p_src[2:], .Little)
+	index_bits, _ := endian.get_u32(p_src[4:], .Little)
+
+	four_colors := p_four_colors_only || c0 > c1
+	palette := bc1_build_palette(c0, c1, four_colors)
+
+	for i in 0 ..< u32(16) {
+		idx := (index_bits >> (2 * i)) & 3
+		color := palette[idx]
+		alpha: u8 = (four_colors == false && idx == 3) ? 0 : 255
+		p_dst[i] = {u8(color.r + 0.5), u8(color.g + 0.5), u8(color.b + 0.5), alpha}
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+decode_block_bc4 :: proc(p_src: []byte, p_channel: u32, p_dst: ^[16][4]u8) {
+	bits, _ := endian.get_u64(p_src, .Little)
+	a0 := u32(bits & 0xFF)
+	a1 := u32((bits >> 8) & 0xFF)
+
+	palette: [8]u32
+	palette[0] = a0
+	palette[1] = a1
+	if a0 > a1 {
+		for i in 1 ..< u32(7) {
+			palette[i + 1] = ((7 - i) * a0 + i * a1 + 3) / 7
+		}
+	} else {
+		for i in 1 ..< u32(5) {
+			palette[i + 1] = ((5 - i) * a0 + i * a1 + 2) / 5
+		}
+		palette[6] = 0
+		palette[7] = 255
+	}
+
+	for i in 0 ..< u64(16) {
+		p_dst[i][p_channel] = u8(palette[(bits >> (16 + 3 * i)) & 7])
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+// Decodes the first mip of a BC1/BC3/BC4/BC5 texture into RGBA8 texels
+@(private = "file")
+decode_surface :: proc(
+	p_data: []byte,
+	p_width: u32,
+	p_height: u32,
+	p_format: TextureAssetFormat,
+	p_texels: [][4]u8,
+) {
+	block_size := get_block_size_in_bytes(p_format)
+	num_blocks_x := (p_width + 3) / 4
+	num_blocks_y := (p_height + 3) / 4
+
+	for block_y in 0 ..< num_blocks_y {
+		for block_x in 0 ..< num_blocks_x {
+			src := p_data[(block_y * num_blocks_x + block_x) * block_size:][:block_size]
+
+			block: [16][4]u8
+			#partial switch p_format {
+			case .BC1_Unorm:
+				decode_block_bc1(src, false, &block)
+			case .BC3_UNorm:
+				decode_block_bc1(src[8:16], true, &block)
+				decode_block_bc4(src[0:8], 3, &block)
+			case .BC4_UNorm:
+				decode_block_bc4(src, 0, &block)
+			case .BC5_UNorm:
+				decode_block_bc4(src[0:8], 0, &block)
+				decode_block_bc4(src[8:16], 1, &block)
+			}
+
+			for i in 0 ..< u32(16) {
+				x := block_x * 4 + i % 4
+				y := block_y * 4 + i / 4
+				if x < p_width && y < p_height {
+					p_texels[y * p_width + x] = block[i]
+				}
+			}
+		}
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+// Returns the format and the first mip of a DDS file written by texconv
+@(private = "file")
+parse_dds_file :: proc(
+	p_data: []byte,
+) -> (
+	width: u32,
+	height: u32,
+	format: TextureAssetFormat,
+	mip_data: []byte,
+	ok: bool,
+) {
+	DDS_HEADER_SIZE :: 128
+	DDS_HEADER_DX10_SIZE :: 20
+
+	if len(p_data) < DDS_HEADER_SIZE || string(p_data[0:4]) != "DDS " {
+		return
+	}
+
+	height, _ = endian.get_u32(p_data[12:], .Little)
+	width, _ = endian.get_u32(p_data[16:], .Little)
+	four_cc := string(p_data[84:88])
+	data_offset := DDS_HEADER_SIZE
+
+	switch four_cc {
+	case "DXT1":
+		format = .BC1_Unorm
+	case "DXT5":
+		format = .BC3_UNorm
+	case "ATI1", "BC4U":
+		format = .BC4_UNorm
+	case "ATI2", "BC5U":
+		format = .BC5_UNorm
+	case "DX10":
+		if len(p_data) < DDS_HEADER_SIZE + DDS_HEADER_DX10_SIZE {
+			return
+		}
+		data_offset += DDS_HEADER_DX10_SIZE
+		dxgi_format, _ := endian.get_u32(p_data[DDS_HEADER_SIZE:], .Little)
+		switch dxgi_format {
+		case 71, 72:
+			format = .BC1_Unorm
+		case 77, 78:
+			format = .BC3_UNorm
+		case 80:
+			format = .BC4_UNorm
+		case 83:
+			format = .BC5_UNorm
+		case:
+			return
+		}
+	case:
+		return
+	}
+
+	mip_size :=
+		int(((width + 3) / 4) * ((height + 3) / 4) * get_block_size_in_bytes(format))
+	if len(p_data) < data_offset + mip_size {
+		return
+	}
+
+	return width, height, format, p_data[data_offset:][:mip_size], true
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+BenchmarkFormatResult :: struct {
+	num_textures:      u32,
+	num_pixels:        u64,
+	duration:          time.Duration,
+	squared_error:     f64,
+	num_error_samples: u64,
+}
+
+//---------------------------------------------------------------------------//
+
+// Re-encodes the first mip of each of the shipped textures and measures the throughput of the
+// encoder, as well as the RMSE against the texconv output the textures were originally compressed with.
+// The source images aren't shipped, so the texconv output decoded to RGBA8 is used as the input.
+texture_compression_run_benchmark :: proc() {
+
+	texture_compression_init()
+
+	texture_paths, glob_err := filepath.glob(
+		G_TEXTURE_ASSETS_DIR + "*.dds",
+		G_ALLOCATORS.main_allocator,
+	)
+	defer {
+		for path in texture_paths {
+			delete(path, G_ALLOCATORS.main_allocator)
+		}
+		delete(texture_paths, G_ALLOCATORS.main_allocator)
+	}
+
+	if glob_err != .None || len(texture_paths) == 0 {
+		log.warnf("Texture compression benchmark: no textures found in %s\n", G_TEXTURE_ASSETS_DIR)
+		return
+	}
+
+	results: [TextureAssetFormat]BenchmarkFormatResult
+
+	for texture_path in texture_paths {
+		dds_data, read_ok := os.read_entire_file(texture_path, G_ALLOCATORS.main_allocator)
+		if read_ok == false {
+			continue
+		}
+		defer delete(dds_data, G_ALLOCATORS.main_allocator)
+
+		width, height, format, mip_data, parse_ok := parse_dds_file(dds_data)
+		if parse_ok == false {
+			continue
+		}
+
+		options := TextureCompressionOptions {
+			format = format,
+		}
+
+		reference := surface_create(width, height, false)
+		defer surface_destroy(&reference)
+		decode_surface(mip_data, width, height, format, reference.texels_ldr)
+
+		start := time.tick_now()
+		compressed_mips := compress_mip_chain([]TextureSurface{reference}, &options)
+		duration := time.tick_since(start)
+		defer destroy_compressed_mips(compressed_mips)
+
+		decoded := surface_create(width, height, false)
+		defer surface_destroy(&decoded)
+		decode_surface(compressed_mips[0].data, width, height, format, decoded.texels_ldr)
+
+		num_channels := 4
+		#partial switch format {
+		case .BC1_Unorm:
+			num_channels = 3
+		case .BC4_UNorm:
+			num_channels = 1
+		case .BC5_UNorm:
+			num_channels = 2
+		}
+
+		result := &results[format]
+		for texel, i in reference.texels_ldr {
+			for c in 0 ..< num_channels {
+				diff := f64(texel[c]) - f64(decoded.texels_ldr[i][c])
+				result.squared_error += diff * diff
+			}
+		}
+
+		result.num_textures += 1
+		result.num_pixels += u64(width * height)
+		result.num_error_samples += u64(width * height) * u64(num_channels)
+		result.duration += duration
+	}
+
+	for result, format in results {
+		if result.num_textures == 0 {
+			continue
+		}
+
+		megapixels := f64(result.num_pixels) / 1_000_000
+		log.infof(
+			"Texture compression benchmark: %v - %d textures, %.2f MPix, %.2f MPix/s, RMSE vs texconv: %.3f\n",
+			format,
+			result.num_textures,
+			megapixels,
+			megapixels / max(time.duration_seconds(result.duration), 0.000001),
+			math.sqrt(result.squared_error / f64(result.num_error_samples)),
+		)
+	}
+}
+
+//---------------------------------------------------------------------------//
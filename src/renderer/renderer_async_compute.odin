@@ -0,0 +1,255 @@
+package renderer
+
+//---------------------------------------------------------------------------//
+
+// Render tasks marked with asyncCompute="" in the renderer config record their work into command
+// buffers that are submitted to the dedicated compute queue, so it can run alongside the graphics
+// work. When any of them was rendered, the frame is submitted in the following batches:
+//
+//  graphics: [ pre async compute ] --signal--.            .--wait--> [ post async compute ]
+//  compute:  [ early ] -----------------------'--wait--> [ main ] --signal--'
+//
+// - the early command buffer doesn't wait for anything, so it overlaps the graphics work
+//   recorded before the async compute tasks, e.g. the GBuffer and shadow rasterization
+// - the main command buffer waits for that graphics work, e.g. for the shadow maps
+// - the graphics work recorded after the last async compute task waits for the main one
+//
+// The resources are owned exclusively by a single queue family, the barriers transfer them
+// between the queues, see vulkan_renderer_resource_transitions.odin. The host written uniform
+// and transient buffers are shared by both of the queues instead.
+//
+// Without a dedicated compute queue, the async compute tasks are recorded into the graphics
+// command buffer, just like the rest of the tasks.
+
+//---------------------------------------------------------------------------//
+
+import "../common"
+import "core:fmt"
+import "core:log"
+
+//---------------------------------------------------------------------------//
+
+@(private)
+AsyncComputeStage :: enum u8 {
+	// Can only use the resources that the graphics queue doesn't touch before the async
+	// compute tasks, nor in the previous frame, as nothing orders the two
+	Early,
+	// Waits for the graphics work recorded before the async compute tasks
+	Main,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+INTERNAL: struct {
+	// Compute queue command buffers for each frame in flight
+	cmd_buffer_refs:                    [][AsyncComputeStage]CommandBufferRef,
+	// Graphics command buffers for the work recorded after the last async compute task
+	post_async_compute_cmd_buffer_refs: []CommandBufferRef,
+	// Set once the graphics work recorded so far was closed, see async_compute_split_graphics()
+	is_graphics_split:                  bool,
+	// An early resource had to be acquired from the graphics queue this frame, so the early
+	// command buffer has to wait for the graphics work as well
+	early_waits_for_graphics:           bool,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+async_compute_init :: proc() -> bool {
+	if .DedicatedComputeQueue not_in G_RENDERER.gpu_device_flags {
+		log.info("No dedicated compute queue, async compute tasks will run on the graphics queue\n")
+		return true
+	}
+
+	INTERNAL.cmd_buffer_refs = make(
+		[][AsyncComputeStage]CommandBufferRef,
+		G_RENDERER.num_frames_in_flight,
+		G_RENDERER_ALLOCATORS.resource_allocator,
+	)
+	INTERNAL.post_async_compute_cmd_buffer_refs = make(
+		[]CommandBufferRef,
+		G_RENDERER.num_frames_in_flight,
+		G_RENDERER_ALLOCATORS.resource_allocator,
+	)
+
+	for frame in 0 ..< G_RENDERER.num_frames_in_flight {
+		for stage in AsyncComputeStage {
+			INTERNAL.cmd_buffer_refs[frame][stage] = create_frame_cmd_buffer(
+				fmt.tprintf("%vAsyncComputeCmdBuffer", stage),
+				{.Primary, .AsyncCompute},
+				frame,
+			) or_return
+		}
+
+		INTERNAL.post_async_compute_cmd_buffer_refs[frame] = create_frame_cmd_buffer(
+			"PostAsyncComputeCmdBuffer",
+			{.Primary},
+			frame,
+		) or_return
+	}
+
+	return backend_async_compute_init()
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+async_compute_deinit :: proc() {
+	if .DedicatedComputeQueue not_in G_RENDERER.gpu_device_flags {
+		return
+	}
+
+	backend_async_compute_deinit()
+
+	for frame in 0 ..< G_RENDERER.num_frames_in_flight {
+		for cmd_buff_ref in INTERNAL.cmd_buffer_refs[frame] {
+			command_buffer_destroy(cmd_buff_ref)
+		}
+		command_buffer_destroy(INTERNAL.post_async_compute_cmd_buffer_refs[frame])
+	}
+
+	delete(INTERNAL.cmd_buffer_refs, G_RENDERER_ALLOCATORS.resource_allocator)
+	delete(INTERNAL.post_async_compute_cmd_buffer_refs, G_RENDERER_ALLOCATORS.resource_allocator)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+create_frame_cmd_buffer :: proc(
+	p_name: string,
+	p_flags: CommandBufferFlags,
+	p_frame: u32,
+) -> (
+	CommandBufferRef,
+	bool,
+) {
+	cmd_buff_ref := command_buffer_allocate(common.create_name(p_name))
+	if cmd_buff_ref == InvalidCommandBufferRef {
+		log.errorf("Failed to allocate command buffer '%s'\n", p_name)
+		return InvalidCommandBufferRef, false
+	}
+
+	cmd_buffer := &g_resources.cmd_buffers[command_buffer_get_idx(cmd_buff_ref)]
+	cmd_buffer.desc = {
+		flags  = p_flags,
+		thread = 0,
+		frame  = u8(p_frame),
+	}
+	if command_buffer_create(cmd_buff_ref) == false {
+		log.errorf("Failed to create command buffer '%s'\n", p_name)
+		return InvalidCommandBufferRef, false
+	}
+
+	return cmd_buff_ref, true
+}
+
+//---------------------------------------------------------------------------//
+
+// Has to be called right after the graphics command buffer of the frame was begun
+@(private)
+async_compute_begin_frame :: proc() {
+	INTERNAL.is_graphics_split = false
+	INTERNAL.early_waits_for_graphics = false
+
+	if is_async_compute_enabled() == false {
+		return
+	}
+
+	for cmd_buff_ref in INTERNAL.cmd_buffer_refs[get_frame_idx()] {
+		command_buffer_begin(cmd_buff_ref)
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+async_compute_end_frame :: proc() {
+	if is_async_compute_enabled() == false {
+		return
+	}
+
+	for cmd_buff_ref in INTERNAL.cmd_buffer_refs[get_frame_idx()] {
+		command_buffer_end(cmd_buff_ref)
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+// Ends the graphics command buffer of the frame and begins the one that waits for the async
+// compute work. Called once the last async compute task of the frame was rendered.
+@(private)
+async_compute_split_graphics :: proc() {
+	if is_async_compute_enabled() == false || INTERNAL.is_graphics_split {
+		return
+	}
+
+	command_buffer_end(get_frame_cmd_buffer_ref())
+	INTERNAL.is_graphics_split = true
+	command_buffer_begin(get_frame_cmd_buffer_ref())
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+async_compute_is_graphics_split :: #force_inline proc() -> bool {
+	return INTERNAL.is_graphics_split
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+async_compute_get_post_graphics_cmd_buffer_ref :: #force_inline proc() -> CommandBufferRef {
+	return INTERNAL.post_async_compute_cmd_buffer_refs[get_frame_idx()]
+}
+
+//---------------------------------------------------------------------------//
+
+// Called when an early resource is acquired from the graphics queue, usually on the first frame
+// it's used by the async compute
+@(private)
+async_compute_set_early_waits_for_graphics :: #force_inline proc() {
+	INTERNAL.early_waits_for_graphics = true
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+async_compute_early_waits_for_graphics :: #force_inline proc() -> bool {
+	return INTERNAL.early_waits_for_graphics
+}
+
+//---------------------------------------------------------------------------//
+
+// Falls back to the graphics command buffer when there is no dedicated compute queue
+@(private)
+get_frame_async_compute_cmd_buffer_ref :: proc(p_stage: AsyncComputeStage) -> CommandBufferRef {
+	if is_async_compute_enabled() {
+		return INTERNAL.cmd_buffer_refs[get_frame_idx()][p_stage]
+	}
+	return get_frame_cmd_buffer_ref()
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+render_task_is_async_compute :: proc(p_render_task_ref: RenderTaskRef) -> bool {
+	render_task := &g_resources.render_tasks[render_task_get_idx(p_render_task_ref)]
+	return .AsyncCompute in render_task.desc.flags && is_async_compute_enabled()
+}
+
+//---------------------------------------------------------------------------//
+
+// Command buffer the render task records its work into
+@(private)
+render_task_get_cmd_buffer_ref :: proc(
+	p_render_task_ref: RenderTaskRef,
+	p_stage := AsyncComputeStage.Main,
+) -> CommandBufferRef {
+	if render_task_is_async_compute(p_render_task_ref) {
+		return INTERNAL.cmd_buffer_refs[get_frame_idx()][p_stage]
+	}
+	return get_frame_cmd_buffer_ref()
+}
+
+//---------------------------------------------------------------------------//
@@ -4,13 +4,19 @@ package renderer
 
 import "../common"
 import "core:log"
+import "core:math/rand"
 import "core:mem"
+import "core:slice"
+import "core:time"
 
 //---------------------------------------------------------------------------//
 
 BufferUploadRequestFlagBits :: enum u8 {
 	RunOnNextFrame,
 	RunSliced,
+	// Small write that is coalesced with the other writes to the same buffer
+	// and sent to the GPU by buffer_upload_flush_coalesced_requests
+	Coalesced,
 }
 
 BufferUploadRequestFlags :: distinct bit_set[BufferUploadRequestFlagBits;u8]
@@ -61,6 +67,35 @@ BufferUploadResponse :: struct {
 
 //---------------------------------------------------------------------------//
 
+// Write recorded with the .Coalesced flag, its data is already in the staging buffer.
+// After coalescing, the same struct describes a run of contiguous writes.
+@(private)
+BufferCoalescedWrite :: struct {
+	dst_buff_offset:       u32,
+	staging_buffer_offset: u32,
+	size:                  u32,
+	first_usage_stage:     PipelineStageFlagBits,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+BufferCoalescedTarget :: struct {
+	dst_buff: BufferRef,
+	writes:   [dynamic]BufferCoalescedWrite,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+g_buffer_upload_stats: struct {
+	num_coalesced_writes: u32,
+	num_coalesced_bytes:  u32,
+	num_copy_regions:     u32,
+}
+
+//---------------------------------------------------------------------------//
+
 @(private = "file")
 INTERNAL: struct {
 	// used for upload request each frame
@@ -72,6 +107,7 @@ INTERNAL: struct {
 	single_async_staging_region_size: u32,
 	last_frame_requests_per_buffer:   map[BufferRef][dynamic]BufferUploadRequest,
 	async_uploads:                    [dynamic]AsyncUploadInfo,
+	coalesced_targets:                [dynamic]BufferCoalescedTarget,
 }
 
 //---------------------------------------------------------------------------//
@@ -157,6 +193,10 @@ buffer_upload_init :: proc(p_options: BufferUploadInitOptions) -> bool {
 		}
 	}
 
+	INTERNAL.coalesced_targets = make(
+		[dynamic]BufferCoalescedTarget,
+		G_RENDERER_ALLOCATORS.main_allocator,
+	)
 
 	return backend_buffer_upload_init(p_options)
 }
@@ -167,6 +207,7 @@ buffer_upload_init :: proc(p_options: BufferUploadInitOptions) -> bool {
 buffer_upload_begin_frame :: proc() {
 	INTERNAL.staging_buffer_offset = 0
 	INTERNAL.async_staging_buffer_offset = 0
+	g_buffer_upload_stats = {}
 }
 
 //---------------------------------------------------------------------------//
@@ -192,6 +233,10 @@ buffer_upload_request_upload :: proc(p_request: BufferUploadRequest) -> BufferUp
 		return buffer_upload_request_upload_integrated(p_request)
 	}
 
+	if .Coalesced in p_request.flags {
+		return buffer_upload_request_coalesced(p_request)
+	}
+
 	// Slice the upload accross multiple frames
 	if .RunSliced in p_request.flags {
 		async_upload_info := AsyncUploadInfo {
@@ -348,6 +393,259 @@ buffer_upload_request_upload_integrated :: proc(
 }
 
 
+//---------------------------------------------------------------------------//
+
+// Copies the data of a .Coalesced request into the staging buffer right away, so the data pointer
+// doesn't have to outlive the call, and records the write for buffer_upload_flush_coalesced_requests
+@(private = "file")
+buffer_upload_request_coalesced :: proc(p_request: BufferUploadRequest) -> BufferUploadResponse {
+
+	if buffer_upload_check_if_fits(p_request.dst_buff, p_request.size) == false {
+		return BufferUploadResponse{status = .Failed}
+	}
+
+	pending_request := buffer_upload_send_data(p_request)
+
+	target := buffer_upload_get_coalesced_target(p_request.dst_buff)
+	append(
+		&target.writes,
+		BufferCoalescedWrite {
+			dst_buff_offset = p_request.dst_buff_offset,
+			staging_buffer_offset = pending_request.staging_buffer_offset,
+			size = p_request.size,
+			first_usage_stage = p_request.first_usage_stage,
+		},
+	)
+
+	return BufferUploadResponse{status = .Uploaded}
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+buffer_upload_get_coalesced_target :: proc(p_buffer_ref: BufferRef) -> ^BufferCoalescedTarget {
+
+	// There's only a handful of buffers that receive coalesced writes
+	for &target in INTERNAL.coalesced_targets {
+		if target.dst_buff == p_buffer_ref {
+			return &target
+		}
+	}
+
+	append(
+		&INTERNAL.coalesced_targets,
+		BufferCoalescedTarget {
+			dst_buff = p_buffer_ref,
+			writes = make([dynamic]BufferCoalescedWrite, G_RENDERER_ALLOCATORS.main_allocator),
+		},
+	)
+
+	return &INTERNAL.coalesced_targets[len(INTERNAL.coalesced_targets) - 1]
+}
+
+//---------------------------------------------------------------------------//
+
+// Sends the writes recorded with the .Coalesced flag to the GPU. The writes to each buffer are
+// merged into runs that are contiguous both in the staging and in the destination buffer, which
+// are then sent as the regions of a single copy. Has to be called outside of a render pass.
+@(private)
+buffer_upload_flush_coalesced_requests :: proc() {
+
+	temp_arena := common.Arena{}
+	common.temp_arena_init(&temp_arena, common.MEGABYTE * 16)
+	defer common.arena_delete(temp_arena)
+
+	for &target in INTERNAL.coalesced_targets {
+
+		if len(target.writes) == 0 {
+			continue
+		}
+
+		common.arena_reset(temp_arena)
+
+		runs := make([dynamic]BufferCoalescedWrite, 0, len(target.writes), temp_arena.allocator)
+		buffer_upload_coalesce_writes(target.writes[:], &runs)
+
+		g_buffer_upload_stats.num_coalesced_writes += u32(len(target.writes))
+		clear(&target.writes)
+
+		requests_to_run := make(
+			[dynamic]PendingBufferUploadRequest,
+			0,
+			len(runs),
+			temp_arena.allocator,
+		)
+		for run in runs {
+			append(
+				&requests_to_run,
+				PendingBufferUploadRequest {
+					request = BufferUploadRequest {
+						size = run.size,
+						dst_buff_offset = run.dst_buff_offset,
+						dst_buff = target.dst_buff,
+						dst_queue_usage = .Graphics,
+						first_usage_stage = run.first_usage_stage,
+					},
+					staging_buffer_offset = run.staging_buffer_offset,
+				},
+			)
+			g_buffer_upload_stats.num_coalesced_bytes += run.size
+		}
+
+		backend_run_buffer_upload_requests(
+			INTERNAL.staging_buffer_ref,
+			target.dst_buff,
+			requests_to_run,
+		)
+
+		g_buffer_upload_stats.num_copy_regions += u32(len(runs))
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+// Sorts the writes by their destination offset and merges the ones that are contiguous both
+// in the destination and in the staging buffer into runs. Where writes overlap, partially or
+// fully, the bytes of the latest one win, so the runs never overlap each other.
+@(private)
+buffer_upload_coalesce_writes :: proc(
+	p_writes: []BufferCoalescedWrite,
+	p_runs: ^[dynamic]BufferCoalescedWrite,
+) {
+
+	write_less :: proc(p_lhs, p_rhs: BufferCoalescedWrite) -> bool {
+		return p_lhs.dst_buff_offset < p_rhs.dst_buff_offset
+	}
+
+	// Writes are usually recorded in the order of the resource indices, so they're already sorted
+	if slice.is_sorted_by(p_writes, write_less) == false {
+		slice.sort_by(p_writes, write_less)
+	}
+
+	overlapped_runs := make([dynamic]BufferCoalescedWrite, p_runs.allocator)
+	defer delete(overlapped_runs)
+
+	for write in p_writes {
+
+		write_end := write.dst_buff_offset + write.size
+
+		// The runs are sorted and don't overlap, so the ones the write overlaps are at the end
+		first_overlapped_run := len(p_runs)
+		for first_overlapped_run > 0 {
+			run := p_runs[first_overlapped_run - 1]
+			if run.dst_buff_offset + run.size <= write.dst_buff_offset {
+				break
+			}
+			first_overlapped_run -= 1
+		}
+
+		if first_overlapped_run == len(p_runs) {
+			buffer_upload_append_run(p_runs, write)
+			continue
+		}
+
+		clear(&overlapped_runs)
+		append(&overlapped_runs, ..p_runs^[first_overlapped_run:])
+		resize(p_runs, first_overlapped_run)
+
+		// Split the write and the overlapped runs, keeping the bytes of the later one where they
+		// overlap. Staging space is allocated in the order the writes were recorded and the staging
+		// ranges of two writes never interleave, so the later one has the larger staging offset.
+		write_cursor := write.dst_buff_offset
+		for run in overlapped_runs {
+
+			run_end := run.dst_buff_offset + run.size
+
+			if run.dst_buff_offset < write.dst_buff_offset {
+				buffer_upload_append_run(
+					p_runs,
+					buffer_upload_write_part(run, run.dst_buff_offset, write.dst_buff_offset),
+				)
+			}
+
+			overlap_start := max(run.dst_buff_offset, write.dst_buff_offset)
+			overlap_end := min(run_end, write_end)
+			if overlap_start < overlap_end {
+				if write_cursor < overlap_start {
+					buffer_upload_append_run(
+						p_runs,
+						buffer_upload_write_part(write, write_cursor, overlap_start),
+					)
+				}
+
+				run_part := buffer_upload_write_part(run, overlap_start, overlap_end)
+				write_part := buffer_upload_write_part(write, overlap_start, overlap_end)
+				if run_part.staging_buffer_offset > write_part.staging_buffer_offset {
+					buffer_upload_append_run(p_runs, run_part)
+				} else {
+					buffer_upload_append_run(p_runs, write_part)
+				}
+
+				write_cursor = overlap_end
+			}
+
+			if run_end > write_end {
+				if write_cursor < write_end {
+					buffer_upload_append_run(
+						p_runs,
+						buffer_upload_write_part(write, write_cursor, write_end),
+					)
+					write_cursor = write_end
+				}
+
+				buffer_upload_append_run(
+					p_runs,
+					buffer_upload_write_part(run, max(run.dst_buff_offset, write_end), run_end),
+				)
+			}
+		}
+
+		if write_cursor < write_end {
+			buffer_upload_append_run(
+				p_runs,
+				buffer_upload_write_part(write, write_cursor, write_end),
+			)
+		}
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+// Appends the write to the runs, merging it into the last run when they're contiguous
+@(private = "file")
+buffer_upload_append_run :: proc(
+	p_runs: ^[dynamic]BufferCoalescedWrite,
+	p_write: BufferCoalescedWrite,
+) {
+	if len(p_runs) > 0 {
+		last_run := &p_runs[len(p_runs) - 1]
+		if last_run.dst_buff_offset + last_run.size == p_write.dst_buff_offset &&
+		   last_run.staging_buffer_offset + last_run.size == p_write.staging_buffer_offset &&
+		   last_run.first_usage_stage == p_write.first_usage_stage {
+			last_run.size += p_write.size
+			return
+		}
+	}
+
+	append(p_runs, p_write)
+}
+
+//---------------------------------------------------------------------------//
+
+// Part of the write that covers [p_dst_start, p_dst_end) of the destination buffer
+@(private = "file")
+buffer_upload_write_part :: #force_inline proc(
+	p_write: BufferCoalescedWrite,
+	p_dst_start: u32,
+	p_dst_end: u32,
+) -> BufferCoalescedWrite {
+	part := p_write
+	part.dst_buff_offset = p_dst_start
+	part.staging_buffer_offset += p_dst_start - p_write.dst_buff_offset
+	part.size = p_dst_end - p_dst_start
+	return part
+}
+
 //---------------------------------------------------------------------------//
 
 @(private)
@@ -459,3 +757,287 @@ buffer_upload_finalize_finished_uploads :: proc() {
 }
 
 //---------------------------------------------------------------------------//
+
+// Compares the CPU side of uploading p_num_writes instance sized writes per frame through the
+// per request path (map of requests rebuilt every frame, a staging copy and a copy region per request)
+// with the coalesced path. Dense writes update every instance, sparse ones a random quarter of them.
+// Uses a CPU staging buffer, so it doesn't need any GPU resources and can be run headless.
+buffer_upload_run_benchmark :: proc(p_num_writes: u32, p_num_frames: u32 = 16) {
+
+	WRITE_SIZE :: size_of(MeshInstanceInfoData)
+
+	arena: common.Arena
+	common.arena_init(&arena, 64 * common.MEGABYTE, context.allocator)
+	defer common.arena_delete(arena)
+
+	frame_arena: common.Arena
+	common.arena_init(&frame_arena, 64 * common.MEGABYTE, context.allocator)
+	defer common.arena_delete(frame_arena)
+
+	source_data := make([]MeshInstanceInfoData, p_num_writes * 4, arena.allocator)
+	staging_data := make([]byte, p_num_writes * 4 * WRITE_SIZE, arena.allocator)
+
+	dense_indices := make([]u32, p_num_writes, arena.allocator)
+	for &instance_idx, i in dense_indices {
+		instance_idx = u32(i)
+	}
+
+	// Every instance has a 1 in 4 chance to be dirty, so the runs are short
+	sparse_indices := make([dynamic]u32, 0, p_num_writes, arena.allocator)
+	for instance_idx in 0 ..< p_num_writes * 4 {
+		if rand.uint32() % 4 == 0 {
+			append(&sparse_indices, instance_idx)
+		}
+	}
+
+	dst_buffer_ref := BufferRef {
+		ref = 0,
+	}
+
+	for instance_indices, pattern_idx in ([][]u32{dense_indices, sparse_indices[:]}) {
+
+		// Per request path
+		per_request_duration: time.Duration
+		num_per_request_regions := 0
+		for _ in 0 ..< p_num_frames {
+			free_all(frame_arena.allocator)
+
+			start := time.tick_now()
+
+			requests_per_buffer := make(
+				map[BufferRef][dynamic]BufferUploadRequest,
+				32,
+				frame_arena.allocator,
+			)
+
+			for instance_idx in instance_indices {
+				if (dst_buffer_ref in requests_per_buffer) == false {
+					requests_per_buffer[dst_buffer_ref] = make(
+						[dynamic]BufferUploadRequest,
+						frame_arena.allocator,
+					)
+				}
+				append(
+					&requests_per_buffer[dst_buffer_ref],
+					BufferUploadRequest {
+						dst_buff = dst_buffer_ref,
+						dst_buff_offset = WRITE_SIZE * instance_idx,
+						first_usage_stage = .VertexShader,
+						size = WRITE_SIZE,
+						data_ptr = &source_data[instance_idx],
+					},
+				)
+			}
+
+			staging_offset: u32 = 0
+			num_per_request_regions = 0
+			for _, requests in requests_per_buffer {
+				pending_requests := make(
+					[dynamic]PendingBufferUploadRequest,
+					0,
+					len(requests),
+					frame_arena.allocator,
+				)
+				for request in requests {
+					mem.copy(&staging_data[staging_offset], request.data_ptr, int(request.size))
+					append(
+						&pending_requests,
+						PendingBufferUploadRequest {
+							request = request,
+							staging_buffer_offset = staging_offset,
+						},
+					)
+					staging_offset += request.size
+				}
+				num_per_request_regions += len(pending_requests)
+			}
+
+			per_request_duration += time.tick_since(start)
+		}
+
+		// Coalesced path
+		coalesced_duration: time.Duration
+		num_coalesced_regions := 0
+		for _ in 0 ..< p_num_frames {
+			free_all(frame_arena.allocator)
+
+			start := time.tick_now()
+
+			writes := make(
+				[dynamic]BufferCoalescedWrite,
+				0,
+				len(instance_indices),
+				frame_arena.allocator,
+			)
+
+			staging_offset: u32 = 0
+			for instance_idx in instance_indices {
+				mem.copy(&staging_data[staging_offset], &source_data[instance_idx], WRITE_SIZE)
+				append(
+					&writes,
+					BufferCoalescedWrite {
+						dst_buff_offset = WRITE_SIZE * instance_idx,
+						staging_buffer_offset = staging_offset,
+						size = WRITE_SIZE,
+						first_usage_stage = .VertexShader,
+					},
+				)
+				staging_offset += WRITE_SIZE
+			}
+
+			runs := make([dynamic]BufferCoalescedWrite, 0, len(writes), frame_arena.allocator)
+			buffer_upload_coalesce_writes(writes[:], &runs)
+
+			pending_requests := make(
+				[dynamic]PendingBufferUploadRequest,
+				0,
+				len(runs),
+				frame_arena.allocator,
+			)
+			for run in runs {
+				append(
+					&pending_requests,
+					PendingBufferUploadRequest {
+						request = BufferUploadRequest {
+							dst_buff = dst_buffer_ref,
+							dst_buff_offset = run.dst_buff_offset,
+							first_usage_stage = run.first_usage_stage,
+							size = run.size,
+						},
+						staging_buffer_offset = run.staging_buffer_offset,
+					},
+				)
+			}
+			num_coalesced_regions = len(pending_requests)
+
+			coalesced_duration += time.tick_since(start)
+		}
+
+		num_writes := len(instance_indices)
+		num_bytes := f64(num_writes * WRITE_SIZE)
+
+		per_request_uploads_per_sec :=
+			f64(num_writes) * f64(p_num_frames) / max(time.duration_seconds(per_request_duration), 1e-9)
+		coalesced_uploads_per_sec :=
+			f64(num_writes) * f64(p_num_frames) / max(time.duration_seconds(coalesced_duration), 1e-9)
+
+		log.infof(
+			"Buffer upload benchmark (%s): %d writes of %d bytes - per request: %.2f M uploads/s, %d copy regions, %.0f bytes/copy region, coalesced: %.2f M uploads/s (%.1fx), %d copy regions, %.0f bytes/copy region\n",
+			"dense" if pattern_idx == 0 else "sparse",
+			num_writes,
+			WRITE_SIZE,
+			per_request_uploads_per_sec / 1e6,
+			num_per_request_regions,
+			num_bytes / f64(max(num_per_request_regions, 1)),
+			coalesced_uploads_per_sec / 1e6,
+			coalesced_uploads_per_sec / max(per_request_uploads_per_sec, 1e-9),
+			num_coalesced_regions,
+			num_bytes / f64(max(num_coalesced_regions, 1)),
+		)
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+// Coalesces random writes, some of which partially overlap, and checks that the runs are sorted,
+// don't overlap and leave the destination with the same data as applying the writes one by one.
+// Runs on the CPU only. Logs an error and returns false if any check fails.
+buffer_upload_run_checks :: proc() -> bool {
+
+	BUFFER_SIZE :: 4096
+	MAX_WRITE_SIZE :: 256
+	MAX_NUM_WRITES :: 64
+	NUM_ITERATIONS :: 1024
+
+	expected_data := make([]byte, BUFFER_SIZE)
+	defer delete(expected_data)
+	coalesced_data := make([]byte, BUFFER_SIZE)
+	defer delete(coalesced_data)
+	staging_data := make([]byte, MAX_WRITE_SIZE * MAX_NUM_WRITES)
+	defer delete(staging_data)
+
+	writes := make([dynamic]BufferCoalescedWrite, 0, MAX_NUM_WRITES)
+	defer delete(writes)
+	runs := make([dynamic]BufferCoalescedWrite, 0, MAX_NUM_WRITES)
+	defer delete(runs)
+
+	for _ in 0 ..< NUM_ITERATIONS {
+
+		slice.zero(expected_data)
+		slice.zero(coalesced_data)
+		clear(&writes)
+		clear(&runs)
+
+		// Mostly instance sized writes, that either match or don't overlap each other,
+		// mixed with unaligned ones that partially overlap them
+		staging_offset: u32 = 0
+		num_writes := 1 + rand.uint32() % MAX_NUM_WRITES
+		for _ in 0 ..< num_writes {
+			size: u32 = 64
+			dst_offset := 64 * (rand.uint32() % (BUFFER_SIZE / 64))
+			if rand.uint32() % 4 == 0 {
+				size = 1 + rand.uint32() % MAX_WRITE_SIZE
+				dst_offset = rand.uint32() % (BUFFER_SIZE - size + 1)
+			}
+
+			for i in 0 ..< size {
+				value := u8(1 + rand.uint32() % 255)
+				staging_data[staging_offset + i] = value
+				expected_data[dst_offset + i] = value
+			}
+
+			append(
+				&writes,
+				BufferCoalescedWrite {
+					dst_buff_offset = dst_offset,
+					staging_buffer_offset = staging_offset,
+					size = size,
+					first_usage_stage = .VertexShader,
+				},
+			)
+			staging_offset += size
+		}
+
+		buffer_upload_coalesce_writes(writes[:], &runs)
+
+		for run, i in runs {
+			is_empty := run.size == 0
+			is_out_of_bounds :=
+				run.dst_buff_offset + run.size > BUFFER_SIZE ||
+				run.staging_buffer_offset + run.size > staging_offset
+			overlaps_previous :=
+				i > 0 && runs[i - 1].dst_buff_offset + runs[i - 1].size > run.dst_buff_offset
+
+			if is_empty || is_out_of_bounds || overlaps_previous {
+				log.errorf(
+					"Buffer upload check failed - run %d [%d, %d) is empty, out of bounds or overlaps the previous one\n",
+					i,
+					run.dst_buff_offset,
+					run.dst_buff_offset + run.size,
+				)
+				return false
+			}
+
+			mem.copy(
+				&coalesced_data[run.dst_buff_offset],
+				&staging_data[run.staging_buffer_offset],
+				int(run.size),
+			)
+		}
+
+		if slice.equal(expected_data, coalesced_data) == false {
+			log.errorf(
+				"Buffer upload check failed - %d writes coalesced into %d runs don't match the writes\n",
+				num_writes,
+				len(runs),
+			)
+			return false
+		}
+	}
+
+	log.info("Buffer upload checks passed\n")
+
+	return true
+}
+
+//---------------------------------------------------------------------------//
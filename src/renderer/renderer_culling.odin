@@ -0,0 +1,493 @@
+package renderer
+
+//---------------------------------------------------------------------------//
+
+import "../common"
+import "base:intrinsics"
+import "core:log"
+import "core:math/linalg/glsl"
+import "core:math/rand"
+import "core:mem"
+import "core:simd"
+import "core:sync"
+import "core:time"
+
+//---------------------------------------------------------------------------//
+
+// Number of bounding boxes tested against a frustum plane at once
+@(private = "file")
+CULLING_SIMD_WIDTH :: 8
+
+@(private = "file")
+f32xN :: #simd[CULLING_SIMD_WIDTH]f32
+
+// Number of bounding boxes culled by a single job, has to be a multiple of CULLING_SIMD_WIDTH
+@(private = "file")
+CULLING_JOB_BATCH_SIZE :: 4096
+
+//---------------------------------------------------------------------------//
+
+// World space bounding boxes stored in SoA layout, so that they can be culled
+// CULLING_SIMD_WIDTH at a time. The boxes past the last full SIMD group are culled one by one.
+@(private)
+CullingBoundingBoxes :: struct {
+	center_x: [dynamic]f32,
+	center_y: [dynamic]f32,
+	center_z: [dynamic]f32,
+	extent_x: [dynamic]f32,
+	extent_y: [dynamic]f32,
+	extent_z: [dynamic]f32,
+	count:    u32,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+g_culling_stats: struct {
+	num_tested: u32,
+	num_culled: u32,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+culling_bounding_boxes_create :: proc(
+	p_capacity: u32,
+	p_allocator: mem.Allocator,
+) -> CullingBoundingBoxes {
+	return CullingBoundingBoxes {
+		center_x = make([dynamic]f32, 0, p_capacity, p_allocator),
+		center_y = make([dynamic]f32, 0, p_capacity, p_allocator),
+		center_z = make([dynamic]f32, 0, p_capacity, p_allocator),
+		extent_x = make([dynamic]f32, 0, p_capacity, p_allocator),
+		extent_y = make([dynamic]f32, 0, p_capacity, p_allocator),
+		extent_z = make([dynamic]f32, 0, p_capacity, p_allocator),
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+// Transforms the mesh space bounding box to world space and adds it to the list
+// https://www.realtimerendering.com/resources/GraphicsGems/gems/TransBox.c
+@(private)
+culling_bounding_boxes_add :: proc(
+	p_bounding_boxes: ^CullingBoundingBoxes,
+	p_bounding_box: BoundingBox,
+	p_model_matrix: glsl.mat4,
+) {
+	center := (p_bounding_box.max + p_bounding_box.min) * 0.5
+	extent := (p_bounding_box.max - p_bounding_box.min) * 0.5
+
+	m := p_model_matrix
+	world_center := (m * glsl.vec4{center.x, center.y, center.z, 1}).xyz
+	world_extent := glsl.vec3 {
+		abs(m[0, 0]) * extent.x + abs(m[0, 1]) * extent.y + abs(m[0, 2]) * extent.z,
+		abs(m[1, 0]) * extent.x + abs(m[1, 1]) * extent.y + abs(m[1, 2]) * extent.z,
+		abs(m[2, 0]) * extent.x + abs(m[2, 1]) * extent.y + abs(m[2, 2]) * extent.z,
+	}
+
+	append(&p_bounding_boxes.center_x, world_center.x)
+	append(&p_bounding_boxes.center_y, world_center.y)
+	append(&p_bounding_boxes.center_z, world_center.z)
+	append(&p_bounding_boxes.extent_x, world_extent.x)
+	append(&p_bounding_boxes.extent_y, world_extent.y)
+	append(&p_bounding_boxes.extent_z, world_extent.z)
+
+	p_bounding_boxes.count += 1
+}
+
+//---------------------------------------------------------------------------//
+
+// Tests the bounding boxes against the frustum planes of the view. Visibility is accumulated
+// in p_visibility, so that a box that is visible in any of the views stays visible.
+@(private)
+culling_frustum_cull_bounding_boxes :: proc(
+	p_frustum_planes: [FRUSTUM_PLANES_COUNT]glsl.vec4,
+	p_bounding_boxes: ^CullingBoundingBoxes,
+	p_visibility: []bool,
+) {
+	assert(u32(len(p_visibility)) >= p_bounding_boxes.count)
+
+	// Broadcast the plane normals, their absolute values and distances
+	plane_x, plane_y, plane_z, plane_w: [FRUSTUM_PLANES_COUNT]f32xN
+	plane_abs_x, plane_abs_y, plane_abs_z: [FRUSTUM_PLANES_COUNT]f32xN
+	for plane, i in p_frustum_planes {
+		plane_x[i] = culling_splat(plane.x)
+		plane_y[i] = culling_splat(plane.y)
+		plane_z[i] = culling_splat(plane.z)
+		plane_w[i] = culling_splat(plane.w)
+		plane_abs_x[i] = culling_splat(abs(plane.x))
+		plane_abs_y[i] = culling_splat(abs(plane.y))
+		plane_abs_z[i] = culling_splat(abs(plane.z))
+	}
+
+	cull_job_data := CullingJobData {
+		bounding_boxes = p_bounding_boxes,
+		visibility     = p_visibility,
+		frustum_planes = p_frustum_planes,
+		plane_x        = plane_x,
+		plane_y        = plane_y,
+		plane_z        = plane_z,
+		plane_w        = plane_w,
+		plane_abs_x    = plane_abs_x,
+		plane_abs_y    = plane_abs_y,
+		plane_abs_z    = plane_abs_z,
+	}
+
+	common.jobs_parallel_for(
+		p_bounding_boxes.count,
+		CULLING_JOB_BATCH_SIZE,
+		culling_frustum_cull_job,
+		&cull_job_data,
+	)
+
+	sync.atomic_add(&g_culling_stats.num_tested, p_bounding_boxes.count)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+CullingJobData :: struct {
+	bounding_boxes: ^CullingBoundingBoxes,
+	visibility:     []bool,
+	frustum_planes: [FRUSTUM_PLANES_COUNT]glsl.vec4,
+	plane_x:        [FRUSTUM_PLANES_COUNT]f32xN,
+	plane_y:        [FRUSTUM_PLANES_COUNT]f32xN,
+	plane_z:        [FRUSTUM_PLANES_COUNT]f32xN,
+	plane_w:        [FRUSTUM_PLANES_COUNT]f32xN,
+	plane_abs_x:    [FRUSTUM_PLANES_COUNT]f32xN,
+	plane_abs_y:    [FRUSTUM_PLANES_COUNT]f32xN,
+	plane_abs_z:    [FRUSTUM_PLANES_COUNT]f32xN,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+culling_frustum_cull_job :: proc(p_start: u32, p_end: u32, p_user_data: rawptr) {
+	data := (^CullingJobData)(p_user_data)
+
+	num_culled: u32 = 0
+
+	// Only the last batch can end with a partial SIMD group, as the batch size is a multiple
+	// of CULLING_SIMD_WIDTH
+	simd_end := p_start + (p_end - p_start) / CULLING_SIMD_WIDTH * CULLING_SIMD_WIDTH
+
+	for i := p_start; i < simd_end; i += CULLING_SIMD_WIDTH {
+
+		center_x := culling_load(data.bounding_boxes.center_x[:], i)
+		center_y := culling_load(data.bounding_boxes.center_y[:], i)
+		center_z := culling_load(data.bounding_boxes.center_z[:], i)
+		extent_x := culling_load(data.bounding_boxes.extent_x[:], i)
+		extent_y := culling_load(data.bounding_boxes.extent_y[:], i)
+		extent_z := culling_load(data.bounding_boxes.extent_z[:], i)
+
+		// A box is outside of the frustum when it's entirely behind any of the planes,
+		// so we keep track of the smallest (signed distance + projected radius)
+		min_distance := culling_splat(max(f32))
+
+		for p in 0 ..< FRUSTUM_PLANES_COUNT {
+			distance :=
+				data.plane_x[p] * center_x +
+				data.plane_y[p] * center_y +
+				data.plane_z[p] * center_z +
+				data.plane_w[p]
+			radius :=
+				data.plane_abs_x[p] * extent_x +
+				data.plane_abs_y[p] * extent_y +
+				data.plane_abs_z[p] * extent_z
+
+			min_distance = simd.min(min_distance, distance + radius)
+		}
+
+		min_distances := transmute([CULLING_SIMD_WIDTH]f32)min_distance
+
+		for lane in 0 ..< u32(CULLING_SIMD_WIDTH) {
+			if min_distances[lane] >= 0 {
+				data.visibility[i + lane] = true
+			} else {
+				num_culled += 1
+			}
+		}
+	}
+
+	// Cull the remaining boxes one by one, so the arrays never have to be read past the count
+	bounding_boxes := data.bounding_boxes
+	for i in simd_end ..< p_end {
+		center := glsl.vec3 {
+			bounding_boxes.center_x[i],
+			bounding_boxes.center_y[i],
+			bounding_boxes.center_z[i],
+		}
+		extent := glsl.vec3 {
+			bounding_boxes.extent_x[i],
+			bounding_boxes.extent_y[i],
+			bounding_boxes.extent_z[i],
+		}
+
+		min_distance := max(f32)
+		for plane in data.frustum_planes {
+			distance := glsl.dot(plane.xyz, center) + plane.w
+			radius := glsl.dot(glsl.abs(plane.xyz), extent)
+			min_distance = min(min_distance, distance + radius)
+		}
+
+		if min_distance >= 0 {
+			data.visibility[i] = true
+		} else {
+			num_culled += 1
+		}
+	}
+
+	sync.atomic_add(&g_culling_stats.num_culled, num_culled)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+culling_reset_stats :: proc() {
+	g_culling_stats = {}
+}
+
+//---------------------------------------------------------------------------//
+
+// Culls p_num_instances random bounding boxes against a random view and reports the throughput.
+// Doesn't touch any GPU resources, so it can be run headless.
+culling_run_benchmark :: proc(p_num_instances: u32, p_num_iterations: u32 = 16) {
+
+	temp_arena: common.Arena
+	common.temp_arena_init(&temp_arena, common.MEGABYTE * 16)
+	defer common.arena_delete(temp_arena)
+
+	bounding_boxes := culling_bounding_boxes_create(p_num_instances, temp_arena.allocator)
+	visibility := make([]bool, p_num_instances, temp_arena.allocator)
+
+	for _ in 0 ..< p_num_instances {
+		position := glsl.vec3 {
+			rand.float32_range(-500, 500),
+			rand.float32_range(-50, 50),
+			rand.float32_range(-500, 500),
+		}
+		extent := glsl.vec3 {
+			rand.float32_range(0.1, 5),
+			rand.float32_range(0.1, 5),
+			rand.float32_range(0.1, 5),
+		}
+		culling_bounding_boxes_add(
+			&bounding_boxes,
+			BoundingBox{min = -extent, max = extent},
+			glsl.mat4Translate(position),
+		)
+	}
+
+	camera := RenderCamera {
+		position   = {0, 0, 0},
+		forward    = glsl.normalize(
+			glsl.vec3{rand.float32_range(-1, 1), 0, rand.float32_range(-1, 1)},
+		),
+		up         = {0, 1, 0},
+		fov        = 45,
+		near_plane = 0.01,
+		far_plane  = 1000,
+	}
+
+	projection := common.mat4PerspectiveInfiniteReverse(
+		glsl.radians_f32(f32(camera.fov)),
+		16.0 / 9.0,
+		camera.near_plane,
+	)
+	view := glsl.mat4LookAt(camera.position, camera.position + camera.forward, camera.up)
+	frustum_planes := render_view_compute_frustum_planes(
+		projection * view,
+		camera.position,
+		camera.forward,
+		camera.far_plane,
+	)
+
+	culling_reset_stats()
+
+	start := time.tick_now()
+	for _ in 0 ..< p_num_iterations {
+		mem.zero_slice(visibility)
+		culling_frustum_cull_bounding_boxes(frustum_planes, &bounding_boxes, visibility)
+	}
+	duration := time.duration_seconds(time.tick_since(start))
+
+	instances_per_second := f64(p_num_instances * p_num_iterations) / duration
+
+	log.infof(
+		"Culling benchmark: %d instances, %d iterations, %.3f ms/iteration, %.2f M instances/s, %d%% culled\n",
+		p_num_instances,
+		p_num_iterations,
+		duration * 1000 / f64(p_num_iterations),
+		instances_per_second / 1000000,
+		g_culling_stats.num_culled * 100 / max(g_culling_stats.num_tested, 1),
+	)
+
+	culling_reset_stats()
+}
+
+//---------------------------------------------------------------------------//
+
+// Culls the meshlets of a mesh instance with their bounding spheres against the frustum planes
+// and with their normal cones against the camera position, so back facing clusters are skipped.
+// The meshlets are in mesh space, the model matrix is expected to have an uniform scale.
+// Returns the number of visible meshlets, p_visibility is set for each of them.
+culling_cull_meshlets :: proc(
+	p_meshlets: []Meshlet,
+	p_model_matrix: glsl.mat4,
+	p_camera_position: glsl.vec3,
+	p_frustum_planes: [FRUSTUM_PLANES_COUNT]glsl.vec4,
+	p_visibility: []bool,
+) -> u32 {
+	assert(len(p_visibility) >= len(p_meshlets))
+
+	m := p_model_matrix
+	scale := glsl.length(glsl.vec3{m[0, 0], m[1, 0], m[2, 0]})
+
+	num_visible: u32 = 0
+
+	for meshlet, i in p_meshlets {
+		p_visibility[i] = false
+
+		center := (m * glsl.vec4{meshlet.center.x, meshlet.center.y, meshlet.center.z, 1}).xyz
+		radius := meshlet.radius * scale
+
+		is_outside_frustum := false
+		for plane in p_frustum_planes {
+			if glsl.dot(plane.xyz, center) + plane.w < -radius {
+				is_outside_frustum = true
+				break
+			}
+		}
+		if is_outside_frustum {
+			continue
+		}
+
+		// The cone of back facing meshlets contains the direction from the camera
+		if meshlet.cone_cutoff < 1 {
+			apex := meshlet.cone_apex
+			axis := meshlet.cone_axis
+			world_apex := (m * glsl.vec4{apex.x, apex.y, apex.z, 1}).xyz
+			world_axis := (m * glsl.vec4{axis.x, axis.y, axis.z, 0}).xyz / scale
+
+			view_dir := glsl.normalize(world_apex - p_camera_position)
+			if glsl.dot(view_dir, world_axis) >= meshlet.cone_cutoff {
+				continue
+			}
+		}
+
+		p_visibility[i] = true
+		num_visible += 1
+	}
+
+	return num_visible
+}
+
+//---------------------------------------------------------------------------//
+
+// Culls p_num_instances randomly placed and rotated copies of the meshlets against a view
+// looking at them and reports the throughput and how many of the meshlets were culled.
+// Doesn't touch any GPU resources, so it can be run headless.
+culling_run_meshlet_benchmark :: proc(
+	p_meshlets: []Meshlet,
+	p_num_instances: u32,
+	p_num_iterations: u32 = 16,
+) {
+	// The inputs scale with the instance count, so they don't come from a fixed size temp arena
+	model_matrices := make([]glsl.mat4, p_num_instances)
+	defer delete(model_matrices)
+
+	for &model_matrix in model_matrices {
+		position := glsl.vec3 {
+			rand.float32_range(-50, 50),
+			rand.float32_range(-5, 5),
+			rand.float32_range(10, 100),
+		}
+		rotation := glsl.quatAxisAngle(
+			glsl.normalize(
+				glsl.vec3 {
+					rand.float32_range(-1, 1),
+					rand.float32_range(-1, 1),
+					rand.float32_range(-1, 1),
+				},
+			),
+			rand.float32_range(0, 2 * glsl.PI),
+		)
+		model_matrix = glsl.mat4Translate(position) * glsl.mat4FromQuat(rotation)
+	}
+
+	camera := RenderCamera {
+		position   = {0, 0, 0},
+		forward    = {0, 0, 1},
+		up         = {0, 1, 0},
+		fov        = 45,
+		near_plane = 0.01,
+		far_plane  = 1000,
+	}
+
+	projection := common.mat4PerspectiveInfiniteReverse(
+		glsl.radians_f32(f32(camera.fov)),
+		16.0 / 9.0,
+		camera.near_plane,
+	)
+	view := glsl.mat4LookAt(camera.position, camera.position + camera.forward, camera.up)
+	frustum_planes := render_view_compute_frustum_planes(
+		projection * view,
+		camera.position,
+		camera.forward,
+		camera.far_plane,
+	)
+
+	visibility := make([]bool, len(p_meshlets))
+	defer delete(visibility)
+	num_visible: u64 = 0
+
+	start := time.tick_now()
+	for _ in 0 ..< p_num_iterations {
+		num_visible = 0
+		for model_matrix in model_matrices {
+			num_visible += u64(
+				culling_cull_meshlets(
+					p_meshlets,
+					model_matrix,
+					camera.position,
+					frustum_planes,
+					visibility,
+				),
+			)
+		}
+	}
+	duration := time.duration_seconds(time.tick_since(start))
+
+	num_tested := u64(len(p_meshlets)) * u64(p_num_instances)
+	meshlets_per_second := f64(num_tested * u64(p_num_iterations)) / duration
+
+	log.infof(
+		"Meshlet culling benchmark: %d meshlets x %d instances, %.3f ms/iteration, %.2f M meshlets/s, %d%% culled\n",
+		len(p_meshlets),
+		p_num_instances,
+		duration * 1000 / f64(p_num_iterations),
+		meshlets_per_second / 1000000,
+		(num_tested - num_visible) * 100 / max(num_tested, 1),
+	)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+culling_splat :: #force_inline proc(p_value: f32) -> f32xN {
+	values: [CULLING_SIMD_WIDTH]f32
+	for &value in values {
+		value = p_value
+	}
+	return transmute(f32xN)values
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+culling_load :: #force_inline proc(p_values: []f32, p_offset: u32) -> f32xN {
+	return intrinsics.unaligned_load((^f32xN)(&p_values[p_offset]))
+}
+
+//---------------------------------------------------------------------------//
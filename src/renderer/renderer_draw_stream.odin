@@ -8,6 +8,21 @@ import "core:slice"
 
 //---------------------------------------------------------------------------//
 
+// Draw streams with fewer draws than this per thread are recorded inline into the primary command buffer
+@(private = "file")
+DRAW_STREAM_MIN_DRAWS_PER_CHUNK :: #config(DRAW_STREAM_MIN_DRAWS_PER_CHUNK, 64)
+
+@(private = "file")
+DRAW_STREAM_MAX_VERTEX_BUFFERS :: 8
+
+@(private = "file")
+DRAW_STREAM_MAX_BIND_GROUPS :: 8
+
+@(private = "file")
+INVALID_DRAW_STREAM_OFFSET :: max(u32)
+
+//---------------------------------------------------------------------------//
+
 // Array of operations that can be performed on a draw stream. Those functions mutate the 
 // draw info in the draw stream dispatch and call appropriate functions to configure the GPU.
 // Order of these functions has to match the order of DrawStramOp enum, as those functions are indexed
@@ -22,6 +37,7 @@ g_draw_stream_ops := []proc(_: ^DrawStreamDispatch) {
 	draw_stream_dispatch_set_first_instance,
 	draw_stream_dispatch_set_draw_count,
 	draw_stream_dispatcher_submit_draw,
+	draw_stream_dispatcher_submit_indirect_draw,
 }
 
 //---------------------------------------------------------------------------//
@@ -36,6 +52,7 @@ DrawStreamOp :: enum u32 {
 	SetFirstInstance,
 	SetDrawCount,
 	SubmitDraw,
+	SubmitIndirectDraw,
 }
 
 //---------------------------------------------------------------------------//
@@ -47,6 +64,17 @@ IndexType :: enum u8 {
 
 //---------------------------------------------------------------------------//
 
+// Arguments of a single indirect draw, see draw_stream_submit_indirect_draw
+DrawIndexedIndirectCommand :: struct #packed {
+	index_count:    u32,
+	instance_count: u32,
+	first_index:    u32,
+	vertex_offset:  i32,
+	first_instance: u32,
+}
+
+//---------------------------------------------------------------------------//
+
 DrawStream :: struct {
 	name:                        common.Name,
 	// Encoded draw stream data: field id and it's values
@@ -55,6 +83,7 @@ DrawStream :: struct {
 	current_index_buffer_ref:    BufferRef,
 	current_index_buffer_offset: u32,
 	current_pipeline_ref:        GraphicsPipelineRef,
+	num_draws:                   u32,
 	allocator:                   mem.Allocator,
 }
 
@@ -79,6 +108,31 @@ DrawStreamDispatch :: struct {
 
 //---------------------------------------------------------------------------//
 
+// Part of the draw stream that is recorded into a separate secondary command buffer. As secondary command
+// buffers don't inherit any state, we store offsets of the last state changing ops issued before the chunk
+// starts, so they can be replayed before recording the chunk
+@(private = "file")
+DrawStreamChunk :: struct {
+	draw_stream:                     ^DrawStream,
+	dynamic_offsets:                 []u32,
+	render_pass_ref:                 RenderPassRef,
+	cmd_buff_ref:                    CommandBufferRef,
+	begin_offset:                    u32,
+	end_offset:                      u32,
+	pipeline_op_offset:              u32,
+	index_buffer_op_offset:          u32,
+	vertex_buffer_op_offsets:        [DRAW_STREAM_MAX_VERTEX_BUFFERS]u32,
+	bind_group_op_offsets:           [DRAW_STREAM_MAX_BIND_GROUPS]u32,
+	bind_group_dynamic_offsets_used: [DRAW_STREAM_MAX_BIND_GROUPS]u32,
+	draw_count:                      u32,
+	instance_count:                  u32,
+	first_instance:                  u32,
+	current_push_constant:           u32,
+	dynamic_offsets_used:            u32,
+}
+
+//---------------------------------------------------------------------------//
+
 draw_stream_create :: proc(
 	p_draw_stream_allocator: mem.Allocator,
 	name: common.Name,
@@ -144,6 +198,238 @@ draw_stream_dispatch :: proc(
 
 //---------------------------------------------------------------------------//
 
+// Returns true if the draw stream is large enough to be recorded with draw_stream_dispatch_parallel.
+// In that case, the render pass has to be begun with the SecondaryCommandBuffers flag.
+draw_stream_should_dispatch_parallel :: proc(p_draw_stream: ^DrawStream) -> bool {
+	return(
+		G_RENDERER_SETTINGS.parallel_command_buffer_recording &&
+		draw_stream_calculate_num_chunks(p_draw_stream) > 1 \
+	)
+}
+
+//---------------------------------------------------------------------------//
+
+// Splits the draw stream into chunks, records each of them into a secondary command buffer
+// on the job system threads and executes them from p_cmd_buff_ref
+draw_stream_dispatch_parallel :: proc(
+	p_cmd_buff_ref: CommandBufferRef,
+	p_render_pass_ref: RenderPassRef,
+	p_draw_stream: ^DrawStream,
+	p_dynamic_offsets: []u32 = {},
+) {
+	num_chunks := draw_stream_calculate_num_chunks(p_draw_stream)
+	assert(num_chunks > 1)
+
+	temp_arena := common.Arena{}
+	common.temp_arena_init(&temp_arena)
+	defer common.arena_delete(temp_arena)
+
+	chunks := draw_stream_split_into_chunks(p_draw_stream, num_chunks, temp_arena.allocator)
+
+	chunk_jobs := make([]common.Job, len(chunks), temp_arena.allocator)
+	chunk_cmd_buff_refs := make([]CommandBufferRef, len(chunks), temp_arena.allocator)
+
+	for &chunk, i in chunks {
+		chunk.draw_stream = p_draw_stream
+		chunk.dynamic_offsets = p_dynamic_offsets
+		chunk.render_pass_ref = p_render_pass_ref
+		chunk.cmd_buff_ref = command_buffer_acquire_secondary()
+
+		chunk_cmd_buff_refs[i] = chunk.cmd_buff_ref
+		chunk_jobs[i] = common.Job {
+			procedure = draw_stream_record_chunk,
+			user_data = &chunk,
+		}
+	}
+
+	counter: common.JobCounter
+	common.jobs_run(chunk_jobs, &counter)
+	common.jobs_wait(&counter)
+
+	command_buffer_execute_secondary(p_cmd_buff_ref, chunk_cmd_buff_refs)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+draw_stream_calculate_num_chunks :: proc(p_draw_stream: ^DrawStream) -> u32 {
+	return min(
+		p_draw_stream.num_draws / DRAW_STREAM_MIN_DRAWS_PER_CHUNK,
+		common.jobs_get_num_threads(),
+		command_buffer_get_num_available_secondary(),
+	)
+}
+
+//---------------------------------------------------------------------------//
+
+// Walks the draw stream without recording anything and splits it into p_num_chunks
+// chunks with roughly the same number of draws, capturing the state at the start of each chunk
+@(private = "file")
+draw_stream_split_into_chunks :: proc(
+	p_draw_stream: ^DrawStream,
+	p_num_chunks: u32,
+	p_allocator: mem.Allocator,
+) -> []DrawStreamChunk {
+
+	chunks := make([dynamic]DrawStreamChunk, 0, p_num_chunks, p_allocator)
+	draws_per_chunk := (p_draw_stream.num_draws + p_num_chunks - 1) / p_num_chunks
+
+	state := DrawStreamChunk {
+		pipeline_op_offset     = INVALID_DRAW_STREAM_OFFSET,
+		index_buffer_op_offset = INVALID_DRAW_STREAM_OFFSET,
+	}
+	for i in 0 ..< DRAW_STREAM_MAX_VERTEX_BUFFERS {
+		state.vertex_buffer_op_offsets[i] = INVALID_DRAW_STREAM_OFFSET
+	}
+	for i in 0 ..< DRAW_STREAM_MAX_BIND_GROUPS {
+		state.bind_group_op_offsets[i] = INVALID_DRAW_STREAM_OFFSET
+	}
+
+	chunk := state
+	num_chunk_draws: u32 = 0
+	pipeline_ref := InvalidGraphicsPipelineRef
+
+	data := p_draw_stream.encoded_draw_stream_data[:]
+	offset: u32 = 0
+
+	for offset < u32(len(data)) {
+		op_offset := offset
+		op := DrawStreamOp(data[offset])
+		offset += 1
+
+		switch op {
+		case .BindPipeline:
+			pipeline_ref = GraphicsPipelineRef {
+				ref = data[offset],
+			}
+			state.pipeline_op_offset = op_offset
+			offset += 1
+		case .BindVertexBuffer:
+			binding := data[offset + 1]
+			state.vertex_buffer_op_offsets[binding] = op_offset
+			offset += 4
+		case .BindIndexBuffer:
+			state.index_buffer_op_offset = op_offset
+			offset += 4
+		case .ChangeBindGroup:
+			binding := data[offset + 1]
+			state.bind_group_op_offsets[binding] = op_offset
+			state.bind_group_dynamic_offsets_used[binding] = state.dynamic_offsets_used
+			num_offsets := data[offset + 2]
+			for dynamic_offset in data[offset + 3:offset + 3 + num_offsets] {
+				if dynamic_offset == common.DYNAMIC_OFFSET {
+					state.dynamic_offsets_used += 1
+				}
+			}
+			offset += 3 + num_offsets
+		case .SetInstanceCount:
+			state.instance_count = data[offset]
+			offset += 1
+		case .SetFirstInstance:
+			state.first_instance = data[offset]
+			offset += 1
+		case .SetDrawCount:
+			state.draw_count = data[offset]
+			offset += 1
+		case .SubmitDraw, .SubmitIndirectDraw:
+			if op == .SubmitIndirectDraw {
+				offset += 5
+			}
+
+			pipeline := &g_resources.graphics_pipelines[graphics_pipeline_get_idx(pipeline_ref)]
+			state.current_push_constant += u32(len(pipeline.desc.push_constants))
+
+			num_chunk_draws += 1
+			if num_chunk_draws < draws_per_chunk {
+				continue
+			}
+
+			chunk.end_offset = offset
+			append(&chunks, chunk)
+
+			chunk = state
+			chunk.begin_offset = offset
+			num_chunk_draws = 0
+		}
+	}
+
+	// Ops after the last draw don't draw anything, so they can be skipped
+	if num_chunk_draws > 0 {
+		chunk.end_offset = offset
+		append(&chunks, chunk)
+	}
+
+	assert(u32(len(chunks)) <= p_num_chunks)
+
+	return chunks[:]
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+draw_stream_record_chunk :: proc(p_user_data: rawptr) {
+	chunk := (^DrawStreamChunk)(p_user_data)
+
+	temp_arena := common.Arena{}
+	common.temp_arena_init(&temp_arena)
+	defer common.arena_delete(temp_arena)
+
+	command_buffer_begin_secondary(chunk.cmd_buff_ref, chunk.render_pass_ref)
+	gpu_debug_region_begin(chunk.cmd_buff_ref, chunk.draw_stream.name)
+
+	draw_stream_dispatch := DrawStreamDispatch {
+		draw_stream     = chunk.draw_stream,
+		cmd_buff_ref    = chunk.cmd_buff_ref,
+		dynamic_offsets = chunk.dynamic_offsets,
+		temp_allocator  = temp_arena.allocator,
+	}
+
+	// Restore the state from before the chunk
+	draw_stream_dispatch_replay_op(&draw_stream_dispatch, chunk.pipeline_op_offset)
+	draw_stream_dispatch_replay_op(&draw_stream_dispatch, chunk.index_buffer_op_offset)
+	for op_offset in chunk.vertex_buffer_op_offsets {
+		draw_stream_dispatch_replay_op(&draw_stream_dispatch, op_offset)
+	}
+	for op_offset, i in chunk.bind_group_op_offsets {
+		draw_stream_dispatch.dynamic_offsets_used = chunk.bind_group_dynamic_offsets_used[i]
+		draw_stream_dispatch_replay_op(&draw_stream_dispatch, op_offset)
+	}
+
+	draw_stream_dispatch.dynamic_offsets_used = chunk.dynamic_offsets_used
+	draw_stream_dispatch.current_push_constant = chunk.current_push_constant
+	draw_stream_dispatch.draw_count = chunk.draw_count
+	draw_stream_dispatch.instance_count = chunk.instance_count
+	draw_stream_dispatch.first_instance = chunk.first_instance
+
+	// Record the chunk
+	draw_stream_dispatch.draw_stream_offset = chunk.begin_offset
+	for draw_stream_dispatch.draw_stream_offset < chunk.end_offset {
+		op := chunk.draw_stream.encoded_draw_stream_data[draw_stream_dispatch.draw_stream_offset]
+		draw_stream_dispatch.draw_stream_offset += 1
+		g_draw_stream_ops[op](&draw_stream_dispatch)
+	}
+
+	gpu_debug_region_end(chunk.cmd_buff_ref)
+	command_buffer_end(chunk.cmd_buff_ref)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+draw_stream_dispatch_replay_op :: proc(
+	p_draw_stream_dispatch: ^DrawStreamDispatch,
+	p_op_offset: u32,
+) {
+	if p_op_offset == INVALID_DRAW_STREAM_OFFSET {
+		return
+	}
+	op := p_draw_stream_dispatch.draw_stream.encoded_draw_stream_data[p_op_offset]
+	p_draw_stream_dispatch.draw_stream_offset = p_op_offset + 1
+	g_draw_stream_ops[op](p_draw_stream_dispatch)
+}
+
+//---------------------------------------------------------------------------//
+
 draw_stream_reset :: proc(p_draw_stream: ^DrawStream) {
 	p_draw_stream.current_index_buffer_offset = 0
 	p_draw_stream.current_index_buffer_ref = InvalidBufferRef
@@ -316,6 +602,32 @@ draw_stream_add_push_constants :: proc(p_draw_stream: ^DrawStream, p_push_consta
 
 draw_stream_submit_draw :: proc(p_draw_stream: ^DrawStream) {
 	append(&p_draw_stream.encoded_draw_stream_data, u32(DrawStreamOp.SubmitDraw))
+	p_draw_stream.num_draws += 1
+}
+
+//---------------------------------------------------------------------------//
+
+// Submits up to p_max_draw_count indexed draws, with their arguments and the actual draw count
+// read from GPU buffers, so that the draws can be generated on the GPU, e.g. by GPU culling.
+// Arguments are tightly packed DrawIndexedIndirectCommands.
+draw_stream_submit_indirect_draw :: proc(
+	p_draw_stream: ^DrawStream,
+	p_args_buffer_ref: BufferRef,
+	p_args_offset: u32,
+	p_count_buffer_ref: BufferRef,
+	p_count_offset: u32,
+	p_max_draw_count: u32,
+) {
+	draw_stream_write(
+		p_draw_stream,
+		.SubmitIndirectDraw,
+		p_args_buffer_ref.ref,
+		p_args_offset,
+		p_count_buffer_ref.ref,
+		p_count_offset,
+		p_max_draw_count,
+	)
+	p_draw_stream.num_draws += 1
 }
 
 //---------------------------------------------------------------------------//
@@ -463,6 +775,48 @@ draw_stream_dispatcher_submit_draw :: proc(p_draw_stream_dispatch: ^DrawStreamDi
 
 //---------------------------------------------------------------------------//
 
+@(private = "file")
+draw_stream_dispatcher_submit_indirect_draw :: proc(p_draw_stream_dispatch: ^DrawStreamDispatch) {
+	assert(p_draw_stream_dispatch.pipeline_ref != InvalidGraphicsPipelineRef)
+	assert(p_draw_stream_dispatch.index_buffer_ref != InvalidBufferRef)
+
+	args_buffer_ref := BufferRef {
+		ref = draw_stream_dispatch_read_next(p_draw_stream_dispatch),
+	}
+	args_offset := draw_stream_dispatch_read_next(p_draw_stream_dispatch)
+	count_buffer_ref := BufferRef {
+		ref = draw_stream_dispatch_read_next(p_draw_stream_dispatch),
+	}
+	count_offset := draw_stream_dispatch_read_next(p_draw_stream_dispatch)
+	max_draw_count := draw_stream_dispatch_read_next(p_draw_stream_dispatch)
+
+	// Collect push constants for the current pipeline
+	pipeline := &g_resources.graphics_pipelines[graphics_pipeline_get_idx(p_draw_stream_dispatch.pipeline_ref)]
+
+	push_constants_start := p_draw_stream_dispatch.current_push_constant
+	push_constants_count := u32(len(pipeline.desc.push_constants))
+
+	push_constants := p_draw_stream_dispatch.draw_stream.push_constants[push_constants_start:push_constants_start +
+	push_constants_count]
+
+	p_draw_stream_dispatch.current_push_constant += push_constants_count
+
+	backend_draw_stream_submit_indexed_indirect_draw(
+		p_draw_stream_dispatch.cmd_buff_ref,
+		args_buffer_ref,
+		args_offset,
+		count_buffer_ref,
+		count_offset,
+		max_draw_count,
+		p_draw_stream_dispatch.pipeline_ref,
+		push_constants,
+	)
+
+	p_draw_stream_dispatch.current_draw += 1
+}
+
+//---------------------------------------------------------------------------//
+
 @(private = "file")
 draw_stream_write :: proc {
 	draw_stream_write_value,
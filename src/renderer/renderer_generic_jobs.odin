@@ -172,7 +172,7 @@ generic_pixel_job_destroy :: proc(p_job: GenericPixelJob) {
 //---------------------------------------------------------------------------//
 
 @(private)
-generic_compute_job_create_uniform_data :: proc(p_resolution: Resolution) -> u32 {
+generic_compute_job_create_uniform_data :: proc(p_resolution: Resolution) -> (u32, bool) {
 	resolution := resolve_resolution(p_resolution)
 
 	// Upload uniform data
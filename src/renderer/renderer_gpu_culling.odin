@@ -0,0 +1,788 @@
+#+feature dynamic-literals
+
+package renderer
+
+//---------------------------------------------------------------------------//
+
+// GPU driven culling of the mesh batch table. A compute pre-pass culls each entry of the table
+// against the frustum and the HiZ buffer, writes the compacted MeshInstancedDrawInfos and
+// builds a DrawIndexedIndirectCommand for each visible batch. The draws are then submitted
+// with a single indirect count draw per pipeline and mesh, so the CPU cost doesn't depend
+// on the number of instances.
+//
+// The LOD of each visible instance is selected in the same pass, the same way as on the CPU
+// (see select_mesh_batch_entry_lods), and each LOD of a batch gets its own draw command.
+// As the number of instances of each LOD is only known after culling, the draw infos are
+// written by a separate pass once the draw commands have been built.
+//
+// Two phase occlusion culling is split between two mesh render tasks:
+// - the early phase tests the instances against the last frame HiZ buffer, using the previous
+//   view and model matrices, draws the visible ones and flags the ones that failed the occlusion test
+// - the HiZ buffer is then rebuilt from the early phase depth
+// - the late phase retests only the flagged instances against the new HiZ buffer and draws
+//   the ones that turned out to be visible, e.g. because they were disoccluded this frame
+
+//---------------------------------------------------------------------------//
+
+import "../common"
+
+import "core:log"
+import "core:math/linalg/glsl"
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+GPU_CULLING_MAX_ENTRIES :: 256 * 1024
+
+// The draw infos of all entries have to fit into a single frame region of the instanced
+// draw info buffer, so the culling shader never writes past it
+#assert(
+	GPU_CULLING_MAX_ENTRIES * size_of(MeshInstancedDrawInfo) <=
+	MESH_INSTANCED_DRAW_INFO_BUFFER_SIZE,
+)
+
+@(private = "file")
+GPU_CULLING_MAX_BATCHES :: 64 * 1024
+
+@(private = "file")
+GPU_CULLING_MAX_DRAW_GROUPS :: 16 * 1024
+
+// Keep in sync with gpu_culling.comp.hlsl
+@(private = "file")
+GPU_CULLING_THREAD_GROUP_SIZE :: 64
+
+//---------------------------------------------------------------------------//
+
+GPUCullingMode :: enum u8 {
+	// Frustum culling only
+	Frustum,
+	// Frustum culling and occlusion culling against the last frame HiZ buffer
+	Occlusion,
+	// Phases of the two phase occlusion culling, see the comment at the top of this file
+	TwoPhaseOcclusionEarly,
+	TwoPhaseOcclusionLate,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+G_GPU_CULLING_MODE_MAPPING := map[string]GPUCullingMode {
+	"Frustum"                = .Frustum,
+	"Occlusion"              = .Occlusion,
+	"TwoPhaseOcclusionEarly" = .TwoPhaseOcclusionEarly,
+	"TwoPhaseOcclusionLate"  = .TwoPhaseOcclusionLate,
+}
+
+//---------------------------------------------------------------------------//
+
+// Keep in sync with gpu_culling.comp.hlsl
+@(private = "file")
+GPUCullingFlagBits :: enum u32 {
+	FrustumCulling,
+	OcclusionCulling,
+	// Test against the last frame HiZ buffer using the previous view and model matrices
+	UsePreviousView,
+	// Flag the instances that failed the occlusion test, so the late phase can retest them
+	WriteOccludedEntries,
+	// Test only the instances flagged by the early phase
+	TestOccludedEntriesOnly,
+	// Select the LOD of each visible instance, LOD 0 is used otherwise
+	SelectLODs,
+}
+
+@(private = "file")
+GPUCullingFlags :: distinct bit_set[GPUCullingFlagBits;u32]
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+GPUCullingEntry :: struct #packed {
+	mesh_instance_idx:     u32,
+	material_instance_idx: u32,
+	batch_idx:             u32,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+GPUCullingBatch :: struct #packed {
+	bounding_box_min:   glsl.vec3,
+	num_lods:           u32,
+	bounding_box_max:   glsl.vec3,
+	first_entry:        u32,
+	num_entries:        u32,
+	draw_group_idx:     u32,
+	first_draw_command: u32,
+	// Index ranges of the LODs, relative to the start of the mesh, and their errors in mesh space
+	lod_first_indices:  [MESH_MAX_LODS]u32,
+	lod_index_counts:   [MESH_MAX_LODS]u32,
+	lod_errors:         [MESH_MAX_LODS]f32,
+	_padding:           u32,
+}
+
+//---------------------------------------------------------------------------//
+
+// Consecutive batches that share the material type and the mesh. As they use the same
+// pipeline and vertex buffers, they're submitted with a single indirect count draw.
+// Each batch has a draw command for each of its LODs, so the draw commands of the group are
+// stored at [first_batch, first_batch + num_batches) * MESH_MAX_LODS.
+@(private)
+GPUCullingDrawGroup :: struct {
+	material_type_idx: u32,
+	mesh_idx:          u32,
+	first_batch:       u32,
+	num_batches:       u32,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+GPUCullingParams :: struct #packed {
+	frustum_planes:      [FRUSTUM_PLANES_COUNT]glsl.vec4,
+	hiz_dimensions:      glsl.uvec2,
+	hiz_mip_count:       u32,
+	flags:               GPUCullingFlags,
+	num_entries:         u32,
+	num_batches:         u32,
+	num_draw_groups:     u32,
+	// In number of MeshInstancedDrawInfos
+	draw_infos_offset:   u32,
+	view_position:       glsl.vec3,
+	lod_error_threshold: f32,
+	// Size of a world space unit in pixels at a distance of 1
+	lod_pixels_per_unit: f32,
+	near_plane:          f32,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+GPUCullingJob :: struct {
+	name:                      common.Name,
+	mode:                      GPUCullingMode,
+	reset_job:                 GenericComputeJob,
+	cull_job:                  GenericComputeJob,
+	build_draw_commands_job:   GenericComputeJob,
+	write_draw_infos_job:      GenericComputeJob,
+	bindings:                  []Binding,
+	batch_counters_buffer_ref: BufferRef,
+	draw_counts_buffer_ref:    BufferRef,
+	draw_commands_buffer_ref:  BufferRef,
+	hiz_ref:                   ImageRef,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+INTERNAL: struct {
+	entries_buffer_ref:          BufferRef,
+	batches_buffer_ref:          BufferRef,
+	// Entries that failed the occlusion test in the early phase
+	occluded_entries_buffer_ref: BufferRef,
+	// LOD and index within the batch and LOD of each visible entry, written by the cull pass
+	entry_draw_slots_buffer_ref: BufferRef,
+	draw_groups:                 [dynamic]GPUCullingDrawGroup,
+	num_entries:                 u32,
+	num_batches:                 u32,
+	// Version of the mesh batch table that was uploaded to the GPU
+	uploaded_version:            u32,
+	// Set when the mesh batch table doesn't fit into the GPU culling buffers
+	is_table_too_large:          bool,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+gpu_culling_init :: proc() -> bool {
+
+	INTERNAL.entries_buffer_ref = gpu_culling_buffer_create(
+		"GPUCullingEntries",
+		size_of(GPUCullingEntry) * GPU_CULLING_MAX_ENTRIES,
+		{.StorageBuffer},
+		true,
+	) or_return
+
+	INTERNAL.batches_buffer_ref = gpu_culling_buffer_create(
+		"GPUCullingBatches",
+		size_of(GPUCullingBatch) * GPU_CULLING_MAX_BATCHES,
+		{.StorageBuffer},
+		true,
+	) or_return
+
+	INTERNAL.occluded_entries_buffer_ref = gpu_culling_buffer_create(
+		"GPUCullingOccludedEntries",
+		size_of(u32) * GPU_CULLING_MAX_ENTRIES,
+		{.StorageBuffer},
+		false,
+	) or_return
+
+	INTERNAL.entry_draw_slots_buffer_ref = gpu_culling_buffer_create(
+		"GPUCullingEntryDrawSlots",
+		size_of(u32) * GPU_CULLING_MAX_ENTRIES,
+		{.StorageBuffer},
+		false,
+	) or_return
+
+	INTERNAL.draw_groups = make(
+		[dynamic]GPUCullingDrawGroup,
+		0,
+		GPU_CULLING_MAX_DRAW_GROUPS,
+		G_RENDERER_ALLOCATORS.main_allocator,
+	)
+
+	INTERNAL.uploaded_version = g_mesh_batches.version
+
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+// Uploads the mesh batch table to the GPU when it changed since the last upload
+@(private)
+gpu_culling_update :: proc() {
+	common.profiler_scope("GpuCullingUpdate")
+
+	if INTERNAL.uploaded_version == g_mesh_batches.version {
+		return
+	}
+
+	num_entries := u32(len(g_mesh_batches.entries))
+	num_batches := u32(len(g_mesh_batches.batches))
+
+	INTERNAL.is_table_too_large =
+		num_entries > GPU_CULLING_MAX_ENTRIES || num_batches > GPU_CULLING_MAX_BATCHES
+
+	if INTERNAL.is_table_too_large {
+		log.warnf(
+			"Mesh batch table is too large for GPU culling (%d entries, %d batches), falling back to the CPU\n",
+			num_entries,
+			num_batches,
+		)
+		INTERNAL.uploaded_version = g_mesh_batches.version
+		return
+	}
+
+	temp_arena := common.Arena{}
+	common.temp_arena_init(&temp_arena, common.MEGABYTE * 16)
+	defer common.arena_delete(temp_arena)
+
+	entries := make([]GPUCullingEntry, num_entries, temp_arena.allocator)
+	batches := make([]GPUCullingBatch, num_batches, temp_arena.allocator)
+
+	clear(&INTERNAL.draw_groups)
+
+	for mesh_batch, batch_idx in g_mesh_batches.batches {
+
+		material_type_idx := mesh_batch_key_get_material_type_idx(mesh_batch.key)
+		mesh_idx := mesh_batch_key_get_mesh_idx(mesh_batch.key)
+		submesh_idx := mesh_batch_key_get_submesh_idx(mesh_batch.key)
+
+		// Batches are sorted by material type and mesh, so the ones from the same group are next to each other
+		num_draw_groups := len(INTERNAL.draw_groups)
+		if num_draw_groups == 0 ||
+		   INTERNAL.draw_groups[num_draw_groups - 1].material_type_idx != material_type_idx ||
+		   INTERNAL.draw_groups[num_draw_groups - 1].mesh_idx != mesh_idx {
+
+			if num_draw_groups == GPU_CULLING_MAX_DRAW_GROUPS {
+				INTERNAL.is_table_too_large = true
+				break
+			}
+
+			append(
+				&INTERNAL.draw_groups,
+				GPUCullingDrawGroup {
+					material_type_idx = material_type_idx,
+					mesh_idx = mesh_idx,
+					first_batch = u32(batch_idx),
+				},
+			)
+			num_draw_groups += 1
+		}
+
+		draw_group := &INTERNAL.draw_groups[num_draw_groups - 1]
+		draw_group.num_batches += 1
+
+		submesh := &g_resources.meshes[mesh_idx].desc.sub_meshes[submesh_idx]
+
+		batch := &batches[batch_idx]
+		batch^ = GPUCullingBatch {
+			bounding_box_min   = submesh.bounding_box.min,
+			num_lods           = submesh.num_lods,
+			bounding_box_max   = submesh.bounding_box.max,
+			first_entry        = mesh_batch.first_entry,
+			num_entries        = mesh_batch.num_entries,
+			draw_group_idx     = u32(num_draw_groups - 1),
+			first_draw_command = draw_group.first_batch * MESH_MAX_LODS,
+		}
+
+		for lod in 0 ..< submesh.num_lods {
+			batch.lod_first_indices[lod] = submesh.lods[lod].index_offset
+			batch.lod_index_counts[lod] = submesh.lods[lod].index_count
+			batch.lod_errors[lod] = submesh.lods[lod].error
+		}
+
+		for entry_idx in mesh_batch.first_entry ..< mesh_batch.first_entry + mesh_batch.num_entries {
+			entry := &g_mesh_batches.entries[entry_idx]
+			entries[entry_idx] = GPUCullingEntry {
+				mesh_instance_idx     = entry.mesh_instance_idx,
+				material_instance_idx = entry.material_instance_idx,
+				batch_idx             = u32(batch_idx),
+			}
+		}
+	}
+
+	if INTERNAL.is_table_too_large {
+		log.warn("Mesh batch table has too many draw groups for GPU culling, falling back to the CPU\n")
+		INTERNAL.uploaded_version = g_mesh_batches.version
+		return
+	}
+
+	if num_entries > 0 {
+		entries_upload_response := buffer_upload_request_upload(
+			BufferUploadRequest {
+				dst_buff = INTERNAL.entries_buffer_ref,
+				dst_queue_usage = .Graphics,
+				first_usage_stage = .ComputeShader,
+				size = size_of(GPUCullingEntry) * num_entries,
+				data_ptr = raw_data(entries),
+			},
+		)
+
+		batches_upload_response := buffer_upload_request_upload(
+			BufferUploadRequest {
+				dst_buff = INTERNAL.batches_buffer_ref,
+				dst_queue_usage = .Graphics,
+				first_usage_stage = .ComputeShader,
+				size = size_of(GPUCullingBatch) * num_batches,
+				data_ptr = raw_data(batches),
+			},
+		)
+
+		// Try again next frame, the CPU path is used until then
+		if entries_upload_response.status == .Failed || batches_upload_response.status == .Failed {
+			return
+		}
+	}
+
+	INTERNAL.num_entries = num_entries
+	INTERNAL.num_batches = num_batches
+	INTERNAL.uploaded_version = g_mesh_batches.version
+}
+
+//---------------------------------------------------------------------------//
+
+// Returns true if the current mesh batch table is on the GPU and can be culled there
+@(private)
+gpu_culling_is_ready :: proc() -> bool {
+	return(
+		INTERNAL.uploaded_version == g_mesh_batches.version &&
+		INTERNAL.is_table_too_large == false \
+	)
+}
+
+//---------------------------------------------------------------------------//
+
+gpu_culling_parse_mode :: proc(p_name: string) -> (GPUCullingMode, bool) {
+
+	if p_name in G_GPU_CULLING_MODE_MAPPING {
+		return G_GPU_CULLING_MODE_MAPPING[p_name], true
+	}
+
+	return {}, false
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+gpu_culling_get_draw_groups :: proc() -> []GPUCullingDrawGroup {
+	return INTERNAL.draw_groups[:]
+}
+
+//---------------------------------------------------------------------------//
+
+// Creates the compute jobs and the output buffers used to cull the mesh batches for a single render task.
+// Draw infos of the visible instances are written into p_draw_infos_buffer_ref.
+@(private)
+gpu_culling_job_create :: proc(
+	p_name: common.Name,
+	p_mode: GPUCullingMode,
+	p_draw_infos_buffer_ref: BufferRef,
+	p_hiz_ref: ImageRef,
+) -> (
+	job: GPUCullingJob,
+	res: bool,
+) {
+	job.name = p_name
+	job.mode = p_mode
+	job.hiz_ref = p_hiz_ref
+
+	uses_occlusion_culling := p_mode != .Frustum
+	if uses_occlusion_culling && p_hiz_ref == InvalidImageRef {
+		log.errorf(
+			"Failed to create GPU culling job '%s' - occlusion culling requires a HiZ buffer\n",
+			common.get_string(p_name),
+		)
+		return {}, false
+	}
+
+	// Counters and draw commands are stored for each batch and LOD
+	job.batch_counters_buffer_ref = gpu_culling_buffer_create(
+		"GPUCullingBatchCounters",
+		size_of(u32) * GPU_CULLING_MAX_BATCHES * MESH_MAX_LODS,
+		{.StorageBuffer},
+		false,
+	) or_return
+	defer if res == false {
+		buffer_destroy(job.batch_counters_buffer_ref)
+	}
+
+	job.draw_counts_buffer_ref = gpu_culling_buffer_create(
+		"GPUCullingDrawCounts",
+		size_of(u32) * GPU_CULLING_MAX_DRAW_GROUPS,
+		{.StorageBuffer, .IndirectBuffer},
+		false,
+	) or_return
+	defer if res == false {
+		buffer_destroy(job.draw_counts_buffer_ref)
+	}
+
+	job.draw_commands_buffer_ref = gpu_culling_buffer_create(
+		"GPUCullingDrawCommands",
+		size_of(DrawIndexedIndirectCommand) * GPU_CULLING_MAX_BATCHES * MESH_MAX_LODS,
+		{.StorageBuffer, .IndirectBuffer},
+		false,
+	) or_return
+	defer if res == false {
+		buffer_destroy(job.draw_commands_buffer_ref)
+	}
+
+	draw_infos_buffer := &g_resources.buffers[buffer_get_idx(p_draw_infos_buffer_ref)]
+
+	// All of the compute jobs share the same bindings, see gpu_culling.comp.hlsl
+	bindings := make([dynamic]Binding, 0, 10, G_RENDERER_ALLOCATORS.resource_allocator)
+	append(
+		&bindings,
+		InputBufferBinding {
+			buffer_ref = g_uniform_buffers.transient_buffer_ref,
+			usage = .Uniform,
+			size = size_of(GPUCullingParams),
+		},
+		InputBufferBinding {
+			buffer_ref = INTERNAL.entries_buffer_ref,
+			usage = .Storage,
+			size = size_of(GPUCullingEntry) * GPU_CULLING_MAX_ENTRIES,
+		},
+		InputBufferBinding {
+			buffer_ref = INTERNAL.batches_buffer_ref,
+			usage = .Storage,
+			size = size_of(GPUCullingBatch) * GPU_CULLING_MAX_BATCHES,
+		},
+		OutputBufferBinding {
+			buffer_ref = job.batch_counters_buffer_ref,
+			size = size_of(u32) * GPU_CULLING_MAX_BATCHES * MESH_MAX_LODS,
+		},
+		OutputBufferBinding {
+			buffer_ref = job.draw_counts_buffer_ref,
+			size = size_of(u32) * GPU_CULLING_MAX_DRAW_GROUPS,
+		},
+		OutputBufferBinding {
+			buffer_ref = p_draw_infos_buffer_ref,
+			size = draw_infos_buffer.desc.size,
+		},
+		OutputBufferBinding {
+			buffer_ref = job.draw_commands_buffer_ref,
+			size = size_of(DrawIndexedIndirectCommand) * GPU_CULLING_MAX_BATCHES * MESH_MAX_LODS,
+		},
+		OutputBufferBinding {
+			buffer_ref = INTERNAL.occluded_entries_buffer_ref,
+			size = size_of(u32) * GPU_CULLING_MAX_ENTRIES,
+		},
+		OutputBufferBinding {
+			buffer_ref = INTERNAL.entry_draw_slots_buffer_ref,
+			size = size_of(u32) * GPU_CULLING_MAX_ENTRIES,
+		},
+	)
+
+	if uses_occlusion_culling {
+		hiz := &g_resources.images[image_get_idx(p_hiz_ref)]
+		append(
+			&bindings,
+			InputImageBinding {
+				image_ref = p_hiz_ref,
+				mip_count = hiz.desc.mip_count,
+				array_layer_count = 1,
+			},
+		)
+	}
+
+	job.bindings = bindings[:]
+	defer if res == false {
+		delete(job.bindings, G_RENDERER_ALLOCATORS.resource_allocator)
+	}
+
+	cull_shader_name := "gpu_culling_cull_occlusion.comp" if uses_occlusion_culling else "gpu_culling_cull.comp"
+
+	job.reset_job = gpu_culling_compute_job_create(
+		p_name,
+		"gpu_culling_reset.comp",
+		job.bindings,
+	) or_return
+	defer if res == false {
+		generic_compute_job_destroy(job.reset_job)
+	}
+
+	job.cull_job = gpu_culling_compute_job_create(p_name, cull_shader_name, job.bindings) or_return
+	defer if res == false {
+		generic_compute_job_destroy(job.cull_job)
+	}
+
+	job.build_draw_commands_job = gpu_culling_compute_job_create(
+		p_name,
+		"gpu_culling_build_draw_commands.comp",
+		job.bindings,
+	) or_return
+	defer if res == false {
+		generic_compute_job_destroy(job.build_draw_commands_job)
+	}
+
+	job.write_draw_infos_job = gpu_culling_compute_job_create(
+		p_name,
+		"gpu_culling_write_draw_infos.comp",
+		job.bindings,
+	) or_return
+
+	return job, true
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+gpu_culling_job_destroy :: proc(p_job: GPUCullingJob) {
+	generic_compute_job_destroy(p_job.reset_job)
+	generic_compute_job_destroy(p_job.cull_job)
+	generic_compute_job_destroy(p_job.build_draw_commands_job)
+	generic_compute_job_destroy(p_job.write_draw_infos_job)
+	buffer_destroy(p_job.batch_counters_buffer_ref)
+	buffer_destroy(p_job.draw_counts_buffer_ref)
+	buffer_destroy(p_job.draw_commands_buffer_ref)
+	delete(p_job.bindings, G_RENDERER_ALLOCATORS.resource_allocator)
+}
+
+//---------------------------------------------------------------------------//
+
+// Records the culling pre-pass into the frame command buffer. Has to be called outside of
+// a render pass. Draw infos are written at p_draw_infos_offset (in bytes) of the draw info buffer.
+// Returns false when there is nothing to draw or the uniform data couldn't be allocated.
+@(private)
+gpu_culling_job_run :: proc(
+	p_job: ^GPUCullingJob,
+	p_render_views: RenderViews,
+	p_draw_infos_offset: u32,
+) -> bool {
+
+	if INTERNAL.num_entries == 0 {
+		return false
+	}
+
+	cmd_buff_ref := get_frame_cmd_buffer_ref()
+
+	// Contents of the HiZ buffer are undefined on the first frame
+	occlusion_culling_enabled :=
+		G_RENDERER_SETTINGS.gpu_occlusion_culling_enabled && get_frame_id() > 0
+
+	flags := GPUCullingFlags{}
+	if G_RENDERER_SETTINGS.frustum_culling_enabled &&
+	   p_render_views.current_view.has_frustum_planes {
+		flags += {.FrustumCulling}
+	}
+
+	switch p_job.mode {
+	case .Frustum:
+	case .Occlusion:
+		if occlusion_culling_enabled {
+			flags += {.OcclusionCulling, .UsePreviousView}
+		}
+	case .TwoPhaseOcclusionEarly:
+		// The flags are always written, so the late phase never sees stale ones
+		flags += {.WriteOccludedEntries}
+		if occlusion_culling_enabled {
+			flags += {.OcclusionCulling, .UsePreviousView}
+		}
+	case .TwoPhaseOcclusionLate:
+		flags += {.OcclusionCulling, .TestOccludedEntriesOnly}
+	}
+
+	if G_RENDERER_SETTINGS.lod_selection_enabled {
+		flags += {.SelectLODs}
+	}
+
+	view := p_render_views.current_view
+	resolution_y := f32(G_RENDERER.config.render_resolution.y)
+
+	params := GPUCullingParams {
+		frustum_planes      = view.frustum_planes,
+		flags               = flags,
+		num_entries         = INTERNAL.num_entries,
+		num_batches         = INTERNAL.num_batches,
+		num_draw_groups     = u32(len(INTERNAL.draw_groups)),
+		draw_infos_offset   = p_draw_infos_offset / size_of(MeshInstancedDrawInfo),
+		view_position       = view.position,
+		lod_error_threshold = G_RENDERER_SETTINGS.lod_error_threshold,
+		lod_pixels_per_unit = view.projection[1, 1] * 0.5 * resolution_y,
+		near_plane          = view.near_plane,
+	}
+
+	if p_job.hiz_ref != InvalidImageRef {
+		hiz := &g_resources.images[image_get_idx(p_job.hiz_ref)]
+		params.hiz_dimensions = hiz.desc.dimensions.xy
+		params.hiz_mip_count = hiz.desc.mip_count
+
+		// HiZ is the last binding
+		transition_binding_resources(p_job.bindings[len(p_job.bindings) - 1:], .Compute)
+	}
+
+	params_offset := uniform_buffer_create_transient_buffer(&params) or_return
+	view_data_offset := uniform_buffer_create_view_data(p_render_views) or_return
+
+	global_uniform_offsets := []u32 {
+		g_uniform_buffers.frame_data_offset,
+		view_data_offset,
+		g_uniform_buffers.render_settings_data_offset,
+	}
+
+	dynamic_offsets := [][]u32{{params_offset}, global_uniform_offsets, nil, nil}
+
+	gpu_debug_region_begin(cmd_buff_ref, p_job.name)
+	defer gpu_debug_region_end(cmd_buff_ref)
+
+	// Draws from the previous frame or render task might still be reading the buffers
+	transition_memory(
+		cmd_buff_ref,
+		{.Transfer, .DrawIndirect, .VertexShader, .ComputeShader},
+		{.ComputeShader},
+	)
+
+	compute_command_dispatch(
+		p_job.reset_job.compute_command_ref,
+		cmd_buff_ref,
+		glsl.uvec3 {
+			gpu_culling_num_thread_groups(
+				max(params.num_batches * MESH_MAX_LODS, params.num_draw_groups),
+			),
+			1,
+			1,
+		},
+		dynamic_offsets,
+	)
+
+	transition_memory(cmd_buff_ref, {.ComputeShader}, {.ComputeShader})
+
+	compute_command_dispatch(
+		p_job.cull_job.compute_command_ref,
+		cmd_buff_ref,
+		glsl.uvec3{gpu_culling_num_thread_groups(params.num_entries), 1, 1},
+		dynamic_offsets,
+	)
+
+	transition_memory(cmd_buff_ref, {.ComputeShader}, {.ComputeShader})
+
+	compute_command_dispatch(
+		p_job.build_draw_commands_job.compute_command_ref,
+		cmd_buff_ref,
+		glsl.uvec3{gpu_culling_num_thread_groups(params.num_batches), 1, 1},
+		dynamic_offsets,
+	)
+
+	transition_memory(cmd_buff_ref, {.ComputeShader}, {.ComputeShader})
+
+	compute_command_dispatch(
+		p_job.write_draw_infos_job.compute_command_ref,
+		cmd_buff_ref,
+		glsl.uvec3{gpu_culling_num_thread_groups(params.num_entries), 1, 1},
+		dynamic_offsets,
+	)
+
+	transition_memory(cmd_buff_ref, {.ComputeShader}, {.DrawIndirect, .VertexShader})
+
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+gpu_culling_buffer_create :: proc(
+	p_name: string,
+	p_size: u32,
+	p_usage: BufferUsageFlags,
+	p_is_uploaded_from_cpu: bool,
+) -> (
+	BufferRef,
+	bool,
+) {
+	buffer_ref := buffer_allocate(common.create_name(p_name))
+	buffer := &g_resources.buffers[buffer_get_idx(buffer_ref)]
+
+	buffer.desc = {
+		flags = {.Dedicated},
+		size  = p_size,
+		usage = p_usage,
+	}
+
+	if p_is_uploaded_from_cpu {
+		if .IntegratedGPU in G_RENDERER.gpu_device_flags {
+			buffer.desc.flags += {.Mapped}
+		} else {
+			buffer.desc.usage += {.TransferDst}
+		}
+	}
+
+	if buffer_create(buffer_ref) == false {
+		log.errorf("Failed to create GPU culling buffer '%s'\n", p_name)
+		return InvalidBufferRef, false
+	}
+
+	return buffer_ref, true
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+gpu_culling_compute_job_create :: proc(
+	p_name: common.Name,
+	p_shader_name: string,
+	p_bindings: []Binding,
+) -> (
+	GenericComputeJob,
+	bool,
+) {
+	shader_ref := shader_find_by_name(p_shader_name)
+	if shader_ref == InvalidShaderRef {
+		log.errorf(
+			"Failed to create GPU culling job '%s' - invalid shader %s\n",
+			common.get_string(p_name),
+			p_shader_name,
+		)
+		return {}, false
+	}
+
+	job, job_created := generic_compute_job_create(p_name, shader_ref, p_bindings)
+	if job_created == false {
+		log.errorf(
+			"Failed to create GPU culling job '%s' - couldn't create compute job for %s\n",
+			common.get_string(p_name),
+			p_shader_name,
+		)
+		return {}, false
+	}
+
+	return job, true
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+gpu_culling_num_thread_groups :: #force_inline proc(p_num_threads: u32) -> u32 {
+	return max((p_num_threads + GPU_CULLING_THREAD_GROUP_SIZE - 1) / GPU_CULLING_THREAD_GROUP_SIZE, 1)
+}
+
+//---------------------------------------------------------------------------//
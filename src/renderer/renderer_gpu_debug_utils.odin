@@ -24,6 +24,9 @@ gpu_debug_marker_add :: proc {
 
 @(private)
 gpu_debug_region_end :: proc(p_cmd_buff_ref: CommandBufferRef) {
+	gpu_profiler_region_end(p_cmd_buff_ref)
+	common.profiler_scope_end()
+
 	if !G_RENDERER.debug_mode {
 		return
 	}
@@ -39,8 +42,12 @@ gpu_debug_region_begin_name :: proc(p_cmd_buff_ref: CommandBufferRef, p_region:
 
 //---------------------------------------------------------------------------//
 
+// The regions are also profiled, both the time it takes to record them and their GPU time
 @(private = "file")
 gpu_debug_region_begin_str :: proc(p_cmd_buff_ref: CommandBufferRef, p_region: string) {
+	common.profiler_scope_begin(p_region)
+	gpu_profiler_region_begin(p_cmd_buff_ref, p_region)
+
 	if !G_RENDERER.debug_mode {
 		return
 	}
@@ -0,0 +1,249 @@
+package renderer
+
+//---------------------------------------------------------------------------//
+
+import "../common"
+import "core:sync"
+
+//---------------------------------------------------------------------------//
+
+// Two timestamps per region
+@(private)
+GPU_PROFILER_MAX_QUERIES_PER_FRAME :: 2048
+
+// Marks a region that didn't get a query, because the frame ran out of them
+@(private = "file")
+GPU_PROFILER_NO_QUERY :: max(u32)
+
+// GPU regions can't nest deeper than this on a single thread
+@(private = "file")
+GPU_PROFILER_MAX_REGION_DEPTH :: 32
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+GpuProfilerRegion :: struct {
+	name:        string,
+	begin_query: u32,
+	gpu_queue:   common.ProfilerGpuQueue,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+GpuProfilerFrame :: struct {
+	// Regions recorded in this frame, the end query of each one follows its begin query
+	regions:        [dynamic]GpuProfilerRegion,
+	num_queries:    u32,
+	// Profiler frame the regions were recorded in, and when it was submitted
+	profiler_frame: u64,
+	submit_time_ns: i64,
+	is_submitted:   bool,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+INTERNAL: struct {
+	frames:       []GpuProfilerFrame,
+	// Regions are begun from the job system threads when the draw streams are recorded in parallel
+	regions_lock: sync.Mutex,
+	is_enabled:   bool,
+}
+
+//---------------------------------------------------------------------------//
+
+// Regions open on the calling thread, each one holds the query of its end timestamp
+@(private = "file", thread_local)
+tls_open_region_end_queries: [GPU_PROFILER_MAX_REGION_DEPTH]u32
+
+@(private = "file", thread_local)
+tls_num_open_regions: u32
+
+//---------------------------------------------------------------------------//
+
+@(private)
+gpu_profiler_init :: proc() -> bool {
+	when common.PROFILER_ENABLED {
+		// Timestamps aren't supported on the graphics queue, only the CPU scopes will be measured
+		if backend_gpu_profiler_init() == false {
+			return true
+		}
+
+		INTERNAL.frames = make(
+			[]GpuProfilerFrame,
+			G_RENDERER.num_frames_in_flight,
+			G_RENDERER_ALLOCATORS.main_allocator,
+		)
+		for &frame in INTERNAL.frames {
+			frame.regions = make([dynamic]GpuProfilerRegion, G_RENDERER_ALLOCATORS.main_allocator)
+		}
+
+		INTERNAL.is_enabled = true
+	}
+
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+gpu_profiler_deinit :: proc() {
+	if INTERNAL.is_enabled == false {
+		return
+	}
+
+	backend_gpu_profiler_deinit()
+
+	for frame in INTERNAL.frames {
+		delete(frame.regions)
+	}
+	delete(INTERNAL.frames, G_RENDERER_ALLOCATORS.main_allocator)
+}
+
+//---------------------------------------------------------------------------//
+
+// Resolves the timestamps that the GPU wrote the last time this frame in flight was used
+// and hands them to the profiler. Has to be called after waiting for the frame's fence.
+@(private)
+gpu_profiler_begin_frame :: proc() {
+	when common.PROFILER_ENABLED {
+		if INTERNAL.is_enabled == false {
+			return
+		}
+
+		frame := &INTERNAL.frames[get_frame_idx()]
+
+		if frame.is_submitted && frame.num_queries > 0 {
+			temp_arena: common.Arena
+			common.temp_arena_init(&temp_arena, common.MEGABYTE)
+			defer common.arena_delete(temp_arena)
+
+			timestamps := make([]u64, frame.num_queries, temp_arena.allocator)
+			if backend_gpu_profiler_read_timestamps(get_frame_idx(), timestamps) {
+				events := make([]common.ProfilerEvent, len(frame.regions), temp_arena.allocator)
+				num_events := 0
+
+				// The GPU timestamps don't share a timebase with the CPU,
+				// so the frame is placed at the time it was submitted
+				frame_start_timestamp := max(u64)
+				for region in frame.regions {
+					if region.begin_query != GPU_PROFILER_NO_QUERY {
+						begin_timestamp := timestamps[region.begin_query]
+						frame_start_timestamp = min(frame_start_timestamp, begin_timestamp)
+					}
+				}
+
+				for region in frame.regions {
+					if region.begin_query == GPU_PROFILER_NO_QUERY {
+						continue
+					}
+					begin_timestamp := timestamps[region.begin_query]
+					end_timestamp := max(timestamps[region.begin_query + 1], begin_timestamp)
+					start_offset := begin_timestamp - frame_start_timestamp
+					start_offset_ns := backend_gpu_profiler_timestamp_to_ns(start_offset)
+
+					events[num_events] = common.ProfilerEvent {
+						name        = region.name,
+						start_ns    = frame.submit_time_ns + start_offset_ns,
+						duration_ns = backend_gpu_profiler_timestamp_to_ns(end_timestamp - begin_timestamp),
+						gpu_queue   = region.gpu_queue,
+					}
+					num_events += 1
+				}
+
+				common.profiler_add_gpu_events(frame.profiler_frame, events[:num_events])
+			}
+		}
+
+		backend_gpu_profiler_reset_queries(get_frame_idx())
+
+		clear(&frame.regions)
+		frame.num_queries = 0
+		frame.profiler_frame = common.profiler_get_frame()
+		frame.is_submitted = false
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+gpu_profiler_submit_frame :: proc() {
+	when common.PROFILER_ENABLED {
+		if INTERNAL.is_enabled == false {
+			return
+		}
+
+		frame := &INTERNAL.frames[get_frame_idx()]
+		frame.submit_time_ns = common.profiler_get_time_ns()
+		frame.is_submitted = true
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+// Writes a timestamp at the beginning of the region, regions recorded into secondary command
+// buffers are measured as well, the time of the ones with the same name is summed up.
+// The regions recorded for the async compute queue show up on their own track.
+@(private)
+gpu_profiler_region_begin :: proc(p_cmd_buff_ref: CommandBufferRef, p_name: string) {
+	when common.PROFILER_ENABLED {
+		if INTERNAL.is_enabled == false {
+			return
+		}
+		assert(tls_num_open_regions < GPU_PROFILER_MAX_REGION_DEPTH)
+
+		frame := &INTERNAL.frames[get_frame_idx()]
+
+		gpu_queue := common.ProfilerGpuQueue.Graphics
+		if command_buffer_is_async_compute(p_cmd_buff_ref) {
+			gpu_queue = .AsyncCompute
+		}
+
+		begin_query := GPU_PROFILER_NO_QUERY
+		if backend_gpu_profiler_supports_cmd_buffer(p_cmd_buff_ref) {
+			sync.mutex_lock(&INTERNAL.regions_lock)
+			defer sync.mutex_unlock(&INTERNAL.regions_lock)
+
+			if frame.num_queries + 2 <= GPU_PROFILER_MAX_QUERIES_PER_FRAME {
+				begin_query = frame.num_queries
+				frame.num_queries += 2
+				append(
+					&frame.regions,
+					GpuProfilerRegion {
+						name = p_name,
+						begin_query = begin_query,
+						gpu_queue = gpu_queue,
+					},
+				)
+			}
+		}
+
+		if begin_query != GPU_PROFILER_NO_QUERY {
+			backend_gpu_profiler_write_timestamp(p_cmd_buff_ref, get_frame_idx(), begin_query, false)
+			tls_open_region_end_queries[tls_num_open_regions] = begin_query + 1
+		} else {
+			tls_open_region_end_queries[tls_num_open_regions] = GPU_PROFILER_NO_QUERY
+		}
+		tls_num_open_regions += 1
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+gpu_profiler_region_end :: proc(p_cmd_buff_ref: CommandBufferRef) {
+	when common.PROFILER_ENABLED {
+		if INTERNAL.is_enabled == false || tls_num_open_regions == 0 {
+			return
+		}
+
+		tls_num_open_regions -= 1
+		end_query := tls_open_region_end_queries[tls_num_open_regions]
+		if end_query != GPU_PROFILER_NO_QUERY {
+			backend_gpu_profiler_write_timestamp(p_cmd_buff_ref, get_frame_idx(), end_query, true)
+		}
+	}
+}
+
+//---------------------------------------------------------------------------//
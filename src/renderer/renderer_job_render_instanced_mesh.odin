@@ -3,53 +3,20 @@ package renderer
 //---------------------------------------------------------------------------//
 
 import "../common"
-import "core:hash"
 import "core:log"
+import "core:math/linalg/glsl"
+import "core:mem"
 import "core:slice"
 
 //---------------------------------------------------------------------------//
 
-@(private = "file")
+// Size of a single frame region of the instanced draw info buffer
+@(private)
 MESH_INSTANCED_DRAW_INFO_BUFFER_SIZE :: 2 * common.MEGABYTE
 
-//---------------------------------------------------------------------------//
-
 @(private = "file")
-MeshBatch :: struct {
-	vertex_buffer_offset: u32,
-	index_buffer_offset:  u32,
-	index_buffer_size:    u32,
-	index_count:          u32,
-	mesh_vertex_count:    u32,
-	material_type_ref:    MaterialTypeRef,
-	instanced_draw_infos: [dynamic]MeshInstancedDrawInfo,
-}
-
-//---------------------------------------------------------------------------//
-
-@(private = "file")
-MeshBatchKey :: distinct u32
-
-//---------------------------------------------------------------------------//
-
-@(private = "file")
-MeshInstancedDrawInfo :: struct #packed {
-	mesh_instance_idx:     u32,
-	material_instance_idx: u32,
-}
-
-//---------------------------------------------------------------------------//
-
-@(private = "file")
-calculate_mesh_batch_key :: proc(
-	p_material_type_idx: u32,
-	p_mesh_idx: u32,
-	p_submesh_index: u32,
-) -> MeshBatchKey {
-	hash_input := []u32{p_material_type_idx, p_mesh_idx, p_submesh_index}
-	mesh_batch_key := hash.crc32(slice.to_bytes(hash_input))
-	return MeshBatchKey(mesh_batch_key)
-}
+MESH_INSTANCED_DRAW_INFO_MAX_COUNT ::
+	MESH_INSTANCED_DRAW_INFO_BUFFER_SIZE / size_of(MeshInstancedDrawInfo)
 
 //---------------------------------------------------------------------------//
 
@@ -151,17 +118,27 @@ render_instanced_mesh_job_run :: proc(
 	p_material_pass_refs: []MaterialPassRef,
 	p_material_pass_type: MaterialPassType,
 	p_dynamic_offsets: []u32 = {},
+	p_gpu_culling_job: ^GPUCullingJob = nil,
 ) {
 
 	assert(len(p_outputs_per_view) == len(p_render_views))
 
+	use_gpu_culling :=
+		p_gpu_culling_job != nil &&
+		G_RENDERER_SETTINGS.gpu_culling_enabled &&
+		gpu_culling_is_ready()
+
+	// Without GPU occlusion culling the early phase has already drawn everything that's visible
+	if p_gpu_culling_job != nil && p_gpu_culling_job.mode == .TwoPhaseOcclusionLate {
+		if use_gpu_culling == false || G_RENDERER_SETTINGS.gpu_occlusion_culling_enabled == false {
+			return
+		}
+	}
+
 	temp_arena := common.Arena{}
 	common.temp_arena_init(&temp_arena, common.MEGABYTE * 16)
 	defer common.arena_delete(temp_arena)
 
-	// Batch meshes that share the same material
-	mesh_batches := make(map[MeshBatchKey]MeshBatch, 16, temp_arena.allocator)
-
 	job_dynamic_offsets := make([]u32, p_job_data.num_dynamic_offset_buffers, temp_arena.allocator)
 	for i in 0 ..< p_job_data.num_dynamic_offset_buffers {
 		job_dynamic_offsets[i] = common.DYNAMIC_OFFSET
@@ -171,93 +148,202 @@ render_instanced_mesh_job_run :: proc(
 		transition_binding_resources(p_job_data.bindings, .Graphics, false)
 	}
 
-	for i in 0 ..< g_resource_refs.mesh_instances.alive_count {
+	draw_stream := draw_stream_create(temp_arena.allocator, p_debug_name)
 
-		mesh_instance_ref := g_resource_refs.mesh_instances.alive_refs[i]
+	mesh_instance_data_offset := MESH_INSTANCED_DRAW_INFO_BUFFER_SIZE * get_frame_idx()
 
-		mesh_instance_idx := mesh_instance_get_idx(mesh_instance_ref)
-		mesh_instance := &g_resources.mesh_instances[mesh_instance_idx]
-		mesh_idx := mesh_get_idx(mesh_instance.desc.mesh_ref)
-		mesh := &g_resources.meshes[mesh_idx]
+	if use_gpu_culling {
+		// The culling results are written for a single view only
+		assert(len(p_render_views) == 1)
 
-		// Skip mesh if it's data is still being uploaded
-		if (mesh.data_upload_context.finished_uploads_count !=
-			   mesh.data_upload_context.needed_uploads_count) {
-			continue
+		has_draws := gpu_culling_job_run(
+			p_gpu_culling_job,
+			p_render_views[0],
+			mesh_instance_data_offset,
+		)
+
+		if has_draws == false {
+			return
 		}
 
-		// Add an instanced draw call for each submesh
-		for submesh, submesh_idx in mesh.desc.sub_meshes {
+		record_gpu_culled_draws(
+			&draw_stream,
+			p_gpu_culling_job,
+			p_job_data,
+			job_dynamic_offsets,
+			p_material_pass_refs,
+			p_material_pass_type,
+		)
+	} else {
+		has_draws := record_cpu_culled_draws(
+			&draw_stream,
+			p_job_data,
+			p_render_views,
+			job_dynamic_offsets,
+			p_material_pass_refs,
+			p_material_pass_type,
+			mesh_instance_data_offset,
+			temp_arena.allocator,
+		)
 
-			material_instance_idx := material_instance_get_idx(submesh.material_instance_ref)
-			material_instance := &g_resources.material_instances[material_instance_idx]
-			material_type_idx := material_type_get_idx(material_instance.desc.material_type_ref)
+		if has_draws == false {
+			return
+		}
+	}
 
-			mesh_batch_key := calculate_mesh_batch_key(
-				material_type_idx,
-				mesh_idx,
-				u32(submesh_idx),
-			)
+	cmd_buff_ref := get_frame_cmd_buffer_ref()
 
-			instanced_draw_info := MeshInstancedDrawInfo {
-				mesh_instance_idx     = mesh_instance_idx,
-				material_instance_idx = material_instance_idx,
-			}
+	resolved_dynamic_offsets := make(
+		[]u32,
+		p_job_data.num_dynamic_offset_buffers + len(GlobalUniformSlot),
+		temp_arena.allocator,
+	)
+	resolved_dynamic_offsets[0] = mesh_instance_data_offset
+	resolved_dynamic_offsets[len(resolved_dynamic_offsets) - len(GlobalUniformSlot) + int(GlobalUniformSlot.PerFrame)] =
+		g_uniform_buffers.frame_data_offset
+	resolved_dynamic_offsets[len(resolved_dynamic_offsets) - len(GlobalUniformSlot) + int(GlobalUniformSlot.RenderSettings)] =
+		g_uniform_buffers.render_settings_data_offset
 
-			if mesh_batch_key in mesh_batches {
-				mesh_batch := &mesh_batches[mesh_batch_key]
-				append(&mesh_batch.instanced_draw_infos, instanced_draw_info)
-				continue
-			}
+	// Dispatch the draw stream for each view
+	num_user_dynamic_offsets := (p_job_data.num_dynamic_offset_buffers - 1)
+	for i in 0 ..< len(p_render_views) {
 
-			i_size: u32 = size_of(INDEX_DATA_TYPE)
-			mesh_batch := MeshBatch {
-				index_buffer_offset  = mesh.index_buffer_allocation.offset + i_size * submesh.index_offset,
-				index_buffer_size    = submesh.index_count * i_size,
-				index_count          = submesh.index_count,
-				mesh_vertex_count    = mesh.vertex_count,
-				vertex_buffer_offset = mesh.vertex_buffer_allocation.offset,
-				material_type_ref    = material_instance.desc.material_type_ref,
-				instanced_draw_infos = make([dynamic]MeshInstancedDrawInfo, temp_arena.allocator),
-			}
+		render_views := p_render_views[i]
+		outputs := p_outputs_per_view[i]
+
+		for j in 0 ..< num_user_dynamic_offsets {
+			resolved_dynamic_offsets[j + 1] =
+				p_dynamic_offsets[u32(i) * num_user_dynamic_offsets + j]
+		}
 
-			append(&mesh_batch.instanced_draw_infos, instanced_draw_info)
+		view_data_offset, view_data_created := uniform_buffer_create_view_data(render_views)
+		if view_data_created == false {
+			return
+		}
 
-			mesh_batches[mesh_batch_key] = mesh_batch
+		resolved_dynamic_offsets[len(resolved_dynamic_offsets) - len(GlobalUniformSlot) + int(GlobalUniformSlot.PerView)] =
+			view_data_offset
+
+		// Record large draw streams in parallel into secondary command buffers
+		if draw_stream_should_dispatch_parallel(&draw_stream) {
+			render_task_render_pass_begin(p_render_pass_ref, outputs, {.SecondaryCommandBuffers})
+			draw_stream_dispatch_parallel(
+				cmd_buff_ref,
+				p_render_pass_ref,
+				&draw_stream,
+				resolved_dynamic_offsets,
+			)
+		} else {
+			render_task_render_pass_begin(p_render_pass_ref, outputs)
+			draw_stream_dispatch(cmd_buff_ref, &draw_stream, resolved_dynamic_offsets)
 		}
+		draw_stream_reset(&draw_stream)
+
+		render_pass_end(p_render_pass_ref, cmd_buff_ref)
 	}
+}
 
-	// Gather all of the batches for each material type
-	mesh_batches_per_material_type := make(
-		map[MaterialTypeRef][dynamic]MeshBatch,
-		len(p_material_pass_refs),
-		temp_arena.allocator,
-	)
+//---------------------------------------------------------------------------//
 
-	for _, mesh_batch in &mesh_batches {
-		if mesh_batch.material_type_ref in mesh_batches_per_material_type {
-			batches := &mesh_batches_per_material_type[mesh_batch.material_type_ref]
-			append(batches, mesh_batch)
-			continue
+// Culls the mesh batch table on the CPU and selects the LODs of its entries, records an instanced
+// draw for each batch and LOD with visible instances and uploads their draw infos.
+// Returns false when there is nothing to draw.
+@(private = "file")
+record_cpu_culled_draws :: proc(
+	p_draw_stream: ^DrawStream,
+	p_job_data: RenderInstancedMeshJob,
+	p_render_views: []RenderViews,
+	p_job_dynamic_offsets: []u32,
+	p_material_pass_refs: []MaterialPassRef,
+	p_material_pass_type: MaterialPassType,
+	p_mesh_instance_data_offset: u32,
+	p_allocator: mem.Allocator,
+) -> bool {
+
+	batches := g_mesh_batches.batches[:]
+
+	// Number of instances of each batch and LOD that are going to be drawn and the index
+	// of the first one, indexed with batch_idx * MESH_MAX_LODS + lod
+	range_first_instances := make([]u32, len(batches) * MESH_MAX_LODS, p_allocator)
+	range_num_instances := make([]u32, len(batches) * MESH_MAX_LODS, p_allocator)
+
+	// Frustum cull the batched submeshes and select their LODs. When everything is visible at LOD 0,
+	// the draw infos of the batch table can be copied to the GPU as they are.
+	mesh_instanced_draws_infos := g_mesh_batches.instanced_draw_infos[:]
+	entry_visibility := cull_mesh_batch_entries(p_render_views, p_allocator)
+	entry_lods := select_mesh_batch_entry_lods(p_render_views, p_allocator)
+
+	if entry_visibility == nil && entry_lods == nil {
+		for batch, i in batches {
+			range_first_instances[i * MESH_MAX_LODS] = batch.first_entry
+			range_num_instances[i * MESH_MAX_LODS] = batch.num_entries
+		}
+	} else {
+		visible_draw_infos := make(
+			[dynamic]MeshInstancedDrawInfo,
+			0,
+			len(g_mesh_batches.instanced_draw_infos),
+			p_allocator,
+		)
+		num_lods := entry_lods == nil ? 1 : MESH_MAX_LODS
+		for batch, i in batches {
+			for lod in 0 ..< num_lods {
+				range_idx := i * MESH_MAX_LODS + lod
+				range_first_instances[range_idx] = u32(len(visible_draw_infos))
+				for entry_idx in batch.first_entry ..< batch.first_entry + batch.num_entries {
+					if entry_visibility != nil && entry_visibility[entry_idx] == false {
+						continue
+					}
+					if entry_lods != nil && int(entry_lods[entry_idx]) != lod {
+						continue
+					}
+					append(&visible_draw_infos, g_mesh_batches.instanced_draw_infos[entry_idx])
+				}
+				range_num_instances[range_idx] =
+					u32(len(visible_draw_infos)) - range_first_instances[range_idx]
+			}
 		}
+		mesh_instanced_draws_infos = visible_draw_infos[:]
+	}
 
-		batches := make([dynamic]MeshBatch, temp_arena.allocator)
-		append(&batches, mesh_batch)
+	// Drop the instances that don't fit into the frame region of the draw info buffer
+	if len(mesh_instanced_draws_infos) > MESH_INSTANCED_DRAW_INFO_MAX_COUNT {
+		log.warnf(
+			"Too many mesh instances to draw (%d), only the first %d are drawn\n",
+			len(mesh_instanced_draws_infos),
+			MESH_INSTANCED_DRAW_INFO_MAX_COUNT,
+		)
 
-		mesh_batches_per_material_type[mesh_batch.material_type_ref] = batches
+		max_count := u32(MESH_INSTANCED_DRAW_INFO_MAX_COUNT)
+		mesh_instanced_draws_infos = mesh_instanced_draws_infos[:max_count]
+		for &num_instances, range_idx in range_num_instances {
+			first_instance := min(range_first_instances[range_idx], max_count)
+			num_instances = min(num_instances, max_count - first_instance)
+		}
 	}
 
-	// Aggregate instanced draw infos so we can issue a single copy and create the draw stream
-	mesh_instanced_draws_infos := make([dynamic]MeshInstancedDrawInfo, temp_arena.allocator)
-	num_instances_dispatched: u32 = 0
-
-	draw_stream := draw_stream_create(temp_arena.allocator, p_debug_name)
 	material_pass_type_idx := transmute(u8)p_material_pass_type
 
-	mesh_instance_data_offset := MESH_INSTANCED_DRAW_INFO_BUFFER_SIZE * get_frame_idx()
+	// Batches are sorted by their keys, so all batches of a material type are next to each other
+	material_type_first_batch := 0
+	for material_type_first_batch < len(batches) {
+
+		material_type_idx := mesh_batch_key_get_material_type_idx(
+			batches[material_type_first_batch].key,
+		)
 
-	for material_type_ref, material_mesh_batches in mesh_batches_per_material_type {
-		material_type := &g_resources.material_types[material_type_get_idx(material_type_ref)]
+		material_type_end_batch := material_type_first_batch + 1
+		for material_type_end_batch < len(batches) &&
+		    mesh_batch_key_get_material_type_idx(batches[material_type_end_batch].key) ==
+			    material_type_idx {
+			material_type_end_batch += 1
+		}
+
+		material_type_batches := batches[material_type_first_batch:material_type_end_batch]
+		material_type_batch_offset := material_type_first_batch
+		material_type_first_batch = material_type_end_batch
+
+		material_type := &g_resources.material_types[material_type_idx]
 		for material_pass_ref in material_type.desc.material_passes_refs {
 
 			// Only render this material pass if it's a part of the mesh render task
@@ -271,97 +357,57 @@ render_instanced_mesh_job_run :: proc(
 			}
 
 			material_pass := &g_resources.material_passes[material_pass_get_idx(material_pass_ref)]
-			pipeline_ref := material_pass.pass_type_pipeline_refs[material_pass_type_idx]
-
-			draw_stream_set_pipeline(&draw_stream, pipeline_ref)
-			draw_stream_set_bind_group(
-				&draw_stream,
-				p_job_data.bind_group_ref,
-				0,
-				job_dynamic_offsets,
-			)
-
-			// Technically, these bind groups can be bound only once, as all material passes of the same material pass type share the same layout
-			draw_stream_set_bind_group(
-				&draw_stream,
-				G_RENDERER.uniforms_bind_group_ref,
-				1,
-				{common.DYNAMIC_OFFSET, common.DYNAMIC_OFFSET, common.DYNAMIC_OFFSET},
+			draw_stream_bind_material_pass(
+				p_draw_stream,
+				material_pass.pass_type_pipeline_refs[material_pass_type_idx],
+				p_job_data,
+				p_job_dynamic_offsets,
 			)
 
-			draw_stream_set_bind_group(&draw_stream, G_RENDERER.globals_bind_group_ref, 2, nil)
-			draw_stream_set_bind_group(&draw_stream, G_RENDERER.bindless_bind_group_ref, 3, nil)
+			for mesh_batch, i in material_type_batches {
 
-			for mesh_batch in material_mesh_batches {
+				batch_idx := material_type_batch_offset + i
 
-				for _, i in mesh_batch.instanced_draw_infos {
-					append(&mesh_instanced_draws_infos, mesh_batch.instanced_draw_infos[i])
-				}
-
-				uv_offset := mesh_batch.mesh_vertex_count * u32(offset_of(VertexFormat, uv))
-				normal_offset :=
-					mesh_batch.mesh_vertex_count * u32(offset_of(VertexFormat, normal))
-				tangent_offset :=
-					mesh_batch.mesh_vertex_count * u32(offset_of(VertexFormat, tangent))
-
-				draw_stream_set_vertex_buffer(
-					&draw_stream,
-					mesh_get_global_vertex_buffer_ref(),
-					0,
-					mesh_batch.vertex_buffer_offset,
-					mesh_batch.mesh_vertex_count * size_of(type_of(VertexFormat{}.position)),
-				)
+				mesh := &g_resources.meshes[mesh_batch_key_get_mesh_idx(mesh_batch.key)]
+				submesh := &mesh.desc.sub_meshes[mesh_batch_key_get_submesh_idx(mesh_batch.key)]
 
-				draw_stream_set_vertex_buffer(
-					&draw_stream,
-					mesh_get_global_vertex_buffer_ref(),
-					1,
-					mesh_batch.vertex_buffer_offset + uv_offset,
-					mesh_batch.mesh_vertex_count * size_of(type_of(VertexFormat{}.uv)),
-				)
+				for lod in 0 ..< MESH_MAX_LODS {
 
-				draw_stream_set_vertex_buffer(
-					&draw_stream,
-					mesh_get_global_vertex_buffer_ref(),
-					2,
-					mesh_batch.vertex_buffer_offset + normal_offset,
-					mesh_batch.mesh_vertex_count * size_of(type_of(VertexFormat{}.normal)),
-				)
+					range_idx := batch_idx * MESH_MAX_LODS + lod
+					num_instances := range_num_instances[range_idx]
+					if num_instances == 0 {
+						continue
+					}
 
-				draw_stream_set_vertex_buffer(
-					&draw_stream,
-					mesh_get_global_vertex_buffer_ref(),
-					3,
-					mesh_batch.vertex_buffer_offset + tangent_offset,
-					mesh_batch.mesh_vertex_count * size_of(type_of(VertexFormat{}.tangent)),
-				)
+					submesh_lod := submesh.lods[lod]
 
-				draw_stream_set_index_buffer(
-					&draw_stream,
-					mesh_get_global_index_buffer_ref(),
-					.UInt32,
-					mesh_batch.index_buffer_offset,
-					mesh_batch.index_buffer_size,
-				)
+					i_size: u32 = size_of(INDEX_DATA_TYPE)
+					index_buffer_offset :=
+						mesh.index_buffer_allocation.offset + i_size * submesh_lod.index_offset
 
-				num_instances := u32(len(mesh_batch.instanced_draw_infos))
+					draw_stream_set_mesh_vertex_buffers(p_draw_stream, mesh)
 
-				draw_stream_set_draw_count(&draw_stream, mesh_batch.index_count)
-				draw_stream_set_instance_count(&draw_stream, num_instances)
-				draw_stream_set_first_instance(&draw_stream, num_instances_dispatched)
-				draw_stream_submit_draw(&draw_stream)
+					draw_stream_set_index_buffer(
+						p_draw_stream,
+						mesh_get_global_index_buffer_ref(),
+						.UInt32,
+						index_buffer_offset,
+						submesh_lod.index_count * i_size,
+					)
 
-				num_instances_dispatched += num_instances
+					draw_stream_set_draw_count(p_draw_stream, submesh_lod.index_count)
+					draw_stream_set_instance_count(p_draw_stream, num_instances)
+					draw_stream_set_first_instance(p_draw_stream, range_first_instances[range_idx])
+					draw_stream_submit_draw(p_draw_stream)
+				}
 			}
 		}
 	}
 
 	if len(mesh_instanced_draws_infos) == 0 {
-		return
+		return false
 	}
 
-	cmd_buff_ref := get_frame_cmd_buffer_ref()
-
 	// Copy the mesh instanced draw info to the GPU
 	instanced_draw_infos_size_in_bytes := u32(
 		size_of(MeshInstancedDrawInfo) * len(mesh_instanced_draws_infos),
@@ -370,7 +416,7 @@ render_instanced_mesh_job_run :: proc(
 	upload_response := buffer_upload_request_upload(
 		BufferUploadRequest {
 			dst_buff = p_job_data.instance_info_buffer_ref,
-			dst_buff_offset = mesh_instance_data_offset,
+			dst_buff_offset = p_mesh_instance_data_offset,
 			dst_queue_usage = .Graphics,
 			first_usage_stage = .VertexShader,
 			size = instanced_draw_infos_size_in_bytes,
@@ -380,42 +426,285 @@ render_instanced_mesh_job_run :: proc(
 
 	if upload_response.status == .Failed {
 		log.warn("Failed to copy mesh instanced draw info\n")
-		return
+		return false
 	}
 
-	resolved_dynamic_offsets := make(
-		[]u32,
-		p_job_data.num_dynamic_offset_buffers + len(GlobalUniformSlot),
-		temp_arena.allocator,
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+// Records a single indirect count draw for each draw group of the GPU culling job. The draw infos
+// and the draw commands are written by the culling job, so nothing has to be uploaded here.
+@(private = "file")
+record_gpu_culled_draws :: proc(
+	p_draw_stream: ^DrawStream,
+	p_gpu_culling_job: ^GPUCullingJob,
+	p_job_data: RenderInstancedMeshJob,
+	p_job_dynamic_offsets: []u32,
+	p_material_pass_refs: []MaterialPassRef,
+	p_material_pass_type: MaterialPassType,
+) {
+	draw_groups := gpu_culling_get_draw_groups()
+	material_pass_type_idx := transmute(u8)p_material_pass_type
+
+	// Draw groups are sorted by the material type, just like the batches they were made of
+	material_type_first_group := 0
+	for material_type_first_group < len(draw_groups) {
+
+		material_type_idx := draw_groups[material_type_first_group].material_type_idx
+
+		material_type_end_group := material_type_first_group + 1
+		for material_type_end_group < len(draw_groups) &&
+		    draw_groups[material_type_end_group].material_type_idx == material_type_idx {
+			material_type_end_group += 1
+		}
+
+		material_type_group_offset := material_type_first_group
+		material_type_groups := draw_groups[material_type_first_group:material_type_end_group]
+		material_type_first_group = material_type_end_group
+
+		material_type := &g_resources.material_types[material_type_idx]
+		for material_pass_ref in material_type.desc.material_passes_refs {
+
+			if slice.contains(p_material_pass_refs, material_pass_ref) == false {
+				continue
+			}
+
+			material_pass := &g_resources.material_passes[material_pass_get_idx(material_pass_ref)]
+			draw_stream_bind_material_pass(
+				p_draw_stream,
+				material_pass.pass_type_pipeline_refs[material_pass_type_idx],
+				p_job_data,
+				p_job_dynamic_offsets,
+			)
+
+			for draw_group, i in material_type_groups {
+
+				mesh := &g_resources.meshes[draw_group.mesh_idx]
+
+				i_size: u32 = size_of(INDEX_DATA_TYPE)
+
+				draw_stream_set_mesh_vertex_buffers(p_draw_stream, mesh)
+
+				// First index of each draw command is relative to the start of the mesh
+				draw_stream_set_index_buffer(
+					p_draw_stream,
+					mesh_get_global_index_buffer_ref(),
+					.UInt32,
+					mesh.index_buffer_allocation.offset,
+					mesh.index_count * i_size,
+				)
+
+				// Each batch has a draw command for each of its LODs
+				draw_stream_submit_indirect_draw(
+					p_draw_stream,
+					p_gpu_culling_job.draw_commands_buffer_ref,
+					draw_group.first_batch * MESH_MAX_LODS * size_of(DrawIndexedIndirectCommand),
+					p_gpu_culling_job.draw_counts_buffer_ref,
+					u32(material_type_group_offset + i) * size_of(u32),
+					draw_group.num_batches * MESH_MAX_LODS,
+				)
+			}
+		}
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+draw_stream_bind_material_pass :: proc(
+	p_draw_stream: ^DrawStream,
+	p_pipeline_ref: GraphicsPipelineRef,
+	p_job_data: RenderInstancedMeshJob,
+	p_job_dynamic_offsets: []u32,
+) {
+	draw_stream_set_pipeline(p_draw_stream, p_pipeline_ref)
+	draw_stream_set_bind_group(p_draw_stream, p_job_data.bind_group_ref, 0, p_job_dynamic_offsets)
+
+	// Technically, these bind groups can be bound only once, as all material passes of the same material pass type share the same layout
+	draw_stream_set_bind_group(
+		p_draw_stream,
+		G_RENDERER.uniforms_bind_group_ref,
+		1,
+		{common.DYNAMIC_OFFSET, common.DYNAMIC_OFFSET, common.DYNAMIC_OFFSET},
 	)
-	resolved_dynamic_offsets[0] = mesh_instance_data_offset
-	resolved_dynamic_offsets[len(resolved_dynamic_offsets) - len(GlobalUniformSlot) + int(GlobalUniformSlot.PerFrame)] =
-		g_uniform_buffers.frame_data_offset
-	resolved_dynamic_offsets[len(resolved_dynamic_offsets) - len(GlobalUniformSlot) + int(GlobalUniformSlot.RenderSettings)] =
-		g_uniform_buffers.render_settings_data_offset
 
-	// Dispatch the draw stream for each view
-	num_user_dynamic_offsets := (p_job_data.num_dynamic_offset_buffers - 1)
-	for i in 0 ..< len(p_render_views) {
+	draw_stream_set_bind_group(p_draw_stream, G_RENDERER.globals_bind_group_ref, 2, nil)
+	draw_stream_set_bind_group(p_draw_stream, G_RENDERER.bindless_bind_group_ref, 3, nil)
+}
 
-		render_views := p_render_views[i]
-		outputs := p_outputs_per_view[i]
+//---------------------------------------------------------------------------//
 
-		for j in 0 ..< num_user_dynamic_offsets {
-			resolved_dynamic_offsets[j + 1] =
-				p_dynamic_offsets[u32(i) * num_user_dynamic_offsets + j]
+// Vertex attributes are stored as separate streams for each mesh, so they're bound per mesh
+@(private = "file")
+draw_stream_set_mesh_vertex_buffers :: proc(p_draw_stream: ^DrawStream, p_mesh: ^MeshResource) {
+
+	vertex_buffer_offset := p_mesh.vertex_buffer_allocation.offset
+
+	uv_offset := p_mesh.vertex_count * u32(offset_of(VertexFormat, uv))
+	normal_offset := p_mesh.vertex_count * u32(offset_of(VertexFormat, normal))
+	tangent_offset := p_mesh.vertex_count * u32(offset_of(VertexFormat, tangent))
+
+	draw_stream_set_vertex_buffer(
+		p_draw_stream,
+		mesh_get_global_vertex_buffer_ref(),
+		0,
+		vertex_buffer_offset,
+		p_mesh.vertex_count * size_of(type_of(VertexFormat{}.position)),
+	)
+
+	draw_stream_set_vertex_buffer(
+		p_draw_stream,
+		mesh_get_global_vertex_buffer_ref(),
+		1,
+		vertex_buffer_offset + uv_offset,
+		p_mesh.vertex_count * size_of(type_of(VertexFormat{}.uv)),
+	)
+
+	draw_stream_set_vertex_buffer(
+		p_draw_stream,
+		mesh_get_global_vertex_buffer_ref(),
+		2,
+		vertex_buffer_offset + normal_offset,
+		p_mesh.vertex_count * size_of(type_of(VertexFormat{}.normal)),
+	)
+
+	draw_stream_set_vertex_buffer(
+		p_draw_stream,
+		mesh_get_global_vertex_buffer_ref(),
+		3,
+		vertex_buffer_offset + tangent_offset,
+		p_mesh.vertex_count * size_of(type_of(VertexFormat{}.tangent)),
+	)
+}
+
+//---------------------------------------------------------------------------//
+
+// Calculates the visibility of each entry of the mesh batch table. Returns nil when all of them
+// are visible, so the draw infos can be uploaded without compacting them.
+@(private = "file")
+cull_mesh_batch_entries :: proc(p_render_views: []RenderViews, p_allocator: mem.Allocator) -> []bool {
+
+	if G_RENDERER_SETTINGS.frustum_culling_enabled == false {
+		return nil
+	}
+
+	// The visibility is the union of all views, so a single view that can't be culled on
+	// the CPU (the shadow cascades that are fit on the GPU) makes every entry visible
+	for render_views in p_render_views {
+		if render_views.current_view.has_frustum_planes == false {
+			return nil
 		}
+	}
 
-		resolved_dynamic_offsets[len(resolved_dynamic_offsets) - len(GlobalUniformSlot) + int(GlobalUniformSlot.PerView)] =
-			uniform_buffer_create_view_data(render_views)
+	// Gather the world space bounding boxes
+	num_entries := u32(len(g_mesh_batches.entries))
+	bounding_boxes := culling_bounding_boxes_create(num_entries, p_allocator)
+	visibility := make([]bool, num_entries, p_allocator)
+
+	for entry in g_mesh_batches.entries {
+		mesh := &g_resources.meshes[mesh_batch_key_get_mesh_idx(entry.key)]
+		submesh := &mesh.desc.sub_meshes[mesh_batch_key_get_submesh_idx(entry.key)]
+		culling_bounding_boxes_add(
+			&bounding_boxes,
+			submesh.bounding_box,
+			g_resources.mesh_instances[entry.mesh_instance_idx].model_matrix,
+		)
+	}
 
-		render_task_render_pass_begin(p_render_pass_ref, outputs)
+	for render_views in p_render_views {
+		culling_frustum_cull_bounding_boxes(
+			render_views.current_view.frustum_planes,
+			&bounding_boxes,
+			visibility,
+		)
+	}
 
-		draw_stream_dispatch(cmd_buff_ref, &draw_stream, resolved_dynamic_offsets)
-		draw_stream_reset(&draw_stream)
+	return visibility
+}
 
-		render_pass_end(p_render_pass_ref, cmd_buff_ref)
+//---------------------------------------------------------------------------//
+
+// Selects the coarsest LOD of each entry of the mesh batch table whose simplification error,
+// projected on the screen, is below the threshold in all of the views. Returns nil when every
+// entry uses LOD 0, so the draw infos don't have to be grouped by their LODs.
+// Keep in sync with SelectLOD in gpu_culling.comp.hlsl.
+@(private = "file")
+select_mesh_batch_entry_lods :: proc(
+	p_render_views: []RenderViews,
+	p_allocator: mem.Allocator,
+) -> []u8 {
+
+	if G_RENDERER_SETTINGS.lod_selection_enabled == false {
+		return nil
+	}
+
+	// Views without frustum planes are the shadow cascades that are fit on the GPU, their
+	// projections aren't known here, so they use the main camera with a coarser LOD instead
+	lod_views := make([]RenderView, len(p_render_views), p_allocator)
+	lod_biases := make([]u32, len(p_render_views), p_allocator)
+	for render_views, i in p_render_views {
+		lod_views[i] = render_views.current_view
+		if lod_views[i].has_frustum_planes == false {
+			lod_views[i] = render_view_create_from_camera(g_render_camera)
+			lod_biases[i] = G_RENDERER_SETTINGS.shadow_lod_bias
+		}
+	}
+
+	resolution_y := f32(G_RENDERER.config.render_resolution.y)
+	entry_lods := make([]u8, len(g_mesh_batches.entries), p_allocator)
+	has_lods := false
+
+	for entry, entry_idx in g_mesh_batches.entries {
+		mesh := &g_resources.meshes[mesh_batch_key_get_mesh_idx(entry.key)]
+		submesh := &mesh.desc.sub_meshes[mesh_batch_key_get_submesh_idx(entry.key)]
+		if submesh.num_lods <= 1 {
+			continue
+		}
+
+		model_matrix := g_resources.mesh_instances[entry.mesh_instance_idx].model_matrix
+
+		// The errors are in mesh space, scale them by the largest scale of the instance
+		scale := max(
+			glsl.length(model_matrix[0].xyz),
+			glsl.length(model_matrix[1].xyz),
+			glsl.length(model_matrix[2].xyz),
+		)
+
+		center := (submesh.bounding_box.min + submesh.bounding_box.max) * 0.5
+		radius := glsl.length(submesh.bounding_box.max - center) * scale
+		world_center := (model_matrix * glsl.vec4{center.x, center.y, center.z, 1}).xyz
+
+		lod := submesh.num_lods - 1
+		for view, view_idx in lod_views {
+			// Size of a world space unit in pixels at the closest point of the bounding sphere
+			distance := max(glsl.length(world_center - view.position) - radius, view.near_plane)
+			pixels_per_unit := view.projection[1, 1] * 0.5 * resolution_y / distance
+
+			view_lod: u32 = 0
+			for lod_idx in 1 ..< submesh.num_lods {
+				projected_error := submesh.lods[lod_idx].error * scale * pixels_per_unit
+				if projected_error > G_RENDERER_SETTINGS.lod_error_threshold {
+					break
+				}
+				view_lod = lod_idx
+			}
+
+			lod = min(lod, view_lod + lod_biases[view_idx])
+		}
+
+		entry_lods[entry_idx] = u8(lod)
+		if lod > 0 {
+			has_lods = true
+		}
 	}
+
+	if has_lods == false {
+		return nil
+	}
+
+	return entry_lods
 }
 
 //---------------------------------------------------------------------------//
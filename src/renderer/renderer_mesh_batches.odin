@@ -0,0 +1,555 @@
+package renderer
+
+//---------------------------------------------------------------------------//
+
+import "../common"
+import "core:hash"
+import "core:log"
+import "core:math/rand"
+import "core:mem"
+import "core:slice"
+import "core:time"
+
+//---------------------------------------------------------------------------//
+
+// Layout of the mesh batch key, from the most significant bits:
+// material type | mesh | submesh
+// Sorting by it keeps all batches of the same material type (and thus pipelines) next to each other
+@(private = "file")
+MESH_BATCH_KEY_MATERIAL_TYPE_SHIFT :: 48
+@(private = "file")
+MESH_BATCH_KEY_MESH_SHIFT :: 24
+@(private = "file")
+MESH_BATCH_KEY_MESH_MASK :: 0xFFFFFF
+@(private = "file")
+MESH_BATCH_KEY_SUBMESH_MASK :: 0xFFFFFF
+
+//---------------------------------------------------------------------------//
+
+@(private)
+MeshBatchKey :: distinct u64
+
+//---------------------------------------------------------------------------//
+
+@(private)
+MeshInstancedDrawInfo :: struct #packed {
+	mesh_instance_idx:     u32,
+	material_instance_idx: u32,
+}
+
+//---------------------------------------------------------------------------//
+
+// Single submesh of a mesh instance
+@(private)
+MeshBatchEntry :: struct {
+	key:                   MeshBatchKey,
+	mesh_instance_idx:     u32,
+	material_instance_idx: u32,
+}
+
+//---------------------------------------------------------------------------//
+
+// Range of entries that share the same key and can be drawn with a single instanced draw
+@(private)
+MeshBatch :: struct {
+	key:         MeshBatchKey,
+	first_entry: u32,
+	num_entries: u32,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+MeshBatchTable :: struct {
+	// Sorted by the key, then by the mesh instance
+	entries:              [dynamic]MeshBatchEntry,
+	// Draw info for each entry, in the same order, so it can be copied to the GPU as is
+	instanced_draw_infos: [dynamic]MeshInstancedDrawInfo,
+	batches:              [dynamic]MeshBatch,
+	// Incremented each time the table changes, so users can tell when their copies are stale
+	version:              u32,
+}
+
+//---------------------------------------------------------------------------//
+
+// Batches of all mesh instances in the scene, shared by all of the mesh render tasks. Patched
+// with the mesh instances that were spawned or destroyed since the last update.
+@(private)
+g_mesh_batches: MeshBatchTable
+
+//---------------------------------------------------------------------------//
+
+// Changes the batch table is patched with on the next update
+@(private = "file")
+INTERNAL: struct {
+	// Spawned mesh instances, the ones whose mesh is still being uploaded stay here until it's done
+	pending_mesh_instance_refs:     [dynamic]MeshInstanceRef,
+	removed_mesh_instance_idxs:     [dynamic]u32,
+	removed_material_instance_idxs: [dynamic]u32,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+mesh_batches_init :: proc() {
+	g_mesh_batches = mesh_batch_table_create(
+		MAX_MESH_INSTANCES,
+		G_RENDERER_ALLOCATORS.main_allocator,
+	)
+	INTERNAL.pending_mesh_instance_refs = make(
+		[dynamic]MeshInstanceRef,
+		G_RENDERER_ALLOCATORS.main_allocator,
+	)
+	INTERNAL.removed_mesh_instance_idxs = make([dynamic]u32, G_RENDERER_ALLOCATORS.main_allocator)
+	INTERNAL.removed_material_instance_idxs = make(
+		[dynamic]u32,
+		G_RENDERER_ALLOCATORS.main_allocator,
+	)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+mesh_batches_add_mesh_instance :: proc(p_mesh_instance_ref: MeshInstanceRef) {
+	append(&INTERNAL.pending_mesh_instance_refs, p_mesh_instance_ref)
+}
+
+//---------------------------------------------------------------------------//
+
+// Has to be called before the ref is freed
+@(private)
+mesh_batches_remove_mesh_instance :: proc(p_mesh_instance_ref: MeshInstanceRef) {
+	for pending_ref, i in INTERNAL.pending_mesh_instance_refs {
+		if pending_ref == p_mesh_instance_ref {
+			unordered_remove(&INTERNAL.pending_mesh_instance_refs, i)
+			return
+		}
+	}
+	append(&INTERNAL.removed_mesh_instance_idxs, mesh_instance_get_idx(p_mesh_instance_ref))
+}
+
+//---------------------------------------------------------------------------//
+
+// Has to be called before the ref is freed
+@(private)
+mesh_batches_remove_material_instance :: proc(p_material_instance_ref: MaterialInstanceRef) {
+	append(
+		&INTERNAL.removed_material_instance_idxs,
+		material_instance_get_idx(p_material_instance_ref),
+	)
+}
+
+//---------------------------------------------------------------------------//
+
+// Removes the entries of the destroyed instances and merges in the entries of the spawned ones
+// whose mesh has been uploaded. The table is left untouched when nothing changed.
+@(private)
+mesh_batches_update :: proc() {
+	common.profiler_scope("MeshBatchesUpdate")
+
+	table_changed := mesh_batch_table_remove_entries(&g_mesh_batches)
+
+	if len(INTERNAL.pending_mesh_instance_refs) > 0 {
+		temp_arena: common.Arena
+		common.temp_arena_init(&temp_arena)
+		defer common.arena_delete(temp_arena)
+
+		added_entries := make([dynamic]MeshBatchEntry, temp_arena.allocator)
+
+		for i := 0; i < len(INTERNAL.pending_mesh_instance_refs); {
+			mesh_instance_ref := INTERNAL.pending_mesh_instance_refs[i]
+			mesh_instance_idx := mesh_instance_get_idx(mesh_instance_ref)
+			mesh_instance := &g_resources.mesh_instances[mesh_instance_idx]
+			mesh_idx := mesh_get_idx(mesh_instance.desc.mesh_ref)
+
+			if mesh_is_uploaded(mesh_idx) == false {
+				i += 1
+				continue
+			}
+			unordered_remove(&INTERNAL.pending_mesh_instance_refs, i)
+
+			mesh := &g_resources.meshes[mesh_idx]
+			for submesh, submesh_idx in mesh.desc.sub_meshes {
+				material_instance_idx := material_instance_get_idx(submesh.material_instance_ref)
+				material_instance := &g_resources.material_instances[material_instance_idx]
+
+				append(
+					&added_entries,
+					MeshBatchEntry {
+						key = mesh_batch_key_create(
+							material_type_get_idx(material_instance.desc.material_type_ref),
+							mesh_idx,
+							u32(submesh_idx),
+						),
+						mesh_instance_idx = mesh_instance_idx,
+						material_instance_idx = material_instance_idx,
+					},
+				)
+			}
+		}
+
+		if len(added_entries) > 0 {
+			slice.sort_by(added_entries[:], mesh_batch_entry_less)
+			mesh_batch_table_merge_entries(&g_mesh_batches, added_entries[:])
+			table_changed = true
+		}
+	}
+
+	if table_changed {
+		mesh_batch_table_build_batches(&g_mesh_batches)
+		g_mesh_batches.version += 1
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+mesh_batch_key_create :: #force_inline proc(
+	p_material_type_idx: u32,
+	p_mesh_idx: u32,
+	p_submesh_idx: u32,
+) -> MeshBatchKey {
+	assert(p_mesh_idx <= MESH_BATCH_KEY_MESH_MASK)
+	assert(p_submesh_idx <= MESH_BATCH_KEY_SUBMESH_MASK)
+	return MeshBatchKey(
+		u64(p_material_type_idx) << MESH_BATCH_KEY_MATERIAL_TYPE_SHIFT |
+		u64(p_mesh_idx) << MESH_BATCH_KEY_MESH_SHIFT |
+		u64(p_submesh_idx),
+	)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+mesh_batch_key_get_material_type_idx :: #force_inline proc(p_key: MeshBatchKey) -> u32 {
+	return u32(p_key >> MESH_BATCH_KEY_MATERIAL_TYPE_SHIFT)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+mesh_batch_key_get_mesh_idx :: #force_inline proc(p_key: MeshBatchKey) -> u32 {
+	return u32(p_key >> MESH_BATCH_KEY_MESH_SHIFT) & MESH_BATCH_KEY_MESH_MASK
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+mesh_batch_key_get_submesh_idx :: #force_inline proc(p_key: MeshBatchKey) -> u32 {
+	return u32(p_key) & MESH_BATCH_KEY_SUBMESH_MASK
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+mesh_batch_table_create :: proc(p_capacity: u32, p_allocator: mem.Allocator) -> MeshBatchTable {
+	return MeshBatchTable {
+		entries = make([dynamic]MeshBatchEntry, 0, p_capacity, p_allocator),
+		instanced_draw_infos = make([dynamic]MeshInstancedDrawInfo, 0, p_capacity, p_allocator),
+		batches = make([dynamic]MeshBatch, 0, p_allocator),
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+// Sorts the entries and builds the batches and the draw infos from them
+@(private = "file")
+mesh_batch_table_build :: proc(p_table: ^MeshBatchTable) {
+	slice.sort_by(p_table.entries[:], mesh_batch_entry_less)
+	mesh_batch_table_build_batches(p_table)
+}
+
+//---------------------------------------------------------------------------//
+
+// Sorts by instance within the batch as well, so the order doesn't depend on the spawn order
+@(private = "file")
+mesh_batch_entry_less :: proc(p_lhs, p_rhs: MeshBatchEntry) -> bool {
+	if p_lhs.key != p_rhs.key {
+		return p_lhs.key < p_rhs.key
+	}
+	return p_lhs.mesh_instance_idx < p_rhs.mesh_instance_idx
+}
+
+//---------------------------------------------------------------------------//
+
+// Drops the entries of the destroyed mesh and material instances, keeping the rest in order.
+// Returns false when there was nothing to remove.
+@(private = "file")
+mesh_batch_table_remove_entries :: proc(p_table: ^MeshBatchTable) -> bool {
+	removed_mesh_instance_idxs := INTERNAL.removed_mesh_instance_idxs[:]
+	removed_material_instance_idxs := INTERNAL.removed_material_instance_idxs[:]
+	if len(removed_mesh_instance_idxs) == 0 && len(removed_material_instance_idxs) == 0 {
+		return false
+	}
+
+	slice.sort(removed_mesh_instance_idxs)
+	slice.sort(removed_material_instance_idxs)
+
+	num_kept := 0
+	for entry in p_table.entries {
+		_, mesh_instance_removed := slice.binary_search(
+			removed_mesh_instance_idxs,
+			entry.mesh_instance_idx,
+		)
+		_, material_instance_removed := slice.binary_search(
+			removed_material_instance_idxs,
+			entry.material_instance_idx,
+		)
+		if mesh_instance_removed || material_instance_removed {
+			continue
+		}
+		p_table.entries[num_kept] = entry
+		num_kept += 1
+	}
+	resize(&p_table.entries, num_kept)
+
+	clear(&INTERNAL.removed_mesh_instance_idxs)
+	clear(&INTERNAL.removed_material_instance_idxs)
+
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+// Merges the sorted new entries into the sorted entries of the table in place, back to front,
+// so only the entries after the first inserted one are moved
+@(private = "file")
+mesh_batch_table_merge_entries :: proc(
+	p_table: ^MeshBatchTable,
+	p_new_entries: []MeshBatchEntry,
+) {
+	num_old_entries := len(p_table.entries)
+	resize(&p_table.entries, num_old_entries + len(p_new_entries))
+
+	entries := p_table.entries[:]
+	old_idx := num_old_entries - 1
+	new_idx := len(p_new_entries) - 1
+
+	for dst_idx := len(entries) - 1; new_idx >= 0; dst_idx -= 1 {
+		if old_idx >= 0 && mesh_batch_entry_less(p_new_entries[new_idx], entries[old_idx]) {
+			entries[dst_idx] = entries[old_idx]
+			old_idx -= 1
+		} else {
+			entries[dst_idx] = p_new_entries[new_idx]
+			new_idx -= 1
+		}
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+// Builds the batches and the draw infos from the sorted entries
+@(private = "file")
+mesh_batch_table_build_batches :: proc(p_table: ^MeshBatchTable) {
+	resize(&p_table.instanced_draw_infos, len(p_table.entries))
+	clear(&p_table.batches)
+
+	for entry, i in p_table.entries {
+		p_table.instanced_draw_infos[i] = MeshInstancedDrawInfo {
+			mesh_instance_idx     = entry.mesh_instance_idx,
+			material_instance_idx = entry.material_instance_idx,
+		}
+
+		if len(p_table.batches) > 0 && p_table.batches[len(p_table.batches) - 1].key == entry.key {
+			p_table.batches[len(p_table.batches) - 1].num_entries += 1
+			continue
+		}
+
+		append(&p_table.batches, MeshBatch{key = entry.key, first_entry = u32(i), num_entries = 1})
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+BENCHMARK_NUM_MATERIAL_TYPES :: 8
+@(private = "file")
+BENCHMARK_NUM_MESHES :: 64
+@(private = "file")
+BENCHMARK_NUM_SUBMESHES :: 4
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+LegacyMeshBatch :: struct {
+	material_type_idx:    u32,
+	instanced_draw_infos: [dynamic]MeshInstancedDrawInfo,
+}
+
+//---------------------------------------------------------------------------//
+
+// Compares the CPU time per frame of batching the mesh instances the way render_instanced_mesh_job_run
+// used to (hash map rebuilt every frame) against the persistent sorted batch table.
+// Uses synthetic data, so it doesn't need any GPU resources and can be run headless.
+mesh_batches_run_benchmark :: proc(p_num_instances: u32, p_num_frames: u32 = 16) {
+
+	arena: common.Arena
+	common.arena_init(&arena, 32 * common.MEGABYTE, context.allocator)
+	defer common.arena_delete(arena)
+
+	frame_arena: common.Arena
+	common.arena_init(&frame_arena, 64 * common.MEGABYTE, context.allocator)
+	defer common.arena_delete(frame_arena)
+
+	num_entries := p_num_instances * BENCHMARK_NUM_SUBMESHES
+
+	// Each instance references a random mesh, each submesh has a material of a different type
+	instance_mesh_indices := make([]u32, p_num_instances, arena.allocator)
+	for &mesh_idx in instance_mesh_indices {
+		mesh_idx = rand.uint32() % BENCHMARK_NUM_MESHES
+	}
+
+	// Legacy path - hash map of batches rebuilt every frame
+	legacy_duration: time.Duration
+	num_legacy_draw_infos := 0
+	for _ in 0 ..< p_num_frames {
+		free_all(frame_arena.allocator)
+
+		start := time.tick_now()
+
+		mesh_batches := make(map[u32]LegacyMeshBatch, 16, frame_arena.allocator)
+
+		for mesh_idx, instance_idx in instance_mesh_indices {
+			for submesh_idx in 0 ..< u32(BENCHMARK_NUM_SUBMESHES) {
+				material_type_idx := (mesh_idx + submesh_idx) % BENCHMARK_NUM_MATERIAL_TYPES
+
+				hash_input := []u32{material_type_idx, mesh_idx, submesh_idx}
+				mesh_batch_key := hash.crc32(slice.to_bytes(hash_input))
+
+				instanced_draw_info := MeshInstancedDrawInfo {
+					mesh_instance_idx     = u32(instance_idx),
+					material_instance_idx = mesh_idx * BENCHMARK_NUM_SUBMESHES + submesh_idx,
+				}
+
+				if mesh_batch_key in mesh_batches {
+					mesh_batch := &mesh_batches[mesh_batch_key]
+					append(&mesh_batch.instanced_draw_infos, instanced_draw_info)
+					continue
+				}
+
+				mesh_batch := LegacyMeshBatch {
+					material_type_idx    = material_type_idx,
+					instanced_draw_infos = make(
+						[dynamic]MeshInstancedDrawInfo,
+						frame_arena.allocator,
+					),
+				}
+				append(&mesh_batch.instanced_draw_infos, instanced_draw_info)
+				mesh_batches[mesh_batch_key] = mesh_batch
+			}
+		}
+
+		mesh_batches_per_material_type := make(
+			map[u32][dynamic]LegacyMeshBatch,
+			BENCHMARK_NUM_MATERIAL_TYPES,
+			frame_arena.allocator,
+		)
+		for _, mesh_batch in mesh_batches {
+			if mesh_batch.material_type_idx in mesh_batches_per_material_type {
+				batches := &mesh_batches_per_material_type[mesh_batch.material_type_idx]
+				append(batches, mesh_batch)
+				continue
+			}
+			batches := make([dynamic]LegacyMeshBatch, frame_arena.allocator)
+			append(&batches, mesh_batch)
+			mesh_batches_per_material_type[mesh_batch.material_type_idx] = batches
+		}
+
+		mesh_instanced_draws_infos := make([dynamic]MeshInstancedDrawInfo, frame_arena.allocator)
+		for _, material_mesh_batches in mesh_batches_per_material_type {
+			for mesh_batch in material_mesh_batches {
+				for _, i in mesh_batch.instanced_draw_infos {
+					append(&mesh_instanced_draws_infos, mesh_batch.instanced_draw_infos[i])
+				}
+			}
+		}
+
+		legacy_duration += time.tick_since(start)
+		num_legacy_draw_infos = len(mesh_instanced_draws_infos)
+	}
+
+	// Persistent batch table - built once, then the draw infos are copied every frame
+	table := mesh_batch_table_create(num_entries, arena.allocator)
+
+	build_start := time.tick_now()
+	for mesh_idx, instance_idx in instance_mesh_indices {
+		for submesh_idx in 0 ..< u32(BENCHMARK_NUM_SUBMESHES) {
+			append(
+				&table.entries,
+				MeshBatchEntry {
+					key = mesh_batch_key_create(
+						(mesh_idx + submesh_idx) % BENCHMARK_NUM_MATERIAL_TYPES,
+						mesh_idx,
+						submesh_idx,
+					),
+					mesh_instance_idx = u32(instance_idx),
+					material_instance_idx = mesh_idx * BENCHMARK_NUM_SUBMESHES + submesh_idx,
+				},
+			)
+		}
+	}
+	mesh_batch_table_build(&table)
+	build_duration := time.tick_since(build_start)
+
+	upload_data := make([]MeshInstancedDrawInfo, num_entries, arena.allocator)
+
+	persistent_duration: time.Duration
+	num_draws: u32 = 0
+	for _ in 0 ..< p_num_frames {
+		start := time.tick_now()
+
+		copy(upload_data, table.instanced_draw_infos[:])
+
+		// Walk the batches the same way the draw stream is built
+		num_draws = 0
+		for batch in table.batches {
+			if batch.num_entries > 0 {
+				num_draws += 1
+			}
+		}
+
+		persistent_duration += time.tick_since(start)
+	}
+
+	assert(num_legacy_draw_infos == len(table.instanced_draw_infos))
+
+	// Patch the table with a single spawned instance, the way mesh_batches_update does it
+	patch_entries: [BENCHMARK_NUM_SUBMESHES]MeshBatchEntry
+	patch_mesh_idx := rand.uint32() % BENCHMARK_NUM_MESHES
+	for &entry, submesh_idx in patch_entries {
+		entry = MeshBatchEntry {
+			key = mesh_batch_key_create(
+				(patch_mesh_idx + u32(submesh_idx)) % BENCHMARK_NUM_MATERIAL_TYPES,
+				patch_mesh_idx,
+				u32(submesh_idx),
+			),
+			mesh_instance_idx = p_num_instances,
+			material_instance_idx = patch_mesh_idx * BENCHMARK_NUM_SUBMESHES + u32(submesh_idx),
+		}
+	}
+
+	patch_start := time.tick_now()
+	slice.sort_by(patch_entries[:], mesh_batch_entry_less)
+	mesh_batch_table_merge_entries(&table, patch_entries[:])
+	mesh_batch_table_build_batches(&table)
+	patch_duration := time.tick_since(patch_start)
+
+	assert(slice.is_sorted_by(table.entries[:], mesh_batch_entry_less))
+	assert(len(table.instanced_draw_infos) == int(num_entries) + BENCHMARK_NUM_SUBMESHES)
+
+	legacy_ms := time.duration_milliseconds(legacy_duration) / f64(p_num_frames)
+	persistent_ms := time.duration_milliseconds(persistent_duration) / f64(p_num_frames)
+
+	log.infof(
+		"Mesh batching benchmark: %d instances, %d draws - per frame map rebuild: %.3f ms/frame, persistent table: %.3f ms/frame (%.1fx), table rebuild: %.3f ms, single instance patch: %.3f ms\n",
+		p_num_instances,
+		num_draws,
+		legacy_ms,
+		persistent_ms,
+		legacy_ms / max(persistent_ms, 0.0001),
+		time.duration_milliseconds(build_duration),
+		time.duration_milliseconds(patch_duration),
+	)
+}
+
+//---------------------------------------------------------------------------//
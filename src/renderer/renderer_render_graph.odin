@@ -0,0 +1,548 @@
+package renderer
+
+//---------------------------------------------------------------------------//
+
+// The render graph is compiled from the <RenderTasks> section of the renderer config, before any
+// image or render task is created. The tasks still run in the order they're declared in, the graph
+// looks at the images they read and write to:
+// - cull the tasks whose outputs are never read,
+// - find the transient images, which are written before they're read each frame, and alias
+//   the memory of the ones whose lifetimes don't overlap,
+// - check that the tasks marked with asyncCompute="" can run alongside the graphics tasks
+//   recorded before them, see renderer_async_compute.odin.
+// The barriers are still recorded by the tasks themselves, see transition_binding_resources().
+
+//---------------------------------------------------------------------------//
+
+import "../common"
+
+import "core:encoding/xml"
+import "core:log"
+import "core:slice"
+
+//---------------------------------------------------------------------------//
+
+@(private)
+g_render_graph_stats: struct {
+	// Reset each frame
+	num_barriers:               u32,
+	num_barrier_batches:        u32,
+	// Pipeline barrier calls saved by recording the input, depth and output barriers together
+	num_merged_barrier_batches: u32,
+	// Transitions that didn't need a barrier, e.g. read after read
+	num_skipped_barriers:       u32,
+	// Set when the graph is compiled
+	num_culled_tasks:           u32,
+	num_async_compute_tasks:    u32,
+	num_aliased_images:         u32,
+	aliased_memory_size:        u64,
+	aliased_memory_saved:       u64,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+RenderGraphTask :: struct {
+	name:              common.Name,
+	input_images:      [dynamic]common.Name,
+	output_images:     [dynamic]common.Name,
+	// Buffers are also consumed outside of the render tasks, e.g. as indirect arguments,
+	// so the tasks writing to them are never culled
+	has_buffer_output: bool,
+	is_culled:         bool,
+	is_async_compute:  bool,
+}
+
+//---------------------------------------------------------------------------//
+
+// Indices of the first and last render task using the image
+@(private = "file")
+RenderGraphImageLifetime :: struct {
+	first_task_idx: u32,
+	last_task_idx:  u32,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+RenderGraphTransientImage :: struct {
+	image_ref:   ImageRef,
+	memory_size: u64,
+	lifetime:    RenderGraphImageLifetime,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+RenderGraphAliasGroup :: struct {
+	images:      [dynamic]RenderGraphTransientImage,
+	image_refs:  [dynamic]ImageRef,
+	// Size of the first image, the largest one
+	memory_size: u64,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+INTERNAL: struct {
+	culled_task_names:         [dynamic]common.Name,
+	async_compute_task_names:  [dynamic]common.Name,
+	transient_image_lifetimes: map[common.Name]RenderGraphImageLifetime,
+	aliased_image_refs:        [dynamic]ImageRef,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+render_graph_compile :: proc(p_doc: ^xml.Document) -> bool {
+
+	temp_arena: common.Arena
+	common.temp_arena_init(&temp_arena)
+	defer common.arena_delete(temp_arena)
+
+	INTERNAL.culled_task_names = make([dynamic]common.Name, G_RENDERER_ALLOCATORS.main_allocator)
+	INTERNAL.async_compute_task_names = make(
+		[dynamic]common.Name,
+		G_RENDERER_ALLOCATORS.main_allocator,
+	)
+	INTERNAL.transient_image_lifetimes = make(
+		map[common.Name]RenderGraphImageLifetime,
+		G_RENDERER_ALLOCATORS.main_allocator,
+	)
+	INTERNAL.aliased_image_refs = make([dynamic]ImageRef, G_RENDERER_ALLOCATORS.main_allocator)
+
+	render_tasks_id, render_tasks_found := xml.find_child_by_ident(p_doc, 0, "RenderTasks")
+	if render_tasks_found == false {
+		return false
+	}
+
+	tasks := make([dynamic]RenderGraphTask, temp_arena.allocator)
+
+	for render_task_id in p_doc.elements[render_tasks_id].value {
+		element_id, is_element := render_task_id.(xml.Element_ID)
+		if is_element == false || p_doc.elements[element_id].kind != .Element {
+			continue
+		}
+
+		render_task_name, name_found := xml.find_attribute_val_by_key(p_doc, element_id, "name")
+		if name_found == false {
+			continue
+		}
+
+		task := RenderGraphTask {
+			name          = common.create_name(render_task_name),
+			input_images  = make([dynamic]common.Name, temp_arena.allocator),
+			output_images = make([dynamic]common.Name, temp_arena.allocator),
+		}
+		_, task.is_async_compute = xml.find_attribute_val_by_key(p_doc, element_id, "asyncCompute")
+		collect_task_resources(p_doc, element_id, &task)
+
+		append(&tasks, task)
+	}
+
+	// Only the images declared in the config can be transient, the ones created by the render
+	// tasks themselves are usually history images that have to survive until the next frame
+	candidate_images := make(map[common.Name]bool, temp_arena.allocator)
+	if images_id, images_found := xml.find_child_by_ident(p_doc, 0, "Images"); images_found {
+		for image_id in p_doc.elements[images_id].value {
+			element_id, is_element := image_id.(xml.Element_ID)
+			if is_element == false || p_doc.elements[element_id].kind != .Element {
+				continue
+			}
+
+			// Images that are read outside of the render tasks have to opt out
+			_, is_persistent := xml.find_attribute_val_by_key(p_doc, element_id, "persistent")
+			if is_persistent == false {
+				candidate_images[common.create_name(p_doc.elements[element_id].ident)] = true
+			}
+		}
+	}
+
+	// The async compute tasks run alongside the graphics ones, so the task order doesn't tell
+	// whether the lifetimes of their images overlap
+	for task in tasks {
+		if task.is_async_compute == false {
+			continue
+		}
+		for image_name in task.input_images {
+			delete_key(&candidate_images, image_name)
+		}
+		for image_name in task.output_images {
+			delete_key(&candidate_images, image_name)
+		}
+	}
+
+	// An image is transient if the first task using it in the frame doesn't read it
+	is_transient_image := make(map[common.Name]bool, temp_arena.allocator)
+	for task in tasks {
+		for image_name in task.input_images {
+			if image_name not_in is_transient_image {
+				is_transient_image[image_name] = false
+			}
+		}
+		for image_name in task.output_images {
+			if image_name not_in is_transient_image {
+				is_transient_image[image_name] = image_name in candidate_images
+			}
+		}
+	}
+
+	// Cull the tasks going backwards, a task is needed when any of its outputs is read later on
+	read_images := make(map[common.Name]bool, temp_arena.allocator)
+	#reverse for &task in tasks {
+		is_needed := task.has_buffer_output || len(task.output_images) == 0
+		for image_name in task.output_images {
+			if is_transient_image[image_name] == false || image_name in read_images {
+				is_needed = true
+				break
+			}
+		}
+
+		if is_needed == false {
+			task.is_culled = true
+			append(&INTERNAL.culled_task_names, task.name)
+			log.infof(
+				"Render task '%s' culled, its outputs are never read\n",
+				common.get_string(task.name),
+			)
+			continue
+		}
+
+		for image_name in task.input_images {
+			read_images[image_name] = true
+		}
+	}
+
+	g_render_graph_stats.num_culled_tasks = u32(len(INTERNAL.culled_task_names))
+
+	validate_async_compute_tasks(tasks[:]) or_return
+
+	// Lifetimes of the transient images used by the remaining tasks
+	for task, task_idx in tasks {
+		if task.is_culled {
+			continue
+		}
+
+		for image_name in task.input_images {
+			if is_transient_image[image_name] {
+				extend_image_lifetime(image_name, u32(task_idx))
+			}
+		}
+		for image_name in task.output_images {
+			if is_transient_image[image_name] {
+				extend_image_lifetime(image_name, u32(task_idx))
+			}
+		}
+	}
+
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+render_graph_deinit :: proc() {
+	delete(INTERNAL.culled_task_names)
+	delete(INTERNAL.async_compute_task_names)
+	delete(INTERNAL.transient_image_lifetimes)
+	delete(INTERNAL.aliased_image_refs)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+render_graph_is_task_culled :: proc(p_render_task_name: common.Name) -> bool {
+	return slice.contains(INTERNAL.culled_task_names[:], p_render_task_name)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+render_graph_is_task_async_compute :: proc(p_render_task_name: common.Name) -> bool {
+	return slice.contains(INTERNAL.async_compute_task_names[:], p_render_task_name)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+render_graph_is_image_transient :: proc(p_image_name: common.Name) -> bool {
+	return p_image_name in INTERNAL.transient_image_lifetimes
+}
+
+//---------------------------------------------------------------------------//
+
+// Creates the transient images, the ones whose lifetimes don't overlap share the same memory.
+// The images are only allocated and described, like the ones passed to image_create().
+@(private)
+render_graph_create_transient_images :: proc(p_image_refs: []ImageRef) -> bool {
+
+	temp_arena: common.Arena
+	common.temp_arena_init(&temp_arena)
+	defer common.arena_delete(temp_arena)
+
+	// Largest images first, so each group is as big as its first image
+	images := make([]RenderGraphTransientImage, len(p_image_refs), temp_arena.allocator)
+	for image_ref, i in p_image_refs {
+		image_name := g_resources.images[image_get_idx(image_ref)].name
+		images[i] = {
+			image_ref   = image_ref,
+			memory_size = image_get_memory_size(image_ref),
+			lifetime    = INTERNAL.transient_image_lifetimes[image_name],
+		}
+	}
+	slice.sort_by(images, proc(p_a, p_b: RenderGraphTransientImage) -> bool {
+		return p_a.memory_size > p_b.memory_size
+	})
+
+	// Each image goes to the first group that isn't in use during its lifetime
+	groups := make([dynamic]RenderGraphAliasGroup, temp_arena.allocator)
+	for image in images {
+		group_idx := -1
+		for group, i in groups {
+			if lifetime_overlaps_group(image.lifetime, group) == false {
+				group_idx = i
+				break
+			}
+		}
+
+		if group_idx == -1 {
+			group_idx = len(groups)
+			append(
+				&groups,
+				RenderGraphAliasGroup {
+					images = make([dynamic]RenderGraphTransientImage, temp_arena.allocator),
+					image_refs = make([dynamic]ImageRef, temp_arena.allocator),
+					memory_size = image.memory_size,
+				},
+			)
+		}
+
+		append(&groups[group_idx].images, image)
+		append(&groups[group_idx].image_refs, image.image_ref)
+	}
+
+	for group in groups {
+		if len(group.images) == 1 {
+			if image_create(group.image_refs[0]) == false {
+				log.errorf(
+					"Failed to create image '%s'\n",
+					common.get_string(g_resources.images[image_get_idx(group.image_refs[0])].name),
+				)
+			}
+			continue
+		}
+
+		if image_create_aliased(group.image_refs[:]) == false {
+			log.errorf("Failed to create %d aliased images\n", len(group.images))
+			continue
+		}
+
+		append(&INTERNAL.aliased_image_refs, ..group.image_refs[:])
+
+		g_render_graph_stats.num_aliased_images += u32(len(group.images))
+		g_render_graph_stats.aliased_memory_size += group.memory_size
+		for image in group.images[1:] {
+			g_render_graph_stats.aliased_memory_saved += image.memory_size
+		}
+	}
+
+	log.infof(
+		"Render graph: %d images aliased, %d bytes of memory saved\n",
+		g_render_graph_stats.num_aliased_images,
+		g_render_graph_stats.aliased_memory_saved,
+	)
+
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+render_graph_begin_frame :: proc() {
+	g_render_graph_stats.num_barriers = 0
+	g_render_graph_stats.num_barrier_batches = 0
+	g_render_graph_stats.num_merged_barrier_batches = 0
+	g_render_graph_stats.num_skipped_barriers = 0
+
+	// Another image of the group could've written to the memory since the last frame
+	for image_ref in INTERNAL.aliased_image_refs {
+		image_discard_content(image_ref)
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+// The graphics tasks placed between the async compute tasks are submitted before the async
+// compute work and run alongside it, so they can't read the images the async compute tasks
+// write to, nor write to the images they use. The images used by both of the queues have to
+// end the frame on the graphics queue, the next frame's graphics work can't get them back.
+@(private = "file")
+validate_async_compute_tasks :: proc(p_tasks: []RenderGraphTask) -> bool {
+
+	temp_arena: common.Arena
+	common.temp_arena_init(&temp_arena)
+	defer common.arena_delete(temp_arena)
+
+	last_async_compute_task_idx := -1
+	for task, task_idx in p_tasks {
+		if task.is_async_compute && task.is_culled == false {
+			last_async_compute_task_idx = task_idx
+		}
+	}
+
+	async_compute_input_images := make(map[common.Name]bool, temp_arena.allocator)
+	async_compute_output_images := make(map[common.Name]bool, temp_arena.allocator)
+
+	for task in p_tasks[:last_async_compute_task_idx + 1] {
+		if task.is_culled {
+			continue
+		}
+
+		if task.is_async_compute {
+			append(&INTERNAL.async_compute_task_names, task.name)
+			for image_name in task.input_images {
+				async_compute_input_images[image_name] = true
+			}
+			for image_name in task.output_images {
+				async_compute_output_images[image_name] = true
+			}
+			continue
+		}
+
+		for image_name in task.input_images {
+			if image_name in async_compute_output_images {
+				log.errorf(
+					"Render task '%s' reads '%s' written by an async compute task before it\n",
+					common.get_string(task.name),
+					common.get_string(image_name),
+				)
+				return false
+			}
+		}
+		for image_name in task.output_images {
+			if image_name in async_compute_input_images ||
+			   image_name in async_compute_output_images {
+				log.errorf(
+					"Render task '%s' writes '%s' used by an async compute task before it\n",
+					common.get_string(task.name),
+					common.get_string(image_name),
+				)
+				return false
+			}
+		}
+	}
+
+	last_task_idx_using_image := make(map[common.Name]int, temp_arena.allocator)
+	is_image_used_by_graphics := make(map[common.Name]bool, temp_arena.allocator)
+	for task, task_idx in p_tasks {
+		if task.is_culled {
+			continue
+		}
+		for image_name in task.input_images {
+			last_task_idx_using_image[image_name] = task_idx
+			if task.is_async_compute == false {
+				is_image_used_by_graphics[image_name] = true
+			}
+		}
+		for image_name in task.output_images {
+			last_task_idx_using_image[image_name] = task_idx
+			if task.is_async_compute == false {
+				is_image_used_by_graphics[image_name] = true
+			}
+		}
+	}
+
+	for image_name, task_idx in last_task_idx_using_image {
+		if p_tasks[task_idx].is_async_compute && is_image_used_by_graphics[image_name] {
+			log.errorf(
+				"Async compute task '%s' can't be the last one using '%s', it's a graphics image\n",
+				common.get_string(p_tasks[task_idx].name),
+				common.get_string(image_name),
+			)
+			return false
+		}
+	}
+
+	g_render_graph_stats.num_async_compute_tasks = u32(len(INTERNAL.async_compute_task_names))
+
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+extend_image_lifetime :: proc(p_image_name: common.Name, p_task_idx: u32) {
+	if p_image_name in INTERNAL.transient_image_lifetimes {
+		lifetime := &INTERNAL.transient_image_lifetimes[p_image_name]
+		lifetime.last_task_idx = p_task_idx
+		return
+	}
+
+	INTERNAL.transient_image_lifetimes[p_image_name] = {
+		first_task_idx = p_task_idx,
+		last_task_idx  = p_task_idx,
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+lifetime_overlaps_group :: proc(
+	p_lifetime: RenderGraphImageLifetime,
+	p_group: RenderGraphAliasGroup,
+) -> bool {
+	for image in p_group.images {
+		if p_lifetime.first_task_idx <= image.lifetime.last_task_idx &&
+		   image.lifetime.first_task_idx <= p_lifetime.last_task_idx {
+			return true
+		}
+	}
+	return false
+}
+
+//---------------------------------------------------------------------------//
+
+// Finds the images declared by the task, including the ones in the nested bindings tags
+@(private = "file")
+collect_task_resources :: proc(
+	p_doc: ^xml.Document,
+	p_element_id: xml.Element_ID,
+	p_task: ^RenderGraphTask,
+) {
+	element := p_doc.elements[p_element_id]
+
+	// Image copies declare their images as attributes
+	if element.ident == "ImageCopy" {
+		if src_name, found := xml.find_attribute_val_by_key(p_doc, p_element_id, "src"); found {
+			append(&p_task.input_images, common.create_name(src_name))
+		}
+		if dst_name, found := xml.find_attribute_val_by_key(p_doc, p_element_id, "dst"); found {
+			append(&p_task.output_images, common.create_name(dst_name))
+		}
+	}
+
+	for child_value in element.value {
+		child_id, is_element := child_value.(xml.Element_ID)
+		if is_element == false || p_doc.elements[child_id].kind != .Element {
+			continue
+		}
+
+		child := p_doc.elements[child_id]
+		switch child.ident {
+		case "InputImage":
+			if image_name, found := xml.find_attribute_val_by_key(p_doc, child_id, "name"); found {
+				append(&p_task.input_images, common.create_name(image_name))
+			}
+		case "OutputImage":
+			if image_name, found := xml.find_attribute_val_by_key(p_doc, child_id, "name"); found {
+				append(&p_task.output_images, common.create_name(image_name))
+			}
+		case "OutputBuffer":
+			p_task.has_buffer_output = true
+		case:
+			collect_task_resources(p_doc, child_id, p_task)
+		}
+	}
+}
+
+//---------------------------------------------------------------------------//
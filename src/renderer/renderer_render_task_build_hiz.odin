@@ -32,6 +32,8 @@ HiZRenderTaskData :: struct {
 	min_max_depth_buffer_ref:      BufferRef,
 	reset_hiz_bindings:            []Binding,
 	build_hiz_bindings:            []Binding,
+	// False when the resources were created by another HiZ task
+	owns_resources:                bool,
 }
 
 //---------------------------------------------------------------------------//
@@ -151,73 +153,44 @@ create_instance :: proc(
 
 	hiz_render_task_data.resolution = G_RESOLUTION_NAME_MAPPING[resolution_name]
 
-	resolution := resolve_resolution(hiz_render_task_data.resolution)
-	log2Size := linalg.min(
-		linalg.log2(glsl.vec2{f32(resolution.x), f32(resolution.y)}),
-		glsl.vec2(12),
-	) // clamp to SPD
+	// The HiZ buffer can be rebuilt multiple times per frame, e.g. by two phase occlusion culling.
+	// In that case the first task creates the resources and the following ones reuse them.
+	hiz_ref := image_find(hiz_buffer_name)
+	spd_atomic_counter_buffer_ref := InvalidBufferRef
+	min_max_depth_buffer_ref := InvalidBufferRef
 
-	// Create the HiZ buffer
-	hiz_ref := image_allocate(common.create_name(hiz_buffer_name))
-	hiz := &g_resources.images[image_get_idx(hiz_ref)]
-	hiz.desc = {
-		dimensions         = glsl.uvec3{resolution.x, resolution.y, 1},
-		mip_count          = u32(linalg.ceil(linalg.max(log2Size.x, log2Size.y))),
-		array_size         = 1,
-		flags              = {.Sampled, .Storage},
-		format             = .R32SFloat,
-		type               = .TwoDimensional,
-		sample_count_flags = {._1},
-	}
-	if image_create(hiz_ref) == false {
-		log.errorf("Failed to create render task '%s' - couldn't create HiZ\n", doc_name)
-		return false
-	}
+	hiz_render_task_data.owns_resources = hiz_ref == InvalidImageRef
 
-	defer if res == false {
-		image_destroy(hiz_ref)
-	}
+	if hiz_render_task_data.owns_resources {
+		hiz_ref, spd_atomic_counter_buffer_ref, min_max_depth_buffer_ref = create_hiz_resources(
+			doc_name,
+			hiz_buffer_name,
+			spd_counter_name,
+			min_max_depth_buffer_name,
+			resolve_resolution(hiz_render_task_data.resolution),
+		) or_return
+	} else {
+		spd_atomic_counter_buffer_ref = buffer_find(spd_counter_name)
+		min_max_depth_buffer_ref = buffer_find(min_max_depth_buffer_name)
 
-	// Create the SPD atomic counter buffer
-	spd_atomic_counter_buffer_ref := buffer_allocate(common.create_name(spd_counter_name))
-	spd_atomic_counter_buffer := &g_resources.buffers[buffer_get_idx(spd_atomic_counter_buffer_ref)]
-	spd_atomic_counter_buffer.desc = {
-		flags = {.Dedicated},
-		size  = size_of(u32) * 6,
-		usage = {.StorageBuffer},
+		if spd_atomic_counter_buffer_ref == InvalidBufferRef ||
+		   min_max_depth_buffer_ref == InvalidBufferRef {
+			log.errorf(
+				"Failed to create render task '%s' - HiZ buffers of the previous HiZ task not found\n",
+				doc_name,
+			)
+			return false
+		}
 	}
 
-	if buffer_create(spd_atomic_counter_buffer_ref) == false {
-		log.errorf(
-			"Failed to create render task '%s' - couldn't create min max depth buffer\n",
-			doc_name,
-		)
-		return false
-	}
-	defer if res == false {
+	defer if res == false && hiz_render_task_data.owns_resources {
+		image_destroy(hiz_ref)
 		buffer_destroy(spd_atomic_counter_buffer_ref)
+		buffer_destroy(min_max_depth_buffer_ref)
 	}
 
-	// Create the min max depth buffer
-	min_max_depth_buffer_ref := buffer_allocate(common.create_name(min_max_depth_buffer_name))
+	hiz := &g_resources.images[image_get_idx(hiz_ref)]
 	min_max_depth_buffer := &g_resources.buffers[buffer_get_idx(min_max_depth_buffer_ref)]
-	min_max_depth_buffer.desc = {
-		flags = {.Dedicated},
-		size  = size_of(u32) * 2,
-		usage = {.StorageBuffer},
-	}
-
-	if buffer_create(min_max_depth_buffer_ref) == false {
-		log.errorf(
-			"Failed to create render task '%s' - couldn't create min max depth buffer\n",
-			doc_name,
-		)
-		return false
-	}
-
-	defer if res == false {
-		buffer_destroy(min_max_depth_buffer_ref)
-	}
 
 	render_task_name := common.create_name(doc_name)
 
@@ -275,6 +248,7 @@ create_instance :: proc(
 	}
 
 	hiz_render_task_data.hiz_ref = hiz_ref
+	hiz_render_task_data.spd_atomic_counter_buffer_ref = spd_atomic_counter_buffer_ref
 	hiz_render_task_data.min_max_depth_buffer_ref = min_max_depth_buffer_ref
 	hiz_render_task_data.mip_count = hiz.desc.mip_count
 
@@ -294,10 +268,11 @@ destroy_instance :: proc(p_render_task_ref: RenderTaskRef) {
 	generic_compute_job_destroy(hiz_render_task_data.build_hiz_job)
 	generic_compute_job_destroy(hiz_render_task_data.reset_buffer_job)
 
-	image_destroy(hiz_render_task_data.hiz_ref)
-
-	buffer_destroy(hiz_render_task_data.spd_atomic_counter_buffer_ref)
-	buffer_destroy(hiz_render_task_data.min_max_depth_buffer_ref)
+	if hiz_render_task_data.owns_resources {
+		image_destroy(hiz_render_task_data.hiz_ref)
+		buffer_destroy(hiz_render_task_data.spd_atomic_counter_buffer_ref)
+		buffer_destroy(hiz_render_task_data.min_max_depth_buffer_ref)
+	}
 
 	delete(hiz_render_task_data.reset_hiz_bindings, G_RENDERER_ALLOCATORS.resource_allocator)
 	delete(hiz_render_task_data.build_hiz_bindings, G_RENDERER_ALLOCATORS.resource_allocator)
@@ -330,9 +305,14 @@ render :: proc(p_render_task_ref: RenderTaskRef, pdt: f32) {
 		previous_view = render_view_create_from_camera(g_previous_render_camera),
 	}
 
+	view_data_offset, view_data_created := uniform_buffer_create_view_data(render_views)
+	if view_data_created == false {
+		return
+	}
+
 	global_uniform_offsets := []u32 {
 		g_uniform_buffers.frame_data_offset,
-		uniform_buffer_create_view_data(render_views),
+		view_data_offset,
 		g_uniform_buffers.render_settings_data_offset,
 	}
 
@@ -368,8 +348,14 @@ render :: proc(p_render_task_ref: RenderTaskRef, pdt: f32) {
 			work_group_count      = work_group_count.x * work_group_count.y,
 		}
 
-		hiz_uniform_data_offset := uniform_buffer_create_transient_buffer(&hiz_uniform_data)
-		generic_compute_job_uniform_data_offset := generic_compute_job_create_uniform_data(.Full)
+		hiz_uniform_data_offset, hiz_uniform_data_created := uniform_buffer_create_transient_buffer(
+			&hiz_uniform_data,
+		)
+		generic_compute_job_uniform_data_offset, generic_uniform_data_created :=
+			generic_compute_job_create_uniform_data(.Full)
+		if hiz_uniform_data_created == false || generic_uniform_data_created == false {
+			return
+		}
 
 		per_instance_offsets := []u32 {
 			generic_compute_job_uniform_data_offset,
@@ -387,3 +373,84 @@ render :: proc(p_render_task_ref: RenderTaskRef, pdt: f32) {
 }
 
 //---------------------------------------------------------------------------//
+
+@(private = "file")
+create_hiz_resources :: proc(
+	p_doc_name: string,
+	p_hiz_buffer_name: string,
+	p_spd_counter_name: string,
+	p_min_max_depth_buffer_name: string,
+	p_resolution: glsl.uvec2,
+) -> (
+	hiz_ref: ImageRef,
+	spd_atomic_counter_buffer_ref: BufferRef,
+	min_max_depth_buffer_ref: BufferRef,
+	res: bool,
+) {
+	log2Size := linalg.min(
+		linalg.log2(glsl.vec2{f32(p_resolution.x), f32(p_resolution.y)}),
+		glsl.vec2(12),
+	) // clamp to SPD
+
+	// Create the HiZ buffer
+	hiz_ref = image_allocate(common.create_name(p_hiz_buffer_name))
+	hiz := &g_resources.images[image_get_idx(hiz_ref)]
+	hiz.desc = {
+		dimensions         = glsl.uvec3{p_resolution.x, p_resolution.y, 1},
+		mip_count          = u32(linalg.ceil(linalg.max(log2Size.x, log2Size.y))),
+		array_size         = 1,
+		flags              = {.Sampled, .Storage},
+		format             = .R32SFloat,
+		type               = .TwoDimensional,
+		sample_count_flags = {._1},
+	}
+	if image_create(hiz_ref) == false {
+		log.errorf("Failed to create render task '%s' - couldn't create HiZ\n", p_doc_name)
+		return InvalidImageRef, InvalidBufferRef, InvalidBufferRef, false
+	}
+
+	defer if res == false {
+		image_destroy(hiz_ref)
+	}
+
+	// Create the SPD atomic counter buffer
+	spd_atomic_counter_buffer_ref = buffer_allocate(common.create_name(p_spd_counter_name))
+	spd_atomic_counter_buffer := &g_resources.buffers[buffer_get_idx(spd_atomic_counter_buffer_ref)]
+	spd_atomic_counter_buffer.desc = {
+		flags = {.Dedicated},
+		size  = size_of(u32) * 6,
+		usage = {.StorageBuffer},
+	}
+
+	if buffer_create(spd_atomic_counter_buffer_ref) == false {
+		log.errorf(
+			"Failed to create render task '%s' - couldn't create SPD counter buffer\n",
+			p_doc_name,
+		)
+		return InvalidImageRef, InvalidBufferRef, InvalidBufferRef, false
+	}
+	defer if res == false {
+		buffer_destroy(spd_atomic_counter_buffer_ref)
+	}
+
+	// Create the min max depth buffer
+	min_max_depth_buffer_ref = buffer_allocate(common.create_name(p_min_max_depth_buffer_name))
+	min_max_depth_buffer := &g_resources.buffers[buffer_get_idx(min_max_depth_buffer_ref)]
+	min_max_depth_buffer.desc = {
+		flags = {.Dedicated},
+		size  = size_of(u32) * 2,
+		usage = {.StorageBuffer},
+	}
+
+	if buffer_create(min_max_depth_buffer_ref) == false {
+		log.errorf(
+			"Failed to create render task '%s' - couldn't create min max depth buffer\n",
+			p_doc_name,
+		)
+		return InvalidImageRef, InvalidBufferRef, InvalidBufferRef, false
+	}
+
+	return hiz_ref, spd_atomic_counter_buffer_ref, min_max_depth_buffer_ref, true
+}
+
+//---------------------------------------------------------------------------//
@@ -151,7 +151,8 @@ render :: proc(p_render_task_ref: RenderTaskRef, dt: f32) {
 
 	for i in 0 ..< num_cascades {
 
-		// Dummy, cascade matrices are calculated by prepare_shadow_cascades
+		// Dummy, cascade matrices are calculated by prepare_shadow_cascades. The views have
+		// no frustum planes, so the instances aren't culled against the cascades on the CPU.
 		render_views[i] = {}
 
 		outputs_per_view[i] = slice.clone(
@@ -164,7 +165,12 @@ render :: proc(p_render_task_ref: RenderTaskRef, dt: f32) {
 			cascade_index = i,
 		}
 
-		shadow_pass_uniform_offsets[i] = uniform_buffer_create_transient_buffer(&shadow_pass_info)
+		uniform_data_created: bool
+		shadow_pass_uniform_offsets[i], uniform_data_created =
+			uniform_buffer_create_transient_buffer(&shadow_pass_info)
+		if uniform_data_created == false {
+			return
+		}
 	}
 
 	render_instanced_mesh_job_run(
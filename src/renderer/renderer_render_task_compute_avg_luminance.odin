@@ -233,9 +233,14 @@ render :: proc(p_render_task_ref: RenderTaskRef, pdt: f32) {
 		previous_view = render_view_create_from_camera(g_previous_render_camera),
 	}
 
+	view_data_offset, view_data_created := uniform_buffer_create_view_data(render_views)
+	if view_data_created == false {
+		return
+	}
+
 	global_uniform_offsets := []u32 {
 		g_uniform_buffers.frame_data_offset,
-		uniform_buffer_create_view_data(render_views),
+		view_data_offset,
 		g_uniform_buffers.render_settings_data_offset,
 	}
 
@@ -259,8 +264,14 @@ render :: proc(p_render_task_ref: RenderTaskRef, pdt: f32) {
 			inv_lum_range_log = 1 / lum_range,
 		}
 
-		uniform_data_offset := uniform_buffer_create_transient_buffer(&uniform_data)
-		generic_compute_job_uniform_data_offset := generic_compute_job_create_uniform_data(.Full)
+		uniform_data_offset, uniform_data_created := uniform_buffer_create_transient_buffer(
+			&uniform_data,
+		)
+		generic_compute_job_uniform_data_offset, generic_uniform_data_created :=
+			generic_compute_job_create_uniform_data(.Full)
+		if uniform_data_created == false || generic_uniform_data_created == false {
+			return
+		}
 
 		job_uniform_offsets := []u32{generic_compute_job_uniform_data_offset, uniform_data_offset}
 
@@ -292,7 +303,12 @@ render :: proc(p_render_task_ref: RenderTaskRef, pdt: f32) {
 			max_ev100_change  = 2,
 		}
 
-		uniform_data_offset := uniform_buffer_create_transient_buffer(&uniform_data)
+		uniform_data_offset, uniform_data_created := uniform_buffer_create_transient_buffer(
+			&uniform_data,
+		)
+		if uniform_data_created == false {
+			return
+		}
 
 		job_uniform_offsets := []u32{uniform_data_offset}
 
@@ -191,9 +191,14 @@ render :: proc(p_render_task_ref: RenderTaskRef, pdt: f32) {
 		previous_view = render_view_create_from_camera(g_previous_render_camera),
 	}
 
+	view_data_offset, view_data_created := uniform_buffer_create_view_data(render_views)
+	if view_data_created == false {
+		return
+	}
+
 	global_uniform_offsets := []u32 {
 		g_uniform_buffers.frame_data_offset,
-		uniform_buffer_create_view_data(render_views),
+		view_data_offset,
 		g_uniform_buffers.render_settings_data_offset,
 	}
 
@@ -205,9 +210,11 @@ render :: proc(p_render_task_ref: RenderTaskRef, pdt: f32) {
 		.Compute if fullscreen_render_task_data.is_using_compute else .Graphics,
 	)
 
-	fullscreen_task_uniform_data_offset := generic_compute_job_create_uniform_data(
-		fullscreen_render_task_data.resolution,
-	)
+	fullscreen_task_uniform_data_offset, uniform_data_created :=
+		generic_compute_job_create_uniform_data(fullscreen_render_task_data.resolution)
+	if uniform_data_created == false {
+		return
+	}
 	per_instance_offsets := []u32{fullscreen_task_uniform_data_offset}
 
 	if fullscreen_render_task_data.is_using_compute {
@@ -4,6 +4,7 @@ package renderer
 
 import "../common"
 import "core:encoding/xml"
+import "core:log"
 
 //---------------------------------------------------------------------------//
 
@@ -11,6 +12,13 @@ import "core:encoding/xml"
 MeshRenderTaskData :: struct {
 	using material_pass_render_task: MaterialPassRenderTask,
 	render_mesh_job:                 RenderInstancedMeshJob,
+	gpu_culling_job:                 GPUCullingJob,
+	gpu_culling_mode:                GPUCullingMode,
+	hiz_name:                        common.Name,
+	uses_gpu_culling:                bool,
+	// The HiZ buffer is created by a HiZ task, which usually comes after this one,
+	// so the GPU culling job is created when the first frame begins
+	has_gpu_culling_job:             bool,
 }
 
 //---------------------------------------------------------------------------//
@@ -59,6 +67,37 @@ create_instance :: proc(
 		&mesh_render_task_data.material_pass_render_task,
 	) or_return
 
+	// Optional GPU culling
+	gpu_culling_mode_name, has_gpu_culling := xml.find_attribute_val_by_key(
+		p_render_task_config.doc,
+		p_render_task_config.render_task_element_id,
+		"gpuCulling",
+	)
+	if has_gpu_culling {
+		gpu_culling_mode, gpu_culling_mode_valid := gpu_culling_parse_mode(gpu_culling_mode_name)
+		if gpu_culling_mode_valid == false {
+			log.errorf(
+				"Failed to create render task '%s' - unsupported GPU culling mode %s\n",
+				name_str,
+				gpu_culling_mode_name,
+			)
+			return false
+		}
+
+		mesh_render_task_data.uses_gpu_culling = true
+		mesh_render_task_data.gpu_culling_mode = gpu_culling_mode
+		mesh_render_task_data.hiz_name = common.EMPTY_NAME
+
+		if gpu_culling_mode != .Frustum {
+			hiz_name := xml.find_attribute_val_by_key(
+				p_render_task_config.doc,
+				p_render_task_config.render_task_element_id,
+				"hiZBuffer",
+			) or_return
+			mesh_render_task_data.hiz_name = common.create_name(hiz_name)
+		}
+	}
+
 	mesh_render_task.data_ptr = rawptr(mesh_render_task_data)
 	mesh_render_task_data.render_mesh_job = render_mesh_job
 
@@ -72,6 +111,10 @@ destroy_instance :: proc(p_render_task_ref: RenderTaskRef) {
 	mesh_render_task := &g_resources.render_tasks[render_task_get_idx(p_render_task_ref)]
 	mesh_render_task_data := (^MeshRenderTaskData)(mesh_render_task.data_ptr)
 
+	if mesh_render_task_data.has_gpu_culling_job {
+		gpu_culling_job_destroy(mesh_render_task_data.gpu_culling_job)
+	}
+
 	render_instanced_mesh_job_destroy(mesh_render_task_data.render_mesh_job)
 	render_task_destroy_material_pass_task(mesh_render_task_data.material_pass_render_task)
 
@@ -82,6 +125,38 @@ destroy_instance :: proc(p_render_task_ref: RenderTaskRef) {
 
 @(private = "file")
 begin_frame :: proc(p_render_task_ref: RenderTaskRef) {
+	mesh_render_task := &g_resources.render_tasks[render_task_get_idx(p_render_task_ref)]
+	mesh_render_task_data := (^MeshRenderTaskData)(mesh_render_task.data_ptr)
+
+	if mesh_render_task_data.uses_gpu_culling == false ||
+	   mesh_render_task_data.has_gpu_culling_job {
+		return
+	}
+
+	hiz_ref := InvalidImageRef
+	if mesh_render_task_data.hiz_name != common.EMPTY_NAME {
+		hiz_ref = image_find(mesh_render_task_data.hiz_name)
+	}
+
+	gpu_culling_job, gpu_culling_job_created := gpu_culling_job_create(
+		mesh_render_task.desc.name,
+		mesh_render_task_data.gpu_culling_mode,
+		mesh_render_task_data.render_mesh_job.instance_info_buffer_ref,
+		hiz_ref,
+	)
+
+	// Don't try again every frame, the task will cull on the CPU instead
+	if gpu_culling_job_created == false {
+		log.warnf(
+			"Render task '%s' will cull on the CPU - failed to create the GPU culling job\n",
+			common.get_string(mesh_render_task.desc.name),
+		)
+		mesh_render_task_data.uses_gpu_culling = false
+		return
+	}
+
+	mesh_render_task_data.gpu_culling_job = gpu_culling_job
+	mesh_render_task_data.has_gpu_culling_job = true
 }
 
 //---------------------------------------------------------------------------//
@@ -98,6 +173,12 @@ render :: proc(p_render_task_ref: RenderTaskRef, dt: f32) {
 	mesh_render_task := &g_resources.render_tasks[render_task_get_idx(p_render_task_ref)]
 	mesh_render_task_data := (^MeshRenderTaskData)(mesh_render_task.data_ptr)
 
+	// Everything was already drawn by the early phase if the late one can't cull on the GPU
+	if mesh_render_task_data.gpu_culling_mode == .TwoPhaseOcclusionLate &&
+	   mesh_render_task_data.has_gpu_culling_job == false {
+		return
+	}
+
 	render_views := []RenderViews {
 		{
 			current_view = render_view_create_from_camera(g_render_camera),
@@ -113,6 +194,8 @@ render :: proc(p_render_task_ref: RenderTaskRef, dt: f32) {
 		{mesh_render_task_data.render_outputs},
 		mesh_render_task_data.material_pass_refs,
 		mesh_render_task_data.material_pass_type,
+		{},
+		&mesh_render_task_data.gpu_culling_job if mesh_render_task_data.has_gpu_culling_job else nil,
 	)
 }
 
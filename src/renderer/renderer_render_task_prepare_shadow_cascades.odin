@@ -202,9 +202,14 @@ render :: proc(p_render_task_ref: RenderTaskRef, pdt: f32) {
 		previous_view = render_view_create_from_camera(g_previous_render_camera),
 	}
 
+	view_data_offset, view_data_created := uniform_buffer_create_view_data(render_views)
+	if view_data_created == false {
+		return
+	}
+
 	global_uniform_offsets := []u32 {
 		g_uniform_buffers.frame_data_offset,
-		uniform_buffer_create_view_data(render_views),
+		view_data_offset,
 		g_uniform_buffers.render_settings_data_offset,
 	}
 
@@ -234,7 +239,14 @@ render :: proc(p_render_task_ref: RenderTaskRef, pdt: f32) {
 		shadow_map_size            = render_task_data.shadow_map_size,
 	}
 
-	task_offsets := []u32{uniform_buffer_create_transient_buffer(&uniform_data)}
+	uniform_data_offset, uniform_data_created := uniform_buffer_create_transient_buffer(
+		&uniform_data,
+	)
+	if uniform_data_created == false {
+		return
+	}
+
+	task_offsets := []u32{uniform_data_offset}
 
 	// Create cascade shadow light matrices
 	compute_command_dispatch(
@@ -182,15 +182,13 @@ type = .ThreeDimensional,
 	previous_volumetric_fog_image.desc = volumetric_fog_image.desc
 	image_create(previous_volumetric_fog_image_ref) or_return
 
-	working_image1_ref := image_allocate(common.create_name("VolumetricFogWorking1"))
-	working_image1 := &g_resources.images[image_get_idx(working_image1_ref)]
-	working_image1.desc = volumetric_fog_image.desc
-	image_create(working_image1_ref) or_return
-
-	working_image2_ref := image_allocate(common.create_name("VolumetricFogWorking2"))
-	working_image2 := &g_resources.images[image_get_idx(working_image2_ref)]
-	working_image2.desc = working_image1.desc
-	image_create(working_image2_ref) or_return
+	// The working images are declared in the renderer config, so the render graph can alias them
+	working_image1_ref := image_find("VolumetricFogWorking1")
+	working_image2_ref := image_find("VolumetricFogWorking2")
+	if working_image1_ref == InvalidImageRef || working_image2_ref == InvalidImageRef {
+		log.error("Volumetric fog working images not found\n")
+		return false
+	}
 
 	render_task_data := new(VolumetricFogRenderTaskData, G_RENDERER_ALLOCATORS.resource_allocator)
 
@@ -371,82 +369,113 @@ render :: proc(p_render_task_ref: RenderTaskRef, pdt: f32) {
 	render_task := &g_resources.render_tasks[render_task_get_idx(p_render_task_ref)]
 	render_task_data := (^VolumetricFogRenderTaskData)(render_task.data_ptr)
 
-	gpu_debug_region_begin(get_frame_cmd_buffer_ref(), render_task.desc.name)
-	defer gpu_debug_region_end(get_frame_cmd_buffer_ref())
+	is_async_compute := render_task_is_async_compute(p_render_task_ref)
+	early_cmd_buff_ref := render_task_get_cmd_buffer_ref(p_render_task_ref, .Early)
+	cmd_buff_ref := render_task_get_cmd_buffer_ref(p_render_task_ref)
 
 	render_views := RenderViews {
 		current_view  = render_view_create_from_camera(g_render_camera),
 		previous_view = render_view_create_from_camera(g_previous_render_camera),
 	}
 
+	view_data_offset, view_data_created := uniform_buffer_create_view_data(render_views)
+	uniform_data_offset, uniform_data_created := uniform_buffer_create_transient_buffer(
+		&render_task_data.uniform_data,
+	)
+	if view_data_created == false || uniform_data_created == false {
+		return
+	}
+
 	global_uniform_offsets := []u32 {
 		g_uniform_buffers.frame_data_offset,
-		uniform_buffer_create_view_data(render_views),
+		view_data_offset,
 		g_uniform_buffers.render_settings_data_offset,
 	}
 
-	job_uniform_data_offsets := []u32 {
-		uniform_buffer_create_transient_buffer(&render_task_data.uniform_data),
-	}
-
-	transition_binding_resources(render_task_data.inject_fog_bindings, .Compute)
+	job_uniform_data_offsets := []u32{uniform_data_offset}
 
-	// Inject fog data
+	// The fog data injection only uses the noise textures, so on the async compute queue it
+	// overlaps the GBuffer and shadows rendering. The rest needs this frame's shadow maps.
 	{
-		gpu_debug_region_begin(get_frame_cmd_buffer_ref(), "Inject fog data")
-		defer gpu_debug_region_end(get_frame_cmd_buffer_ref())
+		gpu_debug_region_begin(early_cmd_buff_ref, render_task.desc.name)
+		defer gpu_debug_region_end(early_cmd_buff_ref)
+
+		transition_binding_resources(
+			render_task_data.inject_fog_bindings,
+			.Compute,
+			is_async_compute,
+			.Early,
+		)
+
+		gpu_debug_region_begin(early_cmd_buff_ref, "Inject fog data")
+		defer gpu_debug_region_end(early_cmd_buff_ref)
 
 		compute_command_dispatch(
 			render_task_data.inject_fog_job.compute_command_ref,
-			get_frame_cmd_buffer_ref(),
+			early_cmd_buff_ref,
 			VOLUMETRIC_FOG_IMAGE_RESOLUTION / VOLUMETRIC_FOG_DISPATCH_SIZE,
 			{job_uniform_data_offsets, global_uniform_offsets, nil, nil},
 			nil,
 		)
 	}
 
-	transition_binding_resources(render_task_data.light_scattering_bindings, .Compute)
+	gpu_debug_region_begin(cmd_buff_ref, render_task.desc.name)
+	defer gpu_debug_region_end(cmd_buff_ref)
+
+	transition_binding_resources(
+		render_task_data.light_scattering_bindings,
+		.Compute,
+		is_async_compute,
+	)
 
 	// Calculate light scattering
 	{
-		gpu_debug_region_begin(get_frame_cmd_buffer_ref(), "Calculate light scattering")
-		defer gpu_debug_region_end(get_frame_cmd_buffer_ref())
+		gpu_debug_region_begin(cmd_buff_ref, "Calculate light scattering")
+		defer gpu_debug_region_end(cmd_buff_ref)
 
 		compute_command_dispatch(
 			render_task_data.light_scattering_job.compute_command_ref,
-			get_frame_cmd_buffer_ref(),
+			cmd_buff_ref,
 			VOLUMETRIC_FOG_IMAGE_RESOLUTION / VOLUMETRIC_FOG_DISPATCH_SIZE,
 			{job_uniform_data_offsets, global_uniform_offsets, nil, nil},
 			nil,
 		)
 	}
 
-	transition_binding_resources(render_task_data.spatial_filter_bindings, .Compute)
+	transition_binding_resources(
+		render_task_data.spatial_filter_bindings,
+		.Compute,
+		is_async_compute,
+	)
 
 	// Spatial filter
 	{
-		gpu_debug_region_begin(get_frame_cmd_buffer_ref(), "Spatial filter")
-		defer gpu_debug_region_end(get_frame_cmd_buffer_ref())
+		gpu_debug_region_begin(cmd_buff_ref, "Spatial filter")
+		defer gpu_debug_region_end(cmd_buff_ref)
 
 		compute_command_dispatch(
 			render_task_data.spatial_filter_job.compute_command_ref,
-			get_frame_cmd_buffer_ref(),
+			cmd_buff_ref,
 			VOLUMETRIC_FOG_IMAGE_RESOLUTION / VOLUMETRIC_FOG_DISPATCH_SIZE,
 			{job_uniform_data_offsets, global_uniform_offsets, nil, nil},
 			nil,
 		)
 	}
 
-	transition_binding_resources(render_task_data.temporal_filter_bindings, .Compute)
+	transition_binding_resources(
+		render_task_data.temporal_filter_bindings,
+		.Compute,
+		is_async_compute,
+	)
 
 	// Temporal filter
 	{
-		gpu_debug_region_begin(get_frame_cmd_buffer_ref(), "Temporal filter")
-		defer gpu_debug_region_end(get_frame_cmd_buffer_ref())
+		gpu_debug_region_begin(cmd_buff_ref, "Temporal filter")
+		defer gpu_debug_region_end(cmd_buff_ref)
 
 		compute_command_dispatch(
 			render_task_data.temporal_filter_job.compute_command_ref,
-			get_frame_cmd_buffer_ref(),
+			cmd_buff_ref,
 			VOLUMETRIC_FOG_IMAGE_RESOLUTION / VOLUMETRIC_FOG_DISPATCH_SIZE,
 			{job_uniform_data_offsets, global_uniform_offsets, nil, nil},
 			nil,
@@ -454,21 +483,25 @@ render :: proc(p_render_task_ref: RenderTaskRef, pdt: f32) {
 	}
 
 	image_copy_content(
-		get_frame_cmd_buffer_ref(),
+		cmd_buff_ref,
 		render_task_data.working_image_refs[1],
 		render_task_data.previous_volumetric_fog_image_ref,
 	)
 
-	transition_binding_resources(render_task_data.integrate_light_bindings, .Compute)
+	transition_binding_resources(
+		render_task_data.integrate_light_bindings,
+		.Compute,
+		is_async_compute,
+	)
 
 	// Integrate light
 	{
-		gpu_debug_region_begin(get_frame_cmd_buffer_ref(), "Integrate light")
-		defer gpu_debug_region_end(get_frame_cmd_buffer_ref())
+		gpu_debug_region_begin(cmd_buff_ref, "Integrate light")
+		defer gpu_debug_region_end(cmd_buff_ref)
 
 		compute_command_dispatch(
 			render_task_data.integrate_light_job.compute_command_ref,
-			get_frame_cmd_buffer_ref(),
+			cmd_buff_ref,
 			glsl.uvec3 {
 				VOLUMETRIC_FOG_IMAGE_RESOLUTION.x / VOLUMETRIC_FOG_DISPATCH_SIZE.x,
 				VOLUMETRIC_FOG_IMAGE_RESOLUTION.y / VOLUMETRIC_FOG_DISPATCH_SIZE.y,
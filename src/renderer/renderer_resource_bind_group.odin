@@ -70,9 +70,28 @@ BindGroupDesc :: struct {
 
 //---------------------------------------------------------------------------//
 
+// Maximum number of bindings of a bind group that can point at the transient uniform buffer
+@(private)
+MAX_BIND_GROUP_TRANSIENT_BINDINGS :: 4
+
+//---------------------------------------------------------------------------//
+
+// Binding pointing at the transient uniform buffer. Its dynamic offset is virtual and
+// has to be resolved when the bind group is bound, see renderer_transient_buffers.odin
+@(private)
+BindGroupTransientBinding :: struct {
+	binding:            u32,
+	dynamic_offset_idx: u32,
+	size:               u32,
+}
+
+//---------------------------------------------------------------------------//
+
 BindGroupResource :: struct {
-	name: common.Name,
-	desc: BindGroupDesc,
+	name:                   common.Name,
+	desc:                   BindGroupDesc,
+	transient_bindings:     [MAX_BIND_GROUP_TRANSIENT_BINDINGS]BindGroupTransientBinding,
+	num_transient_bindings: u32,
 }
 
 //---------------------------------------------------------------------------//
@@ -146,6 +165,11 @@ bind_group_update :: proc(
 	buffers := make([dynamic]BindGroupBufferBinding, temp_arena.allocator)
 	images := make([dynamic]BindGroupImageBinding, temp_arena.allocator)
 
+	bind_group := &g_resources.bind_groups[bind_group_get_idx(p_bind_group_ref)]
+	bind_group_layout := &g_resources.bind_group_layouts[bind_group_layout_get_idx(bind_group.desc.layout_ref)]
+
+	bind_group.num_transient_bindings = 0
+
 	for binding, binding_index in p_bindings {
 
 		switch b in binding {
@@ -189,6 +213,19 @@ bind_group_update :: proc(
 
 			append(&buffers, buffer_binding)
 
+			if b.usage == .Uniform && b.buffer_ref == g_uniform_buffers.transient_buffer_ref {
+				assert(bind_group.num_transient_bindings < MAX_BIND_GROUP_TRANSIENT_BINDINGS)
+				bind_group.transient_bindings[bind_group.num_transient_bindings] = {
+					binding            = u32(binding_index),
+					dynamic_offset_idx = bind_group_get_dynamic_offset_idx(
+						bind_group_layout,
+						u32(binding_index),
+					),
+					size               = b.size,
+				}
+				bind_group.num_transient_bindings += 1
+			}
+
 		case OutputBufferBinding:
 			buffer_binding := BindGroupBufferBinding {
 				binding    = u32(binding_index),
@@ -212,6 +249,23 @@ bind_group_update :: proc(
 
 //---------------------------------------------------------------------------//
 
+// Index of the binding's offset in the dynamic offsets passed when binding the bind group
+@(private = "file")
+bind_group_get_dynamic_offset_idx :: proc(
+	p_bind_group_layout: ^BindGroupLayoutResource,
+	p_binding: u32,
+) -> u32 {
+	dynamic_offset_idx := u32(0)
+	for binding in p_bind_group_layout.desc.bindings[:p_binding] {
+		if binding.type == .UniformBufferDynamic || binding.type == .StorageBufferDynamic {
+			dynamic_offset_idx += 1
+		}
+	}
+	return dynamic_offset_idx
+}
+
+//---------------------------------------------------------------------------//
+
 bind_group_get_idx :: #force_inline proc(p_ref: BindGroupRef) -> u32 {
 	return common.ref_get_idx(&G_BIND_GROUP_REF_ARRAY, p_ref)
 }
@@ -5,6 +5,7 @@ package renderer
 import "../common"
 import vma "../third_party/vma"
 import "core:c"
+import "core:sync"
 import vk "vendor:vulkan"
 
 //---------------------------------------------------------------------------//
@@ -30,9 +31,10 @@ BufferUsageFlagBits :: enum u16 {
 	VertexBuffer,
 	StorageBuffer,
 	DynamicStorageBuffer,
+	IndirectBuffer,
 }
 
-BufferUsageFlags :: distinct bit_set[BufferUsageFlagBits;u8]
+BufferUsageFlags :: distinct bit_set[BufferUsageFlagBits;u16]
 
 //---------------------------------------------------------------------------//
 
@@ -77,6 +79,11 @@ InvalidBufferRef := BufferRef {
 @(private = "file")
 G_BUFFER_REF_ARRAY: common.RefArray(BufferResource)
 
+// Transient buffer pages are created by the jobs that allocate transient data,
+// so the ref array is shared by multiple threads
+@(private = "file")
+G_BUFFER_REF_ARRAY_LOCK: sync.Mutex
+
 //---------------------------------------------------------------------------//
 
 BufferSuballocation :: struct {
@@ -121,7 +128,10 @@ buffer_init :: proc() {
 //---------------------------------------------------------------------------//
 
 buffer_allocate :: proc(p_name: common.Name) -> BufferRef {
+	sync.mutex_lock(&G_BUFFER_REF_ARRAY_LOCK)
 	ref := BufferRef(common.ref_create(BufferResource, &G_BUFFER_REF_ARRAY, p_name))
+	sync.mutex_unlock(&G_BUFFER_REF_ARRAY_LOCK)
+
 	g_resources.buffers[buffer_get_idx(ref)] = {}
 	g_resources.buffers[buffer_get_idx(ref)].name = p_name
 	return ref
@@ -146,7 +156,9 @@ buffer_create :: proc(p_ref: BufferRef) -> bool {
 	}
 
 	if backend_buffer_create(p_ref) == false {
+		sync.mutex_lock(&G_BUFFER_REF_ARRAY_LOCK)
 		common.ref_free(&G_BUFFER_REF_ARRAY, p_ref)
+		sync.mutex_unlock(&G_BUFFER_REF_ARRAY_LOCK)
 		return false
 	}
 
@@ -168,7 +180,10 @@ buffer_destroy :: proc(p_ref: BufferRef) {
 	buffer := &g_resources.buffers[buffer_get_idx(p_ref)]
 	buffer.mapped_ptr = nil
 	backend_buffer_destroy(p_ref)
+
+	sync.mutex_lock(&G_BUFFER_REF_ARRAY_LOCK)
 	common.ref_free(&G_BUFFER_REF_ARRAY, p_ref)
+	sync.mutex_unlock(&G_BUFFER_REF_ARRAY_LOCK)
 }
 
 //---------------------------------------------------------------------------//
@@ -240,7 +255,10 @@ buffer_find :: proc {
 //---------------------------------------------------------------------------//
 
 buffer_find_by_name :: proc(p_name: common.Name) -> BufferRef {
+	sync.mutex_lock(&G_BUFFER_REF_ARRAY_LOCK)
 	ref := common.ref_find_by_name(&G_BUFFER_REF_ARRAY, p_name)
+	sync.mutex_unlock(&G_BUFFER_REF_ARRAY_LOCK)
+
 	if ref == InvalidBufferRef {
 		return InvalidBufferRef
 	}
@@ -18,6 +18,8 @@ CommandBufferDesc :: struct {
 @(private)
 CommandBufferFlagBits :: enum u8 {
 	Primary,
+	// Submitted to the dedicated compute queue, see renderer_async_compute.odin
+	AsyncCompute,
 }
 
 @(private)
@@ -47,6 +49,16 @@ G_COMMAND_BUFFER_REF_ARRAY: common.RefArray(CommandBufferResource)
 
 //---------------------------------------------------------------------------//
 
+@(private = "file")
+INTERNAL: struct {
+	// Secondary command buffers for each frame in flight. Each of them has it's own command pool,
+	// so they can be recorded on any of the job system threads at the same time
+	secondary_cmd_buffer_refs:      [][MAX_SECONDARY_COMMAND_BUFFERS_PER_FRAME]CommandBufferRef,
+	num_secondary_cmd_buffers_used: u32,
+}
+
+//---------------------------------------------------------------------------//
+
 @(private)
 command_buffer_init :: proc(p_options: InitOptions) -> bool {
 	G_COMMAND_BUFFER_REF_ARRAY = common.ref_array_create(
@@ -64,7 +76,26 @@ command_buffer_init :: proc(p_options: InitOptions) -> bool {
 		MAX_COMMAND_BUFFERS,
 		G_RENDERER_ALLOCATORS.resource_allocator,
 	)
-	return backend_command_buffer_end_init(p_options)
+	backend_command_buffer_end_init(p_options) or_return
+
+	// Create the secondary command buffers
+	INTERNAL.secondary_cmd_buffer_refs = make(
+		[][MAX_SECONDARY_COMMAND_BUFFERS_PER_FRAME]CommandBufferRef,
+		G_RENDERER.num_frames_in_flight,
+		G_RENDERER_ALLOCATORS.resource_allocator,
+	)
+	for frame in 0 ..< G_RENDERER.num_frames_in_flight {
+		for i in 0 ..< MAX_SECONDARY_COMMAND_BUFFERS_PER_FRAME {
+			cmd_buff_ref := command_buffer_allocate(common.create_name("SecondaryCmdBuffer"))
+			g_resources.cmd_buffers[command_buffer_get_idx(cmd_buff_ref)].desc = {
+				frame = u8(frame),
+			}
+			command_buffer_create(cmd_buff_ref) or_return
+			INTERNAL.secondary_cmd_buffer_refs[frame][i] = cmd_buff_ref
+		}
+	}
+
+	return true
 }
 
 //---------------------------------------------------------------------------//
@@ -115,3 +146,58 @@ command_buffer_end :: #force_inline proc(p_ref: CommandBufferRef) {
 }
 
 //---------------------------------------------------------------------------//
+
+@(private)
+command_buffer_is_async_compute :: #force_inline proc(p_ref: CommandBufferRef) -> bool {
+	return .AsyncCompute in g_resources.cmd_buffers[command_buffer_get_idx(p_ref)].desc.flags
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+command_buffer_begin_frame :: proc() {
+	INTERNAL.num_secondary_cmd_buffers_used = 0
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+command_buffer_get_num_available_secondary :: proc() -> u32 {
+	return MAX_SECONDARY_COMMAND_BUFFERS_PER_FRAME - INTERNAL.num_secondary_cmd_buffers_used
+}
+
+//---------------------------------------------------------------------------//
+
+// Returns a secondary command buffer that wasn't used yet this frame.
+// Has to be called from the main thread, but the command buffer can be recorded on any thread.
+@(private)
+command_buffer_acquire_secondary :: proc() -> CommandBufferRef {
+	assert(INTERNAL.num_secondary_cmd_buffers_used < MAX_SECONDARY_COMMAND_BUFFERS_PER_FRAME)
+	cmd_buff_ref :=
+		INTERNAL.secondary_cmd_buffer_refs[get_frame_idx()][INTERNAL.num_secondary_cmd_buffers_used]
+	INTERNAL.num_secondary_cmd_buffers_used += 1
+	return cmd_buff_ref
+}
+
+//---------------------------------------------------------------------------//
+
+// Begins a secondary command buffer that will be executed inside of the given render pass
+@(private)
+command_buffer_begin_secondary :: #force_inline proc(
+	p_ref: CommandBufferRef,
+	p_render_pass_ref: RenderPassRef,
+) {
+	backend_command_buffer_begin_secondary(p_ref, p_render_pass_ref)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+command_buffer_execute_secondary :: #force_inline proc(
+	p_ref: CommandBufferRef,
+	p_secondary_refs: []CommandBufferRef,
+) {
+	backend_command_buffer_execute_secondary(p_ref, p_secondary_refs)
+}
+
+//---------------------------------------------------------------------------//
@@ -9,8 +9,10 @@ import "base:intrinsics"
 import "../common"
 import "core:c"
 import "core:log"
+import "core:math"
 import "core:math/linalg/glsl"
 import "core:mem"
+import "core:slice"
 import "core:strings"
 
 import stb_image "vendor:stb/image/"
@@ -188,13 +190,20 @@ ImageDescFlagBits :: enum u8 {
 	Sampled,
 	SwapImage,
 	AddToBindlessArray,
+	// The file mapping is shared with other resources (e.g. an asset pack), so it's never unmapped by the image
+	SharedFileMapping,
 }
 ImageDescFlags :: distinct bit_set[ImageDescFlagBits;u8]
 
 
 //---------------------------------------------------------------------------//
 
-ImageFlagBits :: enum u8 {}
+ImageFlagBits :: enum u8 {
+	// Mips are streamed in and out by the texture streaming, see renderer_texture_streaming.odin
+	Streamed,
+	// Shares its memory with other transient images, see renderer_render_graph.odin
+	Aliased,
+}
 ImageFlags :: distinct bit_set[ImageFlagBits;u8]
 
 //---------------------------------------------------------------------------//
@@ -237,12 +246,14 @@ ImageDesc :: struct {
 //---------------------------------------------------------------------------//
 
 ImageResource :: struct {
-	name:             common.Name,
-	desc:             ImageDesc,
-	flags:            ImageFlags,
-	bindless_idx:     u32,
-	loaded_mips_mask: u32, // mip 0 is the first bit
-	queue:            DeviceQueueType,
+	name:                common.Name,
+	desc:                ImageDesc,
+	flags:               ImageFlags,
+	bindless_idx:        u32,
+	loaded_mips_mask:    u32, // mip 0 is the first bit
+	queue:               DeviceQueueType,
+	// Finer mips aren't allocated in VRAM, only used by streamed textures
+	first_allocated_mip: u32,
 }
 
 //---------------------------------------------------------------------------//
@@ -286,6 +297,8 @@ SamplerNames := []string {
 ImageUploadInfo :: struct {
 	image_ref:                    ImageRef,
 	current_mip:                  u32,
+	// Finest mip to upload, the mips are uploaded from the coarsest one
+	last_mip:                     u32,
 	single_upload_size_in_texels: glsl.uvec2,
 	mip_offset_in_texels:         glsl.uvec2,
 	is_initialized:               bool,
@@ -398,6 +411,17 @@ image_create_texture :: proc(p_ref: ImageRef) -> bool {
 		(image.desc.format > .CompressedFormatsStart && image.desc.format < .CompressedFormatsEnd),
 	)
 
+	// Textures mapped from a file can stream their mips back in after they were evicted,
+	// they start with the mip tail only and the rest is streamed in on demand
+	image.first_allocated_mip = 0
+	if image.desc.file_mapping.mapped_ptr != nil &&
+	   image.desc.mip_count > 1 &&
+	   image.desc.format > .CompressedFormatsStart &&
+	   image.desc.format < .CompressedFormatsEnd {
+		image.flags += {.Streamed}
+		image.first_allocated_mip = texture_streaming_get_initial_mip(p_ref)
+	}
+
 	if backend_image_create_texture(p_ref) == false {
 		append(&INTERNAL.free_bindless_indices, image.bindless_idx)
 		common.ref_free(&G_IMAGE_REF_ARRAY, p_ref)
@@ -407,10 +431,15 @@ image_create_texture :: proc(p_ref: ImageRef) -> bool {
 	image.desc.array_size = 1
 	image.loaded_mips_mask = 0
 
+	if .Streamed in image.flags {
+		texture_streaming_register(p_ref)
+	}
+
 	// Queue data copy for this texture
 	image_upload_info := ImageUploadInfo {
 		image_ref                    = p_ref,
 		current_mip                  = image.desc.mip_count - 1,
+		last_mip                     = image.first_allocated_mip,
 		single_upload_size_in_texels = calculate_image_upload_size(
 			image.desc.dimensions,
 			image.desc.mip_count - 1,
@@ -423,6 +452,59 @@ image_create_texture :: proc(p_ref: ImageRef) -> bool {
 	return true
 }
 
+//---------------------------------------------------------------------------//
+
+// Reallocates a streamed texture so that only the mips from p_first_mip are resident.
+// The mips that are resident in both the old and the new image are kept, the finer ones
+// that weren't allocated before are queued for upload.
+@(private)
+image_reallocate_mips :: proc(p_image_ref: ImageRef, p_first_mip: u32) -> bool {
+	image := &g_resources.images[image_get_idx(p_image_ref)]
+	assert(.Streamed in image.flags)
+
+	backend_image_reallocate_mips(p_image_ref, p_first_mip) or_return
+
+	old_first_mip := image.first_allocated_mip
+	image.first_allocated_mip = p_first_mip
+	image.loaded_mips_mask &= ~u32((1 << p_first_mip) - 1)
+
+	if p_first_mip < old_first_mip {
+		image_upload_info := ImageUploadInfo {
+			image_ref                    = p_image_ref,
+			current_mip                  = old_first_mip - 1,
+			last_mip                     = p_first_mip,
+			single_upload_size_in_texels = calculate_image_upload_size(
+				image.desc.dimensions,
+				old_first_mip - 1,
+			),
+			mip_offset_in_texels         = {0, 0},
+			// The new mips were left in the transfer layout by the reallocation
+			is_initialized               = true,
+		}
+		append(&INTERNAL.image_uploads_in_progress, image_upload_info)
+	}
+
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+// Size of the given mip in VRAM, not accounting for the alignment and tiling
+@(private)
+image_get_mip_size_in_bytes :: proc(p_image_ref: ImageRef, p_mip: u32) -> u64 {
+	image := &g_resources.images[image_get_idx(p_image_ref)]
+
+	width := u64(max(image.desc.dimensions.x >> p_mip, 1))
+	height := u64(max(image.desc.dimensions.y >> p_mip, 1))
+
+	if image.desc.format > .CompressedFormatsStart && image.desc.format < .CompressedFormatsEnd {
+		block_size := u64(get_block_size_in_bytes(image.desc.format))
+		return ((width + 3) / 4) * ((height + 3) / 4) * block_size
+	}
+
+	return width * height * u64(get_pixel_size_in_bytes(image.desc.format))
+}
+
 image_create :: proc(p_image_ref: ImageRef) -> bool {
 
 	image := &g_resources.images[image_get_idx(p_image_ref)]
@@ -446,6 +528,46 @@ image_create :: proc(p_image_ref: ImageRef) -> bool {
 
 //---------------------------------------------------------------------------//
 
+// Creates transient images that share the same memory, only one of them can be used at a time.
+// The first use of each image in a frame discards the content left there by the others.
+@(private)
+image_create_aliased :: proc(p_image_refs: []ImageRef) -> bool {
+
+	for image_ref in p_image_refs {
+		image := &g_resources.images[image_get_idx(image_ref)]
+		assert(.AddToBindlessArray not_in image.desc.flags)
+		assert(image.desc.mip_count <= 16)
+		image.flags += {.Aliased}
+	}
+
+	if backend_image_create_aliased(p_image_refs) == false {
+		for image_ref in p_image_refs {
+			common.ref_free(&G_IMAGE_REF_ARRAY, image_ref)
+		}
+		return false
+	}
+
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+// Size of the memory taken up by the image, it doesn't have to be created yet
+@(private)
+image_get_memory_size :: proc(p_image_ref: ImageRef) -> u64 {
+	return backend_image_get_memory_size(p_image_ref)
+}
+
+//---------------------------------------------------------------------------//
+
+// The next transition of the image won't preserve its content
+@(private)
+image_discard_content :: proc(p_image_ref: ImageRef) {
+	backend_image_discard_content(p_image_ref)
+}
+
+//---------------------------------------------------------------------------//
+
 image_load_from_path :: proc(p_image_name: common.Name, p_image_path: string) -> ImageRef {
 	temp_arena := common.Arena{}
 	common.temp_arena_init(&temp_arena)
@@ -508,6 +630,14 @@ image_destroy :: proc(p_ref: ImageRef) {
 	if image.bindless_idx != c.UINT32_MAX {
 		append(&INTERNAL.free_bindless_indices, image.bindless_idx)
 	}
+	if .Streamed in image.flags {
+		texture_streaming_unregister(p_ref)
+		if image.desc.file_mapping.mapped_ptr != nil &&
+		   .SharedFileMapping not_in image.desc.flags {
+			common.unmap_file(image.desc.file_mapping)
+		}
+		image.desc.file_mapping = {}
+	}
 	backend_image_destroy(p_ref)
 	common.ref_free(&G_IMAGE_REF_ARRAY, p_ref)
 }
@@ -565,6 +695,122 @@ image_copy_content :: proc(
 }
 //--------------------------------------------------------------------------//
 
+// Reads the first mip of the image back from the GPU and saves it as an 8 bit PNG.
+// Stalls the GPU, meant for tools and headless runs, not for per frame use.
+// Float formats are clamped to [0, 1] and written as is, so they should already be tonemapped.
+image_write_to_png :: proc(p_image_ref: ImageRef, p_file_path: string) -> bool {
+	image := &g_resources.images[image_get_idx(p_image_ref)]
+
+	#partial switch image.desc.format {
+	case .RGBA8UNorm, .RGBA8_SRGB, .BGRA8_SRGB, .R11G11B10UFloat, .RGBA16SFloat:
+	case:
+		log.errorf(
+			"Failed to write image '%s' to PNG - unsupported format %v\n",
+			common.get_string(image.name),
+			image.desc.format,
+		)
+		return false
+	}
+
+	image_data, read_back_ok := backend_image_read_back(
+		p_image_ref,
+		G_RENDERER_ALLOCATORS.main_allocator,
+	)
+	if read_back_ok == false {
+		log.errorf("Failed to read back image '%s'\n", common.get_string(image.name))
+		return false
+	}
+	defer delete(image_data, G_RENDERER_ALLOCATORS.main_allocator)
+
+	width := int(image.desc.dimensions.x)
+	height := int(image.desc.dimensions.y)
+	num_pixels := width * height
+
+	rgba_data := make([][4]u8, num_pixels, G_RENDERER_ALLOCATORS.main_allocator)
+	defer delete(rgba_data, G_RENDERER_ALLOCATORS.main_allocator)
+
+	#partial switch image.desc.format {
+	case .RGBA8UNorm, .RGBA8_SRGB:
+		mem.copy(raw_data(rgba_data), raw_data(image_data), num_pixels * 4)
+	case .BGRA8_SRGB:
+		bgra_data := slice.reinterpret([][4]u8, image_data)
+		for bgra, i in bgra_data {
+			rgba_data[i] = {bgra.b, bgra.g, bgra.r, bgra.a}
+		}
+	case .R11G11B10UFloat:
+		packed_data := slice.reinterpret([]u32, image_data)
+		for packed, i in packed_data {
+			rgb := glsl.vec3 {
+				unpack_unsigned_float(packed & 0x7FF, 6),
+				unpack_unsigned_float((packed >> 11) & 0x7FF, 6),
+				unpack_unsigned_float((packed >> 22) & 0x3FF, 5),
+			}
+			rgba_data[i] = {unorm_to_u8(rgb.r), unorm_to_u8(rgb.g), unorm_to_u8(rgb.b), 255}
+		}
+	case .RGBA16SFloat:
+		half_data := slice.reinterpret([][4]f16, image_data)
+		for half, i in half_data {
+			rgba_data[i] = {
+				unorm_to_u8(f32(half.r)),
+				unorm_to_u8(f32(half.g)),
+				unorm_to_u8(f32(half.b)),
+				unorm_to_u8(f32(half.a)),
+			}
+		}
+	}
+
+	temp_arena: common.Arena
+	common.temp_arena_init(&temp_arena)
+	defer common.arena_delete(temp_arena)
+
+	file_path := strings.clone_to_cstring(p_file_path, temp_arena.allocator)
+	png_res := stb_image.write_png(
+		file_path,
+		c.int(width),
+		c.int(height),
+		4,
+		raw_data(rgba_data),
+		c.int(width * 4),
+	)
+	if png_res == 0 {
+		log.errorf(
+			"Failed to write image '%s' to '%s'\n",
+			common.get_string(image.name),
+			p_file_path,
+		)
+		return false
+	}
+
+	return true
+}
+
+//--------------------------------------------------------------------------//
+
+// Decodes the unsigned 11 and 10 bit floats, they have a 5 bit exponent and no sign bit
+@(private = "file")
+unpack_unsigned_float :: proc(p_bits: u32, p_mantissa_bits: u32) -> f32 {
+	mantissa := f32(p_bits & ((1 << p_mantissa_bits) - 1)) / f32(u32(1) << p_mantissa_bits)
+	exponent := i32(p_bits >> p_mantissa_bits)
+
+	if exponent == 0 {
+		return math.ldexp(mantissa, -14)
+	}
+	if exponent == 31 {
+		// Inf and NaN, saturate
+		return 1
+	}
+	return math.ldexp(1 + mantissa, exponent - 15)
+}
+
+//--------------------------------------------------------------------------//
+
+@(private = "file")
+unorm_to_u8 :: #force_inline proc(p_value: f32) -> u8 {
+	return u8(clamp(p_value, 0, 1) * 255 + 0.5)
+}
+
+//--------------------------------------------------------------------------//
+
 @(private)
 image_progress_uploads :: proc() {
 	temp_arena := common.Arena{}
@@ -713,7 +959,7 @@ try_progress_image_copies :: proc(
 					image_upload_info.single_upload_size_in_texels.y
 			}
 
-			is_last_mip := image_upload_info.current_mip == 0
+			is_last_mip := image_upload_info.current_mip == image_upload_info.last_mip
 			mip_upload_done := image_upload_info.mip_offset_in_texels.y == mip_dimensions.y
 
 			// Copy the data to the staging buffer
@@ -76,6 +76,8 @@ material_instance_deinit :: proc() {
 //---------------------------------------------------------------------------//
 
 material_instance_update_dirty_materials :: proc() {
+	common.profiler_scope("MaterialInstanceUpdate")
+
 	for i in 0 ..< G_MATERIAL_INSTANCE_REF_ARRAY.alive_count {
 		material_instance_ref := G_MATERIAL_INSTANCE_REF_ARRAY.alive_refs[i]
 		material_instance := &g_resources.material_instances[material_instance_get_idx(material_instance_ref)]
@@ -95,7 +97,7 @@ material_instance_update_dirty_data :: proc(p_material_instance_ref: MaterialIns
 	material_instance_data_offset := size_of(MaterialProperties) * material_instance_idx
 
 	// If material instance data is dirty, we need to issue a copy to the GPU
-	buffer_upload_request_upload(
+	upload_response := buffer_upload_request_upload(
 		BufferUploadRequest {
 			dst_buff = g_renderer_buffers.material_instances_buffer_ref,
 			dst_buff_offset = material_instance_data_offset,
@@ -103,11 +105,14 @@ material_instance_update_dirty_data :: proc(p_material_instance_ref: MaterialIns
 			first_usage_stage = .VertexShader,
 			size = size_of(MaterialProperties),
 			data_ptr = material_instance_get_properties_ptr(p_material_instance_ref),
-			flags = {.RunOnNextFrame},
+			flags = {.Coalesced},
 		},
 	)
 
-	material_instance.flags -= {.Dirty}
+	// Try again next frame if the staging buffer is full
+	if upload_response.status == .Uploaded {
+		material_instance.flags -= {.Dirty}
+	}
 }
 
 //---------------------------------------------------------------------------//
@@ -137,6 +142,7 @@ material_instance_get_idx :: proc(p_ref: MaterialInstanceRef) -> u32 {
 //--------------------------------------------------------------------------//
 
 material_instance_destroy :: proc(p_ref: MaterialInstanceRef) {
+	mesh_batches_remove_material_instance(p_ref)
 	common.ref_free(&G_MATERIAL_INSTANCE_REF_ARRAY, p_ref)
 }
 
@@ -150,6 +156,15 @@ material_instance_get_properties_ptr :: proc(
 
 //--------------------------------------------------------------------------//
 
+@(private)
+material_instance_get_properties_ptr_by_idx :: proc(
+	p_material_instance_idx: u32,
+) -> ^MaterialProperties {
+	return &INTERNAL.material_properties_array[p_material_instance_idx]
+}
+
+//--------------------------------------------------------------------------//
+
 material_instance_mark_dirty :: proc(p_material_instance_ref: MaterialInstanceRef) {
 	material_instance_idx := material_instance_get_idx(p_material_instance_ref)
 	material_instance := &g_resources.material_instances[material_instance_idx]
@@ -272,13 +272,19 @@ material_pass_compile_for_type :: proc(
 	pixel_shader.desc.file_path = shader_path
 	pixel_shader.desc.stage = .Pixel
 
-	shader_create(vertex_shader_ref) or_return
-	defer if result == false {
-		shader_destroy(vertex_shader_ref)
+	// Both of the stages are compiled at once
+	shader_refs := []ShaderRef{vertex_shader_ref, pixel_shader_ref}
+	shaders_created: [2]bool
+	if shader_create_many(shader_refs, shaders_created[:]) == false {
+		for shader_ref, i in shader_refs {
+			if shaders_created[i] {
+				shader_destroy(shader_ref)
+			}
+		}
+		return false
 	}
-
-	shader_create(pixel_shader_ref) or_return
 	defer if result == false {
+		shader_destroy(vertex_shader_ref)
 		shader_destroy(pixel_shader_ref)
 	}
 
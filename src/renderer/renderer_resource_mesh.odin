@@ -7,6 +7,7 @@ import "core:c"
 import "core:log"
 import "core:math/linalg/glsl"
 import "core:mem"
+import "core:slice"
 
 //---------------------------------------------------------------------------//
 
@@ -20,11 +21,14 @@ INDEX_DATA_TYPE :: u32
 @(private = "file")
 ZERO_VECTOR := glsl.vec4{0, 0, 0, 0}
 
+// Layout of a vertex in the vertex buffer, each attribute is stored in a separate stream.
+// Positions are quantized relative to MeshDesc.position_bounds and dequantized in the vertex
+// shader, normals and tangents are octahedral encoded.
 VertexFormat :: struct #packed {
-	position: glsl.vec3,
-	uv:       glsl.vec2,
-	normal:   glsl.vec3,
-	tangent:  glsl.vec3,
+	position: [4]u16, // unorm, w is unused
+	uv:       [2]f16,
+	normal:   [2]i16, // snorm
+	tangent:  [2]i16, // snorm
 }
 
 //---------------------------------------------------------------------------//
@@ -57,33 +61,92 @@ MeshFeatureFlags :: distinct bit_set[MeshFeatureFlagBits;u16]
 
 //---------------------------------------------------------------------------//
 
+// Axis aligned bounding box, in mesh space for meshes and submeshes
+BoundingBox :: struct {
+	min: glsl.vec3,
+	max: glsl.vec3,
+}
+
+//---------------------------------------------------------------------------//
+
+MESHLET_MAX_VERTICES :: 64
+MESHLET_MAX_TRIANGLES :: 124
+
+MESH_MAX_LODS :: 4
+
+//---------------------------------------------------------------------------//
+
+// Small cluster of triangles of a submesh. The triangles are stored as 8-bit indices into the
+// meshlet's vertices, which in turn are indices into the vertices of the submesh.
+Meshlet :: struct {
+	vertex_offset:   u32, // into MeshDesc.meshlet_vertices
+	vertex_count:    u32,
+	triangle_offset: u32, // in bytes into MeshDesc.meshlet_triangles, 4 byte aligned
+	triangle_count:  u32,
+	// Mesh space bounding sphere
+	center:          glsl.vec3,
+	radius:          f32,
+	// Normal cone, the meshlet is back facing when
+	// dot(normalize(cone_apex - camera_position), cone_axis) >= cone_cutoff
+	cone_apex:       glsl.vec3,
+	cone_cutoff:     f32,
+	cone_axis:       glsl.vec3,
+}
+
+//---------------------------------------------------------------------------//
+
+// Simplified index range of a submesh, using the same vertices as the submesh itself
+SubMeshLOD :: struct {
+	index_offset: u32, // in number of indices
+	index_count:  u32,
+	// Approximate distance to the original surface, in mesh space
+	error:        f32,
+}
+
+//---------------------------------------------------------------------------//
+
 SubMesh :: struct {
 	index_offset:          u32, // in number of indices
 	index_count:           u32,
 	vertex_offset:         u32, // in number of vertices
 	vertex_count:          u32,
+	meshlet_offset:        u32, // in number of meshlets
+	meshlet_count:         u32,
 	material_instance_ref: MaterialInstanceRef,
+	bounding_box:          BoundingBox,
+	// LOD 0 is the index range of the submesh itself
+	lods:                  [MESH_MAX_LODS]SubMeshLOD,
+	num_lods:              u32,
 }
 
 //---------------------------------------------------------------------------//
 
 MeshDesc :: struct {
-	name:           common.Name,
+	name:              common.Name,
 	// Misc flags, telling is if mesh is using indexed draw or not etc.
-	flags:          MeshDescFlags,
+	flags:             MeshDescFlags,
 	// Flags specyfing which features the mesh has (position, normals, UVs etc.)
-	features:       MeshFeatureFlags,
+	features:          MeshFeatureFlags,
 	// List of submeshes that actually define the ranges in vertex/index data
-	sub_meshes:     []SubMesh,
-	// Mesh data
-	indices:        []INDEX_DATA_TYPE,
-	position:       []glsl.vec3,
-	uv:             []glsl.vec2,
-	normal:         []glsl.vec3,
-	tangent:        []glsl.vec3,
+	sub_meshes:        []SubMesh,
+	// Mesh data, vertex attributes are packed as in VertexFormat
+	indices:           []INDEX_DATA_TYPE,
+	position:          [][4]u16,
+	uv:                [][2]f16,
+	normal:            [][2]i16,
+	tangent:           [][2]i16,
+	// Range the positions are quantized to, in mesh space
+	position_bounds:   BoundingBox,
+	// Optional meshlet data, copied to the mesh resource when it's created
+	meshlets:          []Meshlet,
+	meshlet_vertices:  []u32,
+	meshlet_triangles: []u8,
 	// Allocator that was used to allocate memory for the vertex and index data
-	data_allocator: mem.Allocator,
-	file_mapping:   common.FileMemoryMapping,
+	data_allocator:    mem.Allocator,
+	file_mapping:      common.FileMemoryMapping,
+	// Optional single allocation that all of the mesh data points into, e.g. a decompressed
+	// mesh file. When set, it's released instead of the individual streams
+	data_block:        []byte,
 }
 
 //---------------------------------------------------------------------------//
@@ -104,6 +167,12 @@ MeshResource :: struct {
 	vertex_buffer_allocation: BufferSuballocation,
 	index_buffer_allocation:  BufferSuballocation,
 	data_upload_context:      MeshDataUploadContext,
+	// Union of the bounding boxes of all submeshes
+	bounding_box:             BoundingBox,
+	// Meshlets of all submeshes, SubMesh.meshlet_offset/meshlet_count define the ranges
+	meshlets:                 []Meshlet,
+	meshlet_vertices:         []u32,
+	meshlet_triangles:        []u8,
 }
 
 //---------------------------------------------------------------------------//
@@ -181,6 +250,26 @@ mesh_create :: proc(p_mesh_ref: MeshRef) -> bool {
 	mesh.index_count = u32(index_count)
 	mesh.vertex_count = u32(vertex_count)
 
+	// Submeshes without LODs are drawn with their full index range
+	for &sub_mesh in mesh.desc.sub_meshes {
+		if sub_mesh.num_lods == 0 {
+			sub_mesh.lods[0] = SubMeshLOD {
+				index_offset = sub_mesh.index_offset,
+				index_count  = sub_mesh.index_count,
+			}
+			sub_mesh.num_lods = 1
+		}
+	}
+
+	// Calculate the bounding box of the whole mesh
+	if len(mesh.desc.sub_meshes) > 0 {
+		mesh.bounding_box = mesh.desc.sub_meshes[0].bounding_box
+		for sub_mesh in mesh.desc.sub_meshes[1:] {
+			mesh.bounding_box.min = glsl.min(mesh.bounding_box.min, sub_mesh.bounding_box.min)
+			mesh.bounding_box.max = glsl.max(mesh.bounding_box.max, sub_mesh.bounding_box.max)
+		}
+	}
+
 	// Check if the data that is actually provided has the expected number of elements
 	assert(len(mesh.desc.uv) == 0 || len(mesh.desc.uv) == vertex_count)
 	assert(len(mesh.desc.normal) == 0 || len(mesh.desc.normal) == vertex_count)
@@ -191,6 +280,22 @@ mesh_create :: proc(p_mesh_ref: MeshRef) -> bool {
 		(.Indexed in mesh.desc.flags) == false && len(mesh.desc.indices) == 0,
 	)
 
+	// Keep the meshlets around, the mesh data is released once it's uploaded
+	if len(mesh.desc.meshlets) > 0 {
+		mesh.meshlets = slice.clone(
+			mesh.desc.meshlets,
+			G_RENDERER_ALLOCATORS.resource_allocator,
+		)
+		mesh.meshlet_vertices = slice.clone(
+			mesh.desc.meshlet_vertices,
+			G_RENDERER_ALLOCATORS.resource_allocator,
+		)
+		mesh.meshlet_triangles = slice.clone(
+			mesh.desc.meshlet_triangles,
+			G_RENDERER_ALLOCATORS.resource_allocator,
+		)
+	}
+
 	vertex_data_size := size_of(VertexFormat) * vertex_count
 	index_data_size := index_count * size_of(INDEX_DATA_TYPE)
 
@@ -248,7 +353,7 @@ mesh_create :: proc(p_mesh_ref: MeshRef) -> bool {
 
 	// Upload vertex data
 	{
-		positions_size := u32(vertex_count * size_of(glsl.vec3))
+		positions_size := u32(vertex_count * size_of(type_of(VertexFormat{}.position)))
 		uvs_size: u32 = 0
 		normals_size: u32 = 0
 		tangents_size: u32 = 0
@@ -269,7 +374,7 @@ mesh_create :: proc(p_mesh_ref: MeshRef) -> bool {
 		mesh.data_upload_context.needed_uploads_count += 1
 
 		if .UV in mesh.desc.features {
-			uvs_size = u32(vertex_count * size_of(glsl.vec2))
+			uvs_size = u32(vertex_count * size_of(type_of(VertexFormat{}.uv)))
 			uvs_upload_request := BufferUploadRequest {
 				dst_buff                        = INTERNAL.vertex_buffer_ref,
 				dst_buff_offset                 = vertex_allocation.offset + positions_size,
@@ -286,7 +391,7 @@ mesh_create :: proc(p_mesh_ref: MeshRef) -> bool {
 		}
 
 		if .Normal in mesh.desc.features {
-			normals_size = u32(vertex_count * size_of(glsl.vec3))
+			normals_size = u32(vertex_count * size_of(type_of(VertexFormat{}.normal)))
 			normals_upload_request := BufferUploadRequest {
 				dst_buff                        = INTERNAL.vertex_buffer_ref,
 				dst_buff_offset                 = vertex_allocation.offset + positions_size + uvs_size,
@@ -303,7 +408,7 @@ mesh_create :: proc(p_mesh_ref: MeshRef) -> bool {
 		}
 
 		if .Tangent in mesh.desc.features {
-			tangents_size = u32(vertex_count * size_of(glsl.vec3))
+			tangents_size = u32(vertex_count * size_of(type_of(VertexFormat{}.tangent)))
 			tangents_upload_request := BufferUploadRequest {
 				dst_buff                        = INTERNAL.vertex_buffer_ref,
 				dst_buff_offset                 = vertex_allocation.offset + positions_size + uvs_size + normals_size,
@@ -361,6 +466,12 @@ mesh_destroy :: proc(p_ref: MeshRef) {
 
 	delete(mesh.desc.sub_meshes, G_RENDERER_ALLOCATORS.resource_allocator)
 
+	if mesh.meshlets != nil {
+		delete(mesh.meshlets, G_RENDERER_ALLOCATORS.resource_allocator)
+		delete(mesh.meshlet_vertices, G_RENDERER_ALLOCATORS.resource_allocator)
+		delete(mesh.meshlet_triangles, G_RENDERER_ALLOCATORS.resource_allocator)
+	}
+
 	// Free index and vertex data
 	buffer_free(INTERNAL.index_buffer_ref, mesh.index_buffer_allocation.vma_allocation)
 	buffer_free(INTERNAL.vertex_buffer_ref, mesh.vertex_buffer_allocation.vma_allocation)
@@ -376,6 +487,21 @@ mesh_free :: proc(p_mesh_ref: MeshRef) {
 
 //--------------------------------------------------------------------------//
 
+@(private)
+mesh_is_uploaded :: #force_inline proc(p_mesh_idx: u32) -> bool {
+	upload_context := &g_resources.meshes[p_mesh_idx].data_upload_context
+	return upload_context.finished_uploads_count == upload_context.needed_uploads_count
+}
+
+//--------------------------------------------------------------------------//
+
+// Returns true once all of the mesh data is uploaded, meshes are not rendered before that
+mesh_is_ready :: proc(p_mesh_ref: MeshRef) -> bool {
+	return mesh_is_uploaded(mesh_get_idx(p_mesh_ref))
+}
+
+//--------------------------------------------------------------------------//
+
 @(private)
 mesh_get_global_vertex_buffer_ref :: proc() -> BufferRef {
 	return INTERNAL.vertex_buffer_ref
@@ -434,6 +560,12 @@ mesh_upload_finished_callback :: proc(p_user_data: rawptr) {
 			return
 		}
 
+		if mesh.desc.data_block != nil {
+			delete(mesh.desc.data_block, mesh.desc.data_allocator)
+			mesh.desc.data_block = nil
+			return
+		}
+
 		delete(mesh.desc.position, mesh.desc.data_allocator)
 		if mesh.desc.indices != nil {
 			delete(mesh.desc.indices, mesh.desc.data_allocator)
@@ -49,6 +49,9 @@ InvalidMeshInstanceRef := MeshInstanceRef {
 MeshInstanceInfoData :: struct #packed {
 	model_matrix:      glsl.mat4,
 	prev_model_matrix: glsl.mat4,
+	// Dequantizes the positions of the mesh, see VertexFormat
+	position_offset:   glsl.vec4,
+	position_scale:    glsl.vec4,
 }
 
 //---------------------------------------------------------------------------//
@@ -79,6 +82,7 @@ mesh_instance_create :: proc(p_mesh_instance_ref: MeshInstanceRef) -> bool {
 	mesh_instance.model_matrix = glsl.identity(glsl.mat4)
 	mesh_instance.prev_model_matrix = glsl.identity(glsl.mat4)
 	mesh_instance.flags += {.MeshInstanceDataDirty}
+	mesh_batches_add_mesh_instance(p_mesh_instance_ref)
 	return true
 }
 
@@ -101,6 +105,7 @@ mesh_instance_get_idx :: proc(p_ref: MeshInstanceRef) -> u32 {
 
 mesh_instance_destroy :: proc(p_ref: MeshInstanceRef) {
 	// mesh_instance := get_mesh_instance(p_ref)
+	mesh_batches_remove_mesh_instance(p_ref)
 	common.ref_free(&g_resource_refs.mesh_instances, p_ref)
 }
 
@@ -108,6 +113,7 @@ mesh_instance_destroy :: proc(p_ref: MeshInstanceRef) {
 
 @(private)
 mesh_instance_update :: proc() {
+	common.profiler_scope("MeshInstanceUpdate")
 
 	for i in 0 ..< g_resource_refs.mesh_instances.alive_count {
 
@@ -117,9 +123,24 @@ mesh_instance_update :: proc() {
 
 		if .MeshInstanceDataDirty in mesh_instance.flags {
 
+			mesh := &g_resources.meshes[mesh_get_idx(mesh_instance.desc.mesh_ref)]
+			position_bounds := mesh.desc.position_bounds
+
 			mesh_instance_info := MeshInstanceInfoData {
 				model_matrix = mesh_instance.model_matrix,
 				prev_model_matrix = mesh_instance.prev_model_matrix,
+				position_offset = glsl.vec4{
+					position_bounds.min.x,
+					position_bounds.min.y,
+					position_bounds.min.z,
+					0,
+				},
+				position_scale = glsl.vec4{
+					position_bounds.max.x - position_bounds.min.x,
+					position_bounds.max.y - position_bounds.min.y,
+					position_bounds.max.z - position_bounds.min.z,
+					0,
+				},
 			}
 
 			buffer_upload_request := BufferUploadRequest {
@@ -129,6 +150,7 @@ mesh_instance_update :: proc() {
 				first_usage_stage = .VertexShader,
 				size              = size_of(mesh_instance_info),
 				data_ptr          = &mesh_instance_info,
+				flags             = {.Coalesced},
 			}
 
 			buffer_upload_response := buffer_upload_request_upload(buffer_upload_request)
@@ -6,16 +6,16 @@ package renderer
 
 import "../common"
 import c "core:c"
-
-import "core:math/linalg/glsl"
+import "core:log"
+import "core:slice"
 
 //---------------------------------------------------------------------------//
 
 MeshVertexLayout :: struct {
-	position: glsl.vec3,
-	uv:       glsl.vec2,
-	normal:   glsl.vec3,
-	tangent:  glsl.vec3,
+	position: [4]u16,
+	uv:       [2]f16,
+	normal:   [2]i16,
+	tangent:  [2]i16,
 }
 
 //---------------------------------------------------------------------------//
@@ -157,6 +157,31 @@ PipelineType :: enum u8 {
 
 //---------------------------------------------------------------------------//
 
+@(private)
+g_pipeline_stats: struct {
+	num_created:    u32,
+	// Created straight from the pipeline cache, without compiling anything
+	num_cache_hits: u32,
+	num_compiled:   u32,
+	// Identical to another pipeline in the same batch, so they weren't compiled again
+	num_duplicates: u32,
+	create_time_ms: f64,
+	// Size of the pipeline cache at the last flush
+	cache_size:     u64,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+INTERNAL: struct {
+	is_batch_open:                  bool,
+	// Pipelines whose creation was deferred until the batch ends
+	batched_graphics_pipeline_refs: [dynamic]GraphicsPipelineRef,
+	batched_compute_pipeline_refs:  [dynamic]ComputePipelineRef,
+}
+
+//---------------------------------------------------------------------------//
+
 @(private)
 pipeline_init :: proc() -> bool {
 	// Graphics pipelines
@@ -193,6 +218,15 @@ pipeline_init :: proc() -> bool {
 		G_RENDERER_ALLOCATORS.resource_allocator,
 	)
 
+	INTERNAL.batched_graphics_pipeline_refs = make(
+		[dynamic]GraphicsPipelineRef,
+		G_RENDERER_ALLOCATORS.main_allocator,
+	)
+	INTERNAL.batched_compute_pipeline_refs = make(
+		[dynamic]ComputePipelineRef,
+		G_RENDERER_ALLOCATORS.main_allocator,
+	)
+
 	backend_pipeline_init() or_return
 
 	return true
@@ -202,11 +236,73 @@ pipeline_init :: proc() -> bool {
 
 @(private)
 pipeline_deinit :: proc() {
+	delete(INTERNAL.batched_graphics_pipeline_refs)
+	delete(INTERNAL.batched_compute_pipeline_refs)
 	backend_pipeline_deinit()
 }
 
 //---------------------------------------------------------------------------//
 
+// Pipelines created until pipeline_batch_end() is called are only validated, their creation
+// is deferred until the end of the batch, which creates all of them in parallel.
+// They can't be bound before that.
+@(private)
+pipeline_batch_begin :: proc() {
+	assert(INTERNAL.is_batch_open == false)
+	INTERNAL.is_batch_open = true
+}
+
+//---------------------------------------------------------------------------//
+
+// Returns false if any of the batched pipelines failed
+@(private)
+pipeline_batch_end :: proc() -> bool {
+	assert(INTERNAL.is_batch_open)
+	INTERNAL.is_batch_open = false
+
+	defer clear(&INTERNAL.batched_graphics_pipeline_refs)
+	defer clear(&INTERNAL.batched_compute_pipeline_refs)
+
+	stats_before := g_pipeline_stats
+
+	success := backend_pipelines_create(
+		INTERNAL.batched_graphics_pipeline_refs[:],
+		INTERNAL.batched_compute_pipeline_refs[:],
+	)
+
+	log.infof(
+		"Created %d pipelines in %.2f ms - %d cache hits, %d compiled\n",
+		g_pipeline_stats.num_created - stats_before.num_created,
+		g_pipeline_stats.create_time_ms - stats_before.create_time_ms,
+		g_pipeline_stats.num_cache_hits - stats_before.num_cache_hits,
+		g_pipeline_stats.num_compiled - stats_before.num_compiled,
+	)
+
+	return success
+}
+
+//---------------------------------------------------------------------------//
+
+// Recreates the pipelines in parallel, e.g. after their shaders were reloaded
+@(private)
+pipelines_recreate :: proc(
+	p_graphics_pipeline_refs: []GraphicsPipelineRef,
+	p_compute_pipeline_refs: []ComputePipelineRef,
+) -> bool {
+	for pipeline_ref in p_graphics_pipeline_refs {
+		backend_graphics_pipeline_destroy(pipeline_ref)
+		backend_graphics_pipeline_create_layout(pipeline_ref) or_return
+	}
+	for pipeline_ref in p_compute_pipeline_refs {
+		backend_compute_pipeline_destroy(pipeline_ref)
+		backend_compute_pipeline_create_layout(pipeline_ref) or_return
+	}
+
+	return backend_pipelines_create(p_graphics_pipeline_refs, p_compute_pipeline_refs)
+}
+
+//---------------------------------------------------------------------------//
+
 graphics_pipeline_allocate :: proc(
 	p_name: common.Name,
 	p_bind_group_layouts_count: u32,
@@ -233,7 +329,17 @@ graphics_pipeline_allocate :: proc(
 //---------------------------------------------------------------------------//
 
 graphics_pipeline_create :: proc(p_ref: GraphicsPipelineRef) -> bool {
-	if backend_graphics_pipeline_create(p_ref) == false {
+	if backend_graphics_pipeline_create_layout(p_ref) == false {
+		graphics_pipeline_destroy(p_ref)
+		return false
+	}
+
+	if INTERNAL.is_batch_open {
+		append(&INTERNAL.batched_graphics_pipeline_refs, p_ref)
+		return true
+	}
+
+	if backend_pipelines_create({p_ref}, nil) == false {
 		graphics_pipeline_destroy(p_ref)
 		return false
 	}
@@ -251,6 +357,10 @@ graphics_pipeline_get_idx :: #force_inline proc(p_ref: GraphicsPipelineRef) -> u
 graphics_pipeline_destroy :: proc(p_ref: GraphicsPipelineRef) {
 	pipeline := &g_resources.graphics_pipelines[graphics_pipeline_get_idx(p_ref)]
 
+	if idx, found := slice.linear_search(INTERNAL.batched_graphics_pipeline_refs[:], p_ref); found {
+		unordered_remove(&INTERNAL.batched_graphics_pipeline_refs, idx)
+	}
+
 	delete(pipeline.desc.bind_group_layout_refs, G_RENDERER_ALLOCATORS.resource_allocator)
 	pipeline.desc.bind_group_layout_refs = nil
 
@@ -298,7 +408,17 @@ compute_pipeline_allocate :: proc(
 //---------------------------------------------------------------------------//
 
 compute_pipeline_create :: proc(p_ref: ComputePipelineRef) -> bool {
-	if backend_compute_pipeline_create(p_ref) == false {
+	if backend_compute_pipeline_create_layout(p_ref) == false {
+		compute_pipeline_destroy(p_ref)
+		return false
+	}
+
+	if INTERNAL.is_batch_open {
+		append(&INTERNAL.batched_compute_pipeline_refs, p_ref)
+		return true
+	}
+
+	if backend_pipelines_create(nil, {p_ref}) == false {
 		compute_pipeline_destroy(p_ref)
 		return false
 	}
@@ -316,6 +436,10 @@ compute_pipeline_get_idx :: #force_inline proc(p_ref: ComputePipelineRef) -> u32
 compute_pipeline_destroy :: proc(p_ref: ComputePipelineRef) {
 	pipeline := &g_resources.compute_pipelines[compute_pipeline_get_idx(p_ref)]
 
+	if idx, found := slice.linear_search(INTERNAL.batched_compute_pipeline_refs[:], p_ref); found {
+		unordered_remove(&INTERNAL.batched_compute_pipeline_refs, idx)
+	}
+
 	delete(pipeline.desc.bind_group_layout_refs, G_RENDERER_ALLOCATORS.resource_allocator)
 	pipeline.desc.bind_group_layout_refs = nil
 
@@ -102,8 +102,18 @@ RenderPassOutput :: struct {
 
 //---------------------------------------------------------------------------//
 
+RenderPassBeginFlagBits :: enum u8 {
+	// Contents of the render pass are recorded into secondary command buffers
+	SecondaryCommandBuffers,
+}
+
+RenderPassBeginFlags :: distinct bit_set[RenderPassBeginFlagBits;u8]
+
+//---------------------------------------------------------------------------//
+
 RenderPassBeginInfo :: struct {
 	outputs: []RenderPassOutput,
+	flags:   RenderPassBeginFlags,
 }
 
 //---------------------------------------------------------------------------//
@@ -17,12 +17,22 @@ import "core:strings"
 //---------------------------------------------------------------------------//
 
 RenderTaskDesc :: struct {
-	name: common.Name,
-	type: RenderTaskType,
+	name:  common.Name,
+	type:  RenderTaskType,
+	flags: RenderTaskFlags,
 }
 
 //---------------------------------------------------------------------------//
 
+RenderTaskFlagBits :: enum u8 {
+	// Recorded for the dedicated compute queue, see renderer_async_compute.odin
+	AsyncCompute,
+}
+
+RenderTaskFlags :: distinct bit_set[RenderTaskFlagBits;u8]
+
+//---------------------------------------------------------------------------//
+
 RenderTaskRef :: common.Ref(RenderTaskResource)
 
 //---------------------------------------------------------------------------//
@@ -186,8 +196,10 @@ render_task_init :: proc() -> bool {
 //---------------------------------------------------------------------------//
 
 render_task_deinit :: proc() {
-	for i in 0 ..< G_RENDER_TASK_REF_ARRAY.alive_count {
-		render_task_destroy(G_RENDER_TASK_REF_ARRAY.alive_refs[i])
+	// Destroying a task swaps the last alive ref into its place, so go from the back
+	for G_RENDER_TASK_REF_ARRAY.alive_count > 0 {
+		last_alive_idx := G_RENDER_TASK_REF_ARRAY.alive_count - 1
+		render_task_destroy(G_RENDER_TASK_REF_ARRAY.alive_refs[last_alive_idx])
 	}
 	common.ref_array_clear(&G_RENDER_TASK_REF_ARRAY)
 }
@@ -242,6 +254,7 @@ render_task_map_name_to_type :: proc(p_type_name: string) -> (RenderTaskType, bo
 
 @(private)
 render_task_update :: proc(p_dt: f32) {
+	common.profiler_scope("RenderTaskUpdate")
 
 	// Fill per frame uniform data
 	for i in 0 ..< G_RENDER_TASK_REF_ARRAY.alive_count {
@@ -250,14 +263,29 @@ render_task_update :: proc(p_dt: f32) {
 		INTERNAL.render_task_functions[render_task.desc.type].begin_frame(render_task_ref)
 	}
 
-	// Upload uniform data
-	uniform_buffer_update(p_dt)
+	// Upload uniform data, without it there is nothing the render tasks can bind
+	if uniform_buffer_update(p_dt) {
 
-	// Render
-	for i in 0 ..< G_RENDER_TASK_REF_ARRAY.alive_count {
-		render_task_ref := G_RENDER_TASK_REF_ARRAY.alive_refs[i]
-		render_task := &g_resources.render_tasks[render_task_get_idx(render_task_ref)]
-		INTERNAL.render_task_functions[render_task.desc.type].render(render_task_ref, p_dt)
+		// The graphics work recorded after the last async compute task waits for the async compute
+		last_async_compute_task_idx := -1
+		for i in 0 ..< G_RENDER_TASK_REF_ARRAY.alive_count {
+			if render_task_is_async_compute(G_RENDER_TASK_REF_ARRAY.alive_refs[i]) {
+				last_async_compute_task_idx = int(i)
+			}
+		}
+
+		// Render
+		for i in 0 ..< G_RENDER_TASK_REF_ARRAY.alive_count {
+			render_task_ref := G_RENDER_TASK_REF_ARRAY.alive_refs[i]
+			render_task := &g_resources.render_tasks[render_task_get_idx(render_task_ref)]
+			INTERNAL.render_task_functions[render_task.desc.type].render(render_task_ref, p_dt)
+
+			if int(i) == last_async_compute_task_idx {
+				async_compute_split_graphics()
+			}
+		}
+	} else {
+		log.error("Failed to upload the per frame uniform data, skipping the render tasks")
 	}
 
 	// Cleanup
@@ -363,12 +391,14 @@ render_task_config_parse_bindings :: proc(
 render_task_render_pass_begin :: proc(
 	p_render_pass_ref: RenderPassRef,
 	p_outputs: []RenderPassOutput,
+	p_flags: RenderPassBeginFlags = {},
 ) {
 
 	transition_render_outputs(p_outputs)
 
 	render_pass_begin_info := RenderPassBeginInfo {
 		outputs = p_outputs,
+		flags   = p_flags,
 	}
 
 	render_pass_begin(p_render_pass_ref, get_frame_cmd_buffer_ref(), &render_pass_begin_info)
@@ -454,7 +484,7 @@ parse_input_buffer :: proc(
 	buffer_ref: BufferRef
 
 	if buffer_usage == .Uniform {
-		buffer_ref = g_uniform_buffers.transient_buffer.buffer_ref
+		buffer_ref = g_uniform_buffers.transient_buffer_ref
 		offset = common.DYNAMIC_OFFSET
 	} else {
 
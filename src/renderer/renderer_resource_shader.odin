@@ -9,13 +9,11 @@ import "core:c"
 import "core:encoding/json"
 import "core:hash"
 import "core:log"
-import "core:mem"
 import "core:os"
 import "core:slice"
 import "core:strings"
-import "core:sys/windows"
+import "core:time"
 import "core:unicode"
-import "core:unicode/utf16"
 
 import "../common"
 
@@ -27,9 +25,8 @@ BASE_SHADERS_PATH :: "app_data/renderer/assets/shaders/"
 
 @(private = "file")
 INTERNAL: struct {
-	shader_by_hash:       map[u32]ShaderRef,
-	shaders_dir_handle:   windows.HANDLE,
-	windows_event_handle: windows.HANDLE,
+	shader_by_hash:      map[u32]ShaderRef,
+	shaders_dir_watcher: common.DirectoryWatcher,
 }
 
 //---------------------------------------------------------------------------//
@@ -75,7 +72,10 @@ ShaderResource :: struct {
 	desc:           ShaderDesc,
 	flags:          ShaderFlags,
 	hash:           u32,
+	// Files included by the shader, directly or not, relative to the shaders dir
 	included_files: []string,
+	// Key of the compiled shader in the shader cache, see renderer_shader_compiler.odin
+	cache_key:      u64,
 }
 
 //---------------------------------------------------------------------------//
@@ -123,19 +123,7 @@ shader_init :: proc() -> bool {
 
 	shader_json_entries: []ShaderJSONEntry
 
-	// Make sure that the bin and reflect dirs exist
-	{
-		dirs := []string {
-			"app_data/renderer/assets/shaders/bin",
-			"app_data/renderer/assets/shaders/reflect",
-		}
-
-		for dir in dirs {
-			if os.exists(dir) == false {
-				os.make_directory(dir, 0)
-			}
-		}
-	}
+	shader_compiler_init() or_return
 
 	// Parse the shader config file
 	if err := json.unmarshal(
@@ -148,7 +136,10 @@ shader_init :: proc() -> bool {
 		return false
 	}
 
-	// Load the shaders
+	startup_start := time.tick_now()
+
+	// Allocate the shaders, they're compiled together below
+	shader_refs := make([dynamic]ShaderRef, temp_arena.allocator)
 	for entry in shader_json_entries {
 
 		name := common.create_name(entry.name)
@@ -157,7 +148,7 @@ shader_init :: proc() -> bool {
 		shader.desc.file_path = common.create_name(entry.path)
 
 		shader_features := slice.clone_to_dynamic(entry.features, temp_arena.allocator)
-		for feature, i in shader.desc.features {
+		for feature, i in entry.features {
 			shader_features[i] = strings.clone(feature, G_RENDERER_ALLOCATORS.resource_allocator)
 		}
 
@@ -234,13 +225,37 @@ shader_init :: proc() -> bool {
 			return false
 		}
 
-		if shader_create(shader_ref) == false {
-			log.errorf("Failed to create shader %s\n", entry.name)
-			common.ref_free(&g_resource_refs.shaders, shader_ref)
-			continue
+		append(&shader_refs, shader_ref)
+	}
+
+	// Compile the shaders
+	{
+		shaders_created := make([]bool, len(shader_refs), temp_arena.allocator)
+		shader_create_many(shader_refs[:], shaders_created)
+
+		for shader_ref, i in shader_refs {
+			if shaders_created[i] == false {
+				log.errorf("Failed to create shader %s\n", shader_json_entries[i].name)
+				common.ref_free(&g_resource_refs.shaders, shader_ref)
+			}
 		}
 	}
 
+	g_shader_compile_stats.startup_num_cache_hits = g_shader_compile_stats.num_cache_hits
+	g_shader_compile_stats.startup_num_compiled = g_shader_compile_stats.num_compiled
+	g_shader_compile_stats.startup_time_ms = time.duration_milliseconds(
+		time.tick_since(startup_start),
+	)
+
+	log.infof(
+		"Created %d shaders in %.2f ms (%s start) - %d cache hits, %d compiled\n",
+		len(shader_refs),
+		g_shader_compile_stats.startup_time_ms,
+		g_shader_compile_stats.startup_num_compiled == 0 ? "warm" : "cold",
+		g_shader_compile_stats.startup_num_cache_hits,
+		g_shader_compile_stats.startup_num_compiled,
+	)
+
 	init_shader_files_watcher()
 
 	return backend_shader_init()
@@ -249,29 +264,72 @@ shader_init :: proc() -> bool {
 //---------------------------------------------------------------------------//
 
 shader_deinit :: proc() {
+	common.directory_watcher_deinit(&INTERNAL.shaders_dir_watcher)
+	shader_compiler_deinit()
 	backend_shader_deinit()
 }
 
 //---------------------------------------------------------------------------//
 
 shader_create :: proc(p_shader_ref: ShaderRef) -> bool {
-	shader := &g_resources.shaders[shader_get_idx(p_shader_ref)]
-	shader.hash = calculate_hash_for_shader(&shader.desc)
-	assert((shader.hash in INTERNAL.shader_by_hash) == false)
+	shader_created: [1]bool
+	return shader_create_many({p_shader_ref}, shader_created[:])
+}
+
+//---------------------------------------------------------------------------//
+
+// Creates the shaders, compiling the ones that aren't cached in parallel, so prefer it over
+// calling shader_create() for each of them. p_out_created tells which of the shaders were
+// created, the ones that failed are left allocated. Returns false if any of them failed.
+shader_create_many :: proc(p_shader_refs: []ShaderRef, p_out_created: []bool) -> bool {
+	assert(len(p_shader_refs) == len(p_out_created))
 
 	temp_arena: common.Arena
-	common.temp_arena_init(&temp_arena, common.MEGABYTE)
+	common.temp_arena_init(&temp_arena)
 	defer common.arena_delete(temp_arena)
 
-	shader_code := shader_compile(p_shader_ref, temp_arena.allocator) or_return
+	shader_code_arena: common.Arena
+	common.temp_arena_init(&shader_code_arena, common.MEGABYTE)
+	defer common.arena_delete(shader_code_arena)
 
-	if backend_shader_create(p_shader_ref, shader_code) == false {
-		shader_destroy(p_shader_ref)
-		return false
+	shader_bin_paths := shader_compile_many(p_shader_refs, temp_arena.allocator)
+
+	all_created := true
+
+	for shader_ref, i in p_shader_refs {
+		p_out_created[i] = false
+
+		shader := &g_resources.shaders[shader_get_idx(shader_ref)]
+		shader.hash = calculate_hash_for_shader(&shader.desc)
+		assert((shader.hash in INTERNAL.shader_by_hash) == false)
+
+		if len(shader_bin_paths[i]) == 0 {
+			all_created = false
+			continue
+		}
+
+		common.arena_reset(shader_code_arena)
+
+		shader_code, read_ok := os.read_entire_file(
+			shader_bin_paths[i],
+			shader_code_arena.allocator,
+		)
+		if read_ok == false {
+			log.errorf("Failed to read shader code %s\n", shader_bin_paths[i])
+			all_created = false
+			continue
+		}
+
+		if backend_shader_create(shader_ref, shader_code) == false {
+			all_created = false
+			continue
+		}
+
+		INTERNAL.shader_by_hash[shader.hash] = shader_ref
+		p_out_created[i] = true
 	}
 
-	INTERNAL.shader_by_hash[shader.hash] = p_shader_ref
-	return true
+	return all_created
 }
 
 //---------------------------------------------------------------------------//
@@ -297,6 +355,9 @@ shader_destroy :: proc(p_ref: ShaderRef) {
 	for feature in shader.desc.features {
 		delete(feature, G_RENDERER_ALLOCATORS.resource_allocator)
 	}
+	for included_file in shader.included_files {
+		delete(included_file, G_RENDERER_ALLOCATORS.resource_allocator)
+	}
 	delete(shader.included_files, G_RENDERER_ALLOCATORS.resource_allocator)
 	delete(shader.desc.features, G_RENDERER_ALLOCATORS.resource_allocator)
 	common.ref_free(&g_resource_refs.shaders, p_ref)
@@ -342,28 +403,15 @@ calculate_hash_for_shader :: proc(p_shader_desc: ^ShaderDesc) -> u32 {
 
 @(private = "file")
 init_shader_files_watcher :: proc() -> bool {
-
-	temp_arena: common.Arena
-	common.temp_arena_init(&temp_arena)
-	defer common.arena_delete(temp_arena)
-
-	shaders_dir_path := windows.utf8_to_wstring(
-		"app_data/renderer/assets/shaders",
-		temp_arena.allocator,
-	)
-
-	INTERNAL.shaders_dir_handle = windows.CreateFileW(
-		shaders_dir_path,
-		windows.FILE_LIST_DIRECTORY,
-		windows.FILE_SHARE_READ | windows.FILE_SHARE_WRITE | windows.FILE_SHARE_DELETE,
-		nil,
-		windows.OPEN_EXISTING,
-		windows.FILE_FLAG_BACKUP_SEMANTICS | windows.FILE_FLAG_OVERLAPPED,
-		nil,
-	)
-
-	INTERNAL.windows_event_handle = windows.CreateEventW(nil, false, false, nil)
-
+	if common.directory_watcher_init(
+		   &INTERNAL.shaders_dir_watcher,
+		   "app_data/renderer/assets/shaders",
+		   G_RENDERER_ALLOCATORS.main_allocator,
+	   ) ==
+	   false {
+		log.warn("Failed to watch the shaders dir, hot reload is disabled")
+		return false
+	}
 	return true
 }
 
@@ -373,122 +421,84 @@ init_shader_files_watcher :: proc() -> bool {
 @(private)
 shader_update :: proc() {
 
-	windows.ResetEvent(INTERNAL.windows_event_handle)
-
-	overlapped := windows.OVERLAPPED {
-		hEvent = INTERNAL.windows_event_handle,
-	}
-
-	// Read directory changes
-	change_buffer: [1024]windows.BYTE
-	success := windows.ReadDirectoryChangesW(
-		INTERNAL.shaders_dir_handle,
-		&change_buffer[0],
-		len(change_buffer),
-		true,
-		windows.FILE_NOTIFY_CHANGE_LAST_WRITE,
-		nil,
-		&overlapped,
-		nil,
-	)
-	if success == false {
-		return
-	}
-
 	temp_arena: common.Arena
 	common.temp_arena_init(&temp_arena, common.MEGABYTE)
 	defer common.arena_delete(temp_arena)
 
-	result := windows.WaitForSingleObject(overlapped.hEvent, 0)
-	if result == windows.WAIT_FAILED {
-		log.warn("Failed to wait for shaders dir changes")
-		return
-	}
-
-	if result == windows.WAIT_OBJECT_0 {
-
-		bytes_transferred: windows.DWORD
-		windows.GetOverlappedResult(
-			INTERNAL.shaders_dir_handle,
-			&overlapped,
-			&bytes_transferred,
-			false,
-		)
-		if bytes_transferred == 0 {
-			return
-		}
-
-		event := (^windows.FILE_NOTIFY_INFORMATION)(&change_buffer[0])
-
-		for {
-
-			common.arena_reset(temp_arena)
-
-			file_name_len := int(event.file_name_length)
-			file_name_w := windows.wstring(&event.file_name[0])
-			file_name, err := windows.wstring_to_utf8(
-				file_name_w,
-				(file_name_len / size_of(windows.wchar_t)),
-				temp_arena.allocator,
-			)
-
-			if err == nil {
-				shader_reload(file_name)
-			}
-
-			if event.next_entry_offset == 0 {
-				break
-			}
+	changed_files := common.directory_watcher_poll(
+		&INTERNAL.shaders_dir_watcher,
+		temp_arena.allocator,
+	)
 
-			event = (^windows.FILE_NOTIFY_INFORMATION)(
-				uintptr(event) + uintptr(event.next_entry_offset),
-			)
-		}
+	if len(changed_files) > 0 {
+		shader_reload(changed_files)
 	}
-
-	windows.CancelIo(INTERNAL.shaders_dir_handle)
 }
 
 //--------------------------------------------------------------------------//
 
 @(private = "file")
-shader_reload :: proc(p_shader_file_name: string) {
+shader_reload :: proc(p_changed_files: []string) {
 
 	temp_arena: common.Arena
 	common.temp_arena_init(&temp_arena, common.MEGABYTE)
 	defer common.arena_delete(temp_arena)
 
-	if strings.contains(p_shader_file_name, "incl") {
-		// ignore include files
-		return
-	}
-
-	shader_name := common.create_name(p_shader_file_name)
+	shader_code_arena: common.Arena
+	common.temp_arena_init(&shader_code_arena, common.MEGABYTE)
+	defer common.arena_delete(shader_code_arena)
 
-	// Find the shader for this file name
+	// Find the shaders that use any of the changed files, either directly or through an include
+	shader_refs := make([dynamic]ShaderRef, temp_arena.allocator)
 	for i in 0 ..< g_resource_refs.shaders.alive_count {
-
-		common.arena_reset(temp_arena)
-
 		shader_ref := g_resource_refs.shaders.alive_refs[i]
 		shader := &g_resources.shaders[shader_get_idx(shader_ref)]
 
-		if shader_name != shader.desc.file_path {
-			continue
+		for changed_file in p_changed_files {
+			if common.get_string(shader.desc.file_path) == changed_file ||
+			   slice.contains(shader.included_files, changed_file) {
+				append(&shader_refs, shader_ref)
+				break
+			}
 		}
+	}
+
+	if len(shader_refs) == 0 {
+		return
+	}
 
-		shader_code, ok := shader_compile(shader_ref, temp_arena.allocator)
+	shader_bin_paths := shader_compile_many(shader_refs[:], temp_arena.allocator)
+
+	// Pipelines referencing the reloaded shaders, recreated together once all of them are reloaded
+	graphics_pipeline_refs := make([dynamic]GraphicsPipelineRef, temp_arena.allocator)
+	compute_pipeline_refs := make([dynamic]ComputePipelineRef, temp_arena.allocator)
+
+	for shader_ref, i in shader_refs {
+
+		common.arena_reset(shader_code_arena)
+
+		shader := &g_resources.shaders[shader_get_idx(shader_ref)]
+		shader_file_name := common.get_string(shader.desc.file_path)
 
-		if ok == false {
+		if len(shader_bin_paths[i]) == 0 {
 			log.warnf(
 				"Failed to hot reload shader '%s' - the source probably contains errors\n",
-				p_shader_file_name,
+				shader_file_name,
 			)
-			return
+			continue
+		}
+
+		shader_code, read_ok := os.read_entire_file(
+			shader_bin_paths[i],
+			shader_code_arena.allocator,
+		)
+		if read_ok == false {
+			log.warnf("Failed to read shader code %s\n", shader_bin_paths[i])
+			continue
 		}
 
 		if backend_shader_reload(shader_ref, shader_code) == false {
-			return
+			continue
 		}
 
 		// Find all pipelines referencing this shader
@@ -500,8 +510,7 @@ shader_reload :: proc(p_shader_file_name: string) {
 				pipeline := &g_resources.compute_pipelines[compute_pipeline_get_idx(pipeline_ref)]
 
 				if pipeline.desc.compute_shader_ref == shader_ref {
-					backend_compute_pipeline_destroy(pipeline_ref)
-					backend_compute_pipeline_create(pipeline_ref)
+					append(&compute_pipeline_refs, pipeline_ref)
 					num_reloaded_pipelines += 1
 				}
 			}
@@ -510,180 +519,29 @@ shader_reload :: proc(p_shader_file_name: string) {
 				pipeline_ref := g_resource_refs.graphics_pipelines.alive_refs[j]
 				pipeline := &g_resources.graphics_pipelines[graphics_pipeline_get_idx(pipeline_ref)]
 
-				if pipeline.desc.vert_shader_ref == shader_ref ||
-				   pipeline.desc.frag_shader_ref == shader_ref {
-					backend_graphics_pipeline_destroy(pipeline_ref)
-					backend_graphics_pipeline_create(pipeline_ref)
-					num_reloaded_pipelines += 1
+				if pipeline.desc.vert_shader_ref != shader_ref &&
+				   pipeline.desc.frag_shader_ref != shader_ref {
+					continue
 				}
+
+				// Both of the shaders might have been reloaded
+				if slice.contains(graphics_pipeline_refs[:], pipeline_ref) == false {
+					append(&graphics_pipeline_refs, pipeline_ref)
+				}
+				num_reloaded_pipelines += 1
 			}
 		}
 
 		log.infof(
 			"Shader '%s' reloaded, along with %d pipelines\n",
-			p_shader_file_name,
+			common.get_string(shader.name),
 			num_reloaded_pipelines,
 		)
 	}
-}
-
-//--------------------------------------------------------------------------//
-
-@(private = "file")
-shader_compile :: proc(
-	p_shader_ref: ShaderRef,
-	p_shader_code_allocator: mem.Allocator,
-) -> (
-	[]byte,
-	bool,
-) {
-
-	temp_arena: common.Arena
-	common.temp_arena_init(&temp_arena)
-	defer common.arena_delete(temp_arena)
-
-	shader := &g_resources.shaders[shader_get_idx(p_shader_ref)]
-
-	shader_stage := ""
-	shader_suffix := ""
-	switch shader.desc.stage {
-	case .Vertex:
-		shader_stage = "vert"
-		shader_suffix = "vert.hlsl"
-	case .Pixel:
-		shader_stage = "pix"
-		shader_suffix = "pix.hlsl"
-	case .Compute:
-		shader_stage = "comp"
-		shader_stage = "comp.hlsl"
-	case:
-		assert(false, "Unsupported shader type")
-	}
-
-	shader_path := common.get_string(shader.desc.file_path)
-	shader_bin_path_base := shader_path
-
-	// Vertex and pixel shaders shader the same file, so we add the stage
-	// suffix here to compile the shader with differnt entry points
-	if !strings.contains(shader_path, shader_stage) {
-		shader_bin_path_base, _ = strings.replace(
-			shader_path,
-			"hlsl",
-			shader_suffix,
-			1,
-			temp_arena.allocator,
-		)
-	}
-
-	shader_src_path := common.aprintf(
-		temp_arena.allocator,
-		"app_data/renderer/assets/shaders/%s",
-		shader_path,
-	)
-
-	// Find out the last time the shader was modified. It's used to determine
-	// if the compiled version is up to date
-	last_shader_write_time := common.get_last_file_write_time(shader_src_path)
-
-	// @TODO enable once we also keep track of the changes to include files
-	shader_cache_enabled := false
-
-	shader_bin_path := common.aprintf(
-		temp_arena.allocator,
-		"app_data/renderer/assets/shaders/%s/%s-%d.%s",
-		BACKEND_COMPILED_SHADERS_FOLDER,
-		shader_bin_path_base,
-		last_shader_write_time._nsec,
-		BACKEND_COMPILED_SHADERS_EXTENSION,
-	)
-
-	if !os.exists(shader_bin_path) || !shader_cache_enabled {
-
-		// Add defines for macros
-		shader_defines := ""
-		shader_defines_log := ""
-		for feature in shader.desc.features {
-			shader_defines = common.aprintf(
-				temp_arena.allocator,
-				"%s -D %s",
-				shader_defines,
-				feature,
-			)
-			shader_defines_log = common.aprintf(
-				temp_arena.allocator,
-				"%s\n%s\n",
-				shader_defines_log,
-				feature,
-			)
-		}
-
-		log.infof("Compiling shader %s with features %s\n", shader_src_path, shader_defines_log)
-
-		if backend_compile_shader(
-			   shader_src_path,
-			   shader_bin_path,
-			   shader.desc.stage,
-			   shader_defines,
-			   shader.desc.custom_entry_point,
-		   ) ==
-		   false {
-			return nil, false
-		}
-	}
-
-	// Remove old version of the shader binary
-	shader_bins_search_path := common.aprintf(
-		temp_arena.allocator,
-		"app_data/renderer/assets/shaders/%s/%s-*",
-		BACKEND_COMPILED_SHADERS_FOLDER,
-		shader_bin_path_base,
-	)
-
-	path_w := windows.utf8_to_wstring(shader_bins_search_path, temp_arena.allocator)
-
-	find_file_data := windows.WIN32_FIND_DATAW{}
-	file_handle := windows.FindFirstFileW(path_w, &find_file_data)
-
-	timestamp_str := common.aprintf(temp_arena.allocator, "%i", last_shader_write_time._nsec)
-
-	// Loop over all of the files in the directory whose name matches the pattern
-	if file_handle != windows.INVALID_HANDLE_VALUE {
-
-		path_buffer := make([]byte, windows.MAX_PATH, temp_arena.allocator)
-
-		for {
-
-			path_len := utf16.decode_to_utf8(path_buffer, find_file_data.cFileName[:])
-			path := string(path_buffer[:path_len])
-
-			// Delete if it's not the latest version
-			if !strings.contains(path, timestamp_str) {
-
-				delete_path := common.aprintf(
-					temp_arena.allocator,
-					"app_data/renderer/assets/shaders/%s/%s",
-					BACKEND_COMPILED_SHADERS_FOLDER,
-					path,
-				)
-
-				os.remove(delete_path)
-			}
-
-
-			if windows.FindNextFileW(file_handle, &find_file_data) == false {
-				break
-			}
-		}
-
-	}
 
-	// Read the shader binary
-	shader_data, read_success := os.read_entire_file(shader_bin_path, p_shader_code_allocator)
-	if read_success == false {
-		log.errorf("Failed to read shader code %s\n", shader_bin_path)
-		return nil, false
+	if pipelines_recreate(graphics_pipeline_refs[:], compute_pipeline_refs[:]) == false {
+		log.warn("Failed to recreate some of the pipelines after the shader reload\n")
 	}
-	return shader_data, true
 }
 
 //--------------------------------------------------------------------------//
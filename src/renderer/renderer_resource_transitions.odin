@@ -37,8 +37,14 @@ transition_binding_resources :: proc(
 	p_bindings: []Binding,
 	p_pipeline_type: PipelineType,
 	p_async_compute: bool = false,
+	p_async_compute_stage := AsyncComputeStage.Main,
 ) {
-	backend_transition_binding_resources(p_bindings, p_pipeline_type, p_async_compute)
+	backend_transition_binding_resources(
+		p_bindings,
+		p_pipeline_type,
+		p_async_compute,
+		p_async_compute_stage,
+	)
 }
 
 //---------------------------------------------------------------------------//
@@ -68,7 +74,20 @@ transition_render_outputs :: proc(p_render_outputs: []RenderPassOutput) {
 	}
 
 
-	backend_transition_binding_resources(output_image_bindings, .Graphics, false)
+	backend_transition_binding_resources(output_image_bindings, .Graphics, false, .Main)
+}
+
+//---------------------------------------------------------------------------//
+
+// Makes the memory written in p_src_stages visible to p_dst_stages. Used for buffers that are both
+// written and consumed on the GPU, e.g. indirect draw arguments, where per-buffer barriers don't buy anything
+@(private)
+transition_memory :: proc(
+	p_cmd_buff_ref: CommandBufferRef,
+	p_src_stages: PipelineStageFlags,
+	p_dst_stages: PipelineStageFlags,
+) {
+	backend_transition_memory(p_cmd_buff_ref, p_src_stages, p_dst_stages)
 }
 
 //---------------------------------------------------------------------------//
@@ -0,0 +1,424 @@
+package renderer
+
+//---------------------------------------------------------------------------//
+
+// Compiled shaders are cached under a content key - a hash of everything the compiler
+// output depends on:
+// - the source of the shader and of all of the files it includes, directly or not
+// - the defines, the stage and the entry point
+// - the compiler version along with the arguments it's always invoked with
+// Shaders whose key is already in the cache are loaded without invoking the compiler, so a warm
+// start doesn't compile anything, while an edit to any of the files a shader depends on produces
+// a new key. The cache misses are compiled in parallel, each job runs its own compiler process.
+
+//---------------------------------------------------------------------------//
+
+import "core:hash"
+import "core:log"
+import "core:mem"
+import "core:os"
+import "core:strings"
+import "core:time"
+
+import "../common"
+
+//---------------------------------------------------------------------------//
+
+@(private)
+g_shader_compile_stats: struct {
+	// Set once the shaders from the shaders config were created
+	startup_num_cache_hits: u32,
+	startup_num_compiled:   u32,
+	startup_time_ms:        f64,
+	// Accumulated over the whole run, including the material passes and hot reloads
+	num_cache_hits:         u32,
+	num_compiled:           u32,
+	num_failed:             u32,
+	compile_time_ms:        f64,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+INTERNAL: struct {
+	// Compiler version and fixed arguments, part of every content key
+	compiler_id: string,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+ShaderInclude :: struct {
+	// Path as written in the source, or the name of the macro that expands to it
+	path:     string,
+	is_macro: bool,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+ShaderSourceFile :: struct {
+	hash:     u64,
+	includes: []ShaderInclude,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+ShaderCompileJob :: struct {
+	src_path:           string,
+	bin_path:           string,
+	// The compiler writes here first and the file is renamed once it's complete,
+	// so an interrupted compile doesn't leave a broken entry in the cache
+	tmp_bin_path:       string,
+	stage:              ShaderStage,
+	defines:            string,
+	custom_entry_point: common.Name,
+	success:            bool,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+shader_compiler_init :: proc() -> bool {
+	cache_dir := BASE_SHADERS_PATH + BACKEND_COMPILED_SHADERS_FOLDER
+	if os.exists(cache_dir) == false {
+		os.make_directory(cache_dir, 0)
+	}
+
+	INTERNAL.compiler_id = backend_shader_compiler_get_id(G_RENDERER_ALLOCATORS.main_allocator)
+	log.infof("Shader compiler: %s\n", INTERNAL.compiler_id)
+
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+shader_compiler_deinit :: proc() {
+	delete(INTERNAL.compiler_id, G_RENDERER_ALLOCATORS.main_allocator)
+}
+
+//---------------------------------------------------------------------------//
+
+// Returns the paths of the compiled shaders, served from the cache when possible, the rest is
+// compiled in parallel. The path is empty when the shader failed to compile.
+// Also updates the include closure of the shaders, used by the hot reload.
+@(private)
+shader_compile_many :: proc(p_shader_refs: []ShaderRef, p_allocator: mem.Allocator) -> []string {
+
+	temp_arena: common.Arena
+	common.temp_arena_init(&temp_arena, common.MEGABYTE * 4)
+	defer common.arena_delete(temp_arena)
+
+	start := time.tick_now()
+
+	bin_paths := make([]string, len(p_shader_refs), p_allocator)
+	compile_jobs := make([dynamic]ShaderCompileJob, temp_arena.allocator)
+	compile_job_shader_indices := make([dynamic]int, temp_arena.allocator)
+
+	// Sources shared by the shaders, e.g. common include files, are only read and hashed once
+	source_files := make(map[string]ShaderSourceFile, 64, temp_arena.allocator)
+
+	for shader_ref, i in p_shader_refs {
+		shader := &g_resources.shaders[shader_get_idx(shader_ref)]
+		shader_path := common.get_string(shader.desc.file_path)
+
+		// Gather the include closure
+		closure := make([dynamic]string, temp_arena.allocator)
+		append(&closure, shader_path)
+
+		for file_idx := 0; file_idx < len(closure); file_idx += 1 {
+			source_file := get_source_file(&source_files, closure[file_idx], temp_arena.allocator)
+			for include in source_file.includes {
+				include_path := resolve_include(
+					closure[file_idx],
+					include,
+					shader.desc.features,
+					temp_arena.allocator,
+				)
+				if len(include_path) == 0 {
+					continue
+				}
+
+				is_visited := false
+				for path in closure {
+					if path == include_path {
+						is_visited = true
+						break
+					}
+				}
+				if is_visited == false {
+					append(&closure, include_path)
+				}
+			}
+		}
+
+		shader_set_included_files(shader, closure[1:])
+
+		// Calculate the content key
+		key_builder := strings.builder_make(temp_arena.allocator)
+		strings.write_string(&key_builder, INTERNAL.compiler_id)
+		strings.write_int(&key_builder, int(shader.desc.stage))
+		strings.write_string(&key_builder, common.get_string(shader.desc.custom_entry_point))
+		for feature in shader.desc.features {
+			strings.write_byte(&key_builder, 0)
+			strings.write_string(&key_builder, feature)
+		}
+		for path in closure {
+			strings.write_byte(&key_builder, 0)
+			strings.write_string(&key_builder, path)
+			strings.write_u64(&key_builder, source_files[path].hash, 16)
+		}
+		cache_key := hash.fnv64a(key_builder.buf[:])
+
+		bin_paths[i] = common.aprintf(
+			p_allocator,
+			"%s%s/%016x.%s",
+			BASE_SHADERS_PATH,
+			BACKEND_COMPILED_SHADERS_FOLDER,
+			cache_key,
+			BACKEND_COMPILED_SHADERS_EXTENSION,
+		)
+
+		// Remove the version that was superseded by an edit
+		if shader.cache_key != 0 && shader.cache_key != cache_key {
+			os.remove(
+				common.aprintf(
+					temp_arena.allocator,
+					"%s%s/%016x.%s",
+					BASE_SHADERS_PATH,
+					BACKEND_COMPILED_SHADERS_FOLDER,
+					shader.cache_key,
+					BACKEND_COMPILED_SHADERS_EXTENSION,
+				),
+			)
+		}
+		shader.cache_key = cache_key
+
+		if os.exists(bin_paths[i]) {
+			g_shader_compile_stats.num_cache_hits += 1
+			continue
+		}
+
+		defines := ""
+		for feature in shader.desc.features {
+			defines = common.aprintf(temp_arena.allocator, "%s -D %s", defines, feature)
+		}
+
+		append(
+			&compile_jobs,
+			ShaderCompileJob {
+				src_path = common.aprintf(
+					temp_arena.allocator,
+					"%s%s",
+					BASE_SHADERS_PATH,
+					shader_path,
+				),
+				bin_path = bin_paths[i],
+				tmp_bin_path = common.aprintf(temp_arena.allocator, "%s.tmp", bin_paths[i]),
+				stage = shader.desc.stage,
+				defines = defines,
+				custom_entry_point = shader.desc.custom_entry_point,
+			},
+		)
+		append(&compile_job_shader_indices, i)
+	}
+
+	if len(compile_jobs) > 0 {
+		common.jobs_parallel_for(u32(len(compile_jobs)), 1, shader_compile_job_run, &compile_jobs)
+	}
+
+	for compile_job, i in compile_jobs {
+		if compile_job.success {
+			g_shader_compile_stats.num_compiled += 1
+			continue
+		}
+
+		g_shader_compile_stats.num_failed += 1
+		bin_paths[compile_job_shader_indices[i]] = ""
+
+		shader_ref := p_shader_refs[compile_job_shader_indices[i]]
+		g_resources.shaders[shader_get_idx(shader_ref)].cache_key = 0
+	}
+
+	elapsed_ms := time.duration_milliseconds(time.tick_since(start))
+	g_shader_compile_stats.compile_time_ms += elapsed_ms
+
+	if len(compile_jobs) > 0 {
+		log.infof(
+			"Compiled %d shaders in %.2f ms, %d were cached\n",
+			len(compile_jobs),
+			elapsed_ms,
+			len(p_shader_refs) - len(compile_jobs),
+		)
+	}
+
+	return bin_paths
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+shader_compile_job_run :: proc(p_start: u32, p_end: u32, p_user_data: rawptr) {
+	compile_jobs := (^[dynamic]ShaderCompileJob)(p_user_data)
+
+	for i in p_start ..< p_end {
+		compile_job := &compile_jobs[i]
+
+		log.infof(
+			"Compiling shader %s with features%s\n",
+			compile_job.src_path,
+			compile_job.defines,
+		)
+
+		if backend_compile_shader(
+			   compile_job.src_path,
+			   compile_job.tmp_bin_path,
+			   compile_job.stage,
+			   compile_job.defines,
+			   compile_job.custom_entry_point,
+		   ) ==
+		   false {
+			os.remove(compile_job.tmp_bin_path)
+			continue
+		}
+
+		if os.rename(compile_job.tmp_bin_path, compile_job.bin_path) != 0 {
+			log.warnf("Failed to move compiled shader to %s\n", compile_job.bin_path)
+			os.remove(compile_job.tmp_bin_path)
+			continue
+		}
+
+		compile_job.success = true
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+// Reads and hashes the file, parsing the include directives along the way
+@(private = "file")
+get_source_file :: proc(
+	p_source_files: ^map[string]ShaderSourceFile,
+	p_path: string,
+	p_allocator: mem.Allocator,
+) -> ShaderSourceFile {
+	if source_file, found := p_source_files[p_path]; found {
+		return source_file
+	}
+
+	source_file: ShaderSourceFile
+
+	full_path := common.aprintf(p_allocator, "%s%s", BASE_SHADERS_PATH, p_path)
+	source, read_ok := os.read_entire_file(full_path, p_allocator)
+	if read_ok == false {
+		// The compiler reports the missing file, keep the key stable in the meantime
+		p_source_files[p_path] = source_file
+		return source_file
+	}
+
+	source_file.hash = hash.fnv64a(source)
+
+	includes := make([dynamic]ShaderInclude, p_allocator)
+
+	source_str := string(source)
+	for line in strings.split_lines_iterator(&source_str) {
+		directive := strings.trim_left_space(line)
+		if strings.has_prefix(directive, "#include") == false {
+			continue
+		}
+		directive = strings.trim_space(directive[len("#include"):])
+		if len(directive) == 0 {
+			continue
+		}
+
+		switch directive[0] {
+		case '"', '<':
+			closing := directive[0] == '"' ? "\"" : ">"
+			if end := strings.index(directive[1:], closing); end > 0 {
+				append(&includes, ShaderInclude{path = directive[1:end + 1]})
+			}
+		case:
+			macro_end := strings.index_any(directive, " \t/")
+			if macro_end < 0 {
+				macro_end = len(directive)
+			}
+			append(&includes, ShaderInclude{path = directive[:macro_end], is_macro = true})
+		}
+	}
+
+	source_file.includes = includes[:]
+	p_source_files[p_path] = source_file
+
+	return source_file
+}
+
+//---------------------------------------------------------------------------//
+
+// Returns the path of the included file relative to the shaders dir. Includes are looked up
+// next to the file that includes them first, then in the shaders dir, just like the compiler
+// does. Returns an empty string if the file doesn't exist.
+@(private = "file")
+resolve_include :: proc(
+	p_including_file_path: string,
+	p_include: ShaderInclude,
+	p_features: []string,
+	p_allocator: mem.Allocator,
+) -> string {
+	include_path := p_include.path
+
+	// The macros are passed as defines, e.g. MATERIAL_PASS_INCLUDE=\"material_opaque_pbr.hlsli\"
+	if p_include.is_macro {
+		include_path = ""
+		for feature in p_features {
+			if strings.has_prefix(feature, p_include.path) &&
+			   len(feature) > len(p_include.path) &&
+			   feature[len(p_include.path)] == '=' {
+				include_path = strings.trim(feature[len(p_include.path) + 1:], "\\\"")
+				break
+			}
+		}
+		if len(include_path) == 0 {
+			return ""
+		}
+	}
+
+	including_file_dir_end := strings.last_index_byte(p_including_file_path, '/') + 1
+	if including_file_dir_end > 0 {
+		including_file_dir := p_including_file_path[:including_file_dir_end]
+		relative_path := common.aprintf(p_allocator, "%s%s", including_file_dir, include_path)
+		if os.exists(common.aprintf(p_allocator, "%s%s", BASE_SHADERS_PATH, relative_path)) {
+			return relative_path
+		}
+	}
+
+	if os.exists(common.aprintf(p_allocator, "%s%s", BASE_SHADERS_PATH, include_path)) {
+		return include_path
+	}
+
+	return ""
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+shader_set_included_files :: proc(p_shader: ^ShaderResource, p_included_files: []string) {
+	for included_file in p_shader.included_files {
+		delete(included_file, G_RENDERER_ALLOCATORS.resource_allocator)
+	}
+	delete(p_shader.included_files, G_RENDERER_ALLOCATORS.resource_allocator)
+
+	p_shader.included_files = make(
+		[]string,
+		len(p_included_files),
+		G_RENDERER_ALLOCATORS.resource_allocator,
+	)
+	for included_file, i in p_included_files {
+		p_shader.included_files[i] = strings.clone(
+			included_file,
+			G_RENDERER_ALLOCATORS.resource_allocator,
+		)
+	}
+}
+
+//---------------------------------------------------------------------------//
@@ -5,6 +5,7 @@ package renderer
 //---------------------------------------------------------------------------//
 
 import "core:encoding/xml"
+import "core:fmt"
 import "core:log"
 import "core:math/linalg/glsl"
 import "core:mem"
@@ -23,6 +24,10 @@ BINDLESS_2D_IMAGES_COUNT :: 2048
 @(private)
 USE_VULKAN_BACKEND :: #config(USE_VULKAN_BACKEND, true)
 
+// Enables the Khronos validation layer, its errors are counted by get_num_validation_errors
+@(private)
+VULKAN_VALIDATION :: #config(NEAT_VULKAN_VALIDATION, false)
+
 //---------------------------------------------------------------------------//
 
 @(private)
@@ -62,7 +67,8 @@ MAX_RENDER_PASSES :: #config(MAX_RENDER_PASSES, 128)
 MAX_RENDER_PASS_INSTANCES :: #config(MAX_RENDER_PASSES, 128)
 MAX_GRAPHICS_PIPELINES :: #config(MAX_GRAPHICS_PIPELINES, 128)
 MAX_COMPUTE_PIPELINES :: #config(MAX_COMPUTE_PIPELINES, 128)
-MAX_COMMAND_BUFFERS :: #config(MAX_COMMAND_BUFFERS, 32)
+MAX_COMMAND_BUFFERS :: #config(MAX_COMMAND_BUFFERS, 128)
+MAX_SECONDARY_COMMAND_BUFFERS_PER_FRAME :: #config(MAX_SECONDARY_COMMAND_BUFFERS_PER_FRAME, 32)
 MAX_BIND_GROUP_LAYOUTS :: #config(MAX_BIND_GROUP_LAYOUTS, 32)
 MAX_BIND_GROUPS :: #config(MAX_BIND_GROUPS, 256)
 MAX_RENDER_TASKS :: #config(MAX_RENDER_TASKS, 64)
@@ -158,7 +164,9 @@ G_RENDERER: struct {
 	bindless_bind_group_ref:        BindGroupRef,
 	default_image_ref:              ImageRef,
 	debug_mode:                     bool,
+	is_headless:                    bool,
 	min_uniform_buffer_alignment:   u32,
+	min_storage_buffer_alignment:   u32,
 	blue_noise_image_ref:           ImageRef,
 	volumetric_noise_image_ref:     ImageRef,
 }
@@ -195,10 +203,29 @@ G_RENDERER_SETTINGS: struct {
 	taa_temporal_filter:                      bool,
 	taa_inverse_luminance_filter:             bool,
 	taa_luminance_difference_filter:          bool,
+	frustum_culling_enabled:                  bool,
+	gpu_culling_enabled:                      bool,
+	gpu_occlusion_culling_enabled:            bool,
+	parallel_command_buffer_recording:        bool,
+	lod_selection_enabled:                    bool,
+	// Largest allowed simplification error of the selected LOD, in pixels
+	lod_error_threshold:                      f32,
+	// Number of LODs coarser than the main view's ones to use for shadows
+	shadow_lod_bias:                          u32,
+	// Stream the mips of the textures on demand instead of keeping all of them resident
+	texture_streaming_enabled:                bool,
+	// VRAM available for the mips of the streamed textures, in megabytes
+	texture_streaming_budget_mb:              u32,
+	// Number of frames recorded by the profiler capture button in the debug UI
+	profiler_capture_num_frames:              u32,
 }
 
 InitOptions :: struct {
 	using backend_options: BackendInitOptions,
+	// Renders into offscreen images instead of the window's swapchain and skips the UI
+	headless:              bool,
+	// Resolution of the offscreen images that stand in for the swap images in headless mode
+	headless_resolution:   glsl.uvec2,
 }
 
 //---------------------------------------------------------------------------//
@@ -282,9 +309,21 @@ init :: proc(p_options: InitOptions) -> bool {
 	G_RENDERER_SETTINGS.taa_temporal_filter = true
 	G_RENDERER_SETTINGS.taa_inverse_luminance_filter = true
 	G_RENDERER_SETTINGS.taa_luminance_difference_filter = true
+	G_RENDERER_SETTINGS.frustum_culling_enabled = true
+	G_RENDERER_SETTINGS.gpu_culling_enabled = true
+	G_RENDERER_SETTINGS.gpu_occlusion_culling_enabled = true
+	G_RENDERER_SETTINGS.parallel_command_buffer_recording = true
+	G_RENDERER_SETTINGS.lod_selection_enabled = true
+	G_RENDERER_SETTINGS.lod_error_threshold = 1
+	G_RENDERER_SETTINGS.shadow_lod_bias = 1
+	G_RENDERER_SETTINGS.texture_streaming_enabled = true
+	G_RENDERER_SETTINGS.texture_streaming_budget_mb = 512
+	G_RENDERER_SETTINGS.profiler_capture_num_frames = 120
 
 	g_render_settings_data.taa.flags += {.Reset}
 
+	G_RENDERER.is_headless = p_options.headless
+
 	backend_init(p_options) or_return
 
 	shader_init() or_return
@@ -295,7 +334,9 @@ init :: proc(p_options: InitOptions) -> bool {
 	buffer_init()
 	mesh_init()
 	image_init() or_return
+	texture_streaming_init()
 	command_buffer_init(p_options) or_return
+	gpu_profiler_init() or_return
 	buffer_management_init() or_return
 	draw_command_init() or_return
 	compute_command_init() or_return
@@ -310,6 +351,8 @@ init :: proc(p_options: InitOptions) -> bool {
 		buffer_upload_init(buffer_upload_options) or_return
 	}
 
+	transient_buffer_init() or_return
+
 	// Init deferred resource deletion
 	{
 		using g_deferred_resource_delete_context
@@ -371,6 +414,8 @@ init :: proc(p_options: InitOptions) -> bool {
 		}
 	}
 
+	async_compute_init() or_return
+
 	// Create bind group layout for uniforms
 	{
 		// Bind group layout creation
@@ -529,6 +574,8 @@ init :: proc(p_options: InitOptions) -> bool {
 	material_type_init() or_return
 	material_instance_init() or_return
 	mesh_instance_init() or_return
+	mesh_batches_init()
+	gpu_culling_init() or_return
 
 	uniform_buffer_init()
 	init_jobs() or_return
@@ -570,15 +617,15 @@ init :: proc(p_options: InitOptions) -> bool {
 			G_RENDERER.uniforms_bind_group_ref,
 			[]Binding {
 				InputBufferBinding {
-					buffer_ref = g_uniform_buffers.transient_buffer.buffer_ref,
+					buffer_ref = g_uniform_buffers.transient_buffer_ref,
 					size = size_of(g_per_frame_data),
 				},
 				InputBufferBinding {
-					buffer_ref = g_uniform_buffers.transient_buffer.buffer_ref,
+					buffer_ref = g_uniform_buffers.transient_buffer_ref,
 					size = size_of(PerViewData),
 				},
 				InputBufferBinding {
-					buffer_ref = g_uniform_buffers.transient_buffer.buffer_ref,
+					buffer_ref = g_uniform_buffers.transient_buffer_ref,
 					size = size_of(g_render_settings_data),
 				},
 			},
@@ -606,7 +653,9 @@ init :: proc(p_options: InitOptions) -> bool {
 	g_render_camera.far_plane = 10000
 	g_render_camera.fov = 45.0
 
-	ui_init() or_return
+	if G_RENDERER.is_headless == false {
+		ui_init() or_return
+	}
 
 	return true
 }
@@ -638,7 +687,12 @@ update :: proc(p_dt: f32) {
 	}
 
 	common.arena_reset_all()
-	backend_wait_for_frame_resources()
+	{
+		common.profiler_scope("WaitForFrameResources")
+		backend_wait_for_frame_resources()
+	}
+	gpu_profiler_begin_frame()
+	transient_buffer_begin_frame()
 
 	process_deferred_resource_deletes()
 
@@ -646,19 +700,27 @@ update :: proc(p_dt: f32) {
 
 	cmd_buff_ref := get_frame_cmd_buffer_ref()
 	command_buffer_begin(cmd_buff_ref)
+	async_compute_begin_frame()
+
+	// Covers the whole frame, so the profiler shows the total GPU time
+	gpu_debug_region_begin(cmd_buff_ref, "RendererFrame")
 
 	if get_frame_id() == 0 {
 		run_initial_frame_tasks()
 	}
 
 	backend_begin_frame()
-	ui_begin_frame()
+	if G_RENDERER.is_headless == false {
+		ui_begin_frame()
+	}
 
 	buffer_upload_finalize_finished_uploads()
 	image_finalize_finished_uploads()
 
 	image_upload_begin_frame()
 	buffer_upload_begin_frame()
+	render_graph_begin_frame()
+	command_buffer_begin_frame()
 
 	buffer_upload_run_last_frame_requests()
 	image_update_bindless_array()
@@ -667,6 +729,12 @@ update :: proc(p_dt: f32) {
 
 	material_instance_update_dirty_materials()
 	mesh_instance_update()
+	buffer_upload_flush_coalesced_requests()
+	mesh_batches_update()
+	texture_streaming_update()
+	gpu_culling_update()
+
+	culling_reset_stats()
 
 	// Skip this on first frame, as initial resources are being loaded
 	if get_frame_id() > 0 {
@@ -674,15 +742,24 @@ update :: proc(p_dt: f32) {
 
 		g_render_settings_data.taa.flags -= {.Reset}
 
-		draw_debug_ui(p_dt)
+		if G_RENDERER.is_headless == false {
+			draw_debug_ui(p_dt)
+		}
 	}
 
-	ui_submit()
+	if G_RENDERER.is_headless == false {
+		ui_submit()
+	}
 
 	backend_post_render()
 
-	command_buffer_end(cmd_buff_ref)
+	// The async compute tasks could've split the frame into two graphics command buffers,
+	// the region ends in the second one
+	gpu_debug_region_end(get_frame_cmd_buffer_ref())
+	command_buffer_end(get_frame_cmd_buffer_ref())
+	async_compute_end_frame()
 
+	gpu_profiler_submit_frame()
 	submit_current_frame()
 	free_all(get_frame_allocator())
 
@@ -760,11 +837,16 @@ deinit :: proc() {
 	context.allocator = G_RENDERER_ALLOCATORS.main_allocator
 	context.logger = INTERNAL.logger
 
-	ui_shutdown()
+	if G_RENDERER.is_headless == false {
+		ui_shutdown()
+	}
 
+	gpu_profiler_deinit()
+	async_compute_deinit()
 	pipeline_deinit()
 	shader_deinit()
 	render_task_deinit()
+	render_graph_deinit()
 	// @TODO deinit_bind_groups()
 	// @TODO deinit_pipeline_layouts()
 	// @TODOdeinit_pipelines()
@@ -772,12 +854,18 @@ deinit :: proc() {
 	// @TODO mesh_deinit()
 	// @TODO debuffer_init()
 	// @TODO decommand_buffer_init(p_options)
-	render_task_deinit()
 	deinit_backend()
 }
 
 //---------------------------------------------------------------------------//
 
+// Number of the errors reported by the validation layer so far, always 0 when it's disabled
+get_num_validation_errors :: proc() -> u32 {
+	return backend_get_num_validation_errors()
+}
+
+//---------------------------------------------------------------------------//
+
 WindowResizedEvent :: struct {
 	windowID: u32, //SDL2 window id
 }
@@ -794,6 +882,10 @@ handler_on_window_resized :: proc(p_event: WindowResizedEvent) {
 
 @(private)
 get_frame_cmd_buffer_ref :: proc() -> CommandBufferRef {
+	// The graphics work recorded after the async compute tasks has its own command buffer
+	if async_compute_is_graphics_split() {
+		return async_compute_get_post_graphics_cmd_buffer_ref()
+	}
 	return G_RENDERER.primary_cmd_buffer_ref[get_frame_idx()]
 }
 
@@ -823,8 +915,21 @@ load_renderer_config :: proc() -> bool {
 	G_RENDERER.config.render_resolution.x = render_width
 	G_RENDERER.config.render_resolution.y = render_height
 
+	// Has to be compiled first, it decides which images are aliased and which tasks are culled
+	if render_graph_compile(doc) == false {
+		log.error("Failed to compile the render graph\n")
+		return false
+	}
+
 	renderer_config_image_creates(doc)
+
+	// The render tasks create their pipelines in one batch, so they're compiled in parallel
+	pipeline_batch_begin()
 	renderer_config_load_render_tasks(doc)
+	if pipeline_batch_end() == false {
+		log.error("Failed to create the render task pipelines\n")
+		return false
+	}
 
 	return true
 }
@@ -838,6 +943,13 @@ renderer_config_image_creates :: proc(p_doc: ^xml.Document) -> bool {
 		return true
 	}
 
+	temp_arena := common.Arena{}
+	common.temp_arena_init(&temp_arena)
+	defer common.arena_delete(temp_arena)
+
+	// Created at the end, once it's known which of them can share memory
+	transient_image_refs := make([dynamic]ImageRef, temp_arena.allocator)
+
 	images_element_ids := p_doc.elements[images_id]
 	for image_element_id in images_element_ids.value {
 		switch element_id in image_element_id {
@@ -956,20 +1068,21 @@ renderer_config_image_creates :: proc(p_doc: ^xml.Document) -> bool {
 				1,
 			)
 
+			if render_graph_is_image_transient(image_name) {
+				append(&transient_image_refs, image_ref)
+				continue
+			}
+
 			if image_create(image_ref) == false {
 				log.errorf("Failed to create image '%s'\n", child.ident)
 				continue
 			}
 
-			temp_arena := common.Arena{}
-			common.temp_arena_init(&temp_arena)
-			defer common.arena_delete(temp_arena)
-
 			log.infof("Image '%s' created\n", child.ident)
 		}
 	}
 
-	return true
+	return render_graph_create_transient_images(transient_image_refs[:])
 }
 
 //---------------------------------------------------------------------------//
@@ -1008,10 +1121,17 @@ renderer_config_load_render_tasks :: proc(p_doc: ^xml.Document) -> bool {
 				continue
 			}
 
-			render_task_ref := render_task_allocate(common.create_name(render_task_name))
-			g_resources.render_tasks[render_task_get_idx(render_task_ref)].desc.type =
-				render_task_type
+			render_task_name_id := common.create_name(render_task_name)
+			if render_graph_is_task_culled(render_task_name_id) {
+				continue
+			}
 
+			render_task_ref := render_task_allocate(render_task_name_id)
+			render_task := &g_resources.render_tasks[render_task_get_idx(render_task_ref)]
+			render_task.desc.type = render_task_type
+			if render_graph_is_task_async_compute(render_task_name_id) {
+				render_task.desc.flags += {.AsyncCompute}
+			}
 
 			render_task_config := RenderTaskConfig {
 				doc                    = p_doc,
@@ -1102,12 +1222,238 @@ draw_debug_ui :: proc(p_dt: f32) {
 		imgui.SliderInt("Jitter period", (^i32)(&G_RENDERER_SETTINGS.taa_jitter_period), 1, 16)
 	}
 
+	if imgui.CollapsingHeader("Culling", {}) {
+		imgui.Checkbox("Frustum culling", &G_RENDERER_SETTINGS.frustum_culling_enabled)
+		imgui.Checkbox("GPU culling", &G_RENDERER_SETTINGS.gpu_culling_enabled)
+		imgui.Checkbox(
+			"GPU occlusion culling",
+			&G_RENDERER_SETTINGS.gpu_occlusion_culling_enabled,
+		)
+		imgui.Checkbox("LOD selection", &G_RENDERER_SETTINGS.lod_selection_enabled)
+		imgui.SliderFloat("LOD error threshold", &G_RENDERER_SETTINGS.lod_error_threshold, 0.1, 8)
+		imgui.SliderInt(
+			"Shadow LOD bias",
+			(^i32)(&G_RENDERER_SETTINGS.shadow_lod_bias),
+			0,
+			MESH_MAX_LODS - 1,
+		)
+		imgui.Text(
+			fmt.ctprintf(
+				"Submeshes tested: %d, culled: %d",
+				g_culling_stats.num_tested,
+				g_culling_stats.num_culled,
+			),
+		)
+		if imgui.Button("Run culling benchmark") {
+			for num_instances in ([]u32{10000, 50000, 100000}) {
+				culling_run_benchmark(num_instances)
+			}
+		}
+	}
+
+	if imgui.CollapsingHeader("Mesh batches", {}) {
+		imgui.Text(
+			fmt.ctprintf(
+				"Submesh instances: %d, batches: %d",
+				len(g_mesh_batches.entries),
+				len(g_mesh_batches.batches),
+			),
+		)
+		if imgui.Button("Run mesh batching benchmark") {
+			for num_instances in ([]u32{1000, 10000, 50000}) {
+				mesh_batches_run_benchmark(num_instances)
+			}
+		}
+	}
+
+	if imgui.CollapsingHeader("Buffer uploads", {}) {
+		imgui.Text(
+			fmt.ctprintf(
+				"Coalesced writes: %d, bytes: %d, copy regions: %d",
+				g_buffer_upload_stats.num_coalesced_writes,
+				g_buffer_upload_stats.num_coalesced_bytes,
+				g_buffer_upload_stats.num_copy_regions,
+			),
+		)
+		if imgui.Button("Run buffer upload benchmark") {
+			for num_writes in ([]u32{1000, 10000, 50000}) {
+				buffer_upload_run_benchmark(num_writes)
+			}
+		}
+	}
+
+	if imgui.CollapsingHeader("Render graph", {}) {
+		imgui.Text(
+			fmt.ctprintf(
+				"Barriers: %d in %d batches, merged batches: %d, skipped barriers: %d",
+				g_render_graph_stats.num_barriers,
+				g_render_graph_stats.num_barrier_batches,
+				g_render_graph_stats.num_merged_barrier_batches,
+				g_render_graph_stats.num_skipped_barriers,
+			),
+		)
+		imgui.Text(
+			fmt.ctprintf(
+				"Culled tasks: %d, aliased images: %d (%d bytes), memory saved: %d bytes",
+				g_render_graph_stats.num_culled_tasks,
+				g_render_graph_stats.num_aliased_images,
+				g_render_graph_stats.aliased_memory_size,
+				g_render_graph_stats.aliased_memory_saved,
+			),
+		)
+		imgui.Text(
+			fmt.ctprintf(
+				"Async compute tasks: %d, dedicated compute queue: %v",
+				g_render_graph_stats.num_async_compute_tasks,
+				.DedicatedComputeQueue in G_RENDERER.gpu_device_flags,
+			),
+		)
+	}
+
+	if imgui.CollapsingHeader("Shaders", {}) {
+		imgui.Text(
+			fmt.ctprintf(
+				"Startup: %.2f ms (%s), cache hits: %d, compiled: %d",
+				g_shader_compile_stats.startup_time_ms,
+				g_shader_compile_stats.startup_num_compiled == 0 ? "warm" : "cold",
+				g_shader_compile_stats.startup_num_cache_hits,
+				g_shader_compile_stats.startup_num_compiled,
+			),
+		)
+		imgui.Text(
+			fmt.ctprintf(
+				"Total: cache hits: %d, compiled: %d, failed: %d, compile time: %.2f ms",
+				g_shader_compile_stats.num_cache_hits,
+				g_shader_compile_stats.num_compiled,
+				g_shader_compile_stats.num_failed,
+				g_shader_compile_stats.compile_time_ms,
+			),
+		)
+	}
+
+	if imgui.CollapsingHeader("Pipelines", {}) {
+		imgui.Text(
+			fmt.ctprintf(
+				"Created: %d, cache hits: %d, compiled: %d, duplicates: %d, time: %.2f ms",
+				g_pipeline_stats.num_created,
+				g_pipeline_stats.num_cache_hits,
+				g_pipeline_stats.num_compiled,
+				g_pipeline_stats.num_duplicates,
+				g_pipeline_stats.create_time_ms,
+			),
+		)
+		imgui.Text(fmt.ctprintf("Pipeline cache size: %d bytes", g_pipeline_stats.cache_size))
+	}
+
+	if imgui.CollapsingHeader("Transient buffers", {}) {
+		for usage in TransientBufferUsage {
+			stats := transient_buffer_get_stats(usage)
+			imgui.Text(
+				fmt.ctprintf(
+					"%v: allocated %d bytes, high water mark %d bytes, %d pages (%d bytes)",
+					usage,
+					stats.allocated_size,
+					stats.high_water_mark,
+					stats.num_pages,
+					stats.pages_size,
+				),
+			)
+		}
+	}
+
+	if imgui.CollapsingHeader("Texture streaming", {}) {
+		imgui.Checkbox("Enabled", &G_RENDERER_SETTINGS.texture_streaming_enabled)
+		imgui.SliderInt(
+			"Budget (MB)",
+			(^i32)(&G_RENDERER_SETTINGS.texture_streaming_budget_mb),
+			64,
+			4096,
+		)
+		imgui.Text(
+			fmt.ctprintf(
+				"Streamed textures: %d, resident: %d bytes, needed: %d bytes",
+				g_texture_streaming_stats.num_streamed_textures,
+				g_texture_streaming_stats.resident_size,
+				g_texture_streaming_stats.target_size,
+			),
+		)
+		imgui.Text(
+			fmt.ctprintf(
+				"Mips streamed in: %d, evictions: %d",
+				g_texture_streaming_stats.num_mips_streamed_in,
+				g_texture_streaming_stats.num_evictions,
+			),
+		)
+	}
+
+	if imgui.CollapsingHeader("Command buffers", {}) {
+		imgui.Checkbox(
+			"Parallel recording",
+			&G_RENDERER_SETTINGS.parallel_command_buffer_recording,
+		)
+		imgui.Text(fmt.ctprintf("Job system threads: %d", common.jobs_get_num_threads()))
+	}
+
+	if imgui.CollapsingHeader("Profiler", {}) {
+		draw_profiler_ui()
+	}
+
 	// Debug UI
 	render_task_draw_debug_ui()
 }
 
 //---------------------------------------------------------------------------//
 
+@(private = "file")
+PROFILER_CAPTURE_PATH :: "app_data/renderer/profiler_capture.json"
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+draw_profiler_ui :: proc() {
+	when common.PROFILER_ENABLED {
+		imgui.SliderInt(
+			"Capture frames",
+			(^i32)(&G_RENDERER_SETTINGS.profiler_capture_num_frames),
+			1,
+			1000,
+		)
+		if common.profiler_is_capturing() {
+			imgui.Text("Capturing...")
+		} else if imgui.Button("Capture Chrome trace") {
+			common.profiler_capture_begin(
+				G_RENDERER_SETTINGS.profiler_capture_num_frames,
+				PROFILER_CAPTURE_PATH,
+			)
+		}
+
+		stats := common.profiler_get_stats(get_frame_allocator())
+
+		if imgui.BeginTable("ProfilerStats", 3, {.RowBg, .SizingStretchProp}) {
+			imgui.TableSetupColumn("Scope")
+			imgui.TableSetupColumn("CPU ms")
+			imgui.TableSetupColumn("GPU ms")
+			imgui.TableHeadersRow()
+
+			for stat in stats {
+				imgui.TableNextRow()
+				imgui.TableNextColumn()
+				imgui.Text(fmt.ctprintf("%s", stat.name))
+				imgui.TableNextColumn()
+				imgui.Text(fmt.ctprintf("%.3f", stat.cpu_ms))
+				imgui.TableNextColumn()
+				imgui.Text(fmt.ctprintf("%.3f", stat.gpu_ms))
+			}
+
+			imgui.EndTable()
+		}
+	} else {
+		imgui.Text("The profiler is disabled, build with -define:NEAT_PROFILER_ENABLED=true")
+	}
+}
+
+//---------------------------------------------------------------------------//
+
 @(private = "file")
 DeferredResourceDeleteEntry :: struct {
 	delete_func: proc(p_user_data: rawptr),
@@ -1158,6 +1504,14 @@ process_deferred_resource_deletes :: proc() {
 
 //---------------------------------------------------------------------------//
 
+@(private)
+is_async_compute_enabled :: #force_inline proc() -> bool {
+	// Disabled on the first frame, like async transfer, the render tasks don't run on it anyway
+	return (.DedicatedComputeQueue in G_RENDERER.gpu_device_flags) && get_frame_id() > 0
+}
+
+//---------------------------------------------------------------------------//
+
 @(private)
 is_async_transfer_enabled :: #force_inline proc() -> bool {
 	// Async transfer is disabled on first frame due to loading internal renderer textures
@@ -0,0 +1,399 @@
+package renderer
+
+//---------------------------------------------------------------------------//
+
+// Streams the mips of the textures in and out of VRAM, so that the resident ones fit in a budget.
+//
+// The finest mip each texture needs is estimated every frame on the CPU, from the screen space
+// size of the mesh batch entries whose material uses it. The texture is assumed to cover the
+// bounding sphere of the submesh once, so the wanted mip is the one with roughly a texel per pixel.
+//
+// Textures are streamed in one mip at a time, in the order of their priority, and when that goes
+// over the budget the mips finer than what's needed are evicted from the least recently used
+// textures. Images can't be partially resident without sparse binding, so changing the mip
+// range of a texture reallocates its image and copies the mips it keeps, see image_reallocate_mips.
+
+//---------------------------------------------------------------------------//
+
+import "../common"
+
+import "core:math"
+import "core:math/linalg/glsl"
+import "core:slice"
+
+//---------------------------------------------------------------------------//
+
+// Mips up to this size are always resident, the textures are created with them only
+@(private = "file")
+TEXTURE_STREAMING_MIN_RESIDENT_MIP_SIZE :: 64
+
+// Bounds the number of images reallocated and copied in a single frame
+@(private = "file")
+TEXTURE_STREAMING_MAX_REALLOCATIONS_PER_FRAME :: 8
+
+// Number of frames after which the mips of a texture that's not used anymore can be evicted
+@(private = "file")
+TEXTURE_STREAMING_UNUSED_FRAMES :: 60
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+TextureStreamingEntry :: struct {
+	image_ref:            ImageRef,
+	// Finest mip requested by the feedback in the current frame, mip_count when not used
+	requested_mip:        u32,
+	// Finest mip needed by the texture, mips finer than that can be evicted
+	target_mip:           u32,
+	last_requested_frame: u32,
+}
+
+//---------------------------------------------------------------------------//
+
+TextureStreamingStats :: struct {
+	num_streamed_textures: u32,
+	// Size of the mips of the streamed textures that are allocated in VRAM
+	resident_size:         u64,
+	// Size of the mips needed by the streamed textures
+	target_size:           u64,
+	num_mips_streamed_in:  u32,
+	num_evictions:         u32,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+g_texture_streaming_stats: TextureStreamingStats
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+INTERNAL: struct {
+	entries:                    [dynamic]TextureStreamingEntry,
+	entry_idx_per_bindless_idx: map[u32]u32,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+texture_streaming_init :: proc() {
+	INTERNAL.entries = make([dynamic]TextureStreamingEntry, G_RENDERER_ALLOCATORS.main_allocator)
+	INTERNAL.entry_idx_per_bindless_idx = make(
+		map[u32]u32,
+		MAX_IMAGES,
+		G_RENDERER_ALLOCATORS.main_allocator,
+	)
+}
+
+//---------------------------------------------------------------------------//
+
+// Coarsest mip that's always resident, the streamed textures are created with mips up to it
+@(private)
+texture_streaming_get_initial_mip :: proc(p_image_ref: ImageRef) -> u32 {
+	image := &g_resources.images[image_get_idx(p_image_ref)]
+
+	first_mip := u32(0)
+	size := max(image.desc.dimensions.x, image.desc.dimensions.y)
+	for (size >> first_mip) > TEXTURE_STREAMING_MIN_RESIDENT_MIP_SIZE {
+		first_mip += 1
+	}
+
+	return min(first_mip, image.desc.mip_count - 1)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+texture_streaming_register :: proc(p_image_ref: ImageRef) {
+	image := &g_resources.images[image_get_idx(p_image_ref)]
+
+	entry := TextureStreamingEntry {
+		image_ref            = p_image_ref,
+		requested_mip        = image.desc.mip_count,
+		target_mip           = image.first_allocated_mip,
+		last_requested_frame = get_frame_id(),
+	}
+
+	INTERNAL.entry_idx_per_bindless_idx[image.bindless_idx] = u32(len(INTERNAL.entries))
+	append(&INTERNAL.entries, entry)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+texture_streaming_unregister :: proc(p_image_ref: ImageRef) {
+	image := &g_resources.images[image_get_idx(p_image_ref)]
+
+	entry_idx, found := INTERNAL.entry_idx_per_bindless_idx[image.bindless_idx]
+	if found == false {
+		return
+	}
+
+	delete_key(&INTERNAL.entry_idx_per_bindless_idx, image.bindless_idx)
+
+	// Swap the last entry with the removed one
+	last_entry := pop(&INTERNAL.entries)
+	if int(entry_idx) < len(INTERNAL.entries) {
+		INTERNAL.entries[entry_idx] = last_entry
+		last_image := &g_resources.images[image_get_idx(last_entry.image_ref)]
+		INTERNAL.entry_idx_per_bindless_idx[last_image.bindless_idx] = entry_idx
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+texture_streaming_update :: proc() {
+	common.profiler_scope("TextureStreamingUpdate")
+
+	if len(INTERNAL.entries) == 0 {
+		return
+	}
+
+	temp_arena: common.Arena
+	common.temp_arena_init(&temp_arena, common.KILOBYTE * 64)
+	defer common.arena_delete(temp_arena)
+
+	texture_streaming_collect_feedback()
+
+	frame_id := get_frame_id()
+	budget := u64(G_RENDERER_SETTINGS.texture_streaming_budget_mb) * common.MEGABYTE
+	if G_RENDERER_SETTINGS.texture_streaming_enabled == false {
+		budget = max(u64)
+	}
+
+	g_texture_streaming_stats.num_streamed_textures = u32(len(INTERNAL.entries))
+	g_texture_streaming_stats.resident_size = 0
+	g_texture_streaming_stats.target_size = 0
+
+	// Mips to stream in and the ones that can be evicted, indices of the entries
+	stream_in_candidates := make([dynamic]u32, temp_arena.allocator)
+	eviction_candidates := make([dynamic]u32, temp_arena.allocator)
+
+	for &entry, entry_idx in INTERNAL.entries {
+		image := &g_resources.images[image_get_idx(entry.image_ref)]
+
+		if entry.requested_mip < image.desc.mip_count {
+			entry.target_mip = entry.requested_mip
+			entry.last_requested_frame = frame_id
+		} else if frame_id - entry.last_requested_frame > TEXTURE_STREAMING_UNUSED_FRAMES {
+			entry.target_mip = texture_streaming_get_initial_mip(entry.image_ref)
+		}
+
+		if G_RENDERER_SETTINGS.texture_streaming_enabled == false {
+			entry.target_mip = 0
+		}
+
+		g_texture_streaming_stats.resident_size += texture_streaming_get_mips_size(
+			entry.image_ref,
+			image.first_allocated_mip,
+		)
+		g_texture_streaming_stats.target_size += texture_streaming_get_mips_size(
+			entry.image_ref,
+			entry.target_mip,
+		)
+
+		// Reallocating an image that's still being uploaded would drop the upload
+		if texture_streaming_is_image_loaded(entry.image_ref) == false {
+			continue
+		}
+
+		if entry.target_mip < image.first_allocated_mip {
+			append(&stream_in_candidates, u32(entry_idx))
+		} else if entry.target_mip > image.first_allocated_mip {
+			append(&eviction_candidates, u32(entry_idx))
+		}
+	}
+
+	// Stream in the textures that are the furthest from their target first
+	slice.sort_by(stream_in_candidates[:], proc(p_a, p_b: u32) -> bool {
+		return texture_streaming_get_missing_mips(p_a) > texture_streaming_get_missing_mips(p_b)
+	})
+
+	// Evict the textures that weren't used for the longest first
+	slice.sort_by(eviction_candidates[:], proc(p_a, p_b: u32) -> bool {
+		last_requested_a := INTERNAL.entries[p_a].last_requested_frame
+		last_requested_b := INTERNAL.entries[p_b].last_requested_frame
+		return last_requested_a < last_requested_b
+	})
+
+	num_reallocations := 0
+	next_eviction_idx := 0
+
+	for entry_idx in stream_in_candidates {
+		if num_reallocations >= TEXTURE_STREAMING_MAX_REALLOCATIONS_PER_FRAME {
+			break
+		}
+
+		entry := &INTERNAL.entries[entry_idx]
+		image := &g_resources.images[image_get_idx(entry.image_ref)]
+
+		mip := image.first_allocated_mip - 1
+		mip_size := image_get_mip_size_in_bytes(entry.image_ref, mip)
+
+		// Make room for the mip by evicting the least recently used textures
+		for g_texture_streaming_stats.resident_size + mip_size > budget &&
+		    next_eviction_idx < len(eviction_candidates) &&
+		    num_reallocations + 1 < TEXTURE_STREAMING_MAX_REALLOCATIONS_PER_FRAME {
+
+			g_texture_streaming_stats.resident_size -= texture_streaming_evict(
+				eviction_candidates[next_eviction_idx],
+			)
+			next_eviction_idx += 1
+			num_reallocations += 1
+		}
+
+		if g_texture_streaming_stats.resident_size + mip_size > budget {
+			break
+		}
+
+		if image_reallocate_mips(entry.image_ref, mip) {
+			g_texture_streaming_stats.resident_size += mip_size
+			g_texture_streaming_stats.num_mips_streamed_in += 1
+		}
+		num_reallocations += 1
+	}
+
+	// Get back under the budget when it was lowered
+	for g_texture_streaming_stats.resident_size > budget &&
+	    next_eviction_idx < len(eviction_candidates) &&
+	    num_reallocations < TEXTURE_STREAMING_MAX_REALLOCATIONS_PER_FRAME {
+
+		g_texture_streaming_stats.resident_size -= texture_streaming_evict(
+			eviction_candidates[next_eviction_idx],
+		)
+		next_eviction_idx += 1
+		num_reallocations += 1
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+// Requests the mips of the textures used by the materials of the mesh batch entries
+// based on their size on the screen, as seen from the main camera
+@(private = "file")
+texture_streaming_collect_feedback :: proc() {
+
+	for &entry in INTERNAL.entries {
+		image := &g_resources.images[image_get_idx(entry.image_ref)]
+		entry.requested_mip = image.desc.mip_count
+	}
+
+	view := render_view_create_from_camera(g_render_camera)
+	resolution_y := f32(G_RENDERER.config.render_resolution.y)
+
+	for batch_entry in g_mesh_batches.entries {
+		material_properties := material_instance_get_properties_ptr_by_idx(
+			batch_entry.material_instance_idx,
+		)
+		if material_properties.flags == {} {
+			continue
+		}
+
+		mesh := &g_resources.meshes[mesh_batch_key_get_mesh_idx(batch_entry.key)]
+		submesh := &mesh.desc.sub_meshes[mesh_batch_key_get_submesh_idx(batch_entry.key)]
+		model_matrix := g_resources.mesh_instances[batch_entry.mesh_instance_idx].model_matrix
+
+		scale := max(
+			glsl.length(model_matrix[0].xyz),
+			glsl.length(model_matrix[1].xyz),
+			glsl.length(model_matrix[2].xyz),
+		)
+
+		center := (submesh.bounding_box.min + submesh.bounding_box.max) * 0.5
+		radius := glsl.length(submesh.bounding_box.max - center) * scale
+		world_center := (model_matrix * glsl.vec4{center.x, center.y, center.z, 1}).xyz
+
+		// Diameter of the bounding sphere in pixels, measured at its closest point
+		distance := max(glsl.length(world_center - view.position) - radius, view.near_plane)
+		screen_size := 2 * radius * view.projection[1, 1] * 0.5 * resolution_y / distance
+
+		if .HasAlbedoImage in material_properties.flags {
+			texture_streaming_request(material_properties.albedo_image_id, screen_size)
+		}
+		if .HasNormalImage in material_properties.flags {
+			texture_streaming_request(material_properties.normal_image_id, screen_size)
+		}
+		if .HasRoughnessImage in material_properties.flags {
+			texture_streaming_request(material_properties.roughness_image_id, screen_size)
+		}
+		if .HasMetalnessImage in material_properties.flags {
+			texture_streaming_request(material_properties.metalness_image_id, screen_size)
+		}
+		if .HasOcclusionImage in material_properties.flags {
+			texture_streaming_request(material_properties.occlusion_image_id, screen_size)
+		}
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+texture_streaming_request :: proc(p_bindless_idx: u32, p_screen_size: f32) {
+	entry_idx, found := INTERNAL.entry_idx_per_bindless_idx[p_bindless_idx]
+	if found == false {
+		return
+	}
+
+	entry := &INTERNAL.entries[entry_idx]
+	image := &g_resources.images[image_get_idx(entry.image_ref)]
+
+	texture_size := f32(max(image.desc.dimensions.x, image.desc.dimensions.y))
+	mip := u32(max(math.log2(texture_size / max(p_screen_size, 1)), 0))
+
+	entry.requested_mip = min(entry.requested_mip, mip, image.desc.mip_count - 1)
+}
+
+//---------------------------------------------------------------------------//
+
+// Reallocates the texture with the mips it needs only, returns the number of bytes freed
+@(private = "file")
+texture_streaming_evict :: proc(p_entry_idx: u32) -> u64 {
+	entry := &INTERNAL.entries[p_entry_idx]
+	image := &g_resources.images[image_get_idx(entry.image_ref)]
+
+	old_size := texture_streaming_get_mips_size(entry.image_ref, image.first_allocated_mip)
+	if image_reallocate_mips(entry.image_ref, entry.target_mip) == false {
+		return 0
+	}
+
+	g_texture_streaming_stats.num_evictions += 1
+
+	return old_size - texture_streaming_get_mips_size(entry.image_ref, entry.target_mip)
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+texture_streaming_get_mips_size :: proc(p_image_ref: ImageRef, p_first_mip: u32) -> u64 {
+	image := &g_resources.images[image_get_idx(p_image_ref)]
+
+	size := u64(0)
+	for mip in p_first_mip ..< image.desc.mip_count {
+		size += image_get_mip_size_in_bytes(p_image_ref, mip)
+	}
+	return size
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+texture_streaming_get_missing_mips :: proc(p_entry_idx: u32) -> u32 {
+	entry := &INTERNAL.entries[p_entry_idx]
+	image := &g_resources.images[image_get_idx(entry.image_ref)]
+	return image.first_allocated_mip - entry.target_mip
+}
+
+//---------------------------------------------------------------------------//
+
+// Checks if all of the allocated mips of the image are uploaded
+@(private = "file")
+texture_streaming_is_image_loaded :: proc(p_image_ref: ImageRef) -> bool {
+	image := &g_resources.images[image_get_idx(p_image_ref)]
+
+	allocated_mips_mask :=
+		((u32(1) << image.desc.mip_count) - 1) & ~((u32(1) << image.first_allocated_mip) - 1)
+
+	return image.loaded_mips_mask & allocated_mips_mask == allocated_mips_mask
+}
+
+//---------------------------------------------------------------------------//
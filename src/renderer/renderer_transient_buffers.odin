@@ -0,0 +1,396 @@
+package renderer
+
+//---------------------------------------------------------------------------//
+
+// Per frame linear allocator for transient GPU data - render task uniforms, storage data and
+// indirect arguments that are written by the CPU and consumed by the GPU within the same frame.
+//
+// Each usage has its own pool of persistently mapped pages. A frame bump allocates from its current
+// page and chains a free (or a new) page once it's full, so there is no limit on how much data
+// a frame can allocate. The pages used by a frame are given back to the pool at the start of the next
+// frame with the same index, after its fence has been waited on.
+//
+// Uniform data is bound with dynamic offsets through bind groups that are created once, so uniform
+// allocations are addressed with virtual offsets (page index * page size + offset in the page).
+// The first num_frames_in_flight pages - one home page per frame - are regions of a single
+// buffer, the one the bind groups point at, which means that for them the virtual offset is the
+// offset in that buffer. When a frame overflows its home page, the dynamic offsets pointing at the
+// overflow pages are resolved when the bind group is bound, see backend_bind_group_bind_*.
+
+//---------------------------------------------------------------------------//
+
+import "../common"
+
+import "core:log"
+import "core:mem"
+import "core:sync"
+
+//---------------------------------------------------------------------------//
+
+// Can be lowered with -define to force the frames to overflow into new pages
+@(private = "file")
+TRANSIENT_UNIFORM_PAGE_SIZE :: #config(TRANSIENT_UNIFORM_PAGE_SIZE, common.KILOBYTE * 64)
+
+@(private = "file")
+TRANSIENT_STORAGE_PAGE_SIZE :: #config(TRANSIENT_STORAGE_PAGE_SIZE, common.MEGABYTE)
+
+@(private = "file")
+TRANSIENT_INDIRECT_ARGS_PAGE_SIZE :: #config(
+	TRANSIENT_INDIRECT_ARGS_PAGE_SIZE,
+	common.KILOBYTE * 256,
+)
+
+// Vulkan requires 4 byte aligned indirect offsets, 16 allows the commands to be read as uint4
+@(private = "file")
+TRANSIENT_INDIRECT_ARGS_ALIGNMENT :: 16
+
+//---------------------------------------------------------------------------//
+
+TransientBufferUsage :: enum u8 {
+	Uniform,
+	Storage,
+	IndirectArgs,
+}
+
+//---------------------------------------------------------------------------//
+
+TransientBufferAllocation :: struct {
+	buffer_ref:     BufferRef,
+	// Offset of the allocation in buffer_ref
+	offset:         u32,
+	// Offset to use when binding the allocation through a bind group. For uniform allocations
+	// that's the virtual offset in the transient uniform buffer, otherwise it's the same as offset.
+	dynamic_offset: u32,
+	mapped_ptr:     rawptr,
+}
+
+//---------------------------------------------------------------------------//
+
+TransientBufferStats :: struct {
+	// Bytes allocated in the current frame, including the alignment padding
+	allocated_size:  u32,
+	// Largest number of bytes allocated by a single frame so far
+	high_water_mark: u32,
+	num_pages:       u32,
+	pages_size:      u32,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+TransientBufferPage :: struct {
+	buffer_ref:    BufferRef,
+	// Offset of the page in its buffer, only the uniform home pages share a buffer
+	buffer_offset: u32,
+	size:          u32,
+	mapped_ptr:    ^u8,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+TransientBufferPool :: struct {
+	page_name:      string,
+	buffer_usage:   BufferUsageFlags,
+	alignment:      u32,
+	page_size:      u32,
+	num_home_pages: u32,
+	pages:          [dynamic]TransientBufferPage,
+	free_pages:     [dynamic]u32,
+	// Pages used by each frame in flight, the last one is the one currently allocated from
+	frame_pages:    [MAX_NUM_FRAMES_IN_FLIGHT][dynamic]u32,
+	// Allocation offset in the current page
+	page_offset:    u32,
+	stats:          TransientBufferStats,
+	lock:           sync.Mutex,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+INTERNAL: struct {
+	pools:                         [TransientBufferUsage]TransientBufferPool,
+	// Buffer holding the home pages of the uniform pool
+	uniform_home_pages_buffer_ref: BufferRef,
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+transient_buffer_init :: proc() -> bool {
+
+	INTERNAL.pools[.Uniform] = {
+		page_name    = "TransientUniformPage",
+		buffer_usage = {.DynamicUniformBuffer},
+		alignment    = G_RENDERER.min_uniform_buffer_alignment,
+		page_size    = TRANSIENT_UNIFORM_PAGE_SIZE,
+	}
+
+	INTERNAL.pools[.Storage] = {
+		page_name    = "TransientStoragePage",
+		buffer_usage = {.StorageBuffer},
+		alignment    = G_RENDERER.min_storage_buffer_alignment,
+		page_size    = TRANSIENT_STORAGE_PAGE_SIZE,
+	}
+
+	INTERNAL.pools[.IndirectArgs] = {
+		page_name    = "TransientIndirectArgsPage",
+		buffer_usage = {.IndirectBuffer},
+		alignment    = TRANSIENT_INDIRECT_ARGS_ALIGNMENT,
+		page_size    = TRANSIENT_INDIRECT_ARGS_PAGE_SIZE,
+	}
+
+	for &pool in INTERNAL.pools {
+		pool.pages = make([dynamic]TransientBufferPage, G_RENDERER_ALLOCATORS.main_allocator)
+		pool.free_pages = make([dynamic]u32, G_RENDERER_ALLOCATORS.main_allocator)
+		for i in 0 ..< G_RENDERER.num_frames_in_flight {
+			pool.frame_pages[i] = make([dynamic]u32, G_RENDERER_ALLOCATORS.main_allocator)
+		}
+	}
+
+	// Create the uniform home pages, one per frame in flight, as regions of a single buffer
+	{
+		uniform_pool := &INTERNAL.pools[.Uniform]
+
+		buffer_ref := buffer_allocate(common.create_name("TransientUniformBuffer"))
+		buffer := &g_resources.buffers[buffer_get_idx(buffer_ref)]
+
+		// Read by the async compute tasks as well
+		buffer.desc = {
+			flags = {.HostWrite, .Mapped, .SharingModeConcurrent},
+			size  = uniform_pool.page_size * G_RENDERER.num_frames_in_flight,
+			usage = uniform_pool.buffer_usage,
+		}
+
+		if buffer_create(buffer_ref) == false {
+			log.error("Failed to create the transient uniform buffer")
+			return false
+		}
+
+		for i in 0 ..< G_RENDERER.num_frames_in_flight {
+			home_page := TransientBufferPage {
+				buffer_ref    = buffer_ref,
+				buffer_offset = i * uniform_pool.page_size,
+				size          = uniform_pool.page_size,
+				mapped_ptr    = mem.ptr_offset(buffer.mapped_ptr, int(i * uniform_pool.page_size)),
+			}
+			append(&uniform_pool.pages, home_page)
+			append(&uniform_pool.frame_pages[i], i)
+		}
+
+		uniform_pool.num_home_pages = G_RENDERER.num_frames_in_flight
+		uniform_pool.stats.num_pages = G_RENDERER.num_frames_in_flight
+		uniform_pool.stats.pages_size = buffer.desc.size
+		INTERNAL.uniform_home_pages_buffer_ref = buffer_ref
+	}
+
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
+// Gives the pages used by the frame that previously had the current frame index back to the pools.
+// Has to be called after the frame resources were waited on and before anything is allocated.
+@(private)
+transient_buffer_begin_frame :: proc() {
+	frame_idx := get_frame_idx()
+
+	for &pool in INTERNAL.pools {
+		frame_pages := &pool.frame_pages[frame_idx]
+
+		// The uniform home page always stays with its frame
+		first_free_page := 1 if pool.num_home_pages > 0 else 0
+		for page_idx in frame_pages[first_free_page:] {
+			append(&pool.free_pages, page_idx)
+		}
+		resize(frame_pages, first_free_page)
+
+		pool.page_offset = 0
+		pool.stats.allocated_size = 0
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+// Allocates a block of transient memory, valid until the end of the frame. Chains new pages when
+// the frame runs out of space and only fails when a new page can't be created. Safe to call from
+// multiple threads - each pool has its own lock and the pages are created through
+// buffer_allocate(), which locks the buffer refs.
+transient_buffer_allocate :: proc(
+	p_usage: TransientBufferUsage,
+	p_size: u32,
+) -> (
+	TransientBufferAllocation,
+	bool,
+) {
+
+	pool := &INTERNAL.pools[p_usage]
+
+	sync.mutex_lock(&pool.lock)
+	defer sync.mutex_unlock(&pool.lock)
+
+	frame_pages := &pool.frame_pages[get_frame_idx()]
+
+	offset := u32(mem.align_forward_uint(uint(pool.page_offset), uint(pool.alignment)))
+
+	if len(frame_pages^) == 0 ||
+	   offset + p_size > transient_buffer_page_capacity(pool, frame_pages[len(frame_pages^) - 1]) {
+		if len(frame_pages^) > 0 {
+			// Count the unused tail of the current page as allocated, it can't be used anymore
+			capacity := transient_buffer_page_capacity(pool, frame_pages[len(frame_pages^) - 1])
+			pool.stats.allocated_size += capacity - min(pool.page_offset, capacity)
+		}
+
+		new_page_idx, page_acquired := transient_buffer_acquire_page(pool, p_size)
+		if page_acquired == false {
+			return {}, false
+		}
+
+		append(frame_pages, new_page_idx)
+		pool.page_offset = 0
+		offset = 0
+	}
+
+	page_idx := frame_pages[len(frame_pages^) - 1]
+	page := &pool.pages[page_idx]
+
+	// Uniform allocations larger than the page size end up alone at the start of a dedicated page,
+	// where the virtual offset can still address them. The page offset is then past the capacity,
+	// so the next allocation chains a new page.
+	pool.stats.allocated_size += offset + p_size - pool.page_offset
+	pool.stats.high_water_mark = max(pool.stats.high_water_mark, pool.stats.allocated_size)
+	pool.page_offset = offset + p_size
+
+	allocation := TransientBufferAllocation {
+		buffer_ref     = page.buffer_ref,
+		offset         = page.buffer_offset + offset,
+		dynamic_offset = page.buffer_offset + offset,
+		mapped_ptr     = mem.ptr_offset(page.mapped_ptr, int(offset)),
+	}
+
+	if p_usage == .Uniform {
+		allocation.dynamic_offset = page_idx * pool.page_size + offset
+	}
+
+	return allocation, true
+}
+
+//---------------------------------------------------------------------------//
+
+transient_buffer_get_stats :: proc(p_usage: TransientBufferUsage) -> TransientBufferStats {
+	return INTERNAL.pools[p_usage].stats
+}
+
+//---------------------------------------------------------------------------//
+
+// Buffer that the bind groups using transient uniform data should point at
+@(private)
+transient_buffer_get_uniform_buffer_ref :: proc() -> BufferRef {
+	return INTERNAL.uniform_home_pages_buffer_ref
+}
+
+//---------------------------------------------------------------------------//
+
+// Splits a virtual offset into the transient uniform buffer into the overflow page it points at
+// and the offset in that page's buffer. Offsets in the home pages are returned as they are,
+// with page index 0, as home pages live in the transient uniform buffer itself.
+@(private)
+transient_buffer_resolve_uniform_offset :: #force_inline proc(
+	p_virtual_offset: u32,
+) -> (
+	page_idx: u32,
+	offset: u32,
+) {
+	uniform_pool := &INTERNAL.pools[.Uniform]
+
+	page_idx = p_virtual_offset / uniform_pool.page_size
+	if page_idx < uniform_pool.num_home_pages {
+		return 0, p_virtual_offset
+	}
+
+	return page_idx, p_virtual_offset % uniform_pool.page_size
+}
+
+//---------------------------------------------------------------------------//
+
+@(private)
+transient_buffer_get_uniform_page_buffer_ref :: proc(p_page_idx: u32) -> BufferRef {
+	uniform_pool := &INTERNAL.pools[.Uniform]
+
+	sync.mutex_lock(&uniform_pool.lock)
+	defer sync.mutex_unlock(&uniform_pool.lock)
+
+	return uniform_pool.pages[p_page_idx].buffer_ref
+}
+
+//---------------------------------------------------------------------------//
+
+// Number of bytes that can be allocated from a page. Uniform pages are addressed with virtual
+// offsets, so only the first page size bytes of a larger, dedicated uniform page can be used.
+@(private = "file")
+transient_buffer_page_capacity :: #force_inline proc(
+	p_pool: ^TransientBufferPool,
+	p_page_idx: u32,
+) -> u32 {
+	page_size := p_pool.pages[p_page_idx].size
+	if p_pool.num_home_pages > 0 {
+		return min(page_size, p_pool.page_size)
+	}
+	return page_size
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+transient_buffer_acquire_page :: proc(
+	p_pool: ^TransientBufferPool,
+	p_min_size: u32,
+) -> (
+	u32,
+	bool,
+) {
+
+	for page_idx, i in p_pool.free_pages {
+		if p_pool.pages[page_idx].size >= p_min_size {
+			unordered_remove(&p_pool.free_pages, i)
+			return page_idx, true
+		}
+	}
+
+	// Allocations larger than a page get a dedicated, larger page
+	page_size := p_pool.page_size
+	if p_min_size > p_pool.page_size {
+		page_size = u32(mem.align_forward_uint(uint(p_min_size), uint(p_pool.page_size)))
+	}
+
+	buffer_ref := buffer_allocate(common.create_name(p_pool.page_name))
+	buffer := &g_resources.buffers[buffer_get_idx(buffer_ref)]
+
+	// Host written, so they can be read by the async compute tasks without ownership transfers
+	buffer.desc = {
+		flags = {.HostWrite, .Mapped, .SharingModeConcurrent},
+		size  = page_size,
+		usage = p_pool.buffer_usage,
+	}
+
+	if buffer_create(buffer_ref) == false {
+		log.errorf("Failed to create a %d byte %s", page_size, p_pool.page_name)
+		return 0, false
+	}
+
+	append(
+		&p_pool.pages,
+		TransientBufferPage {
+			buffer_ref = buffer_ref,
+			size = page_size,
+			mapped_ptr = buffer.mapped_ptr,
+		},
+	)
+
+	p_pool.stats.num_pages += 1
+	p_pool.stats.pages_size += page_size
+
+	return u32(len(p_pool.pages) - 1), true
+}
+
+//---------------------------------------------------------------------------//
@@ -9,18 +9,6 @@ import "core:mem"
 
 //---------------------------------------------------------------------------//
 
-@(private = "file")
-INTERNAL: struct {
-	current_transient_buffer_offset: u32,
-}
-
-//---------------------------------------------------------------------------//
-
-@(private = "file")
-TRANSIENT_UNIFORM_BUFFER_SIZE :: common.KILOBYTE * 8
-
-//---------------------------------------------------------------------------//
-
 @(private = "file")
 RenderViewData :: struct #packed {
 	view:              glsl.mat4x4,
@@ -95,7 +83,8 @@ g_per_frame_data: struct #packed {
 
 @(private)
 g_uniform_buffers: struct {
-	transient_buffer:            DynamicUniformBuffer,
+	// Transient uniform buffer, see renderer_transient_buffers.odin
+	transient_buffer_ref:        BufferRef,
 	frame_data_offset:           u32,
 	render_settings_data_offset: u32,
 }
@@ -111,10 +100,7 @@ DynamicUniformBuffer :: struct {
 
 @(private)
 uniform_buffer_init :: proc() {
-	g_uniform_buffers.transient_buffer = uniform_buffer_create_dynamic(
-		common.create_name("TransientBuffer"),
-		TRANSIENT_UNIFORM_BUFFER_SIZE,
-	)
+	g_uniform_buffers.transient_buffer_ref = transient_buffer_get_uniform_buffer_ref()
 	g_per_frame_data.volumetric_fog_near = 0.01
 	g_per_frame_data.volumetric_fog_far = 50
 
@@ -133,37 +119,29 @@ uniform_buffer_create_dynamic :: proc {
 //---------------------------------------------------------------------------//
 
 @(private)
-uniform_buffer_update :: proc(p_dt: f32) {
-	// Reset the transient buffer
-	INTERNAL.current_transient_buffer_offset = 0
-	update_per_frame_data(p_dt)
+uniform_buffer_update :: proc(p_dt: f32) -> bool {
+	return update_per_frame_data(p_dt)
 }
 
 //---------------------------------------------------------------------------//
 
 // Creates a transient buffer that can be used to send constant data to a render task
 // Transient buffer are valid only within the frame boundary
+// Returns the dynamic offset to bind it with, the transient buffer grows as needed
+// Fails only when the transient buffer couldn't grow
 
-uniform_buffer_create_transient_buffer :: proc(p_data: ^$T) -> u32 {
+uniform_buffer_create_transient_buffer :: proc(p_data: ^$T) -> (u32, bool) {
 
 	data_size := size_of(p_data^)
-	aligned_size := uniform_buffer_ensure_alignment(u32(data_size))
 
-	if INTERNAL.current_transient_buffer_offset + aligned_size >= TRANSIENT_UNIFORM_BUFFER_SIZE {
-		return 0
+	allocation, allocated := transient_buffer_allocate(.Uniform, u32(data_size))
+	if allocated == false {
+		return 0, false
 	}
 
-	buffer_offset :=
-		get_frame_idx() * g_uniform_buffers.transient_buffer.aligned_size +
-		INTERNAL.current_transient_buffer_offset
-
-	INTERNAL.current_transient_buffer_offset += aligned_size
+	mem.copy(allocation.mapped_ptr, p_data, data_size)
 
-	transient_buffer := &g_resources.buffers[buffer_get_idx(g_uniform_buffers.transient_buffer.buffer_ref)]
-
-	mem.copy(mem.ptr_offset(transient_buffer.mapped_ptr, buffer_offset), p_data, data_size)
-
-	return buffer_offset
+	return allocation.dynamic_offset, true
 }
 
 //---------------------------------------------------------------------------//
@@ -191,7 +169,7 @@ uniform_buffer_ensure_alignment_by_size :: proc(p_size: u32) -> u32 {
 //---------------------------------------------------------------------------//
 
 @(private = "file")
-update_per_frame_data :: proc(p_dt: f32) {
+update_per_frame_data :: proc(p_dt: f32) -> bool {
 
 	g_per_frame_data.time += p_dt
 	g_per_frame_data.delta_time = p_dt
@@ -251,10 +229,14 @@ update_per_frame_data :: proc(p_dt: f32) {
 		g_render_settings_data.taa.flags -= {.LuminanceDifferenceFilter}
 	}
 
-	g_uniform_buffers.frame_data_offset = uniform_buffer_create_transient_buffer(&g_per_frame_data)
+	g_uniform_buffers.frame_data_offset = uniform_buffer_create_transient_buffer(
+		&g_per_frame_data,
+	) or_return
 	g_uniform_buffers.render_settings_data_offset = uniform_buffer_create_transient_buffer(
 		&g_render_settings_data,
-	)
+	) or_return
+
+	return true
 }
 
 //---------------------------------------------------------------------------//
@@ -282,7 +264,7 @@ per_view_data_create :: proc(p_view: RenderView) -> RenderViewData {
 //---------------------------------------------------------------------------//
 
 @(private)
-uniform_buffer_create_view_data :: proc(p_render_views: RenderViews) -> u32 {
+uniform_buffer_create_view_data :: proc(p_render_views: RenderViews) -> (u32, bool) {
 
 	view_data := PerViewData {
 		current_view  = per_view_data_create(p_render_views.current_view),
@@ -304,8 +286,9 @@ uniform_buffer_create_dynamic_by_size :: proc(
 
 	aligned_size := uniform_buffer_ensure_alignment(p_size)
 
+	// Read by the async compute tasks as well
 	buffer.desc = {
-		flags = {.HostWrite, .Mapped},
+		flags = {.HostWrite, .Mapped, .SharingModeConcurrent},
 		size  = aligned_size * G_RENDERER.num_frames_in_flight,
 		usage = {.DynamicUniformBuffer},
 	}
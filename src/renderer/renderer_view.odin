@@ -20,15 +20,25 @@ RenderCamera :: struct {
 
 //--------------------------------------------------------------------------//
 
+@(private)
+FRUSTUM_PLANES_COUNT :: 6
+
+//--------------------------------------------------------------------------//
+
 RenderView :: struct {
-	view:         glsl.mat4,
-	projection:   glsl.mat4,
-	position:     glsl.vec3,
-	forward:      glsl.vec3,
-	up:           glsl.vec3,
-	near_plane:   f32,
-	aspect_ratio: f32,
-	jitter:       glsl.vec2,
+	view:               glsl.mat4,
+	projection:         glsl.mat4,
+	position:           glsl.vec3,
+	forward:            glsl.vec3,
+	up:                 glsl.vec3,
+	near_plane:         f32,
+	aspect_ratio:       f32,
+	jitter:             glsl.vec2,
+	// World space frustum planes (xyz - normal pointing inside, w - distance) used for culling
+	frustum_planes:     [FRUSTUM_PLANES_COUNT]glsl.vec4,
+	// False for views whose projection isn't known on the CPU, e.g. the shadow cascades that
+	// are fit on the GPU. Nothing can be culled against them, so they see every instance.
+	has_frustum_planes: bool,
 }
 
 //--------------------------------------------------------------------------//
@@ -66,6 +76,57 @@ render_view_create_from_camera :: proc(
 	render_view.near_plane = p_render_camera.near_plane
 	render_view.aspect_ratio = aspect_ratio
 	render_view.jitter = p_render_camera.jitter
+	render_view.frustum_planes = render_view_compute_frustum_planes(
+		render_view.projection * render_view.view,
+		p_render_camera.position,
+		p_render_camera.forward,
+		p_render_camera.far_plane,
+	)
+	render_view.has_frustum_planes = true
+
+	return
+}
+
+//--------------------------------------------------------------------------//
+
+// Extracts the frustum planes from the view projection matrix
+// https://www.gamedevs.org/uploads/fast-extraction-viewing-frustum-planes-from-world-view-projection-matrix.pdf
+// The projection is infinite and reversed, so the near plane is z <= w and the far plane
+// is constructed from the camera far plane distance instead
+@(private)
+render_view_compute_frustum_planes :: proc(
+	p_view_projection: glsl.mat4,
+	p_position: glsl.vec3,
+	p_forward: glsl.vec3,
+	p_far_plane: f32,
+) -> (
+	planes: [FRUSTUM_PLANES_COUNT]glsl.vec4,
+) {
+	m := p_view_projection
+	row_0 := glsl.vec4{m[0, 0], m[0, 1], m[0, 2], m[0, 3]}
+	row_1 := glsl.vec4{m[1, 0], m[1, 1], m[1, 2], m[1, 3]}
+	row_2 := glsl.vec4{m[2, 0], m[2, 1], m[2, 2], m[2, 3]}
+	row_3 := glsl.vec4{m[3, 0], m[3, 1], m[3, 2], m[3, 3]}
+
+	planes[0] = row_3 + row_0 // Left
+	planes[1] = row_3 - row_0 // Right
+	planes[2] = row_3 + row_1 // Bottom
+	planes[3] = row_3 - row_1 // Top
+	planes[4] = row_3 - row_2 // Near
+
+	for i in 0 ..< 5 {
+		planes[i] /= glsl.length(planes[i].xyz)
+	}
+
+	// Far, no far plane means an infinite frustum
+	if p_far_plane > 0 {
+		planes[5] = glsl.vec4{
+			-p_forward.x,
+			-p_forward.y,
+			-p_forward.z,
+			glsl.dot(p_forward, p_position) + p_far_plane,
+		}
+	}
 
 	return
 }
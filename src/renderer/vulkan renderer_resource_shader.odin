@@ -3,6 +3,8 @@ package renderer
 
 import "core:c/libc"
 import "core:log"
+import "core:mem"
+import "core:os"
 import "core:strings"
 import vk "vendor:vulkan"
 
@@ -17,6 +19,9 @@ when USE_VULKAN_BACKEND {
 	BACKEND_COMPILED_SHADERS_FOLDER :: "sprv"
 	BACKEND_COMPILED_SHADERS_EXTENSION :: "sprv"
 
+	@(private = "file")
+	DXC_ARGS :: "-spirv -fspv-target-env=vulkan1.3 -HV 2021"
+
 	//---------------------------------------------------------------------------//
 
 	@(private)
@@ -141,7 +146,8 @@ when USE_VULKAN_BACKEND {
 		// @TODO strip debug info
 		compile_cmd := common.aprintf(
 			temp_arena.allocator,
-			"dxc -spirv -fspv-target-env=vulkan1.3 -HV 2021 -T %s -Fo %s %s %s -E %s",
+			"dxc %s -T %s -Fo %s %s %s -E %s",
+			DXC_ARGS,
 			compile_target,
 			p_bin_path,
 			p_src_path,
@@ -160,6 +166,39 @@ when USE_VULKAN_BACKEND {
 
 	//---------------------------------------------------------------------------//
 
+	// Identifies the compiler output, so that the cached shaders are compiled again
+	// when dxc is updated or invoked with different arguments
+	@(private)
+	backend_shader_compiler_get_id :: proc(p_allocator: mem.Allocator) -> string {
+
+		temp_arena: common.Arena
+		common.temp_arena_init(&temp_arena)
+		defer common.arena_delete(temp_arena)
+
+		version_path := common.aprintf(
+			temp_arena.allocator,
+			"%s%s/dxc_version.txt",
+			BASE_SHADERS_PATH,
+			BACKEND_COMPILED_SHADERS_FOLDER,
+		)
+		version_cmd := common.aprintf(temp_arena.allocator, "dxc --version > %s", version_path)
+
+		version := "unknown"
+		if libc.system(strings.clone_to_cstring(version_cmd, temp_arena.allocator)) == 0 {
+			if version_output, read_ok := os.read_entire_file(version_path, temp_arena.allocator);
+			   read_ok {
+				version = strings.trim_space(string(version_output))
+			}
+		} else {
+			log.warn("Failed to query the dxc version\n")
+		}
+		os.remove(version_path)
+
+		return common.aprintf(p_allocator, "%s (%s)", version, DXC_ARGS)
+	}
+
+	//---------------------------------------------------------------------------//
+
 	@(private="file")
 	safe_destroy_vk_module :: proc(p_user_data: rawptr) {
 		vk_module := (^vk.ShaderModule)(p_user_data)
@@ -0,0 +1,161 @@
+package renderer
+
+//---------------------------------------------------------------------------//
+
+import "core:log"
+import vk "vendor:vulkan"
+
+//---------------------------------------------------------------------------//
+
+when USE_VULKAN_BACKEND {
+
+	//---------------------------------------------------------------------------//
+
+	@(private = "file")
+	INTERNAL: struct {
+		// Signaled by the graphics work recorded before the async compute tasks, per frame
+		graphics_semaphores: []vk.Semaphore,
+		// Signaled by the main async compute command buffer, per frame
+		compute_semaphores:  []vk.Semaphore,
+	}
+
+	//---------------------------------------------------------------------------//
+
+	@(private)
+	backend_async_compute_init :: proc() -> bool {
+		INTERNAL.graphics_semaphores = make(
+			[]vk.Semaphore,
+			G_RENDERER.num_frames_in_flight,
+			G_RENDERER_ALLOCATORS.main_allocator,
+		)
+		INTERNAL.compute_semaphores = make(
+			[]vk.Semaphore,
+			G_RENDERER.num_frames_in_flight,
+			G_RENDERER_ALLOCATORS.main_allocator,
+		)
+
+		semaphore_create_info := vk.SemaphoreCreateInfo {
+			sType = .SEMAPHORE_CREATE_INFO,
+		}
+
+		for i in 0 ..< G_RENDERER.num_frames_in_flight {
+			if vk.CreateSemaphore(
+				   G_RENDERER.device,
+				   &semaphore_create_info,
+				   nil,
+				   &INTERNAL.graphics_semaphores[i],
+			   ) !=
+			   .SUCCESS {
+				log.error("Failed to create the async compute semaphores\n")
+				return false
+			}
+			if vk.CreateSemaphore(
+				   G_RENDERER.device,
+				   &semaphore_create_info,
+				   nil,
+				   &INTERNAL.compute_semaphores[i],
+			   ) !=
+			   .SUCCESS {
+				log.error("Failed to create the async compute semaphores\n")
+				return false
+			}
+		}
+
+		return true
+	}
+
+	//---------------------------------------------------------------------------//
+
+	@(private)
+	backend_async_compute_deinit :: proc() {
+		for i in 0 ..< G_RENDERER.num_frames_in_flight {
+			vk.DestroySemaphore(G_RENDERER.device, INTERNAL.graphics_semaphores[i], nil)
+			vk.DestroySemaphore(G_RENDERER.device, INTERNAL.compute_semaphores[i], nil)
+		}
+		delete(INTERNAL.graphics_semaphores, G_RENDERER_ALLOCATORS.main_allocator)
+		delete(INTERNAL.compute_semaphores, G_RENDERER_ALLOCATORS.main_allocator)
+	}
+
+	//---------------------------------------------------------------------------//
+
+	// Submits the graphics work recorded before the async compute tasks and the async compute
+	// work itself. Returns the semaphore the rest of the graphics work has to wait for.
+	@(private)
+	backend_async_compute_submit :: proc() -> vk.Semaphore {
+		frame_idx := get_frame_idx()
+
+		graphics_semaphore := INTERNAL.graphics_semaphores[frame_idx]
+		compute_semaphore := INTERNAL.compute_semaphores[frame_idx]
+
+		pre_async_compute_cmd_buff := get_vk_cmd_buff(G_RENDERER.primary_cmd_buffer_ref[frame_idx])
+		compute_cmd_buffs := [AsyncComputeStage]vk.CommandBuffer {
+			.Early = get_vk_cmd_buff(get_frame_async_compute_cmd_buffer_ref(.Early)),
+			.Main  = get_vk_cmd_buff(get_frame_async_compute_cmd_buffer_ref(.Main)),
+		}
+
+		// Graphics work the async compute depends on
+		{
+			submit_info := vk.SubmitInfo {
+				sType                = .SUBMIT_INFO,
+				commandBufferCount   = 1,
+				pCommandBuffers      = &pre_async_compute_cmd_buff,
+				signalSemaphoreCount = 1,
+				pSignalSemaphores    = &graphics_semaphore,
+			}
+			vk.QueueSubmit(G_RENDERER.graphics_queue, 1, &submit_info, 0)
+		}
+
+		// The semaphore also makes the writes of the graphics queue visible,
+		// so the acquire barriers don't need a source scope
+		wait_stage := vk.PipelineStageFlags{.ALL_COMMANDS}
+
+		// The early resources had to be acquired from the graphics queue,
+		// so both of the compute command buffers wait for it
+		if async_compute_early_waits_for_graphics() {
+			submit_info := vk.SubmitInfo {
+				sType                = .SUBMIT_INFO,
+				waitSemaphoreCount   = 1,
+				pWaitSemaphores      = &graphics_semaphore,
+				pWaitDstStageMask    = &wait_stage,
+				commandBufferCount   = len(compute_cmd_buffs),
+				pCommandBuffers      = &compute_cmd_buffs[.Early],
+				signalSemaphoreCount = 1,
+				pSignalSemaphores    = &compute_semaphore,
+			}
+			vk.QueueSubmit(G_RENDERER.compute_queue, 1, &submit_info, 0)
+			return compute_semaphore
+		}
+
+		submit_infos := [2]vk.SubmitInfo {
+			{
+				sType = .SUBMIT_INFO,
+				commandBufferCount = 1,
+				pCommandBuffers = &compute_cmd_buffs[.Early],
+			},
+			{
+				sType = .SUBMIT_INFO,
+				waitSemaphoreCount = 1,
+				pWaitSemaphores = &graphics_semaphore,
+				pWaitDstStageMask = &wait_stage,
+				commandBufferCount = 1,
+				pCommandBuffers = &compute_cmd_buffs[.Main],
+				signalSemaphoreCount = 1,
+				pSignalSemaphores = &compute_semaphore,
+			},
+		}
+		vk.QueueSubmit(G_RENDERER.compute_queue, len(submit_infos), &submit_infos[0], 0)
+
+		return compute_semaphore
+	}
+
+	//---------------------------------------------------------------------------//
+
+	@(private = "file")
+	get_vk_cmd_buff :: #force_inline proc(p_cmd_buff_ref: CommandBufferRef) -> vk.CommandBuffer {
+		return g_resources.backend_cmd_buffers[command_buffer_get_idx(p_cmd_buff_ref)].vk_cmd_buff
+	}
+
+	//---------------------------------------------------------------------------//
+}
+
+//---------------------------------------------------------------------------//
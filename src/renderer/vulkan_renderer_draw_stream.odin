@@ -73,11 +73,62 @@ when USE_VULKAN_BACKEND {
 		p_first_instance: u32,
 		p_pipeline_ref: GraphicsPipelineRef,
 		p_push_constant: []rawptr,
+	) {
+		backend_cmd_buffer := &g_resources.backend_cmd_buffers[command_buffer_get_idx(p_cmd_buff_ref)]
+
+		push_draw_constants(backend_cmd_buffer.vk_cmd_buff, p_pipeline_ref, p_push_constant)
+
+		vk.CmdDrawIndexed(
+			backend_cmd_buffer.vk_cmd_buff,
+			p_index_count,
+			p_instance_count,
+			0,
+			0,
+			p_first_instance,
+		)
+	}
+
+	//---------------------------------------------------------------------------//
+
+	@(private)
+	backend_draw_stream_submit_indexed_indirect_draw :: #force_inline proc(
+		p_cmd_buff_ref: CommandBufferRef,
+		p_args_buffer_ref: BufferRef,
+		p_args_offset: u32,
+		p_count_buffer_ref: BufferRef,
+		p_count_offset: u32,
+		p_max_draw_count: u32,
+		p_pipeline_ref: GraphicsPipelineRef,
+		p_push_constant: []rawptr,
+	) {
+		backend_cmd_buffer := &g_resources.backend_cmd_buffers[command_buffer_get_idx(p_cmd_buff_ref)]
+		args_buffer := &g_resources.backend_buffers[buffer_get_idx(p_args_buffer_ref)]
+		count_buffer := &g_resources.backend_buffers[buffer_get_idx(p_count_buffer_ref)]
+
+		push_draw_constants(backend_cmd_buffer.vk_cmd_buff, p_pipeline_ref, p_push_constant)
+
+		vk.CmdDrawIndexedIndirectCountKHR(
+			backend_cmd_buffer.vk_cmd_buff,
+			args_buffer.vk_buffer,
+			vk.DeviceSize(p_args_offset),
+			count_buffer.vk_buffer,
+			vk.DeviceSize(p_count_offset),
+			p_max_draw_count,
+			size_of(vk.DrawIndexedIndirectCommand),
+		)
+	}
+
+	//---------------------------------------------------------------------------//
+
+	@(private = "file")
+	push_draw_constants :: #force_inline proc(
+		p_vk_cmd_buff: vk.CommandBuffer,
+		p_pipeline_ref: GraphicsPipelineRef,
+		p_push_constant: []rawptr,
 	) {
 		pipeline_idx := graphics_pipeline_get_idx(p_pipeline_ref)
 		pipeline := &g_resources.graphics_pipelines[pipeline_idx]
 		backend_pipeline := &g_resources.backend_graphics_pipelines[pipeline_idx]
-		backend_cmd_buffer := &g_resources.backend_cmd_buffers[command_buffer_get_idx(p_cmd_buff_ref)]
 
 		for push_constant, i in pipeline.desc.push_constants {
 
@@ -92,7 +143,7 @@ when USE_VULKAN_BACKEND {
 			}
 
 			vk.CmdPushConstants(
-				backend_cmd_buffer.vk_cmd_buff,
+				p_vk_cmd_buff,
 				backend_pipeline.vk_pipeline_layout,
 				stage_flags,
 				push_constant.offset_in_bytes,
@@ -100,15 +151,6 @@ when USE_VULKAN_BACKEND {
 				p_push_constant[i],
 			)
 		}
-
-		vk.CmdDrawIndexed(
-			backend_cmd_buffer.vk_cmd_buff,
-			p_index_count,
-			p_instance_count,
-			0,
-			0,
-			p_first_instance,
-		)
 	}
 
 	//---------------------------------------------------------------------------//
@@ -0,0 +1,189 @@
+package renderer
+
+//---------------------------------------------------------------------------//
+
+import "../common"
+import "core:log"
+import vk "vendor:vulkan"
+
+//---------------------------------------------------------------------------//
+
+when USE_VULKAN_BACKEND {
+
+	//---------------------------------------------------------------------------//
+
+	@(private = "file")
+	INTERNAL: struct {
+		// One pool per frame in flight
+		query_pools:                       []vk.QueryPool,
+		timestamp_period:                  f32,
+		timestamp_mask:                    u64,
+		supports_async_compute_timestamps: bool,
+	}
+
+	//---------------------------------------------------------------------------//
+
+	@(private)
+	backend_gpu_profiler_init :: proc() -> bool {
+
+		temp_arena: common.Arena
+		common.temp_arena_init(&temp_arena)
+		defer common.arena_delete(temp_arena)
+
+		device_properties: vk.PhysicalDeviceProperties
+		vk.GetPhysicalDeviceProperties(G_RENDERER.physical_device, &device_properties)
+
+		queue_family_count: u32
+		vk.GetPhysicalDeviceQueueFamilyProperties(
+			G_RENDERER.physical_device,
+			&queue_family_count,
+			nil,
+		)
+		queue_families := make([]vk.QueueFamilyProperties, queue_family_count, temp_arena.allocator)
+		vk.GetPhysicalDeviceQueueFamilyProperties(
+			G_RENDERER.physical_device,
+			&queue_family_count,
+			raw_data(queue_families),
+		)
+
+		timestamp_valid_bits :=
+			queue_families[G_RENDERER.queue_family_graphics_index].timestampValidBits
+		if timestamp_valid_bits == 0 || device_properties.limits.timestampPeriod == 0 {
+			log.warn("GPU timestamps aren't supported, GPU profiling is disabled\n")
+			return false
+		}
+
+		// The async compute regions are only measured when the compute queue supports timestamps
+		if .DedicatedComputeQueue in G_RENDERER.gpu_device_flags {
+			compute_timestamp_valid_bits :=
+				queue_families[G_RENDERER.queue_family_compute_index].timestampValidBits
+			if compute_timestamp_valid_bits > 0 {
+				INTERNAL.supports_async_compute_timestamps = true
+				timestamp_valid_bits = min(timestamp_valid_bits, compute_timestamp_valid_bits)
+			}
+		}
+
+		INTERNAL.timestamp_period = device_properties.limits.timestampPeriod
+		INTERNAL.timestamp_mask =
+			timestamp_valid_bits >= 64 ? max(u64) : (u64(1) << timestamp_valid_bits) - 1
+
+		INTERNAL.query_pools = make(
+			[]vk.QueryPool,
+			G_RENDERER.num_frames_in_flight,
+			G_RENDERER_ALLOCATORS.main_allocator,
+		)
+
+		for &query_pool, frame_idx in INTERNAL.query_pools {
+			create_info := vk.QueryPoolCreateInfo {
+				sType      = .QUERY_POOL_CREATE_INFO,
+				queryType  = .TIMESTAMP,
+				queryCount = GPU_PROFILER_MAX_QUERIES_PER_FRAME,
+			}
+			if vk.CreateQueryPool(G_RENDERER.device, &create_info, nil, &query_pool) != .SUCCESS {
+				log.error("Failed to create the GPU profiler query pool\n")
+				INTERNAL.query_pools = INTERNAL.query_pools[:frame_idx]
+				backend_gpu_profiler_deinit()
+				return false
+			}
+
+			// The queries have to be reset before their first use
+			vk.ResetQueryPool(G_RENDERER.device, query_pool, 0, GPU_PROFILER_MAX_QUERIES_PER_FRAME)
+		}
+
+		return true
+	}
+
+	//---------------------------------------------------------------------------//
+
+	@(private)
+	backend_gpu_profiler_deinit :: proc() {
+		for query_pool in INTERNAL.query_pools {
+			vk.DestroyQueryPool(G_RENDERER.device, query_pool, nil)
+		}
+		delete(INTERNAL.query_pools, G_RENDERER_ALLOCATORS.main_allocator)
+	}
+
+	//---------------------------------------------------------------------------//
+
+	// The pool is reset from the host, the frame fence guarantees that the GPU is done with it
+	@(private)
+	backend_gpu_profiler_reset_queries :: proc(p_frame_idx: u32) {
+		vk.ResetQueryPool(
+			G_RENDERER.device,
+			INTERNAL.query_pools[p_frame_idx],
+			0,
+			GPU_PROFILER_MAX_QUERIES_PER_FRAME,
+		)
+	}
+
+	//---------------------------------------------------------------------------//
+
+	@(private)
+	backend_gpu_profiler_supports_cmd_buffer :: proc(p_cmd_buff_ref: CommandBufferRef) -> bool {
+		return(
+			command_buffer_is_async_compute(p_cmd_buff_ref) == false ||
+			INTERNAL.supports_async_compute_timestamps 		)
+	}
+
+	//---------------------------------------------------------------------------//
+
+	@(private)
+	backend_gpu_profiler_write_timestamp :: proc(
+		p_cmd_buff_ref: CommandBufferRef,
+		p_frame_idx: u32,
+		p_query: u32,
+		p_is_region_end: bool,
+	) {
+		cmd_buff := g_resources.backend_cmd_buffers[command_buffer_get_idx(p_cmd_buff_ref)]
+
+		// The beginning of the region is marked as soon as the GPU gets to it,
+		// the end once all of the previous commands are done
+		stage := vk.PipelineStageFlags2{.TOP_OF_PIPE}
+		if p_is_region_end {
+			stage = {.ALL_COMMANDS}
+		}
+
+		vk.CmdWriteTimestamp2(
+			cmd_buff.vk_cmd_buff,
+			stage,
+			INTERNAL.query_pools[p_frame_idx],
+			p_query,
+		)
+	}
+
+	//---------------------------------------------------------------------------//
+
+	@(private)
+	backend_gpu_profiler_read_timestamps :: proc(p_frame_idx: u32, p_timestamps: []u64) -> bool {
+		res := vk.GetQueryPoolResults(
+			G_RENDERER.device,
+			INTERNAL.query_pools[p_frame_idx],
+			0,
+			u32(len(p_timestamps)),
+			len(p_timestamps) * size_of(u64),
+			raw_data(p_timestamps),
+			size_of(u64),
+			{._64},
+		)
+		if res != .SUCCESS {
+			return false
+		}
+
+		for &timestamp in p_timestamps {
+			timestamp &= INTERNAL.timestamp_mask
+		}
+
+		return true
+	}
+
+	//---------------------------------------------------------------------------//
+
+	@(private)
+	backend_gpu_profiler_timestamp_to_ns :: #force_inline proc(p_timestamp_delta: u64) -> i64 {
+		return i64(f64(p_timestamp_delta) * f64(INTERNAL.timestamp_period))
+	}
+
+	//---------------------------------------------------------------------------//
+}
+
+//---------------------------------------------------------------------------//
@@ -3,6 +3,7 @@ package renderer
 //---------------------------------------------------------------------------//
 
 import "../common"
+import "core:sync"
 import vk "vendor:vulkan"
 
 //---------------------------------------------------------------------------//
@@ -13,13 +14,33 @@ when USE_VULKAN_BACKEND {
 
 	@(private = "file")
 	INTERNAL: struct {
-		descriptor_pool: vk.DescriptorPool,
+		descriptor_pool:         vk.DescriptorPool,
+		// Guards the transient variants, bind groups can be bound from the recording threads
+		transient_variants_lock: sync.Mutex,
+	}
+
+	//---------------------------------------------------------------------------//
+
+	// Maximum number of dynamic offsets passed when binding a single bind group
+	@(private = "file")
+	MAX_BIND_GROUP_DYNAMIC_OFFSETS :: 16
+
+	//---------------------------------------------------------------------------//
+
+	// Copy of one of the bind group's descriptor sets with its transient
+	// uniform bindings pointing at transient buffer overflow pages
+	@(private = "file")
+	BackendBindGroupTransientVariant :: struct {
+		descriptor_set_idx: u32,
+		page_indices:       [MAX_BIND_GROUP_TRANSIENT_BINDINGS]u32,
+		vk_descriptor_set:  vk.DescriptorSet,
 	}
 
 	//---------------------------------------------------------------------------//
 
 	BackendBindGroupResource :: struct {
 		vk_descriptor_sets: []vk.DescriptorSet,
+		transient_variants: [dynamic]BackendBindGroupTransientVariant,
 	}
 
 	//---------------------------------------------------------------------------//
@@ -111,10 +132,14 @@ when USE_VULKAN_BACKEND {
 		p_target: u32,
 		p_dynamic_offsets: []u32,
 	) {
-		bind_group := &g_resources.bind_groups[bind_group_get_idx(p_bind_group_ref)]
-
 		backend_cmd_buffer := &g_resources.backend_cmd_buffers[command_buffer_get_idx(p_cmd_buff_ref)]
-		backend_bind_group := &g_resources.backend_bind_groups[bind_group_get_idx(p_bind_group_ref)]
+
+		dynamic_offsets: [MAX_BIND_GROUP_DYNAMIC_OFFSETS]u32
+		descriptor_set := backend_bind_group_get_descriptor_set(
+			p_bind_group_ref,
+			p_dynamic_offsets,
+			dynamic_offsets[:len(p_dynamic_offsets)],
+		)
 
 		pipeline_idx := graphics_pipeline_get_idx(p_pipeline_ref)
 		backend_pipeline := &g_resources.backend_graphics_pipelines[pipeline_idx]
@@ -125,9 +150,9 @@ when USE_VULKAN_BACKEND {
 			backend_pipeline.vk_pipeline_layout,
 			p_target,
 			1,
-			&backend_bind_group.vk_descriptor_sets[0 if .GlobalBindGroup in bind_group.desc.flags else get_frame_idx()],
+			&descriptor_set,
 			u32(len(p_dynamic_offsets)),
-			raw_data(p_dynamic_offsets),
+			&dynamic_offsets[0],
 		)
 	}
 
@@ -141,10 +166,14 @@ when USE_VULKAN_BACKEND {
 		p_target: u32,
 		p_dynamic_offsets: []u32,
 	) {
-		bind_group := &g_resources.bind_groups[bind_group_get_idx(p_bind_group_ref)]
-
 		backend_cmd_buffer := &g_resources.backend_cmd_buffers[command_buffer_get_idx(p_cmd_buff_ref)]
-		backend_bind_group := &g_resources.backend_bind_groups[bind_group_get_idx(p_bind_group_ref)]
+
+		dynamic_offsets: [MAX_BIND_GROUP_DYNAMIC_OFFSETS]u32
+		descriptor_set := backend_bind_group_get_descriptor_set(
+			p_bind_group_ref,
+			p_dynamic_offsets,
+			dynamic_offsets[:len(p_dynamic_offsets)],
+		)
 
 		pipeline_idx := compute_pipeline_get_idx(p_pipeline_ref)
 		backend_pipeline := &g_resources.backend_compute_pipelines[pipeline_idx]
@@ -155,9 +184,9 @@ when USE_VULKAN_BACKEND {
 			backend_pipeline.vk_pipeline_layout,
 			p_target,
 			1,
-			&backend_bind_group.vk_descriptor_sets[0 if .GlobalBindGroup in bind_group.desc.flags else get_frame_idx()],
+			&descriptor_set,
 			u32(len(p_dynamic_offsets)),
-			raw_data(p_dynamic_offsets),
+			&dynamic_offsets[0],
 		)
 	}
 
@@ -177,6 +206,10 @@ when USE_VULKAN_BACKEND {
 		}
 
 		delete(backend_bind_group.vk_descriptor_sets, G_RENDERER_ALLOCATORS.resource_allocator)
+
+		backend_bind_group_free_transient_variants(bind_group_idx)
+		delete(backend_bind_group.transient_variants)
+		backend_bind_group.transient_variants = nil
 	}
 
 	//---------------------------------------------------------------------------//
@@ -191,6 +224,9 @@ when USE_VULKAN_BACKEND {
 		bind_group := &g_resources.bind_groups[bind_group_idx]
 		backend_bind_group := &g_resources.backend_bind_groups[bind_group_idx]
 
+		// The variants are copies of the old descriptors
+		backend_bind_group_free_transient_variants(bind_group_idx)
+
 		// Allocate descriptor write array (for now we just write the entire bind group, no dirty bindings checking)
 		buffer_infos_count := len(p_bind_group_update.buffers)
 
@@ -392,6 +428,209 @@ when USE_VULKAN_BACKEND {
 
 	//---------------------------------------------------------------------------//
 
+	// Returns the descriptor set to bind for the current frame and writes the dynamic offsets to bind it
+	// with. Dynamic offsets of the transient uniform bindings that point at an overflow page are
+	// rebased on that page, and a variant of the descriptor set pointing at the page is used instead.
+	@(private = "file")
+	backend_bind_group_get_descriptor_set :: proc(
+		p_bind_group_ref: BindGroupRef,
+		p_dynamic_offsets: []u32,
+		p_resolved_dynamic_offsets: []u32,
+	) -> vk.DescriptorSet {
+		bind_group_idx := bind_group_get_idx(p_bind_group_ref)
+		bind_group := &g_resources.bind_groups[bind_group_idx]
+		backend_bind_group := &g_resources.backend_bind_groups[bind_group_idx]
+
+		descriptor_set_idx := 0 if .GlobalBindGroup in bind_group.desc.flags else get_frame_idx()
+
+		assert(len(p_dynamic_offsets) <= MAX_BIND_GROUP_DYNAMIC_OFFSETS)
+		copy(p_resolved_dynamic_offsets, p_dynamic_offsets)
+
+		page_indices: [MAX_BIND_GROUP_TRANSIENT_BINDINGS]u32
+		uses_overflow_pages := false
+
+		for transient_binding, i in bind_group.transient_bindings[:bind_group.num_transient_bindings] {
+			if int(transient_binding.dynamic_offset_idx) >= len(p_dynamic_offsets) {
+				continue
+			}
+
+			page_indices[i], p_resolved_dynamic_offsets[transient_binding.dynamic_offset_idx] =
+				transient_buffer_resolve_uniform_offset(
+					p_dynamic_offsets[transient_binding.dynamic_offset_idx],
+				)
+
+			uses_overflow_pages |= page_indices[i] > 0
+		}
+
+		if uses_overflow_pages == false {
+			return backend_bind_group.vk_descriptor_sets[descriptor_set_idx]
+		}
+
+		sync.mutex_lock(&INTERNAL.transient_variants_lock)
+		defer sync.mutex_unlock(&INTERNAL.transient_variants_lock)
+
+		for variant in backend_bind_group.transient_variants {
+			if variant.descriptor_set_idx == descriptor_set_idx &&
+			   variant.page_indices == page_indices {
+				return variant.vk_descriptor_set
+			}
+		}
+
+		return backend_bind_group_create_transient_variant(
+			p_bind_group_ref,
+			descriptor_set_idx,
+			page_indices,
+		)
+	}
+
+	//---------------------------------------------------------------------------//
+
+	@(private = "file")
+	backend_bind_group_create_transient_variant :: proc(
+		p_bind_group_ref: BindGroupRef,
+		p_descriptor_set_idx: u32,
+		p_page_indices: [MAX_BIND_GROUP_TRANSIENT_BINDINGS]u32,
+	) -> vk.DescriptorSet {
+
+		temp_arena: common.Arena
+		common.temp_arena_init(&temp_arena)
+		defer common.arena_delete(temp_arena)
+
+		bind_group_idx := bind_group_get_idx(p_bind_group_ref)
+		bind_group := &g_resources.bind_groups[bind_group_idx]
+		backend_bind_group := &g_resources.backend_bind_groups[bind_group_idx]
+
+		bind_group_layout_idx := bind_group_layout_get_idx(bind_group.desc.layout_ref)
+		bind_group_layout := &g_resources.bind_group_layouts[bind_group_layout_idx]
+		backend_bind_group_layout := &g_resources.backend_bind_group_layouts[bind_group_layout_idx]
+
+		base_descriptor_set := backend_bind_group.vk_descriptor_sets[p_descriptor_set_idx]
+
+		descriptor_set_alloc_info := vk.DescriptorSetAllocateInfo {
+			sType              = .DESCRIPTOR_SET_ALLOCATE_INFO,
+			pSetLayouts        = &backend_bind_group_layout.vk_descriptor_set_layout,
+			descriptorSetCount = 1,
+			descriptorPool     = INTERNAL.descriptor_pool,
+		}
+
+		vk_descriptor_set: vk.DescriptorSet
+		if vk.AllocateDescriptorSets(G_RENDERER.device, &descriptor_set_alloc_info, &vk_descriptor_set) !=
+		   .SUCCESS {
+			// Fall back to the base descriptor set, the data will be read from the home page
+			assert(false, "Failed to allocate a transient bind group variant")
+			return base_descriptor_set
+		}
+
+		// Copy the descriptors of the base set. Immutable samplers are part of the layout,
+		// and bindless arrays are never used together with transient uniforms.
+		descriptor_copies := make([dynamic]vk.CopyDescriptorSet, temp_arena.allocator)
+		for binding, binding_idx in bind_group_layout.desc.bindings {
+			if binding.type == .Sampler || .BindlessImageArray in binding.flags {
+				continue
+			}
+
+			append(
+				&descriptor_copies,
+				vk.CopyDescriptorSet {
+					sType = .COPY_DESCRIPTOR_SET,
+					srcSet = base_descriptor_set,
+					srcBinding = u32(binding_idx),
+					dstSet = vk_descriptor_set,
+					dstBinding = u32(binding_idx),
+					descriptorCount = binding.count,
+				},
+			)
+		}
+
+		// Point the transient bindings at their overflow pages
+		descriptor_writes := make([dynamic]vk.WriteDescriptorSet, temp_arena.allocator)
+		buffer_writes := make(
+			[]vk.DescriptorBufferInfo,
+			bind_group.num_transient_bindings,
+			temp_arena.allocator,
+		)
+
+		for transient_binding, i in bind_group.transient_bindings[:bind_group.num_transient_bindings] {
+			if p_page_indices[i] == 0 {
+				continue
+			}
+
+			page_buffer_ref := transient_buffer_get_uniform_page_buffer_ref(p_page_indices[i])
+			backend_page_buffer := &g_resources.backend_buffers[buffer_get_idx(page_buffer_ref)]
+
+			buffer_writes[i] = vk.DescriptorBufferInfo {
+				buffer = backend_page_buffer.vk_buffer,
+				offset = 0,
+				range  = vk.DeviceSize(transient_binding.size),
+			}
+
+			append(
+				&descriptor_writes,
+				vk.WriteDescriptorSet {
+					sType = .WRITE_DESCRIPTOR_SET,
+					descriptorCount = 1,
+					dstBinding = transient_binding.binding,
+					descriptorType = .UNIFORM_BUFFER_DYNAMIC,
+					dstSet = vk_descriptor_set,
+					pBufferInfo = &buffer_writes[i],
+				},
+			)
+		}
+
+		// Writes are performed before copies within a single call, so copy first
+		vk.UpdateDescriptorSets(
+			G_RENDERER.device,
+			0,
+			nil,
+			u32(len(descriptor_copies)),
+			raw_data(descriptor_copies),
+		)
+		vk.UpdateDescriptorSets(
+			G_RENDERER.device,
+			u32(len(descriptor_writes)),
+			raw_data(descriptor_writes),
+			0,
+			nil,
+		)
+
+		if backend_bind_group.transient_variants == nil {
+			backend_bind_group.transient_variants = make(
+				[dynamic]BackendBindGroupTransientVariant,
+				G_RENDERER_ALLOCATORS.resource_allocator,
+			)
+		}
+
+		append(
+			&backend_bind_group.transient_variants,
+			BackendBindGroupTransientVariant {
+				descriptor_set_idx = p_descriptor_set_idx,
+				page_indices = p_page_indices,
+				vk_descriptor_set = vk_descriptor_set,
+			},
+		)
+
+		return vk_descriptor_set
+	}
+
+	//---------------------------------------------------------------------------//
+
+	@(private = "file")
+	backend_bind_group_free_transient_variants :: proc(p_bind_group_idx: u32) {
+		backend_bind_group := &g_resources.backend_bind_groups[p_bind_group_idx]
+
+		for variant in backend_bind_group.transient_variants {
+			descriptor_set_to_delete := defer_resource_delete(
+				safe_destroy_descriptor_set,
+				vk.DescriptorSet,
+			)
+			descriptor_set_to_delete^ = variant.vk_descriptor_set
+		}
+
+		clear(&backend_bind_group.transient_variants)
+	}
+
+	//---------------------------------------------------------------------------//
+
 	@(private = "file")
 	is_buffer_binding :: #force_inline proc(p_binding_type: BindGroupLayoutBindingType) -> bool {
 		return(
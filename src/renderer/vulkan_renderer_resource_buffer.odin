@@ -21,6 +21,8 @@ when USE_VULKAN_BACKEND {
 		vk_buffer:               vk.Buffer,
 		allocation:              vma.Allocation,
 		owning_queue_family_idx: u32,
+		// Stages of the last shader write, waited on by the next barrier
+		last_write_stages:       vk.PipelineStageFlags2,
 	}
 
 	//---------------------------------------------------------------------------//
@@ -40,6 +42,7 @@ when USE_VULKAN_BACKEND {
 		.VertexBuffer         = .VERTEX_BUFFER,
 		.StorageBuffer        = .STORAGE_BUFFER,
 		.DynamicStorageBuffer = .STORAGE_BUFFER,
+		.IndirectBuffer       = .INDIRECT_BUFFER,
 	}
 
 	//---------------------------------------------------------------------------//
@@ -80,6 +83,18 @@ when USE_VULKAN_BACKEND {
 			sharingMode = .EXCLUSIVE,
 		}
 
+		// Used by both the graphics and the async compute queue without ownership transfers
+		concurrent_queue_families := [2]u32 {
+			G_RENDERER.queue_family_graphics_index,
+			G_RENDERER.queue_family_compute_index,
+		}
+		if .SharingModeConcurrent in buffer.desc.flags &&
+		   .DedicatedComputeQueue in G_RENDERER.gpu_device_flags {
+			buffer_create_info.sharingMode = .CONCURRENT
+			buffer_create_info.queueFamilyIndexCount = len(concurrent_queue_families)
+			buffer_create_info.pQueueFamilyIndices = &concurrent_queue_families[0]
+		}
+
 		alloc_usage: vma.MemoryUsage = .AUTO
 		if .PreferHost in buffer.desc.flags {
 			alloc_usage = .AUTO_PREFER_HOST
@@ -2,6 +2,7 @@ package renderer
 
 //---------------------------------------------------------------------------//
 
+import "../common"
 import "core:log"
 import vk "vendor:vulkan"
 
@@ -14,6 +15,8 @@ when USE_VULKAN_BACKEND {
 	@(private)
 	BackendCommandBufferResource :: struct {
 		vk_cmd_buff: vk.CommandBuffer,
+		// Secondary command buffers have their own pool, so they can be recorded in parallel
+		vk_cmd_pool: vk.CommandPool,
 	}
 
 	//---------------------------------------------------------------------------//
@@ -26,7 +29,6 @@ when USE_VULKAN_BACKEND {
 		compute_command_pools:              []vk.CommandPool,
 		transfer_cmd_buffers_pre_graphics:  []vk.CommandBuffer,
 		transfer_cmd_buffers_post_graphics: []vk.CommandBuffer,
-		compute_cmd_buffers:                []vk.CommandBuffer,
 		immediate_submit_command_pool:      vk.CommandPool,
 		immediate_submit_cmd_buffer:        vk.CommandBuffer,
 		immediate_submit_fence:             vk.Fence,
@@ -86,24 +88,20 @@ when USE_VULKAN_BACKEND {
 			) or_return
 		}
 
-		// Create command pools for compute queue if the GPU has a dedicated one
+		// Create command pools for compute queue if the GPU has a dedicated one, the async compute
+		// command buffers are allocated from them, see renderer_async_compute.odin
 		if .DedicatedComputeQueue in G_RENDERER.gpu_device_flags {
 			INTERNAL.compute_command_pools = make(
 				[]vk.CommandPool,
 				int(G_RENDERER.num_frames_in_flight),
 				G_RENDERER_ALLOCATORS.resource_allocator,
 			)
-			INTERNAL.compute_cmd_buffers = make(
-				[]vk.CommandBuffer,
-				int(G_RENDERER.num_frames_in_flight),
-				G_RENDERER_ALLOCATORS.resource_allocator,
-			)
 			command_pools_create(
 				u32(G_RENDERER.queue_family_compute_index),
-				true,
+				false,
 				true,
 				INTERNAL.compute_command_pools,
-				INTERNAL.compute_cmd_buffers,
+				nil,
 			) or_return
 		}
 
@@ -207,10 +205,30 @@ when USE_VULKAN_BACKEND {
 		cmd_buffer := &g_resources.cmd_buffers[cmd_buffer_idx]
 		backend_cmd_buffer := &g_resources.backend_cmd_buffers[cmd_buffer_idx]
 
+		is_primary := .Primary in cmd_buffer.desc.flags
+
+		cmd_pool := INTERNAL.graphics_command_pools[cmd_buffer.desc.frame]
+		if .AsyncCompute in cmd_buffer.desc.flags {
+			assert(is_primary)
+			cmd_pool = INTERNAL.compute_command_pools[cmd_buffer.desc.frame]
+		}
+		if is_primary == false {
+			pool_info := vk.CommandPoolCreateInfo {
+				sType            = .COMMAND_POOL_CREATE_INFO,
+				queueFamilyIndex = G_RENDERER.queue_family_graphics_index,
+				flags            = {.RESET_COMMAND_BUFFER},
+			}
+			if vk.CreateCommandPool(G_RENDERER.device, &pool_info, nil, &cmd_pool) != .SUCCESS {
+				log.error("Couldn't create command pool")
+				return false
+			}
+			backend_cmd_buffer.vk_cmd_pool = cmd_pool
+		}
+
 		alloc_info := vk.CommandBufferAllocateInfo {
 			sType              = .COMMAND_BUFFER_ALLOCATE_INFO,
-			commandPool        = INTERNAL.graphics_command_pools[cmd_buffer.desc.frame],
-			level              = .PRIMARY if .Primary in cmd_buffer.desc.flags else .SECONDARY,
+			commandPool        = cmd_pool,
+			level              = .PRIMARY if is_primary else .SECONDARY,
 			commandBufferCount = 1,
 		}
 
@@ -256,11 +274,81 @@ when USE_VULKAN_BACKEND {
 		cmd_buffer := &g_resources.cmd_buffers[cmd_buffer_idx]
 		backend_cmd_buffer := &g_resources.backend_cmd_buffers[cmd_buffer_idx]
 
-		vk.FreeCommandBuffers(
-			G_RENDERER.device,
-			INTERNAL.graphics_command_pools[cmd_buffer.desc.thread],
-			1,
-			&backend_cmd_buffer.vk_cmd_buff,
+		// Destroying the pool frees it's command buffers
+		if backend_cmd_buffer.vk_cmd_pool != 0 {
+			vk.DestroyCommandPool(G_RENDERER.device, backend_cmd_buffer.vk_cmd_pool, nil)
+			backend_cmd_buffer.vk_cmd_pool = 0
+			return
+		}
+
+		cmd_pool := INTERNAL.graphics_command_pools[cmd_buffer.desc.frame]
+		if .AsyncCompute in cmd_buffer.desc.flags {
+			cmd_pool = INTERNAL.compute_command_pools[cmd_buffer.desc.frame]
+		}
+
+		vk.FreeCommandBuffers(G_RENDERER.device, cmd_pool, 1, &backend_cmd_buffer.vk_cmd_buff)
+	}
+
+	//---------------------------------------------------------------------------//
+
+	@(private)
+	backend_command_buffer_begin_secondary :: proc(
+		p_ref: CommandBufferRef,
+		p_render_pass_ref: RenderPassRef,
+	) {
+		backend_cmd_buffer := &g_resources.backend_cmd_buffers[command_buffer_get_idx(p_ref)]
+		backend_render_pass :=
+			g_resources.backrender_pass_endes[render_pass_get_idx(p_render_pass_ref)]
+
+		// Secondary command buffers have to know the formats of the render pass they're executed in
+		rendering_inheritance_info := vk.CommandBufferInheritanceRenderingInfo {
+			sType                   = .COMMAND_BUFFER_INHERITANCE_RENDERING_INFO,
+			colorAttachmentCount    = backend_render_pass.num_color_formats,
+			pColorAttachmentFormats = &backend_render_pass.vk_color_formats[0],
+			depthAttachmentFormat   = backend_render_pass.vk_depth_format,
+			rasterizationSamples    = {._1},
+		}
+
+		inheritance_info := vk.CommandBufferInheritanceInfo {
+			sType = .COMMAND_BUFFER_INHERITANCE_INFO,
+			pNext = &rendering_inheritance_info,
+		}
+
+		begin_info := vk.CommandBufferBeginInfo {
+			sType            = .COMMAND_BUFFER_BEGIN_INFO,
+			flags            = {.ONE_TIME_SUBMIT, .RENDER_PASS_CONTINUE},
+			pInheritanceInfo = &inheritance_info,
+		}
+
+		vk.BeginCommandBuffer(backend_cmd_buffer.vk_cmd_buff, &begin_info)
+
+		// Dynamic state is not inherited from the primary command buffer
+		vk.CmdSetViewport(backend_cmd_buffer.vk_cmd_buff, 0, 1, &backend_render_pass.vk_viewport)
+		vk.CmdSetScissor(backend_cmd_buffer.vk_cmd_buff, 0, 1, &backend_render_pass.vk_scissor)
+	}
+
+	//---------------------------------------------------------------------------//
+
+	@(private)
+	backend_command_buffer_execute_secondary :: proc(
+		p_ref: CommandBufferRef,
+		p_secondary_refs: []CommandBufferRef,
+	) {
+		temp_arena: common.Arena
+		common.temp_arena_init(&temp_arena, common.KILOBYTE)
+		defer common.arena_delete(temp_arena)
+
+		vk_cmd_buffers := make([]vk.CommandBuffer, len(p_secondary_refs), temp_arena.allocator)
+		for secondary_ref, i in p_secondary_refs {
+			vk_cmd_buffers[i] =
+				g_resources.backend_cmd_buffers[command_buffer_get_idx(secondary_ref)].vk_cmd_buff
+		}
+
+		backend_cmd_buffer := &g_resources.backend_cmd_buffers[command_buffer_get_idx(p_ref)]
+		vk.CmdExecuteCommands(
+			backend_cmd_buffer.vk_cmd_buff,
+			u32(len(vk_cmd_buffers)),
+			raw_data(vk_cmd_buffers),
 		)
 	}
 
@@ -290,10 +378,7 @@ when USE_VULKAN_BACKEND {
 
 	@(private)
 	frame_compute_cmd_buffer_get :: proc() -> vk.CommandBuffer {
-		if .DedicatedComputeQueue in G_RENDERER.gpu_device_flags {
-			return INTERNAL.compute_cmd_buffers[get_frame_idx()]
-		}
-		cmd_buff_ref := get_frame_cmd_buffer_ref()
+		cmd_buff_ref := get_frame_async_compute_cmd_buffer_ref(.Main)
 		return g_resources.backend_cmd_buffers[command_buffer_get_idx(cmd_buff_ref)].vk_cmd_buff
 	}
 
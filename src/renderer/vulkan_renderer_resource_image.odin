@@ -12,6 +12,7 @@ import vk "vendor:vulkan"
 import "base:intrinsics"
 import "core:log"
 import "core:math/linalg/glsl"
+import "core:mem"
 import "core:strings"
 
 //---------------------------------------------------------------------------//
@@ -83,8 +84,21 @@ when USE_VULKAN_BACKEND {
 
 	@(private = "file")
 	BindlessArrayUpdate :: struct {
-		image_ref:         ImageRef,
-		use_default_image: bool,
+		image_ref:            ImageRef,
+		use_default_image:    bool,
+		// Use the view starting at the finest loaded mip, or the default image if none is loaded
+		clamp_to_loaded_mips: bool,
+	}
+
+	//---------------------------------------------------------------------------//
+
+	@(private = "file")
+	ImageToDelete :: struct {
+		vk_image:          vk.Image,
+		allocation:        vma.Allocation,
+		vk_all_mips_views: []vk.ImageView,
+		vk_views:          [][]vk.ImageView,
+		vk_layouts:        [][]vk.ImageLayout,
 	}
 
 	//---------------------------------------------------------------------------//
@@ -96,6 +110,9 @@ when USE_VULKAN_BACKEND {
 		bindless_array_updates:   [dynamic]BindlessArrayUpdate,
 		finished_image_uploads:   [dynamic]FinishedImageUpload,
 		default_image_ref:        ImageRef,
+		// Image and buffer of the read back that's being recorded, see backend_image_read_back
+		read_back_image_ref:      ImageRef,
+		read_back_buffer_ref:     BufferRef,
 	}
 
 	//---------------------------------------------------------------------------//
@@ -164,6 +181,15 @@ when USE_VULKAN_BACKEND {
 			usage += {.STORAGE}
 		}
 
+		// Streamed textures are copied to a new image when their mip range changes
+		if .Streamed in image.flags {
+			usage += {.TRANSFER_SRC}
+		}
+
+		// Mips finer than the first allocated one aren't part of the vk image
+		first_mip := image.first_allocated_mip
+		num_allocated_mips := image.desc.mip_count - first_mip
+
 		// Determine sample count
 		vk_sample_count_flags := vk.SampleCountFlags{}
 		for sample_count in ImageSampleFlagBits {
@@ -175,11 +201,11 @@ when USE_VULKAN_BACKEND {
 		// Create image
 		image_create_info := vk.ImageCreateInfo {
 			sType = .IMAGE_CREATE_INFO,
-			mipLevels = u32(image.desc.mip_count),
+			mipLevels = num_allocated_mips,
 			arrayLayers = 1,
 			extent = {
-				width = image.desc.dimensions.x,
-				height = image.desc.dimensions.y,
+				width = max(image.desc.dimensions.x >> first_mip, 1),
+				height = max(image.desc.dimensions.y >> first_mip, 1),
 				depth = image.desc.dimensions.z,
 			},
 			imageType = vk_image_type,
@@ -236,7 +262,7 @@ when USE_VULKAN_BACKEND {
 				format = vk_image_format,
 				subresourceRange = {
 					aspectMask = vk_map_image_aspect(image_aspect),
-					levelCount = u32(image.desc.mip_count),
+					levelCount = num_allocated_mips,
 					layerCount = 1,
 				},
 			}
@@ -291,7 +317,6 @@ when USE_VULKAN_BACKEND {
 				u32(image.desc.mip_count),
 				G_RENDERER_ALLOCATORS.resource_allocator,
 			)
-			num_image_views_created := 0
 
 			view_create_info := vk.ImageViewCreateInfo {
 				sType = .IMAGE_VIEW_CREATE_INFO,
@@ -301,11 +326,14 @@ when USE_VULKAN_BACKEND {
 				subresourceRange = {aspectMask = {.COLOR}, layerCount = 1},
 			}
 
-			for i in 0 ..< image.desc.mip_count {
+			// The views of the mips that aren't allocated are left empty
+			num_image_views_created := int(first_mip)
+
+			for i in first_mip ..< image.desc.mip_count {
 
 				backend_image.vk_layouts[0][i] = .UNDEFINED
 
-				view_create_info.subresourceRange.baseMipLevel = u32(i)
+				view_create_info.subresourceRange.baseMipLevel = u32(i - first_mip)
 				view_create_info.subresourceRange.levelCount = u32(image.desc.mip_count) - u32(i)
 
 				if vk.CreateImageView(
@@ -433,18 +461,189 @@ when USE_VULKAN_BACKEND {
 
 
 	@(private)
-	backend_image_create :: proc(p_image_ref: ImageRef) -> (res: bool) {
+	backend_image_create :: proc(p_image_ref: ImageRef) -> bool {
+
+		image_idx := image_get_idx(p_image_ref)
+		image := &g_resources.images[image_idx]
+		image_backend := &g_resources.backend_images[image_idx]
+
+		image_create_info, aspect_mask := vk_image_create_info_for(image)
+
+		alloc_create_info := vma.AllocationCreateInfo {
+			usage = .AUTO,
+		}
+
+		create_result := vma.create_image(
+			G_RENDERER.vma_allocator,
+			&image_create_info,
+			&alloc_create_info,
+			&image_backend.vk_image,
+			&image_backend.allocation,
+			nil,
+		)
+		if create_result != .SUCCESS {
+			return false
+		}
+
+		if create_image_views(p_image_ref, aspect_mask) == false {
+			vma.destroy_image(
+				G_RENDERER.vma_allocator,
+				image_backend.vk_image,
+				image_backend.allocation,
+			)
+			return false
+		}
+
+		return true
+	}
+
+	//---------------------------------------------------------------------------//
+
+	// Creates the images on top of a single allocation that fits the largest one of them.
+	// Their contents are undefined after another image of the group was written to.
+	@(private)
+	backend_image_create_aliased :: proc(p_image_refs: []ImageRef) -> (res: bool) {
 
 		temp_arena: common.Arena
 		common.temp_arena_init(&temp_arena)
 		defer common.arena_delete(temp_arena)
 
-		image_idx := image_get_idx(p_image_ref)
-		image := &g_resources.images[image_idx]
-		image_backend := &g_resources.backend_images[image_idx]
+		image_create_infos := make([]vk.ImageCreateInfo, len(p_image_refs), temp_arena.allocator)
+		aspect_masks := make([]ImageAspectFlags, len(p_image_refs), temp_arena.allocator)
+
+		memory_requirements := vk.MemoryRequirements {
+			memoryTypeBits = max(u32),
+		}
+
+		for image_ref, i in p_image_refs {
+			image := &g_resources.images[image_get_idx(image_ref)]
+			image_create_infos[i], aspect_masks[i] = vk_image_create_info_for(image)
+
+			image_requirements := vk_get_image_memory_requirements(&image_create_infos[i])
+			memory_requirements.size = max(memory_requirements.size, image_requirements.size)
+			memory_requirements.alignment = max(
+				memory_requirements.alignment,
+				image_requirements.alignment,
+			)
+			memory_requirements.memoryTypeBits &= image_requirements.memoryTypeBits
+		}
+
+		if memory_requirements.memoryTypeBits == 0 {
+			log.warn("Aliased images don't have a common memory type\n")
+			return false
+		}
+
+		alloc_create_info := vma.AllocationCreateInfo {
+			usage = .AUTO,
+		}
+
+		allocation: vma.Allocation
+		if vma.allocate_memory(
+			   G_RENDERER.vma_allocator,
+			   &memory_requirements,
+			   &alloc_create_info,
+			   &allocation,
+			   nil,
+		   ) !=
+		   .SUCCESS {
+			log.warn("Failed to allocate the memory of the aliased images\n")
+			return false
+		}
+
+		// Images of the group that were created along with their views
+		num_created_images := 0
+
+		defer if res == false {
+			for image_ref in p_image_refs[:num_created_images] {
+				destroy_image_views(image_ref)
+				image_backend := &g_resources.backend_images[image_get_idx(image_ref)]
+				vk.DestroyImage(G_RENDERER.device, image_backend.vk_image, nil)
+			}
+			vma.free_memory(G_RENDERER.vma_allocator, allocation)
+		}
+
+		for image_ref, i in p_image_refs {
+			image_backend := &g_resources.backend_images[image_get_idx(image_ref)]
+
+			create_result := vma.create_aliasing_image(
+				G_RENDERER.vma_allocator,
+				allocation,
+				&image_create_infos[i],
+				&image_backend.vk_image,
+			)
+			if create_result != .SUCCESS {
+				log.warn("Failed to create an aliased image\n")
+				return false
+			}
+
+			if create_image_views(image_ref, aspect_masks[i]) == false {
+				vk.DestroyImage(G_RENDERER.device, image_backend.vk_image, nil)
+				return false
+			}
+
+			num_created_images += 1
+		}
+
+		// Only the first image owns the allocation
+		g_resources.backend_images[image_get_idx(p_image_refs[0])].allocation = allocation
 
+		return true
+	}
+
+	//---------------------------------------------------------------------------//
+
+	// Size of the memory the image would take up, without creating it
+	@(private)
+	backend_image_get_memory_size :: proc(p_image_ref: ImageRef) -> u64 {
+		image := &g_resources.images[image_get_idx(p_image_ref)]
+		image_create_info, _ := vk_image_create_info_for(image)
+		return u64(vk_get_image_memory_requirements(&image_create_info).size)
+	}
+
+	//---------------------------------------------------------------------------//
+
+	@(private)
+	backend_image_discard_content :: proc(p_image_ref: ImageRef) {
+		backend_image := &g_resources.backend_images[image_get_idx(p_image_ref)]
+		for &layouts in backend_image.vk_layouts {
+			for &layout in layouts {
+				layout = .UNDEFINED
+			}
+		}
+	}
+
+	//---------------------------------------------------------------------------//
+
+	@(private = "file")
+	vk_get_image_memory_requirements :: proc(
+		p_image_create_info: ^vk.ImageCreateInfo,
+	) -> vk.MemoryRequirements {
+		image_requirements_info := vk.DeviceImageMemoryRequirements {
+			sType       = .DEVICE_IMAGE_MEMORY_REQUIREMENTS,
+			pCreateInfo = p_image_create_info,
+		}
+		memory_requirements := vk.MemoryRequirements2 {
+			sType = .MEMORY_REQUIREMENTS_2,
+		}
+		vk.GetDeviceImageMemoryRequirements(
+			G_RENDERER.device,
+			&image_requirements_info,
+			&memory_requirements,
+		)
+		return memory_requirements.memoryRequirements
+	}
+
+	//---------------------------------------------------------------------------//
+
+	@(private = "file")
+	vk_image_create_info_for :: proc(
+		p_image: ^ImageResource,
+	) -> (
+		vk.ImageCreateInfo,
+		ImageAspectFlags,
+	) {
 		image_type := vk.ImageType.D1
-		#partial switch image.desc.type {
+		#partial switch p_image.desc.type {
 		case .TwoDimensional:
 			image_type = .D2
 		case .ThreeDimensional:
@@ -454,27 +653,27 @@ when USE_VULKAN_BACKEND {
 		usage := vk.ImageUsageFlags{.TRANSFER_SRC, .TRANSFER_DST}
 		aspect_mask := ImageAspectFlags{}
 
-		if image.desc.format > .DepthFormatsStart && image.desc.format < .DepthFormatsEnd {
+		if p_image.desc.format > .DepthFormatsStart && p_image.desc.format < .DepthFormatsEnd {
 			usage += {.DEPTH_STENCIL_ATTACHMENT}
 			aspect_mask += {.Depth}
 
-			if image.desc.format > .DepthStencilFormatsStart &&
-			   image.desc.format < .DepthStencilFormatsEnd {
+			if p_image.desc.format > .DepthStencilFormatsStart &&
+			   p_image.desc.format < .DepthStencilFormatsEnd {
 				aspect_mask += {.Stencil}
 			}
 
 		} else {
 			aspect_mask += {.Color}
-			if image.desc.format < .CompressedFormatsStart ||
-			   image.desc.format > .CompressedFormatsEnd {
+			if p_image.desc.format < .CompressedFormatsStart ||
+			   p_image.desc.format > .CompressedFormatsEnd {
 				usage += {.COLOR_ATTACHMENT}
 			}
 		}
 
-		if .Sampled in image.desc.flags {
+		if .Sampled in p_image.desc.flags {
 			usage += {.SAMPLED}
 		}
-		if .Storage in image.desc.flags {
+		if .Storage in p_image.desc.flags {
 			usage += {.STORAGE}
 		}
 
@@ -482,13 +681,13 @@ when USE_VULKAN_BACKEND {
 			sType         = .IMAGE_CREATE_INFO,
 			imageType     = image_type,
 			extent        = {
-				image.desc.dimensions.x,
-				image.desc.dimensions.y,
-				image.desc.dimensions.z,
+				p_image.desc.dimensions.x,
+				p_image.desc.dimensions.y,
+				p_image.desc.dimensions.z,
 			},
-			mipLevels     = image.desc.mip_count,
-			arrayLayers   = image.desc.array_size,
-			format        = G_IMAGE_FORMAT_MAPPING[image.desc.format],
+			mipLevels     = p_image.desc.mip_count,
+			arrayLayers   = p_image.desc.array_size,
+			format        = G_IMAGE_FORMAT_MAPPING[p_image.desc.format],
 			tiling        = .OPTIMAL,
 			initialLayout = .UNDEFINED,
 			usage         = usage,
@@ -496,28 +695,27 @@ when USE_VULKAN_BACKEND {
 			samples       = {._1},
 		}
 
-		alloc_create_info := vma.AllocationCreateInfo {
-			usage = .AUTO,
-		}
+		return image_create_info, aspect_mask
+	}
 
-		create_result := vma.create_image(
-			G_RENDERER.vma_allocator,
-			&image_create_info,
-			&alloc_create_info,
-			&image_backend.vk_image,
-			&image_backend.allocation,
-			nil,
-		)
-		if create_result != .SUCCESS {
-			return false
-		}
-		defer if res == false {
-			vma.destroy_image(
-				G_RENDERER.vma_allocator,
-				image_backend.vk_image,
-				image_backend.allocation,
-			)
-		}
+	//---------------------------------------------------------------------------//
+
+	// Creates the views of an image that's already bound to its memory
+	@(private = "file")
+	create_image_views :: proc(
+		p_image_ref: ImageRef,
+		p_aspect_mask: ImageAspectFlags,
+	) -> (
+		res: bool,
+	) {
+
+		temp_arena: common.Arena
+		common.temp_arena_init(&temp_arena)
+		defer common.arena_delete(temp_arena)
+
+		image_idx := image_get_idx(p_image_ref)
+		image := &g_resources.images[image_idx]
+		image_backend := &g_resources.backend_images[image_idx]
 
 		vk_name := strings.clone_to_cstring(
 			common.get_string(image.name),
@@ -534,12 +732,12 @@ when USE_VULKAN_BACKEND {
 		vk.SetDebugUtilsObjectNameEXT(G_RENDERER.device, &name_info)
 
 		view_type := vk.ImageViewType{}
-		#partial switch image_type {
-		case .D1:
+		switch image.desc.type {
+		case .OneDimensional:
 			view_type = .D1 if image.desc.array_size == 1 else .D1_ARRAY
-		case .D2:
+		case .TwoDimensional:
 			view_type = .D2 if image.desc.array_size == 1 else .D2_ARRAY
-		case .D3:
+		case .ThreeDimensional:
 			view_type = .D3
 			assert(image.desc.array_size == 1)
 		}
@@ -550,7 +748,7 @@ when USE_VULKAN_BACKEND {
 			viewType = view_type,
 			format = G_IMAGE_FORMAT_MAPPING[image.desc.format],
 			subresourceRange = {
-				aspectMask = vk_map_image_aspect(aspect_mask),
+				aspectMask = vk_map_image_aspect(p_aspect_mask),
 				levelCount = image.desc.mip_count,
 				layerCount = image.desc.array_size,
 			},
@@ -643,7 +841,7 @@ when USE_VULKAN_BACKEND {
 				viewType = G_IMAGE_VIEW_TYPE_MAPPING[image.desc.type],
 				format = G_IMAGE_FORMAT_MAPPING[image.desc.format],
 				subresourceRange = {
-					aspectMask = vk_map_image_aspect(aspect_mask),
+					aspectMask = vk_map_image_aspect(p_aspect_mask),
 					levelCount = image.desc.mip_count,
 					layerCount = 1,
 					baseArrayLayer = array_level,
@@ -678,7 +876,7 @@ when USE_VULKAN_BACKEND {
 					viewType = G_IMAGE_VIEW_TYPE_MAPPING[image.desc.type],
 					format = G_IMAGE_FORMAT_MAPPING[image.desc.format],
 					subresourceRange = {
-						aspectMask = vk_map_image_aspect(aspect_mask),
+						aspectMask = vk_map_image_aspect(p_aspect_mask),
 						levelCount = 1,
 						layerCount = 1,
 						baseArrayLayer = array_level,
@@ -711,13 +909,39 @@ when USE_VULKAN_BACKEND {
 			}
 		}
 
-		image_backend.aspect_mask = aspect_mask
+		image_backend.aspect_mask = p_aspect_mask
 
 		return true
 	}
 
 	//---------------------------------------------------------------------------//
 
+	// Destroys the views created by create_image_views and releases their arrays
+	@(private = "file")
+	destroy_image_views :: proc(p_image_ref: ImageRef) {
+		image_idx := image_get_idx(p_image_ref)
+		image := &g_resources.images[image_idx]
+		image_backend := &g_resources.backend_images[image_idx]
+
+		vk.DestroyImageView(G_RENDERER.device, image_backend.vk_image_view, nil)
+
+		for i in 0 ..< image.desc.array_size {
+			for j in 0 ..< image.desc.mip_count {
+				vk.DestroyImageView(G_RENDERER.device, image_backend.vk_views[i][j], nil)
+			}
+			vk.DestroyImageView(G_RENDERER.device, image_backend.vk_all_mips_views[i], nil)
+
+			delete(image_backend.vk_views[i], G_RENDERER_ALLOCATORS.resource_allocator)
+			delete(image_backend.vk_layouts[i], G_RENDERER_ALLOCATORS.resource_allocator)
+		}
+
+		delete(image_backend.vk_all_mips_views, G_RENDERER_ALLOCATORS.resource_allocator)
+		delete(image_backend.vk_views, G_RENDERER_ALLOCATORS.resource_allocator)
+		delete(image_backend.vk_layouts, G_RENDERER_ALLOCATORS.resource_allocator)
+	}
+
+	//---------------------------------------------------------------------------//
+
 	backend_image_destroy :: proc(p_image_ref: ImageRef) {
 		img_idx := image_get_idx(p_image_ref)
 		image := &g_resources.images[img_idx]
@@ -783,6 +1007,15 @@ when USE_VULKAN_BACKEND {
 				imageView   = backend_image.vk_image_view,
 			}
 
+			if bindless_update.clamp_to_loaded_mips {
+				highest_loaded_mip := image_get_highest_loaded_mip(bindless_update.image_ref)
+				if highest_loaded_mip < image.desc.mip_count {
+					image_infos[i].imageView = backend_image.vk_views[0][highest_loaded_mip]
+				} else {
+					image_infos[i].imageView = backend_default_image.vk_image_view
+				}
+			}
+
 			if bindless_update.use_default_image {
 				image_infos[i].imageView = backend_default_image.vk_image_view
 			}
@@ -819,7 +1052,7 @@ when USE_VULKAN_BACKEND {
 		image := &g_resources.images[image_idx]
 		backend_image := &g_resources.backend_images[image_idx]
 
-		for i in 0 ..< image.desc.mip_count {
+		for i in image.first_allocated_mip ..< image.desc.mip_count {
 			backend_image.vk_layouts[0][i] = .TRANSFER_DST_OPTIMAL
 		}
 
@@ -835,7 +1068,7 @@ when USE_VULKAN_BACKEND {
 				baseArrayLayer = 0,
 				layerCount = 1,
 				baseMipLevel = 0,
-				levelCount = u32(image.desc.mip_count),
+				levelCount = image.desc.mip_count - image.first_allocated_mip,
 			},
 			dstAccessMask = {.TRANSFER_WRITE},
 		}
@@ -881,6 +1114,305 @@ when USE_VULKAN_BACKEND {
 
 	//---------------------------------------------------------------------------//
 
+	// Creates a new image with the mips from p_first_mip and copies the mips shared with the
+	// current one. The mips that weren't allocated before are left in the transfer layout,
+	// ready to be uploaded. The old image is destroyed once the frames using it are done.
+	@(private)
+	backend_image_reallocate_mips :: proc(p_image_ref: ImageRef, p_first_mip: u32) -> bool {
+
+		temp_arena: common.Arena
+		common.temp_arena_init(&temp_arena)
+		defer common.arena_delete(temp_arena)
+
+		image_idx := image_get_idx(p_image_ref)
+		image := &g_resources.images[image_idx]
+		backend_image := &g_resources.backend_images[image_idx]
+
+		old_first_mip := image.first_allocated_mip
+		num_allocated_mips := image.desc.mip_count - p_first_mip
+
+		vk_image_format := G_IMAGE_FORMAT_MAPPING[image.desc.format]
+
+		image_create_info := vk.ImageCreateInfo {
+			sType = .IMAGE_CREATE_INFO,
+			mipLevels = num_allocated_mips,
+			arrayLayers = 1,
+			extent = {
+				width = max(image.desc.dimensions.x >> p_first_mip, 1),
+				height = max(image.desc.dimensions.y >> p_first_mip, 1),
+				depth = image.desc.dimensions.z,
+			},
+			imageType = .D2,
+			format = vk_image_format,
+			tiling = .OPTIMAL,
+			initialLayout = .UNDEFINED,
+			usage = {.SAMPLED, .TRANSFER_DST, .TRANSFER_SRC},
+			sharingMode = .EXCLUSIVE,
+			samples = {._1},
+		}
+
+		alloc_create_info := vma.AllocationCreateInfo {
+			usage = .AUTO,
+		}
+
+		vk_image: vk.Image
+		allocation: vma.Allocation
+
+		if res := vma.create_image(
+			G_RENDERER.vma_allocator,
+			&image_create_info,
+			&alloc_create_info,
+			&vk_image,
+			&allocation,
+			nil,
+		); res != .SUCCESS {
+			log.warnf(
+				"Failed to reallocate mips of image %s: %s",
+				common.get_string(image.name),
+				res,
+			)
+			return false
+		}
+
+		vk_name := strings.clone_to_cstring(
+			common.get_string(image.name),
+			temp_arena.allocator,
+		)
+
+		name_info := vk.DebugUtilsObjectNameInfoEXT {
+			sType        = .DEBUG_UTILS_OBJECT_NAME_INFO_EXT,
+			objectHandle = u64(vk_image),
+			objectType   = .IMAGE,
+			pObjectName  = vk_name,
+		}
+
+		vk.SetDebugUtilsObjectNameEXT(G_RENDERER.device, &name_info)
+
+		// Create the views, the ones of the mips that aren't allocated are left empty
+		vk_all_mips_views := make([]vk.ImageView, 1, G_RENDERER_ALLOCATORS.resource_allocator)
+		vk_views := make([][]vk.ImageView, 1, G_RENDERER_ALLOCATORS.resource_allocator)
+		vk_views[0] = make(
+			[]vk.ImageView,
+			image.desc.mip_count,
+			G_RENDERER_ALLOCATORS.resource_allocator,
+		)
+		vk_layouts := make([][]vk.ImageLayout, 1, G_RENDERER_ALLOCATORS.resource_allocator)
+		vk_layouts[0] = make(
+			[]vk.ImageLayout,
+			image.desc.mip_count,
+			G_RENDERER_ALLOCATORS.resource_allocator,
+		)
+
+		view_create_info := vk.ImageViewCreateInfo {
+			sType = .IMAGE_VIEW_CREATE_INFO,
+			image = vk_image,
+			viewType = .D2,
+			format = vk_image_format,
+			subresourceRange = {
+				aspectMask = {.COLOR},
+				levelCount = num_allocated_mips,
+				layerCount = 1,
+			},
+		}
+
+		views_created := vk.CreateImageView(
+			G_RENDERER.device,
+			&view_create_info,
+			nil,
+			&vk_all_mips_views[0],
+		) == .SUCCESS
+
+		for mip in p_first_mip ..< image.desc.mip_count {
+			if views_created == false {
+				break
+			}
+
+			view_create_info.subresourceRange.baseMipLevel = mip - p_first_mip
+			view_create_info.subresourceRange.levelCount = image.desc.mip_count - mip
+
+			views_created =
+				vk.CreateImageView(G_RENDERER.device, &view_create_info, nil, &vk_views[0][mip]) ==
+				.SUCCESS
+		}
+
+		if views_created == false {
+			log.warnf(
+				"Failed to create views when reallocating mips of image %s",
+				common.get_string(image.name),
+			)
+			image_to_delete := ImageToDelete {
+				vk_image          = vk_image,
+				allocation        = allocation,
+				vk_all_mips_views = vk_all_mips_views,
+				vk_views          = vk_views,
+				vk_layouts        = vk_layouts,
+			}
+			safe_destroy_image(&image_to_delete)
+			return false
+		}
+
+		cmd_buffer_ref := get_frame_cmd_buffer_ref()
+		cmd_buffer := &g_resources.backend_cmd_buffers[command_buffer_get_idx(cmd_buffer_ref)]
+
+		// Mips that are resident in both images
+		first_copied_mip := max(p_first_mip, old_first_mip)
+		num_copied_mips := image.desc.mip_count - first_copied_mip
+
+		// Prepare the old image to be copied from and the new one to be copied to
+		barriers := [2]vk.ImageMemoryBarrier {
+			{
+				sType = .IMAGE_MEMORY_BARRIER,
+				oldLayout = .SHADER_READ_ONLY_OPTIMAL,
+				newLayout = .TRANSFER_SRC_OPTIMAL,
+				srcAccessMask = {.SHADER_READ},
+				dstAccessMask = {.TRANSFER_READ},
+				image = backend_image.vk_image,
+				subresourceRange = {
+					aspectMask = {.COLOR},
+					layerCount = 1,
+					baseMipLevel = first_copied_mip - old_first_mip,
+					levelCount = num_copied_mips,
+				},
+			},
+			{
+				sType = .IMAGE_MEMORY_BARRIER,
+				oldLayout = .UNDEFINED,
+				newLayout = .TRANSFER_DST_OPTIMAL,
+				dstAccessMask = {.TRANSFER_WRITE},
+				image = vk_image,
+				subresourceRange = {
+					aspectMask = {.COLOR},
+					layerCount = 1,
+					baseMipLevel = 0,
+					levelCount = num_allocated_mips,
+				},
+			},
+		}
+
+		vk.CmdPipelineBarrier(
+			cmd_buffer.vk_cmd_buff,
+			{.VERTEX_SHADER, .FRAGMENT_SHADER, .COMPUTE_SHADER},
+			{.TRANSFER},
+			nil,
+			0,
+			nil,
+			0,
+			nil,
+			len(barriers),
+			&barriers[0],
+		)
+
+		image_copies := make([]vk.ImageCopy, num_copied_mips, temp_arena.allocator)
+		for mip in first_copied_mip ..< image.desc.mip_count {
+			image_copies[mip - first_copied_mip] = vk.ImageCopy {
+				srcSubresource = {
+					aspectMask = {.COLOR},
+					mipLevel = mip - old_first_mip,
+					layerCount = 1,
+				},
+				dstSubresource = {aspectMask = {.COLOR}, mipLevel = mip - p_first_mip, layerCount = 1},
+				extent = {
+					width = max(image.desc.dimensions.x >> mip, 1),
+					height = max(image.desc.dimensions.y >> mip, 1),
+					depth = 1,
+				},
+			}
+		}
+
+		vk.CmdCopyImage(
+			cmd_buffer.vk_cmd_buff,
+			backend_image.vk_image,
+			.TRANSFER_SRC_OPTIMAL,
+			vk_image,
+			.TRANSFER_DST_OPTIMAL,
+			u32(num_copied_mips),
+			raw_data(image_copies),
+		)
+
+		// Make the copied mips available for sampling, the old image can still
+		// be sampled by the frames in flight until it's destroyed
+		barriers[0].oldLayout = .TRANSFER_SRC_OPTIMAL
+		barriers[0].newLayout = .SHADER_READ_ONLY_OPTIMAL
+		barriers[0].srcAccessMask = {.TRANSFER_READ}
+		barriers[0].dstAccessMask = {.SHADER_READ}
+
+		barriers[1].oldLayout = .TRANSFER_DST_OPTIMAL
+		barriers[1].newLayout = .SHADER_READ_ONLY_OPTIMAL
+		barriers[1].srcAccessMask = {.TRANSFER_WRITE}
+		barriers[1].dstAccessMask = {.SHADER_READ}
+		barriers[1].subresourceRange.baseMipLevel = first_copied_mip - p_first_mip
+		barriers[1].subresourceRange.levelCount = num_copied_mips
+
+		vk.CmdPipelineBarrier(
+			cmd_buffer.vk_cmd_buff,
+			{.TRANSFER},
+			{.VERTEX_SHADER, .FRAGMENT_SHADER, .COMPUTE_SHADER},
+			nil,
+			0,
+			nil,
+			0,
+			nil,
+			len(barriers),
+			&barriers[0],
+		)
+
+		for mip in p_first_mip ..< image.desc.mip_count {
+			vk_layouts[0][mip] =
+				.SHADER_READ_ONLY_OPTIMAL if mip >= first_copied_mip else .TRANSFER_DST_OPTIMAL
+		}
+
+		// Destroy the old image when the frames in flight are done with it
+		image_to_delete := defer_resource_delete(safe_destroy_image, ImageToDelete)
+		image_to_delete^ = ImageToDelete {
+			vk_image          = backend_image.vk_image,
+			allocation        = backend_image.allocation,
+			vk_all_mips_views = backend_image.vk_all_mips_views,
+			vk_views          = backend_image.vk_views,
+			vk_layouts        = backend_image.vk_layouts,
+		}
+
+		backend_image.vk_image = vk_image
+		backend_image.allocation = allocation
+		backend_image.vk_all_mips_views = vk_all_mips_views
+		backend_image.vk_image_view = vk_all_mips_views[0]
+		backend_image.vk_views = vk_views
+		backend_image.vk_layouts = vk_layouts
+
+		// Point the bindless entry at the new image, it's updated before the
+		// uploads of the new mips start, so it's clamped to the resident ones
+		append(
+			&INTERNAL.bindless_array_updates,
+			BindlessArrayUpdate{image_ref = p_image_ref, clamp_to_loaded_mips = true},
+		)
+
+		return true
+	}
+
+	//---------------------------------------------------------------------------//
+
+	@(private = "file")
+	safe_destroy_image :: proc(p_user_data: rawptr) {
+		image_to_delete := (^ImageToDelete)(p_user_data)
+
+		for view in image_to_delete.vk_views[0] {
+			vk.DestroyImageView(G_RENDERER.device, view, nil)
+		}
+		vk.DestroyImageView(G_RENDERER.device, image_to_delete.vk_all_mips_views[0], nil)
+		vma.destroy_image(
+			G_RENDERER.vma_allocator,
+			image_to_delete.vk_image,
+			image_to_delete.allocation,
+		)
+
+		delete(image_to_delete.vk_views[0], G_RENDERER_ALLOCATORS.resource_allocator)
+		delete(image_to_delete.vk_views, G_RENDERER_ALLOCATORS.resource_allocator)
+		delete(image_to_delete.vk_layouts[0], G_RENDERER_ALLOCATORS.resource_allocator)
+		delete(image_to_delete.vk_layouts, G_RENDERER_ALLOCATORS.resource_allocator)
+		delete(image_to_delete.vk_all_mips_views, G_RENDERER_ALLOCATORS.resource_allocator)
+	}
+
+	//---------------------------------------------------------------------------//
+
 	@(private)
 	backend_copy_whole_image :: proc(
 		p_image_ref: ImageRef,
@@ -942,6 +1474,7 @@ when USE_VULKAN_BACKEND {
 		)
 
 		image_idx := image_get_idx(p_image_ref)
+		image := &g_resources.images[image_idx]
 		backend_image := &g_resources.backend_images[image_idx]
 
 		backend_buffer := &g_resources.backend_buffers[buffer_get_idx(p_staging_buffer_ref)]
@@ -958,7 +1491,7 @@ when USE_VULKAN_BACKEND {
 					aspectMask = {.COLOR},
 					baseArrayLayer = 0,
 					layerCount = 1,
-					mipLevel = u32(p_current_mip),
+					mipLevel = p_current_mip - image.first_allocated_mip,
 				},
 				imageExtent = {width = p_size.x, height = p_size.y, depth = 1},
 			}
@@ -1043,15 +1576,18 @@ when USE_VULKAN_BACKEND {
 
 			image.loaded_mips_mask |= (1 << finished_upload.mip)
 
+			// Streamed textures keep the file mapped, to be able to stream the mips back in
 			if image.desc.file_mapping.mapped_ptr == nil {
 				delete(image.desc.data_per_mip[finished_upload.mip], image.desc.mip_data_allocator)
 			}
 
-			if finished_upload.mip == 0 {
+			if finished_upload.mip == 0 && (.Streamed in image.flags) == false {
 				if image.desc.file_mapping.mapped_ptr == nil {
 					delete(image.desc.data_per_mip, G_RENDERER_ALLOCATORS.main_allocator)
 				} else if finished_upload.mip == 0 {
-					common.unmap_file(image.desc.file_mapping)
+					if .SharedFileMapping not_in image.desc.flags {
+						common.unmap_file(image.desc.file_mapping)
+					}
 					image.desc.file_mapping = {}
 				}
 			}
@@ -1072,7 +1608,7 @@ when USE_VULKAN_BACKEND {
 					aspectMask = {.COLOR},
 					baseArrayLayer = 0,
 					layerCount = image.desc.array_size,
-					baseMipLevel = u32(finished_upload.mip),
+					baseMipLevel = finished_upload.mip - image.first_allocated_mip,
 					levelCount = 1,
 				},
 			}
@@ -1299,9 +1835,20 @@ when USE_VULKAN_BACKEND {
 
 		image_barriers := []vk.ImageMemoryBarrier{src_image_barrier, dst_image_barrier}
 
+		// The compute queue doesn't support the graphics stages. The images don't change
+		// their owner, they have to be used on the same queue before the copy already.
+		src_stages := vk.PipelineStageFlags {
+			.COMPUTE_SHADER,
+			.COLOR_ATTACHMENT_OUTPUT,
+			.LATE_FRAGMENT_TESTS,
+		}
+		if command_buffer_is_async_compute(p_cmd_buffer_ref) {
+			src_stages = {.COMPUTE_SHADER}
+		}
+
 		vk.CmdPipelineBarrier(
 			cmd_buffer.vk_cmd_buff,
-			{.COMPUTE_SHADER, .COLOR_ATTACHMENT_OUTPUT, .LATE_FRAGMENT_TESTS},
+			src_stages,
 			{.TRANSFER},
 			{},
 			0,
@@ -1324,4 +1871,132 @@ when USE_VULKAN_BACKEND {
 	}
 
 	//---------------------------------------------------------------------------//
+
+	// Copies the first mip of the image to the host. Waits for the device to go idle,
+	// so it's only meant for tools, e.g. to save the final image of a headless run.
+	@(private)
+	backend_image_read_back :: proc(
+		p_image_ref: ImageRef,
+		p_allocator: mem.Allocator,
+	) -> (
+		[]byte,
+		bool,
+	) {
+		image_size := u32(image_get_mip_size_in_bytes(p_image_ref, 0))
+
+		read_back_buffer_ref := buffer_allocate(common.create_name("ImageReadBack"))
+		read_back_buffer := &g_resources.buffers[buffer_get_idx(read_back_buffer_ref)]
+		read_back_buffer.desc = {
+			size  = image_size,
+			flags = {.HostRead},
+			usage = {.TransferDst},
+		}
+		if buffer_create(read_back_buffer_ref) == false {
+			return nil, false
+		}
+		defer buffer_destroy(read_back_buffer_ref)
+
+		vk.DeviceWaitIdle(G_RENDERER.device)
+
+		INTERNAL.read_back_image_ref = p_image_ref
+		INTERNAL.read_back_buffer_ref = read_back_buffer_ref
+		command_buffer_one_time_submit(record_image_read_back)
+
+		image_data := make([]byte, image_size, p_allocator)
+		mem.copy(raw_data(image_data), buffer_mmap(read_back_buffer_ref), int(image_size))
+		buffer_unmmap(read_back_buffer_ref)
+
+		return image_data, true
+	}
+
+	//---------------------------------------------------------------------------//
+
+	@(private = "file")
+	record_image_read_back :: proc(p_cmd_buff: vk.CommandBuffer) {
+		image := &g_resources.images[image_get_idx(INTERNAL.read_back_image_ref)]
+		backend_image := &g_resources.backend_images[image_get_idx(INTERNAL.read_back_image_ref)]
+		backend_buffer := &g_resources.backend_buffers[buffer_get_idx(INTERNAL.read_back_buffer_ref)]
+
+		image_layout := backend_image.vk_layouts[0][0]
+		aspect_mask := vk_map_image_aspect(backend_image.aspect_mask)
+
+		subresource_range := vk.ImageSubresourceRange {
+			aspectMask = aspect_mask,
+			layerCount = 1,
+			levelCount = 1,
+		}
+
+		to_transfer_barrier := vk.ImageMemoryBarrier {
+			sType = .IMAGE_MEMORY_BARRIER,
+			srcAccessMask = {.MEMORY_WRITE},
+			dstAccessMask = {.TRANSFER_READ},
+			image = backend_image.vk_image,
+			oldLayout = image_layout,
+			newLayout = .TRANSFER_SRC_OPTIMAL,
+			subresourceRange = subresource_range,
+		}
+
+		vk.CmdPipelineBarrier(
+			p_cmd_buff,
+			{.ALL_COMMANDS},
+			{.TRANSFER},
+			{},
+			0,
+			nil,
+			0,
+			nil,
+			1,
+			&to_transfer_barrier,
+		)
+
+		region := vk.BufferImageCopy {
+			imageSubresource = {aspectMask = aspect_mask, mipLevel = 0, layerCount = 1},
+			imageExtent = {image.desc.dimensions.x, image.desc.dimensions.y, 1},
+		}
+
+		vk.CmdCopyImageToBuffer(
+			p_cmd_buff,
+			backend_image.vk_image,
+			.TRANSFER_SRC_OPTIMAL,
+			backend_buffer.vk_buffer,
+			1,
+			&region,
+		)
+
+		// Put the image back into the layout the frames expect it in
+		to_previous_layout_barrier := vk.ImageMemoryBarrier {
+			sType = .IMAGE_MEMORY_BARRIER,
+			srcAccessMask = {.TRANSFER_READ},
+			dstAccessMask = {.MEMORY_READ, .MEMORY_WRITE},
+			image = backend_image.vk_image,
+			oldLayout = .TRANSFER_SRC_OPTIMAL,
+			newLayout = image_layout,
+			subresourceRange = subresource_range,
+		}
+
+		buffer_barrier := vk.BufferMemoryBarrier {
+			sType = .BUFFER_MEMORY_BARRIER,
+			srcAccessMask = {.TRANSFER_WRITE},
+			dstAccessMask = {.HOST_READ},
+			buffer = backend_buffer.vk_buffer,
+			size = vk.DeviceSize(vk.WHOLE_SIZE),
+			srcQueueFamilyIndex = vk.QUEUE_FAMILY_IGNORED,
+			dstQueueFamilyIndex = vk.QUEUE_FAMILY_IGNORED,
+		}
+
+		vk.CmdPipelineBarrier(
+			p_cmd_buff,
+			{.TRANSFER},
+			{.ALL_COMMANDS, .HOST},
+			{},
+			0,
+			nil,
+			1,
+			&buffer_barrier,
+			1,
+			&to_previous_layout_barrier,
+		)
+	}
+
+	//---------------------------------------------------------------------------//
 }
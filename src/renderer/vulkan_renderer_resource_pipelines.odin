@@ -5,10 +5,12 @@ package renderer
 //---------------------------------------------------------------------------//
 
 import "../common"
+import "core:hash"
 import "core:log"
-import "core:math/linalg/glsl"
+import "core:mem"
 import "core:os"
 import "core:strings"
+import "core:time"
 
 import vk "vendor:vulkan"
 
@@ -36,6 +38,36 @@ when USE_VULKAN_BACKEND {
 
 	//---------------------------------------------------------------------------//
 
+	@(private = "file")
+	PipelineCreateResult :: enum u8 {
+		Failed,
+		Compiled,
+		CacheHit,
+	}
+
+	//---------------------------------------------------------------------------//
+
+	@(private = "file")
+	PipelineCreateJob :: struct {
+		type:                  PipelineType,
+		graphics_pipeline_ref: GraphicsPipelineRef,
+		compute_pipeline_ref:  ComputePipelineRef,
+		// Hash of the state the driver compiles, identical pipelines in a batch are only
+		// compiled once, the rest is created from the pipeline cache
+		permutation_key:       u64,
+		result:                PipelineCreateResult,
+	}
+
+	//---------------------------------------------------------------------------//
+
+	@(private = "file")
+	PipelineCreateJobBatch :: struct {
+		jobs:        []PipelineCreateJob,
+		job_indices: []int,
+	}
+
+	//---------------------------------------------------------------------------//
+
 	@(private = "file")
 	PipelineLayoutCacheEntry :: struct {
 		vk_pipeline_layout: vk.PipelineLayout,
@@ -63,12 +95,12 @@ when USE_VULKAN_BACKEND {
 	@(private = "file")
 	VERTEX_BINDINGS_PER_TYPE := map[VertexLayout][]vk.VertexInputBindingDescription {
 		.Empty = {},
-		// position, uv, normal, tangent
+		// position, uv, normal, tangent, see VertexFormat
 		.Mesh  = {
-			{binding = 0, stride = size_of(glsl.vec3), inputRate = .VERTEX},
-			{binding = 1, stride = size_of(glsl.vec2), inputRate = .VERTEX},
-			{binding = 2, stride = size_of(glsl.vec3), inputRate = .VERTEX},
-			{binding = 3, stride = size_of(glsl.vec3), inputRate = .VERTEX},
+			{binding = 0, stride = size_of([4]u16), inputRate = .VERTEX},
+			{binding = 1, stride = size_of([2]f16), inputRate = .VERTEX},
+			{binding = 2, stride = size_of([2]i16), inputRate = .VERTEX},
+			{binding = 3, stride = size_of([2]i16), inputRate = .VERTEX},
 		},
 	}
 
@@ -77,12 +109,12 @@ when USE_VULKAN_BACKEND {
 	@(private = "file")
 	VERTEX_ATTRIBUTES_PER_TYPE := map[VertexLayout][]vk.VertexInputAttributeDescription {
 		.Empty = {},
-		// position, uv, normal, tangent
+		// position, uv, normal, tangent, see VertexFormat
 		.Mesh  = {
-			{binding = 0, location = 0, format = .R32G32B32_SFLOAT, offset = 0},
-			{binding = 1, location = 1, format = .R32G32_SFLOAT, offset = 0},
-			{binding = 2, location = 2, format = .R32G32B32_SFLOAT, offset = 0},
-			{binding = 3, location = 3, format = .R32G32B32_SFLOAT, offset = 0},
+			{binding = 0, location = 0, format = .R16G16B16A16_UNORM, offset = 0},
+			{binding = 1, location = 1, format = .R16G16_SFLOAT, offset = 0},
+			{binding = 2, location = 2, format = .R16G16_SNORM, offset = 0},
+			{binding = 3, location = 3, format = .R16G16_SNORM, offset = 0},
 		},
 	}
 
@@ -174,7 +206,10 @@ when USE_VULKAN_BACKEND {
 
 	//---------------------------------------------------------------------------//
 
-	PIPELINE_CACHE_FILE := "app_data/bin/cache/pipeline/pipeline.cache"
+	@(private = "file")
+	PIPELINE_CACHE_DIR :: "app_data/bin/cache/pipeline"
+	@(private = "file")
+	PIPELINE_CACHE_FILE :: PIPELINE_CACHE_DIR + "/pipeline.cache"
 
 	//---------------------------------------------------------------------------//
 
@@ -225,6 +260,16 @@ when USE_VULKAN_BACKEND {
 
 		vk.CreatePipelineCache(G_RENDERER.device, &create_info, nil, &INTERNAL.vk_pipeline_cache)
 
+		// Make sure that the cache dir exists, so the cache can be flushed
+		{
+			dirs := []string{"app_data/bin", "app_data/bin/cache", PIPELINE_CACHE_DIR}
+			for dir in dirs {
+				if os.exists(dir) == false {
+					os.make_directory(dir, 0)
+				}
+			}
+		}
+
 		return true
 	}
 
@@ -232,27 +277,295 @@ when USE_VULKAN_BACKEND {
 
 	@(private)
 	backend_pipeline_deinit :: proc() {
-		cache_size: int
+		flush_pipeline_cache()
+		vk.DestroyPipelineCache(G_RENDERER.device, INTERNAL.vk_pipeline_cache, nil)
+		delete(INTERNAL.pipeline_layout_cache)
+	}
+
+	//---------------------------------------------------------------------------//
 
+	// Writes the pipeline cache to a temp file first, so that a crash in the middle
+	// of the write doesn't leave a truncated cache behind
+	@(private = "file")
+	flush_pipeline_cache :: proc() {
+		temp_arena: common.Arena
+		common.temp_arena_init(&temp_arena)
+		defer common.arena_delete(temp_arena)
+
+		cache_size: int
 		vk.GetPipelineCacheData(G_RENDERER.device, INTERNAL.vk_pipeline_cache, &cache_size, nil)
 
 		cache_data := make([]u8, cache_size, G_RENDERER_ALLOCATORS.main_allocator)
 		defer delete(cache_data, G_RENDERER_ALLOCATORS.main_allocator)
-		defer delete(INTERNAL.pipeline_layout_cache)
 
-		vk.GetPipelineCacheData(
-			G_RENDERER.device,
-			INTERNAL.vk_pipeline_cache,
-			&cache_size,
-			raw_data(cache_data),
+		if vk.GetPipelineCacheData(
+			   G_RENDERER.device,
+			   INTERNAL.vk_pipeline_cache,
+			   &cache_size,
+			   raw_data(cache_data),
+		   ) !=
+		   .SUCCESS {
+			log.warn("Failed to get the pipeline cache data\n")
+			return
+		}
+
+		tmp_cache_file := common.aprintf(temp_arena.allocator, "%s.tmp", PIPELINE_CACHE_FILE)
+		if os.write_entire_file(tmp_cache_file, cache_data[:cache_size]) == false ||
+		   os.rename(tmp_cache_file, PIPELINE_CACHE_FILE) != 0 {
+			log.warn("Failed to write the pipeline cache\n")
+			return
+		}
+
+		g_pipeline_stats.cache_size = u64(cache_size)
+	}
+
+	//---------------------------------------------------------------------------//
+
+	// Creates the pipelines in parallel on the job system. Each pipeline is looked up in the
+	// pipeline cache first, using VK_PIPELINE_CREATE_FAIL_ON_PIPELINE_COMPILE_REQUIRED_BIT, and
+	// only compiled when it's not there. Identical pipelines in the batch are compiled once, the
+	// rest are created once that compile is in the cache. The cache is flushed to disk whenever
+	// something was compiled. Returns false if any of the pipelines failed, they're left without
+	// a VkPipeline.
+	@(private)
+	backend_pipelines_create :: proc(
+		p_graphics_pipeline_refs: []GraphicsPipelineRef,
+		p_compute_pipeline_refs: []ComputePipelineRef,
+	) -> bool {
+
+		temp_arena: common.Arena
+		common.temp_arena_init(&temp_arena)
+		defer common.arena_delete(temp_arena)
+
+		start := time.tick_now()
+
+		num_jobs := len(p_graphics_pipeline_refs) + len(p_compute_pipeline_refs)
+		if num_jobs == 0 {
+			return true
+		}
+
+		jobs := make([]PipelineCreateJob, num_jobs, temp_arena.allocator)
+		for pipeline_ref, i in p_graphics_pipeline_refs {
+			jobs[i] = PipelineCreateJob {
+				type                  = .Graphics,
+				graphics_pipeline_ref = pipeline_ref,
+				permutation_key       = calculate_graphics_pipeline_permutation_key(
+					pipeline_ref,
+					temp_arena.allocator,
+				),
+			}
+		}
+		for pipeline_ref, i in p_compute_pipeline_refs {
+			jobs[len(p_graphics_pipeline_refs) + i] = PipelineCreateJob {
+				type                 = .Compute,
+				compute_pipeline_ref = pipeline_ref,
+				permutation_key      = calculate_compute_pipeline_permutation_key(
+					pipeline_ref,
+					temp_arena.allocator,
+				),
+			}
+		}
+
+		// Split the batch into the unique permutations and their duplicates
+		unique_job_indices := make([dynamic]int, temp_arena.allocator)
+		duplicate_job_indices := make([dynamic]int, temp_arena.allocator)
+		{
+			permutation_keys := make(map[u64]bool, num_jobs, temp_arena.allocator)
+			for job, i in jobs {
+				if job.permutation_key in permutation_keys {
+					append(&duplicate_job_indices, i)
+				} else {
+					permutation_keys[job.permutation_key] = true
+					append(&unique_job_indices, i)
+				}
+			}
+		}
+
+		for job_indices in ([][dynamic]int{unique_job_indices, duplicate_job_indices}) {
+			batch := PipelineCreateJobBatch {
+				jobs        = jobs,
+				job_indices = job_indices[:],
+			}
+			common.jobs_parallel_for(u32(len(job_indices)), 1, pipeline_create_job_run, &batch)
+		}
+
+		success := true
+		num_compiled: u32 = 0
+
+		for job in jobs {
+			switch job.result {
+			case .Failed:
+				success = false
+			case .Compiled:
+				num_compiled += 1
+			case .CacheHit:
+				g_pipeline_stats.num_cache_hits += 1
+			}
+		}
+
+		g_pipeline_stats.num_created += u32(num_jobs)
+		g_pipeline_stats.num_compiled += num_compiled
+		g_pipeline_stats.num_duplicates += u32(len(duplicate_job_indices))
+
+		if num_compiled > 0 {
+			flush_pipeline_cache()
+		}
+
+		g_pipeline_stats.create_time_ms += time.duration_milliseconds(time.tick_since(start))
+
+		return success
+	}
+
+	//---------------------------------------------------------------------------//
+
+	@(private = "file")
+	pipeline_create_job_run :: proc(p_start: u32, p_end: u32, p_user_data: rawptr) {
+		batch := (^PipelineCreateJobBatch)(p_user_data)
+
+		for i in p_start ..< p_end {
+			job := &batch.jobs[batch.job_indices[i]]
+
+			// Try the pipeline cache first, so that the cache hits can be told apart
+			res := create_vk_pipeline(job, {.FAIL_ON_PIPELINE_COMPILE_REQUIRED})
+			if res == .SUCCESS {
+				job.result = .CacheHit
+				continue
+			}
+
+			if res == .PIPELINE_COMPILE_REQUIRED {
+				res = create_vk_pipeline(job, {})
+			}
+
+			if res != .SUCCESS {
+				pipeline_name := common.EMPTY_NAME
+				switch job.type {
+				case .Graphics:
+					pipeline_idx := graphics_pipeline_get_idx(job.graphics_pipeline_ref)
+					pipeline_name = g_resources.graphics_pipelines[pipeline_idx].name
+				case .Compute:
+					pipeline_idx := compute_pipeline_get_idx(job.compute_pipeline_ref)
+					pipeline_name = g_resources.compute_pipelines[pipeline_idx].name
+				}
+				log.warnf(
+					"Couldn't create %s pipeline '%s': %s\n",
+					job.type,
+					common.get_string(pipeline_name),
+					res,
+				)
+				job.result = .Failed
+				continue
+			}
+
+			job.result = .Compiled
+		}
+	}
+
+	//---------------------------------------------------------------------------//
+
+	@(private = "file")
+	create_vk_pipeline :: proc(
+		p_job: ^PipelineCreateJob,
+		p_flags: vk.PipelineCreateFlags,
+	) -> vk.Result {
+		switch p_job.type {
+		case .Graphics:
+			return create_vk_graphics_pipeline(p_job.graphics_pipeline_ref, p_flags)
+		case .Compute:
+			return create_vk_compute_pipeline(p_job.compute_pipeline_ref, p_flags)
+		}
+		return .ERROR_UNKNOWN
+	}
+
+	//---------------------------------------------------------------------------//
+
+	@(private = "file")
+	calculate_graphics_pipeline_permutation_key :: proc(
+		p_ref: GraphicsPipelineRef,
+		p_allocator: mem.Allocator,
+	) -> u64 {
+		pipeline_idx := graphics_pipeline_get_idx(p_ref)
+		pipeline := &g_resources.graphics_pipelines[pipeline_idx]
+		backend_pipeline := &g_resources.backend_graphics_pipelines[pipeline_idx]
+		render_pass_idx := render_pass_get_idx(pipeline.desc.render_pass_ref)
+		render_pass := &g_resources.render_passes[render_pass_idx]
+		vert_shader := &g_resources.shaders[shader_get_idx(pipeline.desc.vert_shader_ref)]
+		frag_shader := &g_resources.shaders[shader_get_idx(pipeline.desc.frag_shader_ref)]
+
+		key_builder := strings.builder_make(p_allocator)
+		strings.write_u64(&key_builder, vert_shader.cache_key)
+		strings.write_byte(&key_builder, 0)
+		strings.write_u64(&key_builder, frag_shader.cache_key)
+		strings.write_byte(&key_builder, 0)
+		strings.write_u64(&key_builder, u64(backend_pipeline.pipeline_layout_hash))
+		strings.write_byte(&key_builder, 0)
+		strings.write_int(&key_builder, int(pipeline.desc.vertex_layout))
+		strings.write_int(&key_builder, int(render_pass.desc.primitive_type))
+		strings.write_int(&key_builder, int(render_pass.desc.resterizer_type))
+		strings.write_int(&key_builder, int(render_pass.desc.multisampling_type))
+		strings.write_int(&key_builder, int(render_pass.desc.depth_stencil_type))
+		strings.write_int(&key_builder, int(render_pass.desc.layout.depth_format))
+		for format, i in render_pass.desc.layout.render_target_formats {
+			blend_type := render_pass.desc.layout.render_target_blend_types[i]
+			strings.write_byte(&key_builder, 0)
+			strings.write_int(&key_builder, int(format))
+			strings.write_int(&key_builder, int(blend_type))
+		}
+
+		return hash.fnv64a(key_builder.buf[:])
+	}
+
+	//---------------------------------------------------------------------------//
+
+	@(private = "file")
+	calculate_compute_pipeline_permutation_key :: proc(
+		p_ref: ComputePipelineRef,
+		p_allocator: mem.Allocator,
+	) -> u64 {
+		pipeline_idx := compute_pipeline_get_idx(p_ref)
+		pipeline := &g_resources.compute_pipelines[pipeline_idx]
+		backend_pipeline := &g_resources.backend_compute_pipelines[pipeline_idx]
+		compute_shader := &g_resources.shaders[shader_get_idx(pipeline.desc.compute_shader_ref)]
+
+		key_builder := strings.builder_make(p_allocator)
+		strings.write_u64(&key_builder, compute_shader.cache_key)
+		strings.write_byte(&key_builder, 0)
+		strings.write_string(
+			&key_builder,
+			common.get_string(compute_shader.desc.custom_entry_point),
 		)
+		strings.write_byte(&key_builder, 0)
+		strings.write_u64(&key_builder, u64(backend_pipeline.pipeline_layout_hash))
 
-		os.write_entire_file(PIPELINE_CACHE_FILE, cache_data)
+		return hash.fnv64a(key_builder.buf[:])
 	}
 
 	//---------------------------------------------------------------------------//
 
-	backend_graphics_pipeline_create :: proc(p_ref: GraphicsPipelineRef) -> bool {
+	// Resolves the pipeline layout, the pipeline itself is created by backend_pipelines_create()
+	@(private)
+	backend_graphics_pipeline_create_layout :: proc(p_ref: GraphicsPipelineRef) -> bool {
+		pipeline_idx := graphics_pipeline_get_idx(p_ref)
+		pipeline := &g_resources.graphics_pipelines[pipeline_idx]
+		backend_pipeline := &g_resources.backend_graphics_pipelines[pipeline_idx]
+
+		backend_pipeline.vk_pipeline = 0
+		backend_pipeline.vk_pipeline_layout, backend_pipeline.pipeline_layout_hash =
+			get_cached_or_create_pipeline_layout(
+				pipeline.desc.bind_group_layout_refs,
+				pipeline.desc.push_constants,
+			) or_return
+
+		return true
+	}
+
+	//---------------------------------------------------------------------------//
+
+	// Called from the job system workers, the pipeline layout has to be resolved already
+	@(private = "file")
+	create_vk_graphics_pipeline :: proc(
+		p_ref: GraphicsPipelineRef,
+		p_flags: vk.PipelineCreateFlags,
+	) -> vk.Result {
 
 		pipeline_idx := graphics_pipeline_get_idx(p_ref)
 		pipeline := &g_resources.graphics_pipelines[pipeline_idx]
@@ -326,13 +639,6 @@ when USE_VULKAN_BACKEND {
 		// Depth stencil
 		depth_stencil := DEPTH_STENCIL_STATE_PER_TYPE[render_pass.desc.depth_stencil_type]
 
-		// Pipeline layout
-		backend_pipeline.vk_pipeline_layout, backend_pipeline.pipeline_layout_hash =
-			get_cached_or_create_pipeline_layout(
-				pipeline.desc.bind_group_layout_refs,
-				pipeline.desc.push_constants,
-			) or_return
-
 		// Map color attachment formats
 		color_attachment_formats := make(
 			[]vk.Format,
@@ -387,6 +693,7 @@ when USE_VULKAN_BACKEND {
 
 		pipeline_info := vk.GraphicsPipelineCreateInfo {
 			sType               = .GRAPHICS_PIPELINE_CREATE_INFO,
+			flags               = p_flags,
 			pDynamicState       = &dynamic_state_create_info,
 			pNext               = &pipeline_rendering_create_info,
 			stageCount          = u32(len(shader_stages)),
@@ -401,19 +708,14 @@ when USE_VULKAN_BACKEND {
 			pViewportState      = &viewport_state,
 		}
 
-		if res := vk.CreateGraphicsPipelines(
+		return vk.CreateGraphicsPipelines(
 			G_RENDERER.device,
-			0,
+			INTERNAL.vk_pipeline_cache,
 			1,
 			&pipeline_info,
 			nil,
 			&backend_pipeline.vk_pipeline,
-		); res != .SUCCESS {
-			log.warnf("Couldn't create graphics pipeline: %s", res)
-			return false
-		}
-
-		return true
+		)
 	}
 
 	//---------------------------------------------------------------------------//
@@ -584,7 +886,31 @@ when USE_VULKAN_BACKEND {
 
 	//---------------------------------------------------------------------------//
 
-	backend_compute_pipeline_create :: proc(p_ref: ComputePipelineRef) -> bool {
+	// Resolves the pipeline layout, the pipeline itself is created by backend_pipelines_create()
+	@(private)
+	backend_compute_pipeline_create_layout :: proc(p_ref: ComputePipelineRef) -> bool {
+		pipeline_idx := compute_pipeline_get_idx(p_ref)
+		pipeline := &g_resources.compute_pipelines[pipeline_idx]
+		backend_pipeline := &g_resources.backend_compute_pipelines[pipeline_idx]
+
+		backend_pipeline.vk_pipeline = 0
+		backend_pipeline.vk_pipeline_layout, backend_pipeline.pipeline_layout_hash =
+			get_cached_or_create_pipeline_layout(
+				pipeline.desc.bind_group_layout_refs,
+				pipeline.desc.push_constants,
+			) or_return
+
+		return true
+	}
+
+	//---------------------------------------------------------------------------//
+
+	// Called from the job system workers, the pipeline layout has to be resolved already
+	@(private = "file")
+	create_vk_compute_pipeline :: proc(
+		p_ref: ComputePipelineRef,
+		p_flags: vk.PipelineCreateFlags,
+	) -> vk.Result {
 
 		pipeline_idx := compute_pipeline_get_idx(p_ref)
 		pipeline := &g_resources.compute_pipelines[pipeline_idx]
@@ -612,32 +938,21 @@ when USE_VULKAN_BACKEND {
 			)
 		}
 
-		// Pipeline layout 
-		backend_pipeline.vk_pipeline_layout, backend_pipeline.pipeline_layout_hash =
-			get_cached_or_create_pipeline_layout(
-				pipeline.desc.bind_group_layout_refs,
-				pipeline.desc.push_constants,
-			) or_return
-
 		pipeline_info := vk.ComputePipelineCreateInfo {
 				sType  = .COMPUTE_PIPELINE_CREATE_INFO,
+				flags  = p_flags,
 				layout = backend_pipeline.vk_pipeline_layout,
 				stage  = compute_stage_info,
 			}
 
-		if res := vk.CreateComputePipelines(
+		return vk.CreateComputePipelines(
 			G_RENDERER.device,
-			0,
+			INTERNAL.vk_pipeline_cache,
 			1,
 			&pipeline_info,
 			nil,
 			&backend_pipeline.vk_pipeline,
-		); res != .SUCCESS {
-			log.warnf("Couldn't create compute pipeline: %s", res)
-			return false
-		}
-
-		return true
+		)
 	}
 
 	//---------------------------------------------------------------------------//
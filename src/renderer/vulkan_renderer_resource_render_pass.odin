@@ -14,8 +14,21 @@ when USE_VULKAN_BACKEND {
 	@(private = "file")
 	INTERNAL: struct{}
 
+	@(private = "file")
+	MAX_COLOR_ATTACHMENTS :: 8
+
+	//---------------------------------------------------------------------------//
+
 	@(private)
-	BackendRenderPassResource :: struct {}
+	BackendRenderPassResource :: struct {
+		// State of the active render pass, secondary command buffers
+		// recorded within the render pass are begun with it
+		vk_viewport:       vk.Viewport,
+		vk_scissor:        vk.Rect2D,
+		vk_color_formats:  [MAX_COLOR_ATTACHMENTS]vk.Format,
+		num_color_formats: u32,
+		vk_depth_format:   vk.Format,
+	}
 
 	@(private)
 	backrender_pass_end_init :: proc() {
@@ -45,11 +58,15 @@ when USE_VULKAN_BACKEND {
 	) {
 		render_pass_idx := render_pass_get_idx(p_render_pass_ref)
 		render_pass := &g_resources.render_passes[render_pass_idx]
+		backend_render_pass := &g_resources.backrender_pass_endes[render_pass_idx]
 
 		assert((.IsActive in render_pass.flags) == false)
 
 		render_pass.flags += {.IsActive}
 
+		backend_render_pass.num_color_formats = 0
+		backend_render_pass.vk_depth_format = .UNDEFINED
+
 		temp_arena: common.Arena
 		common.temp_arena_init(&temp_arena)
 		defer common.arena_delete(temp_arena)
@@ -116,6 +133,8 @@ when USE_VULKAN_BACKEND {
 					storeOp = .STORE,
 				}
 
+				backend_render_pass.vk_depth_format = G_IMAGE_FORMAT_MAPPING[image.desc.format]
+
 				continue
 			}
 
@@ -132,6 +151,8 @@ when USE_VULKAN_BACKEND {
 				storeOp = .STORE,
 			}
 
+			backend_render_pass.vk_color_formats[color_attachments_count] =
+				G_IMAGE_FORMAT_MAPPING[image.desc.format]
 			color_attachments_count += 1
 
 			image_backend.vk_layouts[output.array_layer][output.mip] = new_layout
@@ -176,6 +197,18 @@ when USE_VULKAN_BACKEND {
 			extent = render_area,
 		}
 
+		backend_render_pass.vk_viewport = viewport
+		backend_render_pass.vk_scissor = scissor
+		backend_render_pass.num_color_formats = u32(color_attachments_count)
+
+		// Only vkCmdExecuteCommands can be recorded when the contents are in secondary command
+		// buffers, they set the render state themselves in backend_command_buffer_begin_secondary
+		if .SecondaryCommandBuffers in p_begin_info.flags {
+			rendering_info.flags = {.CONTENTS_SECONDARY_COMMAND_BUFFERS}
+			vk.CmdBeginRendering(backend_cmd_buffer.vk_cmd_buff, &rendering_info)
+			return
+		}
+
 		// Setup render state
 		vk.CmdBeginRendering(backend_cmd_buffer.vk_cmd_buff, &rendering_info)
 		vk.CmdSetViewport(backend_cmd_buffer.vk_cmd_buff, 0, 1, &viewport)
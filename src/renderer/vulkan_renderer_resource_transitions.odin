@@ -11,47 +11,47 @@ when USE_VULKAN_BACKEND {
 
 	//---------------------------------------------------------------------------//	
 
+	@(private = "file")
+	BarrierGroup :: enum u8 {
+		Input,
+		Depth,
+		Output,
+	}
+
+	//---------------------------------------------------------------------------//	
+
+	// All of the barriers needed by the bindings of a single transition, recorded for one queue
+	// with a single vkCmdPipelineBarrier2, so the GPU only drains the pipeline once per transition
+	@(private = "file")
+	BarrierBatch :: struct {
+		image_barriers:  [dynamic]vk.ImageMemoryBarrier2,
+		buffer_barriers: [dynamic]vk.BufferMemoryBarrier2,
+		// Kinds of barriers in the batch, each one used to be recorded separately
+		groups:          bit_set[BarrierGroup],
+	}
+
+	//---------------------------------------------------------------------------//	
+
 	@(private)
 	backend_transition_binding_resources :: proc(
 		p_bindings: []Binding,
 		p_pipeline_type: PipelineType,
 		p_async_compute: bool,
+		p_async_compute_stage: AsyncComputeStage,
 	) {
 
 		temp_arena: common.Arena
 		common.temp_arena_init(&temp_arena)
 		defer common.arena_delete(temp_arena)
 
-		input_image_barriers_graphics := make([dynamic]vk.ImageMemoryBarrier, temp_arena.allocator)
-		input_image_barriers_compute := make([dynamic]vk.ImageMemoryBarrier, temp_arena.allocator)
-
-		input_buffer_barriers_graphics := make(
-			[dynamic]vk.BufferMemoryBarrier,
-			temp_arena.allocator,
-		)
-		input_buffer_barriers_compute := make(
-			[dynamic]vk.BufferMemoryBarrier,
-			temp_arena.allocator,
-		)
-
-		output_image_barriers_graphics := make(
-			[dynamic]vk.ImageMemoryBarrier,
-			temp_arena.allocator,
-		)
-		output_image_barriers_compute := make([dynamic]vk.ImageMemoryBarrier, temp_arena.allocator)
-
-		output_buffer_barriers_graphics := make(
-			[dynamic]vk.BufferMemoryBarrier,
-			temp_arena.allocator,
-		)
-		output_buffer_barriers_compute := make(
-			[dynamic]vk.BufferMemoryBarrier,
-			temp_arena.allocator,
-		)
-
-		depth_barrier := vk.ImageMemoryBarrier{}
-		graphics_depth_barrier_needed := false
-		compute_depth_barrier_needed := false
+		graphics_batch := BarrierBatch {
+			image_barriers  = make([dynamic]vk.ImageMemoryBarrier2, temp_arena.allocator),
+			buffer_barriers = make([dynamic]vk.BufferMemoryBarrier2, temp_arena.allocator),
+		}
+		compute_batch := BarrierBatch {
+			image_barriers  = make([dynamic]vk.ImageMemoryBarrier2, temp_arena.allocator),
+			buffer_barriers = make([dynamic]vk.BufferMemoryBarrier2, temp_arena.allocator),
+		}
 
 		dst_queue: DeviceQueueType = .Compute if p_async_compute else .Graphics
 
@@ -61,177 +61,231 @@ when USE_VULKAN_BACKEND {
 				create_barrier_for_input_image(
 					binding,
 					p_pipeline_type,
-					p_async_compute,
 					dst_queue,
-					&input_image_barriers_graphics,
-					&input_image_barriers_compute,
+					&graphics_batch,
+					&compute_batch,
 				)
 
 			case OutputImageBinding:
 				create_barrier_for_output_image(
 					binding,
 					p_pipeline_type,
-					p_async_compute,
 					dst_queue,
-					&output_image_barriers_graphics,
-					&output_image_barriers_compute,
-					&depth_barrier,
-					&graphics_depth_barrier_needed,
-					&compute_depth_barrier_needed,
+					&graphics_batch,
+					&compute_batch,
 				)
 
 			case InputBufferBinding:
 				create_barrier_for_input_buffer(
 					binding,
 					p_pipeline_type,
-					p_async_compute,
 					dst_queue,
-					&input_buffer_barriers_graphics,
-					&input_buffer_barriers_compute,
+					&graphics_batch,
+					&compute_batch,
 				)
 
 			case OutputBufferBinding:
 				create_barrier_for_output_buffer(
 					binding,
 					p_pipeline_type,
-					p_async_compute,
 					dst_queue,
-					&output_buffer_barriers_graphics,
-					&output_buffer_barriers_compute,
+					&graphics_batch,
+					&compute_batch,
 				)
 			}
 		}
 
-		graphics_cmd_buff_ref := get_frame_cmd_buffer_ref()
-		compute_cmd_buff := frame_compute_cmd_buffer_get()
+		// The compute batch of a graphics transition only releases the resources coming from the
+		// async compute, the main command buffer is the last one that could've used them
+		compute_cmd_buff_ref := get_frame_async_compute_cmd_buffer_ref(.Main)
+		if p_async_compute {
+			compute_cmd_buff_ref = get_frame_async_compute_cmd_buffer_ref(p_async_compute_stage)
 
+			// Nothing orders the early command buffer after the graphics queue releasing them
+			num_released := len(graphics_batch.image_barriers) + len(graphics_batch.buffer_barriers)
+			if p_async_compute_stage == .Early && num_released > 0 {
+				async_compute_set_early_waits_for_graphics()
+			}
+		}
+
+		graphics_cmd_buff_ref := get_frame_cmd_buffer_ref()
 		graphics_cmd_buffer_idx := command_buffer_get_idx(graphics_cmd_buff_ref)
 		backend_graphics_cmd_buffer := &g_resources.backend_cmd_buffers[graphics_cmd_buffer_idx]
 
-		// Insert barriers for input
-		if len(input_image_barriers_graphics) > 0 || len(input_buffer_barriers_graphics) > 0 {
-			vk.CmdPipelineBarrier(
-				backend_graphics_cmd_buffer.vk_cmd_buff,
-				{.COMPUTE_SHADER, .COLOR_ATTACHMENT_OUTPUT, .LATE_FRAGMENT_TESTS, .TRANSFER},
-				{.VERTEX_SHADER, .FRAGMENT_SHADER, .COMPUTE_SHADER},
-				{},
-				0,
-				nil,
-				u32(len(input_buffer_barriers_graphics)),
-				raw_data(input_buffer_barriers_graphics),
-				u32(len(input_image_barriers_graphics)),
-				raw_data(input_image_barriers_graphics),
-			)
-		}
+		compute_cmd_buffer_idx := command_buffer_get_idx(compute_cmd_buff_ref)
+		backend_compute_cmd_buffer := &g_resources.backend_cmd_buffers[compute_cmd_buffer_idx]
 
-		if len(input_image_barriers_compute) > 0 || len(input_buffer_barriers_compute) > 0 {
-			vk.CmdPipelineBarrier(
-				compute_cmd_buff,
-				{.COMPUTE_SHADER},
-				{.BOTTOM_OF_PIPE},
-				{},
-				0,
-				nil,
-				u32(len(input_buffer_barriers_compute)),
-				raw_data(input_buffer_barriers_compute),
-				u32(len(input_image_barriers_compute)),
-				raw_data(input_image_barriers_compute),
-			)
+		record_barrier_batch(backend_graphics_cmd_buffer.vk_cmd_buff, &graphics_batch)
+		record_barrier_batch(backend_compute_cmd_buffer.vk_cmd_buff, &compute_batch)
+	}
+
+	//---------------------------------------------------------------------------//	
+
+	@(private)
+	backend_transition_memory :: proc(
+		p_cmd_buff_ref: CommandBufferRef,
+		p_src_stages: PipelineStageFlags,
+		p_dst_stages: PipelineStageFlags,
+	) {
+		src_stages := vk.PipelineStageFlags{}
+		for stage in p_src_stages {
+			src_stages += {backend_map_pipeline_stage(stage)}
 		}
 
-		// Insert depth attachment barrier
-		if graphics_depth_barrier_needed {
-			vk.CmdPipelineBarrier(
-				backend_graphics_cmd_buffer.vk_cmd_buff,
-				{.LATE_FRAGMENT_TESTS} if p_pipeline_type == .Graphics else {.COMPUTE_SHADER},
-				{.EARLY_FRAGMENT_TESTS},
-				{},
-				0,
-				nil,
-				0,
-				nil,
-				1,
-				&depth_barrier,
-			)
+		dst_stages := vk.PipelineStageFlags{}
+		for stage in p_dst_stages {
+			dst_stages += {backend_map_pipeline_stage(stage)}
 		}
 
-		if compute_depth_barrier_needed {
-			vk.CmdPipelineBarrier(
-				compute_cmd_buff,
-				{.LATE_FRAGMENT_TESTS},
-				{.COMPUTE_SHADER},
-				{},
-				0,
-				nil,
-				0,
-				nil,
-				1,
-				&depth_barrier,
-			)
+		memory_barrier := vk.MemoryBarrier {
+			sType         = .MEMORY_BARRIER,
+			srcAccessMask = {.SHADER_WRITE, .TRANSFER_WRITE},
+			dstAccessMask = {.SHADER_READ, .SHADER_WRITE, .INDIRECT_COMMAND_READ},
 		}
 
-		// Insert output barriers
-		if len(output_image_barriers_graphics) > 0 || len(output_buffer_barriers_graphics) > 0 {
-			vk.CmdPipelineBarrier(
-				backend_graphics_cmd_buffer.vk_cmd_buff,
-				{
-					.VERTEX_SHADER,
-					.FRAGMENT_SHADER,
-					.COMPUTE_SHADER,
-					.TRANSFER,
-					.COLOR_ATTACHMENT_OUTPUT,
-				},
-				{.COLOR_ATTACHMENT_OUTPUT} if p_pipeline_type == .Graphics else {.COMPUTE_SHADER},
-				{},
-				0,
-				nil,
-				u32(len(output_buffer_barriers_graphics)),
-				raw_data(output_buffer_barriers_graphics),
-				u32(len(output_image_barriers_graphics)),
-				raw_data(output_image_barriers_graphics),
-			)
+		backend_cmd_buffer := &g_resources.backend_cmd_buffers[command_buffer_get_idx(p_cmd_buff_ref)]
+
+		vk.CmdPipelineBarrier(
+			backend_cmd_buffer.vk_cmd_buff,
+			src_stages,
+			dst_stages,
+			{},
+			1,
+			&memory_barrier,
+			0,
+			nil,
+			0,
+			nil,
+		)
+	}
+
+	//---------------------------------------------------------------------------//	
+
+	@(private = "file")
+	record_barrier_batch :: proc(p_vk_cmd_buff: vk.CommandBuffer, p_batch: ^BarrierBatch) {
+		num_barriers := len(p_batch.image_barriers) + len(p_batch.buffer_barriers)
+		if num_barriers == 0 {
+			return
 		}
 
-		if len(output_image_barriers_compute) > 0 || len(output_buffer_barriers_compute) > 0 {
-			vk.CmdPipelineBarrier(
-				compute_cmd_buff,
-				{.COMPUTE_SHADER},
-				{.TOP_OF_PIPE},
-				{},
-				0,
-				nil,
-				u32(len(output_buffer_barriers_compute)),
-				raw_data(output_buffer_barriers_compute),
-				u32(len(output_image_barriers_compute)),
-				raw_data(output_image_barriers_compute),
-			)
+		dependency_info := vk.DependencyInfo {
+			sType                    = .DEPENDENCY_INFO,
+			bufferMemoryBarrierCount = u32(len(p_batch.buffer_barriers)),
+			pBufferMemoryBarriers    = raw_data(p_batch.buffer_barriers),
+			imageMemoryBarrierCount  = u32(len(p_batch.image_barriers)),
+			pImageMemoryBarriers     = raw_data(p_batch.image_barriers),
 		}
+
+		vk.CmdPipelineBarrier2(p_vk_cmd_buff, &dependency_info)
+
+		g_render_graph_stats.num_barriers += u32(num_barriers)
+		g_render_graph_stats.num_barrier_batches += 1
+		g_render_graph_stats.num_merged_barrier_batches += u32(card(p_batch.groups)) - 1
 	}
 
-	//---------------------------------------------------------------------------//	
+	//---------------------------------------------------------------------------//
 
+	// Records the barrier for the queue the resource is used on next. When the other queue used it
+	// before, that queue releases it first, unless its content is discarded. The queues are
+	// synchronized with semaphores, see renderer_async_compute.odin, so the acquire barrier only
+	// has to chain the layout transition to the semaphore wait.
 	@(private = "file")
-	insert_async_compute_barriers :: proc(
-		p_image_barrier: vk.ImageMemoryBarrier,
-		p_pipeline_type: PipelineType,
-		p_async_compute: bool,
-		p_graphics_barriers: ^[dynamic]vk.ImageMemoryBarrier,
-		p_compute_barriers: ^[dynamic]vk.ImageMemoryBarrier,
+	append_image_barrier :: proc(
+		p_image_barrier: vk.ImageMemoryBarrier2,
+		p_group: BarrierGroup,
+		p_src_queue: DeviceQueueType,
+		p_dst_queue: DeviceQueueType,
+		p_graphics_batch: ^BarrierBatch,
+		p_compute_batch: ^BarrierBatch,
 	) {
+		barrier := p_image_barrier
+		barrier.srcStageMask = vk_mask_stages_for_queue(barrier.srcStageMask, p_dst_queue)
+		barrier.srcQueueFamilyIndex = vk.QUEUE_FAMILY_IGNORED
+		barrier.dstQueueFamilyIndex = vk.QUEUE_FAMILY_IGNORED
+
+		if p_src_queue != p_dst_queue {
+			if barrier.oldLayout != .UNDEFINED {
+				barrier.srcQueueFamilyIndex = get_queue_family_index(p_src_queue)
+				barrier.dstQueueFamilyIndex = get_queue_family_index(p_dst_queue)
+
+				release_barrier := barrier
+				release_barrier.srcStageMask = vk_mask_stages_for_queue(
+					p_image_barrier.srcStageMask,
+					p_src_queue,
+				)
+				release_barrier.dstStageMask = {}
+				release_barrier.dstAccessMask = {}
 
-		if p_async_compute {
+				src_batch := get_queue_batch(p_src_queue, p_graphics_batch, p_compute_batch)
+				append(&src_batch.image_barriers, release_barrier)
+				src_batch.groups += {p_group}
+			}
+
+			barrier.srcStageMask = {.ALL_COMMANDS}
+			barrier.srcAccessMask = {}
+		}
 
-			assert(p_pipeline_type == .Compute)
-			append(p_compute_barriers, p_image_barrier)
+		dst_batch := get_queue_batch(p_dst_queue, p_graphics_batch, p_compute_batch)
+		append(&dst_batch.image_barriers, barrier)
+		dst_batch.groups += {p_group}
+	}
 
-			if p_image_barrier.srcAccessMask != p_image_barrier.dstAccessMask {
-				append(p_graphics_barriers, p_image_barrier)
+	//---------------------------------------------------------------------------//
+
+	// Same as append_image_barrier(), buffers shared by both of the queues don't change owners
+	@(private = "file")
+	append_buffer_barrier :: proc(
+		p_buffer_barrier: vk.BufferMemoryBarrier2,
+		p_group: BarrierGroup,
+		p_buffer: ^BufferResource,
+		p_dst_queue: DeviceQueueType,
+		p_graphics_batch: ^BarrierBatch,
+		p_compute_batch: ^BarrierBatch,
+	) {
+		barrier := p_buffer_barrier
+		barrier.srcStageMask = vk_mask_stages_for_queue(barrier.srcStageMask, p_dst_queue)
+		barrier.srcQueueFamilyIndex = vk.QUEUE_FAMILY_IGNORED
+		barrier.dstQueueFamilyIndex = vk.QUEUE_FAMILY_IGNORED
+
+		src_queue := p_buffer.queue
+		if src_queue != p_dst_queue {
+			if .SharingModeConcurrent not_in p_buffer.desc.flags {
+				barrier.srcQueueFamilyIndex = get_queue_family_index(src_queue)
+				barrier.dstQueueFamilyIndex = get_queue_family_index(p_dst_queue)
+
+				release_barrier := barrier
+				release_barrier.srcStageMask = vk_mask_stages_for_queue(
+					p_buffer_barrier.srcStageMask,
+					src_queue,
+				)
+				release_barrier.dstStageMask = {}
+				release_barrier.dstAccessMask = {}
+
+				src_batch := get_queue_batch(src_queue, p_graphics_batch, p_compute_batch)
+				append(&src_batch.buffer_barriers, release_barrier)
+				src_batch.groups += {p_group}
 			}
 
-			return
+			barrier.srcStageMask = {.ALL_COMMANDS}
+			barrier.srcAccessMask = {}
 		}
 
-		append(p_graphics_barriers, p_image_barrier)
+		dst_batch := get_queue_batch(p_dst_queue, p_graphics_batch, p_compute_batch)
+		append(&dst_batch.buffer_barriers, barrier)
+		dst_batch.groups += {p_group}
+
+		p_buffer.queue = p_dst_queue
+	}
+
+	//---------------------------------------------------------------------------//
+
+	@(private = "file")
+	get_queue_batch :: #force_inline proc(
+		p_queue: DeviceQueueType,
+		p_graphics_batch: ^BarrierBatch,
+		p_compute_batch: ^BarrierBatch,
+	) -> ^BarrierBatch {
+		return p_compute_batch if p_queue == .Compute else p_graphics_batch
 	}
 
 	//---------------------------------------------------------------------------//
@@ -240,17 +294,15 @@ when USE_VULKAN_BACKEND {
 	create_barrier_for_input_image :: proc(
 		p_binding: InputImageBinding,
 		p_pipeline_type: PipelineType,
-		p_async_compute: bool,
 		p_dst_queue: DeviceQueueType,
-		p_graphics_barriers: ^[dynamic]vk.ImageMemoryBarrier,
-		p_compute_barriers: ^[dynamic]vk.ImageMemoryBarrier,
+		p_graphics_batch: ^BarrierBatch,
+		p_compute_batch: ^BarrierBatch,
 	) {
 
 		image_idx := image_get_idx(p_binding.image_ref)
 		image := &g_resources.images[image_idx]
 
 		new_layout := vk.ImageLayout.SHADER_READ_ONLY_OPTIMAL
-		dst_access_mask := vk.AccessFlags{.SHADER_READ}
 		aspect_mask := vk.ImageAspectFlags{.COLOR}
 
 		if image.desc.format > .DepthFormatsStart && image.desc.format < .DepthFormatsEnd {
@@ -265,20 +317,33 @@ when USE_VULKAN_BACKEND {
 		}
 
 		image_backend := &g_resources.backend_images[image_idx]
+		src_queue := image.queue
 
-		for array_layer in 0 ..< p_binding.array_layer_count {
-			for mip in 0 ..< p_binding.mip_count {
+		for layer_offset in 0 ..< p_binding.array_layer_count {
+			for mip_offset in 0 ..< p_binding.mip_count {
+
+				array_layer := p_binding.base_array_layer + layer_offset
+				mip := p_binding.base_mip + mip_offset
 
 				old_layout := image_backend.vk_layouts[array_layer][mip]
 
-				if old_layout == new_layout {
+				// Read after read on the same queue, nothing to wait for
+				if old_layout == new_layout && src_queue == p_dst_queue {
+					g_render_graph_stats.num_skipped_barriers += 1
 					continue
 				}
 
-				image_input_barrier := vk.ImageMemoryBarrier {
-					sType = .IMAGE_MEMORY_BARRIER,
-					srcAccessMask = vk_resolve_access_from_layout(old_layout),
-					dstAccessMask = dst_access_mask,
+				src_stage_mask, src_access_mask := vk_resolve_src_scope_from_layout(
+					image,
+					old_layout,
+				)
+
+				image_input_barrier := vk.ImageMemoryBarrier2 {
+					sType = .IMAGE_MEMORY_BARRIER_2,
+					srcStageMask = src_stage_mask,
+					srcAccessMask = src_access_mask,
+					dstStageMask = vk_resolve_shader_stages(p_pipeline_type),
+					dstAccessMask = {.SHADER_SAMPLED_READ},
 					oldLayout = old_layout,
 					newLayout = new_layout,
 					image = image_backend.vk_image,
@@ -291,24 +356,20 @@ when USE_VULKAN_BACKEND {
 					},
 				}
 
-				if p_async_compute {
-					image_input_barrier.srcQueueFamilyIndex = get_queue_family_index(image.queue)
-					image_input_barrier.dstQueueFamilyIndex = get_queue_family_index(p_dst_queue)
-				}
-
-				image.queue = p_dst_queue
-
-				insert_async_compute_barriers(
+				append_image_barrier(
 					image_input_barrier,
-					p_pipeline_type,
-					p_async_compute,
-					p_graphics_barriers,
-					p_compute_barriers,
+					.Input,
+					src_queue,
+					p_dst_queue,
+					p_graphics_batch,
+					p_compute_batch,
 				)
 
 				image_backend.vk_layouts[array_layer][mip] = new_layout
 			}
 		}
+
+		image.queue = p_dst_queue
 	}
 
 	//---------------------------------------------------------------------------//
@@ -317,10 +378,9 @@ when USE_VULKAN_BACKEND {
 	create_barrier_for_input_buffer :: proc(
 		p_binding: InputBufferBinding,
 		p_pipeline_type: PipelineType,
-		p_async_compute: bool,
 		p_dst_queue: DeviceQueueType,
-		p_graphics_barriers: ^[dynamic]vk.BufferMemoryBarrier,
-		p_compute_barriers: ^[dynamic]vk.BufferMemoryBarrier,
+		p_graphics_batch: ^BarrierBatch,
+		p_compute_batch: ^BarrierBatch,
 	) {
 
 		if p_binding.usage == .Uniform {
@@ -330,38 +390,37 @@ when USE_VULKAN_BACKEND {
 		buffer := &g_resources.buffers[buffer_get_idx(p_binding.buffer_ref)]
 		backend_buffer := &g_resources.backend_buffers[buffer_get_idx(p_binding.buffer_ref)]
 
-		if buffer.last_access == .Read {
+		// Read after read on the same queue, nothing to wait for
+		if buffer.last_access == .Read && buffer.queue == p_dst_queue {
+			g_render_graph_stats.num_skipped_barriers += 1
 			return
 		}
 
-		buffer_barrier := vk.BufferMemoryBarrier {
-			sType               = .BUFFER_MEMORY_BARRIER,
+		src_stage_mask, src_access_mask := vk_resolve_src_scope_for_buffer(buffer, backend_buffer)
+
+		buffer_barrier := vk.BufferMemoryBarrier2 {
+			sType               = .BUFFER_MEMORY_BARRIER_2,
 			buffer              = backend_buffer.vk_buffer,
-			dstAccessMask       = {.SHADER_READ},
+			srcStageMask        = src_stage_mask,
+			srcAccessMask       = src_access_mask,
+			dstStageMask        = vk_resolve_shader_stages(p_pipeline_type),
+			dstAccessMask       = {.SHADER_STORAGE_READ},
 			offset              = vk.DeviceSize(p_binding.offset),
-			dstQueueFamilyIndex = get_queue_family_index(p_dst_queue),
 			size                = vk.DeviceSize(
 				buffer.desc.size if p_binding.size == 0 else p_binding.size,
 			),
-			srcQueueFamilyIndex = get_queue_family_index(buffer.queue),
 		}
 
 		buffer.last_access = .Read
 
-		if p_async_compute {
-			assert(p_pipeline_type == .Compute)
-			append(p_compute_barriers, buffer_barrier)
-
-			if buffer_barrier.srcAccessMask != buffer_barrier.dstAccessMask {
-				append(p_graphics_barriers, buffer_barrier)
-			}
-		} else {
-			if p_pipeline_type == .Graphics {
-				append(p_graphics_barriers, buffer_barrier)
-			}
-		}
-
-		buffer.queue = p_dst_queue
+		append_buffer_barrier(
+			buffer_barrier,
+			.Input,
+			buffer,
+			p_dst_queue,
+			p_graphics_batch,
+			p_compute_batch,
+		)
 	}
 
 	//---------------------------------------------------------------------------//
@@ -370,13 +429,9 @@ when USE_VULKAN_BACKEND {
 	create_barrier_for_output_image :: proc(
 		p_binding: OutputImageBinding,
 		p_pipeline_type: PipelineType,
-		p_async_compute: bool,
 		p_dst_queue: DeviceQueueType,
-		p_graphics_barriers: ^[dynamic]vk.ImageMemoryBarrier,
-		p_compute_barriers: ^[dynamic]vk.ImageMemoryBarrier,
-		p_depth_barrier: ^vk.ImageMemoryBarrier,
-		p_graphics_depth_barrier_needed: ^bool,
-		p_compute_depth_barrier_needed: ^bool,
+		p_graphics_batch: ^BarrierBatch,
+		p_compute_batch: ^BarrierBatch,
 	) {
 
 		image_idx := image_get_idx(p_binding.image_ref)
@@ -392,6 +447,8 @@ when USE_VULKAN_BACKEND {
 		image_backend := &g_resources.backend_images[image_idx]
 
 		new_layout: vk.ImageLayout = .GENERAL
+		old_layout := image_backend.vk_layouts[p_binding.array_layer][p_binding.base_mip]
+		src_stage_mask, src_access_mask := vk_resolve_src_scope_from_layout(image, old_layout)
 
 		if p_pipeline_type == .Compute {
 
@@ -399,12 +456,14 @@ when USE_VULKAN_BACKEND {
 				image.desc.format > .DepthFormatsStart && image.desc.format < .DepthFormatsEnd
 
 			aspect_mask: vk.ImageAspectFlags = {.DEPTH} if is_depth_image else {.COLOR}
-			old_layout := image_backend.vk_layouts[p_binding.array_layer][p_binding.base_mip]
 
-			image_barrier := vk.ImageMemoryBarrier {
-				sType = .IMAGE_MEMORY_BARRIER,
-				dstAccessMask = {.SHADER_WRITE},
-				srcAccessMask = vk_resolve_access_from_layout(old_layout),
+			// Always needed, even without a layout change, as the previous writes have to finish first
+			image_barrier := vk.ImageMemoryBarrier2 {
+				sType = .IMAGE_MEMORY_BARRIER_2,
+				srcStageMask = src_stage_mask,
+				srcAccessMask = src_access_mask,
+				dstStageMask = {.COMPUTE_SHADER},
+				dstAccessMask = {.SHADER_STORAGE_WRITE},
 				oldLayout = old_layout,
 				newLayout = new_layout,
 				image = image_backend.vk_image,
@@ -415,16 +474,15 @@ when USE_VULKAN_BACKEND {
 					baseMipLevel = u32(p_binding.base_mip),
 					levelCount = u32(p_binding.mip_count),
 				},
-				srcQueueFamilyIndex = get_queue_family_index(image.queue),
-				dstQueueFamilyIndex = get_queue_family_index(p_dst_queue),
 			}
 
-			insert_async_compute_barriers(
+			append_image_barrier(
 				image_barrier,
-				p_pipeline_type,
-				p_async_compute,
-				p_graphics_barriers,
-				p_compute_barriers,
+				.Output,
+				image.queue,
+				p_dst_queue,
+				p_graphics_batch,
+				p_compute_batch,
 			)
 
 			image.queue = p_dst_queue
@@ -441,19 +499,19 @@ when USE_VULKAN_BACKEND {
 			}
 
 			// Check if this image needs to be transitioned
-			current_layout := image_backend.vk_layouts[p_binding.array_layer][p_binding.base_mip]
-			if current_layout == new_layout {
+			if old_layout == new_layout && image.queue == .Graphics {
+				g_render_graph_stats.num_skipped_barriers += 1
 				return
 			}
 
-			p_graphics_depth_barrier_needed^ = true
-
 			// Transition the depth buffer to the expected layout
-			p_depth_barrier^ = {
-				sType = .IMAGE_MEMORY_BARRIER,
+			depth_barrier := vk.ImageMemoryBarrier2 {
+				sType = .IMAGE_MEMORY_BARRIER_2,
+				srcStageMask = src_stage_mask,
+				srcAccessMask = src_access_mask,
+				dstStageMask = {.EARLY_FRAGMENT_TESTS, .LATE_FRAGMENT_TESTS},
 				dstAccessMask = {.DEPTH_STENCIL_ATTACHMENT_READ, .DEPTH_STENCIL_ATTACHMENT_WRITE},
-				srcAccessMask = vk_resolve_access_from_layout(current_layout),
-				oldLayout = image_backend.vk_layouts[p_binding.array_layer][p_binding.base_mip],
+				oldLayout = old_layout,
 				newLayout = new_layout,
 				image = image_backend.vk_image,
 				subresourceRange = {
@@ -463,27 +521,35 @@ when USE_VULKAN_BACKEND {
 					baseMipLevel = u32(p_binding.base_mip),
 					levelCount = u32(p_binding.mip_count),
 				},
-				srcQueueFamilyIndex = get_queue_family_index(image.queue),
-				dstQueueFamilyIndex = get_queue_family_index(.Graphics),
 			}
 
-			p_compute_depth_barrier_needed^ = image.queue != .Graphics
+			append_image_barrier(
+				depth_barrier,
+				.Depth,
+				image.queue,
+				.Graphics,
+				p_graphics_batch,
+				p_compute_batch,
+			)
+
 			image.queue = .Graphics
 		} else {
 
 			new_layout = .ATTACHMENT_OPTIMAL
-			current_layout := image_backend.vk_layouts[p_binding.array_layer][p_binding.base_mip]
 
-			if new_layout == current_layout {
+			if new_layout == old_layout && image.queue == .Graphics {
+				g_render_graph_stats.num_skipped_barriers += 1
 				return
 			}
 
 			// Transition the image to the expected layout
-			image_barrier := vk.ImageMemoryBarrier {
-				sType = .IMAGE_MEMORY_BARRIER,
-				dstAccessMask = {.COLOR_ATTACHMENT_WRITE},
-				oldLayout = current_layout,
-				srcAccessMask = vk_resolve_access_from_layout(current_layout),
+			image_barrier := vk.ImageMemoryBarrier2 {
+				sType = .IMAGE_MEMORY_BARRIER_2,
+				srcStageMask = src_stage_mask,
+				srcAccessMask = src_access_mask,
+				dstStageMask = {.COLOR_ATTACHMENT_OUTPUT},
+				dstAccessMask = {.COLOR_ATTACHMENT_READ, .COLOR_ATTACHMENT_WRITE},
+				oldLayout = old_layout,
 				newLayout = new_layout,
 				image = image_backend.vk_image,
 				subresourceRange = {
@@ -493,20 +559,22 @@ when USE_VULKAN_BACKEND {
 					baseMipLevel = u32(p_binding.base_mip),
 					levelCount = u32(p_binding.mip_count),
 				},
-				srcQueueFamilyIndex = get_queue_family_index(image.queue),
-				dstQueueFamilyIndex = get_queue_family_index(.Graphics),
 			}
 
-			append(p_graphics_barriers, image_barrier)
-			if image.queue != .Graphics {
-				append(p_compute_barriers, image_barrier)
-			}
+			append_image_barrier(
+				image_barrier,
+				.Output,
+				image.queue,
+				.Graphics,
+				p_graphics_batch,
+				p_compute_batch,
+			)
 
 			image.queue = .Graphics
 		}
 
-		for i in p_binding.base_mip ..< p_binding.mip_count {
-			image_backend.vk_layouts[p_binding.array_layer][i] = new_layout
+		for mip in p_binding.base_mip ..< p_binding.base_mip + p_binding.mip_count {
+			image_backend.vk_layouts[p_binding.array_layer][mip] = new_layout
 		}
 	}
 
@@ -516,44 +584,137 @@ when USE_VULKAN_BACKEND {
 	create_barrier_for_output_buffer :: proc(
 		p_binding: OutputBufferBinding,
 		p_pipeline_type: PipelineType,
-		p_async_compute: bool,
 		p_dst_queue: DeviceQueueType,
-		p_graphics_barriers: ^[dynamic]vk.BufferMemoryBarrier,
-		p_compute_barriers: ^[dynamic]vk.BufferMemoryBarrier,
+		p_graphics_batch: ^BarrierBatch,
+		p_compute_batch: ^BarrierBatch,
 	) {
 		buffer := &g_resources.buffers[buffer_get_idx(p_binding.buffer_ref)]
 		backend_buffer := &g_resources.backend_buffers[buffer_get_idx(p_binding.buffer_ref)]
 
-		buffer_barrier := vk.BufferMemoryBarrier {
-			sType               = .BUFFER_MEMORY_BARRIER,
+		src_stage_mask, src_access_mask := vk_resolve_src_scope_for_buffer(buffer, backend_buffer)
+		dst_stage_mask := vk_resolve_shader_stages(p_pipeline_type)
+
+		// The outputs are often read back in the same dispatch, e.g. atomic counters
+		buffer_barrier := vk.BufferMemoryBarrier2 {
+			sType               = .BUFFER_MEMORY_BARRIER_2,
 			buffer              = backend_buffer.vk_buffer,
-			dstAccessMask       = {.SHADER_WRITE},
+			srcStageMask        = src_stage_mask,
+			srcAccessMask       = src_access_mask,
+			dstStageMask        = dst_stage_mask,
+			dstAccessMask       = {.SHADER_STORAGE_READ, .SHADER_STORAGE_WRITE},
 			offset              = vk.DeviceSize(p_binding.offset),
-			dstQueueFamilyIndex = get_queue_family_index(p_dst_queue),
 			size                = vk.DeviceSize(
 				buffer.desc.size if p_binding.size == 0 else p_binding.size,
 			),
-			srcQueueFamilyIndex = get_queue_family_index(buffer.queue),
 		}
 
-		// if p_binding.needs_read_barrier {
-		// 	buffer_barrier.srcAccessMask = {.SHADER_WRITE}
-		// 	buffer_barrier.dstAccessMask += {.SHADER_READ}
-		// }
+		append_buffer_barrier(
+			buffer_barrier,
+			.Output,
+			buffer,
+			p_dst_queue,
+			p_graphics_batch,
+			p_compute_batch,
+		)
 
-		if p_async_compute {
-			assert(p_pipeline_type == .Compute)
-			append(p_compute_barriers, buffer_barrier)
+		buffer.last_access = .Write
+		backend_buffer.last_write_stages = dst_stage_mask
+	}
+
+	//---------------------------------------------------------------------------//
+
+	@(private = "file")
+	vk_resolve_shader_stages :: proc(p_pipeline_type: PipelineType) -> vk.PipelineStageFlags2 {
+		if p_pipeline_type == .Compute {
+			return {.COMPUTE_SHADER}
+		}
+		return {.VERTEX_SHADER, .FRAGMENT_SHADER}
+	}
+
+	//---------------------------------------------------------------------------//
+
+	// The stages are resolved from the previous use of the resource, whichever queue it was on,
+	// so the graphics ones are dropped from the barriers recorded on the compute queue
+	@(private = "file")
+	vk_mask_stages_for_queue :: proc(
+		p_stages: vk.PipelineStageFlags2,
+		p_queue: DeviceQueueType,
+	) -> vk.PipelineStageFlags2 {
+		if p_queue != .Compute {
+			return p_stages
+		}
+		return p_stages & {.COMPUTE_SHADER, .ALL_TRANSFER, .DRAW_INDIRECT, .ALL_COMMANDS}
+	}
+
+	//---------------------------------------------------------------------------//
 
-			if buffer_barrier.srcAccessMask != buffer_barrier.dstAccessMask {
-				append(p_graphics_barriers, buffer_barrier)
+	// Stages and accesses of the previous use of an image, based on the layout it was left in
+	@(private = "file")
+	vk_resolve_src_scope_from_layout :: proc(
+		p_image: ^ImageResource,
+		p_image_layout: vk.ImageLayout,
+	) -> (
+		vk.PipelineStageFlags2,
+		vk.AccessFlags2,
+	) {
+		#partial switch p_image_layout {
+		case .GENERAL:
+			// Only the compute outputs are left in the general layout
+			return {.COMPUTE_SHADER}, {.SHADER_STORAGE_WRITE}
+		case .ATTACHMENT_OPTIMAL:
+			return {.COLOR_ATTACHMENT_OUTPUT}, {.COLOR_ATTACHMENT_WRITE}
+		case .DEPTH_ATTACHMENT_OPTIMAL, .DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+			return {.EARLY_FRAGMENT_TESTS, .LATE_FRAGMENT_TESTS},
+				{.DEPTH_STENCIL_ATTACHMENT_WRITE}
+		case .TRANSFER_SRC_OPTIMAL:
+			return {.ALL_TRANSFER}, {}
+		case .TRANSFER_DST_OPTIMAL:
+			return {.ALL_TRANSFER}, {.TRANSFER_WRITE}
+		case .SHADER_READ_ONLY_OPTIMAL,
+		     .DEPTH_READ_ONLY_OPTIMAL,
+		     .DEPTH_STENCIL_READ_ONLY_OPTIMAL:
+			// Write after read only needs the reads to finish
+			return {.VERTEX_SHADER, .FRAGMENT_SHADER, .COMPUTE_SHADER}, {}
+		case .PRESENT_SRC_KHR:
+			// Chains with the swap image acquire semaphore wait
+			return {.COLOR_ATTACHMENT_OUTPUT}, {}
+		case .UNDEFINED:
+			if .SwapImage in p_image.desc.flags {
+				return {.COLOR_ATTACHMENT_OUTPUT}, {}
 			}
-		} else {
-			append(p_graphics_barriers, buffer_barrier)
+			// The memory of an aliased image was used by a different image before,
+			// its writes have to finish before this one overwrites it
+			if .Aliased in p_image.flags {
+				return {.ALL_COMMANDS}, {.MEMORY_WRITE}
+			}
+			return {}, {}
 		}
 
-		buffer.queue = p_dst_queue
-		buffer.last_access = .Write
+		assert(false)
+
+		return {}, {}
+	}
+
+	//---------------------------------------------------------------------------//
+
+	@(private = "file")
+	vk_resolve_src_scope_for_buffer :: proc(
+		p_buffer: ^BufferResource,
+		p_backend_buffer: ^BackendBufferResource,
+	) -> (
+		vk.PipelineStageFlags2,
+		vk.AccessFlags2,
+	) {
+		switch p_buffer.last_access {
+		case .None:
+			// Not used by a render task yet, the contents come from an upload
+			return {.ALL_TRANSFER}, {.TRANSFER_WRITE}
+		case .Read:
+			return {.VERTEX_SHADER, .FRAGMENT_SHADER, .COMPUTE_SHADER}, {}
+		case .Write:
+			return p_backend_buffer.last_write_stages, {.SHADER_STORAGE_WRITE}
+		}
+		return {}, {}
 	}
 
 	//---------------------------------------------------------------------------//
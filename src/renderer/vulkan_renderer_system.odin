@@ -4,7 +4,10 @@ package renderer
 
 import "base:runtime"
 import "core:c"
+import "core:dynlib"
 import "core:log"
+import "core:math/linalg/glsl"
+import "core:sync"
 
 import vma "../third_party/vma"
 import sdl "vendor:sdl2"
@@ -33,6 +36,25 @@ when USE_VULKAN_BACKEND {
 
 	//---------------------------------------------------------------------------//
 
+	// Loaded directly in headless mode, as there's no SDL window to get the loader from
+	@(private = "file")
+	VULKAN_LIBRARY_PATH :: "vulkan-1.dll" when ODIN_OS == .Windows else "libvulkan.so.1"
+
+	@(private = "file")
+	VULKAN_VALIDATION_LAYER_NAME :: "VK_LAYER_KHRONOS_validation"
+
+	//---------------------------------------------------------------------------//
+
+	// The validation messages are reported on the driver's threads, so the callback logs
+	// them with a copy of the renderer logger
+	@(private = "file")
+	G_VALIDATION: struct {
+		logger:     log.Logger,
+		num_errors: u32,
+	}
+
+	//---------------------------------------------------------------------------//
+
 	@(private)
 	BackendRendererState :: struct {
 		window:                        ^sdl.Window,
@@ -68,6 +90,9 @@ when USE_VULKAN_BACKEND {
 		swap_img_idx:                  u32,
 		transfer_fences_pre_graphics:  []vk.Fence,
 		transfer_fences_post_graphics: []vk.Fence,
+		// Allocations of the offscreen images that replace the swapchain images in headless mode
+		headless_image_allocations:    [dynamic]vma.Allocation,
+		debug_messenger:               vk.DebugUtilsMessengerEXT,
 	}
 
 	//---------------------------------------------------------------------------//
@@ -79,20 +104,38 @@ when USE_VULKAN_BACKEND {
 			name:     cstring,
 			required: bool,
 		} {
-			{name = vk.KHR_SWAPCHAIN_EXTENSION_NAME, required = true},
+			{name = vk.KHR_SWAPCHAIN_EXTENSION_NAME, required = G_RENDERER.is_headless == false},
 			{name = vk.KHR_MAINTENANCE1_EXTENSION_NAME, required = true},
 			{name = vk.KHR_MAINTENANCE3_EXTENSION_NAME, required = true},
 			{name = vk.KHR_MAINTENANCE_5_EXTENSION_NAME, required = true},
 			{name = vk.EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME, required = true},
+			{name = vk.KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME, required = true},
 			{name = vk.EXT_DEBUG_MARKER_EXTENSION_NAME, required = false},
 		}
 
 
 		G_RENDERER.window = p_options.window
-		G_RENDERER.windowID = sdl.GetWindowID(p_options.window)
 
 		// Load the base vulkan procedures
-		vk.load_proc_addresses(sdl.Vulkan_GetVkGetInstanceProcAddr())
+		if G_RENDERER.is_headless {
+			vulkan_library, library_loaded := dynlib.load_library(VULKAN_LIBRARY_PATH)
+			if library_loaded == false {
+				log.errorf("Failed to load the Vulkan library '%s'\n", VULKAN_LIBRARY_PATH)
+				return false
+			}
+			get_instance_proc_addr, found := dynlib.symbol_address(
+				vulkan_library,
+				"vkGetInstanceProcAddr",
+			)
+			if found == false {
+				log.error("Failed to find vkGetInstanceProcAddr")
+				return false
+			}
+			vk.load_proc_addresses(get_instance_proc_addr)
+		} else {
+			G_RENDERER.windowID = sdl.GetWindowID(p_options.window)
+			vk.load_proc_addresses(sdl.Vulkan_GetVkGetInstanceProcAddr())
+		}
 
 		temp_arena: common.Arena
 		common.temp_arena_init(&temp_arena, common.MEGABYTE)
@@ -110,7 +153,7 @@ when USE_VULKAN_BACKEND {
 			defer delete(required_layers)
 
 			// Add SDL extensions
-			{
+			if G_RENDERER.is_headless == false {
 				extension_count: c.uint
 				sdl.Vulkan_GetInstanceExtensions(window, &extension_count, nil)
 				resize(&instance_extensions, int(extension_count))
@@ -128,6 +171,11 @@ when USE_VULKAN_BACKEND {
 					vk.EXT_DEBUG_REPORT_EXTENSION_NAME,
 					vk.EXT_DEBUG_UTILS_EXTENSION_NAME,
 				)
+			} else when VULKAN_VALIDATION {
+				append(&instance_extensions, vk.EXT_DEBUG_UTILS_EXTENSION_NAME)
+			}
+			when VULKAN_VALIDATION {
+				append(&required_layers, VULKAN_VALIDATION_LAYER_NAME)
 			}
 
 			// Bindless support
@@ -205,6 +253,13 @@ when USE_VULKAN_BACKEND {
 				pApplicationInfo        = &app_info,
 			}
 
+			// Chained, so that the instance creation is validated as well
+			debug_messenger_info := validation_debug_messenger_create_info()
+			when VULKAN_VALIDATION {
+				G_VALIDATION.logger = context.logger
+				instance_info.pNext = &debug_messenger_info
+			}
+
 			if vk.CreateInstance(&instance_info, nil, &instance) != .SUCCESS {
 				log.error("Failed to create Vulkan instance")
 				return false
@@ -214,8 +269,23 @@ when USE_VULKAN_BACKEND {
 		// Load the rest of the functions
 		vk.load_proc_addresses(G_RENDERER.instance)
 
+		when VULKAN_VALIDATION {
+			debug_messenger_info := validation_debug_messenger_create_info()
+			if vk.CreateDebugUtilsMessengerEXT(
+				   G_RENDERER.instance,
+				   &debug_messenger_info,
+				   nil,
+				   &G_RENDERER.debug_messenger,
+			   ) !=
+			   .SUCCESS {
+				log.error("Failed to create the Vulkan debug messenger")
+				return false
+			}
+		}
+
 		// Create a single surface for now
-		if !sdl.Vulkan_CreateSurface(G_RENDERER.window, G_RENDERER.instance, &G_RENDERER.surface) {
+		if G_RENDERER.is_headless == false &&
+		   !sdl.Vulkan_CreateSurface(G_RENDERER.window, G_RENDERER.instance, &G_RENDERER.surface) {
 			log.error("SDL couldn't create vulkan surface")
 			return false
 		}
@@ -300,48 +370,59 @@ when USE_VULKAN_BACKEND {
 					continue
 				}
 
-				// surface capabilities
 				capabilities: vk.SurfaceCapabilitiesKHR
-				vk.GetPhysicalDeviceSurfaceCapabilitiesKHR(pd, surface, &capabilities)
-
-				// supported formats
-				format_count: u32
-				vk.GetPhysicalDeviceSurfaceFormatsKHR(pd, surface, &format_count, nil)
-				if format_count == 0 {
-					continue
-				}
+				formats: []vk.SurfaceFormatKHR
+				present_modes: []vk.PresentModeKHR
+
+				// Nothing is presented in headless mode, so there's no surface to check
+				if G_RENDERER.is_headless == false {
+					// surface capabilities
+					vk.GetPhysicalDeviceSurfaceCapabilitiesKHR(pd, surface, &capabilities)
+
+					// supported formats
+					format_count: u32
+					vk.GetPhysicalDeviceSurfaceFormatsKHR(pd, surface, &format_count, nil)
+					if format_count == 0 {
+						continue
+					}
 
-				formats := make(
-					[]vk.SurfaceFormatKHR,
-					int(format_count),
-					G_RENDERER_ALLOCATORS.main_allocator,
-				)
-				vk.GetPhysicalDeviceSurfaceFormatsKHR(
-					pd,
-					surface,
-					&format_count,
-					raw_data(formats),
-				)
+					formats = make(
+						[]vk.SurfaceFormatKHR,
+						int(format_count),
+						G_RENDERER_ALLOCATORS.main_allocator,
+					)
+					vk.GetPhysicalDeviceSurfaceFormatsKHR(
+						pd,
+						surface,
+						&format_count,
+						raw_data(formats),
+					)
+
+					// supported present modes
+					present_mode_count: u32
+					vk.GetPhysicalDeviceSurfacePresentModesKHR(
+						pd,
+						surface,
+						&present_mode_count,
+						nil,
+					)
+					if present_mode_count == 0 {
+						continue
+					}
 
-				// supported present modes
-				present_mode_count: u32
-				vk.GetPhysicalDeviceSurfacePresentModesKHR(pd, surface, &present_mode_count, nil)
-				if present_mode_count == 0 {
-					continue
+					present_modes = make(
+						[]vk.PresentModeKHR,
+						int(present_mode_count),
+						G_RENDERER_ALLOCATORS.main_allocator,
+					)
+					vk.GetPhysicalDeviceSurfacePresentModesKHR(
+						pd,
+						surface,
+						&present_mode_count,
+						raw_data(present_modes),
+					)
 				}
 
-				present_modes := make(
-					[]vk.PresentModeKHR,
-					int(present_mode_count),
-					G_RENDERER_ALLOCATORS.main_allocator,
-				)
-				vk.GetPhysicalDeviceSurfacePresentModesKHR(
-					pd,
-					surface,
-					&present_mode_count,
-					raw_data(present_modes),
-				)
-
 				// check the device queue families
 				queue_family_count: u32
 				vk.GetPhysicalDeviceQueueFamilyProperties(pd, &queue_family_count, nil)
@@ -382,7 +463,12 @@ when USE_VULKAN_BACKEND {
 					}
 
 					present_support: b32
-					vk.GetPhysicalDeviceSurfaceSupportKHR(pd, u32(i), surface, &present_support)
+					if G_RENDERER.is_headless {
+						// The graphics queue stands in for the present queue
+						present_support = .GRAPHICS in qf.queueFlags
+					} else {
+						vk.GetPhysicalDeviceSurfaceSupportKHR(pd, u32(i), surface, &present_support)
+					}
 					if present_index == -1 && present_support {
 						present_index = i
 					}
@@ -408,7 +494,7 @@ when USE_VULKAN_BACKEND {
 				   present_index != -1 &&
 				   compute_index != -1 &&
 				   transfer_index != -1 &&
-				   device_props.deviceType != .CPU {
+				   (device_props.deviceType != .CPU || G_RENDERER.is_headless) {
 
 					log.infof("Picked device: %s\n ", device_props.deviceName)
 
@@ -429,7 +515,7 @@ when USE_VULKAN_BACKEND {
 						G_RENDERER.gpu_device_flags += {.DedicatedTransferQueue}
 					}
 
-					if queue_family_compute_index != queue_family_compute_index {
+					if queue_family_compute_index != queue_family_graphics_index {
 						G_RENDERER.gpu_device_flags += {.DedicatedComputeQueue}
 					}
 
@@ -447,6 +533,9 @@ when USE_VULKAN_BACKEND {
 			G_RENDERER.min_uniform_buffer_alignment = u32(
 				device_properties.limits.minUniformBufferOffsetAlignment,
 			)
+			G_RENDERER.min_storage_buffer_alignment = u32(
+				device_properties.limits.minStorageBufferOffsetAlignment,
+			)
 		}
 
 		// Create logical device for our queues (and the queues themselves)
@@ -490,6 +579,7 @@ when USE_VULKAN_BACKEND {
 			device_features := vk.PhysicalDeviceFeatures{}
 			device_features.samplerAnisotropy = true
 			device_features.depthClamp = true
+			device_features.multiDrawIndirect = true
 
 			maintenance5 := vk.PhysicalDeviceMaintenance5FeaturesKHR {
 				sType                 = .PHYSICAL_DEVICE_MAINTENANCE_5_FEATURES_KHR,
@@ -530,12 +620,32 @@ when USE_VULKAN_BACKEND {
 				pNext                                        = &dynamic_rendering_fratures,
 			}
 
+			// The GPU profiler resets its query pools from the CPU
+			host_query_reset_features := vk.PhysicalDeviceHostQueryResetFeatures {
+				sType          = .PHYSICAL_DEVICE_HOST_QUERY_RESET_FEATURES,
+				hostQueryReset = true,
+				pNext          = &descriptor_indexing_features,
+			}
+
 			buffer_device_address_features := vk.PhysicalDeviceBufferDeviceAddressFeatures {
 				sType = .PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES,
-				pNext = &descriptor_indexing_features,
+				pNext = &host_query_reset_features,
 				bufferDeviceAddress = true,
 			}
 
+			// Lets the pipeline creation check the pipeline cache without compiling
+			pipeline_creation_cache_control_features :=
+				vk.PhysicalDevicePipelineCreationCacheControlFeatures {
+					sType                        = .PHYSICAL_DEVICE_PIPELINE_CREATION_CACHE_CONTROL_FEATURES,
+					pipelineCreationCacheControl = true,
+					pNext                        = &buffer_device_address_features,
+				}
+
+			// The swapchain isn't used in headless mode, the extension might not even be there
+			if G_RENDERER.is_headless {
+				synchronization2_features.pNext = &maintenance5
+			}
+
 			device_create_info := vk.DeviceCreateInfo {
 				sType                   = .DEVICE_CREATE_INFO,
 				queueCreateInfoCount    = u32(len(queue_create_infos)),
@@ -543,7 +653,7 @@ when USE_VULKAN_BACKEND {
 				enabledExtensionCount   = u32(len(enabled_device_extensions)),
 				ppEnabledExtensionNames = raw_data(enabled_device_extensions),
 				pEnabledFeatures        = &device_features,
-				pNext                   = &buffer_device_address_features,
+				pNext                   = &pipeline_creation_cache_control_features,
 			}
 
 			if result := vk.CreateDevice(physical_device, &device_create_info, nil, &device);
@@ -580,15 +690,6 @@ when USE_VULKAN_BACKEND {
 		// Load device function pointers
 		vk.load_proc_addresses(G_RENDERER.device)
 
-		// Get the swapchain working
-		G_RENDERER.swapchain_images = make([dynamic]vk.Image)
-
-		if create_swapchain() == false {
-			return false
-		}
-
-		create_synchronization_primitives()
-
 		// Init VMA
 		{
 			vulkan_functions := vma.create_vulkan_functions()
@@ -605,12 +706,32 @@ when USE_VULKAN_BACKEND {
 			}
 		}
 
+		// Get the swapchain working
+		G_RENDERER.swapchain_images = make([dynamic]vk.Image)
+
+		if G_RENDERER.is_headless {
+			if create_headless_images(p_options.headless_resolution) == false {
+				return false
+			}
+		} else if create_swapchain() == false {
+			return false
+		}
+
+		create_synchronization_primitives()
+
 		return true
 	}
 	//---------------------------------------------------------------------------//
 	@(private)
 	deinit_backend :: proc() {
 		using G_RENDERER
+		for allocation, i in headless_image_allocations {
+			vk.DestroyImageView(device, swapchain_image_views[i], nil)
+			vma.destroy_image(vma_allocator, swapchain_images[i], allocation)
+		}
+		if is_headless {
+			clear(&swapchain_image_views)
+		}
 		vma.destroy_allocator(vma_allocator)
 		for i in 0 ..< num_frames_in_flight {
 			vk.DestroyFence(device, frame_fences[i], nil)
@@ -630,6 +751,9 @@ when USE_VULKAN_BACKEND {
 		if surface != vk.SurfaceKHR(0) {
 			vk.DestroySurfaceKHR(instance, surface, nil)
 		}
+		if debug_messenger != vk.DebugUtilsMessengerEXT(0) {
+			vk.DestroyDebugUtilsMessengerEXT(instance, debug_messenger, nil)
+		}
 		if instance != nil {
 			vk.DestroyInstance(instance, nil)
 		}
@@ -638,6 +762,48 @@ when USE_VULKAN_BACKEND {
 		}
 		sdl.Quit()
 	}
+
+	//---------------------------------------------------------------------------//
+
+	@(private)
+	backend_get_num_validation_errors :: proc() -> u32 {
+		return sync.atomic_load(&G_VALIDATION.num_errors)
+	}
+
+	//---------------------------------------------------------------------------//
+
+	@(private = "file")
+	validation_debug_messenger_create_info :: proc() -> vk.DebugUtilsMessengerCreateInfoEXT {
+		return vk.DebugUtilsMessengerCreateInfoEXT {
+			sType           = .DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT,
+			messageSeverity = {.WARNING, .ERROR},
+			messageType     = {.GENERAL, .VALIDATION, .PERFORMANCE},
+			pfnUserCallback = validation_debug_messenger_callback,
+		}
+	}
+
+	//---------------------------------------------------------------------------//
+
+	@(private = "file")
+	validation_debug_messenger_callback :: proc "system" (
+		p_message_severity: vk.DebugUtilsMessageSeverityFlagsEXT,
+		p_message_types: vk.DebugUtilsMessageTypeFlagsEXT,
+		p_callback_data: ^vk.DebugUtilsMessengerCallbackDataEXT,
+		p_user_data: rawptr,
+	) -> b32 {
+		context = runtime.default_context()
+		context.logger = G_VALIDATION.logger
+
+		if .ERROR in p_message_severity {
+			sync.atomic_add(&G_VALIDATION.num_errors, 1)
+			log.errorf("Vulkan validation: %s\n", p_callback_data.pMessage)
+		} else {
+			log.warnf("Vulkan validation: %s\n", p_callback_data.pMessage)
+		}
+
+		// The call that triggered the message isn't aborted
+		return false
+	}
 }
 //---------------------------------------------------------------------------//
 
@@ -668,6 +834,11 @@ backend_wait_for_frame_resources :: proc() {
 @(private)
 backend_post_render :: proc() {
 
+	// The offscreen images aren't presented, they're left as they are
+	if G_RENDERER.is_headless {
+		return
+	}
+
 	swap_image_ref := G_RENDERER.swap_image_refs[G_RENDERER.swap_img_idx]
 	swap_image := &g_resources.backend_images[image_get_idx(swap_image_ref)]
 
@@ -712,6 +883,42 @@ backend_submit_current_frame :: proc() {
 
 	backend_cmd_buff := &g_resources.backend_cmd_buffers[command_buffer_get_idx(get_frame_cmd_buffer_ref())]
 
+	wait_semaphores: [2]vk.Semaphore
+	wait_stages: [2]vk.PipelineStageFlags
+	num_wait_semaphores: u32 = 0
+
+	// The graphics work recorded after the async compute tasks waits for them,
+	// see renderer_async_compute.odin
+	if async_compute_is_graphics_split() {
+		wait_semaphores[num_wait_semaphores] = backend_async_compute_submit()
+		wait_stages[num_wait_semaphores] = {.ALL_COMMANDS}
+		num_wait_semaphores += 1
+	}
+
+	// Headless frames don't acquire and present an image, so they don't wait for
+	// nor signal the semaphores. The present fences stay signaled.
+	if G_RENDERER.is_headless {
+		vk.ResetFences(G_RENDERER.device, 1, &G_RENDERER.frame_fences[get_frame_idx()])
+
+		submit_info := vk.SubmitInfo {
+			sType              = .SUBMIT_INFO,
+			waitSemaphoreCount = num_wait_semaphores,
+			pWaitSemaphores    = &wait_semaphores[0],
+			pWaitDstStageMask  = &wait_stages[0],
+			commandBufferCount = 1,
+			pCommandBuffers    = &backend_cmd_buff.vk_cmd_buff,
+		}
+
+		vk.QueueSubmit(
+			G_RENDERER.graphics_queue,
+			1,
+			&submit_info,
+			G_RENDERER.frame_fences[get_frame_idx()],
+		)
+
+		return
+	}
+
 	// Submit
 	{
 		reset_fences := []vk.Fence {
@@ -720,15 +927,20 @@ backend_submit_current_frame :: proc() {
 		}
 		vk.ResetFences(G_RENDERER.device, u32(len(reset_fences)), raw_data(reset_fences))
 
+		image_available_semaphore := G_RENDERER.image_available_semaphores[get_frame_idx()]
+		wait_semaphores[num_wait_semaphores] = image_available_semaphore
+		wait_stages[num_wait_semaphores] = {.COLOR_ATTACHMENT_OUTPUT}
+		num_wait_semaphores += 1
+
 		submit_info := vk.SubmitInfo {
 			sType                = .SUBMIT_INFO,
-			pWaitDstStageMask    = &vk.PipelineStageFlags{.COLOR_ATTACHMENT_OUTPUT},
+			pWaitDstStageMask    = &wait_stages[0],
 			commandBufferCount   = 1,
 			pCommandBuffers      = &backend_cmd_buff.vk_cmd_buff,
-			waitSemaphoreCount   = 1,
+			waitSemaphoreCount   = num_wait_semaphores,
 			signalSemaphoreCount = 1,
 			pSignalSemaphores    = &G_RENDERER.render_finished_semaphores[get_frame_idx()],
-			pWaitSemaphores      = &G_RENDERER.image_available_semaphores[get_frame_idx()],
+			pWaitSemaphores      = &wait_semaphores[0],
 		}
 
 		vk.QueueSubmit(
@@ -915,6 +1127,83 @@ create_swapchain :: proc(p_is_recreating: bool = false) -> bool {
 	return true
 }
 
+// Creates the offscreen images used in place of the swapchain images in headless mode,
+// one for each frame in flight, with the format the swapchain would use
+@(private = "file")
+create_headless_images :: proc(p_resolution: glsl.uvec2) -> bool {
+	G_RENDERER.swapchain_format = {
+		format     = .B8G8R8A8_SRGB,
+		colorSpace = .SRGB_NONLINEAR,
+	}
+	G_RENDERER.swap_extent = {p_resolution.x, p_resolution.y}
+
+	resize(&G_RENDERER.swapchain_images, MAX_NUM_FRAMES_IN_FLIGHT)
+	resize(&G_RENDERER.swapchain_image_views, MAX_NUM_FRAMES_IN_FLIGHT)
+	resize(&G_RENDERER.headless_image_allocations, MAX_NUM_FRAMES_IN_FLIGHT)
+
+	for i in 0 ..< MAX_NUM_FRAMES_IN_FLIGHT {
+		image_create_info := vk.ImageCreateInfo {
+			sType = .IMAGE_CREATE_INFO,
+			imageType = .D2,
+			format = G_RENDERER.swapchain_format.format,
+			extent = {width = p_resolution.x, height = p_resolution.y, depth = 1},
+			mipLevels = 1,
+			arrayLayers = 1,
+			samples = {._1},
+			tiling = .OPTIMAL,
+			usage = {.COLOR_ATTACHMENT, .TRANSFER_SRC},
+			sharingMode = .EXCLUSIVE,
+			initialLayout = .UNDEFINED,
+		}
+
+		alloc_create_info := vma.AllocationCreateInfo {
+			usage = .AUTO,
+		}
+
+		if res := vma.create_image(
+			G_RENDERER.vma_allocator,
+			&image_create_info,
+			&alloc_create_info,
+			&G_RENDERER.swapchain_images[i],
+			&G_RENDERER.headless_image_allocations[i],
+			nil,
+		); res != .SUCCESS {
+			log.errorf("Failed to create headless image %s", res)
+			return false
+		}
+
+		view_create_info := vk.ImageViewCreateInfo {
+			sType = .IMAGE_VIEW_CREATE_INFO,
+			image = G_RENDERER.swapchain_images[i],
+			viewType = .D2,
+			format = G_RENDERER.swapchain_format.format,
+			components = {r = .IDENTITY, g = .IDENTITY, b = .IDENTITY, a = .IDENTITY},
+			subresourceRange = {
+				aspectMask = {.COLOR},
+				baseMipLevel = 0,
+				levelCount = 1,
+				baseArrayLayer = 0,
+				layerCount = 1,
+			},
+		}
+
+		if vk.CreateImageView(
+			   G_RENDERER.device,
+			   &view_create_info,
+			   nil,
+			   &G_RENDERER.swapchain_image_views[i],
+		   ) !=
+		   .SUCCESS {
+			log.error("Error creating headless image view\n")
+			return false
+		}
+	}
+
+	return true
+}
+
+//---------------------------------------------------------------------------//
+
 create_synchronization_primitives :: proc() {
 	using G_RENDERER
 
@@ -1029,6 +1318,16 @@ backend_begin_frame :: proc() {
 
 	frame_idx := get_frame_idx()
 
+	// There's an offscreen image per frame in flight
+	if G_RENDERER.is_headless {
+		G_RENDERER.swap_img_idx = frame_idx
+		if is_async_transfer_enabled() {
+			backend_buffer_upload_start_async_cmd_buffer_pre_graphics()
+			backend_buffer_upload_start_async_cmd_buffer_post_graphics()
+		}
+		return
+	}
+
 	// @TODO Move this after recording the command buffer to save some performance
 	acquire_result := vk.AcquireNextImageKHR(
 		G_RENDERER.device,
@@ -7,14 +7,41 @@ import "core:log"
 import "core:math/linalg/glsl"
 import "core:os"
 
+// Runs the CPU benchmarks headless and exits, without creating a window or a renderer
+RUN_BENCHMARKS :: #config(NEAT_RUN_BENCHMARKS, false)
+
+// Runs the correctness checks of the engine systems headless and exits with a non-zero code
+// if any of them fails, without creating a window or a renderer
+RUN_CHECKS :: #config(NEAT_RUN_CHECKS, false)
+
+// Renders a fixed camera flythrough of Sponza without a window, writes the frame timings and
+// the final image, then exits. Also runs on the software Vulkan drivers, e.g. lavapipe.
+RUN_HEADLESS :: #config(NEAT_RUN_HEADLESS, false)
+
+// Loads the assets from a single asset pack file instead of the loose files, the pack is built on first use
+USE_ASSET_PACK :: #config(NEAT_USE_ASSET_PACK, false)
+
 main :: proc() {
 
 	logg := log.create_console_logger()
 	context.logger = logg
 
+	when RUN_CHECKS {
+		if run_checks() == false {
+			os.exit(-1)
+		}
+		return
+	}
+
+	when RUN_BENCHMARKS {
+		run_benchmarks()
+		return
+	}
+
 	engine_opts := engine.InitOptions {
 		window_width  = 1920,
 		window_height = 1080,
+		headless      = RUN_HEADLESS,
 	}
 	if engine.init(engine_opts) == false {
 		os.exit(-1)
@@ -23,21 +50,34 @@ main :: proc() {
 	engine.mesh_asset_import(
 		engine.MeshAssetImportOptions {
 			file_path = "D:/glTF-Sample-Models-master/glTF-Sample-Models-master/2.0/FlightHelmet/glTF/FlightHelmet.gltf",
+			flags     = {.GenerateLODs},
 		},
 	)
 
 	engine.mesh_asset_import(
 		engine.MeshAssetImportOptions {
 			file_path = "D:/glTF-Sample-Models-master/glTF-Sample-Models-master/2.0/SciFiHelmet/glTF/SciFiHelmet.gltf",
+			flags     = {.GenerateLODs},
 		},
 	)
 
 	engine.mesh_asset_import(
 		engine.MeshAssetImportOptions {
 			file_path = "D:/glTF-Sample-Models-master/glTF-Sample-Models-master/2.0/Sponza/glTF/Sponza.gltf",
+			flags     = {.GenerateLODs},
 		},
 	)
 
+	when USE_ASSET_PACK {
+		if os.exists(engine.G_ASSET_PACK_PATH) == false &&
+		   engine.asset_pack_build(engine.G_ASSET_PACK_PATH) == false {
+			os.exit(-1)
+		}
+		if engine.asset_pack_mount(engine.G_ASSET_PACK_PATH) == false {
+			os.exit(-1)
+		}
+	}
+
 	// flight_helmet := engine.mesh_asset_get(engine.mesh_asset_load("FlightHelmet"))
 	// scifi_helmet := engine.mesh_asset_get(engine.mesh_asset_load("SciFiHelmet"))
 	sponza := engine.mesh_asset_get(engine.mesh_asset_load("Sponza"))
@@ -68,5 +108,102 @@ main :: proc() {
 	// 	)
 	// }
 
-	engine.run()
+	when RUN_HEADLESS {
+		headless_camera_path := []engine.HeadlessCameraKey {
+			{position = {-9, 1.5, 0}, yaw = 0, pitch = 0},
+			{position = {0, 2, 0}, yaw = 45, pitch = 10},
+			{position = {9, 1.5, 0}, yaw = 180, pitch = 0},
+			{position = {0, 6, -3}, yaw = 270, pitch = -20},
+		}
+		headless_run_options := engine.HeadlessRunOptions {
+			num_frames        = 600,
+			num_warmup_frames = 60,
+			camera_path       = headless_camera_path,
+			timings_path      = "app_data/headless_timings.csv",
+			scene_dump_path   = "app_data/headless_scene.png",
+		}
+		if engine.run_headless(headless_run_options) == false {
+			os.exit(-1)
+		}
+	} else {
+		engine.run()
+	}
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+run_benchmarks :: proc() {
+	engine.mem_init(engine.MemoryInitOptions{total_available_memory = 64 * common.MEGABYTE})
+	common.init_names(engine.G_ALLOCATORS.string_allocator)
+
+	if common.jobs_init({}, context.allocator) == false {
+		os.exit(-1)
+	}
+	defer common.jobs_deinit()
+
+	if common.jobs_run_stress_test() == false {
+		os.exit(-1)
+	}
+	common.jobs_run_scaling_benchmark()
+	common.ref_array_run_benchmark()
+
+	for num_instances in ([]u32{10000, 50000, 100000}) {
+		renderer.culling_run_benchmark(num_instances)
+	}
+
+	for num_instances in ([]u32{1000, 10000, 50000}) {
+		renderer.mesh_batches_run_benchmark(num_instances)
+	}
+
+	for num_writes in ([]u32{1000, 10000, 50000}) {
+		renderer.buffer_upload_run_benchmark(num_writes)
+	}
+
+	engine.texture_compression_run_benchmark()
+	engine.meshlets_run_benchmark()
+	engine.mesh_compression_run_benchmark()
+	engine.asset_pack_run_benchmark()
+}
+
+//---------------------------------------------------------------------------//
+
+@(private = "file")
+run_checks :: proc() -> bool {
+	engine.mem_init(engine.MemoryInitOptions{total_available_memory = 64 * common.MEGABYTE})
+	common.init_names(engine.G_ALLOCATORS.string_allocator)
+
+	if common.jobs_init({}, context.allocator) == false {
+		return false
+	}
+	defer common.jobs_deinit()
+
+	// Run all of them, so a single run reports every failure
+	success := true
+
+	if renderer.buffer_upload_run_checks() == false {
+		success = false
+	}
+
+	if common.lz4_run_checks() == false {
+		success = false
+	}
+
+	if common.ref_array_run_checks() == false {
+		success = false
+	}
+
+	if engine.mesh_simplifier_run_checks() == false {
+		success = false
+	}
+
+	if engine.mesh_vertex_packing_run_checks() == false {
+		success = false
+	}
+
+	if success == false {
+		log.error("Checks failed\n")
+	}
+
+	return success
 }
@@ -1,6 +1,11 @@
 package assimp
 
-foreign import assimp "external/assimp-vc143-mt.lib"
+when ODIN_OS == .Windows {
+	foreign import assimp "external/assimp-vc143-mt.lib"
+} else {
+	// Linked against the system package, e.g. libassimp-dev
+	foreign import assimp "system:assimp"
+}
 
 import _c "core:c"
 
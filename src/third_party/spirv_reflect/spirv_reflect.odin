@@ -1,6 +1,10 @@
 package spirv_reflect
 
-foreign import spirv_reflect "external/spirv_reflect.lib"
+when ODIN_OS == .Windows {
+	foreign import spirv_reflect "external/spirv_reflect.lib"
+} else {
+	foreign import spirv_reflect {"external/spirv_reflect.a", "system:stdc++"}
+}
 
 import _c "core:c"
 
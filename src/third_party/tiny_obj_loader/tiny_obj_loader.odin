@@ -1,6 +1,10 @@
 package tiny_obj_loader
 
-foreign import "external/tiny_obj_loader.lib"
+when ODIN_OS == .Windows {
+	foreign import tiny_obj_loader "external/tiny_obj_loader.lib"
+} else {
+	foreign import tiny_obj_loader "external/tiny_obj_loader.a"
+}
 
 import _c "core:c"
 
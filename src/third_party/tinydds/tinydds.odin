@@ -1,6 +1,10 @@
 package tinydds
 
-foreign import "external/tinydds.lib"
+when ODIN_OS == .Windows {
+	foreign import tinydds "external/tinydds.lib"
+} else {
+	foreign import tinydds {"external/tinydds.a", "system:stdc++"}
+}
 
 import _c "core:c"
 
@@ -2,7 +2,11 @@ package vma
 
 import vk "vendor:vulkan"
 
-foreign import "external/vma.lib"
+when ODIN_OS == .Windows {
+	foreign import vma "external/vma.lib"
+} else {
+	foreign import vma {"external/vma.a", "system:stdc++"}
+}
 
 import _c "core:c"
 